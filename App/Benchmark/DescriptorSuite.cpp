@@ -0,0 +1,106 @@
+#include "Microbenchmark.hpp"
+
+#include "../Engine/Abstraction/BufferManager.hpp"
+#include "../Engine/Abstraction/DescriptorBufferManager.hpp"
+
+#include <vector>
+#include <initializer_list>
+
+using std::vector;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	constexpr uint32_t DescriptorIteration = 100u;
+	constexpr uint32_t DescriptorSetCount = 1024u;
+	//The size of storage buffer range referenced by each descriptor set, which satisfies the offset alignment of every device.
+	constexpr VkDeviceSize StorageRangeSize = 256ull;
+
+	inline VKO::DescriptorSetLayout createStorageDescriptorSetLayout(const VkDevice device) {
+		constexpr static VkDescriptorSetLayoutBinding storage {
+			.binding = 0u,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1u,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+		};
+		constexpr static VkDescriptorSetLayoutCreateInfo storage_ds {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT,
+			.bindingCount = 1u,
+			.pBindings = &storage
+		};
+		return VKO::createDescriptorSetLayout(device, storage_ds);
+	}
+
+}
+
+void Microbenchmark::runDescriptorBenchmark(Suite& suite, const VulkanContext& ctx) {
+	if (!suite.isSelected("DescriptorBufferManager")) {
+		return;
+	}
+	using UpdateInfo = DescriptorBufferManager::DescriptorUpdater::UpdateInfo;
+
+	const VKO::DescriptorSetLayout ds_layout = ::createStorageDescriptorSetLayout(ctx.Device);
+	const vector<VkDescriptorSetLayout> set_layout(::DescriptorSetCount, ds_layout);
+	DescriptorBufferManager descriptor_buffer(ctx, set_layout, VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT);
+
+	//the buffer is never accessed, only its address is written to descriptors
+	const VKO::BufferAllocation storage = BufferManager::createDeviceBuffer({ ctx.Device, ctx.Allocator,
+		::DescriptorSetCount * ::StorageRangeSize }, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		VKO::AllocationCategory::Geometry);
+	const VkDeviceAddress storage_address = BufferManager::addressOf(ctx.Device, storage.second);
+
+	//descriptor data are fetched when updating, so address info must outlive each update only
+	vector<VkDescriptorAddressInfoEXT> address_info(::DescriptorSetCount);
+	vector<UpdateInfo> update_info(::DescriptorSetCount);
+	for (uint32_t i = 0u; i < ::DescriptorSetCount; i++) {
+		address_info[i] = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
+			.address = storage_address + i * ::StorageRangeSize,
+			.range = ::StorageRangeSize
+		};
+		update_info[i] = {
+			.SetLayout = ds_layout,
+			.SetIndex = i,
+			.GetInfo = {
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				{ .pStorageBuffer = &address_info[i] }
+			}
+		};
+	}
+	//every other set is updated first, such that no written range is adjacent until the updater runs out of dirty range
+	vector<UpdateInfo> strided_update_info;
+	strided_update_info.reserve(::DescriptorSetCount);
+	for (const uint32_t first : { 0u, 1u }) {
+		for (uint32_t i = first; i < ::DescriptorSetCount; i += 2u) {
+			strided_update_info.push_back(update_info[i]);
+		}
+	}
+
+	const auto runUpdate = [&suite, &ctx, &descriptor_buffer](const char* const name, const vector<UpdateInfo>& update) {
+		suite.run(name, ::DescriptorIteration, update.size(), [&ctx, &descriptor_buffer, &update]() -> Sample {
+			return { .Cpu = measureCpu([&ctx, &descriptor_buffer, &update]() {
+				DescriptorBufferManager::DescriptorUpdater updater = descriptor_buffer.createUpdater(ctx);
+				for (const auto& info : update) {
+					updater.update(info);
+				}
+				updater.flush();
+			}) };
+		});
+	};
+	runUpdate("DescriptorBufferManager/update/sequential", update_info);
+	runUpdate("DescriptorBufferManager/update/strided", strided_update_info);
+
+	//nothing is using the descriptor buffer, so any in-flight frame can be applied immediately
+	suite.run("DescriptorBufferManager/defer/sequential", ::DescriptorIteration, update_info.size(),
+		[&ctx, &descriptor_buffer, &update_info]() -> Sample {
+			return { .Cpu = measureCpu([&ctx, &descriptor_buffer, &update_info]() {
+				for (const auto& info : update_info) {
+					descriptor_buffer.defer(ctx, 0u, info);
+				}
+				descriptor_buffer.applyDeferred(ctx, 0u);
+			}) };
+		});
+}
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "Microbenchmark.hpp"
+
+#include "../Renderer/GeometryData.hpp"
+#include "../Renderer/PlaneGeometry.hpp"
+
+#include "../Engine/Abstraction/AccelStructManager.hpp"
+#include "../Engine/Abstraction/CommandBufferManager.hpp"
+#include "../Engine/Abstraction/ImageManager.hpp"
+#include "../Engine/Abstraction/PipelineBarrier.hpp"
+#include "../Common/ErrorHandler.hpp"
+
+#include <glm/vec2.hpp>
+
+#include <array>
+#include <optional>
+#include <string>
+#include <sstream>
+#include <utility>
+
+using glm::dvec2, glm::uvec2;
+
+using std::array, std::pair;
+using std::optional;
+using std::string, std::to_string;
+using std::ostringstream;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	constexpr uint32_t GeometryIteration = 20u;
+	//Subdivision of the plane in each axis, the number of triangle is twice the square of it.
+	constexpr array PlaneSubdivision = { 64u, 128u, 256u, 512u, 1024u };
+	constexpr dvec2 PlaneDimension = dvec2(1024.0);
+	constexpr float PlaneAltitude = 64.0f;
+
+	constexpr uint32_t DisplacementMapSize = 256u;
+	constexpr VkFormat DisplacementMapFormat = VK_FORMAT_R8_UNORM;
+
+	struct DisplacementMap {
+
+		VKO::ImageAllocation Image;
+		VKO::ImageView View;
+		VKO::Sampler Sampler;
+
+	};
+
+	inline string createName(const char* const operation, const uint32_t subdivision) {
+		string name = operation;
+		name += '/';
+		name += to_string(subdivision);
+		return name;
+	}
+
+	//Record commands executed by a primary command buffer, with a pair of timestamp around the timed part, and submit it.
+	template<typename Record, typename Timed>
+	optional<double> submitTimed(Microbenchmark::DeviceTimer& timer, const VkCommandBuffer cmd,
+		Record&& record, Timed&& timed) {
+		CommandBufferManager::beginOneTimeSubmit(cmd);
+		record();
+		timer.begin(cmd);
+		timed();
+		timer.end(cmd);
+		CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
+		return timer.submit(cmd);
+	}
+
+	DisplacementMap createDisplacementMap(const VulkanContext& ctx, Microbenchmark::DeviceTimer& timer, const VkCommandBuffer cmd) {
+		DisplacementMap map {
+			.Image = ImageManager::createImage({
+				.Device = ctx.Device,
+				.Allocator = ctx.Allocator,
+				.Category = VKO::AllocationCategory::Texture,
+				.Flag = { },
+				.ImageType = VK_IMAGE_TYPE_2D,
+				.Format = ::DisplacementMapFormat,
+				.Extent = { ::DisplacementMapSize, ::DisplacementMapSize, 1u },
+				.Usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+			})
+		};
+		map.View = ImageManager::createFullImageView({
+			.Device = ctx.Device,
+			.Image = map.Image.second,
+			.ViewType = VK_IMAGE_VIEW_TYPE_2D,
+			.Format = ::DisplacementMapFormat,
+			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+		});
+		map.Sampler = VKO::createSampler(ctx.Device, {
+			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+			.magFilter = VK_FILTER_LINEAR,
+			.minFilter = VK_FILTER_NEAREST,
+			.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+			.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.maxLod = VK_LOD_CLAMP_NONE
+		});
+
+		//the content does not affect the cost of displacement, so a constant height is enough
+		const VkImageSubresourceRange full_image = ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+		CommandBufferManager::beginOneTimeSubmit(cmd);
+		{
+			PipelineBarrier<0u, 0u, 1u> barrier;
+			barrier.addImageBarrier({
+				VK_PIPELINE_STAGE_2_NONE,
+				VK_ACCESS_2_NONE,
+				VK_PIPELINE_STAGE_2_CLEAR_BIT,
+				VK_ACCESS_2_TRANSFER_WRITE_BIT
+			}, {
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+			}, map.Image.second, full_image);
+			barrier.record(cmd);
+		}
+		constexpr static VkClearColorValue height = { .float32 = { 0.5f, 0.0f, 0.0f, 0.0f } };
+		vkCmdClearColorImage(cmd, map.Image.second, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &height, 1u, &full_image);
+		{
+			PipelineBarrier<0u, 0u, 1u> barrier;
+			barrier.addImageBarrier({
+				VK_PIPELINE_STAGE_2_CLEAR_BIT,
+				VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				PlaneGeometry::DisplacementStage,
+				PlaneGeometry::DisplacementAccess
+			}, {
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			}, map.Image.second, full_image);
+			barrier.record(cmd);
+		}
+		CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
+		timer.submit(cmd);
+
+		return map;
+	}
+
+	void runPlaneBenchmark(Microbenchmark::Suite& suite, const VulkanContext& ctx, const PlaneGeometry& generator,
+		const PlaneGeometry::Displacement& displacement, Microbenchmark::DeviceTimer& timer, const VkCommandBuffer cmd,
+		const uint32_t subdivision) {
+		using enum GeometryData::BarrierTarget;
+		namespace ASM = AccelStructManager;
+
+		const PlaneGeometry::Property property {
+			.Dimension = ::PlaneDimension,
+			.Subdivision = uvec2(subdivision),
+			.IndexType = VK_INDEX_TYPE_UINT32,
+			.RequireAccelStructInput = true
+		};
+		GeometryData geometry;
+		const auto noRecord = []() constexpr noexcept { };
+
+		/********************************
+		 * Generation and displacement
+		 *******************************/
+		//host time covers recording of the secondary command buffer, and memory allocation of the geometry
+		const auto generate = [&](const PlaneGeometry::Displacement* const fused_displacement) -> Microbenchmark::Sample {
+			VkCommandBuffer generation_cmd;
+			const double cpu = Microbenchmark::measureCpu([&]() {
+				generation_cmd = fused_displacement ? generator.generate(ctx, property, *fused_displacement, geometry)
+					: generator.generate(ctx, property, geometry);
+			});
+			const auto gpu = ::submitTimed(timer, cmd, noRecord, [cmd, &generation_cmd]() noexcept {
+				vkCmdExecuteCommands(cmd, 1u, &generation_cmd);
+			});
+			geometry.releaseTemporary();
+			return { cpu, gpu };
+		};
+		suite.run(::createName("PlaneGeometry/generate", subdivision), ::GeometryIteration, subdivision * subdivision,
+			[&generate]() { return generate(nullptr); });
+		suite.run(::createName("PlaneGeometry/generateDisplaced", subdivision), ::GeometryIteration, subdivision * subdivision,
+			[&generate, &displacement]() { return generate(&displacement); });
+
+		//the plane must exist for everything below, even if generation is not selected
+		generate(nullptr);
+		suite.run(::createName("PlaneGeometry/displace", subdivision), ::GeometryIteration, subdivision * subdivision,
+			[&]() -> Microbenchmark::Sample {
+				VkCommandBuffer displacement_cmd;
+				const double cpu = Microbenchmark::measureCpu([&]() {
+					displacement_cmd = generator.displace(ctx, displacement, geometry);
+				});
+				//order after the previous generation or displacement, both of which write in the compute shader
+				const auto gpu = ::submitTimed(timer, cmd, [cmd, &geometry]() { geometry.barrier(cmd, Generation, Displacement); },
+					[cmd, &displacement_cmd]() noexcept { vkCmdExecuteCommands(cmd, 1u, &displacement_cmd); });
+				return { cpu, gpu };
+			});
+
+		/*****************************************
+		 * Acceleration structure
+		 ****************************************/
+		const bool build_selected = suite.isSelected(::createName("AccelStructManager/build", subdivision)),
+			compact_selected = suite.isSelected(::createName("AccelStructManager/compact", subdivision));
+		if (!build_selected && !compact_selected) {
+			return;
+		}
+		::submitTimed(timer, cmd, [cmd, &geometry]() { geometry.barrier(cmd, Displacement, AccelStructBuild); }, noRecord);
+
+		const VKO::QueryPool compaction_query = VKO::createQueryPool(ctx.Device, {
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+			.queryCount = 1u
+		});
+		const ASM::CompactionSizeQueryInfo compaction_query_info {
+			.QueryPool = compaction_query,
+			.QueryIndex = 0u
+		};
+		VkAccelerationStructureGeometryKHR as_geometry;
+		VkAccelerationStructureBuildRangeInfoKHR as_range;
+		geometry.accelerationStructureGeometry(as_geometry, 0ull);
+		geometry.accelerationStructureRange(as_range, 0u);
+		const ASM::AccelStructBuildRequest request {
+			.Type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+			.Flag = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
+			.Geometry = { &as_geometry, 1u },
+			.Range = { &as_range, 1u },
+			.CompactionSizeQuery = &compaction_query_info
+		};
+		const ASM::AccelStructBatchBuildInfo build_info {
+			.Device = ctx.Device,
+			.Allocator = ctx.Allocator,
+			.Command = cmd,
+			.ScratchAlignment = ctx.PhysicalDeviceProperty.AccelStruct.minAccelerationStructureScratchOffsetAlignment
+		};
+		const auto build = [&]() -> pair<ASM::AccelStructBuildResult, Microbenchmark::Sample> {
+			ASM::AccelStructBuildResult result;
+			double cpu;
+			const auto gpu = ::submitTimed(timer, cmd, [cmd, &compaction_query]() noexcept {
+				vkCmdResetQueryPool(cmd, compaction_query, 0u, 1u);
+			}, [&]() {
+				//host time covers allocation of acceleration structure and scratch memory, and recording of the build
+				cpu = Microbenchmark::measureCpu([&]() { result = ASM::buildAccelStruct(build_info, request); });
+			});
+			return { std::move(result), Microbenchmark::Sample { cpu, gpu } };
+		};
+		suite.run(::createName("AccelStructManager/build", subdivision), ::GeometryIteration, as_range.primitiveCount,
+			[&build]() { return build().second; });
+
+		if (!compact_selected) {
+			return;
+		}
+		//compaction only reads the source, so the same build is compacted on every iteration
+		const ASM::AccelStructBuildResult source = build().first;
+		const ASM::AccelStructCompactInfo compact_info {
+			.Device = ctx.Device,
+			.Allocator = ctx.Allocator,
+			.Command = cmd,
+			.Type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+			.Flag = 0u,
+			.CompactionSizeQuery = &compaction_query_info
+		};
+		suite.run(::createName("AccelStructManager/compact", subdivision), ::GeometryIteration, as_range.primitiveCount,
+			[&]() -> Microbenchmark::Sample {
+				ASM::AccelStruct compacted;
+				double cpu;
+				const auto gpu = ::submitTimed(timer, cmd, noRecord, [&]() {
+					//host time covers readback of the compacted size, allocation and recording of the copy
+					cpu = Microbenchmark::measureCpu([&]() {
+						compacted = ASM::compactAccelStruct(source.AccelerationStructure.AccelStruct, compact_info);
+					});
+				});
+				return { cpu, gpu };
+			});
+	}
+
+}
+
+void Microbenchmark::runGeometryBenchmark(Suite& suite, const VulkanContext& ctx, BufferArena& arena) {
+	if (!suite.isSelected("PlaneGeometry") && !suite.isSelected("AccelStructManager")) {
+		return;
+	}
+	ostringstream msg;
+	const PlaneGeometry generator(ctx, arena, msg);
+
+	//plane commands are secondary command buffers for the compute queue
+	DeviceTimer timer(ctx, ctx.Queue.Compute, ctx.QueueIndex.Compute);
+	const VKO::CommandBuffer cmd = VKO::allocateCommandBuffer(ctx.Device, {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = ctx.CommandPool.ComputeGeneral,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1u
+	});
+
+	const ::DisplacementMap map = ::createDisplacementMap(ctx, timer, cmd);
+	const PlaneGeometry::Displacement displacement {
+		.Altitude = ::PlaneAltitude,
+		.DisplacementMap = {
+			.sampler = map.Sampler,
+			.imageView = map.View,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		}
+	};
+	for (const uint32_t subdivision : ::PlaneSubdivision) {
+		::runPlaneBenchmark(suite, ctx, generator, displacement, timer, cmd, subdivision);
+	}
+}
\ No newline at end of file
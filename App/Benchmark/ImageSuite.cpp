@@ -0,0 +1,132 @@
+#include "Microbenchmark.hpp"
+
+#include "../Common/File.hpp"
+#include "../Common/PixelKernel.hpp"
+#include "../Engine/Abstraction/ImageManager.hpp"
+
+#include <LearnVulkan/GeneratedTemplate/ResourcePath.hpp>
+
+#include <array>
+#include <span>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <numeric>
+
+using std::array, std::span, std::vector;
+using std::string, std::string_view;
+
+using namespace LearnVulkan;
+namespace IM = ImageManager;
+namespace RP = ResourcePath;
+
+namespace {
+
+	constexpr uint32_t DecodeIteration = 10u, KernelIteration = 100u;
+	//The number of pixel converted by each kernel iteration, which is the size of a 2K texture.
+	constexpr size_t KernelPixelCount = 2048u * 2048u;
+
+	constexpr string_view SkyBoxRightFilename = "/right.png",
+		SkyBoxLeftFilename = "/left.png",
+		SkyBoxTopFilename = "/top.png",
+		SkyBoxBottomFilename = "/bottom.png",
+		SkyBoxFrontFilename = "/front.png",
+		SkyBoxBackFilename = "/back.png";
+	constexpr auto SkyBoxFullPath = File::toAbsolutePath<RP::SkyCubeMapResourceRoot,
+		SkyBoxRightFilename,
+		SkyBoxLeftFilename,
+		SkyBoxTopFilename,
+		SkyBoxBottomFilename,
+		SkyBoxFrontFilename,
+		SkyBoxBackFilename
+	>();
+	constexpr auto SkyBoxFullPathArray = std::apply(
+		[](const auto&... tup_elem) constexpr noexcept { return array { tup_elem.data()... }; },
+		SkyBoxFullPath
+	);
+
+	constexpr string_view HeightfieldFilename = "/TerrainHeightfield.png",
+		WaterNormalmapFilename = "/Water/waterNormal.png", WaterDistortionFilename = "/Water/waterDUDV.png";
+	constexpr auto HeightfieldFullPath = File::toAbsolutePath<RP::HeightfieldResourceRoot, HeightfieldFilename>();
+	constexpr auto WaterNormalmapFullPath = File::toAbsolutePath<RP::GeneralResourceRoot, WaterNormalmapFilename>();
+	constexpr auto WaterDistortionFullPath = File::toAbsolutePath<RP::GeneralResourceRoot, WaterDistortionFilename>();
+	constexpr array HeightfieldFullPathArray = { HeightfieldFullPath.data() },
+		WaterNormalmapFullPathArray = { WaterNormalmapFullPath.data() },
+		WaterDistortionFullPathArray = { WaterDistortionFullPath.data() };
+
+	template<IM::ImageBitWidth BitWidth>
+	void runDecode(Microbenchmark::Suite& suite, const string_view image_name, const span<const char* const> filename,
+		const IM::ImageReadInfo& read_info) {
+		string name = "ImageManager/decodeFile/";
+		name += image_name;
+		suite.run(std::move(name), ::DecodeIteration, filename.size(), [filename, &read_info]() -> Microbenchmark::Sample {
+			return { .Cpu = Microbenchmark::measureCpu([filename, &read_info]() { IM::decodeFile<BitWidth>(filename, read_info); }) };
+		});
+	}
+
+	template<typename P>
+	void runKernel(Microbenchmark::Suite& suite, const string_view kernel_name, void(*const kernel)(const P*, P*, size_t) noexcept,
+		const size_t input_channel, const size_t output_channel) {
+		string name = "PixelKernel/";
+		name += kernel_name;
+		name += sizeof(P) == 1u ? "/8" : "/16";
+		if (!suite.isSelected(name)) {
+			return;
+		}
+
+		vector<P> input(::KernelPixelCount * input_channel), output(::KernelPixelCount * output_channel);
+		//any pattern not being constant prevents the conversion from being folded
+		std::iota(input.begin(), input.end(), P { 0 });
+		suite.run(std::move(name), ::KernelIteration, ::KernelPixelCount, [kernel, &input, &output]() -> Microbenchmark::Sample {
+			return { .Cpu = Microbenchmark::measureCpu([kernel, &input, &output]() noexcept {
+				kernel(input.data(), output.data(), ::KernelPixelCount);
+			}) };
+		});
+	}
+
+	void runPackHeightfield(Microbenchmark::Suite& suite) {
+		string name = "PixelKernel/packHeightfield/16";
+		if (!suite.isSelected(name)) {
+			return;
+		}
+
+		vector<uint16_t> normal(::KernelPixelCount * 3u), displacement(::KernelPixelCount), output(::KernelPixelCount * 4u);
+		std::iota(normal.begin(), normal.end(), uint16_t { 0 });
+		std::iota(displacement.begin(), displacement.end(), uint16_t { 0 });
+		suite.run(std::move(name), ::KernelIteration, ::KernelPixelCount, [&normal, &displacement, &output]() -> Microbenchmark::Sample {
+			return { .Cpu = Microbenchmark::measureCpu([&normal, &displacement, &output]() noexcept {
+				PixelKernel::packHeightfield(normal.data(), displacement.data(), output.data(), ::KernelPixelCount);
+			}) };
+		});
+	}
+
+}
+
+void Microbenchmark::runImageBenchmark(Suite& suite) {
+	//the distortion map is loaded as RGBA and reduced to RG, and the sky box decodes every face concurrently
+	::runDecode<IM::ImageBitWidth::Eight>(suite, "WaterNormal", ::WaterNormalmapFullPathArray, {
+		.Channel = 4,
+		.ColourSpace = IM::ImageColourSpace::Linear
+	});
+	::runDecode<IM::ImageBitWidth::Eight>(suite, "WaterDUDV", ::WaterDistortionFullPathArray, {
+		.Channel = 2,
+		.ColourSpace = IM::ImageColourSpace::Linear
+	});
+	::runDecode<IM::ImageBitWidth::Eight>(suite, "SkyBox", ::SkyBoxFullPathArray, {
+		.Channel = 4,
+		.ColourSpace = IM::ImageColourSpace::SRGB
+	});
+	::runDecode<IM::ImageBitWidth::Sixteen>(suite, "TerrainHeightfield", ::HeightfieldFullPathArray, {
+		.Channel = 4,
+		.ColourSpace = IM::ImageColourSpace::Linear
+	});
+
+	::runKernel<uint8_t>(suite, "extractRGFromRGBA", &PixelKernel::extractRGFromRGBA, 4u, 2u);
+	::runKernel<uint16_t>(suite, "extractRGFromRGBA", &PixelKernel::extractRGFromRGBA, 4u, 2u);
+	::runKernel<uint8_t>(suite, "padRGBToRGBA", &PixelKernel::padRGBToRGBA, 3u, 4u);
+	::runKernel<uint16_t>(suite, "padRGBToRGBA", &PixelKernel::padRGBToRGBA, 3u, 4u);
+	//each value of a single channel is converted as a pixel
+	::runKernel<uint16_t>(suite, "convertUnormToHalf", &PixelKernel::convertUnormToHalf, 1u, 1u);
+	::runPackHeightfield(suite);
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "Microbenchmark.hpp"
+
+#include "../Common/ErrorHandler.hpp"
+#include "../Common/PixelKernel.hpp"
+#include "../Engine/Camera.hpp"
+#include "../Engine/MasterEngine.hpp"
+
+#include <Volk/volk.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/vec3.hpp>
+#include <glm/trigonometric.hpp>
+
+#include <memory>
+#include <source_location>
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <string_view>
+
+#include <cstdlib>
+
+using glm::dvec3;
+using glm::radians;
+
+using std::unique_ptr;
+using std::source_location;
+using std::runtime_error;
+using std::cout, std::cerr, std::endl;
+using std::string_view;
+
+using namespace LearnVulkan;
+
+namespace {
+
+	constexpr unsigned int CanvasWidth = 1280u, CanvasHeight = 720u;
+	constexpr const char* CanvasTitle = "Vulkan Microbenchmark";
+	//Nothing is drawn, the camera is only required by the engine.
+	constexpr Camera::CameraData CameraData = {
+		.Yaw = radians(-90.0),
+		.Pitch = 0.0,
+		.FieldOfView = radians(60.5),
+		.MovementSpeed = 0.0,
+		.RotationSpeed = 0.0,
+		.Position = dvec3(0.0),
+		.WorldUp = dvec3(0.0, 1.0, 0.0),
+		.Aspect = (1.0 * CanvasWidth) / (1.0 * CanvasHeight),
+		.Near = 0.8,
+		.Far = 1155.5
+	};
+
+	struct CanvasDestroyer {
+	public:
+
+		inline void operator()(GLFWwindow* const canvas) const noexcept {
+			glfwDestroyWindow(canvas);
+		}
+
+	};
+	using CanvasHandle = unique_ptr<GLFWwindow, CanvasDestroyer>;/**< GLFWwindow */
+
+	void checkGLFWError(const int err_code, const source_location src = source_location::current()) {
+		if (err_code != GLFW_TRUE) {
+			ErrorHandler::throwError("GLFW has encountered an error!", src);
+		}
+	}
+#define CHECK_GLFW_ERROR(FUNC) checkGLFWError(FUNC)
+
+	//The canvas is never shown, it is only used to select a physical device capable of presentation.
+	CanvasHandle initCanvas() {
+		CHECK_GLFW_ERROR(glfwVulkanSupported());
+
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+
+		GLFWwindow* const canvas = glfwCreateWindow(CanvasWidth, CanvasHeight, CanvasTitle, nullptr, nullptr);
+		if (!canvas) {
+			throw runtime_error("Unable to initialise GLFW window");
+		}
+		return CanvasHandle(canvas);
+	}
+
+	void writeReport(const char* const output_filename, const VulkanContext& ctx, const Microbenchmark::Suite& suite) {
+		std::ofstream report(output_filename);
+		if (!report) {
+			throw runtime_error("Unable to open the microbenchmark report file for writing");
+		}
+		VkPhysicalDeviceProperties property;
+		vkGetPhysicalDeviceProperties(ctx.PhysicalDevice, &property);
+
+		report << "{\n\t\"device\": \"" << property.deviceName << "\",\n";
+		report << "\t\"driver_version\": " << property.driverVersion << ",\n";
+		report << "\t\"api_version\": \"" << VK_API_VERSION_MAJOR(property.apiVersion) << '.'
+			<< VK_API_VERSION_MINOR(property.apiVersion) << '.' << VK_API_VERSION_PATCH(property.apiVersion) << "\",\n";
+		report << "\t\"instruction_set\": \"" << PixelKernel::toString(PixelKernel::instructionSet()) << "\",\n";
+		report << "\t\"benchmark\": ";
+		suite.writeJson(report);
+		report << "\n}" << endl;
+	}
+
+	void runMicrobenchmark(const string_view filter, const char* const output_filename) {
+		const CanvasHandle canvas_handle = ::initCanvas();
+		Camera::CameraData camera_data = CameraData;
+		//engine is never drawn, so the frame pacing and the number of frame in flight are irrelevant
+		MasterEngine engine({
+			.Canvas = canvas_handle.get(),
+			.CameraData = &camera_data,
+			.DebugMessage = &cout,
+			.Offscreen = true,
+			.Pacing = {
+				.PreferredPresentMode = VK_PRESENT_MODE_FIFO_KHR,
+				.MinFrameTime = 0.0
+			},
+			.FrameInFlight = 1u
+		});
+		const VulkanContext& ctx = engine.context();
+
+		Microbenchmark::Suite suite(filter);
+		Microbenchmark::runImageBenchmark(suite);
+		Microbenchmark::runShaderBenchmark(suite);
+		Microbenchmark::runGeometryBenchmark(suite, ctx, engine.bufferArena());
+		Microbenchmark::runDescriptorBenchmark(suite, ctx);
+		CHECK_VULKAN_ERROR(vkDeviceWaitIdle(ctx.Device));
+
+		suite.print(cout);
+		if (output_filename) {
+			::writeReport(output_filename, ctx, suite);
+			cout << "Microbenchmark report is written to \'" << output_filename << '\'' << endl;
+		}
+	}
+
+}
+
+int main(const int argc, const char* const* const argv) {
+	if (argc > 3) {
+		cout << "Usage: [name filter] [report filename]\n";
+		cout << "Only benchmarks whose name contains the filter are run, and results are written as JSON to the report if given." << endl;
+		return EXIT_SUCCESS;
+	}
+	const string_view filter = argc > 1 ? argv[1] : "";
+	const char* const output_filename = argc > 2 ? argv[2] : nullptr;
+
+	try {
+		CHECK_GLFW_ERROR(glfwInit());
+		CHECK_VULKAN_ERROR(volkInitialize());
+		::runMicrobenchmark(filter, output_filename);
+		glfwTerminate();
+	} catch (const std::exception& e) {
+		cerr << e.what() << endl;
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "Microbenchmark.hpp"
+
+#include "../Engine/Abstraction/CommandBufferManager.hpp"
+#include "../Engine/Abstraction/SemaphoreManager.hpp"
+#include "../Common/ErrorHandler.hpp"
+
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <iomanip>
+#include <utility>
+#include <cmath>
+
+using std::string, std::string_view;
+using std::vector, std::optional, std::nullopt;
+using std::function;
+using std::ostream, std::endl;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	constexpr uint32_t TimestampQueryCount = 2u;
+
+	uint32_t getTimestampValidBit(const VkPhysicalDevice gpu, const uint32_t queue_family) {
+		uint32_t family_count;
+		vkGetPhysicalDeviceQueueFamilyProperties(gpu, &family_count, nullptr);
+		vector<VkQueueFamilyProperties> family(family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(gpu, &family_count, family.data());
+		return family[queue_family].timestampValidBits;
+	}
+
+	//The content of sample will be sorted.
+	Microbenchmark::Statistics computeStatistics(vector<double>& sample) {
+		std::ranges::sort(sample);
+		//nearest-rank percentile
+		const auto percentile = [&sample](const double p) noexcept -> double {
+			const size_t rank = static_cast<size_t>(std::ceil(p * sample.size()));
+			return sample[std::clamp<size_t>(rank, 1u, sample.size()) - 1u];
+		};
+		return {
+			.Average = std::reduce(sample.cbegin(), sample.cend()) / sample.size(),
+			.P50 = percentile(0.5),
+			.P95 = percentile(0.95),
+			.P99 = percentile(0.99)
+		};
+	}
+
+	void writeStatistics(ostream& out, const Microbenchmark::Statistics& stat) {
+		out << "{ \"average\": " << stat.Average << ", \"p50\": " << stat.P50
+			<< ", \"p95\": " << stat.P95 << ", \"p99\": " << stat.P99 << " }";
+	}
+
+}
+
+/*******************
+ * Device timer
+ ******************/
+Microbenchmark::DeviceTimer::DeviceTimer(const VulkanContext& ctx, const VkQueue queue, const uint32_t queue_family) :
+	Context(&ctx), Queue(queue), TimestampPeriod(ctx.PhysicalDeviceProperty.Limit.timestampPeriod), TimestampMask(0ull),
+	Complete(SemaphoreManager::createTimelineSemaphore(ctx.Device, 0ull)), SubmitCount(0ull), Timed(false) {
+	const uint32_t valid_bit = ::getTimestampValidBit(ctx.PhysicalDevice, queue_family);
+	if (valid_bit == 0u) {
+		return;
+	}
+	this->TimestampMask = valid_bit >= 64u ? ~uint64_t { 0 } : (uint64_t { 1 } << valid_bit) - 1ull;
+
+	constexpr static VkQueryPoolCreateInfo query_info {
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = ::TimestampQueryCount
+	};
+	this->Timestamp = VKO::createQueryPool(ctx.Device, query_info);
+}
+
+void Microbenchmark::DeviceTimer::begin(const VkCommandBuffer cmd) noexcept {
+	if (!this->Timestamp) {
+		return;
+	}
+	this->Timed = true;
+	vkCmdResetQueryPool(cmd, this->Timestamp, 0u, ::TimestampQueryCount);
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, this->Timestamp, 0u);
+}
+
+void Microbenchmark::DeviceTimer::end(const VkCommandBuffer cmd) const noexcept {
+	if (!this->Timestamp) {
+		return;
+	}
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, this->Timestamp, 1u);
+}
+
+optional<double> Microbenchmark::DeviceTimer::submit(const VkCommandBuffer cmd) {
+	const VkDevice device = this->Context->Device;
+	const uint64_t complete_value = ++this->SubmitCount;
+	CommandBufferManager::submit<1u, 0u, 1u>({ device, this->Queue }, { cmd }, {{ }},
+		{{{ this->Complete, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, complete_value }}});
+	SemaphoreManager::wait<1u>(device, { }, {{{ this->Complete, complete_value }}});
+
+	if (!std::exchange(this->Timed, false)) {
+		return nullopt;
+	}
+	std::array<uint64_t, ::TimestampQueryCount> timestamp;
+	CHECK_VULKAN_ERROR(vkGetQueryPoolResults(device, this->Timestamp, 0u, ::TimestampQueryCount,
+		sizeof(timestamp), timestamp.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+	//timestamps wrap around at the valid bit
+	const uint64_t tick = (timestamp[1] - timestamp[0]) & this->TimestampMask;
+	return tick * this->TimestampPeriod * 1e-6;
+}
+
+/*******************
+ * Suite
+ ******************/
+Microbenchmark::Suite::Suite(const string_view filter) noexcept : Filter(filter) {
+
+}
+
+bool Microbenchmark::Suite::isSelected(const string_view name) const noexcept {
+	return name.find(this->Filter) != string_view::npos;
+}
+
+void Microbenchmark::Suite::run(string name, const uint32_t iteration, const uint64_t item, const function<Sample()>& iterate) {
+	if (!this->isSelected(name)) {
+		return;
+	}
+	for (uint32_t i = 0u; i < Suite::WarmUpIteration; i++) {
+		iterate();
+	}
+
+	vector<double> cpu_sample, gpu_sample;
+	cpu_sample.reserve(iteration);
+	gpu_sample.reserve(iteration);
+	for (uint32_t i = 0u; i < iteration; i++) {
+		const auto [cpu, gpu] = iterate();
+		cpu_sample.push_back(cpu);
+		if (gpu) {
+			gpu_sample.push_back(*gpu);
+		}
+	}
+
+	Result& result = this->Entry.emplace_back(Result {
+		.Name = std::move(name),
+		.Iteration = iteration,
+		.Item = item,
+		.Cpu = ::computeStatistics(cpu_sample)
+	});
+	//the device either times every iteration or none of them
+	if (gpu_sample.size() == iteration) {
+		result.Gpu = ::computeStatistics(gpu_sample);
+	}
+}
+
+void Microbenchmark::Suite::print(ostream& out) const {
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+
+	out << std::fixed << std::setprecision(4);
+	for (const auto& [name, iteration, item, cpu, gpu] : this->Entry) {
+		out << name << " (" << iteration << " iterations)\n\tCPU (ms): ";
+		::writeStatistics(out, cpu);
+		if (gpu) {
+			out << "\n\tGPU (ms): ";
+			::writeStatistics(out, *gpu);
+		}
+		if (item > 1u) {
+			out << "\n\tThroughput: " << item / (cpu.Average * 1e-3) << " per second";
+		}
+		out << endl;
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+void Microbenchmark::Suite::writeJson(ostream& out) const {
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+
+	out << std::fixed << std::setprecision(6) << '[';
+	bool first_entry = true;
+	for (const auto& [name, iteration, item, cpu, gpu] : this->Entry) {
+		out << (first_entry ? "\n" : ",\n") << "\t\t{ \"name\": \"" << name << "\", \"iteration\": " << iteration
+			<< ", \"item\": " << item << ",\n\t\t\t\"cpu\": ";
+		::writeStatistics(out, cpu);
+		out << ",\n\t\t\t\"gpu\": ";
+		if (gpu) {
+			::writeStatistics(out, *gpu);
+		} else {
+			out << "null";
+		}
+		out << " }";
+		first_entry = false;
+	}
+	out << "\n\t]";
+
+	out.flags(flags);
+	out.precision(precision);
+}
\ No newline at end of file
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "../Engine/BufferArena.hpp"
+#include "../Engine/VulkanContext.hpp"
+#include "../Common/VulkanObject.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <ostream>
+#include <chrono>
+#include <utility>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief A harness to run repeatable microbenchmarks of engine hot paths, and report results in a machine-readable form.
+	 * Each benchmark is run a few times to warm up, then measured for a fixed number of iterations.
+	*/
+	namespace Microbenchmark {
+
+		/**
+		 * @brief The time spent by an iteration, in millisecond.
+		*/
+		struct Sample {
+
+			double Cpu;
+			std::optional<double> Gpu;/**< Empty if the benchmark does not run on the device, or the device cannot time it. */
+
+		};
+
+		/**
+		 * @brief Statistics of a series of time, in millisecond.
+		*/
+		struct Statistics {
+
+			double Average, P50, P95, P99;
+
+		};
+
+		/**
+		 * @brief The result of a benchmark.
+		*/
+		struct Result {
+
+			std::string Name;
+			uint32_t Iteration;
+			uint64_t Item;/**< The amount of work done by each iteration, such as the number of update, to derive throughput. */
+			Statistics Cpu;
+			std::optional<Statistics> Gpu;
+
+		};
+
+		/**
+		 * @brief Measure the CPU time of a function.
+		 * @param func The function to be measured.
+		 * @return The time in millisecond.
+		*/
+		template<class F>
+		inline double measureCpu(F&& func) {
+			using std::chrono::steady_clock;
+			const auto begin = steady_clock::now();
+			std::forward<F>(func)();
+			return std::chrono::duration<double, std::milli>(steady_clock::now() - begin).count();
+		}
+
+		/**
+		 * @brief Time commands on a queue with a pair of timestamps, and submit them to the queue and wait for completion.
+		 * Only one command buffer can be timed at a time.
+		*/
+		class DeviceTimer {
+		private:
+
+			const VulkanContext* const Context;
+			const VkQueue Queue;
+			const double TimestampPeriod;/**< Nanosecond per tick. */
+			uint64_t TimestampMask;/**< Zero if timestamp is not supported on the queue. */
+
+			VulkanObject::QueryPool Timestamp;
+			VulkanObject::Semaphore Complete;
+			uint64_t SubmitCount;
+			bool Timed;/**< If timestamps have been recorded since the last submission. */
+
+		public:
+
+			/**
+			 * @brief Create a device timer.
+			 * @param ctx The context. The context is retained and must remain valid until the timer is destroyed.
+			 * @param queue The queue where timed commands are submitted to.
+			 * @param queue_family The queue family of the queue.
+			*/
+			DeviceTimer(const VulkanContext&, VkQueue, uint32_t);
+
+			DeviceTimer(const DeviceTimer&) = delete;
+
+			DeviceTimer(DeviceTimer&&) = delete;
+
+			DeviceTimer& operator=(const DeviceTimer&) = delete;
+
+			DeviceTimer& operator=(DeviceTimer&&) = delete;
+
+			~DeviceTimer() = default;
+
+			/**
+			 * @brief Record the start of the timed commands.
+			 * @param cmd The primary command buffer.
+			*/
+			void begin(VkCommandBuffer) noexcept;
+
+			/**
+			 * @brief Record the end of the timed commands, which must follow the start in the same command buffer.
+			 * @param cmd The primary command buffer.
+			*/
+			void end(VkCommandBuffer) const noexcept;
+
+			/**
+			 * @brief Submit a command buffer and wait until the device has finished it.
+			 * @param cmd The primary command buffer, which has been ended.
+			 * @return The device time between the beginning and the end of the timed commands,
+			 * or nothing if nothing is timed or timestamp is not supported on the queue.
+			*/
+			std::optional<double> submit(VkCommandBuffer);
+
+		};
+
+		/**
+		 * @brief A collection of benchmark results.
+		*/
+		class Suite {
+		public:
+
+			//Iterations run before measurement, to allow caches and allocators to warm up.
+			constexpr static uint32_t WarmUpIteration = 3u;
+
+		private:
+
+			const std::string_view Filter;
+			std::vector<Result> Entry;
+
+		public:
+
+			/**
+			 * @brief Create an empty suite.
+			 * @param filter Only benchmarks whose name contains this string are run, or every benchmark if empty.
+			 * The string must remain valid until the suite is destroyed.
+			*/
+			explicit Suite(std::string_view) noexcept;
+
+			Suite(const Suite&) = delete;
+
+			Suite(Suite&&) = delete;
+
+			Suite& operator=(const Suite&) = delete;
+
+			Suite& operator=(Suite&&) = delete;
+
+			~Suite() = default;
+
+			/**
+			 * @brief Check if a benchmark is selected to run by the filter.
+			 * @param name The name of the benchmark.
+			*/
+			bool isSelected(std::string_view) const noexcept;
+
+			/**
+			 * @brief Run a benchmark, if it is selected by the filter.
+			 * @param name The name of the benchmark, which is a path of components separated by slash.
+			 * @param iteration The number of measured iteration.
+			 * @param item The amount of work done by each iteration.
+			 * @param iterate Run an iteration and return its time.
+			*/
+			void run(std::string, uint32_t, uint64_t, const std::function<Sample()>&);
+
+			/**
+			 * @brief Print the result of every benchmark in a human-readable form.
+			 * @param out The stream to be printed to.
+			*/
+			void print(std::ostream&) const;
+
+			/**
+			 * @brief Write the result of every benchmark as a JSON array.
+			 * @param out The stream to be written to.
+			*/
+			void writeJson(std::ostream&) const;
+
+		};
+
+		/**
+		 * @brief Benchmark image decoding and pixel channel conversion, which run on the host only.
+		 * @param suite The suite where results are added to.
+		*/
+		void runImageBenchmark(Suite&);
+
+		/**
+		 * @brief Benchmark shader compilation from source, and loading shaders from the shader cache.
+		 * @param suite The suite where results are added to.
+		*/
+		void runShaderBenchmark(Suite&);
+
+		/**
+		 * @brief Benchmark plane generation and displacement, and acceleration structure build and compaction from the plane,
+		 * at a range of subdivision.
+		 * @param suite The suite where results are added to.
+		 * @param ctx The context.
+		 * @param arena The arena where geometry data are allocated from.
+		*/
+		void runGeometryBenchmark(Suite&, const VulkanContext&, BufferArena&);
+
+		/**
+		 * @brief Benchmark the throughput of descriptor buffer update.
+		 * @param suite The suite where results are added to.
+		 * @param ctx The context.
+		*/
+		void runDescriptorBenchmark(Suite&, const VulkanContext&);
+
+	}
+
+}
\ No newline at end of file
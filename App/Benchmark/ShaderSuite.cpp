@@ -0,0 +1,94 @@
+#include "Microbenchmark.hpp"
+
+#include "../Engine/Abstraction/ShaderModuleManager.hpp"
+
+#include <LearnVulkan/GeneratedTemplate/ResourcePath.hpp>
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <utility>
+
+using std::array, std::pair;
+using std::string, std::string_view;
+using std::ostringstream;
+
+using namespace LearnVulkan;
+namespace SMM = ShaderModuleManager;
+
+namespace {
+
+	constexpr uint32_t CompileIteration = 5u, BatchIteration = 3u;
+
+	//Every shader stage used by the engine, relative to the shader root.
+	constexpr auto ShaderStage = array<pair<string_view, shaderc_shader_kind>, 26u> { {
+		{ "ChunkCulling.comp", shaderc_compute_shader },
+		{ "DepthPyramid.comp", shaderc_compute_shader },
+		{ "DrawSky.vert", shaderc_vertex_shader },
+		{ "DrawSky.frag", shaderc_fragment_shader },
+		{ "DrawTriangle.vert", shaderc_vertex_shader },
+		{ "DrawTriangle.frag", shaderc_fragment_shader },
+		{ "DrawTriangleGenerate.comp", shaderc_compute_shader },
+		{ "DrawTriangleCull.comp", shaderc_compute_shader },
+		{ "DynamicResolution.vert", shaderc_vertex_shader },
+		{ "DynamicResolution.frag", shaderc_fragment_shader },
+		{ "MipMapGenerator.comp", shaderc_compute_shader },
+		{ "PlaneDisplacer.comp", shaderc_compute_shader },
+		{ "PlaneGenerator.comp", shaderc_compute_shader },
+		{ "SimpleTerrain.vert", shaderc_vertex_shader },
+		{ "SimpleTerrain.tesc", shaderc_tess_control_shader },
+		{ "SimpleTerrain.tese", shaderc_tess_evaluation_shader },
+		{ "SimpleTerrain.task", shaderc_task_shader },
+		{ "SimpleTerrain.mesh", shaderc_mesh_shader },
+		{ "SimpleTerrain.frag", shaderc_fragment_shader },
+		{ "SimpleWater.vert", shaderc_vertex_shader },
+		{ "SimpleWater.frag", shaderc_fragment_shader },
+		{ "SimpleWater.rgen", shaderc_raygen_shader },
+		{ "SimpleWater.rmiss", shaderc_miss_shader },
+		{ "SimpleWater.rchit", shaderc_closesthit_shader },
+		{ "SimpleWaterResolve.comp", shaderc_compute_shader },
+		{ "SkyAtmosphere.comp", shaderc_compute_shader }
+	} };
+
+}
+
+void Microbenchmark::runShaderBenchmark(Suite& suite) {
+	//the cache is bypassed, otherwise every iteration after the first is a cache hit
+	SMM::ShaderCompileOption uncached_option = SMM::createDefaultCompileOption();
+	uncached_option.Cache = false;
+	//diagnostic messages are discarded, and any compile error is thrown
+	ostringstream msg;
+
+	for (const auto& [stage_name, stage_kind] : ::ShaderStage) {
+		string name = "ShaderModuleManager/compile/";
+		name += stage_name;
+		const string filename = string(ResourcePath::ShaderRoot) + '/' + string(stage_name);
+		const string_view filename_view = filename;
+		const SMM::ShaderBatchCompilationInfo info {
+			.Device = VK_NULL_HANDLE,
+			.ShaderFilename = &filename_view,
+			.ShaderKind = &stage_kind
+		};
+
+		suite.run(std::move(name), ::CompileIteration, 1u, [&info, &msg, &uncached_option]() -> Sample {
+			msg.str(string());
+			return { .Cpu = measureCpu([&info, &msg, &uncached_option]() {
+				SMM::batchShaderCompilation<1u>(&info, &msg, &uncached_option);
+			}) };
+		});
+	}
+
+	//stages are compiled in parallel by the batch
+	suite.run("ShaderModuleManager/compile/all", ::BatchIteration, ::ShaderStage.size(), [&msg, &uncached_option]() -> Sample {
+		msg.str(string());
+		return { .Cpu = measureCpu([&msg, &uncached_option]() {
+			SMM::precompileShaderCache(ResourcePath::ShaderRoot, msg, uncached_option);
+		}) };
+	});
+	//warm-up iterations populate the cache, so every measured iteration is a cache hit
+	suite.run("ShaderModuleManager/loadCache/all", ::BatchIteration, ::ShaderStage.size(), [&msg]() -> Sample {
+		msg.str(string());
+		return { .Cpu = measureCpu([&msg]() { SMM::precompileShaderCache(ResourcePath::ShaderRoot, msg); }) };
+	});
+}
\ No newline at end of file
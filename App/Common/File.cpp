@@ -1,11 +1,23 @@
 #include "File.hpp"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <fstream>
 #include <iterator>
 
 #include <stdexcept>
 
-using std::string, std::ifstream;
+using std::string, std::ifstream, std::ofstream;
+using std::vector, std::span, std::byte;
 using std::ios;
 using std::runtime_error;
 
@@ -27,4 +39,88 @@ string File::readString(const char* const filename) {
 	using stream_it = std::istreambuf_iterator<string::value_type>;
 	content.assign(stream_it(input), stream_it());
 	return content;
+}
+
+vector<byte> File::readBinary(const char* const filename) {
+	ifstream input(filename, ios::binary | ios::ate);
+	if (!input) {
+		using namespace std::string_literals;
+		throw runtime_error("Unable to open file\'"s + filename + "\'"s);
+	}
+
+	vector<byte> content(static_cast<size_t>(input.tellg()));
+	input.seekg(0, ios::beg);
+	if (!input.read(reinterpret_cast<char*>(content.data()), static_cast<std::streamsize>(content.size()))) {
+		using namespace std::string_literals;
+		throw runtime_error("Unable to read file\'"s + filename + "\'"s);
+	}
+	return content;
+}
+
+void File::writeBinary(const char* const filename, const span<const byte> content) {
+	ofstream output(filename, ios::binary | ios::trunc);
+	if (!output.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()))) {
+		using namespace std::string_literals;
+		throw runtime_error("Unable to write file\'"s + filename + "\'"s);
+	}
+}
+
+File::MappedFile::MappedFile(const char* const filename) {
+	using namespace std::string_literals;
+#ifdef _WIN32
+	this->FileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (this->FileHandle == INVALID_HANDLE_VALUE) {
+		throw runtime_error("Unable to open file\'"s + filename + "\'"s);
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(this->FileHandle, &size) || size.QuadPart == 0) {
+		CloseHandle(this->FileHandle);
+		throw runtime_error("Unable to map empty file\'"s + filename + "\'"s);
+	}
+	this->Size = static_cast<size_t>(size.QuadPart);
+
+	this->MappingHandle = CreateFileMappingA(this->FileHandle, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+	this->View = this->MappingHandle ? static_cast<const byte*>(MapViewOfFile(this->MappingHandle, FILE_MAP_READ, 0u, 0u, 0u)) : nullptr;
+	if (!this->View) {
+		if (this->MappingHandle) {
+			CloseHandle(this->MappingHandle);
+		}
+		CloseHandle(this->FileHandle);
+		throw runtime_error("Unable to map file\'"s + filename + "\'"s);
+	}
+#else
+	this->Descriptor = open(filename, O_RDONLY);
+	if (this->Descriptor < 0) {
+		throw runtime_error("Unable to open file\'"s + filename + "\'"s);
+	}
+	struct stat status;
+	if (fstat(this->Descriptor, &status) != 0 || status.st_size == 0) {
+		close(this->Descriptor);
+		throw runtime_error("Unable to map empty file\'"s + filename + "\'"s);
+	}
+	this->Size = static_cast<size_t>(status.st_size);
+
+	void* const view = mmap(nullptr, this->Size, PROT_READ, MAP_PRIVATE, this->Descriptor, 0);
+	if (view == MAP_FAILED) {
+		close(this->Descriptor);
+		throw runtime_error("Unable to map file\'"s + filename + "\'"s);
+	}
+	this->View = static_cast<const byte*>(view);
+#endif
+}
+
+File::MappedFile::~MappedFile() {
+#ifdef _WIN32
+	UnmapViewOfFile(this->View);
+	CloseHandle(this->MappingHandle);
+	CloseHandle(this->FileHandle);
+#else
+	munmap(const_cast<byte*>(this->View), this->Size);
+	close(this->Descriptor);
+#endif
+}
+
+span<const byte> File::MappedFile::content() const noexcept {
+	return { this->View, this->Size };
 }
\ No newline at end of file
@@ -3,10 +3,14 @@
 #include <string>
 #include <string_view>
 #include <array>
+#include <vector>
+#include <span>
 #include <tuple>
 
 #include <utility>
 
+#include <cstddef>
+
 namespace LearnVulkan {
 
 	/**
@@ -22,6 +26,63 @@ namespace LearnVulkan {
 		*/
 		std::string readString(const char*);
 
+		/**
+		 * @brief Read whole content from the target file as binary.
+		 * @param filename The name of file.
+		 * @return Binary content in the file.
+		 * @exception If file cannot be opened/read.
+		*/
+		std::vector<std::byte> readBinary(const char*);
+
+		/**
+		 * @brief Write binary content to the target file, replacing its existing content.
+		 * @param filename The name of file.
+		 * @param content The content to be written.
+		 * @exception If file cannot be opened/written.
+		*/
+		void writeBinary(const char*, std::span<const std::byte>);
+
+		/**
+		 * @brief A read-only view of the whole content of a file mapped into memory.
+		 * Pages are loaded by the operating system on access, so no intermediate copy is made.
+		*/
+		class MappedFile {
+		private:
+
+#ifdef _WIN32
+			void* FileHandle, *MappingHandle;
+#else
+			int Descriptor;
+#endif
+			const std::byte* View;
+			size_t Size;
+
+		public:
+
+			/**
+			 * @brief Map a file into memory.
+			 * @param filename The name of file.
+			 * @exception If file cannot be opened/mapped, or it is empty.
+			*/
+			explicit MappedFile(const char*);
+
+			MappedFile(const MappedFile&) = delete;
+
+			MappedFile(MappedFile&&) = delete;
+
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			MappedFile& operator=(MappedFile&&) = delete;
+
+			~MappedFile();
+
+			/**
+			 * @brief Get the content of the mapped file, which remains valid until this object is destroyed.
+			*/
+			std::span<const std::byte> content() const noexcept;
+
+		};
+
 		/**
 		 * @brief Join two string literals in compile time.
 		 * @tparam RightString The string value on the RHS.
@@ -79,6 +140,31 @@ namespace LearnVulkan {
 			return sequenceToView(raw_array, std::make_index_sequence<StringCount> { });
 		}
 
+		/**
+		 * @brief Convert raw characters to string view.
+		 * This overload resolves a single string, which is not wrapped in an array.
+		 * @param RawStringSize The number of character in the string.
+		 * @return An array of one string view.
+		*/
+		template<size_t RawStringSize>
+		consteval auto batchRawStringToView(const std::array<char, RawStringSize>& raw_string) noexcept {
+			return std::array { std::string_view(raw_string.data(), raw_string.size() - 1u) };
+		}
+
+		/**
+		 * @brief Convert a tuple of raw characters to string view.
+		 * This overload resolves strings with different length.
+		 * @param RawStringSize The number of character in each string.
+		 * @return An array of string view.
+		*/
+		template<size_t... RawStringSize>
+		consteval auto batchRawStringToView(const std::tuple<std::array<char, RawStringSize>...>& raw_tuple) noexcept {
+			constexpr auto sequenceToView = []<size_t... I>(const auto& raw_tuple, std::index_sequence<I...>) consteval noexcept -> auto {
+				return std::array { std::string_view(std::get<I>(raw_tuple).data(), std::get<I>(raw_tuple).size() - 1u)... };
+			};
+			return sequenceToView(raw_tuple, std::make_index_sequence<sizeof...(RawStringSize)> { });
+		}
+
 	}
 
 }
\ No newline at end of file
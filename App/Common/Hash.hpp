@@ -0,0 +1,61 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief 64-bit FNV-1a hash, for addressing cached objects by their content.
+	 * It is fast and simple, but not intended for cryptographic use.
+	*/
+	class Hash {
+	private:
+
+		uint64_t Value = 0xCBF29CE484222325ull;
+
+	public:
+
+		/**
+		 * @brief Accumulate bytes to the hash.
+		 * @param data The bytes to be hashed.
+		*/
+		constexpr void update(const std::span<const std::byte> data) noexcept {
+			for (const std::byte b : data) {
+				this->Value = (this->Value ^ std::to_integer<uint64_t>(b)) * 0x100000001B3ull;
+			}
+		}
+
+		/**
+		 * @brief Accumulate characters of a string to the hash, excluding the null terminator.
+		 * @param str The string to be hashed.
+		*/
+		void update(const std::string_view str) noexcept {
+			this->update(std::as_bytes(std::span(str)));
+		}
+
+		/**
+		 * @brief Accumulate object representation of a value to the hash.
+		 * The type should not have any padding, otherwise the hash is indeterminate.
+		 * @param value The value to be hashed.
+		*/
+		template<class T>
+		requires std::is_trivially_copyable_v<T>
+		void update(const T& value) noexcept {
+			this->update(std::as_bytes(std::span(&value, 1u)));
+		}
+
+		/**
+		 * @brief Get the hash value.
+		*/
+		constexpr uint64_t value() const noexcept {
+			return this->Value;
+		}
+
+	};
+
+}
\ No newline at end of file
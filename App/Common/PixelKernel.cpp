@@ -0,0 +1,472 @@
+#include "PixelKernel.hpp"
+
+#include <array>
+#include <limits>
+#include <bit>
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LV_PIXEL_KERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define LV_PIXEL_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+
+//MSVC allows any intrinsic regardless of the target architecture, other compilers need to be told per function.
+#if defined(LV_PIXEL_KERNEL_X86) && !defined(_MSC_VER)
+#define LV_PIXEL_KERNEL_TARGET(ISA) __attribute__((target(ISA)))
+#else
+#define LV_PIXEL_KERNEL_TARGET(ISA)
+#endif
+
+using std::array;
+
+using namespace LearnVulkan;
+using PixelKernel::InstructionSet;
+
+namespace {
+
+	template<class T>
+	using ConversionKernel = void(*)(const T*, T*, size_t) noexcept;
+	using HeightfieldKernel = void(*)(const uint16_t*, const uint16_t*, uint16_t*, size_t) noexcept;
+
+	/*****************
+	 * Scalar
+	 ****************/
+	//Remainders are handled from the pixel at the beginning index.
+	template<class T>
+	void extractRGFromRGBARemainder(const T* const input, T* const output, const size_t begin, const size_t pixel_count) noexcept {
+		for (size_t i = begin; i < pixel_count; i++) {
+			output[2u * i] = input[4u * i];
+			output[2u * i + 1u] = input[4u * i + 1u];
+		}
+	}
+
+	template<class T>
+	void padRGBToRGBARemainder(const T* const input, T* const output, const size_t begin, const size_t pixel_count) noexcept {
+		for (size_t i = begin; i < pixel_count; i++) {
+			for (size_t c = 0u; c < 3u; c++) {
+				output[4u * i + c] = input[3u * i + c];
+			}
+			output[4u * i + 3u] = std::numeric_limits<T>::max();
+		}
+	}
+
+	//Round a float in [0, 1] to the nearest half-float with ties to even, the same as the hardware conversion.
+	constexpr uint16_t convertUnitFloatToHalf(const float value) noexcept {
+		const uint32_t bit = std::bit_cast<uint32_t>(value),
+			exponent = bit >> 23u;
+		uint32_t half, remainder, tie;
+		if (exponent < 113u) {
+			//below the smallest normal, the implicit leading one is shifted into the mantissa of a subnormal
+			if (exponent < 102u) {
+				return 0u;
+			}
+			const uint32_t mantissa = (bit & 0x7FFFFFu) | 0x800000u,
+				shift = 126u - exponent;
+			half = mantissa >> shift;
+			remainder = mantissa & ((1u << shift) - 1u);
+			tie = 1u << (shift - 1u);
+		} else {
+			//rebias the exponent, and a carry from rounding the mantissa goes into the exponent
+			half = (bit - 0x38000000u) >> 13u;
+			remainder = bit & 0x1FFFu;
+			tie = 0x1000u;
+		}
+		if (remainder > tie || (remainder == tie && (half & 1u) != 0u)) {
+			half++;
+		}
+		return static_cast<uint16_t>(half);
+	}
+
+	void convertUnormToHalfRemainder(const uint16_t* const input, uint16_t* const output, const size_t begin,
+		const size_t element_count) noexcept {
+		for (size_t i = begin; i < element_count; i++) {
+			output[i] = ::convertUnitFloatToHalf(static_cast<float>(input[i]) / 65535.0f);
+		}
+	}
+
+	void packHeightfieldRemainder(const uint16_t* const normal, const uint16_t* const displacement, uint16_t* const output,
+		const size_t begin, const size_t pixel_count) noexcept {
+		for (size_t i = begin; i < pixel_count; i++) {
+			for (size_t c = 0u; c < 3u; c++) {
+				output[4u * i + c] = normal[3u * i + c];
+			}
+			output[4u * i + 3u] = displacement[i];
+		}
+	}
+
+	template<class T>
+	void extractRGFromRGBAScalar(const T* const input, T* const output, const size_t pixel_count) noexcept {
+		::extractRGFromRGBARemainder(input, output, 0u, pixel_count);
+	}
+
+	template<class T>
+	void padRGBToRGBAScalar(const T* const input, T* const output, const size_t pixel_count) noexcept {
+		::padRGBToRGBARemainder(input, output, 0u, pixel_count);
+	}
+
+	void convertUnormToHalfScalar(const uint16_t* const input, uint16_t* const output, const size_t element_count) noexcept {
+		::convertUnormToHalfRemainder(input, output, 0u, element_count);
+	}
+
+	void packHeightfieldScalar(const uint16_t* const normal, const uint16_t* const displacement, uint16_t* const output,
+		const size_t pixel_count) noexcept {
+		::packHeightfieldRemainder(normal, displacement, output, 0u, pixel_count);
+	}
+
+#ifdef LV_PIXEL_KERNEL_X86
+	/*****************
+	 * x86
+	 ****************/
+	//Keep the first two channels of each pixel in a register, packed into the low 8 byte.
+	template<class T>
+	inline __m128i getExtractRGShuffle() noexcept {
+		if constexpr (sizeof(T) == 1u) {
+			return _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+		} else {
+			return _mm_setr_epi8(0, 1, 2, 3, 8, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+		}
+	}
+
+	//Spread 3-channel pixels in the first 12 byte of a register to 4-channel, leaving alpha zero.
+	template<class T>
+	inline __m128i getPadRGBShuffle() noexcept {
+		if constexpr (sizeof(T) == 1u) {
+			return _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		} else {
+			return _mm_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1);
+		}
+	}
+
+	template<class T>
+	inline __m128i getOpaqueAlpha() noexcept {
+		if constexpr (sizeof(T) == 1u) {
+			return _mm_set1_epi32(static_cast<int>(0xFF000000u));
+		} else {
+			return _mm_set1_epi64x(static_cast<long long>(0xFFFF000000000000ull));
+		}
+	}
+
+	//The number of 4-channel pixel in a 128-bit register.
+	template<class T>
+	constexpr size_t RGBAPixelPerLane = 16u / (4u * sizeof(T));
+	//The number of element read by a 128-bit load.
+	template<class T>
+	constexpr size_t ElementPerLane = 16u / sizeof(T);
+
+	template<class T>
+	LV_PIXEL_KERNEL_TARGET("sse4.1")
+	void extractRGFromRGBASSE41(const T* const input, T* const output, const size_t pixel_count) noexcept {
+		constexpr size_t Step = 2u * ::RGBAPixelPerLane<T>;
+		const __m128i shuffle = ::getExtractRGShuffle<T>();
+
+		size_t i = 0u;
+		for (; i + Step <= pixel_count; i += Step) {
+			const T* const src = input + 4u * i;
+			const __m128i lo = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), shuffle),
+				hi = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ::ElementPerLane<T>)), shuffle);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 2u * i), _mm_unpacklo_epi64(lo, hi));
+		}
+		::extractRGFromRGBARemainder(input, output, i, pixel_count);
+	}
+
+	template<class T>
+	LV_PIXEL_KERNEL_TARGET("sse4.1")
+	void padRGBToRGBASSE41(const T* const input, T* const output, const size_t pixel_count) noexcept {
+		constexpr size_t Step = ::RGBAPixelPerLane<T>;
+		const __m128i shuffle = ::getPadRGBShuffle<T>(),
+			alpha = ::getOpaqueAlpha<T>();
+
+		//a load reads a few more elements than those being used, which must not go beyond the input
+		size_t i = 0u;
+		for (; 3u * i + ::ElementPerLane<T> <= 3u * pixel_count; i += Step) {
+			const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 3u * i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 4u * i), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+		}
+		::padRGBToRGBARemainder(input, output, i, pixel_count);
+	}
+
+	//Half-float conversion instructions only come with AVX, so this converts one value at a time.
+	void convertUnormToHalfSSE41(const uint16_t* const input, uint16_t* const output, const size_t element_count) noexcept {
+		::convertUnormToHalfScalar(input, output, element_count);
+	}
+
+	LV_PIXEL_KERNEL_TARGET("sse4.1")
+	void packHeightfieldSSE41(const uint16_t* const normal, const uint16_t* const displacement, uint16_t* const output,
+		const size_t pixel_count) noexcept {
+		constexpr size_t Step = ::RGBAPixelPerLane<uint16_t>;
+		const __m128i shuffle = ::getPadRGBShuffle<uint16_t>();
+
+		//same as padding, the normal is loaded with a few more elements than those being used
+		size_t i = 0u;
+		for (; 3u * i + ::ElementPerLane<uint16_t> <= 3u * pixel_count; i += Step) {
+			const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(normal + 3u * i));
+			int displacement_pair;
+			std::memcpy(&displacement_pair, displacement + i, sizeof(displacement_pair));
+			//widen the displacement of each pixel to 64 bit then move it to the top, where alpha is
+			const __m128i alpha = _mm_slli_epi64(_mm_cvtepu16_epi64(_mm_cvtsi32_si128(displacement_pair)), 48);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 4u * i), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+		}
+		::packHeightfieldRemainder(normal, displacement, output, i, pixel_count);
+	}
+
+	template<class T>
+	LV_PIXEL_KERNEL_TARGET("avx2")
+	void extractRGFromRGBAAVX2(const T* const input, T* const output, const size_t pixel_count) noexcept {
+		constexpr size_t Step = 4u * ::RGBAPixelPerLane<T>;
+		const __m256i shuffle = _mm256_broadcastsi128_si256(::getExtractRGShuffle<T>());
+
+		size_t i = 0u;
+		for (; i + Step <= pixel_count; i += Step) {
+			const auto* const src = reinterpret_cast<const __m256i*>(input + 4u * i);
+			//shuffle does not cross lanes, gather the low half of both lanes
+			const __m256i lo = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(_mm256_loadu_si256(src), shuffle), _MM_SHUFFLE(2, 0, 2, 0)),
+				hi = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(_mm256_loadu_si256(src + 1), shuffle), _MM_SHUFFLE(2, 0, 2, 0));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 2u * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+		}
+		::extractRGFromRGBARemainder(input, output, i, pixel_count);
+	}
+
+	template<class T>
+	LV_PIXEL_KERNEL_TARGET("avx2")
+	void padRGBToRGBAAVX2(const T* const input, T* const output, const size_t pixel_count) noexcept {
+		constexpr size_t LanePixel = ::RGBAPixelPerLane<T>,
+			Step = 2u * LanePixel;
+		const __m256i shuffle = _mm256_broadcastsi128_si256(::getPadRGBShuffle<T>()),
+			alpha = _mm256_broadcastsi128_si256(::getOpaqueAlpha<T>());
+
+		//pixels of each lane are loaded separately, because 3-channel pixels do not fit into a lane evenly
+		size_t i = 0u;
+		for (; 3u * (i + LanePixel) + ::ElementPerLane<T> <= 3u * pixel_count; i += Step) {
+			const T* const src = input + 3u * i;
+			const __m256i rgb = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3u * LanePixel)), 1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 4u * i), _mm256_or_si256(_mm256_shuffle_epi8(rgb, shuffle), alpha));
+		}
+		::padRGBToRGBARemainder(input, output, i, pixel_count);
+	}
+
+	LV_PIXEL_KERNEL_TARGET("avx2,f16c")
+	void convertUnormToHalfAVX2(const uint16_t* const input, uint16_t* const output, const size_t element_count) noexcept {
+		constexpr size_t Step = 8u;
+		const __m256 unorm_max = _mm256_set1_ps(65535.0f);
+
+		//divide rather than multiply by the reciprocal, to round the same as the scalar conversion
+		size_t i = 0u;
+		for (; i + Step <= element_count; i += Step) {
+			const __m256i value = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)));
+			const __m256 unit = _mm256_div_ps(_mm256_cvtepi32_ps(value), unorm_max);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm256_cvtps_ph(unit, _MM_FROUND_TO_NEAREST_INT));
+		}
+		::convertUnormToHalfRemainder(input, output, i, element_count);
+	}
+
+	LV_PIXEL_KERNEL_TARGET("avx2")
+	void packHeightfieldAVX2(const uint16_t* const normal, const uint16_t* const displacement, uint16_t* const output,
+		const size_t pixel_count) noexcept {
+		constexpr size_t LanePixel = ::RGBAPixelPerLane<uint16_t>,
+			Step = 2u * LanePixel;
+		const __m256i shuffle = _mm256_broadcastsi128_si256(::getPadRGBShuffle<uint16_t>());
+
+		size_t i = 0u;
+		for (; 3u * (i + LanePixel) + ::ElementPerLane<uint16_t> <= 3u * pixel_count; i += Step) {
+			const uint16_t* const src = normal + 3u * i;
+			const __m256i rgb = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3u * LanePixel)), 1);
+			const __m256i alpha = _mm256_slli_epi64(
+				_mm256_cvtepu16_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(displacement + i))), 48);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 4u * i), _mm256_or_si256(_mm256_shuffle_epi8(rgb, shuffle), alpha));
+		}
+		::packHeightfieldRemainder(normal, displacement, output, i, pixel_count);
+	}
+
+	InstructionSet detectInstructionSet() noexcept {
+#ifdef _MSC_VER
+		array<int, 4u> info;
+		__cpuid(info.data(), 0);
+		const int max_leaf = info[0];
+
+		__cpuid(info.data(), 1);
+		const bool sse41 = (info[2] & (1 << 19)) != 0,
+			//the OS must also preserve the YMM registers
+			avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6u) == 0x6u,
+			f16c = (info[2] & (1 << 29)) != 0;
+		bool avx2 = false;
+		if (max_leaf >= 7) {
+			__cpuidex(info.data(), 7, 0);
+			avx2 = avx && f16c && (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		//half-float conversion of AVX2 kernels also requires F16C, which comes with every processor supporting AVX2
+		const bool sse41 = __builtin_cpu_supports("sse4.1"),
+			avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+#endif
+		if (avx2) {
+			return InstructionSet::AVX2;
+		}
+		return sse41 ? InstructionSet::SSE41 : InstructionSet::Scalar;
+	}
+#elif defined(LV_PIXEL_KERNEL_NEON)
+	/*****************
+	 * NEON
+	 ****************/
+	//Structured load and store deinterleave and interleave channels.
+	template<class T>
+	void extractRGFromRGBANEON(const T* const input, T* const output, const size_t pixel_count) noexcept {
+		constexpr size_t Step = 16u / sizeof(T);
+
+		size_t i = 0u;
+		for (; i + Step <= pixel_count; i += Step) {
+			if constexpr (sizeof(T) == 1u) {
+				const uint8x16x4_t rgba = vld4q_u8(input + 4u * i);
+				vst2q_u8(output + 2u * i, uint8x16x2_t { { rgba.val[0], rgba.val[1] } });
+			} else {
+				const uint16x8x4_t rgba = vld4q_u16(input + 4u * i);
+				vst2q_u16(output + 2u * i, uint16x8x2_t { { rgba.val[0], rgba.val[1] } });
+			}
+		}
+		::extractRGFromRGBARemainder(input, output, i, pixel_count);
+	}
+
+	template<class T>
+	void padRGBToRGBANEON(const T* const input, T* const output, const size_t pixel_count) noexcept {
+		constexpr size_t Step = 16u / sizeof(T);
+
+		size_t i = 0u;
+		for (; i + Step <= pixel_count; i += Step) {
+			if constexpr (sizeof(T) == 1u) {
+				const uint8x16x3_t rgb = vld3q_u8(input + 3u * i);
+				vst4q_u8(output + 4u * i, uint8x16x4_t { { rgb.val[0], rgb.val[1], rgb.val[2], vdupq_n_u8(0xFFu) } });
+			} else {
+				const uint16x8x3_t rgb = vld3q_u16(input + 3u * i);
+				vst4q_u16(output + 4u * i, uint16x8x4_t { { rgb.val[0], rgb.val[1], rgb.val[2], vdupq_n_u16(0xFFFFu) } });
+			}
+		}
+		::padRGBToRGBARemainder(input, output, i, pixel_count);
+	}
+
+	void convertUnormToHalfNEON(const uint16_t* const input, uint16_t* const output, const size_t element_count) noexcept {
+		constexpr size_t Step = 8u;
+		const float32x4_t unorm_max = vdupq_n_f32(65535.0f);
+
+		size_t i = 0u;
+		for (; i + Step <= element_count; i += Step) {
+			const uint16x8_t value = vld1q_u16(input + i);
+			const float16x4_t lo = vcvt_f16_f32(vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(value))), unorm_max)),
+				hi = vcvt_f16_f32(vdivq_f32(vcvtq_f32_u32(vmovl_high_u16(value)), unorm_max));
+			vst1q_u16(output + i, vreinterpretq_u16_f16(vcombine_f16(lo, hi)));
+		}
+		::convertUnormToHalfRemainder(input, output, i, element_count);
+	}
+
+	void packHeightfieldNEON(const uint16_t* const normal, const uint16_t* const displacement, uint16_t* const output,
+		const size_t pixel_count) noexcept {
+		constexpr size_t Step = 8u;
+
+		size_t i = 0u;
+		for (; i + Step <= pixel_count; i += Step) {
+			const uint16x8x3_t rgb = vld3q_u16(normal + 3u * i);
+			vst4q_u16(output + 4u * i, uint16x8x4_t { { rgb.val[0], rgb.val[1], rgb.val[2], vld1q_u16(displacement + i) } });
+		}
+		::packHeightfieldRemainder(normal, displacement, output, i, pixel_count);
+	}
+
+	//NEON is mandatory on AArch64.
+	constexpr InstructionSet detectInstructionSet() noexcept {
+		return InstructionSet::NEON;
+	}
+#else
+	constexpr InstructionSet detectInstructionSet() noexcept {
+		return InstructionSet::Scalar;
+	}
+#endif
+
+	/*****************
+	 * Dispatch
+	 ****************/
+	struct KernelTable {
+
+		ConversionKernel<uint8_t> ExtractRG8;
+		ConversionKernel<uint16_t> ExtractRG16;
+		ConversionKernel<uint8_t> PadRGB8;
+		ConversionKernel<uint16_t> PadRGB16;
+		ConversionKernel<uint16_t> UnormToHalf;
+		HeightfieldKernel PackHeightfield;
+
+	};
+
+#define CREATE_KERNEL_TABLE(ISA) KernelTable { \
+	.ExtractRG8 = &::extractRGFromRGBA##ISA<uint8_t>, \
+	.ExtractRG16 = &::extractRGFromRGBA##ISA<uint16_t>, \
+	.PadRGB8 = &::padRGBToRGBA##ISA<uint8_t>, \
+	.PadRGB16 = &::padRGBToRGBA##ISA<uint16_t>, \
+	.UnormToHalf = &::convertUnormToHalf##ISA, \
+	.PackHeightfield = &::packHeightfield##ISA \
+}
+	KernelTable createKernelTable(const InstructionSet isa) noexcept {
+		switch (isa) {
+#ifdef LV_PIXEL_KERNEL_X86
+		case InstructionSet::SSE41: return CREATE_KERNEL_TABLE(SSE41);
+		case InstructionSet::AVX2: return CREATE_KERNEL_TABLE(AVX2);
+#elif defined(LV_PIXEL_KERNEL_NEON)
+		case InstructionSet::NEON: return CREATE_KERNEL_TABLE(NEON);
+#endif
+		default: return CREATE_KERNEL_TABLE(Scalar);
+		}
+	}
+#undef CREATE_KERNEL_TABLE
+
+	const KernelTable& getKernel() noexcept {
+		static const KernelTable table = ::createKernelTable(PixelKernel::instructionSet());
+		return table;
+	}
+
+}
+
+InstructionSet PixelKernel::instructionSet() noexcept {
+	static const InstructionSet isa = ::detectInstructionSet();
+	return isa;
+}
+
+const char* PixelKernel::toString(const InstructionSet isa) noexcept {
+	switch (isa) {
+	case InstructionSet::SSE41: return "SSE4.1";
+	case InstructionSet::AVX2: return "AVX2";
+	case InstructionSet::NEON: return "NEON";
+	default: return "Scalar";
+	}
+}
+
+void PixelKernel::extractRGFromRGBA(const uint8_t* const input, uint8_t* const output, const size_t pixel_count) noexcept {
+	::getKernel().ExtractRG8(input, output, pixel_count);
+}
+
+void PixelKernel::extractRGFromRGBA(const uint16_t* const input, uint16_t* const output, const size_t pixel_count) noexcept {
+	::getKernel().ExtractRG16(input, output, pixel_count);
+}
+
+void PixelKernel::padRGBToRGBA(const uint8_t* const input, uint8_t* const output, const size_t pixel_count) noexcept {
+	::getKernel().PadRGB8(input, output, pixel_count);
+}
+
+void PixelKernel::padRGBToRGBA(const uint16_t* const input, uint16_t* const output, const size_t pixel_count) noexcept {
+	::getKernel().PadRGB16(input, output, pixel_count);
+}
+
+void PixelKernel::convertUnormToHalf(const uint16_t* const input, uint16_t* const output, const size_t element_count) noexcept {
+	::getKernel().UnormToHalf(input, output, element_count);
+}
+
+void PixelKernel::packHeightfield(const uint16_t* const normal, const uint16_t* const displacement, uint16_t* const output,
+	const size_t pixel_count) noexcept {
+	::getKernel().PackHeightfield(normal, displacement, output, pixel_count);
+}
\ No newline at end of file
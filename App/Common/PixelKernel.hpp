@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Vectorised kernels for reformatting interleaved pixels while ingesting images.
+	 * Each kernel is selected once at runtime by the best instruction set supported by the CPU,
+	 * and handles leftover pixels with a scalar loop.
+	 * Input and output memory must not overlap, and no alignment is required.
+	*/
+	namespace PixelKernel {
+
+		/**
+		 * @brief The instruction set that kernels are running on.
+		*/
+		enum class InstructionSet : uint8_t {
+			Scalar = 0x00u,
+			SSE41 = 0x01u,
+			AVX2 = 0x02u,
+			NEON = 0x10u
+		};
+
+		/**
+		 * @brief Get the instruction set selected for this CPU.
+		*/
+		InstructionSet instructionSet() noexcept;
+
+		/**
+		 * @brief Get the name of an instruction set.
+		*/
+		const char* toString(InstructionSet) noexcept;
+
+		/**
+		 * @brief Keep the first two channels of every pixel of 4 channels.
+		 * @param input The input pixels of 4 channels.
+		 * @param output The output pixels of 2 channels.
+		 * @param pixel_count The number of pixel.
+		*/
+		void extractRGFromRGBA(const uint8_t*, uint8_t*, size_t) noexcept;
+		void extractRGFromRGBA(const uint16_t*, uint16_t*, size_t) noexcept;
+
+		/**
+		 * @brief Append an opaque alpha channel to every pixel of 3 channels.
+		 * @param input The input pixels of 3 channels.
+		 * @param output The output pixels of 4 channels.
+		 * @param pixel_count The number of pixel.
+		*/
+		void padRGBToRGBA(const uint8_t*, uint8_t*, size_t) noexcept;
+		void padRGBToRGBA(const uint16_t*, uint16_t*, size_t) noexcept;
+
+		/**
+		 * @brief Convert 16-bit unsigned normalised values to half-float, rounding to the nearest even.
+		 * Unlike other kernels, the output may be the same memory as the input to convert in place.
+		 * @param input The input values.
+		 * @param output The output bit patterns of half-float.
+		 * @param element_count The number of value, which is the number of pixel times the number of channel.
+		*/
+		void convertUnormToHalf(const uint16_t*, uint16_t*, size_t) noexcept;
+
+		/**
+		 * @brief Pack a heightfield into pixels of 4 channels in the layout of the terrain,
+		 * with the normal in the first three channels and the displacement in alpha.
+		 * @param normal The input normal of 3 channels.
+		 * @param displacement The input displacement of 1 channel.
+		 * @param output The output pixels of 4 channels.
+		 * @param pixel_count The number of pixel.
+		*/
+		void packHeightfield(const uint16_t*, const uint16_t*, uint16_t*, size_t) noexcept;
+
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <type_traits>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief A lock-free triple buffer hands off the latest value from one producer thread to one consumer thread.
+	 * Each thread owns one buffer exclusively, and the third buffer is exchanged between them,
+	 * such that neither thread ever waits for the other.
+	 * Values published between two consumptions are overwritten, so the consumer always sees the latest value.
+	 * @tparam T The type of the value.
+	*/
+	template<class T>
+	requires(std::is_default_constructible_v<T> && std::is_copy_assignable_v<T>)
+	class TripleBuffer {
+	private:
+
+		//The exchange holds the index of the buffer in between, and whether that buffer is published but not yet consumed.
+		constexpr static uint8_t IndexMask = 0x03u, FreshBit = 0x04u;
+
+		std::array<T, 3u> Buffer;
+		std::atomic<uint8_t> Exchange;
+		uint8_t Back, Front;/**< Owned by the producer and the consumer respectively. */
+
+	public:
+
+		/**
+		 * @brief Initialise a triple buffer with nothing published.
+		*/
+		constexpr TripleBuffer() : Buffer { }, Exchange(1u), Back(0u), Front(2u) {
+		
+		}
+
+		TripleBuffer(const TripleBuffer&) = delete;
+
+		TripleBuffer(TripleBuffer&&) = delete;
+
+		TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+		TripleBuffer& operator=(TripleBuffer&&) = delete;
+
+		~TripleBuffer() = default;
+
+		/**
+		 * @brief Publish a value to the consumer. Only called by the producer.
+		 * @param value The value to be published.
+		*/
+		void publish(const T& value) noexcept(std::is_nothrow_copy_assignable_v<T>) {
+			this->Buffer[this->Back] = value;
+			this->Back = this->Exchange.exchange(this->Back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+		}
+
+		/**
+		 * @brief Take the latest published value as the front value. Only called by the consumer.
+		 * @return True if a value has been published since the last consumption, otherwise the front value is unchanged.
+		*/
+		bool consume() noexcept {
+			if (!(this->Exchange.load(std::memory_order_relaxed) & FreshBit)) {
+				return false;
+			}
+			this->Front = this->Exchange.exchange(this->Front, std::memory_order_acq_rel) & IndexMask;
+			return true;
+		}
+
+		/**
+		 * @brief Get the value taken by the last consumption. Only called by the consumer.
+		 * @return The front value, which is default constructed if nothing has been consumed.
+		*/
+		constexpr const T& front() const noexcept {
+			return this->Buffer[this->Front];
+		}
+
+	};
+
+}
\ No newline at end of file
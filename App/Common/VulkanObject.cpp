@@ -2,12 +2,83 @@
 
 #include "ErrorHandler.hpp"
 
+#include <atomic>
+
 #include <cassert>
 
 using std::make_pair;
 
 using namespace LearnVulkan;
 
+namespace {
+
+	/**
+	 * @brief Memory of live allocations of a category.
+	 * Allocations are made from multiple threads, so counters are atomic.
+	*/
+	struct AllocationCounter {
+
+		std::atomic<uint32_t> Count;
+		std::atomic<VkDeviceSize> Size;
+
+	};
+	std::array<AllocationCounter, VulkanObject::AllocationCategoryCount> GlobalAllocationCounter;
+
+	//The category is stored in the allocation user data offset by one, such that null means the allocation is not tracked.
+	inline void* encodeAllocationCategory(const VulkanObject::AllocationCategory category) noexcept {
+		return reinterpret_cast<void*>(static_cast<uintptr_t>(category) + 1u);
+	}
+
+	void trackAllocation(const VmaAllocator allocator, const VmaAllocation allocation, const VulkanObject::AllocationCategory category) {
+		VmaAllocationInfo info;
+		vmaGetAllocationInfo(allocator, allocation, &info);
+		vmaSetAllocationName(allocator, allocation, VulkanObject::getAllocationCategoryName(category));
+
+		AllocationCounter& counter = ::GlobalAllocationCounter[static_cast<size_t>(category)];
+		counter.Count.fetch_add(1u, std::memory_order_relaxed);
+		counter.Size.fetch_add(info.size, std::memory_order_relaxed);
+	}
+
+	void untrackAllocation(const VmaAllocator allocator, const VmaAllocation allocation) noexcept {
+		VmaAllocationInfo info;
+		vmaGetAllocationInfo(allocator, allocation, &info);
+		if (!info.pUserData) {
+			return;
+		}
+
+		AllocationCounter& counter = ::GlobalAllocationCounter[reinterpret_cast<uintptr_t>(info.pUserData) - 1u];
+		counter.Count.fetch_sub(1u, std::memory_order_relaxed);
+		counter.Size.fetch_sub(info.size, std::memory_order_relaxed);
+	}
+
+}
+
+const char* VulkanObject::getAllocationCategoryName(const AllocationCategory category) noexcept {
+	using enum AllocationCategory;
+	switch (category) {
+	case Geometry: return "Geometry";
+	case AccelStruct: return "AccelStruct";
+	case Texture: return "Texture";
+	case Attachment: return "Attachment";
+	case Staging: return "Staging";
+	case Streaming: return "Streaming";
+	case Descriptor: return "Descriptor";
+	default: return "Unknown";
+	}
+}
+
+VulkanObject::AllocationStatisticArray VulkanObject::queryAllocationStatistic() noexcept {
+	AllocationStatisticArray statistic;
+	for (size_t i = 0u; i < statistic.size(); i++) {
+		const AllocationCounter& counter = ::GlobalAllocationCounter[i];
+		statistic[i] = {
+			.Count = counter.Count.load(std::memory_order_relaxed),
+			.Size = counter.Size.load(std::memory_order_relaxed)
+		};
+	}
+	return statistic;
+}
+
 ///////////////////////////////////////////////////////
 ///				Vulkan Object Deleter
 ///////////////////////////////////////////////////////
@@ -20,9 +91,22 @@ DEFINE_VULKAN_OBJECT_DELETER(AllocatorDestroyer, allocator) {
 }
 
 DEFINE_VULKAN_OBJECT_DELETER(AllocationFreer, allocation) {
+	::untrackAllocation(this->Allocator, allocation);
 	vmaFreeMemory(this->Allocator, allocation);
 }
 
+DEFINE_VULKAN_OBJECT_DELETER(AllocatorPoolDestroyer, pool) {
+	vmaDestroyPool(this->Allocator, pool);
+}
+
+DEFINE_VULKAN_OBJECT_DELETER(VirtualBlockDestroyer, block) {
+	vmaDestroyVirtualBlock(block);
+}
+
+DEFINE_VULKAN_OBJECT_DELETER(VirtualAllocationFreer, allocation) {
+	vmaVirtualFree(this->Block, allocation);
+}
+
 DEFINE_VULKAN_OBJECT_DELETER(InstanceDestroyer, instance) {
 	vkDestroyInstance(instance, nullptr);
 }
@@ -116,6 +200,10 @@ DEFINE_VULKAN_OBJECT_DELETER(QueryPoolDestroyer, query_pool) {
 	vkDestroyQueryPool(this->Device, query_pool, nullptr);
 }
 
+DEFINE_VULKAN_OBJECT_DELETER(PipelineCacheDestroyer, pipeline_cache) {
+	vkDestroyPipelineCache(this->Device, pipeline_cache, nullptr);
+}
+
 /////////////////////////////////////////////////////
 ///				Vulkan Object Creator
 ////////////////////////////////////////////////////
@@ -135,21 +223,55 @@ DEFINE_VULKAN_OBJECT_CREATOR(Allocator, createAllocator, const VmaAllocatorCreat
 }
 
 DEFINE_VULKAN_OBJECT_CREATOR(BufferAllocation, createBufferFromAllocator, const VkDevice device,
-	const VmaAllocator allocator, const VkBufferCreateInfo& pBufferCreateInfo, const VmaAllocationCreateInfo& pAllocationCreateInfo) {
+	const VmaAllocator allocator, const VkBufferCreateInfo& pBufferCreateInfo, const VmaAllocationCreateInfo& pAllocationCreateInfo,
+	const AllocationCategory category) {
+	VmaAllocationCreateInfo alloc_info = pAllocationCreateInfo;
+	alloc_info.pUserData = ::encodeAllocationCategory(category);
+
 	VkBuffer buffer;
 	VmaAllocation allocation;
-	CHECK_VULKAN_ERROR(vmaCreateBuffer(allocator, &pBufferCreateInfo, &pAllocationCreateInfo, &buffer, &allocation, nullptr));
+	CHECK_VULKAN_ERROR(vmaCreateBuffer(allocator, &pBufferCreateInfo, &alloc_info, &buffer, &allocation, nullptr));
+	::trackAllocation(allocator, allocation, category);
 	return make_pair(Allocation(allocation, { allocator }), Buffer(buffer, { device }));
 }
 
 DEFINE_VULKAN_OBJECT_CREATOR(ImageAllocation, createImageFromAllocator, const VkDevice device,
-	const VmaAllocator allocator, const VkImageCreateInfo& pImageCreateInfo, const VmaAllocationCreateInfo& pAllocationCreateInfo) {
+	const VmaAllocator allocator, const VkImageCreateInfo& pImageCreateInfo, const VmaAllocationCreateInfo& pAllocationCreateInfo,
+	const AllocationCategory category) {
+	VmaAllocationCreateInfo alloc_info = pAllocationCreateInfo;
+	alloc_info.pUserData = ::encodeAllocationCategory(category);
+
 	VkImage image;
 	VmaAllocation allocation;
-	CHECK_VULKAN_ERROR(vmaCreateImage(allocator, &pImageCreateInfo, &pAllocationCreateInfo, &image, &allocation, nullptr));
+	CHECK_VULKAN_ERROR(vmaCreateImage(allocator, &pImageCreateInfo, &alloc_info, &image, &allocation, nullptr));
+	::trackAllocation(allocator, allocation, category);
 	return make_pair(Allocation(allocation, { allocator }), Image(image, { device }));
 }
 
+DEFINE_VULKAN_OBJECT_CREATOR(Allocation, allocateMemoryFromAllocator, const VmaAllocator allocator,
+	const VkMemoryRequirements& pMemoryRequirements, const VmaAllocationCreateInfo& pAllocationCreateInfo,
+	const AllocationCategory category) {
+	VmaAllocationCreateInfo alloc_info = pAllocationCreateInfo;
+	alloc_info.pUserData = ::encodeAllocationCategory(category);
+
+	VmaAllocation allocation;
+	CHECK_VULKAN_ERROR(vmaAllocateMemory(allocator, &pMemoryRequirements, &alloc_info, &allocation, nullptr));
+	::trackAllocation(allocator, allocation, category);
+	return Allocation(allocation, { allocator });
+}
+
+DEFINE_VULKAN_OBJECT_CREATOR(AllocatorPool, createAllocatorPool, const VmaAllocator allocator, const VmaPoolCreateInfo& pCreateInfo) {
+	VmaPool pool;
+	CHECK_VULKAN_ERROR(vmaCreatePool(allocator, &pCreateInfo, &pool));
+	return AllocatorPool(pool, { allocator });
+}
+
+DEFINE_VULKAN_OBJECT_CREATOR(VirtualBlock, createVirtualBlock, const VmaVirtualBlockCreateInfo& pCreateInfo) {
+	VmaVirtualBlock block;
+	CHECK_VULKAN_ERROR(vmaCreateVirtualBlock(&pCreateInfo, &block));
+	return block;
+}
+
 DEFINE_VULKAN_OBJECT_CREATOR(Instance, createInstance, const VkInstanceCreateInfo& pCreateInfo) {
 	VkInstance instance;
 	CHECK_VULKAN_ERROR(vkCreateInstance(&pCreateInfo, nullptr, &instance));
@@ -162,6 +284,12 @@ DEFINE_VULKAN_OBJECT_CREATOR(Device, createDevice, const VkPhysicalDevice physic
 	return device;
 }
 
+DEFINE_VULKAN_OBJECT_CREATOR(Image, createImage, const VkDevice device, const VkImageCreateInfo& pCreateInfo) {
+	VkImage image;
+	CHECK_VULKAN_ERROR(vkCreateImage(device, &pCreateInfo, nullptr, &image));
+	return Image(image, { device });
+}
+
 DEFINE_VULKAN_OBJECT_CREATOR(ImageView, createImageView, const VkDevice device, const VkImageViewCreateInfo& pCreateInfo) {
 	VkImageView image_view;
 	CHECK_VULKAN_ERROR(vkCreateImageView(device, &pCreateInfo, nullptr, &image_view));
@@ -188,6 +316,14 @@ DEFINE_VULKAN_OBJECT_CREATOR(Pipeline, createComputePipeline, const VkDevice dev
 	return Pipeline(pipeline, { device });
 }
 
+DEFINE_VULKAN_OBJECT_CREATOR(Pipeline, createRayTracingPipelineKHR, const VkDevice device, const VkPipelineCache pipelineCache,
+	const VkRayTracingPipelineCreateInfoKHR& pCreateInfos) {
+	VkPipeline pipeline;
+	//no deferred operation, so the pipeline is created once it returns
+	CHECK_VULKAN_ERROR(vkCreateRayTracingPipelinesKHR(device, VK_NULL_HANDLE, pipelineCache, 1u, &pCreateInfos, nullptr, &pipeline));
+	return Pipeline(pipeline, { device });
+}
+
 DEFINE_VULKAN_OBJECT_CREATOR(PipelineLayout, createPipelineLayout, const VkDevice device, const VkPipelineLayoutCreateInfo& pCreateInfo) {
 	VkPipelineLayout pipeline_layout;
 	CHECK_VULKAN_ERROR(vkCreatePipelineLayout(device, &pCreateInfo, nullptr, &pipeline_layout));
@@ -263,6 +399,12 @@ DEFINE_VULKAN_OBJECT_CREATOR(QueryPool, createQueryPool, const VkDevice device,
 	return QueryPool(query_pool, { device });
 }
 
+DEFINE_VULKAN_OBJECT_CREATOR(PipelineCache, createPipelineCache, const VkDevice device, const VkPipelineCacheCreateInfo& pCreateInfo) {
+	VkPipelineCache pipeline_cache;
+	CHECK_VULKAN_ERROR(vkCreatePipelineCache(device, &pCreateInfo, nullptr, &pipeline_cache));
+	return PipelineCache(pipeline_cache, { device });
+}
+
 DEFINE_VULKAN_OBJECT_CREATOR(DebugUtilsMessengerEXT, createDebugUtilsMessengerEXT,
 	const VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT& pCreateInfo) {
 	VkDebugUtilsMessengerEXT messenger;
@@ -3,10 +3,14 @@
 #include <Volk/volk.h>
 #include <vma/vk_mem_alloc.h>
 
+#include <array>
 #include <memory>
 #include <type_traits>
 #include <utility>
 
+#include <cstddef>
+#include <cstdint>
+
 #define VULKAN_OBJECT_DELETER_COMMON_MEMBER(POINTER) using pointer = POINTER; \
 void operator()(pointer) const noexcept
 #define DECLARE_VULKAN_OBJECT_DELETER(DEL_NAME, POINTER) struct DEL_NAME { \
@@ -23,6 +27,46 @@ namespace LearnVulkan {
 	*/
 	namespace VulkanObject {
 
+		/**
+		 * @brief The category of memory allocation, to report which component memory belongs to.
+		*/
+		enum class AllocationCategory : uint8_t {
+			Geometry = 0x00u,/**< Vertex, index, indirect command and other renderer-specific buffers. */
+			AccelStruct = 0x01u,/**< Acceleration structure, its build input and scratch. */
+			Texture = 0x02u,
+			Attachment = 0x03u,/**< Render target, including swap chain substitute and any image recreated on reshape. */
+			Staging = 0x04u,/**< Host memory used for transfer. */
+			Streaming = 0x05u,/**< Host-visible memory persistently mapped for per-frame data. */
+			Descriptor = 0x06u
+		};
+		constexpr inline size_t AllocationCategoryCount = 7u;
+
+		/**
+		 * @brief Memory allocated by all live allocations of a category.
+		*/
+		struct AllocationStatistic {
+
+			uint32_t Count;/**< The number of allocation. */
+			VkDeviceSize Size;/**< In byte. */
+
+		};
+		using AllocationStatisticArray = std::array<AllocationStatistic, AllocationCategoryCount>;
+
+		/**
+		 * @brief Get the name of an allocation category.
+		 * @param category The allocation category.
+		 * @return The name of the category, which is also given to every allocation of the category.
+		*/
+		const char* getAllocationCategoryName(AllocationCategory) noexcept;
+
+		/**
+		 * @brief Get memory allocated by all live allocations of each category,
+		 * made through any allocator by the buffer and image creation functions.
+		 * This function is thread-safe.
+		 * @return The allocation statistic indexed by category.
+		*/
+		AllocationStatisticArray queryAllocationStatistic() noexcept;
+
 		//definition of each deleter should be placed here
 		namespace _Internal {
 
@@ -40,6 +84,24 @@ namespace LearnVulkan {
 
 			};
 
+			struct AllocatorPoolDestroyer {
+
+				VULKAN_OBJECT_DELETER_COMMON_MEMBER(VmaPool);
+
+				VmaAllocator Allocator;
+
+			};
+
+			DECLARE_VULKAN_OBJECT_DELETER(VirtualBlockDestroyer, VmaVirtualBlock);
+
+			struct VirtualAllocationFreer {
+
+				VULKAN_OBJECT_DELETER_COMMON_MEMBER(VmaVirtualAllocation);
+
+				VmaVirtualBlock Block;
+
+			};
+
 			/************************
 			 * Vulkan API
 			 ************************/
@@ -219,6 +281,14 @@ namespace LearnVulkan {
 
 			};
 
+			struct PipelineCacheDestroyer {
+
+				VULKAN_OBJECT_DELETER_COMMON_MEMBER(VkPipelineCache);
+
+				VkDevice Device;
+
+			};
+
 			/**
 			 * @brief A simple wrapper over unique_ptr type.
 			 * @tparam THandle The type of the handle to be wrapped over.
@@ -283,6 +353,9 @@ namespace LearnVulkan {
 
 		CREATE_VULKAN_OBJECT_ALIAS(Allocator, VmaAllocator, AllocatorDestroyer);/**< VmaAllocator */
 		CREATE_VULKAN_OBJECT_ALIAS(Allocation, VmaAllocation, AllocationFreer);/**< VmaAllocation */
+		CREATE_VULKAN_OBJECT_ALIAS(AllocatorPool, VmaPool, AllocatorPoolDestroyer);/**< VmaPool */
+		CREATE_VULKAN_OBJECT_ALIAS(VirtualBlock, VmaVirtualBlock, VirtualBlockDestroyer);/**< VmaVirtualBlock */
+		CREATE_VULKAN_OBJECT_ALIAS(VirtualAllocation, VmaVirtualAllocation, VirtualAllocationFreer);/**< VmaVirtualAllocation */
 
 		CREATE_VULKAN_OBJECT_ALIAS(Instance, VkInstance, InstanceDestroyer);/**< VkInstance */
 		CREATE_VULKAN_OBJECT_ALIAS(Device, VkDevice, DeviceDestroyer);/**< VkDevice */
@@ -301,6 +374,7 @@ namespace LearnVulkan {
 		CREATE_VULKAN_OBJECT_ALIAS(DescriptorPool, VkDescriptorPool, DescriptorPoolDestroyer);/**< VkDescriptorPool */
 		CREATE_VULKAN_OBJECT_ALIAS(Sampler, VkSampler, SamplerDestroyer);/**< VkSampler */
 		CREATE_VULKAN_OBJECT_ALIAS(QueryPool, VkQueryPool, QueryPoolDestroyer);/**< VkQueryPool */
+		CREATE_VULKAN_OBJECT_ALIAS(PipelineCache, VkPipelineCache, PipelineCacheDestroyer);/**< VkPipelineCache */
 
 		CREATE_VULKAN_OBJECT_ALIAS(SurfaceKHR, VkSurfaceKHR, SurfaceKHRDestroyer);/**< VkSurfaceKHR */
 		CREATE_VULKAN_OBJECT_ALIAS(DebugUtilsMessengerEXT, VkDebugUtilsMessengerEXT, DebugUtilsMessengerEXTDestroyer);/**< VkDebugUtilsMessengerEXT */
@@ -319,8 +393,13 @@ namespace LearnVulkan {
 		using CommandBufferArray = std::unique_ptr<VkCommandBuffer[], _Internal::CommandBuffersFreer>;
 
 		Allocator createAllocator(const VmaAllocatorCreateInfo&);
-		BufferAllocation createBufferFromAllocator(VkDevice, VmaAllocator, const VkBufferCreateInfo&, const VmaAllocationCreateInfo&);
-		ImageAllocation createImageFromAllocator(VkDevice, VmaAllocator, const VkImageCreateInfo&, const VmaAllocationCreateInfo&);
+		//The category is recorded in the user data of the allocation, which must not be changed by the application.
+		BufferAllocation createBufferFromAllocator(VkDevice, VmaAllocator, const VkBufferCreateInfo&, const VmaAllocationCreateInfo&, AllocationCategory);
+		ImageAllocation createImageFromAllocator(VkDevice, VmaAllocator, const VkImageCreateInfo&, const VmaAllocationCreateInfo&, AllocationCategory);
+		//Allocate memory not bound to any resource, such as to be shared by resources bound later at different offsets.
+		Allocation allocateMemoryFromAllocator(VmaAllocator, const VkMemoryRequirements&, const VmaAllocationCreateInfo&, AllocationCategory);
+		AllocatorPool createAllocatorPool(VmaAllocator, const VmaPoolCreateInfo&);
+		VirtualBlock createVirtualBlock(const VmaVirtualBlockCreateInfo&);
 
 		template<class T>
 		inline MappedAllocation<T> mapAllocation(const VmaAllocator allocator, const VmaAllocation allocation) {
@@ -330,10 +409,13 @@ namespace LearnVulkan {
 
 		Instance createInstance(const VkInstanceCreateInfo&);
 		Device createDevice(VkPhysicalDevice, const VkDeviceCreateInfo&);
+		//The image is created with no memory bound.
+		Image createImage(VkDevice, const VkImageCreateInfo&);
 		ImageView createImageView(VkDevice, const VkImageViewCreateInfo&);
 		ShaderModule createShaderModule(VkDevice, const VkShaderModuleCreateInfo&);
 		Pipeline createGraphicsPipeline(VkDevice, VkPipelineCache, const VkGraphicsPipelineCreateInfo&);
 		Pipeline createComputePipeline(VkDevice, VkPipelineCache, const VkComputePipelineCreateInfo&);
+		Pipeline createRayTracingPipelineKHR(VkDevice, VkPipelineCache, const VkRayTracingPipelineCreateInfoKHR&);
 		PipelineLayout createPipelineLayout(VkDevice, const VkPipelineLayoutCreateInfo&);
 		RenderPass createRenderPass2(VkDevice, const VkRenderPassCreateInfo2&);
 		Framebuffer createFramebuffer(VkDevice, const VkFramebufferCreateInfo&);
@@ -343,6 +425,7 @@ namespace LearnVulkan {
 		DescriptorPool createDescriptorPool(VkDevice, const VkDescriptorPoolCreateInfo&);
 		Sampler createSampler(VkDevice, const VkSamplerCreateInfo&);
 		QueryPool createQueryPool(VkDevice, const VkQueryPoolCreateInfo&);
+		PipelineCache createPipelineCache(VkDevice, const VkPipelineCacheCreateInfo&);
 
 		//The number of command buffer to be allocated must be one, otherwise behaviour is undefined.
 		CommandBuffer allocateCommandBuffer(VkDevice, const VkCommandBufferAllocateInfo&);
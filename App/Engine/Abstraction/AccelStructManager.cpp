@@ -2,111 +2,244 @@
 #include "PipelineBarrier.hpp"
 
 #include "../../Common/ErrorHandler.hpp"
+#include "../../Common/StaticArray.hpp"
 
 #include "BufferManager.hpp"
 
+#include <array>
+#include <vector>
 #include <utility>
 #include <algorithm>
+#include <ranges>
+#include <iomanip>
+#include <initializer_list>
 
-using std::span;
-using std::ranges::transform;
+#include <cassert>
+
+using std::span, std::vector;
+using std::ranges::transform, std::views::iota;
+using std::ostream, std::endl;
 
 using namespace LearnVulkan;
 namespace VKO = VulkanObject;
 
 #define EXPAND_COMPACTION_QUERY const auto [query_pool, query_idx] = *compaction_query
 
-AccelStructManager::AccelStructBuildResult AccelStructManager::_Detail::buildAccelStruct(
-	const AccelStructBuildInfo& build_info,
-	const span<const VkAccelerationStructureGeometryKHR> geometry,
-	const span<const VkAccelerationStructureBuildRangeInfoKHR> range,
-	const span<uint32_t> max_primitive_count
-) {
-	const auto [device, allocator, cmd, type, flag, compaction_query] = build_info;
-
-	/****************************
-	 * Query memory requirement
-	 ****************************/
-	VkAccelerationStructureBuildGeometryInfoKHR vk_build_info {
-		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
-		.type = type,
-		.flags = flag,
-		.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
-		.geometryCount = static_cast<uint32_t>(geometry.size()),
-		.pGeometries = geometry.data()
-	};
-	transform(range, max_primitive_count.begin(), [](const auto& range) { return range.primitiveCount; });
+namespace {
+
+	constexpr VkAccelerationStructureBuildGeometryInfoKHR createBuildGeometryInfo(
+		const AccelStructManager::AccelStructBuildRequest& request) noexcept {
+		return {
+			.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+			.type = request.Type,
+			.flags = request.Flag,
+			.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+			.geometryCount = static_cast<uint32_t>(request.Geometry.size()),
+			.pGeometries = request.Geometry.data()
+		};
+	}
+
+	//The number of query used by each timed command, for the beginning and ending timestamp.
+	constexpr uint32_t QueryPerCommand = 2u;
+	constexpr uint32_t StatisticsQueryCount = AccelStructManager::BuildStatistics::MaxTimedCommand * ::QueryPerCommand;
+
+	uint32_t getTimestampValidBit(const VkPhysicalDevice gpu, const std::initializer_list<uint32_t> queue_family) {
+		uint32_t qf_count;
+		vkGetPhysicalDeviceQueueFamilyProperties(gpu, &qf_count, nullptr);
+		StaticArray<VkQueueFamilyProperties> qf(qf_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(gpu, &qf_count, qf.data());
+
+		//the least number of valid bit of every queue family
+		uint32_t valid_bit = 64u;
+		for (const uint32_t family : queue_family) {
+			assert(family < qf_count);
+			valid_bit = std::min(valid_bit, qf[family].timestampValidBits);
+		}
+		return valid_bit;
+	}
+
+	constexpr const char* toString(const AccelStructManager::BuildStatistics::OperationType op) noexcept {
+		using enum AccelStructManager::BuildStatistics::OperationType;
+		switch (op) {
+		case Build: return "build";
+		case Update: return "update";
+		case Compaction: return "compaction";
+		default: return "unknown";
+		}
+	}
+
+	constexpr double toMebibyte(const VkDeviceSize size) noexcept {
+		return size / (1024.0 * 1024.0);
+	}
+
+}
+
+VkAccelerationStructureBuildSizesInfoKHR AccelStructManager::getBuildSize(
+	const VkDevice device, const AccelStructBuildRequest& request) {
+	const VkAccelerationStructureBuildGeometryInfoKHR vk_build_info = ::createBuildGeometryInfo(request);
+
+	vector<uint32_t> max_primitive_count(request.Range.size());
+	transform(request.Range, max_primitive_count.begin(), [](const auto& range) { return range.primitiveCount; });
 
 	VkAccelerationStructureBuildSizesInfoKHR size_info {
 		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR
 	};
 	vkGetAccelerationStructureBuildSizesKHR(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
 		&vk_build_info, max_primitive_count.data(), &size_info);
-	
-	/********************************
-	 * Create acceleration structure
-	 ********************************/
-	VKO::BufferAllocation as_memory = BufferManager::createDeviceBuffer({ device, allocator, size_info.accelerationStructureSize },
-		VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR),
-		scratch_memory = BufferManager::createDeviceBuffer({ device, allocator, size_info.buildScratchSize },
-			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
-	const VkAccelerationStructureCreateInfoKHR as_create_info {
-		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
-		.buffer = as_memory.second,
-		.offset = 0ull,
-		.size = size_info.accelerationStructureSize,
-		.type = type
-	};
-	VKO::AccelerationStructureKHR as = VKO::createAccelerationStructureKHR(device, as_create_info);
-
-	/******************************
-	 * Build acceleration structure
-	 ******************************/
-	vk_build_info.dstAccelerationStructure = as;
-	vk_build_info.scratchData = { .deviceAddress = BufferManager::addressOf(device, scratch_memory.second) };
+	return size_info;
+}
 
-	const VkAccelerationStructureBuildRangeInfoKHR* const range_ptr = range.data();
-	vkCmdBuildAccelerationStructuresKHR(cmd, 1u, &vk_build_info, &range_ptr);
+void AccelStructManager::recordBuild(const VkCommandBuffer cmd,
+	const span<const AccelStructBuildRequest> request, const span<const AccelStructBuildTarget> target) {
+	vector<VkAccelerationStructureBuildGeometryInfoKHR> vk_build_info(request.size());
+	vector<const VkAccelerationStructureBuildRangeInfoKHR*> range_ptr(request.size());
+	for (const auto i : iota(size_t { 0 }, request.size())) {
+		vk_build_info[i] = ::createBuildGeometryInfo(request[i]);
+		if (target[i].Source != VK_NULL_HANDLE) {
+			vk_build_info[i].mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+			vk_build_info[i].srcAccelerationStructure = target[i].Source;
+		}
+		vk_build_info[i].dstAccelerationStructure = target[i].AccelStruct;
+		vk_build_info[i].scratchData = { .deviceAddress = target[i].Scratch };
+		range_ptr[i] = request[i].Range.data();
+	}
+	vkCmdBuildAccelerationStructuresKHR(cmd, static_cast<uint32_t>(vk_build_info.size()), vk_build_info.data(), range_ptr.data());
 
-	if (compaction_query) {
-		EXPAND_COMPACTION_QUERY;
-		
-		PipelineBarrier<0u, 1u, 0u> barrier;
-		barrier.addBufferBarrier({
+	if (std::ranges::none_of(request, [](const auto& req) noexcept { return req.CompactionSizeQuery != nullptr; })) {
+		return;
+	}
+	{
+		PipelineBarrier<1u, 0u, 0u> barrier;
+		barrier.addMemoryBarrier({
 			VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
 			VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
 			VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
 			VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
-		}, as_memory.second);
+		});
 		barrier.record(cmd);
+	}
+	for (const auto i : iota(size_t { 0 }, request.size())) {
+		if (const CompactionSizeQueryInfo* const compaction_query = request[i].CompactionSizeQuery;
+			compaction_query) {
+			EXPAND_COMPACTION_QUERY;
+			vkCmdWriteAccelerationStructuresPropertiesKHR(cmd, 1u, &target[i].AccelStruct,
+				VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, query_pool, query_idx);
+		}
+	}
+}
 
-		vkCmdWriteAccelerationStructuresPropertiesKHR(cmd, 1u, &vk_build_info.dstAccelerationStructure,
-			VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, query_pool, query_idx);
+AccelStructManager::AccelStructBatchBuildResult AccelStructManager::buildAccelStruct(
+	const AccelStructBatchBuildInfo& build_info, const span<const AccelStructBuildRequest> request) {
+	const auto [device, allocator, cmd, scratch_alignment] = build_info;
+	const auto alignScratch = [scratch_alignment](const VkDeviceSize size) constexpr noexcept -> VkDeviceSize {
+		return (size + scratch_alignment - 1ull) / scratch_alignment * scratch_alignment;
+	};
+	AccelStructBatchBuildResult result;
+	if (request.empty()) {
+		return result;
 	}
 
-	using std::move;
-	return {
-		{
+	vector<AccelStructBuildTarget> target(request.size());
+	result.AccelerationStructure.reserve(request.size());
+	/********************************
+	 * Create acceleration structure
+	 ********************************/
+	//builds in the same command may overlap, so each has a scratch region of its own
+	VkDeviceSize scratch_size = 0ull;
+	for (const auto i : iota(size_t { 0 }, request.size())) {
+		const VkAccelerationStructureBuildSizesInfoKHR size_info = AccelStructManager::getBuildSize(device, request[i]);
+		//offset into the scratch buffer, until its address is known
+		target[i].Scratch = scratch_size;
+		scratch_size += alignScratch(size_info.buildScratchSize);
+
+		VKO::BufferAllocation as_memory = BufferManager::createDeviceBuffer({ device, allocator, size_info.accelerationStructureSize },
+			VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR, VKO::AllocationCategory::AccelStruct);
+		const VkAccelerationStructureCreateInfoKHR as_create_info {
+			.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+			.buffer = as_memory.second,
+			.offset = 0ull,
+			.size = size_info.accelerationStructureSize,
+			.type = request[i].Type
+		};
+		VKO::AccelerationStructureKHR as = VKO::createAccelerationStructureKHR(device, as_create_info);
+		target[i].AccelStruct = as;
+
+		using std::move;
+		result.AccelerationStructure.push_back({
 			move(as_memory),
 			move(as)
-		},
-		move(scratch_memory)
+		});
+	}
+
+	/******************************
+	 * Build acceleration structure
+	 ******************************/
+	//the buffer is not necessarily aligned for scratch, so it is padded to align its address
+	result.ScratchMemory = BufferManager::createDeviceBuffer({ device, allocator, scratch_size + scratch_alignment - 1ull },
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VKO::AllocationCategory::AccelStruct);
+	const VkDeviceAddress scratch_addr = alignScratch(BufferManager::addressOf(device, result.ScratchMemory.second));
+	for (auto& current_target : target) {
+		current_target.Scratch += scratch_addr;
+	}
+	AccelStructManager::recordBuild(cmd, request, target);
+	return result;
+}
+
+AccelStructManager::AccelStructBuildResult AccelStructManager::buildAccelStruct(
+	const AccelStructBatchBuildInfo& build_info, const AccelStructBuildRequest& request) {
+	AccelStructBatchBuildResult batch = AccelStructManager::buildAccelStruct(build_info, span(&request, 1u));
+
+	using std::move;
+	return {
+		move(batch.AccelerationStructure.front()),
+		move(batch.ScratchMemory)
 	};
 }
 
-AccelStructManager::AccelStruct AccelStructManager::compactAccelStruct(
-	const VkAccelerationStructureKHR as, const AccelStructCompactInfo& compact_info) {
-	const auto [device, allocator, cmd, type, flag, compaction_query] = compact_info;
-	EXPAND_COMPACTION_QUERY;
+VkDeviceSize AccelStructManager::getCompactedSize(const VkDevice device, const CompactionSizeQueryInfo& compaction_query) {
+	const auto [query_pool, query_idx] = compaction_query;
 
-	uint32_t size;
+	VkDeviceSize size;
 	//Typically in practice, we can query available instead of waiting.
 	//If not available, we can move on (i.e., keep rendering using the old acceleration structure), and come back later.
 	CHECK_VULKAN_ERROR(vkGetQueryPoolResults(device, query_pool, query_idx, 1u,
-		sizeof(size), &size, sizeof(size), VK_QUERY_RESULT_WAIT_BIT));
+		sizeof(size), &size, sizeof(size), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+	return size;
+}
+
+std::optional<VkDeviceSize> AccelStructManager::tryGetCompactedSize(const VkDevice device,
+	const CompactionSizeQueryInfo& compaction_query) {
+	const auto [query_pool, query_idx] = compaction_query;
+
+	//the size is followed by availability of the query
+	std::array<uint64_t, 2u> result;
+	const VkResult status = vkGetQueryPoolResults(device, query_pool, query_idx, 1u,
+		sizeof(result), result.data(), sizeof(result), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (status == VK_NOT_READY || result[1] == 0ull) {
+		return std::nullopt;
+	}
+	CHECK_VULKAN_ERROR(status);
+	return result[0];
+}
+
+void AccelStructManager::recordCompaction(const VkCommandBuffer cmd,
+	const VkAccelerationStructureKHR src, const VkAccelerationStructureKHR dst) noexcept {
+	const VkCopyAccelerationStructureInfoKHR copy_info {
+		.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
+		.src = src,
+		.dst = dst,
+		.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR
+	};
+	vkCmdCopyAccelerationStructureKHR(cmd, &copy_info);
+}
+
+AccelStructManager::AccelStruct AccelStructManager::compactAccelStruct(
+	const VkAccelerationStructureKHR as, const AccelStructCompactInfo& compact_info) {
+	const auto [device, allocator, cmd, type, flag, compaction_query] = compact_info;
+	const VkDeviceSize size = AccelStructManager::getCompactedSize(device, *compaction_query);
 
 	VKO::BufferAllocation compacted_buf = BufferManager::createDeviceBuffer({ device, allocator, size },
-		VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR);
+		VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR, VKO::AllocationCategory::AccelStruct);
 	VKO::AccelerationStructureKHR compacted_as = VKO::createAccelerationStructureKHR(device, {
 		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
 		.buffer = compacted_buf.second,
@@ -115,13 +248,7 @@ AccelStructManager::AccelStruct AccelStructManager::compactAccelStruct(
 		.type = type
 	});
 
-	const VkCopyAccelerationStructureInfoKHR copy_info {
-		.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR,
-		.src = as,
-		.dst = compacted_as,
-		.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR
-	};
-	vkCmdCopyAccelerationStructureKHR(cmd, &copy_info);
+	AccelStructManager::recordCompaction(cmd, as, compacted_as);
 
 	using std::move;
 	return {
@@ -136,4 +263,159 @@ VkDeviceAddress AccelStructManager::addressOf(const VkDevice device, const VkAcc
 		.accelerationStructure = as
 	};
 	return vkGetAccelerationStructureDeviceAddressKHR(device, &addr_info);
+}
+
+/*************************
+ * Build statistics
+ ************************/
+AccelStructManager::BuildStatistics::BuildStatistics(const VulkanContext& ctx) : Device(ctx.Device),
+	TimestampPeriod(ctx.PhysicalDeviceProperty.Limit.timestampPeriod), TimestampMask(0ull), TimedCommand(0u),
+	CurrentCommand(BuildStatistics::NoTimedCommand) {
+	//builds run on the compute queue during initialisation, and on the rendering queue afterwards
+	const uint32_t valid_bit = ::getTimestampValidBit(ctx.PhysicalDevice, { ctx.QueueIndex.Render, ctx.QueueIndex.Compute });
+	if (valid_bit == 0u) {
+		return;
+	}
+	this->TimestampMask = valid_bit >= 64u ? ~uint64_t { 0 } : (uint64_t { 1 } << valid_bit) - 1ull;
+
+	constexpr static VkQueryPoolCreateInfo query_info {
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = ::StatisticsQueryCount
+	};
+	this->Timestamp = VKO::createQueryPool(this->Device, query_info);
+	//every query is used at most once, so they are only reset once from host
+	vkResetQueryPool(this->Device, this->Timestamp, 0u, ::StatisticsQueryCount);
+}
+
+uint32_t AccelStructManager::BuildStatistics::beginCommand(const VkCommandBuffer cmd) noexcept {
+	assert(this->CurrentCommand == BuildStatistics::NoTimedCommand);
+	if (!this->Timestamp || this->TimedCommand == BuildStatistics::MaxTimedCommand) {
+		return BuildStatistics::NoTimedCommand;
+	}
+
+	this->CurrentCommand = this->TimedCommand++;
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, this->Timestamp, this->CurrentCommand * ::QueryPerCommand);
+	return this->CurrentCommand;
+}
+
+void AccelStructManager::BuildStatistics::beginBuild(const VkCommandBuffer cmd,
+	const span<const AccelStructBuildRequest> request, const span<const AccelStructBuildTarget> target) {
+	const uint32_t command = this->beginCommand(cmd);
+	for (const auto i : iota(size_t { 0 }, request.size())) {
+		const AccelStructBuildRequest& current_request = request[i];
+		const bool update = target[i].Source != VK_NULL_HANDLE;
+		const VkAccelerationStructureBuildSizesInfoKHR size_info = AccelStructManager::getBuildSize(this->Device, current_request);
+
+		uint32_t primitive_count = 0u;
+		for (const auto& range : current_request.Range) {
+			primitive_count += range.primitiveCount;
+		}
+		this->Entry.push_back({
+			.Operation = update ? OperationType::Update : OperationType::Build,
+			.Type = current_request.Type,
+			.PrimitiveCount = primitive_count,
+			.AccelStructSize = size_info.accelerationStructureSize,
+			.ScratchSize = update ? size_info.updateScratchSize : size_info.buildScratchSize,
+			.SourceSize = 0ull
+		});
+		this->EntrySource.push_back({ target[i].AccelStruct, command });
+	}
+}
+
+void AccelStructManager::BuildStatistics::beginCompaction(const VkCommandBuffer cmd, const VkAccelerationStructureKHR src,
+	const VkAccelerationStructureTypeKHR type, const VkDeviceSize size) {
+	const uint32_t command = this->beginCommand(cmd);
+
+	//the latest build of the source, as handles may be reused after destruction
+	Record compaction {
+		.Operation = OperationType::Compaction,
+		.Type = type,
+		.PrimitiveCount = 0u,
+		.AccelStructSize = size,
+		.ScratchSize = 0ull,
+		.SourceSize = 0ull
+	};
+	for (size_t i = this->Entry.size(); i-- > 0u;) {
+		if (const Record& source = this->Entry[i];
+			this->EntrySource[i].AccelStruct == src && source.Operation == OperationType::Build) {
+			compaction.PrimitiveCount = source.PrimitiveCount;
+			compaction.SourceSize = source.AccelStructSize;
+			break;
+		}
+	}
+	this->Entry.push_back(compaction);
+	this->EntrySource.push_back({ src, command });
+}
+
+void AccelStructManager::BuildStatistics::end(const VkCommandBuffer cmd) noexcept {
+	if (this->CurrentCommand == BuildStatistics::NoTimedCommand) {
+		return;
+	}
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, this->Timestamp, this->CurrentCommand * ::QueryPerCommand + 1u);
+	this->CurrentCommand = BuildStatistics::NoTimedCommand;
+}
+
+size_t AccelStructManager::BuildStatistics::resolve() {
+	if (this->TimedCommand == 0u) {
+		return 0u;
+	}
+
+	//each query is followed by its availability
+	std::array<std::array<uint64_t, 2u>, ::StatisticsQueryCount> timestamp;
+	const uint32_t query_count = this->TimedCommand * ::QueryPerCommand;
+	//commands that have not completed are not ready
+	if (const VkResult result = vkGetQueryPoolResults(this->Device, this->Timestamp, 0u, query_count,
+			sizeof(timestamp[0]) * query_count, timestamp.data(), sizeof(timestamp[0]),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		result != VK_NOT_READY) {
+		CHECK_VULKAN_ERROR(result);
+	}
+
+	size_t resolved = 0u;
+	for (const auto i : iota(size_t { 0 }, this->Entry.size())) {
+		Record& entry = this->Entry[i];
+		const uint32_t command = this->EntrySource[i].Command;
+		if (entry.Millisecond || command == BuildStatistics::NoTimedCommand || command == this->CurrentCommand) {
+			continue;
+		}
+
+		const auto [begin, begin_available] = timestamp[command * ::QueryPerCommand];
+		const auto [end, end_available] = timestamp[command * ::QueryPerCommand + 1u];
+		if (begin_available == 0ull || end_available == 0ull) {
+			continue;
+		}
+		const uint64_t tick = ((end & this->TimestampMask) - (begin & this->TimestampMask)) & this->TimestampMask;
+		entry.Millisecond = tick * this->TimestampPeriod * 1e-6;
+		resolved++;
+	}
+	return resolved;
+}
+
+span<const AccelStructManager::BuildStatistics::Record> AccelStructManager::BuildStatistics::record() const noexcept {
+	return this->Entry;
+}
+
+void AccelStructManager::BuildStatistics::print(ostream& out) const {
+	out << "Acceleration structure statistics:\n" << std::fixed << std::setprecision(3);
+	for (const auto& [op, type, primitive, as_size, scratch_size, source_size, ms] : this->Entry) {
+		out << "\t" << (type == VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR ? "TLAS" : "BLAS") << ' ' << ::toString(op)
+			<< ": " << primitive << " primitive, ";
+		if (op == OperationType::Compaction) {
+			out << ::toMebibyte(source_size) << " MiB -> " << ::toMebibyte(as_size) << " MiB";
+			if (source_size > 0ull) {
+				out << " (" << 100.0 * as_size / source_size << "%)";
+			}
+		} else {
+			out << ::toMebibyte(as_size) << " MiB, " << ::toMebibyte(scratch_size) << " MiB scratch";
+		}
+		out << ", ";
+		if (ms) {
+			out << *ms << " ms";
+		} else {
+			out << "time unavailable";
+		}
+		out << '\n';
+	}
+	out << std::defaultfloat << std::flush;
 }
\ No newline at end of file
@@ -1,9 +1,14 @@
 #pragma once
 
+#include "../VulkanContext.hpp"
+
 #include "../../Common/VulkanObject.hpp"
 
-#include <array>
 #include <span>
+#include <vector>
+#include <optional>
+#include <ostream>
+
 #include <cstdint>
 
 namespace LearnVulkan {
@@ -37,6 +42,58 @@ namespace LearnVulkan {
 
 		};
 
+		/**
+		 * @brief Information to build a batch of acceleration structure.
+		*/
+		struct AccelStructBatchBuildInfo {
+
+			VkDevice Device;
+			VmaAllocator Allocator;
+			VkCommandBuffer Command;
+
+			//The minimum alignment of scratch memory of each build,
+			//see `VkPhysicalDeviceAccelerationStructurePropertiesKHR::minAccelerationStructureScratchOffsetAlignment`.
+			VkDeviceSize ScratchAlignment;
+
+		};
+
+		/**
+		 * @brief A request to build an acceleration structure in a batch.
+		*/
+		struct AccelStructBuildRequest {
+
+			VkAccelerationStructureTypeKHR Type;
+			VkBuildAccelerationStructureFlagsKHR Flag;
+
+			std::span<const VkAccelerationStructureGeometryKHR> Geometry;
+			std::span<const VkAccelerationStructureBuildRangeInfoKHR> Range;/**< One for each geometry. */
+
+			//Optional input query pool to query the compaction size of acceleration structure.
+			const CompactionSizeQueryInfo* CompactionSizeQuery = nullptr;
+
+		};
+
+		/**
+		 * @brief The memory where an acceleration structure of a build request is built into.
+		*/
+		struct AccelStructBuildTarget {
+
+			//Created with at least the queried acceleration structure size of the request.
+			VkAccelerationStructureKHR AccelStruct;
+			//The address of scratch memory with at least the queried build scratch size of the request,
+			//or the update scratch size if updating, aligned to the minimum scratch alignment.
+			VkDeviceAddress Scratch;
+			/**
+			 * @brief If not null, the acceleration structure is updated from this source rather than built from scratch,
+			 * which may be the same as the destination to update in place.
+			 * The source must have been built with `VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR`,
+			 * and the request must have the same flag, geometry type and primitive count as the build of the source.
+			 * Geometry data, such as vertices or instance transforms, may differ.
+			*/
+			VkAccelerationStructureKHR Source = VK_NULL_HANDLE;
+
+		};
+
 		/**
 		 * @brief Information to compact an acceleration structure.
 		 * This is just an alias of the build info, except:
@@ -66,43 +123,205 @@ namespace LearnVulkan {
 
 		};
 
-		namespace _Detail {
-		
-			//See the public interface version of this function.
-			AccelStructBuildResult buildAccelStruct(
-				const AccelStructBuildInfo&,
-				std::span<const VkAccelerationStructureGeometryKHR>,
-				std::span<const VkAccelerationStructureBuildRangeInfoKHR>,
-				std::span<uint32_t>
-			);
-		
-		}
-	
-		/**
-		 * FIXME: To make build operation more efficient, consider grouping multiple build operations in one go,
-		 * this can save API round-trip and memory consumption of scratch memory.
-		 * Here we are only building one acceleration structure at a time for simplicity.
-		 * 
-		 * @brief Initiate a device command to build an acceleration structure for a given geometry.
-		 * No pipeline barrier is provided.
-		 * @tparam GeometryCount The number of geometry info.
-		 * @param build_info The acceleration structure build info.
-		 * @param geometry An array of geometry.
-		 * @param range An array of geometry range.
+		/**
+		 * @brief Store the result after issuing a batch of acceleration structure build.
+		*/
+		struct AccelStructBatchBuildResult {
+
+			std::vector<AccelStruct> AccelerationStructure;/**< In the same order as the requests. */
+			//Shared by every build in the batch, and must be retained until all acceleration structures have been built.
+			VulkanObject::BufferAllocation ScratchMemory;
+
+		};
+
+		/**
+		 * @brief Record the memory requirement and device execution time of every acceleration structure build and compaction
+		 * recorded through it, such that ray tracing memory can be budgeted.
+		 * Each command is timed with a pair of timestamp queries, which are read back without waiting.
+		 * Commands are only recorded on the rendering or compute queue, and it is not thread-safe.
+		*/
+		class BuildStatistics {
+		public:
+
+			/**
+			 * @brief The maximum number of command that can be timed, later commands are still recorded but not timed.
+			*/
+			constexpr static uint32_t MaxTimedCommand = 32u;
+
+			enum class OperationType : uint8_t {
+				Build = 0x00u,
+				Update = 0x01u,
+				Compaction = 0x02u
+			};
+
+			/**
+			 * @brief Statistics of a build, update or compaction of an acceleration structure.
+			*/
+			struct Record {
+
+				OperationType Operation;
+				VkAccelerationStructureTypeKHR Type;
+
+				uint32_t PrimitiveCount;/**< Of every geometry, or of the source build when compacting. */
+				//The required size of the acceleration structure, or the compacted size when compacting.
+				VkDeviceSize AccelStructSize;
+				VkDeviceSize ScratchSize;/**< Build or update scratch size, zero when compacting. */
+				//The size before compaction if the build of the source has been recorded, otherwise zero.
+				VkDeviceSize SourceSize;
+				//Device time of the command, which is shared by every build in the same batch.
+				//It is empty until resolved, or if the command is not timed.
+				std::optional<double> Millisecond;
+
+			};
+
+		private:
+
+			constexpr static uint32_t NoTimedCommand = ~0u;
+
+			//Identify the acceleration structure and the timed command of a record.
+			struct RecordSource {
+
+				VkAccelerationStructureKHR AccelStruct;/**< For identification only, which may have been destroyed. */
+				uint32_t Command;
+
+			};
+
+			const VkDevice Device;
+			const double TimestampPeriod;/**< Nanosecond per tick. */
+			uint64_t TimestampMask;
+			VulkanObject::QueryPool Timestamp;/**< Null if timestamp is not supported on every queue used. */
+			uint32_t TimedCommand;
+			uint32_t CurrentCommand;/**< The command being timed, if any. */
+
+			std::vector<Record> Entry;
+			std::vector<RecordSource> EntrySource;
+
+			//Begin timing a command, and return the command index.
+			uint32_t beginCommand(VkCommandBuffer) noexcept;
+
+		public:
+
+			/**
+			 * @brief Create statistics with no record.
+			 * @param ctx The context. Commands are timed if timestamp is supported on both the rendering and compute queue.
+			*/
+			BuildStatistics(const VulkanContext&);
+
+			BuildStatistics(const BuildStatistics&) = delete;
+
+			BuildStatistics(BuildStatistics&&) = delete;
+
+			BuildStatistics& operator=(const BuildStatistics&) = delete;
+
+			BuildStatistics& operator=(BuildStatistics&&) = delete;
+
+			~BuildStatistics() = default;
+
+			/**
+			 * @brief Record a batch of build or update, and begin timing the build command,
+			 * which must be followed by `end` after the build command has been recorded.
+			 * @param cmd The command buffer.
+			 * @param request An array of build request.
+			 * @param target An array of build target, one for each request.
+			*/
+			void beginBuild(VkCommandBuffer, std::span<const AccelStructBuildRequest>, std::span<const AccelStructBuildTarget>);
+
+			/**
+			 * @brief Record a compaction, and begin timing the compaction command,
+			 * which must be followed by `end` after the compaction command has been recorded.
+			 * @param cmd The command buffer.
+			 * @param src The acceleration structure to be compacted.
+			 * @param type The type of the acceleration structure.
+			 * @param size The compacted size in byte.
+			*/
+			void beginCompaction(VkCommandBuffer, VkAccelerationStructureKHR, VkAccelerationStructureTypeKHR, VkDeviceSize);
+
+			/**
+			 * @brief End timing the command that has begun.
+			 * @param cmd The command buffer.
+			*/
+			void end(VkCommandBuffer) noexcept;
+
+			/**
+			 * @brief Read back timing of every command that has completed on the device.
+			 * @return The number of record whose timing is newly resolved.
+			*/
+			size_t resolve();
+
+			/**
+			 * @brief Get every record, in the order they were recorded.
+			*/
+			std::span<const Record> record() const noexcept;
+
+			/**
+			 * @brief Print every record in a human-readable form.
+			 * @param out The stream to be printed to.
+			*/
+			void print(std::ostream&) const;
+
+		};
+
+		/**
+		 * @brief Query the size of acceleration structure and scratch memory needed to build a request.
+		 * @param device The device.
+		 * @param request The build request.
+		 * @return The build size.
+		*/
+		VkAccelerationStructureBuildSizesInfoKHR getBuildSize(VkDevice, const AccelStructBuildRequest&);
+
+		/**
+		 * @brief Record a single command to build or update a batch of acceleration structure
+		 * into memory provided by the application, followed by compaction size queries of the batch.
+		 * @param cmd The command buffer.
+		 * @param request An array of build request.
+		 * @param target An array of build target, one for each request. Scratch memory of each target must not overlap.
+		*/
+		void recordBuild(VkCommandBuffer, std::span<const AccelStructBuildRequest>, std::span<const AccelStructBuildTarget>);
+
+		/**
+		 * @brief Initiate a device command to build a batch of acceleration structure, each for a given request.
+		 * Every build in the batch may execute concurrently, so they share a single scratch buffer sized for all of them,
+		 * and are issued in one build command.
+		 * Compaction sizes are queried after every build in the batch has completed.
+		 * No other pipeline barrier is provided.
+		 * @param build_info The batch build info.
+		 * @param request An array of build request. The acceleration structures must neither reference nor alias each other.
+		 * @return The batch build result.
+		 * @see AccelStructBatchBuildInfo, AccelStructBatchBuildResult
+		*/
+		AccelStructBatchBuildResult buildAccelStruct(const AccelStructBatchBuildInfo&, std::span<const AccelStructBuildRequest>);
+
+		/**
+		 * @brief Initiate a device command to build a single acceleration structure, as a batch of one.
+		 * @param build_info The batch build info.
+		 * @param request The build request.
 		 * @return The acceleration structure build result.
-		 * @see AccelStructBuildInfo, AccelStructBuildResult
-		*/
-		template<size_t GeometryCount>
-		inline AccelStructBuildResult buildAccelStruct(
-			const AccelStructBuildInfo& build_info,
-			const std::array<VkAccelerationStructureGeometryKHR, GeometryCount>& geometry,
-			const std::array<VkAccelerationStructureBuildRangeInfoKHR, GeometryCount>& range
-		) {
-			using std::array;
-			array<uint32_t, GeometryCount> max_primitive_count;
-
-			return _Detail::buildAccelStruct(build_info, geometry, range, max_primitive_count);
-		}
+		*/
+		AccelStructBuildResult buildAccelStruct(const AccelStructBatchBuildInfo&, const AccelStructBuildRequest&);
+
+		/**
+		 * @brief Get the compacted size of an acceleration structure, which waits until the query result is available.
+		 * @param device The device.
+		 * @param compaction_query The query written after the acceleration structure has been built.
+		 * @return The compacted size in byte.
+		*/
+		VkDeviceSize getCompactedSize(VkDevice, const CompactionSizeQueryInfo&);
+
+		/**
+		 * @brief Get the compacted size of an acceleration structure if the query result is available, without waiting.
+		 * @param device The device.
+		 * @param compaction_query The query written after the acceleration structure has been built.
+		 * @return The compacted size in byte, or nothing if the build has not completed yet.
+		*/
+		std::optional<VkDeviceSize> tryGetCompactedSize(VkDevice, const CompactionSizeQueryInfo&);
+
+		/**
+		 * @brief Record a command to compact an acceleration structure into another.
+		 * @param cmd The command buffer.
+		 * @param src The acceleration structure to be compacted.
+		 * @param dst The destination acceleration structure created with at least the compacted size.
+		*/
+		void recordCompaction(VkCommandBuffer, VkAccelerationStructureKHR, VkAccelerationStructureKHR) noexcept;
 
 		/**
 		 * @brief Perform a compaction for an acceleration structure.
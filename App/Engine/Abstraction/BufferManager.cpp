@@ -38,11 +38,11 @@ VkDeviceAddress BufferManager::addressOf(const VkDevice device, const VkBuffer b
 }
 
 VKO::BufferAllocation BufferManager::createStagingBuffer(const BufferCreateInfo& create_info, const HostAccessPattern access) {
-	return BufferManager::createTransientHostBuffer(create_info, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, access);
+	return BufferManager::createTransientHostBuffer(create_info, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, access, VKO::AllocationCategory::Staging);
 }
 
 VKO::BufferAllocation BufferManager::createTransientHostBuffer(const BufferCreateInfo& create_info,
-	const VkBufferUsageFlags usage, const HostAccessPattern access) {
+	const VkBufferUsageFlags usage, const HostAccessPattern access, const VKO::AllocationCategory category) {
 	EXPAND_BUFFER_INFO;
 
 	const VmaAllocationCreateInfo staging_mem_info {
@@ -50,10 +50,11 @@ VKO::BufferAllocation BufferManager::createTransientHostBuffer(const BufferCreat
 		.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
 		.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
 	};
-	return VKO::createBufferFromAllocator(device, allocator, ::createCommonBufferInfo(size, usage), staging_mem_info);
+	return VKO::createBufferFromAllocator(device, allocator, ::createCommonBufferInfo(size, usage), staging_mem_info, category);
 }
 
-VKO::BufferAllocation BufferManager::createDeviceBuffer(const BufferCreateInfo& create_info, const VkBufferUsageFlags usage) {
+VKO::BufferAllocation BufferManager::createDeviceBuffer(const BufferCreateInfo& create_info, const VkBufferUsageFlags usage,
+	const VKO::AllocationCategory category) {
 	EXPAND_BUFFER_INFO;
 
 	constexpr static VmaAllocationCreateInfo deviceLocalAllocationCreateInfo = {
@@ -61,20 +62,25 @@ VKO::BufferAllocation BufferManager::createDeviceBuffer(const BufferCreateInfo&
 		.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
 		.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 	};
-	return VKO::createBufferFromAllocator(device, allocator, ::createCommonBufferInfo(size, usage), deviceLocalAllocationCreateInfo);
+	return VKO::createBufferFromAllocator(device, allocator, ::createCommonBufferInfo(size, usage), deviceLocalAllocationCreateInfo, category);
 }
 
 VKO::BufferAllocation BufferManager::createGlobalStorageBuffer(const BufferCreateInfo& create_info, const HostAccessPattern access) {
+	return BufferManager::createStreamingBuffer(create_info, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, access);
+}
+
+VKO::BufferAllocation BufferManager::createStreamingBuffer(const BufferCreateInfo& create_info,
+	const VkBufferUsageFlags usage, const HostAccessPattern access) {
 	EXPAND_BUFFER_INFO;
 
-	const VmaAllocationCreateInfo ssbo_mem_info {
+	const VmaAllocationCreateInfo streaming_mem_info {
 		.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | ::convertHostAccessFlag(access) | VMA_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT,
 		.usage = VMA_MEMORY_USAGE_AUTO,
 		.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
 		.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 	};
 	return VKO::createBufferFromAllocator(device, allocator,
-		::createCommonBufferInfo(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT), ssbo_mem_info);
+		::createCommonBufferInfo(size, usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT), streaming_mem_info, VKO::AllocationCategory::Streaming);
 }
 
 VKO::BufferAllocation BufferManager::createDescriptorBuffer(const BufferCreateInfo& create_info, const VkBufferUsageFlags usage) {
@@ -87,13 +93,15 @@ VKO::BufferAllocation BufferManager::createDescriptorBuffer(const BufferCreateIn
 		.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 	};
 	return VKO::createBufferFromAllocator(device, allocator,
-		::createCommonBufferInfo(size, usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT), descriptorBufferAllocationCreateInfo);
+		::createCommonBufferInfo(size, usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT), descriptorBufferAllocationCreateInfo,
+		VKO::AllocationCategory::Descriptor);
 }
 
 void BufferManager::recordCopyBuffer(const VkBuffer source, const VkBuffer destination,
-	const VkCommandBuffer cmd, const size_t size) {
+	const VkCommandBuffer cmd, const size_t size, const VkDeviceSize destination_offset) {
 	const VkBufferCopy2 region {
 		.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+		.dstOffset = destination_offset,
 		.size = size
 	};
 	const VkCopyBufferInfo2 copy_info {
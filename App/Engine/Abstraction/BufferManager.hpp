@@ -38,7 +38,7 @@ namespace LearnVulkan {
 
 		/**
 		 * @brief Create an allocated staging buffer for memory transfer.
-		 * This function is an alias of `createTransientHostBuffer`.
+		 * This function is an alias of `createTransientHostBuffer`, and the buffer is categorised as staging memory.
 		 * @param create_info The buffer creation info.
 		 * @param access The host access pattern.
 		 * @return The staging buffer.
@@ -51,17 +51,20 @@ namespace LearnVulkan {
 		 * @param create_info The buffer creation info.
 		 * @param usage The usage of the buffer.
 		 * @param access The host access pattern.
+		 * @param category The allocation category.
 		 * @return The transient host buffer.
 		*/
-		VulkanObject::BufferAllocation createTransientHostBuffer(const BufferCreateInfo&, VkBufferUsageFlags, HostAccessPattern);
+		VulkanObject::BufferAllocation createTransientHostBuffer(const BufferCreateInfo&, VkBufferUsageFlags, HostAccessPattern,
+			VulkanObject::AllocationCategory);
 
 		/**
 		 * @brief Create a buffer with device-local memory location.
 		 * @param create_info The buffer creation info.
 		 * @param usage The usage of the buffer.
+		 * @param category The allocation category.
 		 * @return The device buffer.
 		*/
-		VulkanObject::BufferAllocation createDeviceBuffer(const BufferCreateInfo&, VkBufferUsageFlags);
+		VulkanObject::BufferAllocation createDeviceBuffer(const BufferCreateInfo&, VkBufferUsageFlags, VulkanObject::AllocationCategory);
 
 		/**
 		 * @brief Create a buffer that is used for sharing a SSBO to all shaders, such as camera buffer.
@@ -74,7 +77,18 @@ namespace LearnVulkan {
 		VulkanObject::BufferAllocation createGlobalStorageBuffer(const BufferCreateInfo&, HostAccessPattern);
 
 		/**
-		 * @brief Create a buffer used as a descriptor buffer.
+		 * @brief Create a buffer that is persistently mappable by the host and uncached, for streaming data to the device.
+		 * Device-local memory is preferred if it is host-visible. The buffer is categorised as streaming memory.
+		 * @param create_info The buffer create info.
+		 * @param usage The usage of the buffer.
+		 * A device address usage is automatically included.
+		 * @param access The host access pattern.
+		 * @return The allocated streaming buffer.
+		*/
+		VulkanObject::BufferAllocation createStreamingBuffer(const BufferCreateInfo&, VkBufferUsageFlags, HostAccessPattern);
+
+		/**
+		 * @brief Create a buffer used as a descriptor buffer, which is categorised as descriptor memory.
 		 * @param create_info The buffer create info.
 		 * @param usage The usage of the buffer.
 		 * A device address usage is automatically included.
@@ -83,14 +97,15 @@ namespace LearnVulkan {
 		VulkanObject::BufferAllocation createDescriptorBuffer(const BufferCreateInfo&, VkBufferUsageFlags);
 
 		/**
-		 * @brief Record commands to copy between two buffers from the beginning of two buffers.
+		 * @brief Record commands to copy between two buffers from the beginning of the source buffer.
 		 * @param source The copy source.
 		 * @param destination The copy destination.
 		 * The destination buffer must have at least as much space as the source.
 		 * @param cmd The command buffer where the commands are recorded.
 		 * @param size The number of byte to be copied.
+		 * @param destination_offset The offset into the destination buffer in byte.
 		*/
-		void recordCopyBuffer(VkBuffer, VkBuffer, VkCommandBuffer, size_t);
+		void recordCopyBuffer(VkBuffer, VkBuffer, VkCommandBuffer, size_t, VkDeviceSize = 0ull);
 
 	}
 
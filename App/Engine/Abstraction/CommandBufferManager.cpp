@@ -100,7 +100,7 @@ CmdMgr::AllocatedCommandBuffer CmdMgr::allocateCommandBuffer(const VulkanContext
 	case InFlight:
 	{
 		InFlightCommandBufferArray cmd;
-		transform(ctx.CommandPool.InFlightCommandPool, cmd.begin(),
+		transform(span(ctx.CommandPool.InFlightCommandPool).first(ctx.FrameInFlight), cmd.begin(),
 			[device = *ctx.Device, &cmd_allocate_info](const VkCommandPool pool) {
 				cmd_allocate_info.commandPool = pool;
 				return VKO::allocateCommandBuffer(device, cmd_allocate_info);
@@ -130,4 +130,15 @@ void CmdMgr::beginOneTimeSubmitSecondary(const VkCommandBuffer cmd) {
 		.pInheritanceInfo = &inheritance_info
 	};
 	CHECK_VULKAN_ERROR(vkBeginCommandBuffer(cmd, &cmd_begin));
+}
+
+void CmdMgr::beginReusableSecondary(const VkCommandBuffer cmd) {
+	constexpr static VkCommandBufferInheritanceInfo inheritance_info {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO
+	};
+	constexpr static VkCommandBufferBeginInfo cmd_begin {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pInheritanceInfo = &inheritance_info
+	};
+	CHECK_VULKAN_ERROR(vkBeginCommandBuffer(cmd, &cmd_begin));
 }
\ No newline at end of file
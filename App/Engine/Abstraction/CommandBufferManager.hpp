@@ -18,6 +18,7 @@ namespace LearnVulkan {
 
 		/**
 		 * @brief Allocated command buffer, one from each in-flight command pool.
+		 * Only as many as the number of frame in flight of the context are allocated.
 		*/
 		using InFlightCommandBufferArray = std::array<VulkanObject::CommandBuffer, EngineSetting::MaxFrameInFlight>;
 
@@ -104,6 +105,13 @@ namespace LearnVulkan {
 		*/
 		void beginOneTimeSubmitSecondary(VkCommandBuffer);
 
+		/**
+		 * @brief Similarly, but the secondary command buffer is recorded once and executed in many frames until it is reset.
+		 * It must only be executed by one primary command buffer at a time, such as the primary of the same in-flight frame.
+		 * @param cmd The command buffer to begin.
+		*/
+		void beginReusableSecondary(VkCommandBuffer);
+
 		/**
 		 * @brief Submit the command buffers to a queue.
 		 * @tparam NCmd, NWait, NSignal The number of command buffer, wait semaphore and signal semaphore to be submitted.
@@ -6,11 +6,14 @@
 #include <algorithm>
 #include <numeric>
 #include <ranges>
+#include <utility>
 #include <bit>
 
 #include <stdexcept>
 #include <cassert>
+#include <cstring>
 
+using std::array;
 using std::span;
 using std::runtime_error;
 
@@ -48,68 +51,72 @@ namespace {
 
 }
 
-DescriptorBufferManager::DescriptorUpdater::DescriptorUpdater(const VulkanContext& ctx, DescriptorBufferManager& dbm) :
+DescriptorBufferManager::DescriptorUpdater::DescriptorUpdater(const VulkanContext& ctx, DescriptorBufferManager& dbm) noexcept :
 	Context(&ctx), DesBufManager(&dbm) {
-	if (dbm.UpdaterAlive) {
-		throw runtime_error("It's only allowed to have one descriptor update alive at a time.");
-	}
-	dbm.clearFlush();
-	dbm.UpdaterAlive = true;
 
-	//we are using a dummy type for pointer, because unique_ptr doesn't allow void*
-	this->Mapped = VKO::mapAllocation<uint8_t>(ctx.Allocator, dbm.DescriptorBuffer.first);
-	this->Flusher = { this->Mapped.get(), { this } };
 }
 
-void DescriptorBufferManager::DescriptorUpdater::DescriptorFlusher::operator()(uint8_t*) const {
-	auto& dmb = *this->Updater->DesBufManager;
-	const auto& [allocation, offset, size] = dmb.Flush;
-	
-	const size_t update_count = allocation.size();
-	assert(offset.size() == update_count && size.size() == update_count);
+DescriptorBufferManager::DescriptorUpdater::~DescriptorUpdater() {
+	this->flush();
+}
 
-	CHECK_VULKAN_ERROR(vmaFlushAllocations(this->Updater->Context->Allocator, static_cast<uint32_t>(update_count),
-		allocation.data(), offset.data(), size.data()));
-	dmb.UpdaterAlive = false;
+std::byte* DescriptorBufferManager::DescriptorUpdater::write(const VkDeviceSize offset, const VkDeviceSize size) {
+	auto& dirty_offset = this->DirtyOffset;
+	auto& dirty_size = this->DirtySize;
+
+	//merge with any range that overlaps or touches the new range
+	//descriptors are usually written in order of binding, so it is most likely to extend the last range
+	bool merged = false;
+	for (size_t i = dirty_offset.size(); i-- > 0u;) {
+		const VkDeviceSize begin = dirty_offset[i], end = begin + dirty_size[i];
+		if (offset <= end && begin <= offset + size) {
+			dirty_offset[i] = std::min(begin, offset);
+			dirty_size[i] = std::max(end, offset + size) - dirty_offset[i];
+			merged = true;
+			break;
+		}
+	}
+	if (!merged) {
+		if (dirty_offset.size() == DescriptorUpdater::MaxDirtyRange) {
+			this->flush();
+		}
+		dirty_offset.pushBack(offset);
+		dirty_size.pushBack(size);
+	}
+	return this->DesBufManager->Mapped.get() + offset;
 }
 
-void DescriptorBufferManager::DescriptorUpdater::update(const UpdateInfo& update_info) const {
-	const auto& [ds_layout, set_idx, binding, layer, get_info] = update_info;
-	auto& dmb = *this->DesBufManager;
+void DescriptorBufferManager::DescriptorUpdater::update(const UpdateInfo& update_info) {
 	const auto& ctx = *this->Context;
-	assert(dmb.UpdaterAlive);
-
-	//compute set offset
-	const VkDeviceSize set_offset = dmb.Offset[set_idx];
-	uint8_t* const buf_ptr = this->Mapped.get();
+	const VkDescriptorGetInfoEXT vk_get = ::toDescriptorGetInfo(update_info.GetInfo);
 
-	//compute binding offset
-	const VkDescriptorGetInfoEXT vk_get = ::toDescriptorGetInfo(get_info);
-	const size_t data_size = ::getDataSize(ctx, vk_get);
-	VkDeviceSize binding_offset;
-	vkGetDescriptorSetLayoutBindingOffsetEXT(ctx.Device, ds_layout, static_cast<uint32_t>(binding), &binding_offset);
+	const auto [update_offset, data_size] = this->DesBufManager->locate(ctx, update_info, vk_get);
+	vkGetDescriptorEXT(ctx.Device, &vk_get, data_size, this->write(update_offset, data_size));
+}
 
-	//compute layer offset
-	//according to specification, descriptor array in a binding is tightly packed
-	const VkDeviceSize layer_offset = layer * data_size;
+void DescriptorBufferManager::DescriptorUpdater::flush() {
+	const size_t range_count = this->DirtyOffset.size();
+	if (range_count == 0u) {
+		return;
+	}
+	assert(this->DirtySize.size() == range_count);
 
-	const VkDeviceSize update_offset = set_offset + binding_offset + layer_offset;
-	vkGetDescriptorEXT(ctx.Device, &vk_get, data_size, buf_ptr + update_offset);
+	array<VmaAllocation, DescriptorUpdater::MaxDirtyRange> allocation;
+	allocation.fill(this->DesBufManager->DescriptorBuffer.first);
+	CHECK_VULKAN_ERROR(vmaFlushAllocations(this->Context->Allocator, static_cast<uint32_t>(range_count),
+		allocation.data(), this->DirtyOffset.data(), this->DirtySize.data()));
 
-	//record flush information
-	auto& [allocation, offset, size] = dmb.Flush;
-	allocation.push_back(*dmb.DescriptorBuffer.first);
-	offset.push_back(update_offset);
-	size.push_back(data_size);
+	this->DirtyOffset.clear();
+	this->DirtySize.clear();
 }
 
-DescriptorBufferManager::DescriptorBufferManager() noexcept : UpdaterAlive(false) {
+DescriptorBufferManager::DescriptorBufferManager() noexcept {
 
 }
 
 DescriptorBufferManager::DescriptorBufferManager(const VulkanContext& ctx,
 	const span<const VkDescriptorSetLayout> ds_layout, const VkBufferUsageFlags usage) :
-	Offset(ds_layout.size()), UpdaterAlive(false) {
+	Offset(ds_layout.size()), Deferred(std::make_unique<DeferredUpdate>()) {
 	constexpr static auto roundUp = [](const size_t num, const size_t mul) constexpr noexcept -> size_t {
 		//This round-up optimisation is designed for power-of-2 multiple,
 		//and I would be surprised if the device alignment is not power-of-2.
@@ -133,22 +140,82 @@ DescriptorBufferManager::DescriptorBufferManager(const VulkanContext& ctx,
 	//compute the total size of all descriptor set layouts
 	const VkDeviceSize total_size = std::reduce(offset_span.begin(), offset_span.end(), VkDeviceSize { 0 });
 	this->DescriptorBuffer = BufferManager::createDescriptorBuffer({ ctx.Device, ctx.Allocator, total_size }, usage);
+	this->Mapped = VKO::mapAllocation<std::byte>(ctx.Allocator, this->DescriptorBuffer.first);
 
 	//now convert from size to offset
 	std::exclusive_scan(offset_span.begin(), offset_span.end(), offset_span.begin(), VkDeviceSize { 0 });
 }
 
-constexpr void DescriptorBufferManager::clearFlush() noexcept {
-	auto& [allocation, offset, size] = this->Flush;
-	allocation.clear();
-	offset.clear();
-	size.clear();
+DescriptorBufferManager& DescriptorBufferManager::operator=(DescriptorBufferManager&& dbm) noexcept {
+	//the old buffer must be unmapped before it is destroyed
+	this->Mapped = std::move(dbm.Mapped);
+	this->DescriptorBuffer = std::move(dbm.DescriptorBuffer);
+	this->Offset = std::move(dbm.Offset);
+	this->Deferred = std::move(dbm.Deferred);
+	return *this;
+}
+
+std::pair<VkDeviceSize, size_t> DescriptorBufferManager::locate(const VulkanContext& ctx,
+	const DescriptorUpdater::UpdateInfo& update_info, const VkDescriptorGetInfoEXT& vk_get) const {
+	const auto& [ds_layout, set_idx, binding, layer, get_info] = update_info;
+
+	//compute set offset
+	const VkDeviceSize set_offset = this->Offset[set_idx];
+
+	//compute binding offset
+	const size_t data_size = ::getDataSize(ctx, vk_get);
+	VkDeviceSize binding_offset;
+	vkGetDescriptorSetLayoutBindingOffsetEXT(ctx.Device, ds_layout, static_cast<uint32_t>(binding), &binding_offset);
+
+	//compute layer offset
+	//according to specification, descriptor array in a binding is tightly packed
+	const VkDeviceSize layer_offset = layer * data_size;
+
+	return { set_offset + binding_offset + layer_offset, data_size };
 }
 
 DescriptorBufferManager::DescriptorUpdater DescriptorBufferManager::createUpdater(const VulkanContext& ctx) {
 	return DescriptorUpdater(ctx, *this);
 }
 
+void DescriptorBufferManager::defer(const VulkanContext& ctx, const unsigned int frame_index, const DescriptorUpdater::UpdateInfo& update_info) {
+	const VkDescriptorGetInfoEXT vk_get = ::toDescriptorGetInfo(update_info.GetInfo);
+	const auto [update_offset, data_size] = this->locate(ctx, update_info, vk_get);
+
+	auto& [mutex, pending_update, pending_data] = *this->Deferred;
+	const std::unique_lock lock(mutex);
+
+	std::vector<std::byte>& data = pending_data[frame_index];
+	const size_t data_offset = data.size();
+	data.resize(data_offset + data_size);
+	vkGetDescriptorEXT(ctx.Device, &vk_get, data_size, data.data() + data_offset);
+
+	pending_update[frame_index].push_back({ update_offset, data_size });
+}
+
+void DescriptorBufferManager::applyDeferred(const VulkanContext& ctx, const unsigned int frame_index) {
+	auto& [mutex, pending_update, pending_data] = *this->Deferred;
+	const std::unique_lock lock(mutex);
+
+	std::vector<DeferredUpdate::PendingUpdate>& update = pending_update[frame_index];
+	std::vector<std::byte>& data = pending_data[frame_index];
+	if (update.empty()) {
+		return;
+	}
+
+	{
+		DescriptorUpdater updater(ctx, *this);
+		const std::byte* data_ptr = data.data();
+		for (const auto [offset, size] : update) {
+			std::memcpy(updater.write(offset, size), data_ptr, size);
+			data_ptr += size;
+		}
+	}
+	//capacity of both vectors is kept for the next frame
+	update.clear();
+	data.clear();
+}
+
 VkBuffer DescriptorBufferManager::buffer() const noexcept {
 	return this->DescriptorBuffer.second;
 }
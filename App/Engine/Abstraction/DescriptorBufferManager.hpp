@@ -1,14 +1,20 @@
 #pragma once
 
+#include "../../Common/FixedArray.hpp"
 #include "../../Common/StaticArray.hpp"
 #include "../../Common/VulkanObject.hpp"
 
+#include "../EngineSetting.hpp"
 #include "../VulkanContext.hpp"
 
+#include <array>
 #include <span>
 #include <vector>
+#include <utility>
 
 #include <memory>
+#include <mutex>
+#include <cstddef>
 #include <cstdint>
 
 namespace LearnVulkan {
@@ -21,27 +27,32 @@ namespace LearnVulkan {
 
 		/**
 		 * @brief Descriptor updater is a utility to update descriptor information in a descriptor buffer.
-		 * The update will not take effect until the descriptor updater is destroyed.
+		 * The update will not take effect until the descriptor updater is flushed or destroyed.
+		 * Written ranges are coalesced such that adjacent descriptors are flushed as one range, without any heap allocation.
+		 * Multiple updaters can be alive at a time, and updaters writing to disjoint descriptor sets can be used concurrently
+		 * from different threads, whereas each updater must only be used by one thread at a time.
 		*/
 		class DescriptorUpdater {
-		private:
-
-			const VulkanContext* Context;
-			DescriptorBufferManager* DesBufManager;
-
-			VulkanObject::MappedAllocation<uint8_t> Mapped;
+		public:
 
 			/**
-			 * @brief Flush descriptor buffer memory.
+			 * @brief The maximum number of disjoint dirty range.
+			 * The updater flushes automatically when it runs out of range.
 			*/
-			struct DescriptorFlusher {
+			constexpr static size_t MaxDirtyRange = 16u;
 
-				DescriptorUpdater* Updater;
+		private:
 
-				void operator()(uint8_t*) const;
+			friend class DescriptorBufferManager;
 
-			};
-			std::unique_ptr<uint8_t, DescriptorFlusher> Flusher;
+			const VulkanContext* Context;
+			DescriptorBufferManager* DesBufManager;
+
+			//Written ranges not yet flushed.
+			FixedArray<VkDeviceSize, MaxDirtyRange> DirtyOffset, DirtySize;
+
+			//Get a pointer to the location in the descriptor buffer, and mark the location as dirty.
+			std::byte* write(VkDeviceSize, VkDeviceSize);
 
 		public:
 
@@ -86,35 +97,64 @@ namespace LearnVulkan {
 			 * @param ctx The context.
 			 * @param dbm The parent descriptor buffer manager.
 			*/
-			DescriptorUpdater(const VulkanContext&, DescriptorBufferManager&);
+			DescriptorUpdater(const VulkanContext&, DescriptorBufferManager&) noexcept;
+
+			DescriptorUpdater(const DescriptorUpdater&) = delete;
+
+			DescriptorUpdater(DescriptorUpdater&&) = delete;
 
-			~DescriptorUpdater() = default;
+			DescriptorUpdater& operator=(const DescriptorUpdater&) = delete;
+
+			DescriptorUpdater& operator=(DescriptorUpdater&&) = delete;
+
+			/**
+			 * @brief Flush all remaining updates.
+			*/
+			~DescriptorUpdater();
 
 			/**
 			 * @brief Record an update.
 			 * @param update_info The update info.
 			*/
-			void update(const UpdateInfo&) const;
+			void update(const UpdateInfo&);
+
+			/**
+			 * @brief Make all recorded updates visible to the device.
+			*/
+			void flush();
 
 		};
 
 	private:
 
-		VulkanObject::BufferAllocation DescriptorBuffer;
-		StaticArray<VkDeviceSize> Offset;
+		/**
+		 * @brief Descriptor data waiting to be written at the beginning of an in-flight frame.
+		*/
+		struct DeferredUpdate {
 
-		struct {
+			struct PendingUpdate {
 
-			std::vector<VmaAllocation> Allocation;
-			std::vector<VkDeviceSize> Offset, Size;
+				VkDeviceSize Offset;/**< In the descriptor buffer. */
+				size_t Size;
 
-		} Flush;
-		bool UpdaterAlive;
+			};
 
-		/**
-		 * @brief Clear the temporary data in flush memory.
-		*/
-		constexpr void clearFlush() noexcept;
+			std::mutex Mutex;
+			//Memory is retained when pending updates are applied, so a steady stream of updates does not allocate.
+			std::array<std::vector<PendingUpdate>, EngineSetting::MaxFrameInFlight> Update;
+			std::array<std::vector<std::byte>, EngineSetting::MaxFrameInFlight> Data;
+
+		};
+
+		VulkanObject::BufferAllocation DescriptorBuffer;
+		//The descriptor buffer is persistently mapped.
+		VulkanObject::MappedAllocation<std::byte> Mapped;
+		StaticArray<VkDeviceSize> Offset;
+
+		std::unique_ptr<DeferredUpdate> Deferred;
+
+		//Get the offset of the descriptor in the buffer, and the size of descriptor data.
+		std::pair<VkDeviceSize, size_t> locate(const VulkanContext&, const DescriptorUpdater::UpdateInfo&, const VkDescriptorGetInfoEXT&) const;
 
 	public:
 
@@ -135,7 +175,7 @@ namespace LearnVulkan {
 
 		DescriptorBufferManager(DescriptorBufferManager&&) noexcept = default;
 
-		DescriptorBufferManager& operator=(DescriptorBufferManager&&) noexcept = default;
+		DescriptorBufferManager& operator=(DescriptorBufferManager&&) noexcept;
 
 		~DescriptorBufferManager() = default;
 
@@ -144,11 +184,31 @@ namespace LearnVulkan {
 		 * The current descriptor buffer manager must remain valid until the updater is destroyed.
 		 * @param ctx The context.
 		 * @return The descriptor updater.
-		 * @exception It's only allowed to have one updater alive at a time.
-		 * Exception is generated if another updater is created but not destroyed.
 		*/
 		DescriptorUpdater createUpdater(const VulkanContext&);
 
+		/**
+		 * @brief Defer an update until the beginning of an in-flight frame.
+		 * This is intended for frequently changing descriptors, where each in-flight frame owns a copy of descriptor set,
+		 * such that the set can only be written once the device has finished using the in-flight frame.
+		 * Descriptor data are fetched immediately, so resources referenced by the update info need not to outlive this call.
+		 * This function is thread-safe.
+		 * @param ctx The context.
+		 * @param frame_index The in-flight frame index when the update is applied.
+		 * @param update_info The update info.
+		*/
+		void defer(const VulkanContext&, unsigned int, const DescriptorUpdater::UpdateInfo&);
+
+		/**
+		 * @brief Apply all deferred updates of an in-flight frame.
+		 * It should be called at the beginning of recording an in-flight frame, after the device has finished using it,
+		 * and before the descriptor buffer is bound.
+		 * Updates are applied in the order they are deferred.
+		 * @param ctx The context.
+		 * @param frame_index The in-flight frame index.
+		*/
+		void applyDeferred(const VulkanContext&, unsigned int);
+
 		/**
 		 * @brief Get the descriptor set buffer.
 		 * @return The descriptor set buffer.
@@ -2,6 +2,8 @@
 #include "ImageManager.hpp"
 #include "PipelineBarrier.hpp"
 
+#include "../../Common/ErrorHandler.hpp"
+
 #include <glm/gtc/type_ptr.hpp>
 
 #include <algorithm>
@@ -28,8 +30,10 @@ namespace {
 
 		VkDevice Device;
 		VmaAllocator Allocator;
+		FramebufferManager::TransientAttachmentPool* Pool;
 
 		VkExtent2D Extent;
+		uint32_t Layer;
 		VkSampleCountFlagBits Sample;
 		VkFormat Format;
 
@@ -38,24 +42,63 @@ namespace {
 
 	};
 
+	//Create a transient attachment from the pool of the memory type it is allocated from.
+	VKO::ImageAllocation createTransientAttachment(const VkDevice device, const VmaAllocator allocator,
+		FramebufferManager::TransientAttachmentPool& pool, const VkImageCreateInfo& image_info) {
+		VmaAllocationCreateInfo alloc_info {
+			.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED
+		};
+		uint32_t memory_type;
+		//fall back to ordinary device memory if there is no lazily allocated memory compatible with the image
+		if (vmaFindMemoryTypeIndexForImageInfo(allocator, &image_info, &alloc_info, &memory_type) != VK_SUCCESS) {
+			alloc_info = {
+				.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			};
+			CHECK_VULKAN_ERROR(vmaFindMemoryTypeIndexForImageInfo(allocator, &image_info, &alloc_info, &memory_type));
+		}
+
+		VKO::AllocatorPool& type_pool = pool.Pool[memory_type];
+		if (!type_pool) {
+			type_pool = VKO::createAllocatorPool(allocator, {
+				.memoryTypeIndex = memory_type
+			});
+		}
+		alloc_info.pool = type_pool;
+		return VKO::createImageFromAllocator(device, allocator, image_info, alloc_info, VKO::AllocationCategory::Attachment);
+	}
+
 	//Create a pair of layered image and an array of image views of each layer.
 	auto createOutputAttachment(const OutputAttachmentCreateInfo& atm_info) {
-		const auto [device, allocator, extent, sample, format, usage, aspect] = atm_info;
+		const auto [device, allocator, pool, extent, layer, sample, format, usage, aspect] = atm_info;
 		const auto [w, h] = extent;
 
-		VKO::ImageAllocation attachment = ImageManager::createImage({
+		VKO::ImageAllocation attachment = pool ? ::createTransientAttachment(device, allocator, *pool, {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = format,
+			.extent = { w, h, 1u },
+			.mipLevels = 1u,
+			.arrayLayers = layer,
+			.samples = sample,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+		}) : ImageManager::createImage({
 			.Device = device,
 			.Allocator = allocator,
+			.Category = VKO::AllocationCategory::Attachment,
 			.ImageType = VK_IMAGE_TYPE_2D,
 			.Format = format,
 			.Extent = { w, h, 1u },
+			.Layer = layer,
 			.Sample = sample,
 			.Usage = usage
 		});
 		VKO::ImageView attachment_view = ImageManager::createFullImageView({
 			.Device = device,
 			.Image = attachment.second,
-			.ViewType = VK_IMAGE_VIEW_TYPE_2D,
+			.ViewType = layer > 1u ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D,
 			.Format = format,
 			.Aspect = aspect
 		});
@@ -85,12 +128,12 @@ namespace {
 }
 
 FramebufferManager::SimpleFramebuffer FramebufferManager::createSimpleFramebuffer(const SimpleFramebufferCreateInfo& fbo_info) {
-	const auto [device, allocator, colour_format, depth_format, sample, extent] = fbo_info;
+	const auto [device, allocator, colour_format, depth_format, sample, extent, view_count, pool] = fbo_info;
 
 	/**********************
 	 * Create attachments
 	 *********************/
-	::OutputAttachmentCreateInfo atm_info = { device, allocator, extent, sample,
+	::OutputAttachmentCreateInfo atm_info = { device, allocator, pool, extent, view_count, sample,
 		colour_format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT };
 	auto [colour_atm, colour_atm_view] = ::createOutputAttachment(atm_info);
 	atm_info.Format = depth_format;
@@ -183,7 +226,7 @@ void FramebufferManager::beginInitialRendering(const VkCommandBuffer cmd, const
 	const InitialRenderingBeginInfo& rendering_info) {
 	static_assert(sizeof(VkClearColorValue) == sizeof(glm::vec4));
 
-	const auto& [issue_info_ptr, colour, render_area, resolve_output_view, required_post_rendering] = rendering_info;
+	const auto& [issue_info_ptr, colour, render_area, view_mask, resolve_output_view, required_post_rendering] = rendering_info;
 	const auto [resolve_colour, resolve_depth] = resolve_output_view;
 	const auto& [store_colour, store_depth] = required_post_rendering;
 
@@ -226,6 +269,7 @@ void FramebufferManager::beginInitialRendering(const VkCommandBuffer cmd, const
 		.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
 		.renderArea = render_area,
 		.layerCount = 1u,
+		.viewMask = view_mask,
 		.colorAttachmentCount = 1u,
 		.pColorAttachments = &colour_atm,
 		.pDepthAttachment = &depth_atm
@@ -233,7 +277,7 @@ void FramebufferManager::beginInitialRendering(const VkCommandBuffer cmd, const
 	vkCmdBeginRendering(cmd, &vk_rendering_info);
 }
 
-void FramebufferManager::transitionAttachmentToPresent(const VkCommandBuffer cmd, const VkImage img) {
+void FramebufferManager::transitionAttachmentToPresent(const VkCommandBuffer cmd, const VkImage img, const VkImageLayout present_layout) {
 	PipelineBarrier<0u, 0u, 1u> barrier;
 	barrier.addImageBarrier({
 		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
@@ -242,7 +286,7 @@ void FramebufferManager::transitionAttachmentToPresent(const VkCommandBuffer cmd
 		VK_ACCESS_2_NONE
 	}, {
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+		present_layout
 	}, img, ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT));
 	barrier.record(cmd);
 }
\ No newline at end of file
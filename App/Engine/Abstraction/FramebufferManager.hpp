@@ -13,6 +13,17 @@ namespace LearnVulkan {
 	 * @brief Manage creation and lifetime of framebuffer.
 	*/
 	namespace FramebufferManager {
+
+		/**
+		 * @brief Memory of transient attachments shared by every renderer.
+		 * Memory is lazily allocated where the device supports it, otherwise it is ordinary device-local memory.
+		*/
+		struct TransientAttachmentPool {
+
+			//One pool for each memory type, created when an attachment is first allocated from that type.
+			std::array<VulkanObject::AllocatorPool, VK_MAX_MEMORY_TYPES> Pool;
+
+		};
 	
 		struct SimpleFramebufferCreateInfo {
 
@@ -22,6 +33,13 @@ namespace LearnVulkan {
 			VkSampleCountFlagBits Sample;
 
 			VkExtent2D Extent;
+			//The number of layer of each attachment, one for each view of multiview rendering.
+			//Attachment views are array views if there is more than one layer.
+			uint32_t ViewCount = 1u;
+			//If given, attachments are created as transient attachments from this pool,
+			//which may have no backing memory unless their content is loaded or stored.
+			//Otherwise, attachments are allocated as ordinary images.
+			TransientAttachmentPool* Pool = nullptr;
 
 		};
 
@@ -69,6 +87,10 @@ namespace LearnVulkan {
 			//Only specification of clear colour is allowed, clear depth/stencil value is implementation-specified.
 			std::optional<glm::vec4> ClearColour;
 			VkRect2D RenderArea;
+			//Each set bit renders to the layer of the same index in every attachment, including resolve output,
+			//which should match the view mask of pipelines used in this rendering.
+			//Zero to render to the first layer without multiview.
+			uint32_t ViewMask = 0u;
 
 			//Specify resolve output.
 			//If null, resolution is not performed.
@@ -127,8 +149,9 @@ namespace LearnVulkan {
 		 * @brief Perform layout transition from colour output attachment to present.
 		 * @param cmd The command buffer.
 		 * @param img The surface image.
+		 * @param present_layout The layout of the present image, given by the context.
 		*/
-		void transitionAttachmentToPresent(VkCommandBuffer, VkImage);
+		void transitionAttachmentToPresent(VkCommandBuffer, VkImage, VkImageLayout);
 
 	}
 
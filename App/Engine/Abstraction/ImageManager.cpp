@@ -1,10 +1,18 @@
 #include "ImageManager.hpp"
 #include "PipelineBarrier.hpp"
+#include "../CpuProfiler.hpp"
 
 #include "../../Common/ErrorHandler.hpp"
+#include "../../Common/File.hpp"
+#include "../../Common/PixelKernel.hpp"
 #include "../../../External/stb_image.h"
 
+#include <glm/gtc/packing.hpp>
+
 #include <string>
+#include <array>
+#include <vector>
+#include <filesystem>
 
 #include <memory>
 #include <utility>
@@ -13,25 +21,34 @@
 #include <algorithm>
 #include <ranges>
 #include <execution>
+#include <bit>
+#include <limits>
+#include <type_traits>
 
 #include <cstring>
+#include <cmath>
 
 using std::ranges::views::iota, std::ranges::transform;
 
-using std::span;
+using std::span, std::array, std::vector, std::byte;
 using std::unique_ptr, std::make_pair;
+using std::future;
 using std::runtime_error;
 
 using namespace LearnVulkan;
 namespace VKO = VulkanObject;
 using ImageManager::ImageBitWidth, ImageManager::ImageColourSpace;
 
-#define EXPAND_IMAGE_READ_INFO const auto [channel, colour_space] = img_read_info
-#define EXPAND_IMAGE_INFO const auto [device, allocator, flag, img_type, format, extent, level, layer, sample, usage, init_layout] = image_info
-#define EXPAND_IV_INFO const auto [device, image, view_type, format, component_mapping, aspect] = iv_info
+#define EXPAND_IMAGE_READ_INFO const auto [channel, colour_space, compressed_filename, half_float] = img_read_info
+#define EXPAND_IMAGE_INFO const auto [device, allocator, category, flag, img_type, format, extent, level, layer, sample, usage, init_layout, \
+	queue_family] = image_info
+#define EXPAND_IV_INFO const auto [device, image, view_type, format, component_mapping, aspect, usage] = iv_info
 
 namespace {
 
+	//Staging buffers of read results are read back when the host copies them to images, and reading uncached memory is slow.
+	constexpr auto ReadResultHostAccess = BufferManager::HostAccessPattern::Random;
+
 	struct FreeImage {
 
 		inline void operator()(void* const img) const noexcept {
@@ -88,6 +105,18 @@ using HandleFormat = StbImageData<PixelFormat>
 		return VkExtent2D(x, y);
 	}
 
+	//Get the number of channel stored in an image file.
+	int getImageChannel(const char* const filename) {
+		int x, y, c;
+		if (!stbi_info(filename, &x, &y, &c)) {
+			using namespace std::string_literals;
+			throw runtime_error("Cannot get the information of the image file \'"s + filename + "\'"s);
+		}
+		(void)x;
+		(void)y;
+		return c;
+	}
+
 	template<ImageBitWidth IBW, class CFG = ::ImageReadConfiguration<IBW>>
 	auto loadImage(const char* const filename, const int channel) {
 		int x, y, c;
@@ -103,26 +132,62 @@ using HandleFormat = StbImageData<PixelFormat>
 		return typename CFG::HandleFormat(pixel);
 	}
 
-	template<class TPixel>
-	void convertRGBAToRG(const TPixel* const input_ptr, TPixel* const output_ptr, const VkExtent2D& dim) {
-		const auto [w, h] = dim;
-		const size_t pixel_count = w * h;
+	//Get the dimension of each layer of a multi-layer image, and the size of each layer in byte.
+	template<ImageBitWidth BitWidth>
+	std::pair<VkExtent2D, size_t> getImageLayerInfo(const span<const char* const> filename, const int channel) {
+		//need to first get the dimension of the image to allocate memory
+		//we can assume all images have the same dimension and format
+		const VkExtent2D dimension = ::getImageInfo(filename[0]);
+		const auto [w, h] = dimension;
+		return { dimension, w * h * channel * sizeof(typename ::ImageReadConfiguration<BitWidth>::PixelFormat) };
+	}
 
-		const auto it = iota(size_t { 0 }, pixel_count);
-		std::for_each(std::execution::par_unseq, it.begin(), it.end(), [input_ptr, output_ptr](const auto i) {
-			const TPixel* const input_pixel = input_ptr + 4u * i;
-			TPixel* const output_pixel = output_ptr + 2u * i;
+	//Decode every layer of a multi-layer image in parallel, and lay out layers contiguously in the output memory.
+	template<ImageBitWidth BitWidth>
+	void decodeImageLayer(const span<const char* const> filename, const ImageReadInfo& img_read_info, const VkExtent2D& dimension,
+		const size_t layer_size, byte* const buf) {
+		using CFG = ::ImageReadConfiguration<BitWidth>;
+		const int channel = img_read_info.Channel;
+		const bool half_float = img_read_info.HalfFloat;
+
+		const auto index = iota(size_t { 0 }, filename.size());
+		std::for_each(std::execution::par, index.begin(), index.end(),
+			[filename, buf, channel, half_float, layer_size, &dimension](const auto i) {
+			//what a shame stb_image does not allow use of custom allocator or user-provided memory
+			//that can really save us from repeated allocation!
+
+			//HACK: Since stb_image only allows loading RA channel if 2 channels are used,
+			//but in fact we expect to use RG channel.
+			//This can be done by first loading a RGBA channel, then swizzle the colour manually
+			const bool require_rgba_to_rg = channel == 2,
+				//stb_image converts channels one pixel at a time, pad the alpha ourselves if it is not stored
+				require_rgb_to_rgba = channel == 4 && ::getImageChannel(filename[i]) == 3;
+			const int load_channel = require_rgba_to_rg ? 4 : require_rgb_to_rgba ? 3 : channel;
+			const typename CFG::HandleFormat pixel = ::loadImage<BitWidth>(filename[i], load_channel);
+
+			const size_t offset = layer_size * i,//in byte
+				pixel_count = static_cast<size_t>(dimension.width) * dimension.height;
+			auto* const output = reinterpret_cast<typename CFG::PixelFormat*>(buf + offset);
+			if (require_rgba_to_rg) {
+				PixelKernel::extractRGFromRGBA(pixel.get(), output, pixel_count);
+			} else if (require_rgb_to_rgba) {
+				PixelKernel::padRGBToRGBA(pixel.get(), output, pixel_count);
+			} else {
+				std::memcpy(output, pixel.get(), layer_size);
+			}
 
-			for (const auto p : iota(0u, 2u)) {
-				output_pixel[p] = input_pixel[p];
+			if constexpr (BitWidth == ImageBitWidth::Sixteen) {
+				if (half_float) {
+					PixelKernel::convertUnormToHalf(output, output, layer_size / sizeof(typename CFG::PixelFormat));
+				}
 			}
 		});
 	}
 
 	template<ImageBitWidth BitWidth>
-	VkFormat deduceImageFormat(ImageColourSpace, int);
+	VkFormat deduceImageFormat(ImageColourSpace, int, bool);
 	template<>
-	VkFormat deduceImageFormat<ImageBitWidth::Eight>(const ImageColourSpace colour_space, const int channel) {
+	VkFormat deduceImageFormat<ImageBitWidth::Eight>(const ImageColourSpace colour_space, const int channel, bool) {
 		constexpr static auto deduceLinearImageFormat8 = [](const int channel) -> VkFormat {
 			switch (channel) {
 			case 1:
@@ -157,13 +222,13 @@ using HandleFormat = StbImageData<PixelFormat>
 		}
 	}
 	template<>
-	VkFormat deduceImageFormat<ImageBitWidth::Sixteen>(const ImageColourSpace colour_space, const int channel) {
-		constexpr static auto deduceLinearImageFormat16 = [](const int channel) -> VkFormat {
+	VkFormat deduceImageFormat<ImageBitWidth::Sixteen>(const ImageColourSpace colour_space, const int channel, const bool half_float) {
+		constexpr static auto deduceLinearImageFormat16 = [](const int channel, const bool half_float) -> VkFormat {
 			switch (channel) {
 			case 1:
-				return VK_FORMAT_R16_UNORM;
+				return half_float ? VK_FORMAT_R16_SFLOAT : VK_FORMAT_R16_UNORM;
 			case 4:
-				return VK_FORMAT_R16G16B16A16_UNORM;
+				return half_float ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R16G16B16A16_UNORM;
 			default:
 				throw runtime_error("Cannot deduce the linear image format for 16-bit input given the channel count.");
 			}
@@ -171,18 +236,440 @@ using HandleFormat = StbImageData<PixelFormat>
 
 		using enum ImageColourSpace;
 		switch (colour_space) {
-		case Linear: return deduceLinearImageFormat16(channel);
+		case Linear: return deduceLinearImageFormat16(channel, half_float);
 		case SRGB: throw runtime_error("16-bit image does not support non-linear image format.");
 		default:
 			throw runtime_error("The image colour space to deduce its image format is unknown.");
 		}
 	}
 
+	/*************************
+	 * Block-compressed image
+	 ************************/
+	enum class BlockFormat : uint8_t {
+		BC1,
+		BC3,
+		BC4,
+		BC5,
+		BC6H,
+		BC7
+	};
+
+	//Copy offset of buffer to image must be a multiple of the block size.
+	constexpr size_t CompressedLevelAlignment = 16u;
+
+	//Where each level of each layer of a block-compressed image is stored in a file.
+	struct CompressedImageFile {
+
+		BlockFormat Block;
+		VkExtent2D Extent;
+		uint32_t Layer, Level;
+		vector<size_t> Offset;/**< In byte, indexed by level * Layer + layer. */
+
+	};
+
+	//The size of a 4x4 block in byte.
+	constexpr size_t getBlockSize(const BlockFormat block) noexcept {
+		using enum BlockFormat;
+		return block == BC1 || block == BC4 ? 8u : 16u;
+	}
+
+	//The size of one layer of a level in byte.
+	constexpr size_t getCompressedLayerSize(const BlockFormat block, const VkExtent2D& extent, const uint32_t level) noexcept {
+		const auto blockCount = [level](const uint32_t dim) constexpr noexcept -> size_t {
+			return (std::max(dim >> level, 1u) + 3u) / 4u;
+		};
+		return blockCount(extent.width) * blockCount(extent.height) * ::getBlockSize(block);
+	}
+
+	constexpr uint32_t makeFourCC(const char (&code)[5]) noexcept {
+		return static_cast<uint32_t>(code[0]) | static_cast<uint32_t>(code[1]) << 8u
+			| static_cast<uint32_t>(code[2]) << 16u | static_cast<uint32_t>(code[3]) << 24u;
+	}
+
+	//Read a structure from the content of a file.
+	template<class T>
+	T readFileStructure(const span<const byte> content, const size_t offset, const char* const filename) {
+		if (offset + sizeof(T) > content.size()) {
+			using namespace std::string_literals;
+			throw runtime_error("The compressed image file \'"s + filename + "\' is truncated"s);
+		}
+		T structure;
+		std::memcpy(&structure, content.data() + offset, sizeof(T));
+		return structure;
+	}
+
+	constexpr array<uint8_t, 12u> Ktx2Identifier = { 0xABu, 0x4Bu, 0x54u, 0x58u, 0x20u, 0x32u, 0x30u, 0xBBu, 0x0Du, 0x0Au, 0x1Au, 0x0Au };
+	struct Ktx2Header {
+
+		array<uint8_t, 12u> Identifier;
+		uint32_t Format, TypeSize, PixelWidth, PixelHeight, PixelDepth, LayerCount, FaceCount, LevelCount, SupercompressionScheme;
+		uint32_t DfdByteOffset, DfdByteLength, KvdByteOffset, KvdByteLength;
+		uint64_t SgdByteOffset, SgdByteLength;
+
+	};
+	struct Ktx2LevelIndex {
+
+		uint64_t ByteOffset, ByteLength, UncompressedByteLength;
+
+	};
+
+	CompressedImageFile parseKtx2(const span<const byte> content, const char* const filename) {
+		const auto header = ::readFileStructure<Ktx2Header>(content, 0u, filename);
+		if (header.SupercompressionScheme != 0u) {
+			throw runtime_error("Supercompressed KTX2 image is not supported");
+		}
+		if (header.PixelDepth > 1u) {
+			throw runtime_error("KTX2 image with depth is not supported");
+		}
+
+		BlockFormat block;
+		switch (static_cast<VkFormat>(header.Format)) {
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: [[fallthrough]];
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: block = BlockFormat::BC1;
+			break;
+		case VK_FORMAT_BC3_UNORM_BLOCK: [[fallthrough]];
+		case VK_FORMAT_BC3_SRGB_BLOCK: block = BlockFormat::BC3;
+			break;
+		case VK_FORMAT_BC4_UNORM_BLOCK: block = BlockFormat::BC4;
+			break;
+		case VK_FORMAT_BC5_UNORM_BLOCK: block = BlockFormat::BC5;
+			break;
+		case VK_FORMAT_BC6H_UFLOAT_BLOCK: block = BlockFormat::BC6H;
+			break;
+		case VK_FORMAT_BC7_UNORM_BLOCK: [[fallthrough]];
+		case VK_FORMAT_BC7_SRGB_BLOCK: block = BlockFormat::BC7;
+			break;
+		default:
+			throw runtime_error("The format of the KTX2 image is not a supported block-compressed format");
+		}
+
+		CompressedImageFile file {
+			.Block = block,
+			.Extent = { header.PixelWidth, header.PixelHeight },
+			//layers are laid out in layer-major order, and then by face, which matches layer order of a cube array
+			.Layer = std::max(header.LayerCount, 1u) * std::max(header.FaceCount, 1u),
+			//zero level count requests mip-maps to be generated, we just take the base level
+			.Level = std::max(header.LevelCount, 1u)
+		};
+		file.Offset.resize(file.Level * file.Layer);
+		for (const auto level : iota(0u, file.Level)) {
+			const auto level_index = ::readFileStructure<Ktx2LevelIndex>(content,
+				sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * level, filename);
+			const size_t layer_size = ::getCompressedLayerSize(block, file.Extent, level);
+			for (const auto layer : iota(0u, file.Layer)) {
+				file.Offset[level * file.Layer + layer] = static_cast<size_t>(level_index.ByteOffset) + layer_size * layer;
+			}
+		}
+		return file;
+	}
+
+	struct DdsHeader {
+
+		uint32_t Magic, Size, Flag, Height, Width, PitchOrLinearSize, Depth, MipMapCount;
+		array<uint32_t, 11u> Reserved1;
+		struct {
+
+			uint32_t Size, Flag, FourCC, RGBBitCount, RBitMask, GBitMask, BBitMask, ABitMask;
+
+		} PixelFormat;
+		uint32_t Caps, Caps2, Caps3, Caps4, Reserved2;
+
+	};
+	struct DdsHeaderDxt10 {
+
+		uint32_t DxgiFormat, ResourceDimension, MiscFlag, ArraySize, MiscFlag2;
+
+	};
+
+	CompressedImageFile parseDds(const span<const byte> content, const char* const filename) {
+		constexpr uint32_t FlagMipMapCount = 0x20000u, Caps2CubeMap = 0x200u, MiscFlagTextureCube = 0x4u;
+
+		const auto header = ::readFileStructure<DdsHeader>(content, 0u, filename);
+		if (header.Magic != ::makeFourCC("DDS ")) {
+			using namespace std::string_literals;
+			throw runtime_error("The file \'"s + filename + "\' is neither a KTX2 nor DDS image"s);
+		}
+
+		size_t data_offset = sizeof(DdsHeader);
+		uint32_t layer = (header.Caps2 & Caps2CubeMap) != 0u ? 6u : 1u;
+		BlockFormat block;
+		switch (const uint32_t four_cc = header.PixelFormat.FourCC; four_cc) {
+		case ::makeFourCC("DXT1"): block = BlockFormat::BC1;
+			break;
+		case ::makeFourCC("DXT5"): block = BlockFormat::BC3;
+			break;
+		case ::makeFourCC("ATI1"): [[fallthrough]];
+		case ::makeFourCC("BC4U"): block = BlockFormat::BC4;
+			break;
+		case ::makeFourCC("ATI2"): [[fallthrough]];
+		case ::makeFourCC("BC5U"): block = BlockFormat::BC5;
+			break;
+		case ::makeFourCC("DX10"):
+		{
+			const auto dxt10 = ::readFileStructure<DdsHeaderDxt10>(content, data_offset, filename);
+			data_offset += sizeof(DdsHeaderDxt10);
+			layer = std::max(dxt10.ArraySize, 1u) * ((dxt10.MiscFlag & MiscFlagTextureCube) != 0u ? 6u : 1u);
+
+			switch (dxt10.DxgiFormat) {
+			//DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC1_UNORM_SRGB
+			case 71u: [[fallthrough]];
+			case 72u: block = BlockFormat::BC1;
+				break;
+			//DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_BC3_UNORM_SRGB
+			case 77u: [[fallthrough]];
+			case 78u: block = BlockFormat::BC3;
+				break;
+			//DXGI_FORMAT_BC4_UNORM
+			case 80u: block = BlockFormat::BC4;
+				break;
+			//DXGI_FORMAT_BC5_UNORM
+			case 83u: block = BlockFormat::BC5;
+				break;
+			//DXGI_FORMAT_BC6H_UF16
+			case 95u: block = BlockFormat::BC6H;
+				break;
+			//DXGI_FORMAT_BC7_UNORM, DXGI_FORMAT_BC7_UNORM_SRGB
+			case 98u: [[fallthrough]];
+			case 99u: block = BlockFormat::BC7;
+				break;
+			default:
+				throw runtime_error("The DXGI format of the DDS image is not a supported block-compressed format");
+			}
+			break;
+		}
+		default:
+			throw runtime_error("The format of the DDS image is not a supported block-compressed format");
+		}
+
+		CompressedImageFile file {
+			.Block = block,
+			.Extent = { header.Width, header.Height },
+			.Layer = layer,
+			.Level = (header.Flag & FlagMipMapCount) != 0u ? std::max(header.MipMapCount, 1u) : 1u
+		};
+		//unlike KTX2, every layer is stored with its full mip chain
+		file.Offset.resize(file.Level * file.Layer);
+		for (const auto layer_idx : iota(0u, file.Layer)) {
+			for (const auto level : iota(0u, file.Level)) {
+				file.Offset[level * file.Layer + layer_idx] = data_offset;
+				data_offset += ::getCompressedLayerSize(block, file.Extent, level);
+			}
+		}
+		return file;
+	}
+
+	VkFormat deduceCompressedImageFormat(const ImageColourSpace colour_space, const BlockFormat block) {
+		constexpr static auto deduceLinearCompressedImageFormat = [](const BlockFormat block) -> VkFormat {
+			using enum BlockFormat;
+			switch (block) {
+			case BC1: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+			case BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+			case BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+			case BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+			case BC6H: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+			case BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+			default:
+				throw runtime_error("Cannot deduce the linear image format for the block-compressed input.");
+			}
+		};
+		constexpr static auto deduceNonLinearCompressedImageFormat = [](const BlockFormat block) -> VkFormat {
+			using enum BlockFormat;
+			switch (block) {
+			case BC1: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+			case BC3: return VK_FORMAT_BC3_SRGB_BLOCK;
+			case BC7: return VK_FORMAT_BC7_SRGB_BLOCK;
+			default:
+				throw runtime_error("Cannot deduce the non-linear image format for the block-compressed input.");
+			}
+		};
+
+		using enum ImageColourSpace;
+		switch (colour_space) {
+		case Linear: return deduceLinearCompressedImageFormat(block);
+		case SRGB: return deduceNonLinearCompressedImageFormat(block);
+		default:
+			throw runtime_error("The image colour space to deduce its image format is unknown.");
+		}
+	}
+
+	//Read a KTX2 or DDS file containing a block-compressed image.
+	//The resulting pixels are laid out level by level, and each level contains all layers contiguously.
+	ImageManager::ImageDecodeResult decodeCompressedImage(const char* const filename, const ImageColourSpace colour_space) {
+		const vector<byte> content = File::readBinary(filename);
+		const CompressedImageFile file =
+			content.size() >= ::Ktx2Identifier.size() && std::memcmp(content.data(), ::Ktx2Identifier.data(), ::Ktx2Identifier.size()) == 0
+			? ::parseKtx2(content, filename) : ::parseDds(content, filename);
+		const auto& [block, extent, layer, level, offset] = file;
+
+		ImageManager::ImageDecodeResult result {
+			.Extent = extent,
+			.Format = ::deduceCompressedImageFormat(colour_space, block),
+			.Layer = layer
+		};
+		result.Level.reserve(level);
+		size_t total_size = 0u;
+		for (const auto l : iota(0u, level)) {
+			total_size = (total_size + CompressedLevelAlignment - 1u) / CompressedLevelAlignment * CompressedLevelAlignment;
+			result.Level.push_back({
+				.Offset = total_size,
+				.Extent = { std::max(extent.width >> l, 1u), std::max(extent.height >> l, 1u) }
+			});
+			total_size += ::getCompressedLayerSize(block, extent, l) * layer;
+		}
+
+		result.Pixel.resize(total_size);
+		for (const auto l : iota(0u, level)) {
+			const size_t layer_size = ::getCompressedLayerSize(block, extent, l);
+			for (const auto i : iota(0u, layer)) {
+				const size_t source = offset[l * layer + i];
+				if (source + layer_size > content.size()) {
+					using namespace std::string_literals;
+					throw runtime_error("The compressed image file \'"s + filename + "\' is truncated"s);
+				}
+				std::memcpy(result.Pixel.data() + result.Level[l].Offset + layer_size * i, content.data() + source, layer_size);
+			}
+		}
+		return result;
+	}
+
+	/*************************
+	 * Engine image container
+	 ************************/
+	constexpr uint32_t ContainerMagic = ::makeFourCC("LVIM"), ContainerVersion = 1u;
+
+	//The header is followed by the level table, then the pixels of every level starting from the pixel offset.
+	struct ContainerHeader {
+
+		uint32_t Magic, Version;
+		uint32_t Format, Width, Height, Layer, Level, Reserved;
+		uint64_t PixelOffset, PixelSize;/**< In byte. */
+
+	};
+
+	/************************
+	 * Engine tiled image
+	 ***********************/
+	constexpr uint32_t TiledMagic = ::makeFourCC("LVTI"), TiledVersion = 1u;
+
+	//The header is followed by the level table, then tiles of every level starting from the offset of each level.
+	struct TiledHeader {
+
+		uint32_t Magic, Version;
+		uint32_t Format, Width, Height, TileSize, Level, Reserved;
+
+	};
+
+	//Pixel layout of an uncompressed format.
+	struct PixelLayout {
+
+		uint32_t Channel, ChannelSize;/**< Size of each channel in byte. */
+		bool SRGB;
+		bool HalfFloat = false;/**< Each 16-bit channel is a half-float rather than unsigned normalised. */
+
+	};
+
+	PixelLayout getPixelLayout(const VkFormat format) {
+		switch (format) {
+		case VK_FORMAT_R8_UNORM: return { 1u, 1u, false };
+		case VK_FORMAT_R8_SRGB: return { 1u, 1u, true };
+		case VK_FORMAT_R8G8_UNORM: return { 2u, 1u, false };
+		case VK_FORMAT_R8G8_SRGB: return { 2u, 1u, true };
+		case VK_FORMAT_R8G8B8A8_UNORM: return { 4u, 1u, false };
+		case VK_FORMAT_R8G8B8A8_SRGB: return { 4u, 1u, true };
+		case VK_FORMAT_R16_UNORM: return { 1u, 2u, false };
+		case VK_FORMAT_R16G16B16A16_UNORM: return { 4u, 2u, false };
+		case VK_FORMAT_R16_SFLOAT: return { 1u, 2u, false, true };
+		case VK_FORMAT_R16G16B16A16_SFLOAT: return { 4u, 2u, false, true };
+		default:
+			throw runtime_error("Cannot bake mip-map for an image with the given format.");
+		}
+	}
+
+	inline float convertSRGBToLinear(const float srgb) noexcept {
+		return srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+	}
+
+	inline float convertLinearToSRGB(const float linear) noexcept {
+		return linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+	}
+
+	//Downsample a level to the next level using a 2x2 box filter. Odd texels on the edge are clamped.
+	template<class TChannel>
+	void downsampleLevel(const TChannel* const input, TChannel* const output, const VkExtent2D& input_extent,
+		const VkExtent2D& output_extent, const uint32_t layer, const PixelLayout& pixel_layout) {
+		constexpr float ChannelMax = static_cast<float>(std::numeric_limits<TChannel>::max());
+		const auto [in_w, in_h] = input_extent;
+		const auto [out_w, out_h] = output_extent;
+		const uint32_t channel = pixel_layout.Channel;
+		//alpha channel is always linear
+		const uint32_t colour_channel = channel == 4u ? 3u : channel;
+
+		//half-float channels are filtered as they are, other channels are normalised
+		const auto load = [half_float = pixel_layout.HalfFloat](const TChannel value) noexcept -> float {
+			if constexpr (std::is_same_v<TChannel, uint16_t>) {
+				if (half_float) {
+					return glm::unpackHalf1x16(value);
+				}
+			}
+			return static_cast<float>(value) / ChannelMax;
+		};
+		const auto store = [half_float = pixel_layout.HalfFloat](const float value) noexcept -> TChannel {
+			if constexpr (std::is_same_v<TChannel, uint16_t>) {
+				if (half_float) {
+					return glm::packHalf1x16(value);
+				}
+			}
+			return static_cast<TChannel>(std::clamp(value, 0.0f, 1.0f) * ChannelMax + 0.5f);
+		};
+
+		//each row of every layer is processed in parallel
+		const auto row = iota(0u, out_h * layer);
+		std::for_each(std::execution::par, row.begin(), row.end(),
+			[=, srgb = pixel_layout.SRGB](const uint32_t layer_row) {
+			const uint32_t l = layer_row / out_h, y = layer_row % out_h;
+			const TChannel* const in_layer = input + static_cast<size_t>(in_w) * in_h * channel * l;
+			TChannel* const out_row = output + (static_cast<size_t>(out_w) * out_h * l + static_cast<size_t>(out_w) * y) * channel;
+
+			const array<uint32_t, 2u> src_y = { std::min(2u * y, in_h - 1u), std::min(2u * y + 1u, in_h - 1u) };
+			for (const auto x : iota(0u, out_w)) {
+				const array<uint32_t, 2u> src_x = { std::min(2u * x, in_w - 1u), std::min(2u * x + 1u, in_w - 1u) };
+				for (const auto c : iota(0u, channel)) {
+					const bool linearise = srgb && c < colour_channel;
+					float sum = 0.0f;
+					for (const auto sy : src_y) {
+						for (const auto sx : src_x) {
+							const float value = load(in_layer[(static_cast<size_t>(in_w) * sy + sx) * channel + c]);
+							sum += linearise ? ::convertSRGBToLinear(value) : value;
+						}
+					}
+					const float average = sum * 0.25f,
+						encoded = linearise ? ::convertLinearToSRGB(average) : average;
+					out_row[x * channel + c] = store(encoded);
+				}
+			}
+		});
+	}
+
+	//Check if a pre-compressed file should be read instead.
+	inline bool useCompressedFile(const char* const compressed_filename) {
+		return compressed_filename && std::filesystem::exists(compressed_filename);
+	}
+
+	inline VkImageViewUsageCreateInfo createImageViewUsageInfo(const ImageManager::ImageViewCreateInfo& iv_info) noexcept {
+		return {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO,
+			.usage = iv_info.Usage
+		};
+	}
+
+	//The usage info is only chained if the usage is restricted.
 	inline VkImageViewCreateInfo createCommonImageViewInfo(const ImageManager::ImageViewCreateInfo& iv_info,
-		const VkImageSubresourceRange sub_res) noexcept {
+		const VkImageViewUsageCreateInfo& usage_info, const VkImageSubresourceRange sub_res) noexcept {
 		EXPAND_IV_INFO;
 		return {
 			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.pNext = usage ? &usage_info : nullptr,
 			.image = image,
 			.viewType = view_type,
 			.format = format,
@@ -234,65 +721,381 @@ void ImageManager::_Internal::recordMipMapGeneration(const VkCommandBuffer cmd,
 template<ImageBitWidth BitWidth>
 ImageManager::ImageReadResult ImageManager::readFile(const VkDevice device, const VmaAllocator allocator,
 	const span<const char* const> filename, const ImageReadInfo& img_read_info) {
-	using CFG = ::ImageReadConfiguration<BitWidth>;
+	CPU_PROFILE_SCOPE("Image read");
 	EXPAND_IMAGE_READ_INFO;
+	if (::useCompressedFile(compressed_filename)) {
+		return ImageManager::readFile(device, allocator, ::decodeCompressedImage(compressed_filename, colour_space));
+	}
 
-	//need to first get the dimension of the image to allocate memory
-	//we can assume all images have the same dimension and format
-	const VkExtent2D dimension = ::getImageInfo(filename[0]);
-	const auto [w, h] = dimension;
-
-	const size_t layer_size = w * h * channel * sizeof(typename CFG::PixelFormat),
-		total_size = layer_size * filename.size();
+	const auto [dimension, layer_size] = ::getImageLayerInfo<BitWidth>(filename, channel);
+	const size_t total_size = layer_size * filename.size();
 	VulkanObject::BufferAllocation staging = BufferManager::createStagingBuffer({ device, allocator, total_size },
-		BufferManager::HostAccessPattern::Sequential);
+		::ReadResultHostAccess);
 
 	//laid out every layer contiguously
 	void* data;
 	CHECK_VULKAN_ERROR(vmaMapMemory(allocator, staging.first, &data));
-
-	using std::as_const;
-	const auto index = iota(size_t { 0 }, filename.size());
-	std::for_each(std::execution::par, index.begin(), index.end(),
-		[&filename = as_const(filename), buf = reinterpret_cast<uint8_t*>(data), channel, layer_size, &dimension](const auto i) {
-		//what a shame stb_image does not allow use of custom allocator or user-provided memory
-		//that can really save us from repeated allocation!
-
-		//HACK: Since stb_image only allows loading RA channel if 2 channels are used,
-		//but in fact we expect to use RG channel.
-		//This can be done by first loading a RGBA channel, then swizzle the colour manually
-		const bool require_rgba_to_rg = channel == 2;
-		const int load_channel = require_rgba_to_rg ? 4 : channel;
-		const typename CFG::HandleFormat pixel = ::loadImage<BitWidth>(filename[i], load_channel);
-
-		const size_t offset = layer_size * i;//in byte
-		auto* const output = reinterpret_cast<CFG::PixelFormat*>(buf + offset);
-		if (require_rgba_to_rg) {
-			convertRGBAToRG(pixel.get(), output, dimension);
-		} else {
-			std::memcpy(output, pixel.get(), layer_size);
-		}
-	});
-
+	::decodeImageLayer<BitWidth>(filename, img_read_info, dimension, layer_size, static_cast<byte*>(data));
 	CHECK_VULKAN_ERROR(vmaFlushAllocation(allocator, staging.first, 0ull, total_size));
 	vmaUnmapMemory(allocator, staging.first);
 
 	return {
 		.Extent = dimension,
-		.Format = ::deduceImageFormat<BitWidth>(colour_space, channel),
+		.Format = ::deduceImageFormat<BitWidth>(colour_space, channel, half_float),
 		.Layer = static_cast<uint32_t>(filename.size()),
+		.Level = { { .Offset = 0ull, .Extent = dimension } },
+		.Pixel = std::move(staging)
+	};
+}
+
+ImageManager::ImageReadResult ImageManager::readFile(const VkDevice device, const VmaAllocator allocator,
+	const ImageDecodeResult& decode_result) {
+	const auto& [extent, format, layer, level, pixel] = decode_result;
+	VulkanObject::BufferAllocation staging = BufferManager::createStagingBuffer({ device, allocator, pixel.size() },
+		::ReadResultHostAccess);
+
+	void* data;
+	CHECK_VULKAN_ERROR(vmaMapMemory(allocator, staging.first, &data));
+	std::memcpy(data, pixel.data(), pixel.size());
+	CHECK_VULKAN_ERROR(vmaFlushAllocation(allocator, staging.first, 0ull, pixel.size()));
+	vmaUnmapMemory(allocator, staging.first);
+
+	return {
+		.Extent = extent,
+		.Format = format,
+		.Layer = layer,
+		.Level = level,
 		.Pixel = std::move(staging)
 	};
 }
 
+template<ImageBitWidth BitWidth>
+ImageManager::ImageDecodeResult ImageManager::decodeFile(const span<const char* const> filename, const ImageReadInfo& img_read_info) {
+	CPU_PROFILE_SCOPE("Image decode");
+	EXPAND_IMAGE_READ_INFO;
+	if (::useCompressedFile(compressed_filename)) {
+		return ::decodeCompressedImage(compressed_filename, colour_space);
+	}
+
+	const auto [dimension, layer_size] = ::getImageLayerInfo<BitWidth>(filename, channel);
+	ImageDecodeResult result {
+		.Extent = dimension,
+		.Format = ::deduceImageFormat<BitWidth>(colour_space, channel, half_float),
+		.Layer = static_cast<uint32_t>(filename.size()),
+		.Level = { { .Offset = 0ull, .Extent = dimension } },
+		.Pixel = vector<byte>(layer_size * filename.size())
+	};
+	::decodeImageLayer<BitWidth>(filename, img_read_info, dimension, layer_size, result.Pixel.data());
+	return result;
+}
+
+template<ImageBitWidth BitWidth>
+future<ImageManager::ImageDecodeResult> ImageManager::decodeFileAsync(const span<const char* const> filename,
+	const ImageReadInfo& img_read_info) {
+	return std::async(std::launch::async, &ImageManager::decodeFile<BitWidth>, filename, img_read_info);
+}
+
 #define READ_FILE_INSTANTIATE(IBW) template ImageManager::ImageReadResult \
-ImageManager::readFile<ImageBitWidth::IBW>(VkDevice, VmaAllocator, span<const char* const>, const ImageReadInfo&)
+ImageManager::readFile<ImageBitWidth::IBW>(VkDevice, VmaAllocator, span<const char* const>, const ImageReadInfo&); \
+template ImageManager::ImageDecodeResult ImageManager::decodeFile<ImageBitWidth::IBW>(span<const char* const>, const ImageReadInfo&); \
+template future<ImageManager::ImageDecodeResult> ImageManager::decodeFileAsync<ImageBitWidth::IBW>( \
+	span<const char* const>, const ImageReadInfo&)
 
 READ_FILE_INSTANTIATE(Eight);
 READ_FILE_INSTANTIATE(Sixteen);
 
 #undef READ_FILE_INSTANTIATE
 
+ImageManager::ImageReadResult ImageManager::readContainerFile(const VkDevice device, const VmaAllocator allocator,
+	const char* const filename) {
+	CPU_PROFILE_SCOPE("Image container read");
+	const File::MappedFile file(filename);
+	const span<const byte> content = file.content();
+
+	const auto header = ::readFileStructure<ContainerHeader>(content, 0u, filename);
+	const auto [magic, version, format, width, height, layer, level, reserved, pixel_offset, pixel_size] = header;
+	if (magic != ::ContainerMagic || version != ::ContainerVersion) {
+		using namespace std::string_literals;
+		throw runtime_error("The file \'"s + filename + "\' is not a compatible image container"s);
+	}
+	if (level == 0u || pixel_offset + pixel_size > content.size()) {
+		using namespace std::string_literals;
+		throw runtime_error("The image container \'"s + filename + "\' is truncated"s);
+	}
+	(void)reserved;
+
+	ImageReadResult result {
+		.Extent = { width, height },
+		.Format = static_cast<VkFormat>(format),
+		.Layer = layer,
+		.Level = vector<ImageLevel>(level)
+	};
+	for (const auto l : iota(0u, level)) {
+		result.Level[l] = ::readFileStructure<ImageLevel>(content, sizeof(ContainerHeader) + sizeof(ImageLevel) * l, filename);
+	}
+
+	//pixels are copied from the mapped file straight into the staging buffer
+	result.Pixel = BufferManager::createStagingBuffer({ device, allocator, pixel_size }, ::ReadResultHostAccess);
+	void* data;
+	CHECK_VULKAN_ERROR(vmaMapMemory(allocator, result.Pixel.first, &data));
+	std::memcpy(data, content.data() + pixel_offset, pixel_size);
+	CHECK_VULKAN_ERROR(vmaFlushAllocation(allocator, result.Pixel.first, 0ull, pixel_size));
+	vmaUnmapMemory(allocator, result.Pixel.first);
+
+	return result;
+}
+
+void ImageManager::writeContainerFile(const char* const filename, const ImageDecodeResult& image) {
+	const auto& [extent, format, layer, level, pixel] = image;
+	const ContainerHeader header {
+		.Magic = ::ContainerMagic,
+		.Version = ::ContainerVersion,
+		.Format = static_cast<uint32_t>(format),
+		.Width = extent.width,
+		.Height = extent.height,
+		.Layer = layer,
+		.Level = static_cast<uint32_t>(level.size()),
+		.Reserved = 0u,
+		.PixelOffset = (sizeof(ContainerHeader) + sizeof(ImageLevel) * level.size() + CompressedLevelAlignment - 1u)
+			/ CompressedLevelAlignment * CompressedLevelAlignment,
+		.PixelSize = pixel.size()
+	};
+
+	vector<byte> content(header.PixelOffset + header.PixelSize);
+	std::memcpy(content.data(), &header, sizeof(header));
+	std::memcpy(content.data() + sizeof(header), level.data(), sizeof(ImageLevel) * level.size());
+	std::memcpy(content.data() + header.PixelOffset, pixel.data(), pixel.size());
+	File::writeBinary(filename, content);
+}
+
+bool ImageManager::isContainerFileUpToDate(const char* const filename, const span<const char* const> source) {
+	namespace fs = std::filesystem;
+	std::error_code ec;
+	const fs::file_time_type container_time = fs::last_write_time(filename, ec);
+	if (ec) {
+		return false;
+	}
+	return std::ranges::all_of(source, [container_time](const char* const src) {
+		std::error_code src_ec;
+		const fs::file_time_type source_time = fs::last_write_time(src, src_ec);
+		//a source that does not exist, such as an absent pre-compressed file, does not invalidate the container
+		return src_ec || source_time <= container_time;
+	});
+}
+
+ImageManager::TiledImageFile::TiledImageFile(const char* const filename) : Mapping(filename) {
+	const span<const byte> content = this->Mapping.content();
+
+	const auto header = ::readFileStructure<TiledHeader>(content, 0u, filename);
+	const auto [magic, version, format, width, height, tile_size, level, reserved] = header;
+	if (magic != ::TiledMagic || version != ::TiledVersion) {
+		using namespace std::string_literals;
+		throw runtime_error("The file \'"s + filename + "\' is not a compatible tiled image"s);
+	}
+	(void)width;
+	(void)height;
+	(void)reserved;
+
+	this->Format = static_cast<VkFormat>(format);
+	const ::PixelLayout pixel_layout = ::getPixelLayout(this->Format);
+	this->TileSize = tile_size;
+	this->TileByte = VkDeviceSize { pixel_layout.Channel } * pixel_layout.ChannelSize * tile_size * tile_size;
+
+	this->Level.resize(level);
+	for (const auto l : iota(0u, level)) {
+		const TiledImageLevel& tiled_level = this->Level[l] =
+			::readFileStructure<TiledImageLevel>(content, sizeof(TiledHeader) + sizeof(TiledImageLevel) * l, filename);
+		const auto [tile_x, tile_y] = tiled_level.TileCount;
+		if (tiled_level.Offset + this->TileByte * tile_x * tile_y > content.size()) {
+			using namespace std::string_literals;
+			throw runtime_error("The tiled image \'"s + filename + "\' is truncated"s);
+		}
+	}
+	if (this->Level.empty()) {
+		using namespace std::string_literals;
+		throw runtime_error("The tiled image \'"s + filename + "\' has no level"s);
+	}
+}
+
+VkFormat ImageManager::TiledImageFile::format() const noexcept {
+	return this->Format;
+}
+
+uint32_t ImageManager::TiledImageFile::tileSize() const noexcept {
+	return this->TileSize;
+}
+
+VkDeviceSize ImageManager::TiledImageFile::tileByte() const noexcept {
+	return this->TileByte;
+}
+
+span<const ImageManager::TiledImageLevel> ImageManager::TiledImageFile::level() const noexcept {
+	return this->Level;
+}
+
+span<const byte> ImageManager::TiledImageFile::tile(const uint32_t level, const uint32_t x, const uint32_t y) const noexcept {
+	const TiledImageLevel& tiled_level = this->Level[level];
+	const VkDeviceSize index = VkDeviceSize { tiled_level.TileCount.width } * y + x;
+	return this->Mapping.content().subspan(tiled_level.Offset + this->TileByte * index, this->TileByte);
+}
+
+ImageManager::ImageReadResult ImageManager::TiledImageFile::readLevel(const VkDevice device, const VmaAllocator allocator,
+	const uint32_t level) const {
+	const auto [extent, tile_count, offset] = this->Level[level];
+	const size_t texel_size = this->TileByte / (VkDeviceSize { this->TileSize } * this->TileSize),
+		tile_row_size = texel_size * this->TileSize,
+		row_size = texel_size * extent.width,
+		pixel_size = row_size * extent.height;
+	(void)offset;
+
+	ImageReadResult result {
+		.Extent = extent,
+		.Format = this->Format,
+		.Layer = 1u,
+		.Level = { { .Offset = 0ull, .Extent = extent } },
+		.Pixel = BufferManager::createStagingBuffer({ device, allocator, pixel_size }, ::ReadResultHostAccess)
+	};
+	void* data;
+	CHECK_VULKAN_ERROR(vmaMapMemory(allocator, result.Pixel.first, &data));
+	byte* const pixel = static_cast<byte*>(data);
+	for (const auto y : iota(0u, extent.height)) {
+		const uint32_t tile_y = y / this->TileSize, row = y % this->TileSize;
+		for (const auto tile_x : iota(0u, tile_count.width)) {
+			const span<const byte> tile = this->tile(level, tile_x, tile_y);
+			//padding of tiles on the right edge is discarded
+			const size_t column = tile_row_size * tile_x;
+			std::memcpy(pixel + row_size * y + column, tile.data() + tile_row_size * row, std::min(tile_row_size, row_size - column));
+		}
+	}
+	CHECK_VULKAN_ERROR(vmaFlushAllocation(allocator, result.Pixel.first, 0ull, pixel_size));
+	vmaUnmapMemory(allocator, result.Pixel.first);
+
+	return result;
+}
+
+void ImageManager::writeTiledFile(const char* const filename, const ImageDecodeResult& image, const uint32_t tile_size) {
+	if (image.Layer != 1u || image.Level.size() != 1u) {
+		throw runtime_error("A tiled image can only be written from an image with one layer and only the base level");
+	}
+	ImageDecodeResult baked = image;
+	ImageManager::bakeMipMap(baked);
+
+	const ::PixelLayout pixel_layout = ::getPixelLayout(baked.Format);
+	const size_t texel_size = pixel_layout.Channel * pixel_layout.ChannelSize,
+		tile_row_size = texel_size * tile_size,
+		tile_byte = tile_row_size * tile_size;
+
+	//levels coarser than the first level fitting in one tile are never needed
+	const auto fit_level = std::ranges::find_if(baked.Level, [tile_size](const ImageLevel& baked_level) {
+		return std::max(baked_level.Extent.width, baked_level.Extent.height) <= tile_size;
+	});
+	const size_t level_count = std::min(static_cast<size_t>(fit_level - baked.Level.begin()) + 1u, baked.Level.size());
+
+	vector<TiledImageLevel> level(level_count);
+	uint64_t offset = (sizeof(TiledHeader) + sizeof(TiledImageLevel) * level_count + CompressedLevelAlignment - 1u)
+		/ CompressedLevelAlignment * CompressedLevelAlignment;
+	for (const auto l : iota(size_t { 0 }, level_count)) {
+		const VkExtent2D extent = baked.Level[l].Extent,
+			tile_count = { (extent.width + tile_size - 1u) / tile_size, (extent.height + tile_size - 1u) / tile_size };
+		level[l] = {
+			.Extent = extent,
+			.TileCount = tile_count,
+			.Offset = offset
+		};
+		offset += tile_byte * tile_count.width * tile_count.height;
+	}
+	const TiledHeader header {
+		.Magic = ::TiledMagic,
+		.Version = ::TiledVersion,
+		.Format = static_cast<uint32_t>(baked.Format),
+		.Width = baked.Extent.width,
+		.Height = baked.Extent.height,
+		.TileSize = tile_size,
+		.Level = static_cast<uint32_t>(level.size()),
+		.Reserved = 0u
+	};
+
+	vector<byte> content(offset);
+	std::memcpy(content.data(), &header, sizeof(header));
+	std::memcpy(content.data() + sizeof(header), level.data(), sizeof(TiledImageLevel) * level.size());
+	for (const auto l : iota(size_t { 0 }, level.size())) {
+		const auto [extent, tile_count, level_offset] = level[l];
+		const byte* const input = baked.Pixel.data() + baked.Level[l].Offset;
+
+		//each row of tiles is written in parallel
+		const auto tile_row = iota(0u, tile_count.height);
+		std::for_each(std::execution::par, tile_row.begin(), tile_row.end(), [&](const uint32_t tile_y) {
+			for (const auto tile_x : iota(0u, tile_count.width)) {
+				byte* const tile = content.data() + level_offset + tile_byte * (static_cast<size_t>(tile_count.width) * tile_y + tile_x);
+				for (const auto row : iota(0u, tile_size)) {
+					const uint32_t y = std::min(tile_y * tile_size + row, extent.height - 1u),
+						x = tile_x * tile_size,
+						width = std::min(tile_size, extent.width - x);
+					const byte* const source = input + texel_size * (static_cast<size_t>(extent.width) * y + x);
+					byte* const destination = tile + tile_row_size * row;
+
+					std::memcpy(destination, source, texel_size * width);
+					//repeat the last texel for padding
+					for (const auto p : iota(width, tile_size)) {
+						std::memcpy(destination + texel_size * p, source + texel_size * (width - 1u), texel_size);
+					}
+				}
+			}
+		});
+	}
+	File::writeBinary(filename, content);
+}
+
+void ImageManager::bakeMipMap(ImageDecodeResult& image) {
+	auto& [extent, format, layer, level, pixel] = image;
+	if (level.size() != 1u) {
+		throw runtime_error("Mip-map can only be baked for an image with only the base level");
+	}
+	const ::PixelLayout pixel_layout = ::getPixelLayout(format);
+	const size_t texel_size = pixel_layout.Channel * pixel_layout.ChannelSize;
+
+	const auto level_count = static_cast<uint32_t>(std::bit_width(std::max(extent.width, extent.height)));
+	vector<ImageLevel> baked_level;
+	baked_level.reserve(level_count);
+	size_t total_size = 0u;
+	for (const auto l : iota(0u, level_count)) {
+		total_size = (total_size + CompressedLevelAlignment - 1u) / CompressedLevelAlignment * CompressedLevelAlignment;
+		const VkExtent2D level_extent = { std::max(extent.width >> l, 1u), std::max(extent.height >> l, 1u) };
+		baked_level.push_back({
+			.Offset = total_size,
+			.Extent = level_extent
+		});
+		total_size += texel_size * level_extent.width * level_extent.height * layer;
+	}
+
+	vector<byte> baked_pixel(total_size);
+	std::memcpy(baked_pixel.data(), pixel.data(), texel_size * extent.width * extent.height * layer);
+	for (const auto l : iota(1u, level_count)) {
+		const auto& [input_offset, input_extent] = baked_level[l - 1u];
+		const auto& [output_offset, output_extent] = baked_level[l];
+		byte* const input = baked_pixel.data() + input_offset,
+			*const output = baked_pixel.data() + output_offset;
+		if (pixel_layout.ChannelSize == 1u) {
+			::downsampleLevel(reinterpret_cast<const uint8_t*>(input), reinterpret_cast<uint8_t*>(output),
+				input_extent, output_extent, layer, pixel_layout);
+		} else {
+			::downsampleLevel(reinterpret_cast<const uint16_t*>(input), reinterpret_cast<uint16_t*>(output),
+				input_extent, output_extent, layer, pixel_layout);
+		}
+	}
+
+	level = std::move(baked_level);
+	pixel = std::move(baked_pixel);
+}
+
+bool ImageManager::requireMipMapGeneration(const ImageReadResult& read_result) noexcept {
+	return read_result.Level.size() == 1u && !ImageManager::isBlockCompressed(read_result.Format);
+}
+
+bool ImageManager::isBlockCompressed(const VkFormat format) noexcept {
+	return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
 VKO::ImageAllocation ImageManager::createImage(const ImageCreateInfo& image_info) {
 	EXPAND_IMAGE_INFO;
 
@@ -307,33 +1110,44 @@ VKO::ImageAllocation ImageManager::createImage(const ImageCreateInfo& image_info
 		.samples = sample,
 		.tiling = VK_IMAGE_TILING_OPTIMAL,
 		.usage = usage,
-		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.sharingMode = queue_family.size() > 1u ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = queue_family.size() > 1u ? static_cast<uint32_t>(queue_family.size()) : 0u,
+		.pQueueFamilyIndices = queue_family.size() > 1u ? queue_family.data() : nullptr,
 		.initialLayout = init_layout
 	};
-	return VKO::createImageFromAllocator(device, allocator, img_info, ::CommonImageAllocationInfo);
+	return VKO::createImageFromAllocator(device, allocator, img_info, ::CommonImageAllocationInfo, category);
 }
 
-VKO::ImageAllocation ImageManager::createImageFromReadResult(const VkCommandBuffer cmd, const ImageReadResult& read_result,
+VKO::ImageAllocation ImageManager::createImage(const ImageReadResult& read_result,
 	const ImageCreateFromReadResultInfo& image_read_result) {
-	const auto& [extent, format, layer, pixel] = read_result;
+	const auto [w, h] = read_result.Extent;
 	const auto [device, allocator, flag, level, usage, aspect] = image_read_result;
-	const auto [w, h] = extent;
-	const VkExtent3D extent_3d = { w, h, 1u };
 
-	VKO::ImageAllocation image = ImageManager::createImage({
+	return ImageManager::createImage({
 		.Device = device,
 		.Allocator = allocator,
+		.Category = VKO::AllocationCategory::Texture,
 
 		.Flag = flag,
 		.ImageType = VK_IMAGE_TYPE_2D,
-		.Format = format,
-		.Extent = extent_3d,
+		.Format = read_result.Format,
+		.Extent = { w, h, 1u },
 
 		.Level = level,
-		.Layer = layer,
+		.Layer = read_result.Layer,
 
 		.Usage = usage
 	});
+}
+
+VKO::ImageAllocation ImageManager::createImageFromReadResult(const VkCommandBuffer cmd, const ImageReadResult& read_result,
+	const ImageCreateFromReadResultInfo& image_read_result) {
+	const auto& [extent, format, layer, level, pixel] = read_result;
+	const VkImageAspectFlags aspect = image_read_result.Aspect;
+	const auto [w, h] = extent;
+	const VkExtent3D extent_3d = { w, h, 1u };
+
+	VKO::ImageAllocation image = ImageManager::createImage(read_result, image_read_result);
 
 	//we copy to level 0
 	PipelineBarrier<0u, 0u, 1u> barrier;
@@ -357,9 +1171,103 @@ VKO::ImageAllocation ImageManager::createImageFromReadResult(const VkCommandBuff
 	return image;
 }
 
+VKO::ImageAllocation ImageManager::createImageFromReadResult(const ImageReadResult& read_result,
+	const ImageCreateFromReadResultInfo& image_read_result, const VkImageLayout layout) {
+	const auto& [extent, format, layer, level, pixel] = read_result;
+	const VkDevice device = image_read_result.Device;
+	const VkImageAspectFlags aspect = image_read_result.Aspect;
+	const auto [w, h] = extent;
+
+	VKO::ImageAllocation image = ImageManager::createImage(read_result, image_read_result);
+
+	//the image is not yet known to any queue, so it is transitioned and copied to from the staging buffer directly
+	ImageManager::transitionImageLayoutOnHost(device, image.second, VK_IMAGE_LAYOUT_UNDEFINED, layout,
+		ImageManager::createEachLevelSubresourceRange(aspect, 0u));
+	const auto data = VKO::mapAllocation<byte>(image_read_result.Allocator, pixel.first);
+	ImageManager::copyImageFromMemory(device, image.second, {
+		.Source = data.get(),
+		.ImageExtent = { w, h, 1u },
+		.SubresourceLayers = ImageManager::createFullSubresourceLayers(aspect, 0u, layer),
+		.ImageLayout = layout
+	});
+
+	return image;
+}
+
+bool ImageManager::preferHostImageCopy(const VkPhysicalDevice gpu, const VkFormat format, const VkImageCreateFlags flag,
+	const VkImageUsageFlags usage) {
+	VkFormatProperties3 format_feature {
+		.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3
+	};
+	VkFormatProperties2 format_property {
+		.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
+		.pNext = &format_feature
+	};
+	vkGetPhysicalDeviceFormatProperties2(gpu, format, &format_property);
+	if (!(format_feature.optimalTilingFeatures & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT)) {
+		return false;
+	}
+
+	const VkPhysicalDeviceImageFormatInfo2 image_info {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2,
+		.format = format,
+		.type = VK_IMAGE_TYPE_2D,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = usage | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT,
+		.flags = flag
+	};
+	VkHostImageCopyDevicePerformanceQueryEXT performance {
+		.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT
+	};
+	VkImageFormatProperties2 image_property {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2,
+		.pNext = &performance
+	};
+	if (vkGetPhysicalDeviceImageFormatProperties2(gpu, &image_info, &image_property) != VK_SUCCESS) {
+		return false;
+	}
+	//host transfer usage may cost the device a less efficient memory layout, such as disabling compression,
+	//which is paid by every access in every frame, whereas staging is only paid once
+	return performance.optimalDeviceAccess == VK_TRUE;
+}
+
+void ImageManager::transitionImageLayoutOnHost(const VkDevice device, const VkImage image, const VkImageLayout old_layout,
+	const VkImageLayout new_layout, const VkImageSubresourceRange& sub_res_range) {
+	const VkHostImageLayoutTransitionInfoEXT transition {
+		.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT,
+		.image = image,
+		.oldLayout = old_layout,
+		.newLayout = new_layout,
+		.subresourceRange = sub_res_range
+	};
+	CHECK_VULKAN_ERROR(vkTransitionImageLayoutEXT(device, 1u, &transition));
+}
+
+void ImageManager::copyImageFromMemory(const VkDevice device, const VkImage destination, const ImageCopyFromMemoryInfo& copy_info) {
+	const auto& [source, image_offset, image_extent, memory_row_length, memory_image_height, sub_res_layer, image_layout] = copy_info;
+
+	const VkMemoryToImageCopyEXT region {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT,
+		.pHostPointer = source,
+		.memoryRowLength = memory_row_length,
+		.memoryImageHeight = memory_image_height,
+		.imageSubresource = sub_res_layer,
+		.imageOffset = image_offset,
+		.imageExtent = image_extent
+	};
+	const VkCopyMemoryToImageInfoEXT mem_to_img {
+		.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT,
+		.dstImage = destination,
+		.dstImageLayout = image_layout,
+		.regionCount = 1u,
+		.pRegions = &region
+	};
+	CHECK_VULKAN_ERROR(vkCopyMemoryToImageEXT(device, &mem_to_img));
+}
+
 void ImageManager::recordCopyImageFromBuffer(const VkCommandBuffer cmd, const VkBuffer source, const VkImage destination,
 	const ImageCopyFromBufferInfo& copy_info) {
-	const auto& [buffer_offset, image_offset, image_extent, buffer_row_length, buffer_image_height, sub_res_layer] = copy_info;
+	const auto& [buffer_offset, image_offset, image_extent, buffer_row_length, buffer_image_height, sub_res_layer, image_layout] = copy_info;
 
 	const VkBufferImageCopy2 region {
 		.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2,
@@ -374,7 +1282,7 @@ void ImageManager::recordCopyImageFromBuffer(const VkCommandBuffer cmd, const Vk
 		.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2,
 		.srcBuffer = source,
 		.dstImage = destination,
-		.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.dstImageLayout = image_layout,
 		.regionCount = 1u,
 		.pRegions = &region
 	};
@@ -506,13 +1414,15 @@ VkImageSubresourceRange ImageManager::createEachLayerEachLevelSubresourceRange(c
 }
 
 VKO::ImageView ImageManager::createFullImageView(const ImageViewCreateInfo& iv_info) {
-	return VKO::createImageView(iv_info.Device, ::createCommonImageViewInfo(iv_info,
+	const VkImageViewUsageCreateInfo usage_info = ::createImageViewUsageInfo(iv_info);
+	return VKO::createImageView(iv_info.Device, ::createCommonImageViewInfo(iv_info, usage_info,
 		ImageManager::createFullSubresourceRange(iv_info.Aspect)));
 }
 
 void ImageManager::createEachLayerImageView(const ImageViewCreateInfo& iv_info, const span<VKO::ImageView> output) {
-	transform(iota(size_t { 0 }, output.size()), output.begin(), [&iv_info](const auto i) {
-		return VKO::createImageView(iv_info.Device, ::createCommonImageViewInfo(iv_info,
+	const VkImageViewUsageCreateInfo usage_info = ::createImageViewUsageInfo(iv_info);
+	transform(iota(size_t { 0 }, output.size()), output.begin(), [&iv_info, &usage_info](const auto i) {
+		return VKO::createImageView(iv_info.Device, ::createCommonImageViewInfo(iv_info, usage_info,
 			ImageManager::createEachLayerSubresourceRange(iv_info.Aspect, static_cast<uint32_t>(i))));
 	});
 }
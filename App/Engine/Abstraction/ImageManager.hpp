@@ -2,10 +2,15 @@
 
 #include "BufferManager.hpp"
 
+#include "../../Common/File.hpp"
 #include "../../Common/VulkanObject.hpp"
 
 #include <array>
+#include <vector>
 #include <span>
+#include <future>
+
+#include <cstddef>
 #include <cstdint>
 
 namespace LearnVulkan {
@@ -29,6 +34,25 @@ namespace LearnVulkan {
 		
 			int Channel;/**< The number of channel to be loaded from the file. */
 			ImageColourSpace ColourSpace;
+			/**
+			 * If not null and the file exists, this pre-compressed KTX2 or DDS file is read instead,
+			 * and the images from the array of filename are ignored.
+			 * The file must contain all layers, and may contain mip-maps. The number of channel is ignored.
+			 * Supported formats are BC1, BC3, BC4, BC5, BC6H and BC7, and colour space is applied regardless of the file format.
+			*/
+			const char* CompressedFilename = nullptr;
+			//Store 16-bit pixels as half-float rather than unsigned normalised, ignored by 8-bit images and pre-compressed files.
+			bool HalfFloat = false;
+
+		};
+
+		/**
+		 * @brief The memory layout of a mip level in the pixel data, each level contains all layers laid out contiguously.
+		*/
+		struct ImageLevel {
+
+			VkDeviceSize Offset;/**< In byte, from the beginning of the pixel data. */
+			VkExtent2D Extent;
 
 		};
 
@@ -37,15 +61,32 @@ namespace LearnVulkan {
 			VkExtent2D Extent;
 			VkFormat Format;
 			uint32_t Layer;
+			std::vector<ImageLevel> Level;/**< Mip levels in the pixel data, starting from the base level. */
 
-			VulkanObject::BufferAllocation Pixel;/**< Staging buffer, can be used to copy to an image straight away. */
+			//Staging buffer, can be used to copy to an image straight away, by either the device or the host.
+			VulkanObject::BufferAllocation Pixel;
 		
 		};
 
+		/**
+		 * @brief Image pixels decoded to host memory, which does not require a device.
+		*/
+		struct ImageDecodeResult {
+
+			VkExtent2D Extent;
+			VkFormat Format;
+			uint32_t Layer;
+			std::vector<ImageLevel> Level;/**< Mip levels in the pixel data, starting from the base level. */
+
+			std::vector<std::byte> Pixel;/**< Pixels of every layer laid out contiguously. */
+
+		};
+
 		struct ImageCreateInfo {
 
 			VkDevice Device;
 			VmaAllocator Allocator;
+			VulkanObject::AllocationCategory Category;
 
 			VkImageCreateFlags Flag;
 			VkImageType ImageType;
@@ -57,6 +98,8 @@ namespace LearnVulkan {
 
 			VkImageUsageFlags Usage;
 			VkImageLayout InitialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			//Distinct queue families the image is shared concurrently by, or empty for exclusive access.
+			std::span<const uint32_t> QueueFamily = { };
 
 		};
 
@@ -83,6 +126,23 @@ namespace LearnVulkan {
 				BufferImageHeight = 0u;
 
 			VkImageSubresourceLayers SubresourceLayers;
+			//Either transfer destination optimal or general.
+			VkImageLayout ImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+		};
+
+		struct ImageCopyFromMemoryInfo {
+
+			const void* Source;/**< Host memory where the copied data start from. */
+			VkOffset3D ImageOffset = { 0, 0, 0 };
+			VkExtent3D ImageExtent;
+
+			uint32_t MemoryRowLength = 0u,
+				MemoryImageHeight = 0u;
+
+			VkImageSubresourceLayers SubresourceLayers;
+			//One of the layouts the device supports as a destination of host image copy.
+			VkImageLayout ImageLayout;
 
 		};
 
@@ -145,9 +205,90 @@ namespace LearnVulkan {
 			};
 
 			VkImageAspectFlags Aspect;
+			//Restrict usage of the view to a subset of usage of the image, or zero to inherit all of them.
+			//This is required if the image allows usage not supported by the view format.
+			VkImageUsageFlags Usage = 0u;
 		
 		};
 
+		/**
+		 * @brief The memory layout of a level in an engine-native tiled image file.
+		*/
+		struct TiledImageLevel {
+
+			VkExtent2D Extent, TileCount;
+			uint64_t Offset;/**< In byte, from the beginning of the file to the first tile. */
+
+		};
+
+		/**
+		 * @brief An engine-native tiled image file, which is memory-mapped and read one tile at a time on demand.
+		 * Every level is divided into square tiles of the same size stored contiguously and laid out row by row,
+		 * tiles on the right and bottom edge are padded by repeating the last texel of the level.
+		 * Reading tiles is thread-safe.
+		*/
+		class TiledImageFile {
+		private:
+
+			const File::MappedFile Mapping;
+
+			VkFormat Format;
+			uint32_t TileSize;/**< In texel. */
+			VkDeviceSize TileByte;
+			std::vector<TiledImageLevel> Level;/**< Starting from the base level. */
+
+		public:
+
+			/**
+			 * @brief Open a tiled image file.
+			 * @param filename The tiled image file.
+			 * @exception If the file is not a valid tiled image file.
+			*/
+			explicit TiledImageFile(const char*);
+
+			TiledImageFile(const TiledImageFile&) = delete;
+
+			TiledImageFile(TiledImageFile&&) = delete;
+
+			TiledImageFile& operator=(const TiledImageFile&) = delete;
+
+			TiledImageFile& operator=(TiledImageFile&&) = delete;
+
+			~TiledImageFile() = default;
+
+			VkFormat format() const noexcept;
+
+			/**
+			 * @brief Get the width (and height) of a tile in texel.
+			*/
+			uint32_t tileSize() const noexcept;
+
+			/**
+			 * @brief Get the size of a tile in byte.
+			*/
+			VkDeviceSize tileByte() const noexcept;
+
+			std::span<const TiledImageLevel> level() const noexcept;
+
+			/**
+			 * @brief Get the pixels of a tile, which remain valid until the file is closed.
+			 * @param level The level of tile.
+			 * @param x, y The tile coordinate in the level.
+			 * @return The pixels of the tile laid out row by row.
+			*/
+			std::span<const std::byte> tile(uint32_t, uint32_t, uint32_t) const noexcept;
+
+			/**
+			 * @brief Assemble every tile of a level into a staging buffer, with padding removed.
+			 * @param device The device.
+			 * @param allocator The allocator.
+			 * @param level The level to be read.
+			 * @return The read result with only one layer and one level.
+			*/
+			ImageReadResult readLevel(VkDevice, VmaAllocator, uint32_t) const;
+
+		};
+
 		namespace _Internal {
 		
 			//Provide the memory for the blit info structure.
@@ -170,6 +311,103 @@ namespace LearnVulkan {
 		template<ImageBitWidth BitWidth>
 		ImageReadResult readFile(VkDevice, VmaAllocator, std::span<const char* const>, const ImageReadInfo&);
 
+		/**
+		 * @brief Copy pixels decoded in host memory to a staging buffer.
+		 * @param device The device.
+		 * @param allocator The allocator.
+		 * @param decode_result The decoded image.
+		 * @return The resulting data containing the image pixels.
+		*/
+		ImageReadResult readFile(VkDevice, VmaAllocator, const ImageDecodeResult&);
+
+		/**
+		 * @brief Decode an image from a file to host memory.
+		 * Like reading image from a file, all images are decoded in parallel.
+		 * @tparam BitWidth Specify the bit width of pixel of image to be decoded.
+		 * @param filename An array of filename about the images.
+		 * @param img_read_info Additional information to read the image.
+		 * @return The decoded image.
+		 * @see readFile
+		*/
+		template<ImageBitWidth BitWidth>
+		ImageDecodeResult decodeFile(std::span<const char* const>, const ImageReadInfo&);
+
+		/**
+		 * @brief Decode an image from a file to host memory on a new thread.
+		 * This allows decoding to be overlapped with other work, such as device creation and shader compilation.
+		 * @tparam BitWidth Specify the bit width of pixel of image to be decoded.
+		 * @param filename An array of filename about the images.
+		 * Only the array is copied, so the memory of each filename must remain valid until decoding completes.
+		 * @param img_read_info Additional information to read the image.
+		 * @return The future decoded image. Any error during decoding is rethrown when getting the result.
+		 * @see decodeFile
+		*/
+		template<ImageBitWidth BitWidth>
+		std::future<ImageDecodeResult> decodeFileAsync(std::span<const char* const>, const ImageReadInfo&);
+
+		/**
+		 * @brief Read an image from an engine-native image container file.
+		 * The file is memory-mapped and its pixels are copied straight into the staging buffer without any decoding.
+		 * @param device The device.
+		 * @param allocator The allocator.
+		 * @param filename The container file.
+		 * @return The resulting data containing the image pixels of every level stored in the file.
+		 * @exception If the file is not a valid image container.
+		*/
+		ImageReadResult readContainerFile(VkDevice, VmaAllocator, const char*);
+
+		/**
+		 * @brief Write a decoded image to an engine-native image container file.
+		 * @param filename The container file, existing content is replaced.
+		 * @param image The decoded image, with all its levels.
+		 * @exception If the file cannot be written.
+		*/
+		void writeContainerFile(const char*, const ImageDecodeResult&);
+
+		/**
+		 * @brief Check if an image container file exists and is not older than any of its source file.
+		 * @param filename The container file.
+		 * @param source All source files the container was baked from. Source files that do not exist are ignored.
+		 * @return True if the container can be used in place of its source files.
+		*/
+		bool isContainerFileUpToDate(const char*, std::span<const char* const>);
+
+		/**
+		 * @brief Write a decoded image to an engine-native tiled image file, with a mip chain baked on the host.
+		 * Levels are baked until a level fits in one tile.
+		 * Whether a tiled image file is up to date can be checked the same as an image container.
+		 * @param filename The tiled image file, existing content is replaced.
+		 * @param image The decoded image with only one layer and the base level.
+		 * @param tile_size The width (and height) of a tile in texel.
+		 * @exception If the image is not supported by mip-map baking, or the file cannot be written.
+		 * @see bakeMipMap
+		*/
+		void writeTiledFile(const char*, const ImageDecodeResult&, uint32_t);
+
+		/**
+		 * @brief Generate a full mip chain on the host for a decoded image using a box filter.
+		 * Colour channels of sRGB images are filtered in linear space.
+		 * @param image The decoded image with only the base level, whose levels are replaced by a full mip chain.
+		 * @exception If the image has more than one level, or its format is not supported, such as block-compressed format.
+		*/
+		void bakeMipMap(ImageDecodeResult&);
+
+		/**
+		 * @brief Check if mip-maps of an image read result need to be generated at runtime.
+		 * @param read_result The read result.
+		 * @return True if the read result only has the base level and it supports being a blit destination.
+		 * Otherwise, mip-maps should be taken from the levels of the read result.
+		*/
+		bool requireMipMapGeneration(const ImageReadResult&) noexcept;
+
+		/**
+		 * @brief Check if an image format is block-compressed.
+		 * Block-compressed image cannot be used as blit destination, so mip-maps must be provided with the image data.
+		 * @param format The image format.
+		 * @return True if the format is block-compressed.
+		*/
+		bool isBlockCompressed(VkFormat) noexcept;
+
 		/**
 		 * @brief Create an image.
 		 * @param image_info The image creation info.
@@ -177,6 +415,15 @@ namespace LearnVulkan {
 		*/
 		VulkanObject::ImageAllocation createImage(const ImageCreateInfo&);
 
+		/**
+		 * @brief Create an image whose dimension and format match a read result, without filling any data.
+		 * The image is categorised as texture memory.
+		 * @param read_result The read result.
+		 * @param image_read_result The information regarding how to create such image.
+		 * @return The created image.
+		*/
+		VulkanObject::ImageAllocation createImage(const ImageReadResult&, const ImageCreateFromReadResultInfo&);
+
 		/**
 		 * @brief Create an image with data filled from a read result.
 		 * @param cmd Command buffer to record command to copy the image from the read result.
@@ -187,9 +434,51 @@ namespace LearnVulkan {
 		*/
 		VulkanObject::ImageAllocation createImageFromReadResult(VkCommandBuffer, const ImageReadResult&, const ImageCreateFromReadResultInfo&);
 
+		/**
+		 * @brief Create an image with data filled from a read result by the host, without recording any command.
+		 * The image is ready to be used by any queue once it is returned, and later submissions see the copied data.
+		 * @param read_result The read result.
+		 * @param image_read_result The information regarding how to create such image.
+		 * The usage must include host transfer usage.
+		 * @param layout The layout of the first level of the image after it is filled,
+		 * which must be supported as a destination of host image copy.
+		 * @return The created image with the first level of each layer filled with data.
+		*/
+		VulkanObject::ImageAllocation createImageFromReadResult(const ImageReadResult&, const ImageCreateFromReadResultInfo&, VkImageLayout);
+
+		/**
+		 * @brief Check if an image should be copied to by the host rather than through a staging buffer.
+		 * The device must have host image copy enabled.
+		 * @param gpu The physical device.
+		 * @param format The format of the image.
+		 * @param flag The create flags of the 2D image with optimal tiling.
+		 * @param usage The usage of the image, excluding host transfer usage.
+		 * @return True if the host can copy to the image, and doing so does not degrade device access performance to it.
+		*/
+		bool preferHostImageCopy(VkPhysicalDevice, VkFormat, VkImageCreateFlags, VkImageUsageFlags);
+
+		/**
+		 * @brief Transition the layout of an image on the host, the image must not be accessed by the device meanwhile.
+		 * @param device The device.
+		 * @param image The image created with host transfer usage.
+		 * @param old_layout The current layout, or undefined to discard the content.
+		 * @param new_layout The new layout, which must be supported as a destination of host image copy.
+		 * @param sub_res_range The subresources to be transitioned.
+		*/
+		void transitionImageLayoutOnHost(VkDevice, VkImage, VkImageLayout, VkImageLayout, const VkImageSubresourceRange&);
+
+		/**
+		 * @brief Copy data from host memory to image on the host, the copied subresources must not be accessed by the device meanwhile.
+		 * It returns once the copy is finished, and copies to distinct subresources may run on different threads.
+		 * @param device The device.
+		 * @param destination The destination image created with host transfer usage.
+		 * @param copy_info The information regarding the copy.
+		*/
+		void copyImageFromMemory(VkDevice, VkImage, const ImageCopyFromMemoryInfo&);
+
 		/**
 		 * @brief Record command to copy data from a buffer to image.
-		 * After the copy, the image will have transfer destination optimal layout.
+		 * The image must be in the layout specified by the copy info.
 		 * @param cmd The command buffer.
 		 * @param source The source buffer.
 		 * @param destination The destination image.
@@ -1,8 +1,27 @@
 #include "PipelineManager.hpp"
 
+#include "../../Common/ErrorHandler.hpp"
+#include "../../Common/File.hpp"
+#include "../../Common/FixedArray.hpp"
+#include "../../Common/Hash.hpp"
+
 #include <array>
+#include <vector>
+#include <string_view>
+#include <algorithm>
+#include <memory>
+#include <future>
+#include <atomic>
+
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
 
-using std::array;
+using std::array, std::vector, std::span, std::string_view;
+using std::byte;
+using std::ostream, std::endl;
+using std::runtime_error;
+using std::ranges::copy;
 
 using namespace LearnVulkan;
 namespace VKO = VulkanObject;
@@ -17,127 +36,417 @@ namespace {
 		;
 	}
 
-}
+	/**
+	 * @brief Prepended to the pipeline cache data in the file.
+	 * The header of pipeline cache data defined by Vulkan does not include driver version,
+	 * so the identity of the device is recorded separately.
+	*/
+	struct PipelineCacheFileHeader {
 
-VKO::Pipeline PipelineManager::createSimpleGraphicsPipeline(const VkDevice device, const VkPipelineLayout layout,
-	const SimpleGraphicsPipelineCreateInfo& graphics_info) {
-	const auto& [shader_stage, vertex_input_state, rendering,
-		primitive_topo, cull_move, front_face, sample, min_sample_shading, depth, blend_state, allow_feedback_loop] = graphics_info;
-	const auto [depth_write, depth_compare] = depth;
-	const auto [colour_fbl, depth_fbl] = allow_feedback_loop;
-
-	/////////////////////
-	/// Vertex attribute
-	/////////////////////
-	constexpr static VkPipelineVertexInputStateCreateInfo attribute_less {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO
-	};
+		struct DeviceIdentity {
+
+			uint32_t VendorID, DeviceID, DriverVersion;
+			array<uint8_t, VK_UUID_SIZE> PipelineCacheUUID;
+
+			constexpr bool operator==(const DeviceIdentity&) const noexcept = default;
+
+		} Identity;
+		uint64_t DataSize;/**< In byte, the size of pipeline cache data following the header. */
 
-	///////////////////////
-	/// Input assembly
-	//////////////////////
-	const VkPipelineInputAssemblyStateCreateInfo input_assembly {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-		.topology = primitive_topo,
-		.primitiveRestartEnable = VK_FALSE
 	};
 
-	//////////////////
-	/// Tessellation
-	/////////////////
-	constexpr static VkPipelineTessellationStateCreateInfo tess {
+	PipelineCacheFileHeader::DeviceIdentity getDeviceIdentity(const VkPhysicalDevice gpu) noexcept {
+		VkPhysicalDeviceProperties prop;
+		vkGetPhysicalDeviceProperties(gpu, &prop);
+
+		PipelineCacheFileHeader::DeviceIdentity identity {
+			.VendorID = prop.vendorID,
+			.DeviceID = prop.deviceID,
+			.DriverVersion = prop.driverVersion
+		};
+		copy(prop.pipelineCacheUUID, identity.PipelineCacheUUID.begin());
+		return identity;
+	}
+
+	//Returns an empty span if the file content is not a valid pipeline cache for the device.
+	span<const byte> validatePipelineCacheFile(const span<const byte> content,
+		const PipelineCacheFileHeader::DeviceIdentity& identity) noexcept {
+		PipelineCacheFileHeader header;
+		if (content.size() < sizeof(header)) {
+			return { };
+		}
+		std::memcpy(&header, content.data(), sizeof(header));
+
+		const span<const byte> data = content.subspan(sizeof(header));
+		if (header.Identity != identity || header.DataSize != data.size()) {
+			return { };
+		}
+		return data;
+	}
+
+	/*********************************
+	 * Simple graphics pipeline state
+	 ********************************/
+	constexpr VkPipelineVertexInputStateCreateInfo AttributeLessVertexInput {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO
+	};
+	constexpr VkPipelineTessellationStateCreateInfo SimpleTessellation {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO,
 		.patchControlPoints = 3u
 	};
-
-	////////////////
-	/// Viewport
-	////////////////
-	constexpr static VkPipelineViewportStateCreateInfo vp {
+	constexpr VkPipelineViewportStateCreateInfo SimpleViewport {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
 		.viewportCount = 1u,
 		.scissorCount = 1u
 	};
-
-	////////////////////
-	/// Rasterisation
-	////////////////////
-	const VkPipelineRasterizationStateCreateInfo rasterisation {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-		.polygonMode = VK_POLYGON_MODE_FILL,
-		.cullMode = cull_move,
-		.frontFace = front_face,
-		.lineWidth = 1.0f
-	};
-
-	////////////////////
-	/// Multi-sampling
-	////////////////////
-	const VkPipelineMultisampleStateCreateInfo ms {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-		.rasterizationSamples = sample,
-		.sampleShadingEnable = min_sample_shading ? VK_TRUE : VK_FALSE,
-		.minSampleShading = min_sample_shading.value_or(0.0f)
-	};
-
-	////////////////////
-	/// Fragment test
-	///////////////////
-	const VkPipelineDepthStencilStateCreateInfo depth_stencil {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-		.depthTestEnable = VK_TRUE,
-		.depthWriteEnable = depth_write ? VK_TRUE : VK_FALSE,
-		.depthCompareOp = static_cast<VkCompareOp>(depth_compare)
-	};
-
-	//////////////////////
-	/// Blending
-	/////////////////////
-	const bool custom_blending = !blend_state.empty();
-	constexpr static VkPipelineColorBlendAttachmentState atm_blend {
+	constexpr VkPipelineColorBlendAttachmentState NoBlendAttachment {
 		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
 	};
-	const VkPipelineColorBlendStateCreateInfo blending {
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-		.attachmentCount = custom_blending ? static_cast<uint32_t>(blend_state.size()) : 1u,
-		.pAttachments = custom_blending ? blend_state.data() : &atm_blend
-	};
-
-	///////////////////
-	/// Dynamic state
-	///////////////////
-	constexpr static auto dynamic_state = array {
+	constexpr auto SimpleDynamicState = array {
 		VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR
 	};
-	constexpr static VkPipelineDynamicStateCreateInfo dynamic_state_info {
+	constexpr VkPipelineDynamicStateCreateInfo SimpleDynamicStateInfo {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-		.dynamicStateCount = static_cast<uint32_t>(dynamic_state.size()),
-		.pDynamicStates = dynamic_state.data()
+		.dynamicStateCount = static_cast<uint32_t>(SimpleDynamicState.size()),
+		.pDynamicStates = SimpleDynamicState.data()
+	};
+
+	//All fixed-function states of a simple graphics pipeline.
+	struct SimpleGraphicsPipelineState {
+
+		VkPipelineCreateFlags Flag;
+
+		const VkPipelineVertexInputStateCreateInfo* VertexInput;
+		VkPipelineInputAssemblyStateCreateInfo InputAssembly;
+		VkPipelineRasterizationStateCreateInfo Rasterisation;
+		VkPipelineMultisampleStateCreateInfo Multisample;
+		VkPipelineDepthStencilStateCreateInfo DepthStencil;
+		VkPipelineColorBlendStateCreateInfo Blending;
+
 	};
 
-	VkPipelineCreateFlags pipeline_flag = getCommonPipelineFlag();
-	if (colour_fbl) {
-		pipeline_flag |= VK_PIPELINE_CREATE_COLOR_ATTACHMENT_FEEDBACK_LOOP_BIT_EXT;
+	SimpleGraphicsPipelineState createSimpleGraphicsPipelineState(
+		const PipelineManager::SimpleGraphicsPipelineCreateInfo& graphics_info) noexcept {
+		const auto& [shader_stage, vertex_input_state, rendering,
+			primitive_topo, cull_move, front_face, sample, min_sample_shading, depth, blend_state, allow_feedback_loop] = graphics_info;
+		const auto [depth_write, depth_compare] = depth;
+		const auto [colour_fbl, depth_fbl] = allow_feedback_loop;
+
+		VkPipelineCreateFlags pipeline_flag = getCommonPipelineFlag();
+		if (colour_fbl) {
+			pipeline_flag |= VK_PIPELINE_CREATE_COLOR_ATTACHMENT_FEEDBACK_LOOP_BIT_EXT;
+		}
+		if (depth_fbl) {
+			pipeline_flag |= VK_PIPELINE_CREATE_DEPTH_STENCIL_ATTACHMENT_FEEDBACK_LOOP_BIT_EXT;
+		}
+
+		const bool custom_blending = !blend_state.empty();
+		return {
+			.Flag = pipeline_flag,
+			.VertexInput = vertex_input_state ? vertex_input_state : &::AttributeLessVertexInput,
+			.InputAssembly = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+				.topology = primitive_topo,
+				.primitiveRestartEnable = VK_FALSE
+			},
+			.Rasterisation = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+				.polygonMode = VK_POLYGON_MODE_FILL,
+				.cullMode = cull_move,
+				.frontFace = front_face,
+				.lineWidth = 1.0f
+			},
+			.Multisample = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+				.rasterizationSamples = sample,
+				.sampleShadingEnable = min_sample_shading ? VK_TRUE : VK_FALSE,
+				.minSampleShading = min_sample_shading.value_or(0.0f)
+			},
+			.DepthStencil = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+				.depthTestEnable = VK_TRUE,
+				.depthWriteEnable = depth_write ? VK_TRUE : VK_FALSE,
+				.depthCompareOp = static_cast<VkCompareOp>(depth_compare)
+			},
+			.Blending = {
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+				.attachmentCount = custom_blending ? static_cast<uint32_t>(blend_state.size()) : 1u,
+				.pAttachments = custom_blending ? blend_state.data() : &::NoBlendAttachment
+			}
+		};
 	}
-	if (depth_fbl) {
-		pipeline_flag |= VK_PIPELINE_CREATE_DEPTH_STENCIL_ATTACHMENT_FEEDBACK_LOOP_BIT_EXT;
+
+	/*****************************
+	 * Graphics pipeline library
+	 ****************************/
+	//Shader module handles may be reused once destroyed, so a shader must be inlined as module create info to be identified by its code.
+	void hashShaderStage(Hash& hash, const VkPipelineShaderStageCreateInfo& stage) {
+		const auto* const sm_info = static_cast<const VkShaderModuleCreateInfo*>(stage.pNext);
+		if (stage.module != VK_NULL_HANDLE || !sm_info || sm_info->sType != VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO) {
+			throw runtime_error("Shader stage of a pipeline library must be given inline as shader module create info.");
+		}
+		hash.update(stage.stage);
+		hash.update(string_view(stage.pName));
+		hash.update(span(reinterpret_cast<const byte*>(sm_info->pCode), sm_info->codeSize));
+		if (const VkSpecializationInfo* const spec = stage.pSpecializationInfo; spec) {
+			hash.update(std::as_bytes(span(spec->pMapEntries, spec->mapEntryCount)));
+			hash.update(span(static_cast<const byte*>(spec->pData), spec->dataSize));
+		}
+	}
+
+	void hashMultisample(Hash& hash, const VkPipelineMultisampleStateCreateInfo& ms) noexcept {
+		hash.update(ms.rasterizationSamples);
+		hash.update(ms.sampleShadingEnable);
+		hash.update(ms.minSampleShading);
 	}
 
-	return VKO::createGraphicsPipeline(device, VK_NULL_HANDLE, {
+}
+
+VKO::Pipeline PipelineManager::createSimpleGraphicsPipeline(const VkDevice device, const VkPipelineCache cache,
+	const VkPipelineLayout layout, const SimpleGraphicsPipelineCreateInfo& graphics_info) {
+	const SimpleGraphicsPipelineState state = ::createSimpleGraphicsPipelineState(graphics_info);
+	return VKO::createGraphicsPipeline(device, cache, {
 		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-		.pNext = rendering,
-		.flags = pipeline_flag,
-		.stageCount = static_cast<uint32_t>(shader_stage.size()),
-		.pStages = shader_stage.data(),
-		.pVertexInputState = vertex_input_state ? vertex_input_state : &attribute_less,
-		.pInputAssemblyState = &input_assembly,
-		.pTessellationState = &tess,
-		.pViewportState = &vp,
-		.pRasterizationState = &rasterisation,
-		.pMultisampleState = &ms,
-		.pDepthStencilState = &depth_stencil,
-		.pColorBlendState = &blending,
-		.pDynamicState = &dynamic_state_info,
+		.pNext = graphics_info.Rendering,
+		.flags = state.Flag,
+		.stageCount = static_cast<uint32_t>(graphics_info.ShaderStage.size()),
+		.pStages = graphics_info.ShaderStage.data(),
+		.pVertexInputState = state.VertexInput,
+		.pInputAssemblyState = &state.InputAssembly,
+		.pTessellationState = &::SimpleTessellation,
+		.pViewportState = &::SimpleViewport,
+		.pRasterizationState = &state.Rasterisation,
+		.pMultisampleState = &state.Multisample,
+		.pDepthStencilState = &state.DepthStencil,
+		.pColorBlendState = &state.Blending,
+		.pDynamicState = &::SimpleDynamicStateInfo,
 		.layout = layout
 	});
+}
+
+VkPipeline PipelineManager::GraphicsPipelineLibrary::LinkedPipeline::get() const noexcept {
+	if (this->Optimising) {
+		//pairs with the release store by the background compilation, such that the pipeline is fully created
+		if (const VkPipeline optimised = this->Optimising->Handle.load(std::memory_order_acquire);
+			optimised != VK_NULL_HANDLE) {
+			return optimised;
+		}
+	}
+	return *this->FastLinked;
+}
+
+PipelineManager::GraphicsPipelineLibrary::GraphicsPipelineLibrary(const VulkanContext& ctx, const bool background_optimisation) :
+	Device(ctx.Device), Cache(ctx.PipelineCache), BackgroundOptimisation(background_optimisation) {
+
+}
+
+VkPipeline PipelineManager::GraphicsPipelineLibrary::getLibrary(const uint64_t key,
+	const VkGraphicsPipelineLibraryFlagsEXT part, VkGraphicsPipelineCreateInfo pipeline_info) {
+	if (const auto it = this->Library.find(key); it != this->Library.cend()) {
+		return it->second;
+	}
+
+	const VkGraphicsPipelineLibraryCreateInfoEXT library_info {
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+		.pNext = pipeline_info.pNext,
+		.flags = part
+	};
+	pipeline_info.pNext = &library_info;
+	pipeline_info.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+
+	return this->Library.emplace(key, VKO::createGraphicsPipeline(this->Device, this->Cache, pipeline_info)).first->second;
+}
+
+PipelineManager::GraphicsPipelineLibrary::LinkedPipeline PipelineManager::GraphicsPipelineLibrary::createPipeline(
+	const VkPipelineLayout layout, const SimpleGraphicsPipelineCreateInfo& graphics_info) {
+	const SimpleGraphicsPipelineState state = ::createSimpleGraphicsPipelineState(graphics_info);
+	const VkPipelineRenderingCreateInfo& rendering = *graphics_info.Rendering;
+
+	FixedArray<VkPipelineShaderStageCreateInfo, 4u> pre_rasterisation_stage;
+	FixedArray<VkPipelineShaderStageCreateInfo, 1u> fragment_stage;
+	bool mesh_shading = false;
+	for (const auto& stage : graphics_info.ShaderStage) {
+		if (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT) {
+			fragment_stage.pushBack(stage);
+		} else {
+			pre_rasterisation_stage.pushBack(stage);
+			mesh_shading |= stage.stage == VK_SHADER_STAGE_MESH_BIT_EXT;
+		}
+	}
+
+	//every part shares the same flags, and flags also distinguish libraries of the same state
+	Hash common_hash;
+	common_hash.update(state.Flag);
+	FixedArray<VkPipeline, 4u> library;
+
+	/********************
+	 * Vertex input
+	 *******************/
+	//mesh shading pipeline has no vertex input
+	if (!mesh_shading) {
+		Hash hash = common_hash;
+		hash.update(VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT);
+		const VkPipelineVertexInputStateCreateInfo& vertex_input = *state.VertexInput;
+		hash.update(std::as_bytes(span(vertex_input.pVertexBindingDescriptions, vertex_input.vertexBindingDescriptionCount)));
+		hash.update(std::as_bytes(span(vertex_input.pVertexAttributeDescriptions, vertex_input.vertexAttributeDescriptionCount)));
+		hash.update(state.InputAssembly.topology);
+
+		library.pushBack(this->getLibrary(hash.value(), VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT, {
+			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+			.flags = state.Flag,
+			.pVertexInputState = state.VertexInput,
+			.pInputAssemblyState = &state.InputAssembly
+		}));
+	}
+	/***********************
+	 * Pre-rasterisation
+	 **********************/
+	{
+		Hash hash = common_hash;
+		hash.update(VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT);
+		hash.update(layout);
+		for (const auto& stage : span(pre_rasterisation_stage.data(), pre_rasterisation_stage.size())) {
+			::hashShaderStage(hash, stage);
+		}
+		hash.update(state.Rasterisation.cullMode);
+		hash.update(state.Rasterisation.frontFace);
+		hash.update(rendering.viewMask);
+
+		library.pushBack(this->getLibrary(hash.value(), VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT, {
+			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+			.pNext = &rendering,
+			.flags = state.Flag,
+			.stageCount = static_cast<uint32_t>(pre_rasterisation_stage.size()),
+			.pStages = pre_rasterisation_stage.data(),
+			.pTessellationState = &::SimpleTessellation,
+			.pViewportState = &::SimpleViewport,
+			.pRasterizationState = &state.Rasterisation,
+			.pDynamicState = &::SimpleDynamicStateInfo,
+			.layout = layout
+		}));
+	}
+	/*********************
+	 * Fragment shader
+	 ********************/
+	{
+		Hash hash = common_hash;
+		hash.update(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+		hash.update(layout);
+		for (const auto& stage : span(fragment_stage.data(), fragment_stage.size())) {
+			::hashShaderStage(hash, stage);
+		}
+		::hashMultisample(hash, state.Multisample);
+		hash.update(state.DepthStencil.depthWriteEnable);
+		hash.update(state.DepthStencil.depthCompareOp);
+		hash.update(rendering.viewMask);
+
+		library.pushBack(this->getLibrary(hash.value(), VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT, {
+			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+			.pNext = &rendering,
+			.flags = state.Flag,
+			.stageCount = static_cast<uint32_t>(fragment_stage.size()),
+			.pStages = fragment_stage.data(),
+			.pMultisampleState = &state.Multisample,
+			.pDepthStencilState = &state.DepthStencil,
+			.layout = layout
+		}));
+	}
+	/**********************
+	 * Fragment output
+	 *********************/
+	{
+		Hash hash = common_hash;
+		hash.update(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT);
+		::hashMultisample(hash, state.Multisample);
+		hash.update(std::as_bytes(span(state.Blending.pAttachments, state.Blending.attachmentCount)));
+		hash.update(rendering.viewMask);
+		hash.update(std::as_bytes(span(rendering.pColorAttachmentFormats, rendering.colorAttachmentCount)));
+		hash.update(rendering.depthAttachmentFormat);
+		hash.update(rendering.stencilAttachmentFormat);
+
+		library.pushBack(this->getLibrary(hash.value(), VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT, {
+			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+			.pNext = &rendering,
+			.flags = state.Flag,
+			.pMultisampleState = &state.Multisample,
+			.pColorBlendState = &state.Blending
+		}));
+	}
+
+	/**************
+	 * Linking
+	 *************/
+	const auto link = [device = this->Device, cache = this->Cache, layout, flag = state.Flag, library](
+		const VkPipelineCreateFlags link_flag) -> VKO::Pipeline {
+		const VkPipelineLibraryCreateInfoKHR library_info {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+			.libraryCount = static_cast<uint32_t>(library.size()),
+			.pLibraries = library.data()
+		};
+		return VKO::createGraphicsPipeline(device, cache, {
+			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+			.pNext = &library_info,
+			.flags = flag | link_flag,
+			.layout = layout
+		});
+	};
+
+	LinkedPipeline pipeline;
+	pipeline.FastLinked = link(0u);
+	if (this->BackgroundOptimisation) {
+		pipeline.Optimising = std::make_unique<LinkedPipeline::Optimisation>();
+		LinkedPipeline::Optimisation& optimisation = *pipeline.Optimising;
+		optimisation.Compilation = std::async(std::launch::async, [&optimisation, link]() noexcept {
+			try {
+				optimisation.Pipeline = link(VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT);
+				optimisation.Handle.store(*optimisation.Pipeline, std::memory_order_release);
+			} catch (const std::exception&) {
+				//optimisation is only a bonus, keep using the fast-linked pipeline
+			}
+		});
+	}
+	return pipeline;
+}
+
+size_t PipelineManager::GraphicsPipelineLibrary::libraryCount() const noexcept {
+	return this->Library.size();
+}
+
+VKO::PipelineCache PipelineManager::loadPipelineCache(const VkDevice device, const VkPhysicalDevice gpu,
+	const char* const filename, ostream& msg) {
+	vector<byte> content;
+	try {
+		content = File::readBinary(filename);
+	} catch (const runtime_error&) {
+		//no cache has been saved yet
+	}
+	const span<const byte> data = ::validatePipelineCacheFile(content, ::getDeviceIdentity(gpu));
+
+	if (data.empty()) {
+		msg << "No pipeline cache compatible with the device is found, pipelines will be compiled from scratch" << endl;
+	} else {
+		msg << "Load pipeline cache of " << data.size() << " bytes" << endl;
+	}
+	return VKO::createPipelineCache(device, {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = data.size(),
+		.pInitialData = data.data()
+	});
+}
+
+void PipelineManager::savePipelineCache(const VkDevice device, const VkPhysicalDevice gpu,
+	const VkPipelineCache cache, const char* const filename) {
+	PipelineCacheFileHeader header {
+		.Identity = ::getDeviceIdentity(gpu)
+	};
+
+	size_t data_size;
+	CHECK_VULKAN_ERROR(vkGetPipelineCacheData(device, cache, &data_size, nullptr));
+	vector<byte> content(sizeof(header) + data_size);
+	CHECK_VULKAN_ERROR(vkGetPipelineCacheData(device, cache, &data_size, content.data() + sizeof(header)));
+	content.resize(sizeof(header) + data_size);
+
+	header.DataSize = data_size;
+	std::memcpy(content.data(), &header, sizeof(header));
+	File::writeBinary(filename, content);
 }
\ No newline at end of file
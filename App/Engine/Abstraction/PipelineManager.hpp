@@ -1,11 +1,19 @@
 #pragma once
 
+#include "../VulkanContext.hpp"
 #include "../../Common/VulkanObject.hpp"
 
 #include <optional>
 #include <span>
+#include <unordered_map>
+#include <memory>
+#include <future>
+#include <atomic>
+#include <ostream>
 #include <type_traits>
 
+#include <cstdint>
+
 namespace LearnVulkan {
 
 	/**
@@ -18,7 +26,9 @@ namespace LearnVulkan {
 		*/
 		enum class DepthComparator : std::underlying_type_t<VkCompareOp> {
 			Default = VK_COMPARE_OP_GREATER,
-			DefaultOrEqual = VK_COMPARE_OP_GREATER_OR_EQUAL
+			DefaultOrEqual = VK_COMPARE_OP_GREATER_OR_EQUAL,
+			//Only pass fragments at exactly the depth already written, such as by a depth pre-pass.
+			Equal = VK_COMPARE_OP_EQUAL
 		};
 	
 		/**
@@ -30,6 +40,8 @@ namespace LearnVulkan {
 			std::span<const VkPipelineShaderStageCreateInfo> ShaderStage;
 			//Can be null to use attribute-less rendering.
 			const VkPipelineVertexInputStateCreateInfo* VertexInputState = nullptr;
+			//A non-zero view mask creates a multiview pipeline, whose shaders may index views with gl_ViewIndex.
+			//Pipelines with tessellation shader require VulkanContext::Feature::MultiviewTessellation for multiview.
 			const VkPipelineRenderingCreateInfo* Rendering;
 
 			VkPrimitiveTopology PrimitiveTopology;
@@ -63,11 +75,132 @@ namespace LearnVulkan {
 		 * - Tessellation patch size is set to be 3.
 		 * - Only scissor and viewport dynamic states are supported.
 		 * @param device The device.
+		 * @param cache The pipeline cache, or null to not use any.
 		 * @param layout The pipeline layout.
 		 * @param graphics_info The simple graphics pipeline create info.
 		 * @return Graphics pipeline.
 		*/
-		VulkanObject::Pipeline createSimpleGraphicsPipeline(VkDevice, VkPipelineLayout, const SimpleGraphicsPipelineCreateInfo&);
+		VulkanObject::Pipeline createSimpleGraphicsPipeline(VkDevice, VkPipelineCache, VkPipelineLayout,
+			const SimpleGraphicsPipelineCreateInfo&);
+
+		/**
+		 * @brief Create graphics pipelines by fast-linking pipeline libraries of the four graphics pipeline parts,
+		 * namely vertex input interface, pre-rasterisation shaders, fragment shader and fragment output interface.
+		 * Each part is built once and reused by all pipelines having an identical part.
+		 * Pipelines with a mesh shader stage have no vertex input interface, and are linked from the other three parts.
+		 * All pipelines share the same rules as a simple graphics pipeline.
+		*/
+		class GraphicsPipelineLibrary {
+		public:
+
+			/**
+			 * @brief A pipeline that is fast-linked from libraries, and optionally replaced by
+			 * a link-time optimised pipeline when it becomes available.
+			*/
+			class LinkedPipeline {
+			private:
+
+				friend GraphicsPipelineLibrary;
+
+				//Written by the background compilation, and only published through the atomic handle once complete.
+				struct Optimisation {
+
+					VulkanObject::Pipeline Pipeline;
+					std::atomic<VkPipeline> Handle = VK_NULL_HANDLE;/**< Null until the optimised pipeline is ready. */
+					//Destroyed first, which waits for the background compilation to finish.
+					std::future<void> Compilation;
+
+				};
+
+				//The fast-linked pipeline is kept after optimisation, as it may still be used by recorded commands.
+				VulkanObject::Pipeline FastLinked;
+				//The address remains the same when the linked pipeline is moved, as it is referenced by the background compilation.
+				std::unique_ptr<Optimisation> Optimising;
+
+			public:
+
+				/**
+				 * @brief Get the best pipeline currently available.
+				 * It is safe to call concurrently.
+				 * @return The optimised pipeline if it is ready, or the fast-linked pipeline.
+				*/
+				VkPipeline get() const noexcept;
+
+			};
+
+		private:
+
+			const VkDevice Device;
+			const VkPipelineCache Cache;
+			const bool BackgroundOptimisation;
+
+			std::unordered_map<uint64_t, VulkanObject::Pipeline> Library;
+
+			//Get the library of a pipeline part identified by the key, or create one if it does not exist.
+			VkPipeline getLibrary(uint64_t, VkGraphicsPipelineLibraryFlagsEXT, VkGraphicsPipelineCreateInfo);
+
+		public:
+
+			/**
+			 * @brief Create a graphics pipeline library.
+			 * @param ctx The context. Libraries are compiled with the pipeline cache of the context.
+			 * @param background_optimisation Specify if a link-time optimised pipeline should be compiled
+			 * on a background thread for every linked pipeline.
+			*/
+			GraphicsPipelineLibrary(const VulkanContext&, bool);
+
+			GraphicsPipelineLibrary(const GraphicsPipelineLibrary&) = delete;
+
+			GraphicsPipelineLibrary(GraphicsPipelineLibrary&&) = delete;
+
+			GraphicsPipelineLibrary& operator=(const GraphicsPipelineLibrary&) = delete;
+
+			GraphicsPipelineLibrary& operator=(GraphicsPipelineLibrary&&) = delete;
+
+			/**
+			 * @brief All linked pipelines must be destroyed before the library.
+			*/
+			~GraphicsPipelineLibrary() = default;
+
+			/**
+			 * @brief Create a graphics pipeline. This function is not thread-safe.
+			 * @param layout The pipeline layout. Libraries are identified by the layout handle,
+			 * so it must remain valid for the lifetime of this library.
+			 * @param graphics_info The simple graphics pipeline create info.
+			 * Shader modules must be provided inline as shader module create info, such that identical parts are detected by their code.
+			 * @return The linked pipeline.
+			 * @exception If any shader stage is given as a shader module handle.
+			*/
+			LinkedPipeline createPipeline(VkPipelineLayout, const SimpleGraphicsPipelineCreateInfo&);
+
+			/**
+			 * @brief Get the number of pipeline part libraries that have been built.
+			*/
+			size_t libraryCount() const noexcept;
+
+		};
+
+		/**
+		 * @brief Create a pipeline cache with initial data loaded from a file.
+		 * The file is only used if it was saved from a device with the same vendor, device, driver version and pipeline cache UUID,
+		 * otherwise an empty pipeline cache is created.
+		 * @param device The device.
+		 * @param gpu The physical device of the device.
+		 * @param filename The file where the pipeline cache was saved. It is fine if this file does not exist.
+		 * @param msg A stream to receive diagnostic messages.
+		 * @return The pipeline cache.
+		*/
+		VulkanObject::PipelineCache loadPipelineCache(VkDevice, VkPhysicalDevice, const char*, std::ostream&);
+
+		/**
+		 * @brief Save the content of a pipeline cache to a file, such that it can be loaded in the next run.
+		 * @param device The device.
+		 * @param gpu The physical device of the device.
+		 * @param cache The pipeline cache to be saved.
+		 * @param filename The file where the pipeline cache is saved to. Existing content is replaced.
+		 * @exception If the file cannot be written.
+		*/
+		void savePipelineCache(VkDevice, VkPhysicalDevice, VkPipelineCache, const char*);
 	
 	}
 
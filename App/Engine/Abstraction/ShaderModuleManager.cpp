@@ -1,28 +1,150 @@
 #include "ShaderModuleManager.hpp"
+#include "../CpuProfiler.hpp"
 
 #include "../../Common/File.hpp"
+#include "../../Common/Hash.hpp"
+
+#include <LearnVulkan/GeneratedTemplate/ResourcePath.hpp>
 
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <iomanip>
 
 #include <memory>
 #include <filesystem>
+#include <algorithm>
+#include <execution>
+#include <ranges>
+#include <optional>
+#include <array>
+#include <vector>
+#include <unordered_set>
 #include <utility>
 
 #include <exception>
 #include <stdexcept>
+#include <cstring>
 
 using std::string, std::string_view, std::span;
+using std::optional, std::nullopt, std::vector, std::unordered_set;
+using std::byte;
+using std::exception_ptr;
+using std::views::iota;
 using std::ostringstream, std::ostream, std::endl;
 using std::unique_ptr, std::make_unique;
 using std::suspend_always, std::suspend_never;
 using std::runtime_error, std::move;
 
 using namespace LearnVulkan;
+namespace fs = std::filesystem;
 
 namespace {
 
+	/*******************
+	 * Shader cache
+	 ******************/
+	constexpr string_view ShaderCacheDirectory = "/Shader";
+	constexpr uint32_t SpirvMagicNumber = 0x07230203u;
+
+	//Get the included filename if the line is an include directive with a quoted filename.
+	optional<string_view> parseIncludeDirective(string_view line) noexcept {
+		const auto trimFront = [](string_view& str) noexcept -> void {
+			str.remove_prefix(std::min(str.find_first_not_of(" \t"), str.size()));
+		};
+		constexpr static string_view directive = "include";
+
+		trimFront(line);
+		if (!line.starts_with('#')) {
+			return nullopt;
+		}
+		line.remove_prefix(1u);
+		trimFront(line);
+		if (!line.starts_with(directive)) {
+			return nullopt;
+		}
+		line.remove_prefix(directive.size());
+		trimFront(line);
+		if (!line.starts_with('\"')) {
+			return nullopt;
+		}
+		line.remove_prefix(1u);
+
+		const size_t end = line.find('\"');
+		if (end == string_view::npos) {
+			return nullopt;
+		}
+		return line.substr(0u, end);
+	}
+
+	//Hash the content of a source and every file it includes recursively, each unique file is only hashed once.
+	//Includes are resolved the same way as the shader includer, and includes that cannot be found are ignored.
+	//Every included file is named by its path relative to the shader root, such that the hash does not depend on where the source is.
+	void hashShaderSource(Hash& hash, const fs::path& filename, const string& source, unordered_set<string>& visited) {
+		hash.update(source);
+
+		size_t line_begin = 0u;
+		while (line_begin < source.size()) {
+			const size_t line_end = std::min(source.find('\n', line_begin), source.size());
+			const string_view line = string_view(source).substr(line_begin, line_end - line_begin);
+			line_begin = line_end + 1u;
+
+			const optional<string_view> included = ::parseIncludeDirective(line);
+			if (!included) {
+				continue;
+			}
+			fs::path include_filename = filename;
+			include_filename.replace_filename(*included);
+			include_filename = include_filename.lexically_normal();
+			if (!fs::exists(include_filename) || !visited.emplace(include_filename.string()).second) {
+				continue;
+			}
+			hash.update(string_view(include_filename.lexically_relative(ResourcePath::ShaderRoot).generic_string()));
+			::hashShaderSource(hash, include_filename, File::readString(include_filename.string().c_str()), visited);
+		}
+	}
+
+	//Compute the name of the file in the cache that stores the shader binary, without invoking the shader compiler.
+	string getShaderCacheFilename(const char* const filename, const string& source,
+		const shaderc_shader_kind kind, const ShaderModuleManager::ShaderCompileOption& option) {
+		unordered_set<string> visited { fs::path(filename).lexically_normal().string() };
+		Hash hash;
+		hash.update(option.Key);
+		hash.update(kind);
+		hash.update(option.DebugInfo);
+		if (option.DebugInfo) {
+			//debug information embeds the absolute filename of the source and its includes,
+			//so such binary can only be reused by the same source location
+			hash.update(string_view(filename));
+		}
+		::hashShaderSource(hash, filename, source, visited);
+
+		ostringstream name;
+		name << std::hex << std::setw(16u) << std::setfill('0') << hash.value() << ".spv";
+		return name.str();
+	}
+
+	//Try to read a shader binary from a cache directory, return an empty array if the cache is missed.
+	StaticArray<uint32_t> readShaderCache(const fs::path& cache_filename) {
+		if (!fs::exists(cache_filename)) {
+			return { };
+		}
+		const vector<byte> content = File::readBinary(cache_filename.string().c_str());
+
+		uint32_t magic;
+		if (content.size() < sizeof(magic) || content.size() % sizeof(uint32_t) != 0u) {
+			return { };
+		}
+		std::memcpy(&magic, content.data(), sizeof(magic));
+		if (magic != ::SpirvMagicNumber) {
+			return { };
+		}
+
+		StaticArray<uint32_t> bin(content.size() / sizeof(uint32_t));
+		std::memcpy(bin.data(), content.data(), content.size());
+		return bin;
+	}
+
 	//A custom include utility for shader compilation.
 	//Damn, I hate interfacing with C API, I hate using `new` and `delete`.
 	class ShaderIncluder final : public shaderc::CompileOptions::IncluderInterface {
@@ -102,34 +224,70 @@ namespace {
 		case shaderc_tess_evaluation_shader: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
 		case shaderc_fragment_shader: return VK_SHADER_STAGE_FRAGMENT_BIT;
 		case shaderc_compute_shader: return VK_SHADER_STAGE_COMPUTE_BIT;
+		case shaderc_task_shader: return VK_SHADER_STAGE_TASK_BIT_EXT;
+		case shaderc_mesh_shader: return VK_SHADER_STAGE_MESH_BIT_EXT;
+		case shaderc_raygen_shader: return VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+		case shaderc_miss_shader: return VK_SHADER_STAGE_MISS_BIT_KHR;
+		case shaderc_closesthit_shader: return VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
 		default:
 			throw runtime_error("The shader kind is unknown and cannot be converted to shader stage flag.");
 		}
 	}
 
-	shaderc::CompileOptions createCommonShaderCompileOption() {
-		shaderc::CompileOptions option;
-		//compiler optimisation
+	optional<shaderc_shader_kind> fromExtensionToKind(const string_view extension) noexcept {
+		constexpr static std::array<std::pair<string_view, shaderc_shader_kind>, 10u> ExtensionKind = { {
+			{ ".vert", shaderc_vertex_shader },
+			{ ".tesc", shaderc_tess_control_shader },
+			{ ".tese", shaderc_tess_evaluation_shader },
+			{ ".frag", shaderc_fragment_shader },
+			{ ".comp", shaderc_compute_shader },
+			{ ".task", shaderc_task_shader },
+			{ ".mesh", shaderc_mesh_shader },
+			{ ".rgen", shaderc_raygen_shader },
+			{ ".rmiss", shaderc_miss_shader },
+			{ ".rchit", shaderc_closesthit_shader }
+		} };
+		if (const auto it = std::ranges::find(ExtensionKind, extension, &std::pair<string_view, shaderc_shader_kind>::first);
+			it != ExtensionKind.cend()) {
+			return it->second;
+		}
+		return nullopt;
+	}
+
+}
+
+ShaderModuleManager::ShaderCompileOption ShaderModuleManager::createDefaultCompileOption() {
+	shaderc::CompileOptions option;
+	//the key also includes the version of SPIR-V generated by the compiler, so upgrading compiler usually invalidates the cache
+	unsigned int spv_version, spv_revision;
+	shaderc_get_spv_version(&spv_version, &spv_revision);
+	ostringstream key;
+	key << "spv" << spv_version << '.' << spv_revision;
+
+	//compiler optimisation
 #ifndef NDEBUG
-		option.SetGenerateDebugInfo();
-		option.SetOptimizationLevel(shaderc_optimization_level_zero);
+	constexpr bool debug_info = true;
+	option.SetGenerateDebugInfo();
+	option.SetOptimizationLevel(shaderc_optimization_level_zero);
+	key << ";O0";
 #else
-		option.SetOptimizationLevel(shaderc_optimization_level_performance);
+	constexpr bool debug_info = false;
+	option.SetOptimizationLevel(shaderc_optimization_level_performance);
+	key << ";O";
 #endif
 
-		//language standard
-		option.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
-		option.SetTargetSpirv(shaderc_spirv_version_1_6);
+	//language standard
+	option.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+	option.SetTargetSpirv(shaderc_spirv_version_1_6);
+	key << ";vulkan1.3;spirv1.6";
 
-		//include
-		option.SetIncluder(make_unique<ShaderIncluder>());
-
-		return option;
-	}
+	//include
+	option.SetIncluder(make_unique<ShaderIncluder>());
 
+	return { move(option), key.str(), debug_info };
 }
 
-const shaderc::CompileOptions ShaderModuleManager::DefaultCompileOption = ::createCommonShaderCompileOption();
+const ShaderModuleManager::ShaderCompileOption ShaderModuleManager::DefaultCompileOption = ShaderModuleManager::createDefaultCompileOption();
 
 ShaderModuleManager::ShaderOutputGenerator::~ShaderOutputGenerator() {
 	if (*this) {
@@ -164,25 +322,111 @@ void ShaderModuleManager::ShaderOutputView::unhandled_exception() {
 }
 
 void ShaderModuleManager::_Internal::batchShaderCompilation(const ShaderBatchCompilationInfo& info, ostream& out,
-	const shaderc::CompileOptions& option, const span<ShaderOutput> shader_out) {
+	const ShaderCompileOption& option, const span<ShaderOutput> shader_out) {
+	CPU_PROFILE_SCOPE("Shader batch compilation");
 	const auto [device, shader_filename, shader_kind] = info;
-	shaderc::Compiler compiler;
-
-	for (size_t i = 0u; i < shader_out.size(); i++) {
-		const char* const current_filename = shader_filename[i].data();
-		const shaderc_shader_kind current_kind = shader_kind[i];
-
-		const shaderc::CompilationResult result = compiler.CompileGlslToSpv(
-			File::readString(current_filename), current_kind, current_filename, option);
-
-		ShaderOutput& current_out = shader_out[i];
-		current_out.Code = processShaderCompilationResult(result, out);
-		const StaticArray<uint32_t>& bin = current_out.Code;
-		current_out.SMInfo = {
-			.sType = VkStructureType::VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-			.codeSize = bin.size() * sizeof(uint32_t),
-			.pCode = bin.data()
-		};
-		current_out.Stage = ::fromKindToStage(current_kind);
+
+	const fs::path cache_dir = fs::path(ResourcePath::CacheRoot).concat(::ShaderCacheDirectory),
+		prebuilt_cache_dir = fs::path(ResourcePath::PrebuiltShaderCacheRoot);
+	bool cache_writable = option.Cache;
+	if (cache_writable) {
+		try {
+			fs::create_directories(cache_dir);
+		} catch (const std::exception& e) {
+			//shaders are still usable even if they cannot be cached
+			out << "Unable to create shader cache: " << e.what() << endl;
+			cache_writable = false;
+		}
+	}
+
+	//Every stage is compiled in parallel, and diagnostic messages are buffered and written to the output in order once finished.
+	//Exceptions cannot escape from a parallel algorithm, so they are captured and rethrown in order as well.
+	vector<ostringstream> stage_msg(shader_out.size());
+	vector<exception_ptr> stage_exception(shader_out.size());
+
+	const auto index = iota(size_t { 0 }, shader_out.size());
+	std::for_each(std::execution::par, index.begin(), index.end(), [&](const size_t i) {
+		CPU_PROFILE_SCOPE("Shader stage compilation");
+		ostringstream& current_msg = stage_msg[i];
+		try {
+			const char* const current_filename = shader_filename[i].data();
+			const shaderc_shader_kind current_kind = shader_kind[i];
+			ShaderOutput& current_out = shader_out[i];
+
+			const string source = File::readString(current_filename);
+			string cache_filename;
+			if (option.Cache) {
+				cache_filename = ::getShaderCacheFilename(current_filename, source, current_kind, option);
+				//prebuilt cache takes precedence over the cache generated at runtime
+				if (!prebuilt_cache_dir.empty()) {
+					current_out.Code = ::readShaderCache(prebuilt_cache_dir / cache_filename);
+				}
+				if (current_out.Code.size() == 0u) {
+					current_out.Code = ::readShaderCache(cache_dir / cache_filename);
+				}
+			}
+
+			if (current_out.Code.size() == 0u) {
+				//each stage uses its own compiler, and the compiler is only created on cache miss
+				const shaderc::Compiler compiler;
+				const shaderc::CompilationResult result = compiler.CompileGlslToSpv(source, current_kind, current_filename, option.Option);
+				current_out.Code = processShaderCompilationResult(result, current_msg);
+
+				if (cache_writable) {
+					try {
+						File::writeBinary((cache_dir / cache_filename).string().c_str(),
+							std::as_bytes(span(current_out.Code.data(), current_out.Code.size())));
+					} catch (const std::exception& e) {
+						current_msg << "Unable to write shader cache: " << e.what() << endl;
+					}
+				}
+			} else {
+				current_msg << "Load shader from cache " << cache_filename << endl;
+			}
+			const StaticArray<uint32_t>& bin = current_out.Code;
+			current_out.SMInfo = {
+				.sType = VkStructureType::VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+				.codeSize = bin.size() * sizeof(uint32_t),
+				.pCode = bin.data()
+			};
+			current_out.Stage = ::fromKindToStage(current_kind);
+		} catch (...) {
+			stage_exception[i] = std::current_exception();
+		}
+	});
+
+	for (const auto i : index) {
+		out << stage_msg[i].str();
+		if (stage_exception[i]) {
+			std::rethrow_exception(stage_exception[i]);
+		}
+	}
+}
+
+void ShaderModuleManager::precompileShaderCache(const string_view directory, ostream& out, const ShaderCompileOption& option) {
+	vector<string> filename;
+	vector<shaderc_shader_kind> kind;
+	for (const auto& entry : fs::directory_iterator(directory)) {
+		if (!entry.is_regular_file()) {
+			continue;
+		}
+		const fs::path& path = entry.path();
+		if (const optional<shaderc_shader_kind> shader_kind = ::fromExtensionToKind(path.extension().string()); shader_kind) {
+			filename.emplace_back(string(directory) + '/' + path.filename().string());
+			kind.push_back(*shader_kind);
+		}
+	}
+	const vector<string_view> filename_view(filename.cbegin(), filename.cend());
+
+	const ShaderBatchCompilationInfo info {
+		.Device = VK_NULL_HANDLE,
+		.ShaderFilename = filename_view.data(),
+		.ShaderKind = kind.data()
+	};
+	vector<_Internal::ShaderOutput> shader_output(filename.size());
+	try {
+		_Internal::batchShaderCompilation(info, out, option, shader_output);
+	} catch (const std::exception& e) {
+		out << "Unable to precompile shader: " << e.what() << endl;
 	}
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <Volk/volk.h>
 #include <shaderc/shaderc.hpp>
 
+#include <string>
 #include <string_view>
 #include <array>
 #include <span>
@@ -19,10 +20,13 @@ namespace LearnVulkan {
 
 	/**
 	 * @brief A simple framework to runtime-compile shader from source.
+	 * Compiled SPIR-V are cached on disk, addressed by a hash of the shader source, every file it includes,
+	 * the shader kind and the compile option, which includes the compiler version. Shader compilation is skipped entirely on cache hit.
 	*/
 	namespace ShaderModuleManager {
 
 		struct ShaderBatchCompilationInfo;
+		struct ShaderCompileOption;
 
 		namespace _Internal {
 
@@ -39,7 +43,7 @@ namespace LearnVulkan {
 
 			//Shader compilation output is allocated automatically on stack.
 			void batchShaderCompilation(const ShaderBatchCompilationInfo&, std::ostream&,
-				const shaderc::CompileOptions&, std::span<ShaderOutput>);
+				const ShaderCompileOption&, std::span<ShaderOutput>);
 
 		}
 
@@ -84,7 +88,42 @@ namespace LearnVulkan {
 
 		};
 
-		extern const shaderc::CompileOptions DefaultCompileOption;
+		/**
+		 * @brief Shader compile option, and a key to identify it in the shader cache.
+		*/
+		struct ShaderCompileOption {
+
+			shaderc::CompileOptions Option;
+			//Two options having the same key must produce the same SPIR-V given the same source.
+			std::string Key;
+			//Whether the option generates debug information, which embeds filename of the source in the SPIR-V;
+			//if true, the source filename becomes part of the cache key.
+			bool DebugInfo = false;
+			//If false, every shader is compiled from source, and neither read from nor written to the shader cache.
+			bool Cache = true;
+
+		};
+
+		/**
+		 * @brief Create the common compile option used by every renderer, which the default compile option is created with.
+		 * The option cannot be copied without losing its includer, so a variant of the default option must be created from this.
+		 * @return The compile option.
+		*/
+		ShaderCompileOption createDefaultCompileOption();
+
+		extern const ShaderCompileOption DefaultCompileOption;
+
+		/**
+		 * @brief Compile every shader source in a directory into the shader cache without creating any shader module,
+		 * such that later batch compilation of these shaders loads from the cache.
+		 * The shader kind is deduced from the file extension, and files of any other extension, such as includes, are ignored.
+		 * A shader failing to compile is only reported, as it is compiled again and the error is thrown when it is actually used.
+		 * @param directory The directory to search for shader source, not recursively.
+		 * Each shader filename is the directory followed by a slash and the name of the file.
+		 * @param out The stream output where diagnostic messages are written to.
+		 * @param option The compilation options expected to be used by batch compilation.
+		*/
+		void precompileShaderCache(std::string_view, std::ostream&, const ShaderCompileOption& = DefaultCompileOption);
 
 		/**
 		 * @brief Quickly compile a collection of shader source code to shader module.
@@ -99,7 +138,7 @@ namespace LearnVulkan {
 		*/
 		template<size_t ShaderCount>
 		inline ShaderOutputGenerator batchShaderCompilation(const ShaderBatchCompilationInfo* const info, std::ostream* const out,
-			const shaderc::CompileOptions* const option = &DefaultCompileOption) {
+			const ShaderCompileOption* const option = &DefaultCompileOption) {
 			using std::array, std::span;
 
 			array<_Internal::ShaderOutput, ShaderCount> shader_output;
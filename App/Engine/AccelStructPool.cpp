@@ -0,0 +1,172 @@
+#include "AccelStructPool.hpp"
+
+#include "Abstraction/BufferManager.hpp"
+#include "Abstraction/PipelineBarrier.hpp"
+
+#include <ranges>
+#include <utility>
+#include <bit>
+
+using std::span, std::vector;
+using std::views::iota;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	constexpr VkDeviceSize alignTo(const VkDeviceSize value, const VkDeviceSize alignment) noexcept {
+		return (value + alignment - 1ull) / alignment * alignment;
+	}
+
+}
+
+AccelStructPool::AccelStructPool(const VulkanContext& ctx, const VkDeviceSize block_size) : Context(&ctx),
+	ScratchAlignment(ctx.PhysicalDeviceProperty.AccelStruct.minAccelerationStructureScratchOffsetAlignment),
+	Storage(ctx, block_size, AccelStructPool::StorageUsage, VKO::AllocationCategory::AccelStruct), Scratch { }, Statistics(ctx) {
+
+}
+
+VkDeviceAddress AccelStructPool::acquireScratch(const VkDeviceSize size) {
+	if (size <= this->Scratch.Size) {
+		return this->Scratch.Address;
+	}
+
+	//grow geometrically, such that the scratch buffer settles quickly when builds grow gradually
+	const VkDeviceSize scratch_size = std::bit_ceil(size);
+	const VkDevice device = this->Context->Device;
+	if (this->Scratch.Memory.first) {
+		this->RetiredScratch.push_back(std::move(this->Scratch.Memory));
+	}
+	//the buffer is not necessarily aligned for scratch, so it is padded to align its address
+	this->Scratch.Memory = BufferManager::createDeviceBuffer({ device, this->Context->Allocator,
+		scratch_size + this->ScratchAlignment - 1ull }, AccelStructPool::ScratchUsage, VKO::AllocationCategory::AccelStruct);
+	this->Scratch.Size = scratch_size;
+	this->Scratch.Address = ::alignTo(BufferManager::addressOf(device, this->Scratch.Memory.second), this->ScratchAlignment);
+	return this->Scratch.Address;
+}
+
+AccelStructPool::AccelStruct AccelStructPool::createAccelStruct(const VkAccelerationStructureTypeKHR type, const VkDeviceSize size) {
+	BufferArena::Range memory = this->Storage.allocate(size, AccelStructPool::StorageAlignment);
+	VKO::AccelerationStructureKHR as = VKO::createAccelerationStructureKHR(this->Context->Device, {
+		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+		.buffer = memory.Buffer,
+		.offset = memory.Offset,
+		.size = size,
+		.type = type
+	});
+
+	using std::move;
+	return {
+		move(memory),
+		move(as)
+	};
+}
+
+vector<AccelStructPool::AccelStruct> AccelStructPool::build(const VkCommandBuffer cmd,
+	const span<const AccelStructManager::AccelStructBuildRequest> request) {
+	vector<AccelStruct> as;
+	if (request.empty()) {
+		return as;
+	}
+
+	vector<AccelStructManager::AccelStructBuildTarget> target(request.size());
+	as.reserve(request.size());
+	//builds in the same command may overlap, so each has a scratch region of its own
+	VkDeviceSize scratch_size = 0ull;
+	for (const auto i : iota(size_t { 0 }, request.size())) {
+		const VkAccelerationStructureBuildSizesInfoKHR size_info = AccelStructManager::getBuildSize(this->Context->Device, request[i]);
+		//offset into the scratch buffer, until its address is known
+		target[i].Scratch = scratch_size;
+		scratch_size += ::alignTo(size_info.buildScratchSize, this->ScratchAlignment);
+
+		target[i].AccelStruct = as.emplace_back(this->createAccelStruct(request[i].Type, size_info.accelerationStructureSize)).AccelStruct;
+	}
+
+	this->recordBuild(cmd, request, target, scratch_size);
+	return as;
+}
+
+void AccelStructPool::recordBuild(const VkCommandBuffer cmd, const span<const AccelStructManager::AccelStructBuildRequest> request,
+	const span<AccelStructManager::AccelStructBuildTarget> target, const VkDeviceSize scratch_size) {
+	const VkDeviceAddress scratch_addr = this->acquireScratch(scratch_size);
+	for (auto& current_target : target) {
+		current_target.Scratch += scratch_addr;
+	}
+	{
+		//earlier builds may still be using the shared scratch memory
+		PipelineBarrier<1u, 0u, 0u> barrier;
+		barrier.addMemoryBarrier({
+			VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+			VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+			VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+			VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR
+		});
+		barrier.record(cmd);
+	}
+	this->Statistics.beginBuild(cmd, request, target);
+	AccelStructManager::recordBuild(cmd, request, target);
+	this->Statistics.end(cmd);
+}
+
+AccelStructPool::AccelStruct AccelStructPool::build(const VkCommandBuffer cmd,
+	const AccelStructManager::AccelStructBuildRequest& request) {
+	return std::move(this->build(cmd, span(&request, 1u)).front());
+}
+
+void AccelStructPool::update(const VkCommandBuffer cmd,
+	const span<const AccelStructManager::AccelStructBuildRequest> request, const span<const VkAccelerationStructureKHR> as) {
+	if (request.empty()) {
+		return;
+	}
+
+	vector<AccelStructManager::AccelStructBuildTarget> target(request.size());
+	VkDeviceSize scratch_size = 0ull;
+	for (const auto i : iota(size_t { 0 }, request.size())) {
+		//update in place, the storage size is unchanged
+		target[i] = {
+			.AccelStruct = as[i],
+			.Scratch = scratch_size,
+			.Source = as[i]
+		};
+		scratch_size += ::alignTo(AccelStructManager::getBuildSize(this->Context->Device, request[i]).updateScratchSize,
+			this->ScratchAlignment);
+	}
+	this->recordBuild(cmd, request, target, scratch_size);
+}
+
+AccelStructPool::AccelStruct AccelStructPool::compact(const VkCommandBuffer cmd, const VkAccelerationStructureKHR as,
+	const VkAccelerationStructureTypeKHR type, const AccelStructManager::CompactionSizeQueryInfo& compaction_query) {
+	return this->compact(cmd, as, type, AccelStructManager::getCompactedSize(this->Context->Device, compaction_query));
+}
+
+AccelStructPool::AccelStruct AccelStructPool::compact(const VkCommandBuffer cmd, const VkAccelerationStructureKHR as,
+	const VkAccelerationStructureTypeKHR type, const VkDeviceSize size) {
+	AccelStruct compacted_as = this->createAccelStruct(type, size);
+	this->Statistics.beginCompaction(cmd, as, type, size);
+	AccelStructManager::recordCompaction(cmd, as, compacted_as.AccelStruct);
+	this->Statistics.end(cmd);
+	return compacted_as;
+}
+
+size_t AccelStructPool::trim() {
+	const size_t retired = this->RetiredScratch.size();
+	this->RetiredScratch.clear();
+	return retired + this->Storage.releaseEmptyBlock();
+}
+
+size_t AccelStructPool::blockCount() const noexcept {
+	return this->Storage.blockCount();
+}
+
+VkDeviceSize AccelStructPool::scratchSize() const noexcept {
+	return this->Scratch.Size;
+}
+
+AccelStructManager::BuildStatistics& AccelStructPool::statistics() noexcept {
+	return this->Statistics;
+}
+
+const AccelStructManager::BuildStatistics& AccelStructPool::statistics() const noexcept {
+	return this->Statistics;
+}
\ No newline at end of file
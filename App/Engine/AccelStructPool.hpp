@@ -0,0 +1,176 @@
+#pragma once
+
+#include "BufferArena.hpp"
+#include "VulkanContext.hpp"
+
+#include "Abstraction/AccelStructManager.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <span>
+#include <vector>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief A persistent pool of memory for acceleration structure, such that frequent rebuilds have a predictable memory footprint.
+	 * Acceleration structure storage is sub-allocated from large buffers, and every build shares a single scratch buffer,
+	 * which only grows when a larger build is requested and is otherwise reused across frames.
+	 * The pool is not thread-safe, and scratch memory must only be used on a single queue.
+	 * Every build, update and compaction from the pool is recorded in the build statistics of the pool.
+	*/
+	class AccelStructPool {
+	public:
+
+		constexpr static VkDeviceSize DefaultBlockSize = 32ull << 20u;/**< In byte. */
+		constexpr static VkDeviceSize StorageAlignment = 256ull;/**< Required by the offset of acceleration structure. */
+
+		constexpr static VkBufferUsageFlags StorageUsage =
+			VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+		constexpr static VkBufferUsageFlags ScratchUsage =
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+		/**
+		 * @brief An acceleration structure whose storage is allocated from the pool.
+		 * The storage is returned to the pool when destroyed, and must be destroyed before the pool.
+		*/
+		struct AccelStruct {
+
+			BufferArena::Range Memory;
+			VulkanObject::AccelerationStructureKHR AccelStruct;
+
+		};
+
+	private:
+
+		const VulkanContext* const Context;
+		const VkDeviceSize ScratchAlignment;
+
+		BufferArena Storage;
+		struct {
+
+			VulkanObject::BufferAllocation Memory;
+			VkDeviceSize Size;/**< The usable size after aligning the address. */
+			VkDeviceAddress Address;/**< Aligned for scratch. */
+
+		} Scratch;
+		//Scratch buffers replaced by a larger one, which may still be used by the device until trimmed.
+		std::vector<VulkanObject::BufferAllocation> RetiredScratch;
+		AccelStructManager::BuildStatistics Statistics;
+
+		//Get the address of the scratch buffer with at least the given size, the buffer is grown if needed.
+		VkDeviceAddress acquireScratch(VkDeviceSize);
+
+		//Record a build using the shared scratch memory of the given size, where scratch of each target is an offset into it.
+		void recordBuild(VkCommandBuffer, std::span<const AccelStructManager::AccelStructBuildRequest>,
+			std::span<AccelStructManager::AccelStructBuildTarget>, VkDeviceSize);
+
+		//Allocate storage and create an acceleration structure of the given size.
+		AccelStruct createAccelStruct(VkAccelerationStructureTypeKHR, VkDeviceSize);
+
+	public:
+
+		/**
+		 * @brief Create an empty acceleration structure pool.
+		 * @param ctx The context. The context is retained and must remain valid until the pool is destroyed.
+		 * @param block_size The size of each storage buffer in byte.
+		*/
+		AccelStructPool(const VulkanContext&, VkDeviceSize = DefaultBlockSize);
+
+		AccelStructPool(const AccelStructPool&) = delete;
+
+		AccelStructPool(AccelStructPool&&) = delete;
+
+		AccelStructPool& operator=(const AccelStructPool&) = delete;
+
+		AccelStructPool& operator=(AccelStructPool&&) = delete;
+
+		/**
+		 * @brief All acceleration structures must have been destroyed, and the device must have finished every build.
+		*/
+		~AccelStructPool() = default;
+
+		/**
+		 * @brief Initiate a device command to build a batch of acceleration structure into storage of the pool.
+		 * Builds from the pool share the same scratch memory, so a barrier is recorded before the build
+		 * to serialise against any earlier build on the same queue.
+		 * @param cmd The command buffer.
+		 * @param request An array of build request.
+		 * @return The built acceleration structures, in the same order as the requests.
+		 * @see AccelStructManager::buildAccelStruct
+		*/
+		std::vector<AccelStruct> build(VkCommandBuffer, std::span<const AccelStructManager::AccelStructBuildRequest>);
+
+		/**
+		 * @brief Initiate a device command to build a single acceleration structure into storage of the pool.
+		 * @param cmd The command buffer.
+		 * @param request The build request.
+		 * @return The built acceleration structure.
+		*/
+		AccelStruct build(VkCommandBuffer, const AccelStructManager::AccelStructBuildRequest&);
+
+		/**
+		 * @brief Initiate a device command to update a batch of acceleration structure in place,
+		 * such as to refit a BLAS after its vertices have been displaced, using the shared scratch memory.
+		 * @param cmd The command buffer.
+		 * @param request An array of request, each with the same flag and primitive count as the build of the acceleration structure,
+		 * which must include `VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR`.
+		 * @param as An array of acceleration structure to be updated, one for each request.
+		 * The device must have finished reading from them, or a barrier must have been recorded by the application.
+		 * @see AccelStructManager::AccelStructBuildTarget
+		*/
+		void update(VkCommandBuffer, std::span<const AccelStructManager::AccelStructBuildRequest>,
+			std::span<const VkAccelerationStructureKHR>);
+
+		/**
+		 * @brief Compact an acceleration structure into storage of the pool, which waits for the compaction size query.
+		 * The compacted storage is allocated preferring to fill gaps left by released acceleration structures,
+		 * the source acceleration structure can be released after the device has finished the compaction,
+		 * followed by a trim to return emptied storage.
+		 * @param cmd The command buffer.
+		 * @param as The acceleration structure to be compacted.
+		 * @param type The type of the acceleration structure.
+		 * @param compaction_query The query written after the acceleration structure has been built.
+		 * @return The compacted acceleration structure.
+		*/
+		AccelStruct compact(VkCommandBuffer, VkAccelerationStructureKHR, VkAccelerationStructureTypeKHR,
+			const AccelStructManager::CompactionSizeQueryInfo&);
+
+		/**
+		 * @brief Compact an acceleration structure into storage of the pool, given its compacted size.
+		 * @param cmd The command buffer.
+		 * @param as The acceleration structure to be compacted.
+		 * @param type The type of the acceleration structure.
+		 * @param size The compacted size in byte.
+		 * @return The compacted acceleration structure.
+		 * @see compact
+		 * @see AccelStructManager::tryGetCompactedSize
+		*/
+		AccelStruct compact(VkCommandBuffer, VkAccelerationStructureKHR, VkAccelerationStructureTypeKHR, VkDeviceSize);
+
+		/**
+		 * @brief Destroy retired scratch buffers and storage buffers from which nothing is allocated.
+		 * The device must have finished every build and compaction recorded before.
+		 * @return The number of buffer destroyed.
+		*/
+		size_t trim();
+
+		/**
+		 * @brief Get the number of storage buffer.
+		*/
+		size_t blockCount() const noexcept;
+
+		/**
+		 * @brief Get the size of the scratch buffer in byte.
+		*/
+		VkDeviceSize scratchSize() const noexcept;
+
+		/**
+		 * @brief Get statistics of every build and compaction from the pool.
+		*/
+		AccelStructManager::BuildStatistics& statistics() noexcept;
+		const AccelStructManager::BuildStatistics& statistics() const noexcept;
+
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "BufferArena.hpp"
+
+#include "Abstraction/BufferManager.hpp"
+#include "../Common/ErrorHandler.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	//Index and indirect command require 4 byte alignment, and vertex data of acceleration structure input are no stricter.
+	constexpr VkDeviceSize MinArenaAlignment = 16ull;
+
+	inline VkDeviceSize getArenaAlignment(const VkPhysicalDeviceLimits& limit) noexcept {
+		return std::max(::MinArenaAlignment, limit.minStorageBufferOffsetAlignment);
+	}
+
+}
+
+BufferArena::BufferArena(const VulkanContext& ctx, const VkDeviceSize block_size,
+	const VkBufferUsageFlags usage, const VKO::AllocationCategory category) :
+	Context(&ctx), BlockSize(block_size), Alignment(::getArenaAlignment(ctx.PhysicalDeviceProperty.Limit)),
+	Usage(usage), Category(category) {
+
+}
+
+BufferArena::MemoryBlock& BufferArena::createBlock(const VkDeviceSize size) {
+	const VkDeviceSize block_size = std::max(this->BlockSize, size);
+	const VkDevice device = this->Context->Device;
+
+	VKO::BufferAllocation memory = BufferManager::createDeviceBuffer({ device, this->Context->Allocator, block_size },
+		this->Usage, this->Category);
+	const VkDeviceAddress address = BufferManager::addressOf(device, memory.second);
+	return this->Block.emplace_back(MemoryBlock {
+		.Virtual = VKO::createVirtualBlock({
+			.size = block_size
+		}),
+		.Memory = std::move(memory),
+		.Address = address
+	});
+}
+
+BufferArena::Range BufferArena::allocate(const VkDeviceSize size, const VkDeviceSize alignment) {
+	const VmaVirtualAllocationCreateInfo alloc_info {
+		.size = size,
+		.alignment = alignment == 0ull ? this->Alignment : alignment,
+		.flags = VMA_VIRTUAL_ALLOCATION_CREATE_STRATEGY_MIN_MEMORY_BIT
+	};
+	const auto createRange = [size](const MemoryBlock& block, const VmaVirtualAllocation allocation, const VkDeviceSize offset) {
+		return Range {
+			.Allocation = VKO::VirtualAllocation(allocation, { block.Virtual }),
+			.Buffer = block.Memory.second,
+			.Offset = offset,
+			.Size = size,
+			.Address = block.Address + offset
+		};
+	};
+
+	VmaVirtualAllocation allocation;
+	VkDeviceSize offset;
+	//the latest block is the most likely to have space
+	for (auto it = this->Block.rbegin(); it != this->Block.rend(); it++) {
+		if (vmaVirtualAllocate(it->Virtual, &alloc_info, &allocation, &offset) == VK_SUCCESS) {
+			return createRange(*it, allocation, offset);
+		}
+	}
+
+	//the beginning of a new block satisfies any alignment
+	const MemoryBlock& block = this->createBlock(size);
+	CHECK_VULKAN_ERROR(vmaVirtualAllocate(block.Virtual, &alloc_info, &allocation, &offset));
+	return createRange(block, allocation, offset);
+}
+
+size_t BufferArena::releaseEmptyBlock() {
+	if (this->Block.empty()) {
+		return 0u;
+	}
+	//ranges refer to the virtual block handle rather than the block itself, so removing other blocks does not invalidate them
+	const auto [first, last] = std::ranges::remove_if(this->Block.begin(), std::prev(this->Block.end()),
+		[](const MemoryBlock& block) noexcept { return vmaIsVirtualBlockEmpty(block.Virtual) == VK_TRUE; });
+	const size_t released = std::distance(first, last);
+	this->Block.erase(first, last);
+	return released;
+}
+
+size_t BufferArena::blockCount() const noexcept {
+	return this->Block.size();
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "VulkanContext.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <vector>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Sub-allocate aligned ranges from a few large device-local buffers, rather than creating a buffer for each use.
+	 * Each buffer is a block managed by a VMA virtual block, and a new block is created when no existing block has space.
+	 * The arena is not thread-safe; allocating and releasing ranges must be externally synchronised.
+	*/
+	class BufferArena {
+	public:
+
+		constexpr static VkDeviceSize DefaultBlockSize = 16ull << 20u;/**< In byte. */
+		/**
+		 * @brief The default usage of every buffer in the arena, which covers geometry data, shader storage with device address,
+		 * input of acceleration structure build and destination of upload.
+		*/
+		constexpr static VkBufferUsageFlags DefaultUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+			| VK_BUFFER_USAGE_TRANSFER_DST_BIT
+			| VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+			| VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+			| VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+			| VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+			| VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+			| VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+
+		/**
+		 * @brief A range of memory in one of the arena buffers.
+		 * The range is returned to the arena when destroyed, and must be destroyed before the arena.
+		*/
+		struct Range {
+
+			VulkanObject::VirtualAllocation Allocation;
+
+			VkBuffer Buffer;/**< The arena buffer where the range is allocated from. */
+			VkDeviceSize Offset, Size;/**< In byte, into the arena buffer. */
+			VkDeviceAddress Address;/**< The device address of the beginning of the range, which has the offset included. */
+
+		};
+
+	private:
+
+		struct MemoryBlock {
+
+			VulkanObject::VirtualBlock Virtual;
+			VulkanObject::BufferAllocation Memory;
+			VkDeviceAddress Address;
+
+		};
+
+		const VulkanContext* const Context;
+
+		const VkDeviceSize BlockSize, Alignment;
+		const VkBufferUsageFlags Usage;
+		const VulkanObject::AllocationCategory Category;
+		std::vector<MemoryBlock> Block;
+
+		//Create a new block with at least the given size.
+		MemoryBlock& createBlock(VkDeviceSize);
+
+	public:
+
+		/**
+		 * @brief Create an empty buffer arena.
+		 * @param ctx The context. The context is retained and must remain valid until the arena is destroyed.
+		 * @param block_size The size of each buffer in byte. Allocation larger than this size gets a block of its own.
+		 * @param usage The usage of every buffer in the arena, which must include device address.
+		 * @param category The category reported for memory of every buffer.
+		*/
+		BufferArena(const VulkanContext&, VkDeviceSize = DefaultBlockSize, VkBufferUsageFlags = DefaultUsage,
+			VulkanObject::AllocationCategory = VulkanObject::AllocationCategory::Geometry);
+
+		BufferArena(const BufferArena&) = delete;
+
+		BufferArena(BufferArena&&) = delete;
+
+		BufferArena& operator=(const BufferArena&) = delete;
+
+		BufferArena& operator=(BufferArena&&) = delete;
+
+		/**
+		 * @brief All ranges must have been released.
+		*/
+		~BufferArena() = default;
+
+		/**
+		 * @brief Allocate a range from the arena.
+		 * @param size The number of byte.
+		 * @param alignment The alignment of the offset of the range, which must be a power of two.
+		 * If zero, the offset is aligned for use as storage buffer, index, vertex and indirect command.
+		 * @return The allocated range.
+		*/
+		Range allocate(VkDeviceSize, VkDeviceSize = 0ull);
+
+		/**
+		 * @brief Destroy every buffer from which no range is allocated, except the latest one which is kept for future allocation.
+		 * The device must have finished using ranges released from those buffers.
+		 * @return The number of buffer destroyed.
+		*/
+		size_t releaseEmptyBlock();
+
+		/**
+		 * @brief Get the number of buffer created by the arena.
+		*/
+		size_t blockCount() const noexcept;
+
+	};
+
+}
\ No newline at end of file
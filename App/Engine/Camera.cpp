@@ -1,8 +1,6 @@
 #include "Camera.hpp"
 
 #include "Abstraction/BufferManager.hpp"
-#include "../Common/ErrorHandler.hpp"
-#include "../Common/FixedArray.hpp"
 
 #include <glm/mat3x3.hpp>
 #include <glm/mat4x4.hpp>
@@ -12,17 +10,16 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <algorithm>
+#include <new>
 #include <ranges>
+#include <span>
 #include <stdexcept>
 
-#include <cassert>
-
 using glm::mat4;
-using glm::vec3, glm::dvec2, glm::dvec3, glm::dmat4;
+using glm::vec2, glm::vec3, glm::dvec2, glm::dvec3, glm::dmat4;
 using glm::lookAt, glm::perspective, glm::normalize, glm::radians;
 
-using std::ranges::generate, std::ranges::for_each, std::ranges::transform, std::ranges::fill;
-using std::make_pair;
+using std::ranges::for_each, std::ranges::transform, std::ranges::fill;
 using std::array;
 
 using namespace LearnVulkan;
@@ -30,12 +27,19 @@ namespace VKO = VulkanObject;
 
 struct Camera::PackedCameraBuffer {
 
-	mat4 V, PV, InvPVRot;
+	mat4 V;
 	vec3 Pos;
 
 	float _pad0;
 	vec3 LDF;
 
+	float _pad1;
+	vec2 Res;
+	float PxScl;
+	uint32_t ViewCnt;
+
+	mat4 PV[EngineSetting::MaxViewCount], InvPVRot[EngineSetting::MaxViewCount];
+
 };
 
 namespace {
@@ -62,43 +66,49 @@ namespace {
 
 }
 
-Camera::Camera(const CreateInfo& camera_create_info) : CameraInfo(*camera_create_info.CameraInfo), Dirty { } {
+Camera::Camera(const CreateInfo& camera_create_info) : CameraInfo(*camera_create_info.CameraInfo), Resolution(1.0),
+	PendingPose {
+		.Position = this->CameraInfo.Position,
+		.Yaw = this->CameraInfo.Yaw,
+		.Pitch = this->CameraInfo.Pitch
+	}, View { }, ViewCount(0u), Dirty { }, FrameMemory(camera_create_info.FrameMemory),
+	ShaderBufferOffset(this->FrameMemory->reserve(sizeof(PackedCameraBuffer))) {
 	this->updateViewSpace();
+	//make the initial pose visible right away, before the first update
+	this->PoseSnapshot.publish(this->PendingPose);
+	this->PoseSnapshot.consume();
+	this->dirtyView();
+	this->dirtyPosition();
 	const VulkanContext& ctx = *camera_create_info.Context;
 	
-	const BufferManager::BufferCreateInfo buf_info = { ctx.Device, ctx.Allocator, sizeof(PackedCameraBuffer) };
-	generate(this->ShaderBuffer, [&buf_info = std::as_const(buf_info), &cam_info = camera_create_info.CameraInfo]() {
-		VKO::BufferAllocation camera_buf = BufferManager::createGlobalStorageBuffer(buf_info, BufferManager::HostAccessPattern::Sequential);
-		auto mapped = VKO::mapAllocation<PackedCameraBuffer>(buf_info.Allocator, camera_buf.first);
-
-		*mapped = { };
-		const double near = cam_info->Near,
-			far = cam_info->Far;
-		mapped->LDF = vec3(
+	const double near = this->CameraInfo.Near,
+		far = this->CameraInfo.Far;
+	for (const auto i : std::views::iota(0u, ctx.FrameInFlight)) {
+		PackedCameraBuffer* const camera_memory =
+			new(this->FrameMemory->at(i, this->ShaderBufferOffset).Data) PackedCameraBuffer { };
+		camera_memory->LDF = vec3(
 			far * near,
 			far - near,
 			far
 		);
-		CHECK_VULKAN_ERROR(vmaFlushAllocation(buf_info.Allocator, camera_buf.first, 0ull, VK_WHOLE_SIZE));
-
-		return make_pair(std::move(camera_buf), std::move(mapped));
-	});
+	}
 
 	/***************************
 	 * Create descriptor buffer
 	 ***************************/
-	this->DescriptorSetLayout = ::createCameraDescriptorSetLayout(this->getDevice());
+	this->DescriptorSetLayout = ::createCameraDescriptorSetLayout(ctx.Device);
 
 	//we need to allocate a descriptor set for each in-flight frame
 	array<VkDescriptorSetLayout, EngineSetting::MaxFrameInFlight> camera_ds_layout;
 	fill(camera_ds_layout, *this->DescriptorSetLayout);
-	this->DescriptorBuffer = DescriptorBufferManager(ctx, camera_ds_layout, VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT);
+	this->DescriptorBuffer = DescriptorBufferManager(ctx, std::span(camera_ds_layout).first(ctx.FrameInFlight),
+		VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT);
 
 	/***************************
 	 * Update descriptor buffer
 	 **************************/
 	using DU = DescriptorBufferManager::DescriptorUpdater;
-	const DU camera_ds_updater = this->DescriptorBuffer.createUpdater(ctx);
+	DU camera_ds_updater = this->DescriptorBuffer.createUpdater(ctx);
 	VkDescriptorAddressInfoEXT addr_info {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
 		.range = sizeof(PackedCameraBuffer),
@@ -112,27 +122,27 @@ Camera::Camera(const CreateInfo& camera_create_info) : CameraInfo(*camera_create
 		}
 	};
 
-	for (const auto i : std::views::iota(0u, this->ShaderBuffer.size())) {
-		addr_info.address = BufferManager::addressOf(this->getDevice(), this->ShaderBuffer[i].first.second);
+	for (const auto i : std::views::iota(0u, ctx.FrameInFlight)) {
+		addr_info.address = this->FrameMemory->at(i, this->ShaderBufferOffset).Address;
 		update_info.SetIndex = i;
 		camera_ds_updater.update(update_info);
 	}
 }
 
 void Camera::updateViewSpace() noexcept {
-	const double cos_pitch = glm::cos(this->CameraInfo.Pitch);
-	this->Front = normalize(dvec3(
-		glm::cos(this->CameraInfo.Yaw) * cos_pitch,
-		glm::sin(this->CameraInfo.Pitch),
-		glm::sin(this->CameraInfo.Yaw) * cos_pitch
+	Pose& pose = this->PendingPose;
+	const double cos_pitch = glm::cos(pose.Pitch);
+	pose.Front = normalize(dvec3(
+		glm::cos(pose.Yaw) * cos_pitch,
+		glm::sin(pose.Pitch),
+		glm::sin(pose.Yaw) * cos_pitch
 	));
-	this->Right = normalize(cross(this->Front, this->CameraInfo.WorldUp));
-	this->Up = normalize(cross(this->Right, this->Front));
+	pose.Right = normalize(cross(pose.Front, this->CameraInfo.WorldUp));
+	pose.Up = normalize(cross(pose.Right, pose.Front));
 }
 
 VkDevice Camera::getDevice() const noexcept {
-	//all buffers uses the same logical device, pick any
-	return this->ShaderBuffer[0].first.second->get_deleter().Device;
+	return this->DescriptorSetLayout->get_deleter().Device;
 }
 
 void Camera::dirtyProjection() noexcept {
@@ -163,99 +173,108 @@ VkDeviceSize Camera::descriptorBufferOffset(const unsigned int index) const noex
 	return this->DescriptorBuffer.offset(index);
 }
 
+dvec3 Camera::position() const noexcept {
+	return this->PoseSnapshot.front().Position;
+}
+
 void Camera::update(const unsigned int index) {
+	if (this->PoseSnapshot.consume()) {
+		this->dirtyView();
+		this->dirtyPosition();
+	}
+
 	DirtyFlag& dirty = this->Dirty[index];
-	const auto& [buffer, camera_memory] = this->ShaderBuffer[index];
+	auto* const camera_memory = reinterpret_cast<PackedCameraBuffer*>(this->FrameMemory->at(index, this->ShaderBufferOffset).Data);
 	const CameraData& ci = this->CameraInfo;
+	const Pose& pose = this->PoseSnapshot.front();
 
-	constexpr static size_t FlushCount = 4u;
-	FixedArray<VkDeviceSize, FlushCount> offset, size;
-
-#define PUSH_OFFSET_SIZE(FIELD) \
-offset.pushBack(offsetof(PackedCameraBuffer, FIELD)); \
-size.pushBack(sizeof(PackedCameraBuffer::FIELD))
-
-	dmat4 view, projection;
+	dmat4 view;
 	if (dirty.Projection || dirty.View) {
-		view = lookAt(ci.Position, ci.Position + this->Front, this->Up);
-		projection = perspective(ci.FieldOfView, ci.Aspect, ci.Far, ci.Near);
-		
-		const dmat4 inv_projection = glm::inverse(projection),
-			view_rotation = dmat4(glm::dmat3(view)),
-			inv_view_rotation = glm::transpose(view_rotation);
-
-		camera_memory->PV = projection * view;
-		camera_memory->InvPVRot = inv_view_rotation * inv_projection;
-
-		PUSH_OFFSET_SIZE(PV);
-		PUSH_OFFSET_SIZE(InvPVRot);
+		view = lookAt(pose.Position, pose.Position + pose.Front, pose.Up);
+		const auto computeView = [camera_memory, &ci](const uint32_t view_index, const dmat4& view_space, const double fov, const double aspect) {
+			const dmat4 projection = perspective(fov, aspect, ci.Far, ci.Near),
+				inv_projection = glm::inverse(projection),
+				view_rotation = dmat4(glm::dmat3(view_space)),
+				inv_view_rotation = glm::transpose(view_rotation);
+
+			camera_memory->PV[view_index] = projection * view_space;
+			camera_memory->InvPVRot[view_index] = inv_view_rotation * inv_projection;
+		};
+
+		if (this->ViewCount == 0u) {
+			computeView(0u, view, ci.FieldOfView, ci.Aspect);
+		}
+		for (const auto i : std::views::iota(0u, this->ViewCount)) {
+			const auto& [offset, fov, aspect] = this->View[i];
+			computeView(i, offset * view, fov, aspect);
+		}
+	}
+	if (dirty.Projection) {
+		camera_memory->ViewCnt = std::max(this->ViewCount, 1u);
+		camera_memory->Res = this->Resolution;
+		camera_memory->PxScl = static_cast<float>(this->Resolution.y * 0.5 / glm::tan(ci.FieldOfView * 0.5));
 	}
 	if (dirty.View) {
 		camera_memory->V = view;
-
-		PUSH_OFFSET_SIZE(V);
 	}
 	if (dirty.Position) {
-		camera_memory->Pos = ci.Position;
-
-		PUSH_OFFSET_SIZE(Pos);
-	}
-
-#undef PUSH_OFFSET_SIZE
-
-	assert(offset.size() == size.size());
-	if (const bool require_flush = offset.size() > 0u;
-		!require_flush) {
-		return;
+		camera_memory->Pos = pose.Position;
 	}
 
-	array<VmaAllocation, FlushCount> allocation;
-	fill(allocation | std::views::take(offset.size()), *buffer.first);
-	//more efficient to do a batched flush
-	CHECK_VULKAN_ERROR(vmaFlushAllocations(buffer.first->get_deleter().Allocator, static_cast<uint32_t>(offset.size()),
-		allocation.data(), offset.data(), size.data()));
-
 	dirty = { };
 }
 
 void Camera::move(const MoveDirection direction, const double delta) {
 	const double velocity = this->CameraInfo.MovementSpeed * delta;
+	Pose& pose = this->PendingPose;
 
 	using enum MoveDirection;
 	switch (direction) {
-	case Forward: this->CameraInfo.Position += this->Front * velocity;
+	case Forward: pose.Position += pose.Front * velocity;
 		break;
-	case Backward: this->CameraInfo.Position -= this->Front * velocity;
+	case Backward: pose.Position -= pose.Front * velocity;
 		break;
-	case Left: this->CameraInfo.Position -= this->Right * velocity;
+	case Left: pose.Position -= pose.Right * velocity;
 		break;
-	case Right: this->CameraInfo.Position += this->Right * velocity;
+	case Right: pose.Position += pose.Right * velocity;
 		break;
-	case Up: this->CameraInfo.Position += this->CameraInfo.WorldUp * velocity;
+	case Up: pose.Position += this->CameraInfo.WorldUp * velocity;
 		break;
-	case Down: this->CameraInfo.Position -= this->CameraInfo.WorldUp * velocity;
+	case Down: pose.Position -= this->CameraInfo.WorldUp * velocity;
 		break;
 	default:
 		throw std::runtime_error("Unknown camera movement direction enum.");
 	}
-	this->dirtyView();
-	this->dirtyPosition();
 }
 
 void Camera::rotate(const dvec2& offset) noexcept {
 	constexpr static double YawMax = radians(360.0), PitchMax = radians(89.0);
 
 	const dvec2 rotateAmount = offset * this->CameraInfo.RotationSpeed;
-	this->CameraInfo.Yaw += rotateAmount.x;
-	this->CameraInfo.Yaw = glm::mod(this->CameraInfo.Yaw, YawMax);
-	this->CameraInfo.Pitch += rotateAmount.y;
-	this->CameraInfo.Pitch = glm::clamp(this->CameraInfo.Pitch, -PitchMax, PitchMax);
+	Pose& pose = this->PendingPose;
+	pose.Yaw += rotateAmount.x;
+	pose.Yaw = glm::mod(pose.Yaw, YawMax);
+	pose.Pitch += rotateAmount.y;
+	pose.Pitch = glm::clamp(pose.Pitch, -PitchMax, PitchMax);
 
 	this->updateViewSpace();
-	this->dirtyView();
+}
+
+void Camera::publish() noexcept {
+	this->PoseSnapshot.publish(this->PendingPose);
 }
 
 void Camera::setAspect(const double width, const double height) noexcept {
 	this->CameraInfo.Aspect = width / height;
+	this->Resolution = dvec2(width, height);
+	this->dirtyProjection();
+}
+
+void Camera::setMultiview(const std::span<const ViewData> view) {
+	if (view.size() > this->View.size()) {
+		throw std::runtime_error("The number of multiview view exceeds the maximum view count.");
+	}
+	std::ranges::copy(view, this->View.begin());
+	this->ViewCount = static_cast<uint32_t>(view.size());
 	this->dirtyProjection();
 }
\ No newline at end of file
@@ -2,21 +2,29 @@
 
 #include "CameraInterface.hpp"
 
+#include "../Common/TripleBuffer.hpp"
 #include "../Common/VulkanObject.hpp"
 #include "Abstraction/DescriptorBufferManager.hpp"
 #include "EngineSetting.hpp"
+#include "FrameAllocator.hpp"
 #include "VulkanContext.hpp"
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
 
 #include <array>
-#include <utility>
+#include <span>
+
+#include <cstdint>
 
 namespace LearnVulkan {
 
 	/**
 	 * @brief Camera utility for 3D rendering.
+	 * The camera can be moved by a simulation thread while another render thread draws with it.
+	 * Movement is handed off to the render thread as a snapshot of camera pose, which is consumed when the camera is updated.
+	 * Functions moving the camera are only called by the simulation thread, and the rest only by the render thread.
 	*/
 	class Camera : public CameraInterface {
 	public:
@@ -50,12 +58,24 @@ namespace LearnVulkan {
 
 		};
 
+		/**
+		 * @brief A view of multiview rendering, such as a face of a cube map or an eye of stereo output.
+		 * Every view shares the position of the camera for decisions made of the whole camera, as well as near and far plane.
+		*/
+		struct ViewData {
+
+			glm::dmat4 Offset;/**< Transform from the view space of the camera to the view space of this view. */
+			double FieldOfView, Aspect;
+
+		};
+
 		/**
 		 * @brief Creation information for the camera class.
 		*/
 		struct CreateInfo {
 
 			const VulkanContext* Context;
+			FrameAllocator* FrameMemory;/**< Camera memory is reserved from the frame allocator, which must outlive the camera. */
 			const CameraData* CameraInfo;
 
 		};
@@ -67,9 +87,27 @@ namespace LearnVulkan {
 		*/
 		struct PackedCameraBuffer;
 
-		//camera intrinsic data
+		/**
+		 * @brief The position and orientation of the camera.
+		*/
+		struct Pose {
+
+			glm::dvec3 Position;
+			double Yaw, Pitch;
+			glm::dvec3 Front, Up, Right;
+
+		};
+
+		//camera intrinsic data, where the initial pose is only read at construction
 		CameraData CameraInfo;
-		glm::dvec3 Front, Up, Right;
+		glm::dvec2 Resolution;/**< Of the viewport, in pixel. */
+
+		Pose PendingPose;/**< Owned by the simulation thread, and visible to the render thread once published. */
+		TripleBuffer<Pose> PoseSnapshot;
+
+		//Views of multiview rendering, or none to render the camera itself as the only view.
+		std::array<ViewData, EngineSetting::MaxViewCount> View;
+		uint32_t ViewCount;
 
 		/**
 		 * @brief Status flags to record which matrix needs to be updated.
@@ -81,15 +119,15 @@ namespace LearnVulkan {
 		};
 		std::array<DirtyFlag, EngineSetting::MaxFrameInFlight> Dirty;/**< For each concurrent frame. */
 
-		//camera shader memory
-		std::array<std::pair<VulkanObject::BufferAllocation, VulkanObject::MappedAllocation<PackedCameraBuffer>>,
-			EngineSetting::MaxFrameInFlight> ShaderBuffer;
+		//camera shader memory, reserved at the same offset in every in-flight frame
+		FrameAllocator* FrameMemory;
+		VkDeviceSize ShaderBufferOffset;
 
 		VulkanObject::DescriptorSetLayout DescriptorSetLayout;
 		DescriptorBufferManager DescriptorBuffer;
 
 		/**
-		 * @brief Update the camera vectors.
+		 * @brief Update the camera vectors of the pending pose.
 		*/
 		void updateViewSpace() noexcept;
 
@@ -114,11 +152,11 @@ namespace LearnVulkan {
 
 		Camera(const Camera&) = delete;
 
-		Camera(Camera&&) noexcept = default;
+		Camera(Camera&&) = delete;
 
 		Camera& operator=(const Camera&) = delete;
 
-		Camera& operator=(Camera&&) noexcept = default;
+		Camera& operator=(Camera&&) = delete;
 
 		~Camera() override = default;
 
@@ -128,8 +166,12 @@ namespace LearnVulkan {
 
 		VkDeviceSize descriptorBufferOffset(unsigned int) const noexcept override;
 
+		glm::dvec3 position() const noexcept override;
+
 		/**
-		 * @brief Re-compute the internal camera matrix and flush the camera uniform buffer after the internal state has been updated.
+		 * @brief Re-compute the internal camera matrix after the internal state has been updated.
+		 * The latest published pose is consumed, and it remains the pose seen by the render thread until the next update.
+		 * The camera memory is flushed together with the rest of the frame allocator.
 		 * @param index The index of in-flight frame to be updated.
 		*/
 		void update(unsigned int);
@@ -148,12 +190,25 @@ namespace LearnVulkan {
 		void rotate(const glm::dvec2&) noexcept;
 
 		/**
-		 * @brief Set the aspect ratio of the view frustum.
-		 * @param width The new frustum width.
-		 * @param height The new frustum height.
+		 * @brief Publish movement since the last publication, which is taken by the next update.
+		*/
+		void publish() noexcept;
+
+		/**
+		 * @brief Set the aspect ratio of the view frustum, as well as the resolution of viewport.
+		 * @param width The new frustum width, in pixel.
+		 * @param height The new frustum height, in pixel.
 		*/
 		void setAspect(double, double) noexcept;
 
+		/**
+		 * @brief Set views of multiview rendering, which are indexed by view index in shader.
+		 * Shader stages outside multiview rendering only see the first view.
+		 * @param view Views relative to the camera, or empty to have the camera itself as the only view.
+		 * @exception If there are more than EngineSetting::MaxViewCount views.
+		*/
+		void setMultiview(std::span<const ViewData>);
+
 	};
 
 }
\ No newline at end of file
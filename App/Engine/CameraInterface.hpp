@@ -2,6 +2,8 @@
 
 #include <Volk/volk.h>
 
+#include <glm/vec3.hpp>
+
 namespace LearnVulkan {
 
 	/**
@@ -33,6 +35,12 @@ namespace LearnVulkan {
 		*/
 		virtual VkDeviceSize descriptorBufferOffset(unsigned int) const noexcept = 0;
 
+		/**
+		 * @brief Get the position of the camera in world space, for decisions made on the host such as streaming.
+		 * @return The camera position.
+		*/
+		virtual glm::dvec3 position() const noexcept = 0;
+
 	};
 
 }
\ No newline at end of file
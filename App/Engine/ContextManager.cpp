@@ -4,6 +4,7 @@
 
 #include "../Common/ErrorHandler.hpp"
 
+#include <array>
 #include <iterator>
 #include <utility>
 
@@ -16,7 +17,7 @@
 #include <stdexcept>
 #include <cassert>
 
-using std::make_unique;
+using std::array, std::make_unique;
 
 using std::optional, std::nullopt;
 using std::span;
@@ -65,6 +66,21 @@ namespace {
 		return layer;
 	}
 
+	//Get all instance extensions, sorted by extension name.
+	StaticArray<VkExtensionProperties> getInstanceExtension() {
+		uint32_t extension_count;
+		CHECK_VULKAN_ERROR(vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr));
+		if (extension_count == 0u) {
+			return { };
+		}
+
+		StaticArray<VkExtensionProperties> extension(extension_count);
+		CHECK_VULKAN_ERROR(vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extension.data()));
+		sort(extension.toSpan(), ::stringLessThan<>,
+			[](const auto& ext_props) constexpr noexcept { return ext_props.extensionName; });
+		return extension;
+	}
+
 	//Check if the supported layers meet the requirement.
 	//*layer* range must be sorted by layer extension name.
 	inline bool isLayerSuitable(const span<const VkLayerProperties> layer, const ExtensionName& required_layer) {
@@ -95,10 +111,19 @@ namespace {
 	//As its name suggests...
 	DeviceProperty getPhysicalDeviceProperty(const VkPhysicalDevice device) {
 		auto property = make_unique<DeviceProperty::element_type>();
-		auto& [dev10, dev11, dev12, dev13, descriptor_buf] = *property;
+		auto& [dev10, dev11, dev12, dev13, descriptor_buf, accel_struct, ray_tracing] = *property;
 
+		//properties of an unsupported extension are left untouched
+		ray_tracing = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR
+		};
+		accel_struct = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR,
+			.pNext = &ray_tracing
+		};
 		descriptor_buf = {
-			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT,
+			.pNext = &accel_struct
 		};
 		dev13 = {
 			.sType = VkStructureType::VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_PROPERTIES,
@@ -196,6 +221,99 @@ namespace {
 		return includes(all_extensions, req_dev_ext_arr.toSpan(), ::stringEqual<>, extension_name_projector);
 	}
 
+	//Check if the given device supports task and mesh shader, which is an optional alternative to tessellation.
+	//*all_extensions* must be sorted by device extension name.
+	bool isMeshShaderSupported(const VkPhysicalDevice device, const span<const VkExtensionProperties> all_extensions) {
+		constexpr static auto extension_name_projector = [](const VkExtensionProperties& props) constexpr noexcept -> const char* {
+			return props.extensionName;
+		};
+		constexpr static auto mesh_shader_ext = array { VK_EXT_MESH_SHADER_EXTENSION_NAME };
+
+		assert(is_sorted(all_extensions, ::stringLessThan<>, extension_name_projector));
+		if (!includes(all_extensions, mesh_shader_ext, ::stringLessThan<>, extension_name_projector)) {
+			return false;
+		}
+
+		VkPhysicalDeviceMeshShaderFeaturesEXT mesh_shader {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT
+		};
+		VkPhysicalDeviceFeatures2 feature {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &mesh_shader
+		};
+		vkGetPhysicalDeviceFeatures2(device, &feature);
+		return mesh_shader.taskShader == VK_TRUE && mesh_shader.meshShader == VK_TRUE;
+	}
+
+	//Check if the given device supports ray tracing pipeline, which is an optional alternative to ray query.
+	//*all_extensions* must be sorted by device extension name.
+	bool isRayTracingPipelineSupported(const VkPhysicalDevice device, const span<const VkExtensionProperties> all_extensions) {
+		constexpr static auto extension_name_projector = [](const VkExtensionProperties& props) constexpr noexcept -> const char* {
+			return props.extensionName;
+		};
+		constexpr static auto ray_tracing_ext = array { VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME };
+
+		assert(is_sorted(all_extensions, ::stringLessThan<>, extension_name_projector));
+		if (!includes(all_extensions, ray_tracing_ext, ::stringLessThan<>, extension_name_projector)) {
+			return false;
+		}
+
+		VkPhysicalDeviceRayTracingPipelineFeaturesKHR ray_tracing {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR
+		};
+		VkPhysicalDeviceFeatures2 feature {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &ray_tracing
+		};
+		vkGetPhysicalDeviceFeatures2(device, &feature);
+		return ray_tracing.rayTracingPipeline == VK_TRUE;
+	}
+
+	//Check if the given device supports copying between host memory and images on the host.
+	//*all_extensions* must be sorted by device extension name.
+	bool isHostImageCopySupported(const VkPhysicalDevice device, const span<const VkExtensionProperties> all_extensions) {
+		constexpr static auto extension_name_projector = [](const VkExtensionProperties& props) constexpr noexcept -> const char* {
+			return props.extensionName;
+		};
+		constexpr static auto host_image_copy_ext = array { VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME };
+
+		assert(is_sorted(all_extensions, ::stringLessThan<>, extension_name_projector));
+		if (!includes(all_extensions, host_image_copy_ext, ::stringLessThan<>, extension_name_projector)) {
+			return false;
+		}
+
+		VkPhysicalDeviceHostImageCopyFeaturesEXT host_image_copy {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT
+		};
+		VkPhysicalDeviceFeatures2 feature {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &host_image_copy
+		};
+		vkGetPhysicalDeviceFeatures2(device, &feature);
+		return host_image_copy.hostImageCopy == VK_TRUE;
+	}
+
+	//Check if the given device supports tessellation shader in multiview rendering.
+	//Multiview itself is a core feature every device supports, so no extension check is needed.
+	bool isMultiviewTessellationSupported(const VkPhysicalDevice device) {
+		VkPhysicalDeviceMultiviewFeatures multiview {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES
+		};
+		VkPhysicalDeviceFeatures2 feature {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &multiview
+		};
+		vkGetPhysicalDeviceFeatures2(device, &feature);
+		return multiview.multiview == VK_TRUE && multiview.multiviewTessellationShader == VK_TRUE;
+	}
+
+	//Check if the given device supports pipeline statistics query, which is a core feature.
+	bool isPipelineStatisticsQuerySupported(const VkPhysicalDevice device) {
+		VkPhysicalDeviceFeatures feature;
+		vkGetPhysicalDeviceFeatures(device, &feature);
+		return feature.pipelineStatisticsQuery == VK_TRUE;
+	}
+
 	//Check if the surface format that meets our requirement.
 	inline bool isSurfaceFormatSuitable(const span<const VkSurfaceFormatKHR> surface_format,
 		const VkFormat format, const VkColorSpaceKHR colour_space) {
@@ -224,6 +342,34 @@ namespace {
 		}
 	}
 
+	//Find a queue family that supports compute but not graphics, such that compute work can run alongside rendering.
+	//Return none if no such queue family is found.
+	optional<uint32_t> findComputingQueueFamily(const span<const VkQueueFamilyProperties> all_qf) {
+		const auto computing_it = find_if(all_qf, [](const VkQueueFlags queue_flags) constexpr noexcept {
+			return (queue_flags & VK_QUEUE_COMPUTE_BIT) && !(queue_flags & VK_QUEUE_GRAPHICS_BIT);
+		}, [](const VkQueueFamilyProperties& props) constexpr noexcept { return props.queueFlags; });
+
+		if (computing_it == all_qf.end()) {
+			return nullopt;
+		} else {
+			return static_cast<uint32_t>(distance(all_qf.begin(), computing_it));
+		}
+	}
+
+	//Find a queue family that supports transfer but neither graphics nor compute, usually backed by dedicated copy engines.
+	//Return none if no such queue family is found.
+	optional<uint32_t> findTransferringQueueFamily(const span<const VkQueueFamilyProperties> all_qf) {
+		const auto transferring_it = find_if(all_qf, [](const VkQueueFlags queue_flags) constexpr noexcept {
+			return (queue_flags & VK_QUEUE_TRANSFER_BIT) && !(queue_flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+		}, [](const VkQueueFamilyProperties& props) constexpr noexcept { return props.queueFlags; });
+
+		if (transferring_it == all_qf.end()) {
+			return nullopt;
+		} else {
+			return static_cast<uint32_t>(distance(all_qf.begin(), transferring_it));
+		}
+	}
+
 	//Similarly, find the index to the queue family for presentation.
 	optional<uint32_t> findPresentingQueueFamily(const VkPhysicalDevice device, const VkSurfaceKHR surface, const uint32_t qf_size) {
 		const auto queue_index = iota(0u, qf_size);
@@ -305,6 +451,7 @@ ContextManager::VulkanContext ContextManager::selectPhysicalDevice(
 			continue;
 		}
 
+		const uint32_t computing_queue = findComputingQueueFamily(qf.toSpan()).value_or(*rendering_queue_opt);
 		return VulkanContext {
 			.TotalPhysicalDevice = static_cast<uint32_t>(device.size()),
 			.TotalQueueFamily = static_cast<uint32_t>(qf.size()),
@@ -313,13 +460,48 @@ ContextManager::VulkanContext ContextManager::selectPhysicalDevice(
 
 			.PhysicalDevice = d,
 			.RenderingQueueFamily = *rendering_queue_opt,
-			.PresentingQueueFamily = *presenting_queue_opt
+			.PresentingQueueFamily = *presenting_queue_opt,
+			.ComputingQueueFamily = computing_queue,
+			.TransferringQueueFamily = findTransferringQueueFamily(qf.toSpan()).value_or(computing_queue),
+
+			.MeshShaderSupport = isMeshShaderSupported(d, ext.toSpan()),
+			.RayTracingPipelineSupport = isRayTracingPipelineSupported(d, ext.toSpan()),
+			.MultiviewTessellationSupport = isMultiviewTessellationSupported(d),
+			.PipelineStatisticsQuerySupport = isPipelineStatisticsQuerySupported(d),
+			.HostImageCopySupport = isHostImageCopySupported(d, ext.toSpan())
 		};
 	}
 
 	throw runtime_error("No suitable physical device was found that meets all requirements.");
 }
 
+bool ContextManager::isInstanceExtensionSupported(const ExtensionName& extension) {
+	const StaticArray<VkExtensionProperties> all_extension = getInstanceExtension();
+
+	auto ext_arr = StaticArray<const char*>(extension.size());
+	copy(extension, ext_arr.data());
+	sort(ext_arr.toSpan(), ::stringLessThan<>);
+
+	return includes(all_extension.toSpan(), ext_arr.toSpan(), ::stringLessThan<>,
+		[](const VkExtensionProperties& props) constexpr noexcept -> const char* { return props.extensionName; });
+}
+
+bool ContextManager::isDeviceExtensionSupported(const VkPhysicalDevice device, const ExtensionName& extension) {
+	const StaticArray<VkExtensionProperties> all_extension = getDeviceExtension(device);
+
+	//`includes` function requires both ranges to be sorted
+	auto ext_arr = StaticArray<const char*>(extension.size());
+	copy(extension, ext_arr.data());
+	sort(ext_arr.toSpan(), ::stringLessThan<>);
+
+	return includes(all_extension.toSpan(), ext_arr.toSpan(), ::stringLessThan<>,
+		[](const VkExtensionProperties& props) constexpr noexcept -> const char* { return props.extensionName; });
+}
+
+StaticArray<VkPresentModeKHR> ContextManager::querySurfacePresentMode(const VkPhysicalDevice device, const VkSurfaceKHR surface) {
+	return getSurfacePresentMode(device, surface);
+}
+
 ContextManager::SwapchainImage ContextManager::querySwapchainImage(const VkDevice device, const VkSwapchainKHR sc, const VkFormat format) {
 	uint32_t img_count;
 	CHECK_VULKAN_ERROR(vkGetSwapchainImagesKHR(device, sc, &img_count, nullptr));
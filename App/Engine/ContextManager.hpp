@@ -32,7 +32,9 @@ namespace LearnVulkan {
 			VkPhysicalDeviceVulkan11Properties,
 			VkPhysicalDeviceVulkan12Properties,
 			VkPhysicalDeviceVulkan13Properties,
-			VkPhysicalDeviceDescriptorBufferPropertiesEXT
+			VkPhysicalDeviceDescriptorBufferPropertiesEXT,
+			VkPhysicalDeviceAccelerationStructurePropertiesKHR,
+			VkPhysicalDeviceRayTracingPipelinePropertiesKHR
 		>>;
 
 		/**
@@ -78,6 +80,19 @@ namespace LearnVulkan {
 			//The context for the application.
 			VkPhysicalDevice PhysicalDevice;
 			uint32_t RenderingQueueFamily, PresentingQueueFamily;/**< Index into the queue family for rendering and presentation. */
+			//Index into the queue family for asynchronous compute.
+			//A compute-only queue family is preferred, otherwise it is the same as the rendering queue family.
+			uint32_t ComputingQueueFamily;
+			//Index into the queue family for uploading data.
+			//A transfer-only queue family is preferred, otherwise it is the same as the computing queue family.
+			uint32_t TransferringQueueFamily;
+
+			//Optional features of the selected physical device, which are not part of the device requirement.
+			bool MeshShaderSupport;/**< True if task and mesh shader from VK_EXT_mesh_shader are supported. */
+			bool RayTracingPipelineSupport;/**< True if ray tracing pipeline from VK_KHR_ray_tracing_pipeline is supported. */
+			bool MultiviewTessellationSupport;/**< True if tessellation shader can be used with multiview. */
+			bool PipelineStatisticsQuerySupport;/**< True if pipeline statistics can be queried. */
+			bool HostImageCopySupport;/**< True if the host can copy to images from VK_EXT_host_image_copy. */
 
 		};
 
@@ -98,6 +113,29 @@ namespace LearnVulkan {
 		*/
 		VulkanContext selectPhysicalDevice(VkInstance, VkSurfaceKHR, const DeviceRequirement&);
 
+		/**
+		 * @brief Check if all given instance extensions are supported.
+		 * @param extension The extensions to be checked.
+		 * @return True if all extensions are supported.
+		*/
+		bool isInstanceExtensionSupported(const ExtensionName&);
+
+		/**
+		 * @brief Check if all given extensions are supported by a physical device.
+		 * @param device The physical device.
+		 * @param extension The extensions to be checked.
+		 * @return True if all extensions are supported.
+		*/
+		bool isDeviceExtensionSupported(VkPhysicalDevice, const ExtensionName&);
+
+		/**
+		 * @brief Query all present modes supported by a surface.
+		 * @param device The physical device.
+		 * @param surface The surface.
+		 * @return An array of supported present modes.
+		*/
+		StaticArray<VkPresentModeKHR> querySurfacePresentMode(VkPhysicalDevice, VkSurfaceKHR);
+
 		/**
 		 * @brief Query the image from a swap chain object.
 		 * @param device The device.
@@ -0,0 +1,183 @@
+#include "CpuProfiler.hpp"
+#include "EngineSetting.hpp"
+
+#include <memory>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+using std::unique_ptr, std::make_unique;
+using std::vector;
+using std::ostream, std::ostringstream;
+using std::mutex, std::lock_guard;
+
+namespace chrono = std::chrono;
+
+using namespace LearnVulkan;
+
+namespace {
+
+	//The number of most recent scopes kept by each thread.
+	constexpr size_t ThreadEventCapacity = 1u << 16u;
+
+	struct ScopeEvent {
+
+		const char* Name;
+		int64_t Begin, End;/**< In nanosecond. */
+
+	};
+
+	//Every access is guarded by its mutex, which is only contended while the trace is written.
+	struct ThreadTrace {
+
+		mutex Mutex;
+		const char* Name = nullptr;
+
+		vector<ScopeEvent> Event;
+		size_t NextEvent = 0u;/**< The oldest event once the ring is full. */
+
+	};
+
+	struct TraceRegistry {
+
+		const chrono::steady_clock::time_point Origin = chrono::steady_clock::now();
+
+		mutex Mutex;
+		//Thread traces are never destroyed with the thread, such that scopes of finished threads remain in the timeline.
+		vector<unique_ptr<ThreadTrace>> Thread;
+
+		std::atomic_bool DebugLabel = false;
+
+	};
+
+	TraceRegistry& getRegistry() {
+		static TraceRegistry registry;
+		return registry;
+	}
+
+	ThreadTrace& getThreadTrace() {
+		thread_local ThreadTrace* const trace = []() {
+			auto thread_trace = make_unique<ThreadTrace>();
+			thread_trace->Event.reserve(::ThreadEventCapacity);
+
+			TraceRegistry& registry = ::getRegistry();
+			const lock_guard lock(registry.Mutex);
+			return registry.Thread.emplace_back(std::move(thread_trace)).get();
+		}();
+		return *trace;
+	}
+
+	inline int64_t now() noexcept {
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - ::getRegistry().Origin).count();
+	}
+
+	inline bool isDebugLabelEnabled() noexcept {
+		return EngineSetting::EnableCpuProfiler && ::getRegistry().DebugLabel.load(std::memory_order_relaxed);
+	}
+
+	inline VkDebugUtilsLabelEXT createLabel(const char* const name) noexcept {
+		return {
+			.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
+			.pLabelName = name
+		};
+	}
+
+}
+
+CpuProfiler::Scope::Scope(const char* const name) noexcept : Name(name), Begin(::now()) {
+
+}
+
+CpuProfiler::Scope::~Scope() {
+	const ScopeEvent event {
+		.Name = this->Name,
+		.Begin = this->Begin,
+		.End = ::now()
+	};
+
+	ThreadTrace& trace = ::getThreadTrace();
+	const lock_guard lock(trace.Mutex);
+	if (trace.Event.size() < ::ThreadEventCapacity) {
+		trace.Event.push_back(event);
+	} else {
+		trace.Event[trace.NextEvent] = event;
+		trace.NextEvent = (trace.NextEvent + 1u) % ::ThreadEventCapacity;
+	}
+}
+
+void CpuProfiler::nameThread(const char* const name) noexcept {
+	if constexpr (EngineSetting::EnableCpuProfiler) {
+		ThreadTrace& trace = ::getThreadTrace();
+		const lock_guard lock(trace.Mutex);
+		trace.Name = name;
+	}
+}
+
+void CpuProfiler::enableDebugLabel() noexcept {
+	::getRegistry().DebugLabel.store(true, std::memory_order_relaxed);
+}
+
+void CpuProfiler::beginCommandLabel(const VkCommandBuffer cmd, const char* const name) noexcept {
+	if (::isDebugLabelEnabled()) {
+		const VkDebugUtilsLabelEXT label = ::createLabel(name);
+		vkCmdBeginDebugUtilsLabelEXT(cmd, &label);
+	}
+}
+
+void CpuProfiler::endCommandLabel(const VkCommandBuffer cmd) noexcept {
+	if (::isDebugLabelEnabled()) {
+		vkCmdEndDebugUtilsLabelEXT(cmd);
+	}
+}
+
+void CpuProfiler::beginQueueLabel(const VkQueue queue, const char* const name) noexcept {
+	if (::isDebugLabelEnabled()) {
+		const VkDebugUtilsLabelEXT label = ::createLabel(name);
+		vkQueueBeginDebugUtilsLabelEXT(queue, &label);
+	}
+}
+
+void CpuProfiler::endQueueLabel(const VkQueue queue) noexcept {
+	if (::isDebugLabelEnabled()) {
+		vkQueueEndDebugUtilsLabelEXT(queue);
+	}
+}
+
+void CpuProfiler::writeChromeTrace(ostream& out) {
+	//timestamps of Chrome trace are in microsecond
+	ostringstream trace;
+	trace << std::fixed << std::setprecision(3);
+	trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first_event = true;
+	const auto writeEventHeader = [&trace, &first_event](const char* const name, const char phase, const size_t thread) {
+		trace << (first_event ? "\n" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"" << phase
+			<< "\",\"pid\":0,\"tid\":" << thread;
+		first_event = false;
+	};
+
+	TraceRegistry& registry = ::getRegistry();
+	const lock_guard registry_lock(registry.Mutex);
+	for (size_t thread = 0u; thread < registry.Thread.size(); thread++) {
+		ThreadTrace& thread_trace = *registry.Thread[thread];
+		const lock_guard trace_lock(thread_trace.Mutex);
+
+		if (thread_trace.Name) {
+			writeEventHeader("thread_name", 'M', thread);
+			trace << ",\"args\":{\"name\":\"" << thread_trace.Name << "\"}}";
+		}
+		//events are written from the oldest, which is the next to be overwritten once the ring is full
+		const size_t event_count = thread_trace.Event.size();
+		for (size_t i = 0u; i < event_count; i++) {
+			const auto [name, begin, end] = thread_trace.Event[(thread_trace.NextEvent + i) % event_count];
+			writeEventHeader(name, 'X', thread);
+			trace << ",\"ts\":" << begin * 1e-3 << ",\"dur\":" << (end - begin) * 1e-3 << '}';
+		}
+	}
+	trace << "\n]}";
+	out << trace.view();
+}
\ No newline at end of file
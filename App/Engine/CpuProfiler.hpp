@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Volk/volk.h>
+
+#include <ostream>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief A CPU profiler that records named scopes of every thread into a timeline, which can be exported as a Chrome trace.
+	 * It also emits debug utils labels into command buffers and queues, such that GPU captures line up with the timeline.
+	 * Each thread keeps its most recent scopes in a ring of fixed capacity, so recording never allocates after the first scope.
+	 * Nothing is recorded unless the profiler is compiled in, see EngineSetting::EnableCpuProfiler.
+	*/
+	namespace CpuProfiler {
+
+		/**
+		 * @brief Mark a scope on the calling thread, from construction to destruction.
+		 * Use CPU_PROFILE_SCOPE instead, which compiles to nothing if the profiler is disabled.
+		*/
+		class Scope {
+		private:
+
+			const char* const Name;
+			const int64_t Begin;/**< In nanosecond. */
+
+		public:
+
+			/**
+			 * @brief Begin a scope.
+			 * @param name The name of the scope. It must have static storage duration and needs no escape in JSON.
+			*/
+			explicit Scope(const char*) noexcept;
+
+			Scope(const Scope&) = delete;
+
+			Scope(Scope&&) = delete;
+
+			Scope& operator=(const Scope&) = delete;
+
+			Scope& operator=(Scope&&) = delete;
+
+			/**
+			 * @brief End the scope and record it to the timeline.
+			*/
+			~Scope();
+
+		};
+
+		/**
+		 * @brief Name the calling thread in the timeline.
+		 * @param name The name of the thread, with the same requirement as the name of a scope.
+		*/
+		void nameThread(const char*) noexcept;
+
+		/**
+		 * @brief Allow emitting debug utils labels.
+		 * It should only be called once the debug utils instance extension is enabled and its commands are loaded.
+		*/
+		void enableDebugLabel() noexcept;
+
+		/**
+		 * @brief Record a command to open a debug utils label region.
+		 * Regions in a secondary command buffer must be closed in the same command buffer.
+		 * @param cmd The command buffer.
+		 * @param name The name of the region.
+		*/
+		void beginCommandLabel(VkCommandBuffer, const char*) noexcept;
+
+		/**
+		 * @brief Record a command to close the last opened debug utils label region.
+		 * @param cmd The command buffer.
+		*/
+		void endCommandLabel(VkCommandBuffer) noexcept;
+
+		/**
+		 * @brief Open a debug utils label region in a queue.
+		 * @param queue The queue.
+		 * @param name The name of the region.
+		*/
+		void beginQueueLabel(VkQueue, const char*) noexcept;
+
+		/**
+		 * @brief Close the last opened debug utils label region in a queue.
+		 * @param queue The queue.
+		*/
+		void endQueueLabel(VkQueue) noexcept;
+
+		/**
+		 * @brief Write the timeline of every thread as a Chrome trace JSON.
+		 * Scopes still open are not included.
+		 * @param out The stream to be written to.
+		*/
+		void writeChromeTrace(std::ostream&);
+
+	}
+
+}
+
+#define LEARN_VULKAN_CPU_PROFILE_SCOPE_NAME_IMPL(LINE) _CpuProfileScope##LINE
+#define LEARN_VULKAN_CPU_PROFILE_SCOPE_NAME(LINE) LEARN_VULKAN_CPU_PROFILE_SCOPE_NAME_IMPL(LINE)
+#ifdef LEARN_VULKAN_ENABLE_CPU_PROFILER
+#define CPU_PROFILE_SCOPE(NAME) const LearnVulkan::CpuProfiler::Scope LEARN_VULKAN_CPU_PROFILE_SCOPE_NAME(__LINE__) { NAME }
+#else
+#define CPU_PROFILE_SCOPE(NAME) static_cast<void>(0)
+#endif
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "DepthPyramid.hpp"
+
+#include "Abstraction/ImageManager.hpp"
+#include "Abstraction/PipelineBarrier.hpp"
+#include "Abstraction/ShaderModuleManager.hpp"
+#include "../Common/File.hpp"
+
+#include <LearnVulkan/GeneratedTemplate/ResourcePath.hpp>
+
+#include <shaderc/shaderc.h>
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <bit>
+
+using std::array, std::string_view;
+using std::ostream, std::endl;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	//each invocation reduces the footprint of a texel on the destination level
+	constexpr uint32_t ReductionLocalSize = 8u;
+
+	constexpr string_view DepthPyramidCS = "/DepthPyramid.comp";
+	constexpr auto DepthPyramidShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, DepthPyramidCS>();
+	constexpr auto DepthPyramidShaderFilename = File::batchRawStringToView(DepthPyramidShaderFilenameRaw);
+
+	inline VKO::DescriptorSetLayout createReductionDescriptorSetLayout(const VkDevice device) {
+		constexpr static array<VkDescriptorSetLayoutBinding, 2u> reduction {{
+			{
+				.binding = 0u,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = 1u,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+			},
+			{
+				.binding = 1u,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = 1u,
+				.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+			}
+		}};
+		constexpr static VkDescriptorSetLayoutCreateInfo reduction_ds {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT | VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR,
+			.bindingCount = static_cast<uint32_t>(reduction.size()),
+			.pBindings = reduction.data()
+		};
+		return VKO::createDescriptorSetLayout(device, reduction_ds);
+	}
+
+	inline VKO::PipelineLayout createReductionPipelineLayout(const VkDevice device, const VkDescriptorSetLayout ds_layout) {
+		return VKO::createPipelineLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1u,
+			.pSetLayouts = &ds_layout
+		});
+	}
+
+	inline VkImageSubresourceRange createLevelSubresourceRange(const uint32_t level, const uint32_t count) noexcept {
+		return {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = level,
+			.levelCount = count,
+			.baseArrayLayer = 0u,
+			.layerCount = 1u
+		};
+	}
+
+}
+
+DepthPyramid::DepthPyramid(const VulkanContext& ctx, DescriptorHeap& heap, ostream& msg) : Context(&ctx), Heap(&heap),
+	ReductionLayout(::createReductionDescriptorSetLayout(ctx.Device)),
+	PipelineLayout(::createReductionPipelineLayout(ctx.Device, this->ReductionLayout)),
+	Sampler(VKO::createSampler(ctx.Device, {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_NEAREST,
+		.minFilter = VK_FILTER_NEAREST,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.maxLod = VK_LOD_CLAMP_NONE
+	})), Extent { } {
+	msg << "Compiling depth pyramid shader" << endl;
+	constexpr static shaderc_shader_kind compute_shader = shaderc_compute_shader;
+	const ShaderModuleManager::ShaderBatchCompilationInfo reduction_info {
+		.Device = ctx.Device,
+		.ShaderFilename = ::DepthPyramidShaderFilename.data(),
+		.ShaderKind = &compute_shader
+	};
+	const auto reduction_shader_gen = ShaderModuleManager::batchShaderCompilation<1u>(&reduction_info, &msg);
+
+	this->Pipeline = VKO::createComputePipeline(ctx.Device, ctx.PipelineCache, {
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+#ifndef NDEBUG
+		| VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT
+#endif
+		,
+		.stage = reduction_shader_gen.promise().ShaderStage.front(),
+		.layout = this->PipelineLayout
+	});
+
+	//image descriptor is written when the pyramid is reshaped
+	this->HeapSlot.Image = heap.allocate(DescriptorHeap::DescriptorType::SampledImage);
+	this->HeapSlot.Sampler = heap.addSampler(this->Sampler);
+}
+
+void DepthPyramid::reshape(const VkExtent2D extent) {
+	const VkDevice device = this->Context->Device;
+	//ensure to destroy image views before image
+	this->FullView = { };
+	this->LevelView.clear();
+
+	this->Extent = {
+		std::bit_floor(std::max(extent.width, 1u)),
+		std::bit_floor(std::max(extent.height, 1u))
+	};
+	const auto [w, h] = this->Extent;
+	const uint32_t level = static_cast<uint32_t>(std::bit_width(std::max(w, h)));
+
+	this->Image = ImageManager::createImage({
+		.Device = device,
+		.Allocator = this->Context->Allocator,
+		.Category = VKO::AllocationCategory::Attachment,
+
+		.ImageType = VK_IMAGE_TYPE_2D,
+		.Format = DepthPyramid::Format,
+		.Extent = { w, h, 1u },
+		.Level = level,
+		.Usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT
+	});
+
+	VkImageViewCreateInfo view_info {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = this->Image.second,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = DepthPyramid::Format,
+		.subresourceRange = ::createLevelSubresourceRange(0u, level)
+	};
+	this->FullView = VKO::createImageView(device, view_info);
+
+	this->LevelView.reserve(level);
+	for (uint32_t i = 0u; i < level; i++) {
+		view_info.subresourceRange = ::createLevelSubresourceRange(i, 1u);
+		this->LevelView.push_back(VKO::createImageView(device, view_info));
+	}
+
+	this->Heap->writeSampledImage(this->HeapSlot.Image, this->FullView, DepthPyramid::Layout);
+}
+
+void DepthPyramid::record(const VkCommandBuffer cmd, const BuildInfo& build_info) const {
+	const auto [depth, depth_view, depth_layout, depth_stage, depth_access] = build_info;
+	const uint32_t level = static_cast<uint32_t>(this->LevelView.size());
+
+	/*************
+	 * Barrier
+	 ************/
+	{
+		PipelineBarrier<0u, 0u, 2u> barrier;
+		barrier.addImageBarrier({
+			depth_stage,
+			depth_access,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
+		}, {
+			depth_layout,
+			depth_layout
+		}, depth, ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_DEPTH_BIT));
+		//the old content is fully overwritten, but may still be read by the previous build
+		barrier.addImageBarrier({
+			DepthPyramid::ReadStage,
+			VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		}, {
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			DepthPyramid::Layout
+		}, this->Image.second, ::createLevelSubresourceRange(0u, level));
+		barrier.record(cmd);
+	}
+
+	/**************
+	 * Reduction
+	 *************/
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->Pipeline);
+	for (uint32_t i = 0u; i < level; i++) {
+		//the base level is reduced from the depth, and every other level from the level above
+		const VkDescriptorImageInfo source {
+			.sampler = this->Sampler,
+			.imageView = i == 0u ? depth_view : *this->LevelView[i - 1u],
+			.imageLayout = i == 0u ? depth_layout : DepthPyramid::Layout
+		}, destination {
+			.imageView = this->LevelView[i],
+			.imageLayout = DepthPyramid::Layout
+		};
+		const array<VkWriteDescriptorSet, 2u> reduction_write {{
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstBinding = 0u,
+				.dstArrayElement = 0u,
+				.descriptorCount = 1u,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo = &source
+			},
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstBinding = 1u,
+				.dstArrayElement = 0u,
+				.descriptorCount = 1u,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.pImageInfo = &destination
+			}
+		}};
+		vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->PipelineLayout, 0u,
+			static_cast<uint32_t>(reduction_write.size()), reduction_write.data());
+
+		const uint32_t w = std::max(this->Extent.width >> i, 1u),
+			h = std::max(this->Extent.height >> i, 1u);
+		vkCmdDispatch(cmd, (w + ::ReductionLocalSize - 1u) / ::ReductionLocalSize, (h + ::ReductionLocalSize - 1u) / ::ReductionLocalSize, 1u);
+
+		//make the level visible to the next level, as well as to reads after build
+		PipelineBarrier<0u, 0u, 1u> barrier;
+		barrier.addImageBarrier({
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | DepthPyramid::ReadStage,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | DepthPyramid::ReadAccess
+		}, {
+			DepthPyramid::Layout,
+			DepthPyramid::Layout
+		}, this->Image.second, ::createLevelSubresourceRange(i, 1u));
+		barrier.record(cmd);
+	}
+}
+
+uint32_t DepthPyramid::imageHeapIndex() const noexcept {
+	return this->HeapSlot.Image.index();
+}
+
+uint32_t DepthPyramid::samplerHeapIndex() const noexcept {
+	return this->HeapSlot.Sampler.index();
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "DescriptorHeap.hpp"
+#include "VulkanContext.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <ostream>
+#include <vector>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief A hierarchical depth buffer, where each texel on every level keeps the farthest depth of its footprint,
+	 * for conservative occlusion test of screen space bounds.
+	 * Depth is assumed to be reversed, such that the farthest depth is the smallest.
+	 * The base level has the largest power-of-two extent no greater than the source depth, so every level below is an exact 2x2 reduction.
+	 * The pyramid is stored in a single-channel 32-bit float image in general layout, and is added to the descriptor heap.
+	*/
+	class DepthPyramid {
+	public:
+
+		/**
+		 * @brief Information to build the pyramid from a depth image.
+		*/
+		struct BuildInfo {
+
+			VkImage Depth;
+			VkImageView DepthView;/**< Of the depth aspect, with a single level. */
+			VkImageLayout DepthLayout;/**< Which remains unchanged. */
+			//Stage and access of the last write to the depth image.
+			VkPipelineStageFlags2 DepthStage;
+			VkAccessFlags2 DepthAccess;
+
+		};
+
+		constexpr static VkFormat Format = VK_FORMAT_R32_SFLOAT;
+		constexpr static VkImageLayout Layout = VK_IMAGE_LAYOUT_GENERAL;
+		//Stage and access that can read the pyramid after build.
+		constexpr static VkPipelineStageFlags2 ReadStage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		constexpr static VkAccessFlags2 ReadAccess = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+
+	private:
+
+		const VulkanContext* const Context;
+		DescriptorHeap* const Heap;
+
+		const VulkanObject::DescriptorSetLayout ReductionLayout;
+		const VulkanObject::PipelineLayout PipelineLayout;
+		VulkanObject::Pipeline Pipeline;
+		const VulkanObject::Sampler Sampler;
+
+		VulkanObject::ImageAllocation Image;
+		std::vector<VulkanObject::ImageView> LevelView;
+		VulkanObject::ImageView FullView;
+		VkExtent2D Extent;/**< Of the base level. */
+
+		struct {
+
+			DescriptorHeap::Slot Image, Sampler;
+
+		} HeapSlot;
+
+	public:
+
+		/**
+		 * @brief Create an empty depth pyramid.
+		 * @param ctx The context. The context is retained and must remain valid until the pyramid is destroyed.
+		 * @param heap The heap where the pyramid is added to. The heap is retained.
+		 * @param msg A stream to receive diagnostic messages.
+		*/
+		DepthPyramid(const VulkanContext&, DescriptorHeap&, std::ostream&);
+
+		DepthPyramid(const DepthPyramid&) = delete;
+
+		DepthPyramid(DepthPyramid&&) = delete;
+
+		DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+		DepthPyramid& operator=(DepthPyramid&&) = delete;
+
+		~DepthPyramid() = default;
+
+		/**
+		 * @brief Recreate the pyramid for a new extent of source depth.
+		 * Content of the pyramid is undefined until the next build, and the old pyramid must not be in use by the device.
+		 * @param extent The extent of source depth.
+		*/
+		void reshape(VkExtent2D);
+
+		/**
+		 * @brief Record command to build every level of the pyramid.
+		 * The pyramid must not be read before the build, and can be read by the read stage and access after.
+		 * @param cmd The command buffer, which must be on a queue supporting compute.
+		 * @param build_info The build info.
+		*/
+		void record(VkCommandBuffer, const BuildInfo&) const;
+
+		/**
+		 * @brief Get the index of the pyramid image and its nearest sampler in the descriptor heap.
+		 * Every level of the pyramid is accessible through the image.
+		*/
+		uint32_t imageHeapIndex() const noexcept;
+		uint32_t samplerHeapIndex() const noexcept;
+
+	};
+
+}
\ No newline at end of file
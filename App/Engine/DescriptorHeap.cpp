@@ -0,0 +1,222 @@
+#include "DescriptorHeap.hpp"
+
+#include "Abstraction/BufferManager.hpp"
+#include "../Common/ErrorHandler.hpp"
+
+#include <algorithm>
+#include <ranges>
+#include <string>
+#include <utility>
+
+#include <stdexcept>
+#include <cassert>
+
+using std::array;
+using std::runtime_error;
+using std::ranges::views::iota;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	constexpr VkDescriptorType toVulkanDescriptorType(const DescriptorHeap::DescriptorType type) noexcept {
+		using enum DescriptorHeap::DescriptorType;
+		switch (type) {
+		case Sampler: return VK_DESCRIPTOR_TYPE_SAMPLER;
+		case SampledImage: return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		default: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		}
+	}
+
+	constexpr size_t toBinding(const DescriptorHeap::DescriptorType type) noexcept {
+		return static_cast<size_t>(type);
+	}
+
+	VKO::DescriptorSetLayout createHeapDescriptorSetLayout(const VkDevice device, const array<uint32_t, 3u>& capacity) {
+		array<VkDescriptorSetLayoutBinding, 3u> binding;
+		std::ranges::transform(iota(0u, static_cast<uint32_t>(binding.size())), binding.begin(), [&capacity](const auto i) {
+			return VkDescriptorSetLayoutBinding {
+				.binding = i,
+				.descriptorType = ::toVulkanDescriptorType(static_cast<DescriptorHeap::DescriptorType>(i)),
+				.descriptorCount = capacity[i],
+				.stageFlags = VK_SHADER_STAGE_ALL
+			};
+		});
+		//not every index is written, and shaders only access those that are written
+		array<VkDescriptorBindingFlags, 3u> binding_flag;
+		binding_flag.fill(VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT);
+
+		const VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flag_info {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+			.bindingCount = static_cast<uint32_t>(binding_flag.size()),
+			.pBindingFlags = binding_flag.data()
+		};
+		return VKO::createDescriptorSetLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.pNext = &binding_flag_info,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT,
+			.bindingCount = static_cast<uint32_t>(binding.size()),
+			.pBindings = binding.data()
+		});
+	}
+
+}
+
+DescriptorHeap::Slot::Slot() noexcept : Heap(nullptr), Type(DescriptorType::Sampler), Index(0u) {
+
+}
+
+DescriptorHeap::Slot::Slot(DescriptorHeap& heap, const DescriptorType type, const uint32_t index) noexcept :
+	Heap(&heap), Type(type), Index(index) {
+
+}
+
+DescriptorHeap::Slot::Slot(Slot&& slot) noexcept :
+	Heap(std::exchange(slot.Heap, nullptr)), Type(slot.Type), Index(slot.Index) {
+
+}
+
+DescriptorHeap::Slot& DescriptorHeap::Slot::operator=(Slot&& slot) noexcept {
+	if (this != &slot) {
+		if (this->Heap) {
+			this->Heap->release(this->Type, this->Index);
+		}
+		this->Heap = std::exchange(slot.Heap, nullptr);
+		this->Type = slot.Type;
+		this->Index = slot.Index;
+	}
+	return *this;
+}
+
+DescriptorHeap::Slot::~Slot() {
+	if (this->Heap) {
+		this->Heap->release(this->Type, this->Index);
+	}
+}
+
+DescriptorHeap::DescriptorType DescriptorHeap::Slot::type() const noexcept {
+	return this->Type;
+}
+
+uint32_t DescriptorHeap::Slot::index() const noexcept {
+	return this->Index;
+}
+
+DescriptorHeap::DescriptorHeap(const VulkanContext& ctx) : Context(&ctx),
+	Descriptor {
+		DescriptorArray { .Capacity = std::min(DescriptorHeap::SamplerCapacity, ctx.PhysicalDeviceProperty.Limit.maxPerStageDescriptorSamplers) },
+		DescriptorArray { .Capacity = std::min(DescriptorHeap::SampledImageCapacity, ctx.PhysicalDeviceProperty.Limit.maxPerStageDescriptorSampledImages) },
+		DescriptorArray { .Capacity = std::min(DescriptorHeap::StorageBufferCapacity, ctx.PhysicalDeviceProperty.Limit.maxPerStageDescriptorStorageBuffers) }
+	},
+	SetLayout(::createHeapDescriptorSetLayout(ctx.Device, {
+		this->Descriptor[0].Capacity, this->Descriptor[1].Capacity, this->Descriptor[2].Capacity })) {
+	const VkDevice device = ctx.Device;
+	const VkPhysicalDeviceDescriptorBufferPropertiesEXT& prop = ctx.PhysicalDeviceProperty.DescriptorBuffer;
+
+	const array<size_t, 3u> descriptor_size { prop.samplerDescriptorSize, prop.sampledImageDescriptorSize, prop.storageBufferDescriptorSize };
+	for (const auto i : iota(size_t { 0 }, this->Descriptor.size())) {
+		auto& [free, next, capacity, offset, size] = this->Descriptor[i];
+		next = 0u;
+		size = descriptor_size[i];
+		vkGetDescriptorSetLayoutBindingOffsetEXT(device, this->SetLayout, static_cast<uint32_t>(i), &offset);
+	}
+
+	VkDeviceSize heap_size;
+	vkGetDescriptorSetLayoutSizeEXT(device, this->SetLayout, &heap_size);
+	this->Memory = BufferManager::createDescriptorBuffer({ device, ctx.Allocator, heap_size },
+		VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT);
+	this->Data = VKO::mapAllocation<std::byte>(ctx.Allocator, this->Memory.first);
+	this->Address = BufferManager::addressOf(device, this->Memory.second);
+}
+
+void DescriptorHeap::release(const DescriptorType type, const uint32_t index) noexcept {
+	this->Descriptor[::toBinding(type)].Free.push_back(index);
+}
+
+void DescriptorHeap::write(const Slot& slot, const VkDescriptorGetInfoEXT& get_info) {
+	const DescriptorArray& descriptor = this->Descriptor[::toBinding(slot.type())];
+	assert(get_info.type == ::toVulkanDescriptorType(slot.type()));
+
+	const VkDeviceSize offset = descriptor.Offset + slot.index() * descriptor.Size;
+	vkGetDescriptorEXT(this->Context->Device, &get_info, descriptor.Size, this->Data.get() + offset);
+	CHECK_VULKAN_ERROR(vmaFlushAllocation(this->Context->Allocator, this->Memory.first, offset, descriptor.Size));
+}
+
+DescriptorHeap::Slot DescriptorHeap::allocate(const DescriptorType type) {
+	auto& [free, next, capacity, offset, size] = this->Descriptor[::toBinding(type)];
+	if (!free.empty()) {
+		const uint32_t index = free.back();
+		free.pop_back();
+		return Slot(*this, type, index);
+	}
+	if (next == capacity) {
+		using namespace std::string_literals;
+		throw runtime_error("Descriptor heap has run out of descriptor at binding "s + std::to_string(::toBinding(type))
+			+ ", the capacity is "s + std::to_string(capacity));
+	}
+	return Slot(*this, type, next++);
+}
+
+void DescriptorHeap::writeSampler(const Slot& slot, const VkSampler sampler) {
+	this->write(slot, {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+		.type = VK_DESCRIPTOR_TYPE_SAMPLER,
+		.data = { .pSampler = &sampler }
+	});
+}
+
+void DescriptorHeap::writeSampledImage(const Slot& slot, const VkImageView image_view, const VkImageLayout image_layout) {
+	const VkDescriptorImageInfo image_info {
+		.imageView = image_view,
+		.imageLayout = image_layout
+	};
+	this->write(slot, {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+		.type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+		.data = { .pSampledImage = &image_info }
+	});
+}
+
+void DescriptorHeap::writeStorageBuffer(const Slot& slot, const VkDeviceAddress address, const VkDeviceSize range) {
+	const VkDescriptorAddressInfoEXT address_info {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
+		.address = address,
+		.range = range
+	};
+	this->write(slot, {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+		.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		.data = { .pStorageBuffer = &address_info }
+	});
+}
+
+DescriptorHeap::Slot DescriptorHeap::addSampler(const VkSampler sampler) {
+	Slot slot = this->allocate(DescriptorType::Sampler);
+	this->writeSampler(slot, sampler);
+	return slot;
+}
+
+DescriptorHeap::Slot DescriptorHeap::addSampledImage(const VkImageView image_view, const VkImageLayout image_layout) {
+	Slot slot = this->allocate(DescriptorType::SampledImage);
+	this->writeSampledImage(slot, image_view, image_layout);
+	return slot;
+}
+
+DescriptorHeap::Slot DescriptorHeap::addStorageBuffer(const VkDeviceAddress address, const VkDeviceSize range) {
+	Slot slot = this->allocate(DescriptorType::StorageBuffer);
+	this->writeStorageBuffer(slot, address, range);
+	return slot;
+}
+
+VkDescriptorSetLayout DescriptorHeap::descriptorSetLayout() const noexcept {
+	return this->SetLayout;
+}
+
+VkDescriptorBufferBindingInfoEXT DescriptorHeap::descriptorBufferBindingInfo() const noexcept {
+	return {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
+		.address = this->Address,
+		.usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT
+	};
+}
\ No newline at end of file
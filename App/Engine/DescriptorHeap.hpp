@@ -0,0 +1,179 @@
+#pragma once
+
+#include "VulkanContext.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <array>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief An engine-wide descriptor buffer with one large array for each type of descriptor.
+	 * Every descriptor is given a stable index into the array of its type, which is passed to shaders by the application,
+	 * such that all renderers share the same descriptor set layout, and the heap only needs to be bound once per command buffer.
+	 * @see Shader/DescriptorHeap.glsl
+	 * The heap is not thread-safe; allocating, writing and releasing descriptors must be externally synchronised.
+	*/
+	class DescriptorHeap {
+	public:
+
+		/**
+		 * @brief The type of descriptor in the heap, whose value is the binding index in the heap set layout.
+		*/
+		enum class DescriptorType : uint8_t {
+			Sampler = 0x00u,
+			SampledImage = 0x01u,
+			StorageBuffer = 0x02u
+		};
+
+		/**
+		 * @brief The maximum number of descriptor of each type.
+		 * The actual capacity is clamped to the per-stage limit of the device.
+		*/
+		constexpr static uint32_t SamplerCapacity = 64u,
+			SampledImageCapacity = 1024u,
+			StorageBufferCapacity = 1024u;
+
+		/**
+		 * @brief A descriptor allocated from the heap.
+		 * The index is returned to the heap when destroyed, and it must be destroyed before the heap.
+		 * The device must have finished using the descriptor when it is destroyed.
+		*/
+		class Slot {
+		private:
+
+			DescriptorHeap* Heap;
+			DescriptorType Type;
+			uint32_t Index;
+
+		public:
+
+			/**
+			 * @brief Initialise a slot with no allocated descriptor.
+			*/
+			Slot() noexcept;
+
+			/**
+			 * @brief Take ownership of an allocated descriptor.
+			 * @param heap The heap where the descriptor is allocated from.
+			 * @param type The type of descriptor.
+			 * @param index The index of descriptor.
+			*/
+			Slot(DescriptorHeap&, DescriptorType, uint32_t) noexcept;
+
+			Slot(const Slot&) = delete;
+
+			Slot(Slot&&) noexcept;
+
+			Slot& operator=(const Slot&) = delete;
+
+			Slot& operator=(Slot&&) noexcept;
+
+			~Slot();
+
+			/**
+			 * @brief Get the type of descriptor.
+			*/
+			DescriptorType type() const noexcept;
+
+			/**
+			 * @brief Get the index of descriptor, which is used by shaders to access the array of its type.
+			*/
+			uint32_t index() const noexcept;
+
+		};
+
+	private:
+
+		struct DescriptorArray {
+
+			std::vector<uint32_t> Free;/**< Released indices to be reused. */
+			uint32_t Next, Capacity;
+
+			VkDeviceSize Offset;/**< In byte, of the binding in the heap. */
+			size_t Size;/**< In byte, of each descriptor. */
+
+		};
+
+		const VulkanContext* const Context;
+
+		std::array<DescriptorArray, 3u> Descriptor;
+		const VulkanObject::DescriptorSetLayout SetLayout;
+
+		VulkanObject::BufferAllocation Memory;
+		VulkanObject::MappedAllocation<std::byte> Data;
+		VkDeviceAddress Address;
+
+		//Return an index to the array.
+		void release(DescriptorType, uint32_t) noexcept;
+
+		//Write descriptor data to the slot and flush it.
+		void write(const Slot&, const VkDescriptorGetInfoEXT&);
+
+	public:
+
+		/**
+		 * @brief Create an empty descriptor heap.
+		 * @param ctx The context. The context is retained and must remain valid until the heap is destroyed.
+		*/
+		DescriptorHeap(const VulkanContext&);
+
+		DescriptorHeap(const DescriptorHeap&) = delete;
+
+		DescriptorHeap(DescriptorHeap&&) = delete;
+
+		DescriptorHeap& operator=(const DescriptorHeap&) = delete;
+
+		DescriptorHeap& operator=(DescriptorHeap&&) = delete;
+
+		/**
+		 * @brief All slots must have been released.
+		*/
+		~DescriptorHeap() = default;
+
+		/**
+		 * @brief Allocate a descriptor without writing to it.
+		 * @param type The type of descriptor.
+		 * @return The allocated slot.
+		 * @exception If the heap has run out of descriptor of this type.
+		*/
+		Slot allocate(DescriptorType);
+
+		/**
+		 * @brief Write a descriptor.
+		 * The descriptor must not be in use by the device.
+		 * @param slot The slot whose type must match the descriptor to be written.
+		 * @param sampler, image_view, image_layout, address, range The descriptor data.
+		*/
+		void writeSampler(const Slot&, VkSampler);
+		void writeSampledImage(const Slot&, VkImageView, VkImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		void writeStorageBuffer(const Slot&, VkDeviceAddress, VkDeviceSize);
+
+		/**
+		 * @brief Allocate a descriptor and write to it.
+		 * @see allocate() and write functions.
+		 * @return The allocated slot.
+		*/
+		Slot addSampler(VkSampler);
+		Slot addSampledImage(VkImageView, VkImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		Slot addStorageBuffer(VkDeviceAddress, VkDeviceSize);
+
+		/**
+		 * @brief Get the descriptor set layout of the heap.
+		*/
+		VkDescriptorSetLayout descriptorSetLayout() const noexcept;
+
+		/**
+		 * @brief Get the binding info of the heap.
+		 * The heap contains only one set which starts at offset zero.
+		*/
+		VkDescriptorBufferBindingInfoEXT descriptorBufferBindingInfo() const noexcept;
+
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "DynamicResolution.hpp"
+
+#include "Abstraction/ImageManager.hpp"
+#include "Abstraction/PipelineBarrier.hpp"
+#include "Abstraction/ShaderModuleManager.hpp"
+#include "../Common/File.hpp"
+
+#include <LearnVulkan/GeneratedTemplate/ResourcePath.hpp>
+
+#include <shaderc/shaderc.h>
+
+#include <algorithm>
+#include <ranges>
+#include <string_view>
+
+#include <cmath>
+
+using std::array, std::string_view;
+using std::ostream, std::endl;
+using std::pair;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	//The difference of scale between two adjacent levels.
+	constexpr float ScaleStep = 0.125f;
+	//Controller parameters, frame time is smoothed with an exponential moving average.
+	constexpr double FrameTimeSmoothing = 0.1,
+		//Frame time within this fraction of the target is considered on target.
+		FrameTimeTolerance = 0.1;
+	constexpr uint32_t SettleFrameCount = 30u;
+
+	struct UpscalePushConstant {
+
+		float Sharpness;
+
+	};
+
+	/*****************
+	 * Shader
+	 ****************/
+	constexpr string_view UpscaleVS = "/DynamicResolution.vert",
+		UpscaleFS = "/DynamicResolution.frag";
+	constexpr array UpscaleShaderKind = { shaderc_vertex_shader, shaderc_fragment_shader };
+
+	constexpr auto UpscaleShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, UpscaleVS, UpscaleFS>();
+	constexpr auto UpscaleShaderFilename = File::batchRawStringToView(UpscaleShaderFilenameRaw);
+
+	/**************
+	 * Setup
+	 *************/
+	inline VKO::DescriptorSetLayout createUpscaleDescriptorSetLayout(const VkDevice device) {
+		constexpr static VkDescriptorSetLayoutBinding source {
+			.binding = 0u,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1u,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+		};
+		constexpr static VkDescriptorSetLayoutCreateInfo upscale_ds {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT | VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR,
+			.bindingCount = 1u,
+			.pBindings = &source
+		};
+		return VKO::createDescriptorSetLayout(device, upscale_ds);
+	}
+
+	inline VKO::PipelineLayout createUpscalePipelineLayout(const VkDevice device, const VkDescriptorSetLayout ds_layout) {
+		constexpr static VkPushConstantRange upscale_pc {
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.offset = 0u,
+			.size = static_cast<uint32_t>(sizeof(::UpscalePushConstant))
+		};
+		return VKO::createPipelineLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1u,
+			.pSetLayouts = &ds_layout,
+			.pushConstantRangeCount = 1u,
+			.pPushConstantRanges = &upscale_pc
+		});
+	}
+
+	PipelineManager::GraphicsPipelineLibrary::LinkedPipeline createUpscalePipeline(const VkDevice device,
+		PipelineManager::GraphicsPipelineLibrary& library, const VkPipelineLayout layout, const VkFormat format, ostream& msg) {
+		msg << "Compiling dynamic resolution shader" << endl;
+		const ShaderModuleManager::ShaderBatchCompilationInfo upscale_info {
+			.Device = device,
+			.ShaderFilename = ::UpscaleShaderFilename.data(),
+			.ShaderKind = ::UpscaleShaderKind.data()
+		};
+		const auto upscale_shader_gen = ShaderModuleManager::batchShaderCompilation<::UpscaleShaderKind.size()>(&upscale_info, &msg);
+
+		const VkPipelineRenderingCreateInfo upscale_rendering {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+			.colorAttachmentCount = 1u,
+			.pColorAttachmentFormats = &format
+		};
+		//every output pixel is written once, with no depth attachment
+		return library.createPipeline(layout, {
+			.ShaderStage = upscale_shader_gen.promise().ShaderStage,
+			.Rendering = &upscale_rendering,
+			.PrimitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+			.CullMode = VK_CULL_MODE_NONE,
+			.Depth = {
+				.Write = false
+			}
+		});
+	}
+
+}
+
+DynamicResolution::DynamicResolution(const VulkanContext& ctx, PipelineManager::GraphicsPipelineLibrary& library,
+	const VkFormat format, const CreateInfo& resolution_info, ostream& msg) : Context(&ctx), Setting(resolution_info), Format(format),
+	ScaleLevelCount(static_cast<uint32_t>(std::floor((1.0f - resolution_info.MinimumScale) / ::ScaleStep)) + 1u),
+	UpscaleLayout(::createUpscaleDescriptorSetLayout(ctx.Device)),
+	PipelineLayout(::createUpscalePipelineLayout(ctx.Device, this->UpscaleLayout)),
+	Pipeline(::createUpscalePipeline(ctx.Device, library, this->PipelineLayout, format, msg)),
+	Sampler(VKO::createSampler(ctx.Device, {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_LINEAR,
+		.minFilter = VK_FILTER_LINEAR,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.maxLod = 0.0f
+	})), OutputExtent { }, RenderExtent { }, ScaleLevel(0u), AverageFrameTime(0.0), SettleFrame(::SettleFrameCount) {
+
+}
+
+inline float DynamicResolution::scaleOf(const uint32_t level) const noexcept {
+	return 1.0f - ::ScaleStep * level;
+}
+
+void DynamicResolution::reshape(const VkExtent2D extent) {
+	const VkDevice device = this->Context->Device;
+	const float scale = this->scaleOf(this->ScaleLevel);
+
+	this->OutputExtent = extent;
+	this->RenderExtent = {
+		std::max(static_cast<uint32_t>(std::round(scale * extent.width)), 1u),
+		std::max(static_cast<uint32_t>(std::round(scale * extent.height)), 1u)
+	};
+	const auto [w, h] = this->RenderExtent;
+
+	for (const auto i : std::views::iota(0u, this->Context->FrameInFlight)) {
+		//ensure to destroy image view before image
+		this->TargetView[i] = { };
+		this->Target[i] = ImageManager::createImage({
+			.Device = device,
+			.Allocator = this->Context->Allocator,
+			.Category = VKO::AllocationCategory::Attachment,
+			.ImageType = VK_IMAGE_TYPE_2D,
+			.Format = this->Format,
+			.Extent = { w, h, 1u },
+			//renderers leave the target in the present layout, which is transfer source when rendering offscreen
+			.Usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+		});
+		this->TargetView[i] = ImageManager::createFullImageView({
+			.Device = device,
+			.Image = this->Target[i].second,
+			.ViewType = VK_IMAGE_VIEW_TYPE_2D,
+			.Format = this->Format,
+			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+		});
+	}
+}
+
+bool DynamicResolution::update(const double frame_time) noexcept {
+	if (this->SettleFrame > 0u) {
+		this->SettleFrame--;
+		this->AverageFrameTime = frame_time;
+		return false;
+	}
+	this->AverageFrameTime += (frame_time - this->AverageFrameTime) * ::FrameTimeSmoothing;
+
+	//frame time is assumed to be proportional to the number of pixel
+	const double target = this->Setting.TargetFrameTime,
+		average = this->AverageFrameTime;
+	uint32_t level = this->ScaleLevel;
+	if (average > target * (1.0 + ::FrameTimeTolerance) && level + 1u < this->ScaleLevelCount) {
+		level++;
+	} else if (level > 0u) {
+		//only go up if the finer level is predicted to stay on target, to avoid oscillating between two levels
+		const double ratio = this->scaleOf(level - 1u) / this->scaleOf(level);
+		if (average * ratio * ratio < target * (1.0 - ::FrameTimeTolerance)) {
+			level--;
+		}
+	}
+	if (level == this->ScaleLevel) {
+		return false;
+	}
+	this->ScaleLevel = level;
+	this->SettleFrame = ::SettleFrameCount;
+	return true;
+}
+
+VkExtent2D DynamicResolution::renderExtent() const noexcept {
+	return this->RenderExtent;
+}
+
+pair<VkImage, VkImageView> DynamicResolution::renderTarget(const unsigned int frame_index) const noexcept {
+	return { this->Target[frame_index].second, this->TargetView[frame_index] };
+}
+
+void DynamicResolution::record(const VkCommandBuffer cmd, const unsigned int frame_index, const VkImage output,
+	const VkImageView output_view) const {
+	const VkImage target = this->Target[frame_index].second;
+	{
+		PipelineBarrier<0u, 0u, 2u> barrier;
+		//the renderer transitions its present image without making it visible to any stage
+		barrier.addImageBarrier({
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
+		}, {
+			this->Context->PresentLayout,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		}, target, ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT));
+		//the output is waited to be available at colour attachment output
+		barrier.addImageBarrier({
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT
+		}, {
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+		}, output, ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT));
+		barrier.record(cmd);
+	}
+
+	const VkRect2D output_area {
+		.offset = { 0, 0 },
+		.extent = this->OutputExtent
+	};
+	const VkRenderingAttachmentInfo output_atm {
+		.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+		.imageView = output_view,
+		.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		.storeOp = VK_ATTACHMENT_STORE_OP_STORE
+	};
+	const VkRenderingInfo output_rendering {
+		.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+		.renderArea = output_area,
+		.layerCount = 1u,
+		.colorAttachmentCount = 1u,
+		.pColorAttachments = &output_atm
+	};
+	vkCmdBeginRendering(cmd, &output_rendering);
+
+	//the render target is stored top row first like the output, so no flip is needed
+	const VkViewport vp {
+		.x = 0.0f,
+		.y = 0.0f,
+		.width = 1.0f * this->OutputExtent.width,
+		.height = 1.0f * this->OutputExtent.height,
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f
+	};
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->Pipeline.get());
+	vkCmdSetViewport(cmd, 0u, 1u, &vp);
+	vkCmdSetScissor(cmd, 0u, 1u, &output_area);
+
+	const VkDescriptorImageInfo source {
+		.sampler = this->Sampler,
+		.imageView = this->TargetView[frame_index],
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	};
+	const VkWriteDescriptorSet upscale_write {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstBinding = 0u,
+		.dstArrayElement = 0u,
+		.descriptorCount = 1u,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.pImageInfo = &source
+	};
+	vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->PipelineLayout, 0u, 1u, &upscale_write);
+	const ::UpscalePushConstant upscale_pc {
+		.Sharpness = this->Setting.Sharpness
+	};
+	vkCmdPushConstants(cmd, this->PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0u, sizeof(upscale_pc), &upscale_pc);
+
+	vkCmdDraw(cmd, 3u, 1u, 0u, 0u);
+	vkCmdEndRendering(cmd);
+
+	PipelineBarrier<0u, 0u, 1u> barrier;
+	barrier.addImageBarrier({
+		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_NONE,
+		VK_ACCESS_2_NONE
+	}, {
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		this->Context->PresentLayout
+	}, output, ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT));
+	barrier.record(cmd);
+}
\ No newline at end of file
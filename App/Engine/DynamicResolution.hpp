@@ -0,0 +1,127 @@
+#pragma once
+
+#include "EngineSetting.hpp"
+#include "VulkanContext.hpp"
+
+#include "Abstraction/PipelineManager.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <ostream>
+#include <array>
+#include <utility>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Render at a lower resolution than the output to hold a target GPU frame time,
+	 * and upscale the result to the output with a contrast adaptive sharpening filter.
+	 * The render extent is a fraction of the output extent from a few discrete scales,
+	 * such that the renderer is only reshaped when the scale changes, which is made infrequent by hysteresis.
+	 * The render target is owned by the controller, one for each in-flight frame.
+	*/
+	class DynamicResolution {
+	public:
+
+		/**
+		 * @brief Information to create a dynamic resolution controller.
+		*/
+		struct CreateInfo {
+
+			double TargetFrameTime;/**< The GPU frame time to hold, in millisecond. */
+			float MinimumScale = 0.5f;/**< Of the render extent relative to the output extent along each axis, in (0, 1]. */
+			float Sharpness = 0.5f;/**< Of the upscale filter, in [0, 1]. */
+
+		};
+
+	private:
+
+		const VulkanContext* const Context;
+		const CreateInfo Setting;
+		const VkFormat Format;
+		const uint32_t ScaleLevelCount;
+
+		const VulkanObject::DescriptorSetLayout UpscaleLayout;
+		const VulkanObject::PipelineLayout PipelineLayout;
+		const PipelineManager::GraphicsPipelineLibrary::LinkedPipeline Pipeline;
+		const VulkanObject::Sampler Sampler;
+
+		//The renderer draws into the target of the in-flight frame, as if it was the present image.
+		std::array<VulkanObject::ImageAllocation, EngineSetting::MaxFrameInFlight> Target;
+		std::array<VulkanObject::ImageView, EngineSetting::MaxFrameInFlight> TargetView;
+		VkExtent2D OutputExtent, RenderExtent;
+
+		uint32_t ScaleLevel;/**< Zero is the full resolution, and each level is a fixed step lower. */
+		double AverageFrameTime;
+		//Results of the next few frames are discarded after the scale changes,
+		//as they may still be measured from frames in flight at the old scale.
+		uint32_t SettleFrame;
+
+		//The scale of render extent along each axis at a level.
+		float scaleOf(uint32_t) const noexcept;
+
+	public:
+
+		/**
+		 * @brief Create a dynamic resolution controller at the full resolution.
+		 * @param ctx The context. The context is retained and must remain valid until the controller is destroyed.
+		 * @param library The library to create the upscale pipeline from.
+		 * @param format The format of output image, which is also the format of render target.
+		 * @param resolution_info The dynamic resolution create info.
+		 * @param msg A stream to receive diagnostic messages.
+		*/
+		DynamicResolution(const VulkanContext&, PipelineManager::GraphicsPipelineLibrary&, VkFormat, const CreateInfo&, std::ostream&);
+
+		DynamicResolution(const DynamicResolution&) = delete;
+
+		DynamicResolution(DynamicResolution&&) = delete;
+
+		DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+		DynamicResolution& operator=(DynamicResolution&&) = delete;
+
+		~DynamicResolution() = default;
+
+		/**
+		 * @brief Recreate render targets at the current scale of an output extent.
+		 * The old render targets must not be in use by the device.
+		 * @param extent The output extent.
+		*/
+		void reshape(VkExtent2D);
+
+		/**
+		 * @brief Feed the GPU time of a frame into the controller.
+		 * @param frame_time The GPU frame time in millisecond.
+		 * @return True if the scale has changed, after which render targets and the renderer should be reshaped.
+		*/
+		bool update(double) noexcept;
+
+		/**
+		 * @brief Get the extent the renderer should render at.
+		*/
+		VkExtent2D renderExtent() const noexcept;
+
+		/**
+		 * @brief Get the render target of an in-flight frame, to be given to the renderer as its present image.
+		 * @param frame_index The in-flight frame index.
+		 * @return The render target image and its view.
+		*/
+		std::pair<VkImage, VkImageView> renderTarget(unsigned int) const noexcept;
+
+		/**
+		 * @brief Record command to upscale the render target to an output image.
+		 * The render target must have been drawn and transitioned to present as a present image,
+		 * and the output image is transitioned to present after the upscale.
+		 * Writes to the output image are performed at colour attachment output stage.
+		 * @param cmd The command buffer.
+		 * @param frame_index The in-flight frame index.
+		 * @param output The output image.
+		 * @param output_view The view of the output image.
+		*/
+		void record(VkCommandBuffer, unsigned int, VkImage, VkImageView) const;
+
+	};
+
+}
\ No newline at end of file
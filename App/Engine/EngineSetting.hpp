@@ -17,11 +17,42 @@ namespace LearnVulkan {
 #else
 		constexpr bool EnableValidation = false;
 #endif
+		//Whether CPU scopes and debug utils labels are recorded, enabled by the LV_ENABLE_CPU_PROFILER build option.
+		//Every marker compiles to nothing when disabled.
+#ifdef LEARN_VULKAN_ENABLE_CPU_PROFILER
+		constexpr bool EnableCpuProfiler = true;
+#else
+		constexpr bool EnableCpuProfiler = false;
+#endif
 
 		/**
 		 * @brief Specify the maximum number of frame that can be submitted to the queue before rendering.
+		 * The actual number is chosen at start up, and per-frame resources are stored in arrays of this capacity,
+		 * of which only the chosen number of elements are used.
+		*/
+		constexpr inline unsigned int MaxFrameInFlight = 4u;
+		/**
+		 * @brief The number of frame in flight used if not specified otherwise.
+		*/
+		constexpr inline unsigned int DefaultFrameInFlight = 2u;
+
+		/**
+		 * @brief Specify the maximum number of view rendered in one pass with multiview, such as six faces of a cube map.
+		 * This must be the same as CAMERA_MAX_VIEW in the camera shader, and no more than six which every device supports.
+		*/
+		constexpr inline unsigned int MaxViewCount = 6u;
+
+		/**
+		 * @brief Specify the maximum number of worker thread for recording commands in parallel.
+		 * The actual number is also limited by the hardware concurrency.
+		*/
+		constexpr inline unsigned int MaxRecordingWorker = 4u;
+
+		/**
+		 * @brief Specify if graphics pipelines fast-linked from pipeline libraries are replaced by
+		 * link-time optimised pipelines compiled in the background.
 		*/
-		constexpr inline unsigned int MaxFrameInFlight = 2u;
+		constexpr inline bool BackgroundPipelineOptimisation = true;
 
 	}
 
@@ -0,0 +1,98 @@
+#include "FrameAllocator.hpp"
+
+#include "Abstraction/BufferManager.hpp"
+#include "../Common/ErrorHandler.hpp"
+
+#include <algorithm>
+#include <span>
+#include <string>
+
+#include <stdexcept>
+
+using std::runtime_error;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	//The largest alignment required by vector types in shader.
+	constexpr VkDeviceSize MinFrameAlignment = 16ull;
+
+	inline VkDeviceSize getFrameAlignment(const VkPhysicalDeviceLimits& limit) noexcept {
+		return std::max({ ::MinFrameAlignment, limit.minStorageBufferOffsetAlignment, limit.minUniformBufferOffsetAlignment });
+	}
+
+	[[noreturn]] void throwOutOfMemory(const VkDeviceSize size, const VkDeviceSize capacity) {
+		using namespace std::string_literals;
+		throw runtime_error("Frame allocator has run out of memory when allocating "s + std::to_string(size)
+			+ " byte, the capacity is "s + std::to_string(capacity) + " byte"s);
+	}
+
+}
+
+FrameAllocator::FrameAllocator(const VulkanContext& ctx, const VkDeviceSize capacity) :
+	Context(&ctx), Alignment(::getFrameAlignment(ctx.PhysicalDeviceProperty.Limit)), Capacity(capacity), Reserved(0ull) {
+	const VkDevice device = ctx.Device;
+	const VmaAllocator allocator = ctx.Allocator;
+
+	for (auto& [memory, data, address, head] : std::span(this->Frame).first(ctx.FrameInFlight)) {
+		memory = BufferManager::createStreamingBuffer({ device, allocator, capacity }, FrameAllocator::Usage,
+			BufferManager::HostAccessPattern::Sequential);
+		data = VKO::mapAllocation<std::byte>(allocator, memory.first);
+		address = BufferManager::addressOf(device, memory.second);
+		head.store(0ull, std::memory_order_relaxed);
+	}
+}
+
+inline VkDeviceSize FrameAllocator::alignUp(const VkDeviceSize value, const VkDeviceSize alignment) const noexcept {
+	const VkDeviceSize mask = (alignment == 0ull ? this->Alignment : alignment) - 1ull;
+	return (value + mask) & ~mask;
+}
+
+VkDeviceSize FrameAllocator::reserve(const VkDeviceSize size, const VkDeviceSize alignment) {
+	const VkDeviceSize offset = this->alignUp(this->Reserved, alignment);
+	if (offset + size > this->Capacity) {
+		::throwOutOfMemory(size, this->Capacity);
+	}
+
+	this->Reserved = offset + size;
+	for (auto& frame : this->Frame) {
+		frame.Head.store(this->Reserved, std::memory_order_relaxed);
+	}
+	return offset;
+}
+
+FrameAllocator::Allocation FrameAllocator::at(const unsigned int index, const VkDeviceSize offset) const noexcept {
+	const FrameMemory& frame = this->Frame[index];
+	return {
+		.Data = frame.Data.get() + offset,
+		.Buffer = frame.Memory.second,
+		.Offset = offset,
+		.Address = frame.Address + offset
+	};
+}
+
+FrameAllocator::Allocation FrameAllocator::allocate(const unsigned int index, const VkDeviceSize size, const VkDeviceSize alignment) {
+	std::atomic<VkDeviceSize>& head = this->Frame[index].Head;
+
+	VkDeviceSize current = head.load(std::memory_order_relaxed), offset;
+	do {
+		offset = this->alignUp(current, alignment);
+		if (offset + size > this->Capacity) {
+			::throwOutOfMemory(size, this->Capacity);
+		}
+	} while (!head.compare_exchange_weak(current, offset + size, std::memory_order_relaxed));
+
+	return this->at(index, offset);
+}
+
+void FrameAllocator::reset(const unsigned int index) noexcept {
+	this->Frame[index].Head.store(this->Reserved, std::memory_order_relaxed);
+}
+
+void FrameAllocator::flush(const unsigned int index) const {
+	const FrameMemory& frame = this->Frame[index];
+	CHECK_VULKAN_ERROR(vmaFlushAllocation(this->Context->Allocator, frame.Memory.first, 0ull,
+		frame.Head.load(std::memory_order_relaxed)));
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "EngineSetting.hpp"
+#include "VulkanContext.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+#include <cstddef>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief A linear allocator for dynamic data that live for one frame, such as per-frame uniforms and instance data.
+	 * Each in-flight frame owns a persistently mapped host-visible buffer, memory is bumped from the beginning of the buffer,
+	 * and all of them are released at once when the in-flight frame is reset, after the device has finished using it.
+	 * The engine flushes the used memory before submission, so users neither allocate buffers nor flush on their own.
+	*/
+	class FrameAllocator {
+	public:
+
+		constexpr static VkDeviceSize DefaultCapacity = 4ull << 20u;/**< In byte, for each in-flight frame. */
+		constexpr static VkBufferUsageFlags Usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+			| VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+			| VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+			| VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+			| VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+			| VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+
+		/**
+		 * @brief Memory allocated from an in-flight frame.
+		*/
+		struct Allocation {
+
+			std::byte* Data;/**< Host pointer to the memory. */
+
+			VkBuffer Buffer;
+			VkDeviceSize Offset;/**< In byte, into the buffer. */
+			VkDeviceAddress Address;/**< The device address of the memory, which has the offset included. */
+
+		};
+
+	private:
+
+		struct FrameMemory {
+
+			VulkanObject::BufferAllocation Memory;
+			VulkanObject::MappedAllocation<std::byte> Data;
+			VkDeviceAddress Address;
+
+			std::atomic<VkDeviceSize> Head;/**< The end of used memory. */
+
+		};
+
+		const VulkanContext* const Context;
+
+		const VkDeviceSize Alignment, Capacity;
+		//Memory at the beginning of every in-flight frame that is never released.
+		VkDeviceSize Reserved;
+		std::array<FrameMemory, EngineSetting::MaxFrameInFlight> Frame;
+
+		//Round up to the alignment, or the default alignment if zero.
+		VkDeviceSize alignUp(VkDeviceSize, VkDeviceSize) const noexcept;
+
+	public:
+
+		/**
+		 * @brief Create a frame allocator.
+		 * @param ctx The context. The context is retained and must remain valid until the allocator is destroyed.
+		 * @param capacity The size of memory of each in-flight frame in byte.
+		*/
+		FrameAllocator(const VulkanContext&, VkDeviceSize = DefaultCapacity);
+
+		FrameAllocator(const FrameAllocator&) = delete;
+
+		FrameAllocator(FrameAllocator&&) = delete;
+
+		FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+		FrameAllocator& operator=(FrameAllocator&&) = delete;
+
+		~FrameAllocator() = default;
+
+		/**
+		 * @brief Reserve memory at the same offset in every in-flight frame, that is never released by reset.
+		 * This is intended for data that are updated in place every frame, whose descriptors are written once.
+		 * Reservation must be made before any allocation.
+		 * @param size The number of byte.
+		 * @param alignment The alignment of the offset, which must be a power of two.
+		 * If zero, the offset is aligned for use as storage and uniform buffer.
+		 * @return The offset of the reserved memory.
+		 * @exception If the size is greater than the remaining capacity.
+		*/
+		VkDeviceSize reserve(VkDeviceSize, VkDeviceSize = 0ull);
+
+		/**
+		 * @brief Get the memory of an in-flight frame at an offset, such as a reserved memory.
+		 * @param index The in-flight frame index.
+		 * @param offset The offset in byte.
+		 * @return The memory.
+		*/
+		Allocation at(unsigned int, VkDeviceSize) const noexcept;
+
+		/**
+		 * @brief Allocate memory from an in-flight frame, which is released when the frame is reset.
+		 * This function is thread-safe.
+		 * @param index The in-flight frame index.
+		 * @param size The number of byte.
+		 * @param alignment The alignment of the offset, same as reservation.
+		 * @return The allocated memory.
+		 * @exception If the in-flight frame has run out of memory.
+		*/
+		Allocation allocate(unsigned int, VkDeviceSize, VkDeviceSize = 0ull);
+
+		/**
+		 * @brief Allocate memory from an in-flight frame and copy an object to it.
+		 * @tparam T The type of object, which must be trivially copyable.
+		 * @param index The in-flight frame index.
+		 * @param data The object to be copied.
+		 * @return The allocated memory.
+		*/
+		template<class T>
+		Allocation push(const unsigned int index, const T& data) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			const Allocation allocation = this->allocate(index, sizeof(T));
+			std::memcpy(allocation.Data, &data, sizeof(T));
+			return allocation;
+		}
+
+		/**
+		 * @brief Release all allocations of an in-flight frame.
+		 * The device must have finished using memory of this frame.
+		 * @param index The in-flight frame index.
+		*/
+		void reset(unsigned int) noexcept;
+
+		/**
+		 * @brief Make host writes to memory of an in-flight frame, including the reserved memory, available to the device.
+		 * @param index The in-flight frame index.
+		*/
+		void flush(unsigned int) const;
+
+	};
+
+}
\ No newline at end of file
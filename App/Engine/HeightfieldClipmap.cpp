@@ -0,0 +1,314 @@
+#include "HeightfieldClipmap.hpp"
+#include "EngineSetting.hpp"
+
+#include <glm/common.hpp>
+#include <glm/vector_relational.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <ranges>
+#include <limits>
+#include <chrono>
+#include <string>
+
+#include <stdexcept>
+
+#include <cstring>
+#include <cmath>
+
+using glm::uvec2, glm::vec2, glm::dvec2, glm::vec4;
+
+using std::array, std::vector, std::span;
+using std::byte;
+using std::ranges::views::iota;
+using std::runtime_error;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	//must match the layout in shader
+	struct ClipLevelData {
+
+		vec4 Region;/**< Resident region in texel, min and max. */
+		vec2 Extent;
+		vec2 Padding;
+
+	};
+	struct ClipmapData {
+
+		uint32_t LevelCount, Image, Sampler;
+		float WindowSize;
+		array<ClipLevelData, HeightfieldClipmap::MaxClipLevel> Level;
+
+	};
+	static_assert(offsetof(ClipmapData, Level) == 16u && sizeof(ClipLevelData) == 32u);
+
+	//Clip levels are those finer than the first level that fits in a clip window.
+	uint32_t findCoarseLevel(const ImageManager::TiledImageFile& source, const uint32_t window_tile) {
+		const uint32_t window_size = window_tile * source.tileSize();
+		const span<const ImageManager::TiledImageLevel> level = source.level();
+
+		const auto coarse = std::ranges::find_if(level, [window_size](const ImageManager::TiledImageLevel& tiled_level) {
+			return tiled_level.Extent.width <= window_size && tiled_level.Extent.height <= window_size;
+		});
+		//the last level always fits in one tile
+		const auto coarse_level = static_cast<uint32_t>(std::min(coarse - level.begin(), static_cast<ptrdiff_t>(level.size()) - 1));
+		if (coarse_level > HeightfieldClipmap::MaxClipLevel) {
+			using namespace std::string_literals;
+			throw runtime_error("The heightfield requires "s + std::to_string(coarse_level)
+				+ " clip levels, which is more than supported, consider a larger clip window"s);
+		}
+		return coarse_level;
+	}
+
+	//Tiles are addressed toroidally in a clip layer, so every tile in a window has a distinct slot.
+	constexpr uvec2 getTileSlot(const uvec2& tile, const uint32_t window_tile) noexcept {
+		return tile % window_tile;
+	}
+
+}
+
+HeightfieldClipmap::HeightfieldClipmap(const VulkanContext& ctx, const ClipmapCreateInfo& clipmap_info) :
+	Context(&ctx), Uploader(clipmap_info.Uploader), FrameMemory(clipmap_info.FrameMemory),
+	DataOffset(this->FrameMemory->reserve(sizeof(::ClipmapData), alignof(vec4))),
+	Source(clipmap_info.Filename), WindowTile(clipmap_info.WindowTile), Stage(clipmap_info.Stage),
+	Concurrent(ctx.QueueIndex.Transfer != ctx.QueueIndex.Render),
+	CoarseLevel(::findCoarseLevel(this->Source, this->WindowTile)), Level { }, FrameCount(0ull) {
+	if (this->CoarseLevel == 0u) {
+		//the heightfield fits in a clip window, nothing needs to be streamed
+		return;
+	}
+	const uint32_t tile_size = this->Source.tileSize(),
+		window_size = this->WindowTile * tile_size;
+	const VkDeviceSize tile_byte = this->Source.tileByte(),
+		tile_row_byte = tile_byte / tile_size,
+		texel_byte = tile_row_byte / tile_size;
+
+	/*******************
+	 * Clip image
+	 ******************/
+	//clip layers are sampled while other tiles in the same layer are uploaded, so the image is never transitioned
+	const auto queue_family = array { ctx.QueueIndex.Transfer, ctx.QueueIndex.Render };
+	this->Image = ImageManager::createImage({
+		.Device = ctx.Device,
+		.Allocator = ctx.Allocator,
+		.Category = VKO::AllocationCategory::Texture,
+		.ImageType = VK_IMAGE_TYPE_2D,
+		.Format = this->Source.format(),
+		.Extent = { window_size, window_size, 1u },
+		.Layer = this->CoarseLevel,
+		.Usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		.QueueFamily = this->Concurrent ? span<const uint32_t>(queue_family) : span<const uint32_t>()
+	});
+	this->ImageView = ImageManager::createFullImageView({
+		.Device = ctx.Device,
+		.Image = this->Image.second,
+		.ViewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+		.Format = this->Source.format(),
+		.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+	});
+	//the window wraps around the clip layer
+	this->Sampler = VKO::createSampler(ctx.Device, {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_LINEAR,
+		.minFilter = VK_FILTER_LINEAR,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT
+	});
+
+	/********************
+	 * Initial window
+	 *******************/
+	//every clip layer is uploaded whole, which also defines its layout
+	vector<byte> layer_data(tile_byte * this->WindowTile * this->WindowTile);
+	for (const auto l : iota(0u, this->CoarseLevel)) {
+		ClipLevel& level = this->Level[l];
+		level.Window = level.Resident = this->calcWindow(l, clipmap_info.Focus);
+		level.Status = ClipLevel::StreamStatus::Idle;
+
+		const auto [min, max] = level.Resident;
+		for (const auto y : iota(min.y, max.y)) {
+			for (const auto x : iota(min.x, max.x)) {
+				const span<const byte> tile = this->Source.tile(l, x, y);
+				const uvec2 slot = ::getTileSlot(uvec2(x, y), this->WindowTile);
+				for (const auto row : iota(0u, tile_size)) {
+					std::memcpy(layer_data.data() + texel_byte * (static_cast<VkDeviceSize>(window_size) * (slot.y * tile_size + row)
+						+ slot.x * tile_size), tile.data() + tile_row_byte * row, tile_row_byte);
+				}
+			}
+		}
+		this->Uploader->upload({
+			.Destination = this->Image.second,
+			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+			.Extent = { window_size, window_size, 1u },
+			.BaseLayer = l,
+			.TargetLayout = VK_IMAGE_LAYOUT_GENERAL,
+			.Target = { this->Stage, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT },
+			.Concurrent = this->Concurrent
+		}, layer_data);
+	}
+	this->Uploader->wait(this->Uploader->flush());
+
+	DescriptorHeap& heap = *clipmap_info.Heap;
+	this->HeapSlot.Image = heap.addSampledImage(this->ImageView, VK_IMAGE_LAYOUT_GENERAL);
+	this->HeapSlot.Sampler = heap.addSampler(this->Sampler);
+}
+
+HeightfieldClipmap::TileRect HeightfieldClipmap::calcWindow(const uint32_t level, const dvec2& focus) const noexcept {
+	const auto& [extent, tile_count, offset] = this->Source.level()[level];
+	const dvec2 centre = focus * dvec2(extent.width, extent.height) / static_cast<double>(this->Source.tileSize());
+	const auto origin = [window_tile = this->WindowTile](const double c, const uint32_t count) noexcept -> uint32_t {
+		const auto first = static_cast<int64_t>(std::llround(c - window_tile * 0.5));
+		return static_cast<uint32_t>(std::clamp(first, int64_t { 0 }, std::max(static_cast<int64_t>(count) - window_tile, int64_t { 0 })));
+	};
+
+	const uvec2 min(origin(centre.x, tile_count.width), origin(centre.y, tile_count.height));
+	return {
+		.Min = min,
+		.Max = glm::min(min + this->WindowTile, uvec2(tile_count.width, tile_count.height))
+	};
+}
+
+void HeightfieldClipmap::beginStream(const uint32_t level_index, const TileRect& window) {
+	ClipLevel& level = this->Level[level_index];
+
+	//tiles leaving the window are no longer sampled from this frame onwards
+	TileRect kept {
+		.Min = glm::max(level.Resident.Min, window.Min),
+		.Max = glm::min(level.Resident.Max, window.Max)
+	};
+	if (glm::any(glm::greaterThanEqual(kept.Min, kept.Max))) {
+		kept = { window.Min, window.Min };
+	}
+	level.Resident = kept;
+	level.Window = window;
+
+	level.Tile.clear();
+	for (const auto y : iota(window.Min.y, window.Max.y)) {
+		for (const auto x : iota(window.Min.x, window.Max.x)) {
+			if (x < kept.Min.x || x >= kept.Max.x || y < kept.Min.y || y >= kept.Max.y) {
+				level.Tile.emplace_back(x, y);
+			}
+		}
+	}
+	level.Data = std::async(std::launch::async, [&source = this->Source, level_index, &tile = level.Tile]() {
+		const VkDeviceSize tile_byte = source.tileByte();
+		vector<byte> data(tile_byte * tile.size());
+		for (const auto i : iota(size_t { 0 }, tile.size())) {
+			std::memcpy(data.data() + tile_byte * i, source.tile(level_index, tile[i].x, tile[i].y).data(), tile_byte);
+		}
+		return data;
+	});
+
+	//the last frame that may sample tiles leaving the window is the frame right before
+	level.UploadFrame = this->FrameCount + this->Context->FrameInFlight - 1u;
+	level.Status = ClipLevel::StreamStatus::Reading;
+}
+
+void HeightfieldClipmap::uploadStream(const uint32_t level_index) {
+	ClipLevel& level = this->Level[level_index];
+	const vector<byte> data = level.Data.get();
+	const uint32_t tile_size = this->Source.tileSize();
+	const VkDeviceSize tile_byte = this->Source.tileByte();
+
+	for (const auto i : iota(size_t { 0 }, level.Tile.size())) {
+		const uvec2 slot = ::getTileSlot(level.Tile[i], this->WindowTile) * tile_size;
+		this->Uploader->upload({
+			.Destination = this->Image.second,
+			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+			.Offset = { static_cast<int32_t>(slot.x), static_cast<int32_t>(slot.y), 0 },
+			.Extent = { tile_size, tile_size, 1u },
+			.BaseLayer = level_index,
+			.CurrentLayout = VK_IMAGE_LAYOUT_GENERAL,
+			.TargetLayout = VK_IMAGE_LAYOUT_GENERAL,
+			.Target = { this->Stage, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT },
+			.Concurrent = this->Concurrent
+		}, span(data).subspan(tile_byte * i, tile_byte));
+	}
+	level.Status = ClipLevel::StreamStatus::Uploading;
+}
+
+ImageManager::ImageReadResult HeightfieldClipmap::readCoarseLevel() const {
+	return this->Source.readLevel(this->Context->Device, this->Context->Allocator, this->CoarseLevel);
+}
+
+void HeightfieldClipmap::update(const unsigned int frame_index, const dvec2& focus) {
+	using enum ClipLevel::StreamStatus;
+
+	/*****************
+	 * Streaming
+	 ****************/
+	//levels whose uploads are recorded in this frame, which share the same ticket
+	uint32_t uploaded = 0u;
+	for (const auto l : iota(0u, this->CoarseLevel)) {
+		ClipLevel& level = this->Level[l];
+		switch (level.Status) {
+		case Idle:
+			if (const TileRect window = this->calcWindow(l, focus);
+				window != level.Resident) {
+				this->beginStream(l, window);
+			}
+			break;
+		case Reading:
+			if (this->FrameCount >= level.UploadFrame && level.Data.wait_for(std::chrono::seconds::zero()) == std::future_status::ready) {
+				this->uploadStream(l);
+				uploaded |= 1u << l;
+			}
+			break;
+		case Uploading:
+			//the window is resident once the upload is visible to the rendering queue
+			if (this->Uploader->isComplete(level.Ticket)) {
+				level.Resident = level.Window;
+				level.Status = Idle;
+			}
+			break;
+		}
+	}
+	if (uploaded != 0u) {
+		const StagingUploader::Ticket ticket = this->Uploader->flush();
+		for (const auto l : iota(0u, this->CoarseLevel)) {
+			if ((uploaded & 1u << l) != 0u) {
+				this->Level[l].Ticket = ticket;
+			}
+		}
+	}
+	this->FrameCount++;
+
+	/******************
+	 * Publish
+	 *****************/
+	const uint32_t tile_size = this->Source.tileSize();
+	::ClipmapData data {
+		.LevelCount = this->CoarseLevel,
+		.Image = this->CoarseLevel > 0u ? this->HeapSlot.Image.index() : 0u,
+		.Sampler = this->CoarseLevel > 0u ? this->HeapSlot.Sampler.index() : 0u,
+		.WindowSize = static_cast<float>(this->WindowTile * tile_size),
+		.Level = { }
+	};
+	for (const auto l : iota(0u, this->CoarseLevel)) {
+		const auto [min, max] = this->Level[l].Resident;
+		const auto& [extent, tile_count, offset] = this->Source.level()[l];
+
+		vec4 region = vec4(vec2(min * tile_size), vec2(max * tile_size));
+		//a region reaching the edge of the level is unbounded, so the level is not blended out at the border of the heightfield
+		if (glm::all(glm::lessThan(min, max))) {
+			constexpr float Unbounded = std::numeric_limits<float>::max();
+			region = glm::mix(region, vec4(-Unbounded, -Unbounded, Unbounded, Unbounded), glm::equal(
+				glm::uvec4(min, max), glm::uvec4(0u, 0u, tile_count.width, tile_count.height)));
+		}
+		data.Level[l] = {
+			.Region = region,
+			.Extent = vec2(extent.width, extent.height)
+		};
+	}
+
+	std::memcpy(this->FrameMemory->at(frame_index, this->DataOffset).Data, &data, sizeof(data));
+}
+
+VkDeviceAddress HeightfieldClipmap::address(const unsigned int frame_index) const noexcept {
+	return this->FrameMemory->at(frame_index, this->DataOffset).Address;
+}
\ No newline at end of file
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "DescriptorHeap.hpp"
+#include "FrameAllocator.hpp"
+#include "StagingUploader.hpp"
+#include "VulkanContext.hpp"
+
+#include "Abstraction/ImageManager.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <glm/vec2.hpp>
+
+#include <array>
+#include <vector>
+#include <future>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Stream a heightfield far larger than device memory from a tiled image file, using a clipmap.
+	 * The coarsest level that fits in a clip window is read whole by the user as an ordinary texture, and is always resident.
+	 * Every finer level keeps a window of tiles around a focus point in a layer of a 2D array image,
+	 * tiles are addressed toroidally such that only tiles entering a moving window are read from the file on a worker thread,
+	 * then uploaded through the staging uploader.
+	 * The resident region of every level is published per frame into memory reserved from the frame allocator,
+	 * and is only grown after its upload has completed,
+	 * and shrunk before tiles leaving the window are overwritten.
+	 * @see Shader/HeightfieldClipmap.glsl
+	*/
+	class HeightfieldClipmap {
+	public:
+
+		constexpr static uint32_t MaxClipLevel = 8u;
+		constexpr static uint32_t DefaultWindowTile = 4u;
+
+		/**
+		 * @brief Information to create a clipmap.
+		*/
+		struct ClipmapCreateInfo {
+
+			const char* Filename;/**< The tiled image file, which remains mapped until the clipmap is destroyed. */
+			uint32_t WindowTile = DefaultWindowTile;/**< The width and height of the window of each clip level, in tile. */
+			glm::dvec2 Focus = glm::dvec2(0.5);/**< The initial focus point, in UV. */
+			VkPipelineStageFlags2 Stage;/**< Stages where the clipmap is sampled on the rendering queue. */
+
+			DescriptorHeap* Heap;/**< The clip image and its sampler are added to the heap. */
+			StagingUploader* Uploader;/**< Tiles are uploaded through the uploader, which is retained. */
+			FrameAllocator* FrameMemory;/**< Clipmap data are reserved from the frame allocator, which must outlive the clipmap. */
+
+		};
+
+	private:
+
+		//A rectangle of tiles in [Min, Max).
+		struct TileRect {
+
+			glm::uvec2 Min, Max;
+
+			constexpr bool operator==(const TileRect&) const noexcept = default;
+
+		};
+
+		struct ClipLevel {
+
+			enum class StreamStatus : uint8_t {
+				Idle = 0x00u,
+				Reading = 0x01u,/**< Tiles are being read from the file. */
+				Uploading = 0x02u
+			};
+
+			TileRect Resident;/**< Tiles whose data are in the clip layer and can be sampled. */
+			TileRect Window;/**< The window being streamed, which is the same as resident when idle. */
+
+			StreamStatus Status;
+			std::vector<glm::uvec2> Tile;/**< Tiles being streamed. */
+			std::future<std::vector<std::byte>> Data;/**< Pixels of every streamed tile laid out contiguously. */
+			//Tiles leaving the window are only overwritten after every frame that may sample them has completed.
+			uint64_t UploadFrame;
+			StagingUploader::Ticket Ticket;
+
+		};
+
+		const VulkanContext* const Context;
+		StagingUploader* const Uploader;
+		FrameAllocator* const FrameMemory;
+		//Clipmap data are updated in place, such that every in-flight frame publishes at the same address.
+		const VkDeviceSize DataOffset;
+
+		const ImageManager::TiledImageFile Source;
+		const uint32_t WindowTile;
+		const VkPipelineStageFlags2 Stage;
+		const bool Concurrent;/**< True if the clip image is shared by the transfer and the rendering queue family. */
+
+		const uint32_t CoarseLevel;/**< Also the number of clip level. */
+		VulkanObject::ImageAllocation Image;
+		VulkanObject::ImageView ImageView;
+		VulkanObject::Sampler Sampler;
+		struct {
+
+			DescriptorHeap::Slot Image, Sampler;
+
+		} HeapSlot;
+
+		std::array<ClipLevel, MaxClipLevel> Level;
+		uint64_t FrameCount;
+
+		//Get the window of tiles on a level centred around the focus point.
+		TileRect calcWindow(uint32_t, const glm::dvec2&) const noexcept;
+
+		//Start streaming a level to a new window, and shrink its resident region.
+		void beginStream(uint32_t, const TileRect&);
+
+		//Upload tiles of a level that have been read, which must not be called before the upload frame.
+		void uploadStream(uint32_t);
+
+	public:
+
+		/**
+		 * @brief Create a clipmap, and upload the initial window of every clip level.
+		 * @param ctx The context. The context is retained and must remain valid until the clipmap is destroyed.
+		 * @param clipmap_info The clipmap create info.
+		 * @exception If the clip window cannot fit the coarsest level of the file in at most the maximum number of clip levels.
+		*/
+		HeightfieldClipmap(const VulkanContext&, const ClipmapCreateInfo&);
+
+		HeightfieldClipmap(const HeightfieldClipmap&) = delete;
+
+		HeightfieldClipmap(HeightfieldClipmap&&) = delete;
+
+		HeightfieldClipmap& operator=(const HeightfieldClipmap&) = delete;
+
+		HeightfieldClipmap& operator=(HeightfieldClipmap&&) = delete;
+
+		/**
+		 * @brief Outstanding reads are waited, and the device must have finished using the clipmap.
+		*/
+		~HeightfieldClipmap() = default;
+
+		/**
+		 * @brief Read the coarsest level, which is sampled by the clipmap outside of every clip window.
+		 * @return The read result.
+		*/
+		ImageManager::ImageReadResult readCoarseLevel() const;
+
+		/**
+		 * @brief Move the window of every clip level towards a focus point, and publish the resident region of this frame.
+		 * This should be called exactly once every frame, after the in-flight frame has been waited.
+		 * @param frame_index The in-flight frame index.
+		 * @param focus The focus point, in UV.
+		*/
+		void update(unsigned int, const glm::dvec2&);
+
+		/**
+		 * @brief Get the device address of the clipmap data of an in-flight frame.
+		 * The address never changes, such that it can be recorded into commands replayed in many frames.
+		 * @param frame_index The in-flight frame index.
+		 * @return The device address.
+		*/
+		VkDeviceAddress address(unsigned int) const noexcept;
+
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "JobSystem.hpp"
+#include "CpuProfiler.hpp"
+
+#include <ranges>
+#include <utility>
+#include <cassert>
+
+using std::span;
+using std::unique_lock, std::stop_token;
+using std::exception_ptr, std::current_exception, std::rethrow_exception;
+
+using std::views::iota;
+
+using namespace LearnVulkan;
+
+JobSystem::JobSystem(const uint32_t worker_count) : NextJob(0u), RemainingJob(0u) {
+	assert(worker_count > 0u);
+	this->Worker.reserve(worker_count);
+	for (const auto idx : iota(0u, worker_count)) {
+		this->Worker.emplace_back([this, idx](const stop_token token) { this->work(token, idx); });
+	}
+}
+
+void JobSystem::work(const stop_token token, const uint32_t worker_idx) {
+	CpuProfiler::nameThread("Job worker");
+	unique_lock lock(this->Mutex);
+	while (true) {
+		//returns false only if stop is requested with no job available
+		if (!this->JobReady.wait(lock, token, [this]() noexcept { return this->NextJob < this->Batch.size(); })) {
+			return;
+		}
+		const Job& job = this->Batch[this->NextJob++];
+
+		lock.unlock();
+		exception_ptr job_exception;
+		try {
+			CPU_PROFILE_SCOPE("Job");
+			job(worker_idx);
+		} catch (...) {
+			job_exception = current_exception();
+		}
+		lock.lock();
+
+		if (job_exception && !this->JobException) {
+			this->JobException = std::move(job_exception);
+		}
+		if (--this->RemainingJob == 0u) {
+			this->JobDone.notify_one();
+		}
+	}
+}
+
+uint32_t JobSystem::workerCount() const noexcept {
+	return static_cast<uint32_t>(this->Worker.size());
+}
+
+void JobSystem::run(const span<const Job> job) {
+	if (job.empty()) {
+		return;
+	}
+	unique_lock lock(this->Mutex);
+	assert(this->RemainingJob == 0u);
+
+	this->Batch = job;
+	this->NextJob = 0u;
+	this->RemainingJob = job.size();
+	this->JobException = nullptr;
+	this->JobReady.notify_all();
+
+	this->JobDone.wait(lock, [this]() noexcept { return this->RemainingJob == 0u; });
+	this->Batch = { };
+	if (this->JobException) {
+		rethrow_exception(std::exchange(this->JobException, nullptr));
+	}
+}
\ No newline at end of file
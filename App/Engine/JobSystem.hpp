@@ -0,0 +1,85 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <functional>
+#include <exception>
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief A small pool of worker threads to run a batch of jobs in parallel.
+	 * Each job is given the index of the worker running it, so per-worker resources, such as command pools,
+	 * can be used by a job without further synchronisation.
+	*/
+	class JobSystem {
+	public:
+
+		/**
+		 * @brief A job to be run. The argument is the index of the worker running this job.
+		*/
+		using Job = std::function<void(uint32_t)>;
+
+	private:
+
+		std::mutex Mutex;
+		std::condition_variable_any JobReady;
+		std::condition_variable JobDone;
+
+		//The batch being run, jobs before the next job index have been taken by a worker.
+		std::span<const Job> Batch;
+		size_t NextJob, RemainingJob;
+		//The first exception thrown by a job in the current batch.
+		std::exception_ptr JobException;
+
+		//Worker must be destroyed first so no worker is using any synchronisation primitive.
+		std::vector<std::jthread> Worker;
+
+		//The main loop of a worker.
+		void work(std::stop_token, uint32_t);
+
+	public:
+
+		/**
+		 * @brief Start a job system.
+		 * @param worker_count The number of worker thread, must be at least one.
+		*/
+		explicit JobSystem(uint32_t);
+
+		JobSystem(const JobSystem&) = delete;
+
+		JobSystem(JobSystem&&) = delete;
+
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		JobSystem& operator=(JobSystem&&) = delete;
+
+		/**
+		 * @brief All workers are stopped and joined.
+		*/
+		~JobSystem() = default;
+
+		/**
+		 * @brief Get the number of worker thread.
+		 * Worker index given to a job is always less than this number.
+		*/
+		uint32_t workerCount() const noexcept;
+
+		/**
+		 * @brief Run a batch of jobs in parallel, and block until all of them are finished.
+		 * The order of execution of jobs is unspecified.
+		 * This function is not reentrant, and must not be called from within a job.
+		 * @param job The jobs to be run.
+		 * @exception If any job throws, the first exception is rethrown after all jobs have finished.
+		*/
+		void run(std::span<const Job>);
+
+	};
+
+}
\ No newline at end of file
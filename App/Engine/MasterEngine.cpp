@@ -1,11 +1,17 @@
 #include "MasterEngine.hpp"
 
 #include "ContextManager.hpp"
+#include "CpuProfiler.hpp"
 #include "Abstraction/CommandBufferManager.hpp"
 #include "Abstraction/ImageManager.hpp"
 #include "Abstraction/SemaphoreManager.hpp"
 #include "Abstraction/PipelineBarrier.hpp"
+#include "Abstraction/PipelineManager.hpp"
 #include "../Common/ErrorHandler.hpp"
+#include "../Common/File.hpp"
+#include "../Common/FixedArray.hpp"
+
+#include <LearnVulkan/GeneratedTemplate/ResourcePath.hpp>
 
 #include <Volk/volk.h>
 
@@ -14,12 +20,17 @@
 
 #include <iterator>
 #include <algorithm>
+#include <ranges>
 #include <limits>
 #include <utility>
 
 #include <vector>
+#include <string>
 #include <tuple>
 #include <span>
+#include <initializer_list>
+#include <functional>
+#include <thread>
 
 #include <stdexcept>
 #include <cassert>
@@ -35,6 +46,7 @@ using std::array, std::span, std::pair, std::tuple, std::vector;
 using std::make_pair, std::make_tuple;
 
 using std::ranges::transform, std::ranges::generate, std::ranges::copy;
+using std::views::iota;
 
 using std::runtime_error;
 using std::numeric_limits;
@@ -52,12 +64,17 @@ struct MasterEngine::DebugCallbackUserData {
 
 namespace {
 
+	constexpr std::string_view PipelineCacheFilename = "/PipelineCache.bin";
+	constexpr auto PipelineCacheFilenameRaw = File::toAbsolutePath<ResourcePath::CacheRoot, PipelineCacheFilename>();
+
 	constexpr array RequiredLayer = { "VK_LAYER_KHRONOS_validation" };
 	constexpr array RequiredExtension = {
 		VK_KHR_16BIT_STORAGE_EXTENSION_NAME,
 		VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
+		//only required by acceleration structure, every acceleration structure is built on the device
 		VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
 		VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+		VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
 		VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
 		VK_KHR_IMAGE_FORMAT_LIST_EXTENSION_NAME,
 		VK_KHR_MAINTENANCE_1_EXTENSION_NAME,
@@ -70,9 +87,35 @@ namespace {
 		VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
 
 		VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME,
+		VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
 		VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
 		VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME
 	};
+	//Optional extensions that allow waiting for presentation to complete for better frame pacing.
+	constexpr array PresentWaitExtension = {
+		VK_KHR_PRESENT_ID_EXTENSION_NAME,
+		VK_KHR_PRESENT_WAIT_EXTENSION_NAME
+	};
+	//Optional extension that allows rendering with task and mesh shader, support is determined at device selection.
+	constexpr array MeshShaderExtension = {
+		VK_EXT_MESH_SHADER_EXTENSION_NAME
+	};
+	//Optional extension that allows tracing rays with a ray tracing pipeline, support is determined at device selection.
+	constexpr array RayTracingPipelineExtension = {
+		VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME
+	};
+	//Optional extension that allows the host to copy to images without staging, support is determined at device selection.
+	constexpr array HostImageCopyExtension = {
+		VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME
+	};
+	//Optional extension that allows querying accurate memory budget from the driver.
+	constexpr array MemoryBudgetExtension = {
+		VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+	};
+	//Optional instance extension that allows labelling command buffers and queues for the CPU profiler.
+	constexpr array DebugUtilsExtension = {
+		VK_EXT_DEBUG_UTILS_EXTENSION_NAME
+	};
 
 	constexpr CTX::DeviceRequirement ContextRequirement = {
 		.DeviceType = VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU,
@@ -98,7 +141,8 @@ namespace {
 
 	};
 
-	VKO::Instance createInstance(ostream& msg) {
+	//Also returns if debug utils extension is enabled.
+	pair<VKO::Instance, bool> createInstance(ostream& msg) {
 		constexpr static uint32_t version = VK_MAKE_API_VERSION(0u, 0u, 16u, 7u);//v0.16.7
 		constexpr static VkApplicationInfo app_info {
 			.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -131,9 +175,19 @@ namespace {
 
 		//add additional instance extension under debug build
 		auto enabled_layer = vector(req_layer, req_layer + req_layer_count);
+		bool debug_utils = false;
 		if constexpr (EngineSetting::EnableValidation) {
 			//no need to check the existence of this extension, because it is implicitly enabled by validation layer
-			enabled_layer.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+			debug_utils = true;
+		} else if constexpr (EngineSetting::EnableCpuProfiler) {
+			//without validation it is usually provided by a capture tool
+			debug_utils = CTX::isInstanceExtensionSupported(::DebugUtilsExtension);
+		}
+		if (debug_utils) {
+			enabled_layer.insert(enabled_layer.cend(), ::DebugUtilsExtension.cbegin(), ::DebugUtilsExtension.cend());
+		}
+		if constexpr (EngineSetting::EnableCpuProfiler) {
+			msg << "Debug utils label " << (debug_utils ? "enabled" : "disabled") << '\n';
 		}
 
 		/***********************
@@ -149,7 +203,7 @@ namespace {
 			ins_info.enabledLayerCount = static_cast<uint32_t>(RequiredLayer.size());
 			ins_info.ppEnabledLayerNames = RequiredLayer.data();
 		}
-		return VKO::createInstance(ins_info);
+		return { VKO::createInstance(ins_info), debug_utils };
 	}
 
 	inline VKO::SurfaceKHR createSurface(GLFWwindow* const canvas, const VkInstance instance) {
@@ -191,28 +245,69 @@ namespace {
 		return VKO::createDebugUtilsMessengerEXT(ctx.Instance, dbg_msg_info);
 	}
 
-	tuple<VKO::Device, VkQueue, VkQueue> createLogicalDevice(const CTX::VulkanContext& ctx) {
+	bool isPresentWaitSupported(const VkPhysicalDevice gpu) {
+		if (!CTX::isDeviceExtensionSupported(gpu, ::PresentWaitExtension)) {
+			return false;
+		}
+
+		VkPhysicalDevicePresentWaitFeaturesKHR present_wait {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR
+		};
+		VkPhysicalDevicePresentIdFeaturesKHR present_id {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+			.pNext = &present_wait
+		};
+		VkPhysicalDeviceFeatures2 feature {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &present_id
+		};
+		vkGetPhysicalDeviceFeatures2(gpu, &feature);
+		return present_id.presentId == VK_TRUE && present_wait.presentWait == VK_TRUE;
+	}
+
+	vector<VkImageLayout> getHostImageCopyDstLayout(const VkPhysicalDevice gpu) {
+		VkPhysicalDeviceHostImageCopyPropertiesEXT host_image_copy {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT
+		};
+		VkPhysicalDeviceProperties2 property {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+			.pNext = &host_image_copy
+		};
+		vkGetPhysicalDeviceProperties2(gpu, &property);
+
+		vector<VkImageLayout> layout(host_image_copy.copyDstLayoutCount);
+		host_image_copy.copySrcLayoutCount = 0u;
+		host_image_copy.pCopyDstLayouts = layout.data();
+		vkGetPhysicalDeviceProperties2(gpu, &property);
+		return layout;
+	}
+
+	tuple<VKO::Device, VkQueue, VkQueue, VkQueue, VkQueue> createLogicalDevice(const CTX::VulkanContext& ctx,
+		const bool enable_present_wait, const bool enable_memory_budget) {
 		const uint32_t render_queue_idx = ctx.RenderingQueueFamily,
-			present_queue_idx = ctx.PresentingQueueFamily;
+			present_queue_idx = ctx.PresentingQueueFamily,
+			compute_queue_idx = ctx.ComputingQueueFamily,
+			transfer_queue_idx = ctx.TransferringQueueFamily;
 		/*********************************
 		 * Create logical device
 		 *********************************/
 		constexpr static float priority = 0.25f;
-		array<VkDeviceQueueCreateInfo, 2u> queue_info;
-		//render queue
-		queue_info[0] = {
-			.sType = VkStructureType::VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-			.queueFamilyIndex = render_queue_idx,
-			.queueCount = 1u,
-			.pQueuePriorities = &priority
-		};
-		//present queue, which reuses most parameters from the render queue
-		queue_info[1] = queue_info[0];
-		queue_info[1].queueFamilyIndex = present_queue_idx;
-
-		//Vulkan specification requires all queue family indices to be distinct,
-		//so if they are the same then just creating one queue is sufficient.
-		const uint32_t queue_info_count = render_queue_idx == present_queue_idx ? 1u : static_cast<uint32_t>(queue_info.size());
+		//render, present, compute and transfer queue
+		FixedArray<VkDeviceQueueCreateInfo, 4u> queue_info;
+		for (const uint32_t qf_idx : { render_queue_idx, present_queue_idx, compute_queue_idx, transfer_queue_idx }) {
+			//Vulkan specification requires all queue family indices to be distinct,
+			//so if they are the same then just creating one queue is sufficient.
+			const span<const VkDeviceQueueCreateInfo> created_info(queue_info.data(), queue_info.size());
+			if (std::ranges::find(created_info, qf_idx, &VkDeviceQueueCreateInfo::queueFamilyIndex) != created_info.end()) {
+				continue;
+			}
+			queue_info.pushBack({
+				.sType = VkStructureType::VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+				.queueFamilyIndex = qf_idx,
+				.queueCount = 1u,
+				.pQueuePriorities = &priority
+			});
+		}
 
 		VkPhysicalDeviceRayQueryFeaturesKHR ray_query {
 			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR,
@@ -223,14 +318,26 @@ namespace {
 			.pNext = &ray_query,
 			.accelerationStructure = VK_TRUE
 		};
+		VkPhysicalDeviceMultiviewFeatures multiview {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES,
+			.pNext = &accel_struct,
+			.multiview = VK_TRUE,
+			.multiviewTessellationShader = ctx.MultiviewTessellationSupport ? VK_TRUE : VK_FALSE
+		};
 		VkPhysicalDeviceMaintenance4Features maintenance_4 {
 			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_4_FEATURES,
-			.pNext = &accel_struct,
+			.pNext = &multiview,
 			.maintenance4 = VK_TRUE
 		};
+		VkPhysicalDeviceDescriptorIndexingFeatures des_indexing {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES,
+			.pNext = &maintenance_4,
+			.descriptorBindingPartiallyBound = VK_TRUE,
+			.runtimeDescriptorArray = VK_TRUE
+		};
 		VkPhysicalDevice16BitStorageFeatures storage_16bit {
 			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES,
-			.pNext = &maintenance_4,
+			.pNext = &des_indexing,
 			.storageBuffer16BitAccess = VK_TRUE
 		};
 		VkPhysicalDeviceDynamicRenderingFeatures dynamic_rendering {
@@ -269,30 +376,87 @@ namespace {
 			.pNext = &sep_depth_stencil,
 			.synchronization2 = VK_TRUE
 		};
+		VkPhysicalDeviceHostQueryResetFeatures host_query_reset {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES,
+			.pNext = &sync2,
+			.hostQueryReset = VK_TRUE
+		};
 		VkPhysicalDeviceIndexTypeUint8FeaturesEXT uint8_index {
 			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT,
-			.pNext = &sync2,
+			.pNext = &host_query_reset,
 			.indexTypeUint8 = VK_TRUE
 		};
+		VkPhysicalDevicePresentIdFeaturesKHR present_id {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+			.pNext = &uint8_index,
+			.presentId = VK_TRUE
+		};
+		VkPhysicalDevicePresentWaitFeaturesKHR present_wait {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+			.pNext = &present_id,
+			.presentWait = VK_TRUE
+		};
+		VkPhysicalDeviceMeshShaderFeaturesEXT mesh_shader {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+			.pNext = enable_present_wait ? static_cast<void*>(&present_wait) : static_cast<void*>(&uint8_index),
+			.taskShader = VK_TRUE,
+			.meshShader = VK_TRUE
+		};
+		VkPhysicalDeviceRayTracingPipelineFeaturesKHR ray_tracing {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
+			.pNext = ctx.MeshShaderSupport ? static_cast<void*>(&mesh_shader) : mesh_shader.pNext,
+			.rayTracingPipeline = VK_TRUE
+		};
+		VkPhysicalDeviceHostImageCopyFeaturesEXT host_image_copy {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT,
+			.pNext = ctx.RayTracingPipelineSupport ? static_cast<void*>(&ray_tracing) : ray_tracing.pNext,
+			.hostImageCopy = VK_TRUE
+		};
 		VkPhysicalDeviceFeatures2 feature10 {
 			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
-			.pNext = &uint8_index,
+			.pNext = ctx.HostImageCopySupport ? static_cast<void*>(&host_image_copy) : host_image_copy.pNext,
 			.features = {
 				.tessellationShader = VK_TRUE,
 				.sampleRateShading = VK_TRUE,
+				//culled draws are issued with indirect count, each of which may contain any instance
+				.multiDrawIndirect = VK_TRUE,
+				.drawIndirectFirstInstance = VK_TRUE,
 				.samplerAnisotropy = VK_TRUE,
+				.textureCompressionBC = VK_TRUE,
+				.pipelineStatisticsQuery = ctx.PipelineStatisticsQuerySupport ? VK_TRUE : VK_FALSE,
+				.shaderStorageImageReadWithoutFormat = VK_TRUE,
+				.shaderStorageImageWriteWithoutFormat = VK_TRUE,
+				.shaderSampledImageArrayDynamicIndexing = VK_TRUE,
+				.shaderStorageBufferArrayDynamicIndexing = VK_TRUE,
+				.shaderStorageImageArrayDynamicIndexing = VK_TRUE,
 				.shaderFloat64 = VK_TRUE,
 				.shaderInt64 = VK_TRUE,
 				.shaderInt16 = VK_TRUE
 			}
 		};
+		auto extension = vector(RequiredExtension.cbegin(), RequiredExtension.cend());
+		if (enable_present_wait) {
+			extension.insert(extension.cend(), ::PresentWaitExtension.cbegin(), ::PresentWaitExtension.cend());
+		}
+		if (ctx.MeshShaderSupport) {
+			extension.insert(extension.cend(), ::MeshShaderExtension.cbegin(), ::MeshShaderExtension.cend());
+		}
+		if (ctx.RayTracingPipelineSupport) {
+			extension.insert(extension.cend(), ::RayTracingPipelineExtension.cbegin(), ::RayTracingPipelineExtension.cend());
+		}
+		if (ctx.HostImageCopySupport) {
+			extension.insert(extension.cend(), ::HostImageCopyExtension.cbegin(), ::HostImageCopyExtension.cend());
+		}
+		if (enable_memory_budget) {
+			extension.insert(extension.cend(), ::MemoryBudgetExtension.cbegin(), ::MemoryBudgetExtension.cend());
+		}
 		const VkDeviceCreateInfo dev_info {
 			.sType = VkStructureType::VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
 			.pNext = &feature10,
-			.queueCreateInfoCount = queue_info_count,
+			.queueCreateInfoCount = static_cast<uint32_t>(queue_info.size()),
 			.pQueueCreateInfos = queue_info.data(),
-			.enabledExtensionCount = static_cast<uint32_t>(RequiredExtension.size()),
-			.ppEnabledExtensionNames = RequiredExtension.data()
+			.enabledExtensionCount = static_cast<uint32_t>(extension.size()),
+			.ppEnabledExtensionNames = extension.data()
 		};
 		VKO::Device device = VKO::createDevice(ctx.PhysicalDevice, dev_info);
 
@@ -311,17 +475,20 @@ namespace {
 			return queue;
 		};
 
-		return make_tuple(move(device), get_queue(render_queue_idx), get_queue(present_queue_idx));
+		return make_tuple(move(device), get_queue(render_queue_idx), get_queue(present_queue_idx),
+			get_queue(compute_queue_idx), get_queue(transfer_queue_idx));
 	}
 
-	inline VKO::Allocator createGlobalVma(const VkInstance instance, const VkPhysicalDevice gpu, const VkDevice device) {
+	inline VKO::Allocator createGlobalVma(const VkInstance instance, const VkPhysicalDevice gpu, const VkDevice device,
+		const bool memory_budget) {
 		const VmaVulkanFunctions alloc_func {
 			.vkGetInstanceProcAddr = vkGetInstanceProcAddr,
 			.vkGetDeviceProcAddr = vkGetDeviceProcAddr
 		};
 		const VmaAllocatorCreateInfo alloc_info {
-			//HACK: we are not doing multithreading in this tutorial, but remember to remove it if we need to do so.
-			.flags = VMA_ALLOCATOR_CREATE_EXTERNALLY_SYNCHRONIZED_BIT | VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+			//allocator is internally synchronised, as renderers may record commands from multiple threads
+			.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT
+				| (memory_budget ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : VmaAllocatorCreateFlags { 0 }),
 			.physicalDevice = gpu,
 			.device = device,
 			.pVulkanFunctions = &alloc_func,
@@ -418,9 +585,18 @@ namespace {
 
 }
 
-MasterEngine::MasterEngine(GLFWwindow* const canvas, const Camera::CameraData& camera_data, ostream& msg) :
+MasterEngine::MasterEngine(const CreateInfo& engine_info) :
 	DbgCbUserData(EngineSetting::EnableValidation ? std::make_unique<DebugCallbackUserData>() : nullptr),
-	AttachedRenderer(nullptr), FrameInFlightIndex(0u) {
+	OffscreenRendering(engine_info.Offscreen), Pacer(engine_info.Pacing), AttachedRenderer(nullptr), FrameInFlightIndex(0u) {
+	CPU_PROFILE_SCOPE("Engine setup");
+	GLFWwindow* const canvas = engine_info.Canvas;
+	ostream& msg = *engine_info.DebugMessage;
+	if (engine_info.FrameInFlight == 0u || engine_info.FrameInFlight > EngineSetting::MaxFrameInFlight) {
+		throw runtime_error("The number of frame in flight must be between 1 and " + std::to_string(EngineSetting::MaxFrameInFlight));
+	}
+	this->Context.FrameInFlight = engine_info.FrameInFlight;
+	this->Context.PresentLayout = this->OffscreenRendering ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
 	/*********************************
 	 * Application context creation
 	 ********************************/
@@ -428,46 +604,68 @@ MasterEngine::MasterEngine(GLFWwindow* const canvas, const Camera::CameraData& c
 		//HACK: It's actually not a very good practice to pass the entire context structure into each create functions
 		//while not all members are fully initialised, and relying on the fact that those functions only use subset of initialised members.
 		//It is done just because of my laziness to reduce typing many function arguments.
-		VKO::Instance instance = createInstance(msg);
+		auto [instance, debug_utils] = createInstance(msg);
 		volkLoadInstance(instance);
+		if (debug_utils) {
+			CpuProfiler::enableDebugLabel();
+		}
 		//need to create a surface first because we need to find surface format when selecting physical device
 		this->Surface = createSurface(canvas, instance);
 
 		//select an appropriate physical device
 		const CTX::VulkanContext context = CTX::selectPhysicalDevice(instance, this->Surface, ContextRequirement);
 	
-		auto [logical_device, render_queue, present_queue] = createLogicalDevice(context);
+		//present wait is only useful when there is something to be presented
+		const bool present_wait = !this->OffscreenRendering && isPresentWaitSupported(context.PhysicalDevice);
+		this->Pacer.enablePresentWait(present_wait);
+		const bool memory_budget = CTX::isDeviceExtensionSupported(context.PhysicalDevice, ::MemoryBudgetExtension);
+	
+		auto [logical_device, render_queue, present_queue, compute_queue, transfer_queue] =
+			createLogicalDevice(context, present_wait, memory_budget);
 		volkLoadDevice(logical_device);
 
 		this->Context.Instance = move(instance);
 		this->Context.PhysicalDevice = context.PhysicalDevice;
 		this->Context.Device = move(logical_device);
 
-		this->Context.Allocator = createGlobalVma(this->Context.Instance, this->Context.PhysicalDevice, this->Context.Device);
+		this->Context.Allocator = createGlobalVma(this->Context.Instance, this->Context.PhysicalDevice, this->Context.Device, memory_budget);
+		this->MemoryUsage.emplace(this->Context, memory_budget);
 		this->Context.CommandPool = {
 			.Reshape = CommandBufferManager::createCommandPool(this->Context.Device, { }, context.RenderingQueueFamily),
 			.Transient = CommandBufferManager::createCommandPool(this->Context.Device,
 				VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, context.RenderingQueueFamily),
 			.General = CommandBufferManager::createCommandPool(this->Context.Device,
-				VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, context.RenderingQueueFamily)
+				VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, context.RenderingQueueFamily),
+			.ComputeTransient = CommandBufferManager::createCommandPool(this->Context.Device,
+				VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, context.ComputingQueueFamily),
+			.ComputeGeneral = CommandBufferManager::createCommandPool(this->Context.Device,
+				VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, context.ComputingQueueFamily),
+			.Transfer = CommandBufferManager::createCommandPool(this->Context.Device,
+				VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, context.TransferringQueueFamily)
 		};
-		generate(this->Context.CommandPool.InFlightCommandPool, [device = *this->Context.Device, qf = context.RenderingQueueFamily]()
+		generate(span(this->Context.CommandPool.InFlightCommandPool).first(this->Context.FrameInFlight), [device = *this->Context.Device, qf = context.RenderingQueueFamily]()
 			{ return CommandBufferManager::createCommandPool(device, { }, qf); });
+		this->Context.PipelineCache = PipelineManager::loadPipelineCache(this->Context.Device, this->Context.PhysicalDevice,
+			::PipelineCacheFilenameRaw.data(), msg);
 
 		this->Context.Queue = {
 			.Render = render_queue,
-			.Present = present_queue
+			.Present = present_queue,
+			.Compute = compute_queue,
+			.Transfer = transfer_queue
 		};
 		this->Context.QueueIndex = {
 			.Render = context.RenderingQueueFamily,
-			.Present = context.PresentingQueueFamily
+			.Present = context.PresentingQueueFamily,
+			.Compute = context.ComputingQueueFamily,
+			.Transfer = context.TransferringQueueFamily
 		};
 
 		//////////////////////
 		/// Logging
 		/////////////////////
 		msg << "Found " << context.TotalPhysicalDevice << " physical device\n";
-		const auto& [dev10_struct, dev11, dev12, dev13, descriptor_buf] = *context.DeviceProperty;
+		const auto& [dev10_struct, dev11, dev12, dev13, descriptor_buf, accel_struct, ray_tracing] = *context.DeviceProperty;
 		const VkPhysicalDeviceProperties& dev10 = dev10_struct.properties;
 
 		msg << "Select physical device:\n";
@@ -483,10 +681,31 @@ MasterEngine::MasterEngine(GLFWwindow* const canvas, const Camera::CameraData& c
 		msg << "Found " << context.TotalQueueFamily << " device queue family\n";
 		msg << "Select rendering queue family " << context.RenderingQueueFamily << '\n';
 		msg << "Select presenting queue family " << context.PresentingQueueFamily << '\n';
+		msg << "Select computing queue family " << context.ComputingQueueFamily << '\n';
+		msg << "Select transferring queue family " << context.TransferringQueueFamily << '\n';
+		msg << "Present wait " << (present_wait ? "enabled" : "disabled") << '\n';
+		msg << "Memory budget " << (memory_budget ? "enabled" : "disabled") << '\n';
+		msg << "Mesh shader " << (context.MeshShaderSupport ? "enabled" : "disabled") << '\n';
+		msg << "Ray tracing pipeline " << (context.RayTracingPipelineSupport ? "enabled" : "disabled") << '\n';
+		msg << "Multiview tessellation " << (context.MultiviewTessellationSupport ? "enabled" : "disabled") << '\n';
+		msg << "Pipeline statistics query " << (context.PipelineStatisticsQuerySupport ? "enabled" : "disabled") << '\n';
+		msg << "Host image copy " << (context.HostImageCopySupport ? "enabled" : "disabled") << '\n';
 		msg << "---------------------------------------------------------------------------" << endl;
 
 		this->Context.PhysicalDeviceProperty = {
-			.DescriptorBuffer = descriptor_buf
+			.Limit = dev10.limits,
+			.DescriptorBuffer = descriptor_buf,
+			.AccelStruct = accel_struct,
+			.RayTracingPipeline = ray_tracing,
+			.HostImageCopyDstLayout = context.HostImageCopySupport
+				? ::getHostImageCopyDstLayout(context.PhysicalDevice) : vector<VkImageLayout> { }
+		};
+		this->Context.Feature = {
+			.MeshShader = context.MeshShaderSupport,
+			.RayTracingPipeline = context.RayTracingPipelineSupport,
+			.MultiviewTessellation = context.MultiviewTessellationSupport,
+			.PipelineStatisticsQuery = context.PipelineStatisticsQuerySupport,
+			.HostImageCopy = context.HostImageCopySupport
 		};
 	}
 
@@ -503,12 +722,17 @@ MasterEngine::MasterEngine(GLFWwindow* const canvas, const Camera::CameraData& c
 	}
 
 	this->createPresentation(canvas);
-	msg << this->SwapChainImage.size() << " swap chain image has been queried" << endl;
+	if (this->OffscreenRendering) {
+		msg << "Rendering offscreen to " << this->SwapChainImage.size() << " image" << endl;
+	} else {
+		msg << this->SwapChainImage.size() << " swap chain image has been queried" << endl;
+	}
+	msg << this->Context.FrameInFlight << " frame in flight" << endl;
 
 	/*******************
 	 * Renderer
 	 ******************/
-	generate(this->DrawSync, [&ctx = std::as_const(this->Context)]() {
+	generate(span(this->DrawSync).first(this->Context.FrameInFlight), [&ctx = std::as_const(this->Context)]() {
 		auto [available_sema, finish_sema, wait_frame] = createSyncPrimitive(ctx);
 		return DrawSynchronisationPrimitive {
 			.ImageAvailable = move(available_sema),
@@ -518,27 +742,170 @@ MasterEngine::MasterEngine(GLFWwindow* const canvas, const Camera::CameraData& c
 		};
 	});
 
+	this->FrameMemory.emplace(this->Context);
 	this->SceneCamera.emplace(Camera::CreateInfo {
 		.Context = &this->Context,
-		.CameraInfo = &camera_data
+		.FrameMemory = &*this->FrameMemory,
+		.CameraInfo = engine_info.CameraData
 	});
+
+	/****************
+	 * Profiling
+	 ***************/
+	this->Profiler.emplace(this->Context);
+	{
+		const auto allocateInFlight = [&ctx = std::as_const(this->Context)]() {
+			return std::get<CommandBufferManager::InFlightCommandBufferArray>(
+				CommandBufferManager::allocateCommandBuffer(ctx, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+					CommandBufferManager::CommandBufferType::InFlight));
+		};
+		this->FrameProfile.Begin = allocateInFlight();
+		this->FrameProfile.End = allocateInFlight();
+		this->FrameProfile.Region = this->Profiler->registerRegion("Frame");
+	}
+
+	/**************
+	 * Uploading
+	 *************/
+	this->Uploader.emplace(this->Context);
+
+	/*********************
+	 * Pipeline library
+	 ********************/
+	this->PipelineLibrary.emplace(this->Context, EngineSetting::BackgroundPipelineOptimisation);
+
+	/**********************
+	 * Dynamic resolution
+	 *********************/
+	if (engine_info.Resolution) {
+		this->Resolution.emplace(this->Context, *this->PipelineLibrary, ::SwapChainImageViewFormat, *engine_info.Resolution, msg);
+		this->Resolution->reshape(this->SwapChainExtent);
+
+		this->ResolutionProfile.Upscale = std::get<CommandBufferManager::InFlightCommandBufferArray>(
+			CommandBufferManager::allocateCommandBuffer(this->Context, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				CommandBufferManager::CommandBufferType::InFlight));
+		this->ResolutionProfile.Region = this->Profiler->registerRegion("Render");
+		msg << "Dynamic resolution enabled, target frame time " << engine_info.Resolution->TargetFrameTime << " ms" << endl;
+	}
+
+	/**********************
+	 * Mip-map generation
+	 *********************/
+	this->MipMap.emplace(this->Context, msg);
+
+	/*********************
+	 * Buffer arena
+	 ********************/
+	this->Arena.emplace(this->Context);
+
+	/*********************************
+	 * Acceleration structure memory
+	 ********************************/
+	this->AccelStructMemory.emplace(this->Context);
+
+	/********************
+	 * Descriptor heap
+	 *******************/
+	this->Heap.emplace(this->Context);
+
+	/****************************
+	 * Parallel command recording
+	 ***************************/
+	{
+		const uint32_t worker_count = std::clamp(std::thread::hardware_concurrency(), 1u, EngineSetting::MaxRecordingWorker);
+		this->Job.emplace(worker_count);
+		this->WorkerCommand.emplace(this->Context, worker_count);
+		msg << "Start " << worker_count << " command recording workers" << endl;
+	}
 }
 
-MasterEngine::~MasterEngine() = default;
+MasterEngine::~MasterEngine() {
+	try {
+		PipelineManager::savePipelineCache(this->Context.Device, this->Context.PhysicalDevice, this->Context.PipelineCache,
+			::PipelineCacheFilenameRaw.data());
+	} catch (...) {
+		//failing to save only costs pipeline compilation in the next run, which should not prevent the engine from shutting down
+	}
+}
 
 inline void MasterEngine::createPresentation(GLFWwindow* const canvas) {
+	//frames in flight may still be rendering to or presenting the current images
+	if (this->SwapChainImage.size() > 0u) {
+		RetiredPresentation& retired = this->RetiredPresent.emplace_back(RetiredPresentation {
+			.SwapChain = move(this->SwapChain),
+			.OffscreenImage = move(this->OffscreenImage),
+			.Image = move(this->SwapChainImage)
+		});
+		transform(span(this->DrawSync).first(this->Context.FrameInFlight), retired.FrameCounter.begin(),
+			&DrawSynchronisationPrimitive::FrameCounter);
+		this->SwapChainImage = { };
+	}
+	const VkSwapchainKHR old_swap_chain = this->RetiredPresent.empty() ? VK_NULL_HANDLE : *this->RetiredPresent.back().SwapChain;
+
+	if (this->OffscreenRendering) {
+		int w, h;
+		glfwGetFramebufferSize(canvas, &w, &h);
+		this->SwapChainExtent = { static_cast<uint32_t>(w), static_cast<uint32_t>(h) };
+
+		this->SwapChainImage = CTX::SwapchainImage(this->Context.FrameInFlight);
+		for (const auto i : iota(0u, this->Context.FrameInFlight)) {
+			VKO::ImageAllocation& image = this->OffscreenImage[i];
+			image = ImageManager::createImage({
+				.Device = this->Context.Device,
+				.Allocator = this->Context.Allocator,
+				.Category = VKO::AllocationCategory::Attachment,
+				.ImageType = VK_IMAGE_TYPE_2D,
+				.Format = ::SwapChainImageViewFormat,
+				.Extent = { this->SwapChainExtent.width, this->SwapChainExtent.height, 1u },
+				.Usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+			});
+			this->SwapChainImage[i] = make_pair(*image.second, ImageManager::createFullImageView({
+				.Device = this->Context.Device,
+				.Image = image.second,
+				.ViewType = VK_IMAGE_VIEW_TYPE_2D,
+				.Format = ::SwapChainImageViewFormat,
+				.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+			}));
+		}
+		return;
+	}
+
+	const StaticArray<VkPresentModeKHR> present_mode = CTX::querySurfacePresentMode(this->Context.PhysicalDevice, this->Surface);
 	const EngineSwapchainCreateInfo swapchain_info {
 		.ImageFormat = ContextRequirement.Format,
 		.ImageColourSpace = ContextRequirement.ColourSpace,
-		.Presentation = ContextRequirement.PresentMode
+		.Presentation = this->Pacer.selectPresentMode(present_mode.toSpan())
 	};
-	auto [swap_chain, swap_chain_extent] = createSwapchain(canvas, this->Context, this->Surface, swapchain_info);
+	auto [swap_chain, swap_chain_extent] = createSwapchain(canvas, this->Context, this->Surface, swapchain_info, old_swap_chain);
 
 	this->SwapChain = move(swap_chain);
 	this->SwapChainExtent = swap_chain_extent;
 	this->SwapChainImage = CTX::querySwapchainImage(this->Context.Device, this->SwapChain, ::SwapChainImageViewFormat);
 }
 
+void MasterEngine::releaseRetiredPresentation() const {
+	if (this->RetiredPresent.empty()) {
+		return;
+	}
+	const size_t frame_in_flight = this->Context.FrameInFlight;
+	array<uint64_t, EngineSetting::MaxFrameInFlight> finished;
+	transform(span(this->DrawSync).first(frame_in_flight), finished.begin(), [device = *this->Context.Device](const DrawSynchronisationPrimitive& sync) {
+		uint64_t value;
+		CHECK_VULKAN_ERROR(vkGetSemaphoreCounterValue(device, sync.WaitFrame, &value));
+		return value;
+	});
+	//presentation is retired in order, so the oldest one always finishes first
+	const auto first_busy = std::ranges::find_if_not(this->RetiredPresent, [&finished, frame_in_flight](const RetiredPresentation& retired) {
+		return std::ranges::equal(span(finished).first(frame_in_flight), span(retired.FrameCounter).first(frame_in_flight),
+			std::ranges::greater_equal { });
+	});
+	this->RetiredPresent.erase(this->RetiredPresent.begin(), first_busy);
+}
+
+inline VkExtent2D MasterEngine::renderExtent() const noexcept {
+	return this->Resolution ? this->Resolution->renderExtent() : this->SwapChainExtent;
+}
+
 const VulkanContext& MasterEngine::context() const noexcept {
 	return this->Context;
 }
@@ -547,13 +914,62 @@ Camera& MasterEngine::camera() noexcept {
 	return *this->SceneCamera;
 }
 
+TimestampProfiler& MasterEngine::profiler() noexcept {
+	return *this->Profiler;
+}
+
+const TimestampProfiler& MasterEngine::profiler() const noexcept {
+	return *this->Profiler;
+}
+
+double MasterEngine::gpuFrameTime() const noexcept {
+	return this->Profiler->regionTime()[this->FrameProfile.Region].Millisecond;
+}
+
+const PresentPacer& MasterEngine::presentPacer() const noexcept {
+	return this->Pacer;
+}
+
+StagingUploader& MasterEngine::uploader() noexcept {
+	return *this->Uploader;
+}
+
+PipelineManager::GraphicsPipelineLibrary& MasterEngine::pipelineLibrary() noexcept {
+	return *this->PipelineLibrary;
+}
+
+const MipMapGenerator& MasterEngine::mipMapGenerator() const noexcept {
+	return *this->MipMap;
+}
+
+BufferArena& MasterEngine::bufferArena() noexcept {
+	return *this->Arena;
+}
+
+AccelStructPool& MasterEngine::accelStructPool() noexcept {
+	return *this->AccelStructMemory;
+}
+
+FrameAllocator& MasterEngine::frameAllocator() noexcept {
+	return *this->FrameMemory;
+}
+
+DescriptorHeap& MasterEngine::descriptorHeap() noexcept {
+	return *this->Heap;
+}
+
+const MemoryTelemetry& MasterEngine::memoryTelemetry() const noexcept {
+	return *this->MemoryUsage;
+}
+
 void MasterEngine::attachRenderer(RendererInterface* const renderer) {
+	CPU_PROFILE_SCOPE("Attach renderer");
 	this->AttachedRenderer = renderer;
 	if (this->AttachedRenderer) {
 		//reshape to allocate initial rendering memory
 		this->AttachedRenderer->reshape({
 			.Context = &this->Context,
-			.Extent = this->SwapChainExtent
+			.Extent = this->renderExtent()
 		});
 	}
 }
@@ -567,96 +983,231 @@ void MasterEngine::reshape(GLFWwindow* const canvas) {
 			glfwGetFramebufferSize(canvas, &w, &h);
 			glfwWaitEvents();
 		}
-		CHECK_VULKAN_ERROR(vkDeviceWaitIdle(this->Context.Device));
+		//The old presentation context is kept alive until frames in flight have finished with it,
+		//swap chain extent will be updated when presentation is re-created.
+		const VkExtent2D old_extent = this->SwapChainExtent;
+		this->createPresentation(canvas);
+		//Attachments of the renderer are still valid if the extent is the same, such as when only the present mode changes.
+		//Yet renderers cache commands writing to swap chain images, unless they only write to render targets of dynamic resolution.
+		if (this->SwapChainExtent.width == old_extent.width && this->SwapChainExtent.height == old_extent.height && this->Resolution) {
+			return;
+		}
 
-		//delete old presentation context first in the correct order
-		this->SwapChain->reset();
+		//Attachments are owned by the renderer, which are destroyed on reshape.
+		//Renderer reshape commands are also submitted to the rendering queue, without being tracked by any frame.
+		CHECK_VULKAN_ERROR(vkQueueWaitIdle(this->Context.Queue.Render));
 		CHECK_VULKAN_ERROR(vkResetCommandPool(this->Context.Device, this->Context.CommandPool.Reshape, { }));
+		this->WorkerCommand->resetReshape();
 
-		//Then recreate all of them, swap chain extent will be updated when presentation is re-created.
-		this->createPresentation(canvas);
+		if (this->Resolution) {
+			this->Resolution->reshape(this->SwapChainExtent);
+		}
 		this->attachRenderer(this->AttachedRenderer);
 	}
 	//update camera
 	{
-		const auto [w, h] = this->SwapChainExtent;
+		const auto [w, h] = this->renderExtent();
 		this->SceneCamera->setAspect(w, h);
 	}
 }
 
+void MasterEngine::setPresentMode(GLFWwindow* const canvas, const VkPresentModeKHR mode) {
+	this->Pacer.setPreferredPresentMode(mode);
+	if (!this->OffscreenRendering) {
+		this->reshape(canvas);
+	}
+}
+
+double MasterEngine::waitNextFrame() {
+	return this->Pacer.waitNextFrame(this->Context.Device, this->SwapChain, this->Context.FrameInFlight);
+}
+
 void MasterEngine::draw(const double delta_time) const {
+	CPU_PROFILE_SCOPE("Draw");
 	const auto& [image_available_sema, render_finish_sema, wait_frame, frame_counter] = this->DrawSync[this->FrameInFlightIndex];
 	/****************************
 	 * Rendering
 	 ***************************/
 	//wait for previous rendering on the same in-flight index to finish before starting the current
-	SemaphoreManager::wait<1u>(this->Context.Device, { }, {{{ wait_frame, frame_counter++ }}});
-	//it is cheaper to reset the command pool globally than issuing reset to individual command buffer
-	CHECK_VULKAN_ERROR(vkResetCommandPool(this->Context.Device,
-		this->Context.CommandPool.InFlightCommandPool[this->FrameInFlightIndex], { }));
+	{
+		CPU_PROFILE_SCOPE("Wait frame");
+		SemaphoreManager::wait<1u>(this->Context.Device, { }, {{{ wait_frame, frame_counter++ }}});
+	}
+	//timestamps from the last use of this in-flight frame are now available
+	this->Profiler->resolve(this->FrameInFlightIndex);
+	this->releaseRetiredPresentation();
+	//the render extent only changes between frames, after every frame in flight has finished
+	if (this->Resolution && this->Resolution->update(this->Profiler->regionTime()[this->ResolutionProfile.Region].Millisecond)) {
+		//see reshape of the master engine
+		CHECK_VULKAN_ERROR(vkQueueWaitIdle(this->Context.Queue.Render));
+		CHECK_VULKAN_ERROR(vkResetCommandPool(this->Context.Device, this->Context.CommandPool.Reshape, { }));
+		this->WorkerCommand->resetReshape();
+
+		this->Resolution->reshape(this->SwapChainExtent);
+		const VkExtent2D render_extent = this->Resolution->renderExtent();
+		this->SceneCamera->setAspect(render_extent.width, render_extent.height);
+		if (this->AttachedRenderer) {
+			this->AttachedRenderer->reshape({
+				.Context = &this->Context,
+				.Extent = render_extent
+			});
+		}
+	}
+	{
+		CPU_PROFILE_SCOPE("Reset pool");
+		//it is cheaper to reset the command pool globally than issuing reset to individual command buffer
+		CHECK_VULKAN_ERROR(vkResetCommandPool(this->Context.Device,
+			this->Context.CommandPool.InFlightCommandPool[this->FrameInFlightIndex], { }));
+		this->WorkerCommand->reset(this->FrameInFlightIndex);
+		//all transient memory of this in-flight frame is no longer in use
+		this->FrameMemory->reset(this->FrameInFlightIndex);
+	}
 
 	this->SceneCamera->update(this->FrameInFlightIndex);
 
-	//acquire image from swap chain
+	//acquire image from swap chain, or use the offscreen image dedicated to this in-flight frame
 	uint32_t image_index;
-	CHECK_VULKAN_ERROR(vkAcquireNextImageKHR(this->Context.Device, this->SwapChain, numeric_limits<uint64_t>::max(),
-		image_available_sema, VK_NULL_HANDLE, &image_index));
+	if (this->OffscreenRendering) {
+		image_index = this->FrameInFlightIndex;
+	} else {
+		CPU_PROFILE_SCOPE("Acquire");
+		CHECK_VULKAN_ERROR(vkAcquireNextImageKHR(this->Context.Device, this->SwapChain, numeric_limits<uint64_t>::max(),
+			image_available_sema, VK_NULL_HANDLE, &image_index));
+	}
 
 	//compose draw command for next frame onto the requested image
 	const auto& [present_img, present_img_view] = this->SwapChainImage[image_index];
+	//with dynamic resolution, the renderer draws into the render target which is later upscaled to the present image
+	const auto [target_img, target_img_view] = this->Resolution ? this->Resolution->renderTarget(this->FrameInFlightIndex)
+		: pair<VkImage, VkImageView>(present_img, present_img_view);
+	const VkExtent2D render_extent = this->renderExtent();
 	const LearnVulkan::RendererInterface::DrawInfo draw_info {
 		.Context = &this->Context,
 		.Camera = &*this->SceneCamera,
+		.Heap = &*this->Heap,
+		.Profiler = &*this->Profiler,
+		.Job = &*this->Job,
+		.WorkerCommand = &*this->WorkerCommand,
+		.FrameMemory = &*this->FrameMemory,
 
 		.DeltaTime = delta_time,
 		.FrameInFlightIndex = this->FrameInFlightIndex,
 
 		.Viewport = {
 			.x = 0.0f,
-			.y = 1.0f * this->SwapChainExtent.height,//lower-left origin
-			.width = 1.0f * this->SwapChainExtent.width,
-			.height = -1.0f * this->SwapChainExtent.height,//Y is inverted
+			.y = 1.0f * render_extent.height,//lower-left origin
+			.width = 1.0f * render_extent.width,
+			.height = -1.0f * render_extent.height,//Y is inverted
 			.minDepth = 0.0f,
 			.maxDepth = 1.0f
 		},
 		.DrawArea = {
 			.offset = { 0, 0 },
-			.extent = this->SwapChainExtent
+			.extent = render_extent
 		},
 
-		.PresentImage = present_img,
-		.PresentImageView = present_img_view
+		.PresentImage = target_img,
+		.PresentImageView = target_img_view
 	};
-	const auto [draw_cmd, wait_stage] = this->AttachedRenderer->draw(draw_info);
-
-	/*************************
-	 * Signal for presentation
-	 *************************/
-	{
+	const auto [draw_cmd, wait_stage] = [this, &draw_info]() {
+		CPU_PROFILE_SCOPE("Record");
+		return this->AttachedRenderer->draw(draw_info);
+	}();
+
+	//mark the whole frame for profiling
+	const VkCommandBuffer frame_begin_cmd = this->FrameProfile.Begin[this->FrameInFlightIndex],
+		frame_end_cmd = this->FrameProfile.End[this->FrameInFlightIndex],
+		upscale_cmd = this->Resolution ? this->ResolutionProfile.Upscale[this->FrameInFlightIndex] : VK_NULL_HANDLE;
+	CommandBufferManager::beginOneTimeSubmit(frame_begin_cmd);
+	this->Profiler->beginRegion(frame_begin_cmd, this->FrameInFlightIndex, this->FrameProfile.Region);
+	if (this->Resolution) {
+		this->Profiler->beginRegion(frame_begin_cmd, this->FrameInFlightIndex, this->ResolutionProfile.Region);
+	}
+	CHECK_VULKAN_ERROR(vkEndCommandBuffer(frame_begin_cmd));
+	CommandBufferManager::beginOneTimeSubmit(frame_end_cmd);
+	if (this->Resolution) {
+		this->Profiler->endRegion(frame_end_cmd, this->FrameInFlightIndex, this->ResolutionProfile.Region);
+
+		//the frame ends after the upscale
+		CommandBufferManager::beginOneTimeSubmit(upscale_cmd);
+		this->Resolution->record(upscale_cmd, this->FrameInFlightIndex, present_img, present_img_view);
+		this->Profiler->endRegion(upscale_cmd, this->FrameInFlightIndex, this->FrameProfile.Region);
+		CHECK_VULKAN_ERROR(vkEndCommandBuffer(upscale_cmd));
+	} else {
+		this->Profiler->endRegion(frame_end_cmd, this->FrameInFlightIndex, this->FrameProfile.Region);
+	}
+	CHECK_VULKAN_ERROR(vkEndCommandBuffer(frame_end_cmd));
+
+	//make everything written to transient memory by the camera and renderer visible before submission
+	this->FrameMemory->flush(this->FrameInFlightIndex);
+	const CommandBufferManager::CommandSubmitInfo render_submit { this->Context.Device, this->Context.Queue.Render };
+	CpuProfiler::beginQueueLabel(this->Context.Queue.Render, "Frame");
+	if (this->Resolution) {
+		CPU_PROFILE_SCOPE("Submit");
+		//nothing drawn by the renderer needs the present image, so only the upscale waits for it
+		CommandBufferManager::submit<3u>(render_submit, { frame_begin_cmd, draw_cmd, frame_end_cmd }, {{ }}, {{ }});
+	}
+	if (this->OffscreenRendering) {
+		const array<const CommandBufferManager::SemaphoreOperation, 1u> frame_signal {{
+			{ wait_frame, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame_counter }
+		}};
+		{
+			CPU_PROFILE_SCOPE("Submit");
+			if (this->Resolution) {
+				CommandBufferManager::submit<1u, 0u, 1u>(render_submit, { upscale_cmd }, {{ }}, frame_signal, VK_NULL_HANDLE);
+			} else {
+				CommandBufferManager::submit<3u, 0u, 1u>(render_submit,
+					{ frame_begin_cmd, draw_cmd, frame_end_cmd }, {{ }}, frame_signal, VK_NULL_HANDLE);
+			}
+		}
+		CpuProfiler::endQueueLabel(this->Context.Queue.Render);
+	} else {
+		/*************************
+		 * Signal for presentation
+		 *************************/
 		const VkSemaphore wait_sema = image_available_sema,
 			signal_sema = render_finish_sema;
 		const VkSwapchainKHR swap_chain = this->SwapChain;
 
+		const uint64_t present_id = this->Pacer.presentID();
+		const VkPresentIdKHR present_id_info {
+			.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+			.swapchainCount = 1u,
+			.pPresentIds = &present_id
+		};
 		const VkPresentInfoKHR present_info {
 			.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+			.pNext = this->Pacer.presentWaitEnabled() ? &present_id_info : nullptr,
 			.waitSemaphoreCount = 1u,
 			.pWaitSemaphores = &signal_sema,
 			.swapchainCount = 1u,
 			.pSwapchains = &swap_chain,
 			.pImageIndices = &image_index
 		};
+		const array<const CommandBufferManager::SemaphoreOperation, 2u> frame_signal {{
+			//looks like WSI only supports binary semaphore
+			{ signal_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+			{ wait_frame, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame_counter }
+		}};
 		//submit draw command
-		CommandBufferManager::submit<1u, 1u, 2u>({ this->Context.Device, this->Context.Queue.Render },
-			{ draw_cmd },
-			{{{ wait_sema, wait_stage }}},
-			{{
-				//looks like WSI only supports binary semaphore
-				{ signal_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
-				{ wait_frame, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame_counter }
-			}}, VK_NULL_HANDLE);
+		{
+			CPU_PROFILE_SCOPE("Submit");
+			if (this->Resolution) {
+				//the upscale writes the present image as colour attachment
+				CommandBufferManager::submit<1u, 1u, 2u>(render_submit, { upscale_cmd },
+					{{{ wait_sema, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT }}}, frame_signal, VK_NULL_HANDLE);
+			} else {
+				CommandBufferManager::submit<3u, 1u, 2u>(render_submit,
+					{ frame_begin_cmd, draw_cmd, frame_end_cmd },
+					{{{ wait_sema, wait_stage }}}, frame_signal, VK_NULL_HANDLE);
+			}
+		}
+		CpuProfiler::endQueueLabel(this->Context.Queue.Render);
 		//return swap chain image back
+		CPU_PROFILE_SCOPE("Present");
 		CHECK_VULKAN_ERROR(vkQueuePresentKHR(this->Context.Queue.Present, &present_info));
+		this->Pacer.notifyPresent();
 	}
 
-	this->FrameInFlightIndex = (this->FrameInFlightIndex + 1u) % EngineSetting::MaxFrameInFlight;
+	this->FrameInFlightIndex = (this->FrameInFlightIndex + 1u) % this->Context.FrameInFlight;
 }
\ No newline at end of file
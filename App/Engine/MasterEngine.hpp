@@ -3,9 +3,24 @@
 #include "../Common/VulkanObject.hpp"
 #include "../Common/StaticArray.hpp"
 
+#include "AccelStructPool.hpp"
+#include "BufferArena.hpp"
 #include "Camera.hpp"
+#include "DescriptorHeap.hpp"
+#include "DynamicResolution.hpp"
 #include "EngineSetting.hpp"
+#include "FrameAllocator.hpp"
+#include "JobSystem.hpp"
+#include "MemoryTelemetry.hpp"
+#include "MipMapGenerator.hpp"
+#include "PresentPacer.hpp"
 #include "RendererInterface.hpp"
+#include "StagingUploader.hpp"
+#include "TimestampProfiler.hpp"
+#include "WorkerCommandPool.hpp"
+
+#include "Abstraction/CommandBufferManager.hpp"
+#include "Abstraction/PipelineManager.hpp"
 
 #include "ContextManager.hpp"
 #include "VulkanContext.hpp"
@@ -16,6 +31,7 @@
 #include <array>
 #include <optional>
 #include <memory>
+#include <vector>
 
 #include <cstdint>
 
@@ -25,8 +41,50 @@ namespace LearnVulkan {
 	 * @brief The master engine that drives all renderers.
 	*/
 	class MasterEngine {
+	public:
+
+		/**
+		 * @brief Information to create a master engine.
+		*/
+		struct CreateInfo {
+
+			GLFWwindow* Canvas;/**< Specify the canvas used for drawing. */
+			const Camera::CameraData* CameraData;/**< The intrinsic properties to create a camera. */
+			std::ostream* DebugMessage;/**< A stream to be used for debug message output. */
+
+			/**
+			 * @brief Render into images owned by the engine rather than a swap chain, and nothing is presented.
+			 * A canvas is still required to select a physical device capable of presentation, but it can be hidden.
+			 * The output extent follows the canvas framebuffer size.
+			*/
+			bool Offscreen = false;
+			PresentPacer::CreateInfo Pacing;/**< Control frame rate and present mode of presentation. */
+			/**
+			 * @brief The number of frame in flight, in [1, EngineSetting::MaxFrameInFlight].
+			 * Fewer frames give lower latency, and more frames give higher throughput.
+			*/
+			unsigned int FrameInFlight = EngineSetting::DefaultFrameInFlight;
+			/**
+			 * @brief Render at a dynamic resolution to hold a target GPU frame time, or empty to always render at the output extent.
+			 * The renderer is reshaped whenever the render extent changes.
+			*/
+			std::optional<DynamicResolution::CreateInfo> Resolution;
+
+		};
+
 	private:
 
+		//Presentation replaced by a reshape, which may still be used by frames in flight.
+		struct RetiredPresentation {
+
+			VulkanObject::SwapchainKHR SwapChain;
+			std::array<VulkanObject::ImageAllocation, EngineSetting::MaxFrameInFlight> OffscreenImage;
+			ContextManager::SwapchainImage Image;
+			//The last timeline value signalled by each in-flight frame at retirement.
+			std::array<uint64_t, EngineSetting::MaxFrameInFlight> FrameCounter;
+
+		};
+
 		struct DrawSynchronisationPrimitive {
 
 			VulkanObject::Semaphore ImageAvailable, RenderFinish, WaitFrame;
@@ -46,40 +104,77 @@ namespace LearnVulkan {
 		VulkanObject::DebugUtilsMessengerEXT DebugMessage;
 
 		//presentation
+		const bool OffscreenRendering;
 		VulkanObject::SwapchainKHR SwapChain;
+		//Used in place of swap chain images when rendering offscreen, one for each in-flight frame.
+		std::array<VulkanObject::ImageAllocation, EngineSetting::MaxFrameInFlight> OffscreenImage;
 		ContextManager::SwapchainImage SwapChainImage;
 		VkExtent2D SwapChainExtent;
+		mutable std::vector<RetiredPresentation> RetiredPresent;
+		mutable PresentPacer Pacer;
 
 		//rendering
 		std::array<DrawSynchronisationPrimitive, EngineSetting::MaxFrameInFlight> DrawSync;
 
 		//our objects
+		std::optional<MemoryTelemetry> MemoryUsage;
+		mutable std::optional<FrameAllocator> FrameMemory;
 		mutable std::optional<Camera> SceneCamera;
+		mutable std::optional<TimestampProfiler> Profiler;
+		std::optional<StagingUploader> Uploader;
+		std::optional<PipelineManager::GraphicsPipelineLibrary> PipelineLibrary;
+		std::optional<MipMapGenerator> MipMap;
+		std::optional<BufferArena> Arena;
+		std::optional<AccelStructPool> AccelStructMemory;
+		std::optional<DescriptorHeap> Heap;
+		mutable std::optional<JobSystem> Job;
+		mutable std::optional<WorkerCommandPool> WorkerCommand;
+		//Timestamp commands submitted around the renderer command to profile the whole frame.
+		struct {
+
+			CommandBufferManager::InFlightCommandBufferArray Begin, End;
+			TimestampProfiler::RegionIdentifier Region;
+
+		} FrameProfile;
+		mutable std::optional<DynamicResolution> Resolution;
+		//The upscale is submitted separately from the renderer, such that only the upscale waits for the swap chain image,
+		//and the time spent by the renderer is profiled without waiting.
+		struct {
+
+			CommandBufferManager::InFlightCommandBufferArray Upscale;
+			TimestampProfiler::RegionIdentifier Region;
+
+		} ResolutionProfile;
 		RendererInterface* AttachedRenderer;
 
 		/**
 		 * @brief Allow rendering the next frame before the previous one has finished.
 		 * This counter keeps track of which sub-frame we are working on right now.
-		 * @see EngineSetting::MaxFrameInFlight
+		 * @see VulkanContext::FrameInFlight
 		*/
 		mutable unsigned int FrameInFlightIndex;
 
 		/**
 		 * @brief Create (or recreate if already) presentation context.
+		 * The old presentation context is retired rather than destroyed, and the old swap chain is handed over to the new one.
 		 * @param canvas The canvas to be presented on.
 		*/
 		void createPresentation(GLFWwindow*);
 
+		//Destroy retired presentation whose every frame in flight has finished.
+		void releaseRetiredPresentation() const;
+
+		//The extent the renderer renders at, which is the output extent unless dynamic resolution is enabled.
+		VkExtent2D renderExtent() const noexcept;
+
 	public:
 
 		/**
 		 * @brief Initialise the master engine.
 		 * The caller should retain the lifetime of all references until the constructing master engine is destroyed.
-		 * @param canvas Specify the canvas used for drawing.
-		 * @param camera_data The intrinsic properties to create a camera.
-		 * @param msg A stream to be used for debug message output.
+		 * @param engine_info The information to create the master engine.
 		*/
-		MasterEngine(GLFWwindow*, const Camera::CameraData&, std::ostream&);
+		MasterEngine(const CreateInfo&);
 
 		MasterEngine(const MasterEngine&) = delete;
 
@@ -96,6 +191,48 @@ namespace LearnVulkan {
 		//////////////////////////////////////
 		const VulkanContext& context() const noexcept;
 		Camera& camera() noexcept;
+		TimestampProfiler& profiler() noexcept;
+		const TimestampProfiler& profiler() const noexcept;
+		/**
+		 * @brief Get the GPU time of the whole frame, in millisecond.
+		 * Like every other profiled region, it is the result from the last frame using the current in-flight frame index.
+		 * When presenting to a swap chain, this also includes any time spent waiting for the swap chain image to become available.
+		*/
+		double gpuFrameTime() const noexcept;
+		const PresentPacer& presentPacer() const noexcept;
+		/**
+		 * @brief Get the uploader shared by all renderers for uploading data from host.
+		 * Ownership of uploaded resources is transferred to the rendering queue family.
+		*/
+		StagingUploader& uploader() noexcept;
+		/**
+		 * @brief Get the graphics pipeline library shared by all renderers, such that identical pipeline parts are built once.
+		*/
+		PipelineManager::GraphicsPipelineLibrary& pipelineLibrary() noexcept;
+		/**
+		 * @brief Get the compute mip-map generator shared by all renderers.
+		*/
+		const MipMapGenerator& mipMapGenerator() const noexcept;
+		/**
+		 * @brief Get the arena shared by all renderers for sub-allocating device-local buffers.
+		*/
+		BufferArena& bufferArena() noexcept;
+		/**
+		 * @brief Get the pool shared by all renderers for memory of acceleration structure.
+		*/
+		AccelStructPool& accelStructPool() noexcept;
+		/**
+		 * @brief Get the allocator of per-frame transient memory, which is also given to the renderer when drawing.
+		*/
+		FrameAllocator& frameAllocator() noexcept;
+		/**
+		 * @brief Get the descriptor heap shared by all renderers, which is also given to the renderer when drawing.
+		*/
+		DescriptorHeap& descriptorHeap() noexcept;
+		/**
+		 * @brief Get the report of device memory usage of each memory heap and allocation category.
+		*/
+		const MemoryTelemetry& memoryTelemetry() const noexcept;
 		//////////////////////////////////////
 
 		/**
@@ -109,10 +246,28 @@ namespace LearnVulkan {
 		/**
 		 * @brief Reshape the presentation context.
 		 * This function should be called whenever the canvas has reshaped.
+		 * Frames in flight are not waited for, unless the renderer needs to be reshaped as the extent has changed.
 		 * @param canvas The canvas to be reshaped.
 		*/
 		void reshape(GLFWwindow*);
 
+		/**
+		 * @brief Change the present mode, and recreate the presentation context.
+		 * FIFO mode is used if the requested mode is not supported by the surface.
+		 * This has no effect on the output when rendering offscreen.
+		 * @param canvas The canvas being presented on.
+		 * @param mode The requested present mode.
+		*/
+		void setPresentMode(GLFWwindow*, VkPresentModeKHR);
+
+		/**
+		 * @brief Block until the next frame should be drawn.
+		 * User input should be sampled right after this function returns, so its latency can be measured.
+		 * The camera pose is sampled when the next frame is drawn.
+		 * @return The time since the last frame, in second.
+		*/
+		double waitNextFrame();
+
 		/**
 		 * @brief Execute draw command on one frame.
 		 * @param delta_time The time since the last frame.
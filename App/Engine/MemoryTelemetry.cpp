@@ -0,0 +1,85 @@
+#include "MemoryTelemetry.hpp"
+
+#include <array>
+#include <ranges>
+#include <iomanip>
+
+using std::array;
+using std::ostream;
+using std::views::iota;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	constexpr double toMebibyte(const VkDeviceSize byte) noexcept {
+		return byte / (1024.0 * 1024.0);
+	}
+
+}
+
+MemoryTelemetry::MemoryTelemetry(const VulkanContext& ctx, const bool memory_budget) noexcept :
+	Context(&ctx), MemoryBudget(memory_budget) {
+
+}
+
+MemoryTelemetry::Report MemoryTelemetry::query() const {
+	const VmaAllocator allocator = this->Context->Allocator;
+
+	const VkPhysicalDeviceMemoryProperties* memory_prop;
+	vmaGetMemoryProperties(allocator, &memory_prop);
+	array<VmaBudget, VK_MAX_MEMORY_HEAPS> budget;
+	vmaGetHeapBudgets(allocator, budget.data());
+
+	Report report;
+	for (const auto i : iota(0u, memory_prop->memoryHeapCount)) {
+		const VmaBudget& heap_budget = budget[i];
+		report.Heap.pushBack({
+			.Flag = memory_prop->memoryHeaps[i].flags,
+			.Budget = heap_budget.budget,
+			.Usage = heap_budget.usage,
+			.Block = heap_budget.statistics.blockBytes,
+			.Allocation = heap_budget.statistics.allocationBytes
+		});
+	}
+	report.Category = VKO::queryAllocationStatistic();
+	return report;
+}
+
+void MemoryTelemetry::print(ostream& out) const {
+	const auto [heap, category] = this->query();
+
+	out << "Device memory usage (MiB)" << (this->MemoryBudget ? "" : ", budget is estimated") << '\n' << std::fixed << std::setprecision(1);
+	for (const auto i : iota(size_t { 0 }, heap.size())) {
+		const auto [flag, budget, usage, block, allocation] = heap[i];
+		out << "Heap " << i << ((flag & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "") << ": "
+			<< ::toMebibyte(usage) << " / " << ::toMebibyte(budget) << " used, "
+			<< ::toMebibyte(allocation) << " allocated from " << ::toMebibyte(block) << " in block\n";
+	}
+	for (const auto i : iota(size_t { 0 }, category.size())) {
+		const auto [count, size] = category[i];
+		out << VKO::getAllocationCategoryName(static_cast<VKO::AllocationCategory>(i)) << ": "
+			<< ::toMebibyte(size) << " in " << count << " allocation\n";
+	}
+	out << std::flush;
+}
+
+void MemoryTelemetry::writeJson(ostream& out) const {
+	const auto [heap, category] = this->query();
+
+	out << "{ \"budgetExtension\": " << (this->MemoryBudget ? "true" : "false") << ", \"heap\": [";
+	for (const auto i : iota(size_t { 0 }, heap.size())) {
+		const auto [flag, budget, usage, block, allocation] = heap[i];
+		out << (i == 0u ? " " : ", ") << "{ \"deviceLocal\": " << ((flag & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false")
+			<< ", \"budget\": " << budget << ", \"usage\": " << usage
+			<< ", \"block\": " << block << ", \"allocation\": " << allocation << " }";
+	}
+	out << " ], \"category\": {";
+	for (const auto i : iota(size_t { 0 }, category.size())) {
+		const auto [count, size] = category[i];
+		out << (i == 0u ? " \"" : ", \"") << VKO::getAllocationCategoryName(static_cast<VKO::AllocationCategory>(i))
+			<< "\": { \"count\": " << count << ", \"size\": " << size << " }";
+	}
+	out << " } }";
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "VulkanContext.hpp"
+
+#include "../Common/FixedArray.hpp"
+#include "../Common/VulkanObject.hpp"
+
+#include <ostream>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Report device memory usage of the engine, for each memory heap and each allocation category.
+	 * Heap budget is only accurate when memory budget extension is enabled, otherwise it is estimated by the allocator.
+	*/
+	class MemoryTelemetry {
+	public:
+
+		/**
+		 * @brief Memory usage of a memory heap.
+		*/
+		struct HeapStatistic {
+
+			VkMemoryHeapFlags Flag;
+			/**
+			 * @brief In byte, the memory the process can allocate from the heap without exceeding the limit,
+			 * and the memory the process currently uses from the heap, including those not allocated by the engine.
+			*/
+			VkDeviceSize Budget, Usage;
+			/**
+			 * @brief In byte, device memory blocks allocated by the allocator,
+			 * and the part of them occupied by allocations.
+			*/
+			VkDeviceSize Block, Allocation;
+
+		};
+
+		/**
+		 * @brief A snapshot of memory usage.
+		*/
+		struct Report {
+
+			FixedArray<HeapStatistic, VK_MAX_MEMORY_HEAPS> Heap;
+			VulkanObject::AllocationStatisticArray Category;/**< Indexed by allocation category. */
+
+		};
+
+	private:
+
+		const VulkanContext* const Context;
+		const bool MemoryBudget;
+
+	public:
+
+		/**
+		 * @brief Create a memory telemetry.
+		 * @param ctx The context. The context is retained and must remain valid until the telemetry is destroyed.
+		 * @param memory_budget True if memory budget extension is enabled, and the allocator is created with it.
+		*/
+		MemoryTelemetry(const VulkanContext&, bool) noexcept;
+
+		MemoryTelemetry(const MemoryTelemetry&) = delete;
+
+		MemoryTelemetry(MemoryTelemetry&&) = delete;
+
+		MemoryTelemetry& operator=(const MemoryTelemetry&) = delete;
+
+		MemoryTelemetry& operator=(MemoryTelemetry&&) = delete;
+
+		~MemoryTelemetry() = default;
+
+		/**
+		 * @brief Take a snapshot of the current memory usage.
+		 * This function is thread-safe.
+		 * @return The memory usage report.
+		*/
+		Report query() const;
+
+		/**
+		 * @brief Print the current memory usage in human-readable text.
+		 * @param out The output stream.
+		*/
+		void print(std::ostream&) const;
+
+		/**
+		 * @brief Write the current memory usage as a JSON object, sizes are reported in byte.
+		 * @param out The output stream.
+		*/
+		void writeJson(std::ostream&) const;
+
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "MipMapGenerator.hpp"
+
+#include "Abstraction/BufferManager.hpp"
+#include "Abstraction/ImageManager.hpp"
+#include "Abstraction/PipelineBarrier.hpp"
+#include "Abstraction/ShaderModuleManager.hpp"
+#include "../Common/File.hpp"
+
+#include <LearnVulkan/GeneratedTemplate/ResourcePath.hpp>
+
+#include <shaderc/shaderc.h>
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <ranges>
+
+using std::array, std::string_view;
+using std::ranges::views::iota;
+using std::ostream, std::endl;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	//each workgroup reduces a tile of this many texels on the base level
+	constexpr uint32_t TileDimension = 64u;
+
+	struct GenerationArgument {
+
+		VkDeviceAddress Counter;
+		uint32_t LevelCount, SRGB;
+
+	};
+
+	constexpr string_view MipMapGeneratorCS = "/MipMapGenerator.comp";
+	constexpr auto MipMapGeneratorShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, MipMapGeneratorCS>();
+	constexpr auto MipMapGeneratorShaderFilename = File::batchRawStringToView(MipMapGeneratorShaderFilenameRaw);
+
+	//Get the format to reinterpret the image as for storage.
+	constexpr VkFormat getStorageFormat(const VkFormat format) noexcept {
+		switch (format) {
+		case VK_FORMAT_R8_SRGB: return VK_FORMAT_R8_UNORM;
+		case VK_FORMAT_R8G8_SRGB: return VK_FORMAT_R8G8_UNORM;
+		case VK_FORMAT_R8G8B8A8_SRGB: return VK_FORMAT_R8G8B8A8_UNORM;
+		case VK_FORMAT_B8G8R8A8_SRGB: return VK_FORMAT_B8G8R8A8_UNORM;
+		case VK_FORMAT_A8B8G8R8_SRGB_PACK32: return VK_FORMAT_A8B8G8R8_UNORM_PACK32;
+		default: return format;
+		}
+	}
+
+	inline VKO::DescriptorSetLayout createLevelDescriptorSetLayout(const VkDevice device) {
+		constexpr static VkDescriptorSetLayoutBinding level {
+			.binding = 0u,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.descriptorCount = MipMapGenerator::MaxLevel,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+		};
+		constexpr static VkDescriptorSetLayoutCreateInfo level_ds {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT | VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR,
+			.bindingCount = 1u,
+			.pBindings = &level
+		};
+		return VKO::createDescriptorSetLayout(device, level_ds);
+	}
+
+	inline VKO::PipelineLayout createGeneratorPipelineLayout(const VkDevice device, const VkDescriptorSetLayout ds_layout) {
+		constexpr static VkPushConstantRange argument {
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0u,
+			.size = static_cast<uint32_t>(sizeof(::GenerationArgument))
+		};
+		return VKO::createPipelineLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1u,
+			.pSetLayouts = &ds_layout,
+			.pushConstantRangeCount = 1u,
+			.pPushConstantRanges = &argument
+		});
+	}
+
+}
+
+MipMapGenerator::MipMapGenerator(const VulkanContext& ctx, ostream& msg) : Context(&ctx),
+	LevelLayout(::createLevelDescriptorSetLayout(ctx.Device)),
+	PipelineLayout(::createGeneratorPipelineLayout(ctx.Device, this->LevelLayout)) {
+	msg << "Compiling mip-map generation shader" << endl;
+	constexpr static shaderc_shader_kind compute_shader = shaderc_compute_shader;
+	const ShaderModuleManager::ShaderBatchCompilationInfo generator_info {
+		.Device = ctx.Device,
+		.ShaderFilename = ::MipMapGeneratorShaderFilename.data(),
+		.ShaderKind = &compute_shader
+	};
+	const auto generator_shader_gen = ShaderModuleManager::batchShaderCompilation<1u>(&generator_info, &msg);
+	const VkPipelineShaderStageCreateInfo& generator_stage = generator_shader_gen.promise().ShaderStage.front();
+
+	//filter is specialised, so there is no branching on it per texel
+	constexpr static VkSpecializationMapEntry filter_entry {
+		.constantID = 0u,
+		.offset = 0u,
+		.size = sizeof(ReductionFilter)
+	};
+	std::ranges::transform(iota(0u, static_cast<uint32_t>(this->Pipeline.size())), this->Pipeline.begin(),
+		[&ctx, &generator_stage, layout = *this->PipelineLayout](const uint32_t filter) {
+			const VkSpecializationInfo spec_info {
+				.mapEntryCount = 1u,
+				.pMapEntries = &filter_entry,
+				.dataSize = sizeof(filter),
+				.pData = &filter
+			};
+			VkPipelineShaderStageCreateInfo spec_stage = generator_stage;
+			spec_stage.pSpecializationInfo = &spec_info;
+
+			return VKO::createComputePipeline(ctx.Device, ctx.PipelineCache, {
+				.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+				.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+#ifndef NDEBUG
+				| VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT
+#endif
+				,
+				.stage = spec_stage,
+				.layout = layout
+			});
+		});
+}
+
+VkImageCreateFlags MipMapGenerator::requiredCreateFlag(const VkFormat format) noexcept {
+	//the image allows storage usage which its own format does not support, only through an UNORM view
+	return ::getStorageFormat(format) == format ? VkImageCreateFlags { }
+		: VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+}
+
+bool MipMapGenerator::isSupported(const VkFormat format, const VkExtent2D extent, const uint32_t level) const {
+	if (level < 2u || level > MipMapGenerator::MaxLevel || std::max(extent.width, extent.height) > MipMapGenerator::MaxExtent
+		|| ImageManager::isBlockCompressed(format)) {
+		return false;
+	}
+
+	VkFormatProperties3 format_prop3 {
+		.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3
+	};
+	VkFormatProperties2 format_prop {
+		.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
+		.pNext = &format_prop3
+	};
+	vkGetPhysicalDeviceFormatProperties2(this->Context->PhysicalDevice, ::getStorageFormat(format), &format_prop);
+
+	//the shader accesses every level without format qualifier
+	constexpr static VkFormatFeatureFlags2 required_feature = VK_FORMAT_FEATURE_2_STORAGE_IMAGE_BIT
+		| VK_FORMAT_FEATURE_2_STORAGE_READ_WITHOUT_FORMAT_BIT | VK_FORMAT_FEATURE_2_STORAGE_WRITE_WITHOUT_FORMAT_BIT;
+	return (format_prop3.optimalTilingFeatures & required_feature) == required_feature;
+}
+
+MipMapGenerator::Generation MipMapGenerator::record(const VkCommandBuffer cmd, const GenerationInfo& gen_info) const {
+	const auto& [image, format, extent, layer, level, filter,
+		in_stage, in_access, in_layout, out_stage, out_access, out_layout] = gen_info;
+	const VkDevice device = this->Context->Device;
+	const VkFormat storage_format = ::getStorageFormat(format);
+
+	/******************
+	 * Prepare memory
+	 *****************/
+	Generation generation {
+		.Counter = BufferManager::createDeviceBuffer({ device, this->Context->Allocator, sizeof(uint32_t) * layer },
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			VKO::AllocationCategory::Texture)
+	};
+	generation.LevelView.reserve(level);
+	for (const auto i : iota(0u, level)) {
+		generation.LevelView.push_back(VKO::createImageView(device, {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = image,
+			.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+			.format = storage_format,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = i,
+				.levelCount = 1u,
+				.baseArrayLayer = 0u,
+				.layerCount = layer
+			}
+		}));
+	}
+	vkCmdFillBuffer(cmd, generation.Counter.second, 0ull, VK_WHOLE_SIZE, 0u);
+
+	/*************
+	 * Barrier
+	 ************/
+	{
+		PipelineBarrier<0u, 1u, 2u> barrier;
+		barrier.addBufferBarrier({
+			VK_PIPELINE_STAGE_2_CLEAR_BIT,
+			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		}, generation.Counter.second);
+		barrier.addImageBarrier({
+			in_stage,
+			in_access,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+		}, {
+			in_layout,
+			VK_IMAGE_LAYOUT_GENERAL
+		}, image, {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0u,
+			.levelCount = 1u,
+			.baseArrayLayer = 0u,
+			.layerCount = VK_REMAINING_ARRAY_LAYERS
+		});
+		//some levels are read back by the last workgroup
+		barrier.addImageBarrier({
+			VK_PIPELINE_STAGE_2_NONE,
+			VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		}, {
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL
+		}, image, {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 1u,
+			.levelCount = level - 1u,
+			.baseArrayLayer = 0u,
+			.layerCount = VK_REMAINING_ARRAY_LAYERS
+		});
+		barrier.record(cmd);
+	}
+
+	/*************
+	 * Dispatch
+	 ************/
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->Pipeline[static_cast<size_t>(filter)]);
+
+	//every descriptor in the array is statically used, levels beyond the image are never accessed but must be valid
+	array<VkDescriptorImageInfo, MipMapGenerator::MaxLevel> level_info;
+	std::ranges::transform(iota(0u, MipMapGenerator::MaxLevel), level_info.begin(), [&generation](const uint32_t i) noexcept {
+		return VkDescriptorImageInfo {
+			.imageView = generation.LevelView[std::min(i, static_cast<uint32_t>(generation.LevelView.size()) - 1u)],
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+		};
+	});
+	const VkWriteDescriptorSet level_write {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstBinding = 0u,
+		.dstArrayElement = 0u,
+		.descriptorCount = static_cast<uint32_t>(level_info.size()),
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		.pImageInfo = level_info.data()
+	};
+	vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->PipelineLayout, 0u, 1u, &level_write);
+
+	const ::GenerationArgument argument {
+		.Counter = BufferManager::addressOf(device, generation.Counter.second),
+		.LevelCount = level,
+		.SRGB = storage_format != format ? 1u : 0u
+	};
+	vkCmdPushConstants(cmd, this->PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0u,
+		static_cast<uint32_t>(sizeof(argument)), &argument);
+
+	const auto [w, h] = extent;
+	vkCmdDispatch(cmd, (w + ::TileDimension - 1u) / ::TileDimension, (h + ::TileDimension - 1u) / ::TileDimension, layer);
+
+	/**************
+	 * Finalise
+	 *************/
+	PipelineBarrier<0u, 0u, 1u> barrier;
+	barrier.addImageBarrier({
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		out_stage,
+		out_access
+	}, {
+		VK_IMAGE_LAYOUT_GENERAL,
+		out_layout
+	}, image, ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT));
+	barrier.record(cmd);
+
+	return generation;
+}
\ No newline at end of file
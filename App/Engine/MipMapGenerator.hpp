@@ -0,0 +1,125 @@
+#pragma once
+
+#include "VulkanContext.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <ostream>
+#include <array>
+#include <vector>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Generate all levels of mip-map of an image in a single compute dispatch.
+	 * As opposed to blitting, which requires a barrier between every level, each workgroup reduces a tile into multiple levels
+	 * through shared memory, and the last workgroup to finish, tracked by a global atomic counter, reduces the rest of levels.
+	*/
+	class MipMapGenerator {
+	public:
+
+		constexpr static uint32_t MaxLevel = 13u;/**< Including the base level. */
+		constexpr static uint32_t MaxExtent = 1u << (MaxLevel - 1u);
+
+		/**
+		 * @brief Specify how each 2x2 footprint is reduced.
+		*/
+		enum class ReductionFilter : uint32_t {
+			Average = 0u,/**< Box filter, in linear space if the image is sRGB. */
+			Normal = 1u,/**< Average of tangent space normal encoded in RGB, and is renormalised. */
+			Count = 2u
+		};
+
+		/**
+		 * @brief Information to generate mip-map.
+		 * The image must be created with the required usage and create flags of the generator.
+		*/
+		struct GenerationInfo {
+
+			VkImage Image;
+			VkFormat Format;
+			VkExtent2D Extent;/**< Of the base level. */
+			uint32_t Layer, Level;/**< The total number of level includes the base level. */
+			ReductionFilter Filter = ReductionFilter::Average;
+
+			//Stage, access and layout of the base level before generation.
+			VkPipelineStageFlags2 InputStage;
+			VkAccessFlags2 InputAccess;
+			VkImageLayout InputLayout;
+			//Stage, access and layout of the whole image after generation.
+			VkPipelineStageFlags2 OutputStage;
+			VkAccessFlags2 OutputAccess;
+			VkImageLayout OutputLayout;
+
+		};
+
+		/**
+		 * @brief Resources used by a recorded generation, which must remain valid until the generation command completes.
+		*/
+		struct Generation {
+
+			std::vector<VulkanObject::ImageView> LevelView;
+			VulkanObject::BufferAllocation Counter;
+
+		};
+
+		constexpr static VkImageUsageFlags RequiredUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+
+	private:
+
+		const VulkanContext* const Context;
+
+		const VulkanObject::DescriptorSetLayout LevelLayout;
+		const VulkanObject::PipelineLayout PipelineLayout;
+		std::array<VulkanObject::Pipeline, static_cast<size_t>(ReductionFilter::Count)> Pipeline;
+
+	public:
+
+		/**
+		 * @brief Create a mip-map generator.
+		 * @param ctx The context. The context is retained and must remain valid until the generator is destroyed.
+		 * @param msg A stream to receive diagnostic messages.
+		*/
+		MipMapGenerator(const VulkanContext&, std::ostream&);
+
+		MipMapGenerator(const MipMapGenerator&) = delete;
+
+		MipMapGenerator(MipMapGenerator&&) = delete;
+
+		MipMapGenerator& operator=(const MipMapGenerator&) = delete;
+
+		MipMapGenerator& operator=(MipMapGenerator&&) = delete;
+
+		~MipMapGenerator() = default;
+
+		/**
+		 * @brief Get the image create flags required by an image of a format to have mip-map generated.
+		 * sRGB images are reinterpreted as UNORM, because sRGB formats do not support storage.
+		 * @param format The image format.
+		 * @return The image create flags.
+		*/
+		static VkImageCreateFlags requiredCreateFlag(VkFormat) noexcept;
+
+		/**
+		 * @brief Check if an image can have mip-map generated.
+		 * If not, mip-map should be generated by blitting instead.
+		 * @param format The image format.
+		 * @param extent The extent of the base level.
+		 * @param level The total number of level.
+		 * @return True if supported.
+		*/
+		bool isSupported(VkFormat, VkExtent2D, uint32_t) const;
+
+		/**
+		 * @brief Record command to generate mip-map for all layers of an image.
+		 * @param cmd The command buffer, which must be on a queue supporting compute.
+		 * @param gen_info The generation info.
+		 * @return Resources to be retained until the command completes.
+		*/
+		Generation record(VkCommandBuffer, const GenerationInfo&) const;
+
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "PresentPacer.hpp"
+
+#include "../Common/ErrorHandler.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include <cmath>
+
+using std::span;
+using std::chrono::duration, std::chrono::duration_cast;
+
+using namespace LearnVulkan;
+
+namespace {
+
+	//Timeout for waiting for presentation, in nanosecond.
+	//The wait should never take that long unless presentation is blocked, for example when the canvas is minimised.
+	constexpr uint64_t PresentWaitTimeout = 100'000'000ull;
+	//Weight of the latest sample in the moving average of latency.
+	constexpr double LatencySmoothing = 0.1;
+
+}
+
+PresentPacer::PresentPacer(const CreateInfo& pacer_info) noexcept :
+	PreferredPresentMode(pacer_info.PreferredPresentMode), PresentMode(VK_PRESENT_MODE_FIFO_KHR),
+	MinFrameTime(duration_cast<Clock::duration>(duration<double>(pacer_info.MinFrameTime))), PresentWait(false),
+	LastFrame(Clock::now()), PresentID(1ull), FirstSwapchainPresentID(1ull), InputTime { }, Latency(0.0) {
+
+}
+
+void PresentPacer::recordLatency(const uint64_t present_id, const Clock::time_point presented) noexcept {
+	const double sample = duration<double, std::milli>(presented - this->InputTime[present_id % InputTimeHistory]).count();
+	this->Latency = this->Latency == 0.0 ? sample : std::lerp(this->Latency, sample, ::LatencySmoothing);
+}
+
+void PresentPacer::setPreferredPresentMode(const VkPresentModeKHR mode) noexcept {
+	this->PreferredPresentMode = mode;
+}
+
+VkPresentModeKHR PresentPacer::selectPresentMode(const span<const VkPresentModeKHR> supported) noexcept {
+	this->PresentMode = std::ranges::find(supported, this->PreferredPresentMode) != supported.end() ?
+		this->PreferredPresentMode : VK_PRESENT_MODE_FIFO_KHR;
+	//present ID must be increasing within a swap chain, a new swap chain starts over
+	this->FirstSwapchainPresentID = this->PresentID;
+	return this->PresentMode;
+}
+
+void PresentPacer::enablePresentWait(const bool enable) noexcept {
+	this->PresentWait = enable;
+}
+
+VkPresentModeKHR PresentPacer::presentMode() const noexcept {
+	return this->PresentMode;
+}
+
+bool PresentPacer::presentWaitEnabled() const noexcept {
+	return this->PresentWait;
+}
+
+double PresentPacer::latency() const noexcept {
+	return this->Latency;
+}
+
+double PresentPacer::waitNextFrame(const VkDevice device, const VkSwapchainKHR swap_chain, const unsigned int frame_in_flight) {
+	//Allow at most as many frames as frame in flight queued for presentation.
+	//If we wait for the most recent present, no work can be overlapped between CPU and GPU.
+	if (this->PresentWait && swap_chain != VK_NULL_HANDLE
+		&& this->PresentID >= this->FirstSwapchainPresentID + frame_in_flight) {
+		const uint64_t wait_id = this->PresentID - frame_in_flight;
+		//timeout or out-of-date swap chain are not fatal, the swap chain will be recreated by the application
+		if (const VkResult result = vkWaitForPresentKHR(device, swap_chain, wait_id, ::PresentWaitTimeout);
+			result == VK_SUCCESS) {
+			this->recordLatency(wait_id, Clock::now());
+		} else if (result != VK_TIMEOUT && result != VK_ERROR_OUT_OF_DATE_KHR && result != VK_SUBOPTIMAL_KHR) {
+			CHECK_VULKAN_ERROR(result);
+		}
+	}
+
+	//sleep rather than spin until the next frame is due
+	if (const Clock::time_point due = this->LastFrame + this->MinFrameTime;
+		Clock::now() < due) {
+		std::this_thread::sleep_until(due);
+	}
+
+	const Clock::time_point now = Clock::now();
+	const double delta = duration<double>(now - this->LastFrame).count();
+	this->LastFrame = now;
+	this->InputTime[this->PresentID % InputTimeHistory] = now;
+	return delta;
+}
+
+uint64_t PresentPacer::presentID() const noexcept {
+	return this->PresentID;
+}
+
+void PresentPacer::notifyPresent() noexcept {
+	if (!this->PresentWait) {
+		this->recordLatency(this->PresentID, Clock::now());
+	}
+	this->PresentID++;
+}
\ No newline at end of file
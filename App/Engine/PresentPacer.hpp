@@ -0,0 +1,130 @@
+#pragma once
+
+#include "EngineSetting.hpp"
+
+#include <Volk/volk.h>
+
+#include <array>
+#include <span>
+#include <chrono>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Control the pace of frame presentation and measure presentation latency.
+	 * The pacer sleeps until the next frame is due rather than spinning,
+	 * and when supported, waits for presentation of previously queued frames to bound the latency.
+	*/
+	class PresentPacer {
+	public:
+
+		using Clock = std::chrono::steady_clock;
+
+		/**
+		 * @brief Information to create a present pacer.
+		*/
+		struct CreateInfo {
+
+			//The present mode to be used if supported by the surface, otherwise FIFO is used which is always supported.
+			VkPresentModeKHR PreferredPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+			double MinFrameTime = 0.0;/**< The minimum time between two frames in second. Zero to disable frame rate limit. */
+
+		};
+
+	private:
+
+		//The number of input time to be remembered, must be greater than the number of frame that can be queued for presentation.
+		constexpr static size_t InputTimeHistory = 8u;
+		static_assert(InputTimeHistory > EngineSetting::MaxFrameInFlight);
+
+		VkPresentModeKHR PreferredPresentMode, PresentMode;
+		const Clock::duration MinFrameTime;
+		bool PresentWait;
+
+		Clock::time_point LastFrame;
+		//The identifier to be used by the next presentation, and the first identifier presented to the current swap chain.
+		uint64_t PresentID, FirstSwapchainPresentID;
+		std::array<Clock::time_point, InputTimeHistory> InputTime;/**< Indexed by present ID. */
+
+		double Latency;/**< Moving average in millisecond. */
+
+		//Add a latency sample of the frame with the given present ID.
+		void recordLatency(uint64_t, Clock::time_point) noexcept;
+
+	public:
+
+		/**
+		 * @brief Create a present pacer.
+		 * @param pacer_info The information to create a present pacer.
+		*/
+		PresentPacer(const CreateInfo&) noexcept;
+
+		PresentPacer(const PresentPacer&) = delete;
+
+		PresentPacer(PresentPacer&&) = delete;
+
+		PresentPacer& operator=(const PresentPacer&) = delete;
+
+		PresentPacer& operator=(PresentPacer&&) = delete;
+
+		~PresentPacer() = default;
+
+		/**
+		 * @brief Change the preferred present mode.
+		 * The new mode takes effect when the present mode is selected next time.
+		 * @param mode The preferred present mode.
+		*/
+		void setPreferredPresentMode(VkPresentModeKHR) noexcept;
+
+		/**
+		 * @brief Select a present mode to be used by the next swap chain.
+		 * This also begins a new history of presentation.
+		 * @param supported All present modes supported by the surface.
+		 * @return The selected present mode.
+		*/
+		VkPresentModeKHR selectPresentMode(std::span<const VkPresentModeKHR>) noexcept;
+
+		/**
+		 * @brief Enable waiting for presentation.
+		 * @param enable True if both present ID and present wait features are enabled on the device.
+		*/
+		void enablePresentWait(bool) noexcept;
+
+		//Get the present mode currently in use.
+		VkPresentModeKHR presentMode() const noexcept;
+
+		//Check if present ID should be chained to the present info.
+		bool presentWaitEnabled() const noexcept;
+
+		/**
+		 * @brief Get the average latency, in millisecond, between input being sampled and its frame being displayed.
+		 * If present wait is not enabled, latency is measured until the frame is handed to the presentation engine.
+		*/
+		double latency() const noexcept;
+
+		/**
+		 * @brief Block until the next frame is due.
+		 * Input for the next frame should be sampled right after this function returns.
+		 * @param device The device.
+		 * @param swap_chain The swap chain to be presented to. Can be null if nothing is presented.
+		 * @param frame_in_flight The number of frame in flight, which is also the number of frame allowed to be queued for presentation.
+		 * @return The time since the last frame, in second.
+		*/
+		double waitNextFrame(VkDevice, VkSwapchainKHR, unsigned int);
+
+		/**
+		 * @brief Get the present ID to be used by the upcoming presentation.
+		 * The ID is only meaningful when present wait is enabled.
+		*/
+		uint64_t presentID() const noexcept;
+
+		/**
+		 * @brief Inform the pacer that the upcoming frame has been handed to the presentation engine.
+		*/
+		void notifyPresent() noexcept;
+
+	};
+
+}
\ No newline at end of file
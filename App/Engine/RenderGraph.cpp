@@ -0,0 +1,441 @@
+#include "RenderGraph.hpp"
+
+#include "../Common/ErrorHandler.hpp"
+
+#include <algorithm>
+#include <ranges>
+
+#include <stdexcept>
+#include <cassert>
+
+using std::span, std::vector;
+using std::ranges::sort, std::views::iota;
+using std::runtime_error;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	//Accesses that modify memory, anything else is a read.
+	constexpr VkAccessFlags2 WriteAccess = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		| VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT
+		| VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+	constexpr uint32_t NoPass = ~0u;
+
+	constexpr VkDeviceSize alignTo(const VkDeviceSize value, const VkDeviceSize alignment) noexcept {
+		return (value + alignment - 1ull) / alignment * alignment;
+	}
+
+	//The state of a resource while replaying usages.
+	struct TrackedState {
+
+		VkImageLayout Layout;
+		//The last write, and every read since then.
+		//A read already made visible by a barrier needs no other barrier until the next write.
+		VkPipelineStageFlags2 WriteStage, ReadStage;
+		VkAccessFlags2 WriteAccess, ReadAccess;
+
+	};
+
+	constexpr TrackedState createTrackedState(const RenderGraph::ResourceState& state) noexcept {
+		const auto [stage, access, layout] = state;
+		if ((access & ::WriteAccess) != VK_ACCESS_2_NONE) {
+			return { layout, stage, VK_PIPELINE_STAGE_2_NONE, access & ::WriteAccess, VK_ACCESS_2_NONE };
+		}
+		return { layout, VK_PIPELINE_STAGE_2_NONE, stage, VK_ACCESS_2_NONE, access };
+	}
+
+	struct BarrierRequirement {
+
+		VkPipelineStageFlags2 SourceStage;
+		VkAccessFlags2 SourceAccess;
+		VkImageLayout OldLayout;
+
+	};
+
+	//Advance the tracked state to the next usage, and return the barrier needed before it, if any.
+	std::optional<BarrierRequirement> synchronise(TrackedState& state, const RenderGraph::ResourceState& next, const bool image) noexcept {
+		const bool transition = image && next.Layout != state.Layout;
+		const VkImageLayout old_layout = state.Layout;
+
+		//layout transition is a write to the image
+		if (transition || (next.Access & ::WriteAccess) != VK_ACCESS_2_NONE) {
+			//writes wait for every earlier access, but only earlier writes need to be made available
+			const BarrierRequirement barrier {
+				.SourceStage = state.WriteStage | state.ReadStage,
+				.SourceAccess = state.WriteAccess,
+				.OldLayout = old_layout
+			};
+			state = {
+				.Layout = image ? next.Layout : state.Layout,
+				.WriteStage = next.Stage,
+				.ReadStage = VK_PIPELINE_STAGE_2_NONE,
+				.WriteAccess = next.Access & ::WriteAccess,
+				.ReadAccess = VK_ACCESS_2_NONE
+			};
+			if (!transition && barrier.SourceStage == VK_PIPELINE_STAGE_2_NONE) {
+				return std::nullopt;
+			}
+			return barrier;
+		}
+
+		//read after read, or the write has already been made visible to this read
+		const bool visible = state.WriteAccess == VK_ACCESS_2_NONE
+			|| ((next.Stage & ~state.ReadStage) == VK_PIPELINE_STAGE_2_NONE && (next.Access & ~state.ReadAccess) == VK_ACCESS_2_NONE);
+		state.ReadStage |= next.Stage;
+		state.ReadAccess |= next.Access;
+		if (visible) {
+			return std::nullopt;
+		}
+		return BarrierRequirement {
+			.SourceStage = state.WriteStage,
+			.SourceAccess = state.WriteAccess,
+			.OldLayout = old_layout
+		};
+	}
+
+}
+
+RenderGraph::RenderGraph(const VulkanContext& ctx) : Device(ctx.Device), Allocator(ctx.Allocator), Compiled(false) {
+
+}
+
+RenderGraph::ResourceIdentifier RenderGraph::importImage(const ImageImportInfo& import_info) {
+	assert(!this->Compiled);
+	this->GraphResource.push_back({
+		.Type = ResourceType::Image,
+		.Image = import_info.Image,
+		.Range = import_info.Range,
+		.Initial = import_info.Initial,
+		.Final = import_info.Final
+	});
+	return static_cast<ResourceIdentifier>(this->GraphResource.size() - 1u);
+}
+
+RenderGraph::ResourceIdentifier RenderGraph::importBuffer(const BufferImportInfo& import_info) {
+	assert(!this->Compiled);
+	this->GraphResource.push_back({
+		.Type = ResourceType::Buffer,
+		.Buffer = import_info.Buffer,
+		.Offset = import_info.Offset,
+		.Size = import_info.Size,
+		.Initial = import_info.Initial
+	});
+	return static_cast<ResourceIdentifier>(this->GraphResource.size() - 1u);
+}
+
+RenderGraph::ResourceIdentifier RenderGraph::createTransientImage(const TransientImageCreateInfo& transient_info) {
+	assert(!this->Compiled);
+	const VkImageCreateInfo& image_info = *transient_info.Image;
+	const auto id = static_cast<ResourceIdentifier>(this->GraphResource.size());
+
+	VKO::Image image = VKO::createImage(this->Device, image_info);
+	this->GraphResource.push_back({
+		.Type = ResourceType::TransientImage,
+		.Image = image,
+		.Range = {
+			.aspectMask = transient_info.Aspect,
+			.baseMipLevel = 0u,
+			.levelCount = image_info.mipLevels,
+			.baseArrayLayer = 0u,
+			.layerCount = image_info.arrayLayers
+		}
+	});
+
+	TransientImage& transient = this->Transient.emplace_back();
+	transient.Resource = id;
+	vkGetImageMemoryRequirements(this->Device, image, &transient.Requirement);
+	transient.Image = std::move(image);
+	return id;
+}
+
+RenderGraph::PassIdentifier RenderGraph::addPass(const PassCreateInfo& pass_info) {
+	assert(!this->Compiled);
+	this->GraphPass.push_back({
+		.Name = pass_info.Name,
+		.Usage = vector(pass_info.Usage.begin(), pass_info.Usage.end())
+	});
+	return static_cast<PassIdentifier>(this->GraphPass.size() - 1u);
+}
+
+void RenderGraph::sortPass() {
+	const size_t pass_count = this->GraphPass.size();
+	//passes reading from the output of each pass
+	vector<vector<PassIdentifier>> consumer(pass_count);
+	vector<bool> writes_import(pass_count, false);
+	{
+		vector<PassIdentifier> last_writer(this->GraphResource.size(), ::NoPass);
+		vector<VkImageLayout> layout(this->GraphResource.size());
+		std::ranges::transform(this->GraphResource, layout.begin(), [](const auto& res) { return res.Initial.Layout; });
+
+		for (const auto pass : iota(PassIdentifier { 0 }, static_cast<PassIdentifier>(pass_count))) {
+			for (const auto& [res_id, state] : this->GraphPass[pass].Usage) {
+				const Resource& res = this->GraphResource[res_id];
+				const bool image = res.Type != ResourceType::Buffer,
+					write = (image && state.Layout != layout[res_id]) || (state.Access & ::WriteAccess) != VK_ACCESS_2_NONE;
+
+				if (last_writer[res_id] != ::NoPass && (state.Access & ~::WriteAccess) != VK_ACCESS_2_NONE) {
+					consumer[last_writer[res_id]].push_back(pass);
+				}
+				if (write) {
+					last_writer[res_id] = pass;
+					writes_import[pass] = writes_import[pass] || res.Type != ResourceType::TransientImage;
+				}
+				if (image) {
+					layout[res_id] = state.Layout;
+				}
+			}
+		}
+	}
+
+	//A pass is needed if it writes an imported resource, or it is read by a needed pass.
+	//Every dependency points to a later pass in the order passes are added, so a backward sweep is sufficient.
+	vector<bool> needed(pass_count, false);
+	for (auto pass = pass_count; pass-- > 0u;) {
+		needed[pass] = writes_import[pass]
+			|| std::ranges::any_of(consumer[pass], [&needed](const auto reader) { return static_cast<bool>(needed[reader]); });
+	}
+	//the order passes are added is already a topological order of dependencies, which is kept such that the result is unchanged
+	this->Order.clear();
+	for (const auto pass : iota(PassIdentifier { 0 }, static_cast<PassIdentifier>(pass_count))) {
+		if (needed[pass]) {
+			this->Order.push_back(pass);
+		}
+	}
+}
+
+void RenderGraph::allocateTransient() {
+	for (auto& transient : this->Transient) {
+		transient.FirstUse = ::NoPass;
+		transient.LastUse = 0u;
+	}
+	for (const auto position : iota(uint32_t { 0 }, static_cast<uint32_t>(this->Order.size()))) {
+		for (const auto& usage : this->GraphPass[this->Order[position]].Usage) {
+			for (auto& transient : this->Transient) {
+				if (transient.Resource == usage.Resource) {
+					transient.FirstUse = std::min(transient.FirstUse, position);
+					transient.LastUse = std::max(transient.LastUse, position);
+				}
+			}
+		}
+	}
+
+	//place larger images first, each at the lowest offset not overlapping any placed image with an overlapping lifetime
+	vector<uint32_t> placement;
+	for (const auto i : iota(uint32_t { 0 }, static_cast<uint32_t>(this->Transient.size()))) {
+		if (this->Transient[i].FirstUse != ::NoPass) {
+			placement.push_back(i);
+		}
+	}
+	sort(placement, [&transient = this->Transient](const auto a, const auto b) {
+		return transient[a].Requirement.size > transient[b].Requirement.size;
+	});
+	if (placement.empty()) {
+		return;
+	}
+
+	VkMemoryRequirements memory_requirement {
+		.size = 0ull,
+		.alignment = 1ull,
+		.memoryTypeBits = ~0u
+	};
+	vector<uint32_t> overlapping;
+	for (const auto current_idx : iota(size_t { 0 }, placement.size())) {
+		TransientImage& current = this->Transient[placement[current_idx]];
+		const VkDeviceSize alignment = current.Requirement.alignment;
+
+		overlapping.clear();
+		for (const auto placed_idx : span(placement.data(), current_idx)) {
+			if (const TransientImage& placed = this->Transient[placed_idx];
+				placed.FirstUse <= current.LastUse && current.FirstUse <= placed.LastUse) {
+				overlapping.push_back(placed_idx);
+			}
+		}
+		sort(overlapping, [&transient = this->Transient](const auto a, const auto b) {
+			return transient[a].Offset < transient[b].Offset;
+		});
+
+		VkDeviceSize offset = 0ull;
+		for (const auto placed_idx : overlapping) {
+			const TransientImage& placed = this->Transient[placed_idx];
+			if (offset + current.Requirement.size <= placed.Offset) {
+				break;
+			}
+			offset = std::max(offset, ::alignTo(placed.Offset + placed.Requirement.size, alignment));
+		}
+		current.Offset = offset;
+
+		memory_requirement.size = std::max(memory_requirement.size, offset + current.Requirement.size);
+		memory_requirement.alignment = std::max(memory_requirement.alignment, alignment);
+		memory_requirement.memoryTypeBits &= current.Requirement.memoryTypeBits;
+	}
+	if (memory_requirement.memoryTypeBits == 0u) {
+		throw runtime_error("Transient images of the render graph have no memory type in common.");
+	}
+
+	constexpr static VmaAllocationCreateInfo transient_alloc_info {
+		.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	};
+	this->TransientMemory = VKO::allocateMemoryFromAllocator(this->Allocator, memory_requirement, transient_alloc_info,
+		VKO::AllocationCategory::Attachment);
+	for (const auto i : placement) {
+		const TransientImage& transient = this->Transient[i];
+		CHECK_VULKAN_ERROR(vmaBindImageMemory2(this->Allocator, this->TransientMemory, transient.Offset, transient.Image, nullptr));
+	}
+}
+
+void RenderGraph::computeBarrier() {
+	vector<TrackedState> state(this->GraphResource.size());
+	std::ranges::transform(this->GraphResource, state.begin(), [](const auto& res) { return ::createTrackedState(res.Initial); });
+
+	//A transient image waits for every use of images sharing its memory, either earlier in this execution or in the last execution.
+	//The content is discarded, so the layout is undefined.
+	for (const auto& transient : this->Transient) {
+		if (transient.FirstUse == ::NoPass) {
+			continue;
+		}
+		TrackedState& transient_state = state[transient.Resource];
+		transient_state = {
+			.Layout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.WriteStage = VK_PIPELINE_STAGE_2_NONE,
+			.ReadStage = VK_PIPELINE_STAGE_2_NONE,
+			.WriteAccess = VK_ACCESS_2_NONE,
+			.ReadAccess = VK_ACCESS_2_NONE
+		};
+		for (const auto& alias : this->Transient) {
+			if (alias.FirstUse == ::NoPass || alias.Offset >= transient.Offset + transient.Requirement.size
+				|| transient.Offset >= alias.Offset + alias.Requirement.size) {
+				continue;
+			}
+			for (const auto pass : this->Order) {
+				for (const auto& [res_id, usage] : this->GraphPass[pass].Usage) {
+					if (res_id == alias.Resource) {
+						transient_state.WriteStage |= usage.Stage;
+						transient_state.WriteAccess |= usage.Access & ::WriteAccess;
+					}
+				}
+			}
+		}
+	}
+
+	const auto addBarrier = [this](BarrierBatch& batch, const ResourceIdentifier res_id, const BarrierRequirement& requirement,
+		const ResourceState& next) -> void {
+		const Resource& res = this->GraphResource[res_id];
+		const auto [src_stage, src_access, old_layout] = requirement;
+		if (res.Type == ResourceType::Buffer) {
+			batch.Buffer.push_back({
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+				.srcStageMask = src_stage,
+				.srcAccessMask = src_access,
+				.dstStageMask = next.Stage,
+				.dstAccessMask = next.Access,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.buffer = res.Buffer,
+				.offset = res.Offset,
+				.size = res.Size
+			});
+			return;
+		}
+		batch.Image.push_back({
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.srcStageMask = src_stage,
+			.srcAccessMask = src_access,
+			.dstStageMask = next.Stage,
+			.dstAccessMask = next.Access,
+			.oldLayout = old_layout,
+			.newLayout = next.Layout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = res.Image,
+			.subresourceRange = res.Range
+		});
+		batch.ImageResource.push_back(res_id);
+	};
+
+	this->Batch.assign(this->Order.size() + 1u, { });
+	for (const auto position : iota(size_t { 0 }, this->Order.size())) {
+		for (const auto& [res_id, usage] : this->GraphPass[this->Order[position]].Usage) {
+			if (const auto requirement = ::synchronise(state[res_id], usage, this->GraphResource[res_id].Type != ResourceType::Buffer);
+				requirement) {
+				addBarrier(this->Batch[position], res_id, *requirement, usage);
+			}
+		}
+	}
+	for (const auto res_id : iota(ResourceIdentifier { 0 }, static_cast<ResourceIdentifier>(this->GraphResource.size()))) {
+		const Resource& res = this->GraphResource[res_id];
+		if (!res.Final) {
+			continue;
+		}
+		if (const auto requirement = ::synchronise(state[res_id], *res.Final, res.Type != ResourceType::Buffer);
+			requirement) {
+			addBarrier(this->Batch.back(), res_id, *requirement, *res.Final);
+		}
+	}
+}
+
+void RenderGraph::compile() {
+	if (this->Compiled) {
+		throw runtime_error("The render graph has already been compiled.");
+	}
+	this->sortPass();
+	this->allocateTransient();
+	this->computeBarrier();
+	this->Compiled = true;
+}
+
+void RenderGraph::bindImage(const ResourceIdentifier resource, const VkImage image) noexcept {
+	assert(this->GraphResource[resource].Type == ResourceType::Image);
+	this->GraphResource[resource].Image = image;
+	for (auto& batch : this->Batch) {
+		for (const auto i : iota(size_t { 0 }, batch.Image.size())) {
+			if (batch.ImageResource[i] == resource) {
+				batch.Image[i].image = image;
+			}
+		}
+	}
+}
+
+VkImage RenderGraph::image(const ResourceIdentifier resource) const noexcept {
+	return this->GraphResource[resource].Image;
+}
+
+bool RenderGraph::isPassExecuted(const PassIdentifier pass) const noexcept {
+	assert(this->Compiled);
+	return std::ranges::find(this->Order, pass) != this->Order.cend();
+}
+
+VkDeviceSize RenderGraph::transientMemorySize() const noexcept {
+	if (!this->TransientMemory) {
+		return 0ull;
+	}
+	VmaAllocationInfo info;
+	vmaGetAllocationInfo(this->Allocator, this->TransientMemory, &info);
+	return info.size;
+}
+
+void RenderGraph::execute(const VkCommandBuffer cmd, const span<const VkCommandBuffer> pass_cmd) const noexcept {
+	assert(this->Compiled);
+	const auto recordBatch = [cmd](const BarrierBatch& batch) -> void {
+		if (batch.Image.empty() && batch.Buffer.empty()) {
+			return;
+		}
+		const VkDependencyInfo dep {
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.bufferMemoryBarrierCount = static_cast<uint32_t>(batch.Buffer.size()),
+			.pBufferMemoryBarriers = batch.Buffer.data(),
+			.imageMemoryBarrierCount = static_cast<uint32_t>(batch.Image.size()),
+			.pImageMemoryBarriers = batch.Image.data()
+		};
+		vkCmdPipelineBarrier2(cmd, &dep);
+	};
+
+	for (const auto position : iota(size_t { 0 }, this->Order.size())) {
+		recordBatch(this->Batch[position]);
+		vkCmdExecuteCommands(cmd, 1u, &pass_cmd[this->Order[position]]);
+	}
+	recordBatch(this->Batch.back());
+}
\ No newline at end of file
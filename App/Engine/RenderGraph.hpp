@@ -0,0 +1,261 @@
+#pragma once
+
+#include "VulkanContext.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <span>
+#include <vector>
+#include <optional>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief A frame graph of passes, where each pass is recorded to a secondary command buffer of its own,
+	 * such that passes can be recorded in parallel.
+	 * Every pass declares attachments and buffers it reads and writes, from which the graph orders the passes,
+	 * and computes a single batch of the minimal barriers to be recorded in the primary command buffer before each pass.
+	 * Transient images only live within an execution of the graph, and those whose lifetimes do not overlap share memory.
+	 * Synchronisation between commands within the same pass, and of resources not declared to the graph, is left to the pass.
+	 * The graph is compiled once, and executed every frame on the same queue.
+	*/
+	class RenderGraph {
+	public:
+
+		using ResourceIdentifier = uint32_t;/**< An identifier to a resource of the graph. */
+		using PassIdentifier = uint32_t;/**< An identifier to a pass of the graph, in the order passes are added. */
+
+		/**
+		 * @brief Specify how a resource is accessed.
+		*/
+		struct ResourceState {
+
+			VkPipelineStageFlags2 Stage;
+			VkAccessFlags2 Access;
+			VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;/**< Ignored by buffer. */
+
+		};
+
+		/**
+		 * @brief A use of a resource by a pass.
+		*/
+		struct ResourceUsage {
+
+			ResourceIdentifier Resource;
+			ResourceState State;
+
+		};
+
+		/**
+		 * @brief Information to import an image owned by the application.
+		*/
+		struct ImageImportInfo {
+
+			//Can be null if the image is only bound before every execution, such as a swap chain image.
+			VkImage Image = VK_NULL_HANDLE;
+			VkImageSubresourceRange Range;
+			//The state left by commands before the graph, which includes the last execution of the graph.
+			//Layout should be undefined if the content of the image can be discarded.
+			ResourceState Initial;
+			//The state to transition to after the last pass, or empty to leave the image as the last pass uses it.
+			std::optional<ResourceState> Final;
+
+		};
+
+		/**
+		 * @brief Information to import a range of buffer owned by the application.
+		*/
+		struct BufferImportInfo {
+
+			VkBuffer Buffer;
+			VkDeviceSize Offset, Size;
+			ResourceState Initial;/**< @see ImageImportInfo::Initial */
+
+		};
+
+		/**
+		 * @brief Information to create a transient image, whose content is discarded before its first use in each execution.
+		*/
+		struct TransientImageCreateInfo {
+
+			const VkImageCreateInfo* Image;
+			VkImageAspectFlags Aspect;
+
+		};
+
+		/**
+		 * @brief Information to add a pass.
+		*/
+		struct PassCreateInfo {
+
+			const char* Name;
+			std::span<const ResourceUsage> Usage;/**< Each resource is used at most once by the same pass. */
+
+		};
+
+	private:
+
+		enum class ResourceType : uint8_t {
+			Image = 0x00u,
+			Buffer = 0x01u,
+			TransientImage = 0x02u
+		};
+
+		struct Resource {
+
+			ResourceType Type;
+			VkImage Image;
+			VkImageSubresourceRange Range;
+			VkBuffer Buffer;
+			VkDeviceSize Offset, Size;
+
+			ResourceState Initial;
+			std::optional<ResourceState> Final;
+
+		};
+
+		struct TransientImage {
+
+			ResourceIdentifier Resource;
+			VulkanObject::Image Image;
+			VkMemoryRequirements Requirement;
+			VkDeviceSize Offset;/**< Into the shared transient memory. */
+			//The first and last position of pass in the execution order using this image.
+			uint32_t FirstUse, LastUse;
+
+		};
+
+		struct Pass {
+
+			const char* Name;
+			std::vector<ResourceUsage> Usage;
+
+		};
+
+		//Barriers recorded before a pass, or after the last pass.
+		struct BarrierBatch {
+
+			std::vector<VkImageMemoryBarrier2> Image;
+			std::vector<ResourceIdentifier> ImageResource;/**< The resource of each image barrier, to be rebound. */
+			std::vector<VkBufferMemoryBarrier2> Buffer;
+
+		};
+
+		const VkDevice Device;
+		const VmaAllocator Allocator;
+
+		std::vector<Resource> GraphResource;
+		std::vector<TransientImage> Transient;
+		std::vector<Pass> GraphPass;
+
+		std::vector<PassIdentifier> Order;/**< Passes in execution order, culled passes are excluded. */
+		//One for each pass in execution order, followed by one for final transitions.
+		std::vector<BarrierBatch> Batch;
+		VulkanObject::Allocation TransientMemory;
+		bool Compiled;
+
+		//Sort passes by dependencies, and cull passes contributing to no imported resource.
+		void sortPass();
+
+		//Place transient images in the shared memory, such that images with disjoint lifetimes may overlap.
+		void allocateTransient();
+
+		//Compute barriers of every pass by replaying resource usages in execution order.
+		void computeBarrier();
+
+	public:
+
+		/**
+		 * @brief Create an empty render graph.
+		 * @param ctx The context. Transient images are created and allocated from the device and allocator of the context.
+		*/
+		RenderGraph(const VulkanContext&);
+
+		RenderGraph(const RenderGraph&) = delete;
+
+		RenderGraph(RenderGraph&&) = delete;
+
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		RenderGraph& operator=(RenderGraph&&) = delete;
+
+		/**
+		 * @brief The device must have finished every execution of the graph.
+		*/
+		~RenderGraph() = default;
+
+		/**
+		 * @brief Import an image into the graph.
+		 * @param import_info The image import info.
+		 * @return The identifier of the image.
+		*/
+		ResourceIdentifier importImage(const ImageImportInfo&);
+
+		/**
+		 * @brief Import a range of buffer into the graph.
+		 * @param import_info The buffer import info.
+		 * @return The identifier of the buffer.
+		*/
+		ResourceIdentifier importBuffer(const BufferImportInfo&);
+
+		/**
+		 * @brief Declare a transient image, which is created when the graph is compiled.
+		 * @param transient_info The transient image create info.
+		 * @return The identifier of the image.
+		*/
+		ResourceIdentifier createTransientImage(const TransientImageCreateInfo&);
+
+		/**
+		 * @brief Add a pass to the graph.
+		 * Passes are added in an order where executing them sequentially gives the intended result.
+		 * @param pass_info The pass create info.
+		 * @return The identifier of the pass.
+		*/
+		PassIdentifier addPass(const PassCreateInfo&);
+
+		/**
+		 * @brief Compile the graph, after which no more resource or pass can be added.
+		 * @exception If the graph has been compiled, or transient images cannot share the same type of memory.
+		*/
+		void compile();
+
+		/**
+		 * @brief Replace the handle of an imported image, such as the present image of the current frame.
+		 * The new image must have the same subresource range and states as the imported one.
+		 * @param resource The identifier of an imported image.
+		 * @param image The new image handle.
+		*/
+		void bindImage(ResourceIdentifier, VkImage) noexcept;
+
+		/**
+		 * @brief Get the handle of an image, which is only available for a transient image after compilation.
+		 * @param resource The identifier of an image.
+		 * @return The image handle.
+		*/
+		VkImage image(ResourceIdentifier) const noexcept;
+
+		/**
+		 * @brief Check if a pass remains in the graph after compilation.
+		 * @param pass The identifier of the pass.
+		 * @return True if the pass is executed.
+		*/
+		bool isPassExecuted(PassIdentifier) const noexcept;
+
+		/**
+		 * @brief Get the size of memory shared by every transient image after compilation.
+		*/
+		VkDeviceSize transientMemorySize() const noexcept;
+
+		/**
+		 * @brief Record every pass to a primary command buffer, with barriers before each pass and final transitions.
+		 * @param cmd The primary command buffer.
+		 * @param pass_cmd The secondary command buffer of every pass, indexed by pass identifier.
+		 * Command buffers of culled passes are ignored.
+		*/
+		void execute(VkCommandBuffer, std::span<const VkCommandBuffer>) const noexcept;
+
+	};
+
+}
\ No newline at end of file
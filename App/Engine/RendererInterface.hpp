@@ -2,6 +2,11 @@
 
 #include "VulkanContext.hpp"
 #include "CameraInterface.hpp"
+#include "DescriptorHeap.hpp"
+#include "FrameAllocator.hpp"
+#include "TimestampProfiler.hpp"
+#include "JobSystem.hpp"
+#include "WorkerCommandPool.hpp"
 
 #include <Volk/volk.h>
 
@@ -33,6 +38,15 @@ namespace LearnVulkan {
 			const VulkanContext* Context;
 
 			const CameraInterface* Camera;
+			//Bound to set 1 of every pipeline layout, after the camera at set 0.
+			const DescriptorHeap* Heap;
+			const TimestampProfiler* Profiler;/**< For marking profiling region. */
+			//Secondary command buffers can be recorded in parallel by jobs,
+			//each job allocates command buffers from the worker command pool with its worker index.
+			JobSystem* Job;
+			WorkerCommandPool* WorkerCommand;
+			//Dynamic data consumed by this frame only, released once the same in-flight frame is drawn again.
+			FrameAllocator* FrameMemory;
 
 			double DeltaTime;/**< The frame time from last time the draw function is called. */
 			unsigned int FrameInFlightIndex;/**< sub-frame index */
@@ -43,6 +57,7 @@ namespace LearnVulkan {
 			/**
 			 * @brief The image where the rendering output should be written to.
 			 * The final layout of this image must be transitioned and ready for presentation.
+			 * It is one of a few images which remain the same until the next reshape, so commands writing to it can be cached.
 			*/
 			VkImage PresentImage;
 			VkImageView PresentImageView;
@@ -0,0 +1,469 @@
+#include "StagingUploader.hpp"
+
+#include "Abstraction/BufferManager.hpp"
+#include "Abstraction/ImageManager.hpp"
+#include "Abstraction/PipelineBarrier.hpp"
+#include "Abstraction/SemaphoreManager.hpp"
+#include "../Common/ErrorHandler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <ranges>
+#include <execution>
+#include <utility>
+
+#include <stdexcept>
+
+#include <cstring>
+
+using std::span, std::array;
+using std::ranges::views::iota;
+using std::byte;
+using std::runtime_error;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	//Round up to the nearest multiple of alignment, which is not required to be a power of two.
+	constexpr uint64_t alignUp(const uint64_t value, const uint64_t alignment) noexcept {
+		return (value + alignment - 1ull) / alignment * alignment;
+	}
+
+	//Copy offset of buffer to image must be a multiple of texel size, and the largest texel is 16 byte.
+	constexpr VkDeviceSize MinRingAlignment = 16ull;
+
+	inline VkDeviceSize getRingAlignment(const VkPhysicalDeviceLimits& limit) noexcept {
+		return std::max(::MinRingAlignment, limit.optimalBufferCopyOffsetAlignment);
+	}
+
+	inline VkBufferMemoryBarrier2 createBufferBarrier(const PipelineBarrierInfo::BarrierInfo& barrier,
+		const PipelineBarrierInfo::QueueFamilyTransitionInfo& queue_family,
+		const VkBuffer buffer, const VkDeviceSize offset, const VkDeviceSize size) noexcept {
+		PipelineBarrier<0u, 1u, 0u> dep;
+		dep.addBufferBarrier(barrier, queue_family, buffer, offset, size);
+		return dep.BufferBarrier[0];
+	}
+
+	inline VkImageMemoryBarrier2 createImageBarrier(const PipelineBarrierInfo::BarrierInfo& barrier,
+		const PipelineBarrierInfo::ImageLayoutTransitionInfo& layout,
+		const PipelineBarrierInfo::QueueFamilyTransitionInfo& queue_family,
+		const VkImage image, const VkImageSubresourceRange& sub_res_range) noexcept {
+		PipelineBarrier<0u, 0u, 1u> dep;
+		dep.addImageBarrier(barrier, layout, queue_family, image, sub_res_range);
+		return dep.ImageBarrier[0];
+	}
+
+	inline VkImageSubresourceRange getUploadRange(const StagingUploader::ImageUploadInfo& upload_info) noexcept {
+		return {
+			.aspectMask = upload_info.Aspect,
+			.baseMipLevel = 0u,
+			.levelCount = std::max(static_cast<uint32_t>(upload_info.Level.size()), 1u),
+			.baseArrayLayer = upload_info.BaseLayer,
+			.layerCount = upload_info.Layer
+		};
+	}
+
+	//An image in general layout is copied to in place, otherwise it is transitioned to transfer destination.
+	constexpr VkImageLayout getCopyLayout(const VkImageLayout current_layout) noexcept {
+		return current_layout == VK_IMAGE_LAYOUT_GENERAL ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	}
+
+	inline VkImageSubresourceLayers getUploadLayers(const StagingUploader::ImageUploadInfo& upload_info, const uint32_t level) noexcept {
+		return {
+			.aspectMask = upload_info.Aspect,
+			.mipLevel = level,
+			.baseArrayLayer = upload_info.BaseLayer,
+			.layerCount = upload_info.Layer
+		};
+	}
+
+}
+
+void StagingUploader::BarrierBatch::record(const VkCommandBuffer cmd) const noexcept {
+	if (this->Buffer.empty() && this->Image.empty()) {
+		return;
+	}
+	const VkDependencyInfo dep {
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.bufferMemoryBarrierCount = static_cast<uint32_t>(this->Buffer.size()),
+		.pBufferMemoryBarriers = this->Buffer.data(),
+		.imageMemoryBarrierCount = static_cast<uint32_t>(this->Image.size()),
+		.pImageMemoryBarriers = this->Image.data()
+	};
+	vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+void StagingUploader::BarrierBatch::clear() noexcept {
+	this->Buffer.clear();
+	this->Image.clear();
+}
+
+StagingUploader::StagingUploader(const VulkanContext& ctx, const VkDeviceSize capacity) :
+	Context(&ctx), OwnershipTransfer(ctx.QueueIndex.Transfer != ctx.QueueIndex.Render),
+	Alignment(::getRingAlignment(ctx.PhysicalDeviceProperty.Limit)),
+	//the ring is a multiple of alignment, such that every allocation starting from the beginning of the ring is aligned
+	Capacity(::alignUp(capacity, this->Alignment)),
+	Ring(BufferManager::createStagingBuffer({ ctx.Device, ctx.Allocator, this->Capacity },
+		BufferManager::HostAccessPattern::Sequential)),
+	RingData(VKO::mapAllocation<byte>(ctx.Allocator, this->Ring.first)),
+	TransferTimeline(SemaphoreManager::createTimelineSemaphore(ctx.Device, 0ull)),
+	AcquireTimeline(SemaphoreManager::createTimelineSemaphore(ctx.Device, 0ull)),
+	NextTicket(1ull), Head(0ull), SubmittedHead(0ull), Tail(0ull) {
+
+}
+
+inline VkDevice StagingUploader::getDevice() const noexcept {
+	return this->Context->Device;
+}
+
+inline VkSemaphore StagingUploader::getCompletionSemaphore() const noexcept {
+	return this->OwnershipTransfer ? this->AcquireTimeline : this->TransferTimeline;
+}
+
+VkCommandBuffer StagingUploader::getPendingCommand() {
+	if (*this->Pending.Command == VK_NULL_HANDLE) {
+		this->Pending.Command = VKO::allocateCommandBuffer(this->getDevice(), {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = this->Context->CommandPool.Transfer,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1u
+		});
+		CommandBufferManager::beginOneTimeSubmit(this->Pending.Command);
+	}
+	return this->Pending.Command;
+}
+
+VkDeviceSize StagingUploader::allocate(const VkDeviceSize size) {
+	if (size > this->Capacity) {
+		throw runtime_error("The size of upload exceeds the capacity of the staging ring.");
+	}
+
+	while (true) {
+		const uint64_t aligned = ::alignUp(this->Head, this->Alignment);
+		//memory must be contiguous, skip the remaining of the ring if it does not fit
+		const uint64_t begin = aligned % this->Capacity + size > this->Capacity ? ::alignUp(aligned, this->Capacity) : aligned,
+			end = begin + size;
+		if (end - this->Tail <= this->Capacity) {
+			this->Head = end;
+			return begin % this->Capacity;
+		}
+
+		//the ring is full, pending uploads must be submitted before their memory can be reclaimed
+		if (this->InFlight.empty()) {
+			this->flush();
+		}
+		this->retire(true);
+	}
+}
+
+void StagingUploader::retire(const bool wait) {
+	if (wait && !this->InFlight.empty()) {
+		this->wait(this->InFlight.front().Value);
+	}
+
+	uint64_t completed;
+	CHECK_VULKAN_ERROR(vkGetSemaphoreCounterValue(this->getDevice(), this->getCompletionSemaphore(), &completed));
+	while (!this->InFlight.empty() && this->InFlight.front().Value <= completed) {
+		this->Tail = this->InFlight.front().RingEnd;
+		this->InFlight.pop_front();
+	}
+
+	//start over from the beginning of the ring when it is idle, to avoid skipping memory at the end of the ring
+	if (this->InFlight.empty() && *this->Pending.Command == VK_NULL_HANDLE) {
+		this->Head = ::alignUp(this->Head, this->Capacity);
+		this->SubmittedHead = this->Head;
+		this->Tail = this->Head;
+	}
+}
+
+void StagingUploader::releaseBuffer(const VkBuffer buffer, const VkDeviceSize offset, const VkDeviceSize size,
+	const UploadTarget& target) {
+	const auto [target_stage, target_access] = target;
+	if (!this->OwnershipTransfer) {
+		this->Pending.Release.Buffer.push_back(::createBufferBarrier({
+			VK_PIPELINE_STAGE_2_COPY_BIT,
+			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			target_stage,
+			target_access
+		}, { }, buffer, offset, size));
+		return;
+	}
+
+	const PipelineBarrierInfo::QueueFamilyTransitionInfo transfer_to_render {
+		.Source = this->Context->QueueIndex.Transfer,
+		.Target = this->Context->QueueIndex.Render
+	};
+	this->Pending.Release.Buffer.push_back(::createBufferBarrier({
+		VK_PIPELINE_STAGE_2_COPY_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_NONE,
+		VK_ACCESS_2_NONE
+	}, transfer_to_render, buffer, offset, size));
+	this->Pending.Acquire.Buffer.push_back(::createBufferBarrier({
+		VK_PIPELINE_STAGE_2_NONE,
+		VK_ACCESS_2_NONE,
+		target_stage,
+		target_access
+	}, transfer_to_render, buffer, offset, size));
+}
+
+void StagingUploader::releaseImage(const ImageUploadInfo& upload_info) {
+	const auto [target_stage, target_access] = upload_info.Target;
+	//layout transition happens once between release and acquire, both of which must specify the same layouts
+	const PipelineBarrierInfo::ImageLayoutTransitionInfo layout {
+		.OldLayout = ::getCopyLayout(upload_info.CurrentLayout),
+		.NewLayout = upload_info.TargetLayout
+	};
+	const VkImageSubresourceRange upload_range = ::getUploadRange(upload_info);
+	if (!this->OwnershipTransfer) {
+		this->Pending.Release.Image.push_back(::createImageBarrier({
+			VK_PIPELINE_STAGE_2_COPY_BIT,
+			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			target_stage,
+			target_access
+		}, layout, { }, upload_info.Destination, upload_range));
+		return;
+	}
+	if (upload_info.Concurrent) {
+		//the acquire submission waits for the transfer, and the wait makes the upload visible to the rendering queue
+		this->Pending.Release.Image.push_back(::createImageBarrier({
+			VK_PIPELINE_STAGE_2_COPY_BIT,
+			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_NONE,
+			VK_ACCESS_2_NONE
+		}, layout, { }, upload_info.Destination, upload_range));
+		return;
+	}
+
+	const PipelineBarrierInfo::QueueFamilyTransitionInfo transfer_to_render {
+		.Source = this->Context->QueueIndex.Transfer,
+		.Target = this->Context->QueueIndex.Render
+	};
+	this->Pending.Release.Image.push_back(::createImageBarrier({
+		VK_PIPELINE_STAGE_2_COPY_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_NONE,
+		VK_ACCESS_2_NONE
+	}, layout, transfer_to_render, upload_info.Destination, upload_range));
+	this->Pending.Acquire.Image.push_back(::createImageBarrier({
+		VK_PIPELINE_STAGE_2_NONE,
+		VK_ACCESS_2_NONE,
+		target_stage,
+		target_access
+	}, layout, transfer_to_render, upload_info.Destination, upload_range));
+}
+
+void StagingUploader::recordImageUpload(const ImageUploadInfo& upload_info, const VkBuffer source, const VkDeviceSize offset) {
+	const auto [image, aspect, image_offset, extent, base_layer, layer, level, current_layout, target_layout, target, concurrent, usage]
+		= upload_info;
+	const VkCommandBuffer cmd = this->getPendingCommand();
+	const VkImageLayout copy_layout = ::getCopyLayout(current_layout);
+
+	//the image may still be read by the rendering queue, but never the uploaded region
+	PipelineBarrier<0u, 0u, 1u> barrier;
+	barrier.addImageBarrier({
+		VK_PIPELINE_STAGE_2_NONE,
+		VK_ACCESS_2_NONE,
+		VK_PIPELINE_STAGE_2_COPY_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT
+	}, {
+		current_layout,
+		copy_layout
+	}, image, ::getUploadRange(upload_info));
+	barrier.record(cmd);
+
+	if (level.empty()) {
+		ImageManager::recordCopyImageFromBuffer(cmd, source, image, {
+			.BufferOffset = offset,
+			.ImageOffset = image_offset,
+			.ImageExtent = extent,
+			.SubresourceLayers = ::getUploadLayers(upload_info, 0u),
+			.ImageLayout = copy_layout
+		});
+	} else {
+		for (const auto l : iota(size_t { 0 }, level.size())) {
+			const auto [level_offset, level_extent] = level[l];
+			ImageManager::recordCopyImageFromBuffer(cmd, source, image, {
+				.BufferOffset = offset + level_offset,
+				.ImageExtent = { level_extent.width, level_extent.height, 1u },
+				.SubresourceLayers = ::getUploadLayers(upload_info, static_cast<uint32_t>(l)),
+				.ImageLayout = copy_layout
+			});
+		}
+	}
+	this->releaseImage(upload_info);
+}
+
+bool StagingUploader::isHostCopy(const ImageUploadInfo& upload_info) const noexcept {
+	//host copies are not ordered with device access in flight, so only an image never used by the device is copied to
+	return upload_info.CurrentLayout == VK_IMAGE_LAYOUT_UNDEFINED && this->canHostCopy(upload_info.Usage, upload_info.TargetLayout);
+}
+
+void StagingUploader::copyImageOnHost(const ImageUploadInfo& upload_info, const byte* const source) const {
+	const auto [image, aspect, image_offset, extent, base_layer, layer, level, current_layout, target_layout, target, concurrent, usage]
+		= upload_info;
+	const VkDevice device = this->getDevice();
+
+	//a host write is made visible to the device by any later submission, and an image not yet used is owned by no queue family,
+	//so neither barrier nor ownership transfer is needed
+	ImageManager::transitionImageLayoutOnHost(device, image, current_layout, target_layout, ::getUploadRange(upload_info));
+	if (level.empty()) {
+		ImageManager::copyImageFromMemory(device, image, {
+			.Source = source,
+			.ImageOffset = image_offset,
+			.ImageExtent = extent,
+			.SubresourceLayers = ::getUploadLayers(upload_info, 0u),
+			.ImageLayout = target_layout
+		});
+		return;
+	}
+
+	//copies to distinct levels are independent of each other
+	const auto index = iota(size_t { 0 }, level.size());
+	std::for_each(std::execution::par, index.begin(), index.end(), [device, source, &upload_info](const auto l) {
+		const auto [level_offset, level_extent] = upload_info.Level[l];
+		ImageManager::copyImageFromMemory(device, upload_info.Destination, {
+			.Source = source + level_offset,
+			.ImageExtent = { level_extent.width, level_extent.height, 1u },
+			.SubresourceLayers = ::getUploadLayers(upload_info, static_cast<uint32_t>(l)),
+			.ImageLayout = upload_info.TargetLayout
+		});
+	});
+}
+
+VkImageUsageFlags StagingUploader::imageUsage(const VkFormat format, const VkImageCreateFlags flag, const VkImageUsageFlags usage) const {
+	//transfer destination is always required, because not every upload can be done by the host
+	const VkImageUsageFlags staged_usage = usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	if (!this->Context->Feature.HostImageCopy
+		|| !ImageManager::preferHostImageCopy(this->Context->PhysicalDevice, format, flag, staged_usage)) {
+		return staged_usage;
+	}
+	return staged_usage | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+}
+
+bool StagingUploader::canHostCopy(const VkImageUsageFlags usage, const VkImageLayout layout) const noexcept {
+	const auto& dst_layout = this->Context->PhysicalDeviceProperty.HostImageCopyDstLayout;
+	return (usage & VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT) && std::ranges::find(dst_layout, layout) != dst_layout.cend();
+}
+
+void StagingUploader::upload(const BufferUploadInfo& upload_info, const span<const byte> data) {
+	const auto [destination, dst_offset, target] = upload_info;
+	const VkDeviceSize size = data.size_bytes(),
+		offset = this->allocate(size);
+	std::memcpy(this->RingData.get() + offset, data.data(), size);
+
+	const VkBufferCopy2 region {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2,
+		.srcOffset = offset,
+		.dstOffset = dst_offset,
+		.size = size
+	};
+	const VkCopyBufferInfo2 copy_info {
+		.sType = VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2,
+		.srcBuffer = this->Ring.second,
+		.dstBuffer = destination,
+		.regionCount = 1u,
+		.pRegions = &region
+	};
+	vkCmdCopyBuffer2(this->getPendingCommand(), &copy_info);
+	this->releaseBuffer(destination, dst_offset, size, target);
+}
+
+void StagingUploader::upload(const ImageUploadInfo& upload_info, const span<const byte> data) {
+	if (this->isHostCopy(upload_info)) {
+		this->copyImageOnHost(upload_info, data.data());
+		return;
+	}
+
+	const VkDeviceSize size = data.size_bytes(),
+		offset = this->allocate(size);
+	std::memcpy(this->RingData.get() + offset, data.data(), size);
+
+	this->recordImageUpload(upload_info, this->Ring.second, offset);
+}
+
+void StagingUploader::upload(const ImageUploadInfo& upload_info, const VKO::BufferAllocation& source) {
+	if (this->isHostCopy(upload_info)) {
+		this->copyImageOnHost(upload_info, VKO::mapAllocation<byte>(this->Context->Allocator, source.first).get());
+		return;
+	}
+	this->recordImageUpload(upload_info, source.second, 0ull);
+}
+
+StagingUploader::Ticket StagingUploader::flush() {
+	if (*this->Pending.Command == VK_NULL_HANDLE) {
+		return this->NextTicket - 1ull;
+	}
+	const Ticket ticket = this->NextTicket++;
+	const VkDevice device = this->getDevice();
+
+	//flush ring memory written since the last submission, which may wrap around the end of the ring
+	{
+		const VkDeviceSize begin = this->SubmittedHead % this->Capacity,
+			size = this->Head - this->SubmittedHead,
+			first_size = std::min(size, this->Capacity - begin);
+		const auto allocation = array { *this->Ring.first, *this->Ring.first };
+		const auto offset = array { begin, VkDeviceSize { 0 } },
+			flush_size = array { first_size, size - first_size };
+		CHECK_VULKAN_ERROR(vmaFlushAllocations(this->Context->Allocator, static_cast<uint32_t>(allocation.size()),
+			allocation.data(), offset.data(), flush_size.data()));
+	}
+
+	VKO::CommandBuffer transfer_cmd = std::move(this->Pending.Command);
+	this->Pending.Release.record(transfer_cmd);
+	CHECK_VULKAN_ERROR(vkEndCommandBuffer(transfer_cmd));
+	CommandBufferManager::submit<1u, 0u, 1u>({ device, this->Context->Queue.Transfer }, { transfer_cmd }, {{ }},
+		{{{ this->TransferTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, ticket }}});
+
+	VKO::CommandBuffer acquire_cmd;
+	if (this->OwnershipTransfer) {
+		acquire_cmd = VKO::allocateCommandBuffer(device, {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = this->Context->CommandPool.Transient,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1u
+		});
+		CommandBufferManager::beginOneTimeSubmit(acquire_cmd);
+		this->Pending.Acquire.record(acquire_cmd);
+		CHECK_VULKAN_ERROR(vkEndCommandBuffer(acquire_cmd));
+
+		CommandBufferManager::submit<1u, 1u, 1u>({ device, this->Context->Queue.Render }, { acquire_cmd },
+			{{{ this->TransferTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, ticket }}},
+			{{{ this->AcquireTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, ticket }}});
+	}
+
+	this->Pending.Release.clear();
+	this->Pending.Acquire.clear();
+	this->InFlight.push_back({
+		.Value = ticket,
+		.RingEnd = this->Head,
+		.Transfer = std::move(transfer_cmd),
+		.Acquire = std::move(acquire_cmd)
+	});
+	this->SubmittedHead = this->Head;
+
+	//opportunistically reclaim command buffers and memory of batches that are done
+	this->retire(false);
+	return ticket;
+}
+
+CommandBufferManager::SemaphoreOperation StagingUploader::waitOperation(const Ticket ticket,
+	const VkPipelineStageFlags2 stage) const noexcept {
+	return {
+		.Semaphore = this->getCompletionSemaphore(),
+		.Stage = stage,
+		.Value = ticket
+	};
+}
+
+void StagingUploader::wait(const Ticket ticket) const {
+	SemaphoreManager::wait<1u>(this->getDevice(), { }, {{{ this->getCompletionSemaphore(), ticket }}});
+}
+
+bool StagingUploader::isComplete(const Ticket ticket) const {
+	uint64_t completed;
+	CHECK_VULKAN_ERROR(vkGetSemaphoreCounterValue(this->getDevice(), this->getCompletionSemaphore(), &completed));
+	return completed >= ticket;
+}
\ No newline at end of file
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "VulkanContext.hpp"
+#include "Abstraction/CommandBufferManager.hpp"
+#include "Abstraction/ImageManager.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <span>
+#include <deque>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Upload data from host to device through a persistently mapped ring of staging memory.
+	 * Uploads are batched and executed on the transfer queue, and ownership of each destination resource is
+	 * transferred to the rendering queue family if the queue families are distinct.
+	 * Completion of a batch is tracked by timeline semaphore value, and staging memory is reused once its batch completes.
+	 * If the device supports host image copy, images not yet in use by the device are copied to by the host instead,
+	 * which neither takes staging memory nor joins a batch.
+	*/
+	class StagingUploader {
+	public:
+
+		using Ticket = uint64_t;/**< Timeline semaphore value signalled when a batch of uploads completes. */
+
+		constexpr static VkDeviceSize DefaultCapacity = 16ull << 20u;/**< In byte. */
+
+		/**
+		 * @brief Specify how the uploaded resource will be used on the rendering queue.
+		*/
+		struct UploadTarget {
+
+			VkPipelineStageFlags2 Stage;
+			VkAccessFlags2 Access;
+
+		};
+
+		/**
+		 * @brief Information about uploading to a buffer.
+		*/
+		struct BufferUploadInfo {
+
+			VkBuffer Destination;
+			VkDeviceSize Offset = 0ull;/**< In byte, into the destination buffer. */
+			UploadTarget Target;
+
+		};
+
+		/**
+		 * @brief Information about uploading to an image.
+		 * Data are copied to each given level of each layer, and layers are laid out contiguously in the source memory.
+		 * The image will be in transfer destination optimal layout during the upload, unless it is in general layout,
+		 * levels not uploaded are left undefined if the current layout is undefined.
+		*/
+		struct ImageUploadInfo {
+
+			VkImage Destination;
+			VkImageAspectFlags Aspect;
+			//Offset into the base level, to upload a region of it. It must be zero if multiple levels are uploaded.
+			VkOffset3D Offset = { 0, 0, 0 };
+			VkExtent3D Extent;/**< Extent of the base level, or the region. */
+			uint32_t BaseLayer = 0u,
+				Layer = 1u;/**< The number of layer starting from the base layer. */
+			//Memory layout of levels in the source memory starting from the base level.
+			//If empty, only the base level which starts at the beginning of the source memory is uploaded.
+			std::span<const ImageManager::ImageLevel> Level = { };
+
+			/**
+			 * @brief The layout of uploaded subresources before the upload.
+			 * Content outside the uploaded region is only preserved if it is not undefined.
+			 * If it is general, the layout is never transitioned, so other regions can be read during the upload.
+			*/
+			VkImageLayout CurrentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkImageLayout TargetLayout;/**< The layout of the base level after the upload. */
+			UploadTarget Target;
+			//True if the image is shared concurrently by the transfer and the rendering queue family,
+			//so its ownership is never transferred.
+			bool Concurrent = false;
+			/**
+			 * @brief The usage the image is created with, see imageUsage().
+			 * The host copies to the image if it includes host transfer usage, the current layout is undefined,
+			 * and the target layout is supported by host image copy; the upload is complete once it returns.
+			*/
+			VkImageUsageFlags Usage = { };
+
+		};
+
+	private:
+
+		//Barriers to be recorded at once by the end of a batch.
+		struct BarrierBatch {
+
+			std::vector<VkBufferMemoryBarrier2> Buffer;
+			std::vector<VkImageMemoryBarrier2> Image;
+
+			void record(VkCommandBuffer) const noexcept;
+
+			void clear() noexcept;
+
+		};
+
+		struct InFlightBatch {
+
+			Ticket Value;
+			uint64_t RingEnd;/**< The end of ring memory used by this batch. */
+			VulkanObject::CommandBuffer Transfer, Acquire;
+
+		};
+
+		const VulkanContext* const Context;
+		//True if uploaded resources need to be transferred from the transfer queue family to the rendering queue family.
+		const bool OwnershipTransfer;
+
+		const VkDeviceSize Alignment, Capacity;
+		const VulkanObject::BufferAllocation Ring;
+		const VulkanObject::MappedAllocation<std::byte> RingData;
+
+		//The transfer timeline is signalled by the transfer queue, and the acquire timeline by the rendering queue
+		//after acquiring ownership, the latter is only used when ownership transfer is required.
+		const VulkanObject::Semaphore TransferTimeline, AcquireTimeline;
+		Ticket NextTicket;
+
+		//Position in the ring increments monotonically, and wraps around when indexing into the ring memory.
+		//Memory between tail and head is in use; memory before submitted head is owned by in-flight batches.
+		uint64_t Head, SubmittedHead, Tail;
+		std::deque<InFlightBatch> InFlight;
+		struct {
+
+			VulkanObject::CommandBuffer Command;
+			//Release barriers are recorded to the transfer queue, and acquire barriers to the rendering queue.
+			BarrierBatch Release, Acquire;
+
+		} Pending;
+
+		VkDevice getDevice() const noexcept;
+
+		//Get the semaphore signalled when a batch is completely ready to be used by the rendering queue.
+		VkSemaphore getCompletionSemaphore() const noexcept;
+
+		//Get the command buffer of the pending batch, and begin one if there is not yet any.
+		VkCommandBuffer getPendingCommand();
+
+		/**
+		 * @brief Allocate memory from the ring.
+		 * Pending uploads may be submitted if the ring is full.
+		 * @param size The number of byte.
+		 * @return The offset into the ring memory.
+		 * @exception If the size is greater than the capacity of the ring.
+		*/
+		VkDeviceSize allocate(VkDeviceSize);
+
+		//Reclaim ring memory from completed batches, and optionally block until the oldest batch completes.
+		void retire(bool);
+
+		//Record barriers to hand over the resource to the rendering queue after it has been copied to.
+		void releaseBuffer(VkBuffer, VkDeviceSize, VkDeviceSize, const UploadTarget&);
+		void releaseImage(const ImageUploadInfo&);
+
+		//Record a copy from buffer to image, with all required barriers.
+		void recordImageUpload(const ImageUploadInfo&, VkBuffer, VkDeviceSize);
+
+		//Check if an upload to image can be done by the host.
+		bool isHostCopy(const ImageUploadInfo&) const noexcept;
+		//Transition and copy to an image on the host, levels are copied in parallel.
+		void copyImageOnHost(const ImageUploadInfo&, const std::byte*) const;
+
+	public:
+
+		/**
+		 * @brief Create a staging uploader.
+		 * @param ctx The context. The context is retained and must remain valid until the uploader is destroyed.
+		 * @param capacity The size of the staging ring in byte.
+		*/
+		StagingUploader(const VulkanContext&, VkDeviceSize = DefaultCapacity);
+
+		StagingUploader(const StagingUploader&) = delete;
+
+		StagingUploader(StagingUploader&&) = delete;
+
+		StagingUploader& operator=(const StagingUploader&) = delete;
+
+		StagingUploader& operator=(StagingUploader&&) = delete;
+
+		/**
+		 * @brief The device must be idle, or all submitted uploads have completed.
+		*/
+		~StagingUploader() = default;
+
+		/**
+		 * @brief Get the usage required by an image to be uploaded to.
+		 * Host transfer usage is included if the host can copy to the image without degrading device access to it.
+		 * @param format The format of the 2D image with optimal tiling.
+		 * @param flag The create flags of the image.
+		 * @param usage Other usage of the image.
+		 * @return The usage the image should be created with.
+		*/
+		VkImageUsageFlags imageUsage(VkFormat, VkImageCreateFlags, VkImageUsageFlags) const;
+
+		/**
+		 * @brief Check if the host can copy to an image.
+		 * @param usage The usage the image is created with.
+		 * @param layout The layout of the image during the copy.
+		 * @return True if the image has host transfer usage and the layout is supported by host image copy.
+		*/
+		bool canHostCopy(VkImageUsageFlags, VkImageLayout) const noexcept;
+
+		/**
+		 * @brief Upload data to a buffer.
+		 * @param upload_info The information about the upload.
+		 * @param data The data to be uploaded. Data are copied into the staging ring immediately.
+		 * @exception If the data is larger than the capacity of the staging ring.
+		*/
+		void upload(const BufferUploadInfo&, std::span<const std::byte>);
+
+		/**
+		 * @brief Upload data to an image.
+		 * @param upload_info The information about the upload.
+		 * @param data The data to be uploaded. Data are copied into the staging ring, or to the image by the host, immediately.
+		 * @exception If the data is larger than the capacity of the staging ring.
+		*/
+		void upload(const ImageUploadInfo&, std::span<const std::byte>);
+
+		/**
+		 * @brief Upload data to an image from an existing staging buffer, such as an image read result.
+		 * @param upload_info The information about the upload.
+		 * @param source The source buffer whose data start from the beginning.
+		 * The buffer must remain valid until the batch this upload belongs to completes,
+		 * or it is mapped and copied to the image by the host immediately.
+		*/
+		void upload(const ImageUploadInfo&, const VulkanObject::BufferAllocation&);
+
+		/**
+		 * @brief Submit all pending uploads as a batch.
+		 * @return The ticket that will be signalled when this and all previous batches complete.
+		 * If nothing is pending, it is the ticket of the last batch.
+		*/
+		Ticket flush();
+
+		/**
+		 * @brief Get the semaphore operation to have a submission to the rendering queue wait for uploads.
+		 * @param ticket The ticket to be waited.
+		 * @param stage The stage at which the wait happens.
+		 * @return The semaphore operation.
+		*/
+		CommandBufferManager::SemaphoreOperation waitOperation(Ticket, VkPipelineStageFlags2) const noexcept;
+
+		/**
+		 * @brief Block the host until uploads have completed.
+		 * @param ticket The ticket to be waited.
+		*/
+		void wait(Ticket) const;
+
+		/**
+		 * @brief Check if uploads have completed without blocking.
+		 * @param ticket The ticket to be checked.
+		 * @return True if uploads of the ticket are ready to be used by the rendering queue.
+		*/
+		bool isComplete(Ticket) const;
+
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "StartupGraph.hpp"
+#include "CpuProfiler.hpp"
+
+#include <iomanip>
+#include <string_view>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <cassert>
+
+using std::span, std::vector, std::string_view, std::ostream, std::endl;
+using std::unique_lock, std::lock_guard;
+using std::exception_ptr, std::current_exception, std::rethrow_exception;
+using std::runtime_error;
+
+namespace chrono = std::chrono;
+
+using namespace LearnVulkan;
+
+namespace {
+
+	inline double toMillisecond(const chrono::steady_clock::duration duration) noexcept {
+		return chrono::duration<double, std::milli>(duration).count();
+	}
+
+	//The graph and phase being run by this thread, for timing steps.
+	thread_local StartupGraph* CurrentGraph = nullptr;
+	thread_local StartupGraph::PhaseIdentifier CurrentPhase = 0u;
+
+}
+
+StartupGraph::Step::Step(const char* const name) noexcept : Graph(::CurrentGraph), Owner(::CurrentPhase), Name(name),
+	Begin(chrono::steady_clock::now()) {
+
+}
+
+StartupGraph::Step::~Step() {
+	if (!this->Graph) {
+		return;
+	}
+	const double duration = ::toMillisecond(chrono::steady_clock::now() - this->Begin);
+
+	const lock_guard lock(this->Graph->Mutex);
+	vector<StepTime>& step = this->Graph->StepDuration;
+	//the same name may be from different translation units, so it is compared by content
+	const auto it = std::ranges::find_if(step, [owner = this->Owner, name = string_view(this->Name)](const auto& time) noexcept {
+		return time.Phase == owner && time.Name == name;
+	});
+	if (it == step.end()) {
+		step.push_back({
+			.Phase = this->Owner,
+			.Name = this->Name,
+			.Duration = duration
+		});
+	} else {
+		it->Duration += duration;
+	}
+}
+
+StartupGraph::StartupGraph() : TotalTime(0.0), RemainingPhase(0u) {
+
+}
+
+StartupGraph::PhaseIdentifier StartupGraph::addPhase(PhaseCreateInfo&& info) {
+	const auto id = static_cast<PhaseIdentifier>(this->Node.size());
+	for (const auto dependency : info.Dependency) {
+		if (dependency >= id) {
+			throw runtime_error("A startup phase must only depend on phases added before it");
+		}
+		this->Node[dependency].Dependent.push_back(id);
+	}
+	this->Node.push_back({
+		.Name = info.Name,
+		.Work = std::move(info.Work),
+		.RemainingDependency = static_cast<uint32_t>(info.Dependency.size()),
+		.MainThread = info.MainThread
+	});
+	return id;
+}
+
+void StartupGraph::schedule(const PhaseIdentifier id) {
+	if (this->Node[id].MainThread) {
+		this->MainThreadReady.push_back(id);
+		this->Progress.notify_one();
+		return;
+	}
+	this->Worker.emplace_back([this, id]() {
+		CpuProfiler::nameThread("Startup worker");
+		this->execute(id);
+	});
+}
+
+void StartupGraph::finish(const PhaseIdentifier id) {
+	this->RemainingPhase--;
+	for (const auto dependent : this->Node[id].Dependent) {
+		if (--this->Node[dependent].RemainingDependency > 0u) {
+			continue;
+		}
+		//a phase whose dependency has failed is skipped, which in turn skips its own dependents
+		if (this->PhaseException) {
+			this->finish(dependent);
+		} else {
+			this->schedule(dependent);
+		}
+	}
+	if (this->RemainingPhase == 0u) {
+		this->Progress.notify_one();
+	}
+}
+
+void StartupGraph::execute(const PhaseIdentifier id) {
+	Phase& phase = this->Node[id];
+
+	::CurrentGraph = this;
+	::CurrentPhase = id;
+	const auto begin = chrono::steady_clock::now();
+	exception_ptr phase_exception;
+	try {
+		CPU_PROFILE_SCOPE(phase.Name);
+		phase.Work();
+	} catch (...) {
+		phase_exception = current_exception();
+	}
+	const auto end = chrono::steady_clock::now();
+	::CurrentGraph = nullptr;
+	//release anything captured by the work as early as possible
+	phase.Work = nullptr;
+
+	const lock_guard lock(this->Mutex);
+	this->Time[id] = {
+		.Name = phase.Name,
+		.Start = ::toMillisecond(begin - this->Origin),
+		.Duration = ::toMillisecond(end - begin)
+	};
+	if (phase_exception && !this->PhaseException) {
+		this->PhaseException = std::move(phase_exception);
+	}
+	this->finish(id);
+}
+
+void StartupGraph::run() {
+	assert(this->Time.empty());
+	this->Time.resize(this->Node.size(), PhaseTime { });
+	for (size_t i = 0u; i < this->Node.size(); i++) {
+		this->Time[i].Name = this->Node[i].Name;
+	}
+
+	unique_lock lock(this->Mutex);
+	this->Origin = chrono::steady_clock::now();
+	this->RemainingPhase = this->Node.size();
+	for (size_t i = 0u; i < this->Node.size(); i++) {
+		if (this->Node[i].RemainingDependency == 0u) {
+			this->schedule(static_cast<PhaseIdentifier>(i));
+		}
+	}
+
+	while (true) {
+		this->Progress.wait(lock, [this]() noexcept { return !this->MainThreadReady.empty() || this->RemainingPhase == 0u; });
+		if (this->RemainingPhase == 0u) {
+			break;
+		}
+		const PhaseIdentifier id = this->MainThreadReady.back();
+		this->MainThreadReady.pop_back();
+		if (this->PhaseException) {
+			this->finish(id);
+			continue;
+		}
+
+		lock.unlock();
+		this->execute(id);
+		lock.lock();
+	}
+	this->TotalTime = ::toMillisecond(chrono::steady_clock::now() - this->Origin);
+	lock.unlock();
+
+	//every phase has finished, so this only waits for the threads to return
+	this->Worker.clear();
+	if (this->PhaseException) {
+		rethrow_exception(std::exchange(this->PhaseException, nullptr));
+	}
+}
+
+span<const StartupGraph::PhaseTime> StartupGraph::phaseTime() const noexcept {
+	return this->Time;
+}
+
+span<const StartupGraph::StepTime> StartupGraph::stepTime() const noexcept {
+	return this->StepDuration;
+}
+
+double StartupGraph::totalTime() const noexcept {
+	return this->TotalTime;
+}
+
+void StartupGraph::report(ostream& out) const {
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+
+	out << "Startup phase:" << std::fixed << std::setprecision(2) << endl;
+	for (size_t i = 0u; i < this->Time.size(); i++) {
+		const auto& [name, start, duration] = this->Time[i];
+		out << '\t' << std::left << std::setw(20) << name << std::right
+			<< " starts at " << std::setw(9) << start << " ms, takes " << std::setw(9) << duration << " ms" << endl;
+		for (const auto& step : this->StepDuration) {
+			if (step.Phase != i) {
+				continue;
+			}
+			out << "\t\t" << std::left << std::setw(28) << step.Name << std::right
+				<< " takes " << std::setw(9) << step.Duration << " ms in total" << endl;
+		}
+	}
+	out << "Startup takes " << this->TotalTime << " ms" << endl;
+
+	out.flags(flags);
+	out.precision(precision);
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <ostream>
+#include <span>
+#include <vector>
+#include <functional>
+#include <exception>
+#include <chrono>
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Run application startup as a graph of phases, each of which starts as soon as all its dependencies are finished,
+	 * such that independent phases run concurrently.
+	 * Every phase is timed, and the duration can be reported once the graph has been run.
+	*/
+	class StartupGraph {
+	public:
+
+		/**
+		 * @brief Identify a phase in the graph.
+		*/
+		using PhaseIdentifier = uint32_t;
+
+		/**
+		 * @brief Information to add a phase to the graph.
+		*/
+		struct PhaseCreateInfo {
+
+			const char* Name;/**< It must have static storage duration, and is used as the name of CPU profiler scope. */
+			std::function<void()> Work;
+			//Every dependency must be added before this phase, so the graph can never have a cycle.
+			std::span<const PhaseIdentifier> Dependency;
+			//Run on the thread calling run(), for work that must stay on the main thread such as window system calls.
+			//Otherwise the phase is run on a thread of its own.
+			bool MainThread = false;
+
+		};
+
+		/**
+		 * @brief The time of a phase, in millisecond relative to the start of the graph.
+		*/
+		struct PhaseTime {
+
+			const char* Name;
+			double Start, Duration;
+
+		};
+
+		/**
+		 * @brief The total time of every step of the same name in a phase, in millisecond.
+		*/
+		struct StepTime {
+
+			PhaseIdentifier Phase;
+			const char* Name;
+			double Duration;
+
+		};
+
+		/**
+		 * @brief Time a step of the phase being run by the calling thread, from construction to destruction.
+		 * This breaks down a phase whose steps cannot run as phases of their own, for example because they share
+		 * resources that are only safe to be used by one thread.
+		 * Nothing is recorded if the calling thread is not running a phase, so it can be used by code that also runs after startup.
+		*/
+		class Step {
+		private:
+
+			StartupGraph* const Graph;
+			const PhaseIdentifier Owner;
+			const char* const Name;
+			const std::chrono::steady_clock::time_point Begin;
+
+		public:
+
+			/**
+			 * @brief Begin a step.
+			 * @param name The name of the step. It must have static storage duration.
+			*/
+			explicit Step(const char*) noexcept;
+
+			Step(const Step&) = delete;
+
+			Step(Step&&) = delete;
+
+			Step& operator=(const Step&) = delete;
+
+			Step& operator=(Step&&) = delete;
+
+			/**
+			 * @brief End the step and add its duration to the phase.
+			*/
+			~Step();
+
+		};
+
+	private:
+
+		struct Phase {
+
+			const char* Name;
+			std::function<void()> Work;
+			std::vector<PhaseIdentifier> Dependent;
+			uint32_t RemainingDependency;
+			bool MainThread;
+
+		};
+		std::vector<Phase> Node;
+		std::vector<PhaseTime> Time;
+		std::vector<StepTime> StepDuration;/**< Guarded by the mutex while the graph is run. */
+		std::chrono::steady_clock::time_point Origin;
+		double TotalTime;
+
+		//States below are guarded by the mutex while the graph is run.
+		std::mutex Mutex;
+		std::condition_variable Progress;
+		std::vector<PhaseIdentifier> MainThreadReady;
+		size_t RemainingPhase;
+		//The first exception thrown by a phase, after which no more phase is started.
+		std::exception_ptr PhaseException;
+		std::vector<std::jthread> Worker;
+
+		//Queue a phase whose dependencies are all finished. The mutex must be held.
+		void schedule(PhaseIdentifier);
+		//Mark a phase as finished and schedule its ready dependents, or skip them after any exception. The mutex must be held.
+		void finish(PhaseIdentifier);
+		//Run and time a phase. The mutex must not be held.
+		void execute(PhaseIdentifier);
+
+	public:
+
+		StartupGraph();
+
+		StartupGraph(const StartupGraph&) = delete;
+
+		StartupGraph(StartupGraph&&) = delete;
+
+		StartupGraph& operator=(const StartupGraph&) = delete;
+
+		StartupGraph& operator=(StartupGraph&&) = delete;
+
+		~StartupGraph() = default;
+
+		/**
+		 * @brief Add a phase to the graph.
+		 * @param info The phase create info.
+		 * @return The identifier of the phase.
+		*/
+		PhaseIdentifier addPhase(PhaseCreateInfo&&);
+
+		/**
+		 * @brief Run every phase in the graph, and block until all of them are finished.
+		 * The graph can only be run once.
+		 * @exception If any phase throws, phases not yet started are skipped,
+		 * and the first exception is rethrown after all started phases have finished.
+		*/
+		void run();
+
+		/**
+		 * @brief Get the time of every phase in the order of addition, after the graph has been run.
+		*/
+		std::span<const PhaseTime> phaseTime() const noexcept;
+
+		/**
+		 * @brief Get the time of every step, in the order each name first appears, after the graph has been run.
+		*/
+		std::span<const StepTime> stepTime() const noexcept;
+
+		/**
+		 * @brief Get the wall time from the start to the end of the graph in millisecond, after the graph has been run.
+		*/
+		double totalTime() const noexcept;
+
+		/**
+		 * @brief Write the duration of every phase, each followed by its steps, to a stream.
+		 * @param out The stream to be written to.
+		*/
+		void report(std::ostream&) const;
+
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "TimestampProfiler.hpp"
+#include "CpuProfiler.hpp"
+
+#include "../Common/ErrorHandler.hpp"
+#include "../Common/StaticArray.hpp"
+
+#include <algorithm>
+#include <ranges>
+
+#include <stdexcept>
+#include <cassert>
+
+using std::array, std::span;
+using std::ranges::generate, std::views::iota;
+using std::runtime_error;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	//The number of query used by each region, for the beginning and ending timestamp.
+	constexpr uint32_t QueryPerRegion = 2u;
+	constexpr uint32_t QueryCount = TimestampProfiler::MaxRegion * ::QueryPerRegion;
+
+	//Results are written in the order of bit, which matches the order of member in the statistics struct.
+	constexpr VkQueryPipelineStatisticFlags PipelineStatisticsFlag =
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_CONTROL_SHADER_PATCHES_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_EVALUATION_SHADER_INVOCATIONS_BIT
+		| VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+	constexpr uint32_t PipelineStatisticsCount = sizeof(TimestampProfiler::PipelineStatistics) / sizeof(uint64_t);
+
+	inline VKO::QueryPool createProfilerQueryPool(const VkDevice device, const VkQueryPoolCreateInfo& query_info) {
+		VKO::QueryPool query = VKO::createQueryPool(device, query_info);
+		//queries must be reset before the first use, and we reset from host so there is no need to have a command buffer
+		vkResetQueryPool(device, query, 0u, query_info.queryCount);
+		return query;
+	}
+
+	inline VKO::QueryPool createTimestampQueryPool(const VkDevice device) {
+		constexpr static VkQueryPoolCreateInfo query_info {
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = ::QueryCount
+		};
+		return ::createProfilerQueryPool(device, query_info);
+	}
+
+	inline VKO::QueryPool createStatisticsQueryPool(const VkDevice device) {
+		constexpr static VkQueryPoolCreateInfo query_info {
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+			.queryCount = TimestampProfiler::MaxRegion,
+			.pipelineStatistics = ::PipelineStatisticsFlag
+		};
+		return ::createProfilerQueryPool(device, query_info);
+	}
+
+	uint32_t getTimestampValidBit(const VkPhysicalDevice gpu, const uint32_t queue_family) {
+		uint32_t qf_count;
+		vkGetPhysicalDeviceQueueFamilyProperties(gpu, &qf_count, nullptr);
+		StaticArray<VkQueueFamilyProperties> qf(qf_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(gpu, &qf_count, qf.data());
+
+		assert(queue_family < qf_count);
+		return qf[queue_family].timestampValidBits;
+	}
+
+}
+
+TimestampProfiler::TimestampProfiler(const VulkanContext& ctx) :
+	TimestampPeriod(ctx.PhysicalDeviceProperty.Limit.timestampPeriod) {
+	const uint32_t valid_bit = ::getTimestampValidBit(ctx.PhysicalDevice, ctx.QueueIndex.Render);
+	if (valid_bit == 0u) {
+		throw runtime_error("The rendering queue does not support timestamp query.");
+	}
+	this->TimestampMask = valid_bit >= 64u ? ~uint64_t { 0 } : (uint64_t { 1 } << valid_bit) - 1ull;
+
+	generate(span(this->QueryPool).first(ctx.FrameInFlight), [device = *ctx.Device]() { return ::createTimestampQueryPool(device); });
+	if (ctx.Feature.PipelineStatisticsQuery) {
+		generate(span(this->StatisticsQueryPool).first(ctx.FrameInFlight),
+			[device = *ctx.Device]() { return ::createStatisticsQueryPool(device); });
+	}
+}
+
+inline VkDevice TimestampProfiler::getDevice() const noexcept {
+	return this->QueryPool.front()->get_deleter().Device;
+}
+
+TimestampProfiler::RegionIdentifier TimestampProfiler::registerRegion(const char* const name, const bool statistics) {
+	if (this->Region.size() == this->Region.capacity()) {
+		throw runtime_error("The number of profiler region has exceeded the limit.");
+	}
+
+	this->Region.pushBack({
+		.Name = name,
+		.Millisecond = 0.0,
+		.RecordStatistics = statistics && *this->StatisticsQueryPool.front() != VK_NULL_HANDLE,
+		.Statistics = { }
+	});
+	return static_cast<RegionIdentifier>(this->Region.size() - 1u);
+}
+
+void TimestampProfiler::beginRegion(const VkCommandBuffer cmd, const unsigned int frame_index, const RegionIdentifier region) const noexcept {
+	assert(region < this->Region.size());
+	//GPU captures show the same regions
+	CpuProfiler::beginCommandLabel(cmd, this->Region[region].Name);
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, this->QueryPool[frame_index], region * ::QueryPerRegion);
+	if (this->Region[region].RecordStatistics) {
+		vkCmdBeginQuery(cmd, this->StatisticsQueryPool[frame_index], region, 0u);
+	}
+}
+
+void TimestampProfiler::endRegion(const VkCommandBuffer cmd, const unsigned int frame_index, const RegionIdentifier region) const noexcept {
+	assert(region < this->Region.size());
+	if (this->Region[region].RecordStatistics) {
+		vkCmdEndQuery(cmd, this->StatisticsQueryPool[frame_index], region);
+	}
+	vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, this->QueryPool[frame_index], region * ::QueryPerRegion + 1u);
+	CpuProfiler::endCommandLabel(cmd);
+}
+
+void TimestampProfiler::resolve(const unsigned int frame_index) {
+	const uint32_t region_count = static_cast<uint32_t>(this->Region.size());
+	if (region_count == 0u) {
+		return;
+	}
+	const VkDevice device = this->getDevice();
+	const VkQueryPool query = this->QueryPool[frame_index];
+
+	//each query is followed by its availability
+	array<array<uint64_t, 2u>, ::QueryCount> timestamp;
+	const uint32_t query_count = region_count * ::QueryPerRegion;
+	//it is expected to be not ready if some regions are not recorded in this frame
+	if (const VkResult result = vkGetQueryPoolResults(device, query, 0u, query_count, sizeof(timestamp[0]) * query_count,
+			timestamp.data(), sizeof(timestamp[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		result != VK_NOT_READY) {
+		CHECK_VULKAN_ERROR(result);
+	}
+
+	for (const auto i : iota(0u, region_count)) {
+		const auto [begin, begin_available] = timestamp[i * ::QueryPerRegion];
+		const auto [end, end_available] = timestamp[i * ::QueryPerRegion + 1u];
+		if (begin_available == 0ull || end_available == 0ull) {
+			continue;
+		}
+
+		const uint64_t tick = ((end & this->TimestampMask) - (begin & this->TimestampMask)) & this->TimestampMask;
+		this->Region[i].Millisecond = tick * this->TimestampPeriod * 1e-6;
+	}
+	vkResetQueryPool(device, query, 0u, query_count);
+
+	const VkQueryPool statistics_query = this->StatisticsQueryPool[frame_index];
+	if (statistics_query == VK_NULL_HANDLE) {
+		return;
+	}
+	//every counter of a query is followed by a single availability
+	//queries of regions not recording statistics are never written and remain unavailable
+	array<array<uint64_t, ::PipelineStatisticsCount + 1u>, TimestampProfiler::MaxRegion> statistics;
+	if (const VkResult result = vkGetQueryPoolResults(device, statistics_query, 0u, region_count, sizeof(statistics[0]) * region_count,
+			statistics.data(), sizeof(statistics[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		result != VK_NOT_READY) {
+		CHECK_VULKAN_ERROR(result);
+	}
+
+	for (const auto i : iota(0u, region_count)) {
+		const auto& counter = statistics[i];
+		if (!this->Region[i].RecordStatistics || counter.back() == 0ull) {
+			continue;
+		}
+		this->Region[i].Statistics = {
+			.VertexShaderInvocation = counter[0],
+			.ClippingPrimitive = counter[1],
+			.FragmentShaderInvocation = counter[2],
+			.TessellationControlShaderPatch = counter[3],
+			.TessellationEvaluationShaderInvocation = counter[4],
+			.ComputeShaderInvocation = counter[5]
+		};
+	}
+	vkResetQueryPool(device, statistics_query, 0u, region_count);
+}
+
+span<const TimestampProfiler::RegionTime> TimestampProfiler::regionTime() const noexcept {
+	return { this->Region.data(), this->Region.size() };
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "EngineSetting.hpp"
+#include "VulkanContext.hpp"
+
+#include "../Common/FixedArray.hpp"
+#include "../Common/VulkanObject.hpp"
+
+#include <array>
+#include <span>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief A GPU profiler that measures the execution time of named regions in command buffers using timestamp queries.
+	 * A region may also count the work done by the pipeline using pipeline statistics queries, if supported by the device.
+	 * Each in-flight frame owns its own set of queries, and results of a frame are read back the next time the same
+	 * in-flight frame index is used, such that reading results never stalls the queue.
+	*/
+	class TimestampProfiler {
+	public:
+
+		/**
+		 * @brief The maximum number of region supported by the profiler.
+		*/
+		constexpr static uint32_t MaxRegion = 8u;
+
+		using RegionIdentifier = uint32_t;/**< An identifier to a registered region. */
+
+		/**
+		 * @brief Counters of pipeline statistics, in the order they are written by the query.
+		*/
+		struct PipelineStatistics {
+
+			uint64_t VertexShaderInvocation,
+				ClippingPrimitive,/**< Primitives reaching the clipping stage. */
+				FragmentShaderInvocation,
+				TessellationControlShaderPatch,
+				TessellationEvaluationShaderInvocation,
+				ComputeShaderInvocation;
+
+		};
+
+		/**
+		 * @brief Timing of a named region.
+		*/
+		struct RegionTime {
+
+			const char* Name;
+			double Millisecond;/**< GPU time of the region from the most recently resolved frame. */
+			bool RecordStatistics;/**< True if pipeline statistics are recorded for this region. */
+			PipelineStatistics Statistics;/**< From the most recently resolved frame, or zero if not recorded. */
+
+		};
+
+	private:
+
+		std::array<VulkanObject::QueryPool, EngineSetting::MaxFrameInFlight> QueryPool;
+		//One query for each region, or empty if pipeline statistics are not supported.
+		std::array<VulkanObject::QueryPool, EngineSetting::MaxFrameInFlight> StatisticsQueryPool;
+		FixedArray<RegionTime, MaxRegion> Region;
+
+		double TimestampPeriod;/**< Nanosecond per tick. */
+		uint64_t TimestampMask;
+
+		VkDevice getDevice() const noexcept;
+
+	public:
+
+		/**
+		 * @brief Create a timestamp profiler.
+		 * @param ctx The context. Timestamps will be written on the rendering queue.
+		*/
+		TimestampProfiler(const VulkanContext&);
+
+		TimestampProfiler(const TimestampProfiler&) = delete;
+
+		TimestampProfiler(TimestampProfiler&&) = delete;
+
+		TimestampProfiler& operator=(const TimestampProfiler&) = delete;
+
+		TimestampProfiler& operator=(TimestampProfiler&&) = delete;
+
+		~TimestampProfiler() = default;
+
+		/**
+		 * @brief Register a new region to be profiled.
+		 * @param name The name of the region. The string must remain valid until the profiler is destroyed.
+		 * @param statistics True to also record pipeline statistics, which is ignored if not supported by the device.
+		 * Such region must begin and end in the same command buffer, both outside rendering or both within the same rendering,
+		 * and must not overlap another region recording statistics in the same command buffer.
+		 * @return The identifier of the region.
+		 * @exception If the number of region exceeds the limit.
+		*/
+		RegionIdentifier registerRegion(const char*, bool = false);
+
+		/**
+		 * @brief Record a command to mark the beginning of a region.
+		 * Each region can only be recorded once per frame.
+		 * The region is also labelled with debug utils, so regions must be nested if they overlap,
+		 * and a region begun in a secondary command buffer must end in the same command buffer.
+		 * @param cmd The command buffer.
+		 * @param frame_index The in-flight frame index.
+		 * @param region The region identifier.
+		*/
+		void beginRegion(VkCommandBuffer, unsigned int, RegionIdentifier) const noexcept;
+
+		/**
+		 * @brief Record a command to mark the end of a region.
+		 * @param cmd The command buffer.
+		 * @param frame_index The in-flight frame index.
+		 * @param region The region identifier.
+		*/
+		void endRegion(VkCommandBuffer, unsigned int, RegionIdentifier) const noexcept;
+
+		/**
+		 * @brief Read back timestamps and pipeline statistics from the previous use of an in-flight frame and reset its queries.
+		 * The host must have waited for all commands previously submitted with this frame index to finish.
+		 * Regions not recorded in that frame retain their previous results.
+		 * @param frame_index The in-flight frame index.
+		*/
+		void resolve(unsigned int);
+
+		/**
+		 * @brief Get timings and pipeline statistics of all registered regions.
+		 * @return An array of region time, indexed by region identifier.
+		*/
+		std::span<const RegionTime> regionTime() const noexcept;
+
+	};
+
+}
\ No newline at end of file
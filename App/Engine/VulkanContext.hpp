@@ -1,9 +1,11 @@
 #pragma once
 
 #include "EngineSetting.hpp"
+#include "Abstraction/FramebufferManager.hpp"
 #include "../Common/VulkanObject.hpp"
 
 #include <array>
+#include <vector>
 #include <unordered_set>
 
 #include <cstdint>
@@ -43,6 +45,16 @@ namespace LearnVulkan {
 
 		VulkanObject::Device Device;
 		VulkanObject::Allocator Allocator;
+		//Pools are created in place when renderers are reshaped, which never happens concurrently.
+		mutable FramebufferManager::TransientAttachmentPool TransientAttachment;
+		//Shared by all pipeline creation, loaded from disk at start up and saved on shutdown.
+		VulkanObject::PipelineCache PipelineCache;
+		//The number of frame in flight chosen at start up, in [1, EngineSetting::MaxFrameInFlight].
+		//Every in-flight frame index is less than this number.
+		unsigned int FrameInFlight;
+		//The layout every renderer leaves the present image in at the end of a frame.
+		//It is present source with a swap chain, and transfer source when rendering offscreen, such that the image can be read back.
+		VkImageLayout PresentLayout;
 		struct {
 
 			//This command pool does not allow individual command buffer reset,
@@ -55,25 +67,50 @@ namespace LearnVulkan {
 				Transient,
 				//The general pool allows individual reset.
 				General;
+			//Pools for the compute queue, analogous to the transient and general pool for the rendering queue.
+			VulkanObject::CommandPool ComputeTransient, ComputeGeneral;
+			//Pool for the transfer queue, optimised for temporary command buffer use.
+			VulkanObject::CommandPool Transfer;
 
 		} CommandPool;
 
 		struct {
 		
-			VkQueue Render, Present;
+			VkQueue Render, Present,
+				//Used for asynchronous compute, such as geometry generation and acceleration structure build.
+				//Resources with exclusive sharing mode need queue family ownership transfer before use by other queues.
+				Compute,
+				//Used for uploading data from host, and it follows the same ownership rule as the compute queue.
+				Transfer;
 		
 		} Queue;
 		struct {
 			
-			uint32_t Render, Present;
+			uint32_t Render, Present, Compute, Transfer;
 		
 		} QueueIndex;
 
 		struct {
 		
+			VkPhysicalDeviceLimits Limit;
 			VkPhysicalDeviceDescriptorBufferPropertiesEXT DescriptorBuffer;
+			VkPhysicalDeviceAccelerationStructurePropertiesKHR AccelStruct;
+			VkPhysicalDeviceRayTracingPipelinePropertiesKHR RayTracingPipeline;/**< Undefined if the feature is disabled. */
+			//Layouts an image can be in when the host copies to it, empty if the feature is disabled.
+			std::vector<VkImageLayout> HostImageCopyDstLayout;
 
 		} PhysicalDeviceProperty;
+		//Optional features enabled on the device, renderers should provide a fallback when a feature is disabled.
+		struct {
+
+			bool MeshShader;/**< Task and mesh shader. */
+			bool RayTracingPipeline;/**< Ray tracing pipeline and shader binding table. */
+			//Tessellation shader in multiview rendering, multiview is otherwise always enabled.
+			bool MultiviewTessellation;
+			bool PipelineStatisticsQuery;/**< Pipeline statistics query. */
+			bool HostImageCopy;/**< Copy from host memory to images on the host. */
+
+		} Feature;
 
 		VulkanContext() noexcept = default;
 
@@ -0,0 +1,77 @@
+#include "WorkerCommandPool.hpp"
+#include "Abstraction/CommandBufferManager.hpp"
+
+#include "../Common/ErrorHandler.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <span>
+
+#include <cassert>
+
+using std::ranges::generate;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+WorkerCommandPool::WorkerCommandPool(const VulkanContext& ctx, const uint32_t worker_count) : Worker(worker_count) {
+	for (auto& worker : this->Worker) {
+		generate(std::span(worker).first(ctx.FrameInFlight), [&ctx]() {
+			return FramePool {
+				//like the in-flight command pool, command buffers are reset with the pool
+				.Pool = CommandBufferManager::createCommandPool(ctx.Device, { }, ctx.QueueIndex.Render),
+				.Used = 0u
+			};
+		});
+	}
+	this->ReshapePool.reserve(worker_count);
+	std::generate_n(std::back_inserter(this->ReshapePool), worker_count,
+		[&ctx]() { return CommandBufferManager::createCommandPool(ctx.Device, { }, ctx.QueueIndex.Render); });
+}
+
+inline VkDevice WorkerCommandPool::getDevice() const noexcept {
+	return this->Worker.front().front().Pool->get_deleter().Device;
+}
+
+void WorkerCommandPool::reset(const unsigned int frame_index) {
+	const VkDevice device = this->getDevice();
+	for (auto& worker : this->Worker) {
+		FramePool& frame = worker[frame_index];
+		if (frame.Used == 0u) {
+			continue;
+		}
+		CHECK_VULKAN_ERROR(vkResetCommandPool(device, frame.Pool, { }));
+		frame.Used = 0u;
+	}
+}
+
+VkCommandBuffer WorkerCommandPool::allocateSecondary(const uint32_t worker_index, const unsigned int frame_index) {
+	assert(worker_index < this->Worker.size());
+	auto& [pool, secondary, used] = this->Worker[worker_index][frame_index];
+	if (used == secondary.size()) {
+		secondary.emplace_back(VKO::allocateCommandBuffer(this->getDevice(), {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1u
+		}));
+	}
+	return secondary[used++];
+}
+
+void WorkerCommandPool::resetReshape() {
+	const VkDevice device = this->getDevice();
+	for (const auto& pool : this->ReshapePool) {
+		CHECK_VULKAN_ERROR(vkResetCommandPool(device, pool, { }));
+	}
+}
+
+VKO::CommandBuffer WorkerCommandPool::allocateReshapeSecondary(const uint32_t worker_index) {
+	assert(worker_index < this->ReshapePool.size());
+	return VKO::allocateCommandBuffer(this->getDevice(), {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = this->ReshapePool[worker_index],
+		.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+		.commandBufferCount = 1u
+	});
+}
\ No newline at end of file
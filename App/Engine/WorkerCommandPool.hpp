@@ -0,0 +1,91 @@
+#pragma once
+
+#include "EngineSetting.hpp"
+#include "VulkanContext.hpp"
+#include "../Common/VulkanObject.hpp"
+
+#include <array>
+#include <vector>
+
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Command pools for the rendering queue, one for each worker of a job system and each in-flight frame.
+	 * Command pools are externally synchronised, so giving each worker its own pool allows recording in parallel.
+	 * Secondary command buffers are allocated linearly from a pool and recycled when the in-flight frame is reset.
+	 * Each worker also has a pool for secondary command buffers recorded once and reused until the next reshape.
+	*/
+	class WorkerCommandPool {
+	private:
+
+		struct FramePool {
+
+			VulkanObject::CommandPool Pool;
+			//Command buffers allocated so far, those before the used count have been handed out in the current frame.
+			std::vector<VulkanObject::CommandBuffer> Secondary;
+			size_t Used;
+
+		};
+		//Indexed by worker, then in-flight frame.
+		std::vector<std::array<FramePool, EngineSetting::MaxFrameInFlight>> Worker;
+		//Indexed by worker.
+		std::vector<VulkanObject::CommandPool> ReshapePool;
+
+		VkDevice getDevice() const noexcept;
+
+	public:
+
+		/**
+		 * @brief Create worker command pools.
+		 * @param ctx The context.
+		 * @param worker_count The number of worker.
+		*/
+		WorkerCommandPool(const VulkanContext&, uint32_t);
+
+		WorkerCommandPool(const WorkerCommandPool&) = delete;
+
+		WorkerCommandPool(WorkerCommandPool&&) = delete;
+
+		WorkerCommandPool& operator=(const WorkerCommandPool&) = delete;
+
+		WorkerCommandPool& operator=(WorkerCommandPool&&) = delete;
+
+		~WorkerCommandPool() = default;
+
+		/**
+		 * @brief Reset command pools of all workers for an in-flight frame.
+		 * All command buffers allocated for this frame must no longer be in use by the device.
+		 * @param frame_index The in-flight frame index.
+		*/
+		void reset(unsigned int);
+
+		/**
+		 * @brief Get a secondary command buffer in initial state, valid until the in-flight frame is reset.
+		 * It is safe to call concurrently as long as each thread uses a distinct worker index.
+		 * @param worker_index The index of the worker recording the command buffer.
+		 * @param frame_index The in-flight frame index.
+		 * @return The secondary command buffer.
+		*/
+		VkCommandBuffer allocateSecondary(uint32_t, unsigned int);
+
+		/**
+		 * @brief Reset reshape command pools of all workers.
+		 * All command buffers allocated from them must no longer be in use by the device.
+		*/
+		void resetReshape();
+
+		/**
+		 * @brief Allocate a secondary command buffer from the reshape command pool of a worker,
+		 * which is reset together with the reshape command pool of the context.
+		 * It is safe to call concurrently as long as each thread uses a distinct worker index,
+		 * and the command buffer must only be recorded by the same worker.
+		 * @param worker_index The index of the worker recording the command buffer.
+		 * @return The secondary command buffer.
+		*/
+		VulkanObject::CommandBuffer allocateReshapeSecondary(uint32_t);
+
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "ChunkCulling.hpp"
+
+#include <LearnVulkan/GeneratedTemplate/ResourcePath.hpp>
+
+#include "../Common/File.hpp"
+
+#include "../Engine/Abstraction/BufferManager.hpp"
+#include "../Engine/Abstraction/PipelineBarrier.hpp"
+#include "../Engine/Abstraction/ShaderModuleManager.hpp"
+#include "../Engine/IndirectCommand.hpp"
+#include "../Engine/StartupGraph.hpp"
+
+#include <shaderc/shaderc.h>
+
+#include <glm/mat4x4.hpp>
+
+#include <array>
+#include <string_view>
+
+using std::array, std::string_view;
+using std::ostream, std::endl;
+
+using namespace LearnVulkan;
+namespace VKO = VulkanObject;
+
+namespace {
+
+	constexpr uint32_t CullLocalSize = 64u;
+	constexpr uint32_t ViewHistoryLength = 2u;
+
+	//must match the flags in shader
+	constexpr uint32_t CullRecordViewBit = 1u << 0u,
+		CullOcclusionBit = 1u << 1u;
+
+	struct CullArgument {
+
+		VkDeviceAddress Chunk, Command, Draw,
+			CurrentView, PreviousView;
+		uint32_t ChunkCount, Transform, CullFlag,
+			DepthPyramid, DepthPyramidSampler;
+		float MinHeight, MaxHeight;
+
+	};
+
+	constexpr string_view CullCS = "/ChunkCulling.comp";
+	constexpr auto CullShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, CullCS>();
+	constexpr auto CullShaderFilename = File::batchRawStringToView(CullShaderFilenameRaw);
+
+	inline VKO::PipelineLayout createCullPipelineLayout(const VkDevice device, const array<VkDescriptorSetLayout, 2u>& ds_layout) {
+		constexpr static VkPushConstantRange cull_pc {
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0u,
+			.size = static_cast<uint32_t>(sizeof(::CullArgument))
+		};
+		return VKO::createPipelineLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = static_cast<uint32_t>(ds_layout.size()),
+			.pSetLayouts = ds_layout.data(),
+			.pushConstantRangeCount = 1u,
+			.pPushConstantRanges = &cull_pc
+		});
+	}
+
+	VKO::Pipeline createCullPipeline(const VkDevice device, const VkPipelineCache cache, const VkPipelineLayout layout, ostream& out) {
+		const StartupGraph::Step step("Pipeline creation");
+		out << "Compiling chunk culling shader" << endl;
+
+		constexpr static shaderc_shader_kind compute_shader = shaderc_compute_shader;
+		const ShaderModuleManager::ShaderBatchCompilationInfo cull_info {
+			.Device = device,
+			.ShaderFilename = CullShaderFilename.data(),
+			.ShaderKind = &compute_shader
+		};
+		const auto cull_shader_gen = ShaderModuleManager::batchShaderCompilation<1u>(&cull_info, &out);
+
+		constexpr static VkSpecializationMapEntry local_size_entry {
+			.constantID = 0u,
+			.offset = 0u,
+			.size = sizeof(::CullLocalSize)
+		};
+		const VkSpecializationInfo spec_info {
+			.mapEntryCount = 1u,
+			.pMapEntries = &local_size_entry,
+			.dataSize = sizeof(::CullLocalSize),
+			.pData = &::CullLocalSize
+		};
+		VkPipelineShaderStageCreateInfo cull_stage = cull_shader_gen.promise().ShaderStage.front();
+		cull_stage.pSpecializationInfo = &spec_info;
+
+		return VKO::createComputePipeline(device, cache, {
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+#ifndef NDEBUG
+			| VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT
+#endif
+			,
+			.stage = cull_stage,
+			.layout = layout
+		});
+	}
+
+}
+
+ChunkCulling::ChunkCulling(const VulkanContext& ctx, const VkDescriptorSetLayout camera_layout, const VkDescriptorSetLayout heap_layout,
+	BufferArena& arena, ostream& msg) : Context(&ctx),
+	PipelineLayout(::createCullPipelineLayout(ctx.Device, { camera_layout, heap_layout })),
+	Pipeline(::createCullPipeline(ctx.Device, ctx.PipelineCache, this->PipelineLayout, msg)),
+	ViewHistory(arena.allocate(sizeof(glm::mat4) * ::ViewHistoryLength)) {
+
+}
+
+void ChunkCulling::record(const VkCommandBuffer cmd, const CameraInterface& camera, const CullInfo& cull_info) const {
+	const auto [geometry, frame_index, frame_count, transform, min_height, max_height, record_view, occluder] = cull_info;
+	const GeometryData::CulledDrawInfo draw = geometry->culledDraw(frame_index);
+	const VkDeviceSize draw_size = draw.CommandOffset - draw.CountOffset
+		+ sizeof(IndirectCommand::VkDrawIndexedIndirectCommand) * draw.MaxCount;
+
+	const BufferArena::Range& history = this->ViewHistory;
+	const VkDeviceSize current_view = sizeof(glm::mat4) * (frame_count % ::ViewHistoryLength),
+		previous_view = sizeof(glm::mat4) * ((frame_count + ::ViewHistoryLength - 1u) % ::ViewHistoryLength);
+
+	vkCmdFillBuffer(cmd, draw.Buffer, draw.CountOffset, sizeof(uint32_t), 0u);
+	{
+		PipelineBarrier<0u, 2u, 0u> barrier;
+		barrier.addBufferBarrier({
+			VK_PIPELINE_STAGE_2_CLEAR_BIT,
+			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		}, { }, draw.Buffer, draw.CountOffset, draw_size);
+		//view is written by culling in one frame and read in the next
+		barrier.addBufferBarrier({
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		}, { }, history.Buffer, history.Offset, history.Size);
+		barrier.record(cmd);
+	}
+
+	/*************
+	 * Dispatch
+	 ************/
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->Pipeline);
+	{
+		constexpr static auto ds_idx = array { 0u, 1u };
+		const auto ds_offset = array {
+			camera.descriptorBufferOffset(frame_index),
+			VkDeviceSize { 0 }
+		};
+		vkCmdSetDescriptorBufferOffsetsEXT(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->PipelineLayout, 0u,
+			static_cast<uint32_t>(ds_idx.size()), ds_idx.data(), ds_offset.data());
+	}
+
+	//attribute offsets are from the beginning of the buffer
+	const GeometryData::AttributeInfo& attr_info = geometry->attributeInfo();
+	const VkDeviceAddress geometry_addr = BufferManager::addressOf(this->Context->Device, geometry->buffer());
+	const ::CullArgument cull_arg {
+		.Chunk = geometry_addr + attr_info.Offset.Chunk,
+		.Command = draw.CommandAddress,
+		.Draw = draw.CountAddress,
+		.CurrentView = history.Address + current_view,
+		.PreviousView = history.Address + previous_view,
+		.ChunkCount = attr_info.Count.Chunk,
+		.Transform = transform,
+		.CullFlag = (record_view ? ::CullRecordViewBit : 0u) | (occluder ? ::CullOcclusionBit : 0u),
+		.DepthPyramid = occluder ? occluder->imageHeapIndex() : 0u,
+		.DepthPyramidSampler = occluder ? occluder->samplerHeapIndex() : 0u,
+		.MinHeight = min_height,
+		.MaxHeight = max_height
+	};
+	vkCmdPushConstants(cmd, this->PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0u, sizeof(cull_arg), &cull_arg);
+	vkCmdDispatch(cmd, (attr_info.Count.Chunk + ::CullLocalSize - 1u) / ::CullLocalSize, 1u, 1u);
+
+	PipelineBarrier<0u, 1u, 0u> barrier;
+	barrier.addBufferBarrier({
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+		VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT
+	}, { }, draw.Buffer, draw.CountOffset, draw_size);
+	barrier.record(cmd);
+}
\ No newline at end of file
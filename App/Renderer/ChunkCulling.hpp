@@ -0,0 +1,94 @@
+#pragma once
+
+#include "GeometryData.hpp"
+
+#include "../Engine/BufferArena.hpp"
+#include "../Engine/CameraInterface.hpp"
+#include "../Engine/DepthPyramid.hpp"
+#include "../Engine/VulkanContext.hpp"
+
+#include "../Common/VulkanObject.hpp"
+
+#include <ostream>
+#include <cstdint>
+
+namespace LearnVulkan {
+
+	/**
+	 * @brief Cull chunks of a geometry on the device, and compact draw commands of visible chunks for indirect count draw.
+	 * Chunks are tested against side planes of the view frustum,
+	 * and optionally against a depth pyramid built from depth of the last frame.
+	 * The projection view of the last frame is kept by the culler itself,
+	 * so exactly one geometry should record view every frame for occlusion test of the next frame to be valid.
+	*/
+	class ChunkCulling {
+	public:
+
+		/**
+		 * @brief Information to cull chunks of a geometry.
+		*/
+		struct CullInfo {
+
+			const GeometryData* Geometry;/**< Culled draw commands are written to this geometry. */
+			unsigned int FrameIndex;
+			uint64_t FrameCount;/**< The number of frame drawn before the current one, which selects the slot of view history. */
+
+			uint32_t Transform;/**< Index into the descriptor heap of a storage buffer beginning with the model matrix. */
+			//The range of displacement in plane space along vertical axis, added to the bound of every chunk.
+			float MinHeight, MaxHeight;
+
+			bool RecordView;/**< Save the current projection view for occlusion test of the next frame. */
+			/**
+			 * @brief The depth pyramid built from depth of the last frame, or null to disable occlusion test.
+			 * The pyramid must be built in the current frame, and the last frame must have recorded view.
+			*/
+			const DepthPyramid* Occluder = nullptr;
+
+		};
+
+	private:
+
+		const VulkanContext* const Context;
+
+		const VulkanObject::PipelineLayout PipelineLayout;
+		VulkanObject::Pipeline Pipeline;
+
+		//Projection view matrix of the current and the last frame, alternating every frame.
+		//Accesses from different frames are ordered on the rendering queue, regardless of the number of frame in flight.
+		const BufferArena::Range ViewHistory;
+
+	public:
+
+		/**
+		 * @brief Create a chunk culler.
+		 * @param ctx The context. The context is retained and must remain valid until the culler is destroyed.
+		 * @param camera_layout The camera descriptor set layout.
+		 * @param heap_layout The descriptor heap set layout.
+		 * @param arena The arena where view history is allocated from.
+		 * @param msg A stream to receive diagnostic messages.
+		*/
+		ChunkCulling(const VulkanContext&, VkDescriptorSetLayout, VkDescriptorSetLayout, BufferArena&, std::ostream&);
+
+		ChunkCulling(const ChunkCulling&) = delete;
+
+		ChunkCulling(ChunkCulling&&) = delete;
+
+		ChunkCulling& operator=(const ChunkCulling&) = delete;
+
+		ChunkCulling& operator=(ChunkCulling&&) = delete;
+
+		~ChunkCulling() = default;
+
+		/**
+		 * @brief Record culling of all chunks of a geometry, and make culled draw commands visible to indirect draw.
+		 * Descriptor buffers of camera and descriptor heap must have been bound to binding 0 and 1 respectively,
+		 * the descriptor buffer offsets for compute pipeline are set by the culler.
+		 * @param cmd The command buffer, outside of any rendering.
+		 * @param camera The camera.
+		 * @param cull_info The cull info.
+		*/
+		void record(VkCommandBuffer, const CameraInterface&, const CullInfo&) const;
+
+	};
+
+}
\ No newline at end of file
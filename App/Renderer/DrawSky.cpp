@@ -11,16 +11,21 @@
 #include "../Engine/Abstraction/SemaphoreManager.hpp"
 #include "../Engine/Abstraction/ShaderModuleManager.hpp"
 #include "../Engine/IndirectCommand.hpp"
+#include "../Engine/StartupGraph.hpp"
 
 #include <shaderc/shaderc.h>
 
 #include <array>
+#include <algorithm>
+#include <span>
 #include <string_view>
 #include <numeric>
 
 #include <cstring>
 
-using std::array, std::string_view;
+#include <glm/geometric.hpp>
+
+using std::array, std::span, std::string_view;
 using std::ostream, std::endl;
 
 using namespace LearnVulkan;
@@ -35,6 +40,23 @@ namespace {
 		0u
 	};
 
+	struct SkyPushConstant {
+
+		uint32_t SkyBoxImage, SkyBoxSampler;
+
+	};
+
+	struct AtmospherePushConstant {
+
+		glm::vec3 SunDirection;
+		float SunIntensity;
+
+	};
+
+	//Baked sky is sampled with filtering, which needs no more precision than half float.
+	constexpr VkFormat AtmosphereFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+	constexpr uint32_t AtmosphereGroupSize = 8u, CubemapFaceCount = 6u;
+
 	/*****************
 	 * Shader
 	 ****************/
@@ -45,6 +67,10 @@ namespace {
 	constexpr auto SkyShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, SkyVS, SkyFS>();
 	constexpr auto SkyShaderFilename = File::batchRawStringToView(SkyShaderFilenameRaw);
 
+	constexpr string_view AtmosphereCS = "/SkyAtmosphere.comp";
+	constexpr auto AtmosphereShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, AtmosphereCS>();
+	constexpr auto AtmosphereShaderFilename = File::batchRawStringToView(AtmosphereShaderFilenameRaw);
+
 	/**************
 	 * Setup
 	 *************/
@@ -59,43 +85,38 @@ namespace {
 		return ShaderModuleManager::batchShaderCompilation<SkyShaderKind.size()>(&sky_info, &msg);
 	}
 
-	inline VKO::DescriptorSetLayout createSkyDescriptorSetLayout(const VkDevice device) {
-		constexpr static VkDescriptorSetLayoutBinding sky_binding {
-			.binding = 0u,
-			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.descriptorCount = 1u,
-			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
-		};
-		return VKO::createDescriptorSetLayout(device, {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT,
-			.bindingCount = 1u,
-			.pBindings = &sky_binding
-		});
-	}
-
 	template<size_t LayoutCount>
 	inline VKO::PipelineLayout createSkyPipelineLayout(const VkDevice device,
 		const array<VkDescriptorSetLayout, LayoutCount>& layout) {
+		constexpr static VkPushConstantRange sky_pc {
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.offset = 0u,
+			.size = static_cast<uint32_t>(sizeof(::SkyPushConstant))
+		};
 		return VKO::createPipelineLayout(device, {
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 			.setLayoutCount = static_cast<uint32_t>(LayoutCount),
-			.pSetLayouts = layout.data()
+			.pSetLayouts = layout.data(),
+			.pushConstantRangeCount = 1u,
+			.pPushConstantRanges = &sky_pc
 		});
 	}
 
-	VKO::Pipeline createSkyPipeline(const VkDevice device, const VkPipelineLayout layout,
+	PipelineManager::GraphicsPipelineLibrary::LinkedPipeline createSkyPipeline(const VkDevice device,
+		PipelineManager::GraphicsPipelineLibrary& library, const VkPipelineLayout layout,
 		ostream& msg, const DrawSky::DrawFormat& format) {
+		const StartupGraph::Step step("Pipeline creation");
 		const auto sky_shader_gen = compileSkyShader(device, msg);
 
-		const auto [colour_format, depth_format, sample] = format;
+		const auto [colour_format, depth_format, sample, view_mask] = format;
 		const VkPipelineRenderingCreateInfo sky_rendering {
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+			.viewMask = view_mask,
 			.colorAttachmentCount = 1u,
 			.pColorAttachmentFormats = &colour_format,
 			.depthAttachmentFormat = depth_format
 		};
-		return PipelineManager::createSimpleGraphicsPipeline(device, layout, {
+		return library.createPipeline(layout, {
 			.ShaderStage = sky_shader_gen.promise().ShaderStage,
 			.Rendering = &sky_rendering,
 			.PrimitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
@@ -111,10 +132,65 @@ namespace {
 		});
 	}
 
+	inline VKO::DescriptorSetLayout createAtmosphereDescriptorSetLayout(const VkDevice device) {
+		constexpr static VkDescriptorSetLayoutBinding cubemap_binding {
+			.binding = 0u,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.descriptorCount = 1u,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+		};
+		return VKO::createDescriptorSetLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT | VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR,
+			.bindingCount = 1u,
+			.pBindings = &cubemap_binding
+		});
+	}
+
+	inline VKO::PipelineLayout createAtmospherePipelineLayout(const VkDevice device, const VkDescriptorSetLayout ds_layout) {
+		constexpr static VkPushConstantRange atmosphere_pc {
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0u,
+			.size = static_cast<uint32_t>(sizeof(::AtmospherePushConstant))
+		};
+		return VKO::createPipelineLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = 1u,
+			.pSetLayouts = &ds_layout,
+			.pushConstantRangeCount = 1u,
+			.pPushConstantRanges = &atmosphere_pc
+		});
+	}
+
+	VKO::Pipeline createAtmospherePipeline(const VkDevice device, const VkPipelineCache cache, const VkPipelineLayout layout,
+		ostream& msg) {
+		const StartupGraph::Step step("Pipeline creation");
+		msg << "Compiling sky atmosphere shader" << endl;
+
+		constexpr static shaderc_shader_kind compute_shader = shaderc_compute_shader;
+		const ShaderModuleManager::ShaderBatchCompilationInfo atmosphere_info {
+			.Device = device,
+			.ShaderFilename = ::AtmosphereShaderFilename.data(),
+			.ShaderKind = &compute_shader
+		};
+		const auto atmosphere_shader_gen = ShaderModuleManager::batchShaderCompilation<1u>(&atmosphere_info, &msg);
+
+		return VKO::createComputePipeline(device, cache, {
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+#ifndef NDEBUG
+			| VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT
+#endif
+			,
+			.stage = atmosphere_shader_gen.promise().ShaderStage.front(),
+			.layout = layout
+		});
+	}
+
 	inline VKO::BufferAllocation createSkyIndirectCommandBuffer(const VkDevice device, const VmaAllocator allocator) {
 		return BufferManager::createDeviceBuffer({
 			device, allocator, sizeof(::SkyIndirect)
-		}, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		}, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VKO::AllocationCategory::Geometry);
 	}
 
 }
@@ -122,59 +198,34 @@ namespace {
 DrawSky::DrawSky(const VulkanContext& ctx, const SkyCreateInfo& sky_info) :
 	SkyIndirectCommand(createSkyIndirectCommandBuffer(ctx.Device, ctx.Allocator)),
 
-	SkyShaderLayout(createSkyDescriptorSetLayout(this->getDevice())),
 	PipelineLayout(createSkyPipelineLayout(this->getDevice(), array {
 		sky_info.CameraDescriptorSetLayout,
-		*this->SkyShaderLayout
+		sky_info.Heap->descriptorSetLayout()
 	})),
-	Pipeline(createSkyPipeline(this->getDevice(), this->PipelineLayout, *sky_info.DebugMessage, sky_info.OutputFormat)),
-	
-	SkyCommand(std::get<CommandBufferManager::InFlightCommandBufferArray>(
-		CommandBufferManager::allocateCommandBuffer(ctx, VK_COMMAND_BUFFER_LEVEL_SECONDARY,
-			CommandBufferManager::CommandBufferType::InFlight)
-	)) {
+	Pipeline(createSkyPipeline(this->getDevice(), *sky_info.PipelineLibrary, this->PipelineLayout,
+		*sky_info.DebugMessage, sky_info.OutputFormat)),
+	ViewMask(sky_info.OutputFormat.ViewMask),
+
+	ProfileRegion(sky_info.Profiler->registerRegion("Sky", true)) {
 	{
-		const VKO::Semaphore sema = SemaphoreManager::createTimelineSemaphore(this->getDevice(), 0ull);
-		const VKO::CommandBuffer cmd = VKO::allocateCommandBuffer(this->getDevice(), {
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-			.commandPool = ctx.CommandPool.Transient,
-			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			.commandBufferCount = 1u
-		});
-		CommandBufferManager::beginOneTimeSubmit(cmd);
+		StagingUploader& uploader = *sky_info.Uploader;
 
 		/****************************
 		 * Prepare indirect command
 		 ***************************/
-		const VKO::BufferAllocation indirect_staging = BufferManager::createStagingBuffer({
-			this->getDevice(), ctx.Allocator, sizeof(::SkyIndirect)
-		}, BufferManager::HostAccessPattern::Sequential);
-
-		VKO::MappedAllocation indirect_data = VKO::mapAllocation<IndirectCommand::VkDrawIndirectCommand>(ctx.Allocator, indirect_staging.first);
-		*indirect_data = ::SkyIndirect;
-		CHECK_VULKAN_ERROR(vmaFlushAllocation(ctx.Allocator, indirect_staging.first, 0ull, VK_WHOLE_SIZE));
-		indirect_data.reset();
-
-		BufferManager::recordCopyBuffer(indirect_staging.second, this->SkyIndirectCommand.second, cmd, sizeof(::SkyIndirect));
+		uploader.upload({
+			.Destination = this->SkyIndirectCommand.second,
+			.Target = { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT }
+		}, std::as_bytes(span(&::SkyIndirect, 1u)));
 
 		/***************************
-		 * Prepare cubemap texture
+		 * Prepare sky box
 		 **************************/
-		this->SkyBox.Image = ImageManager::createImageFromReadResult(cmd, *sky_info.Cubemap, {
-			.Device = this->getDevice(),
-			.Allocator = ctx.Allocator,
-			.Flag = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
-			.Level = 1u,
-			.Usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
-		});
-		this->SkyBox.ImageView = ImageManager::createFullImageView({
-			.Device = this->getDevice(),
-			.Image = this->SkyBox.Image.second,
-			.ViewType = VK_IMAGE_VIEW_TYPE_CUBE,
-			.Format = sky_info.Cubemap->Format,
-			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
-		});
+		if (sky_info.Atmosphere) {
+			this->createSkyBoxFromAtmosphere(ctx, *sky_info.Atmosphere, *sky_info.DebugMessage);
+		} else {
+			this->createSkyBoxFromTexture(ctx, *sky_info.Cubemap, uploader);
+		}
 		this->SkyBox.Sampler = VKO::createSampler(this->getDevice(), {
 			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
 			.magFilter = VK_FILTER_LINEAR,
@@ -186,68 +237,181 @@ DrawSky::DrawSky(const VulkanContext& ctx, const SkyCreateInfo& sky_info) :
 			.maxLod = VK_LOD_CLAMP_NONE
 		});
 
-		PipelineBarrier<0u, 1u, 1u> barrier;
-		barrier.addBufferBarrier({
-			VK_PIPELINE_STAGE_2_COPY_BIT,
-			VK_ACCESS_2_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
-			VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT
-		}, this->SkyIndirectCommand.second);
+		//nothing else needs to be done on the rendering queue, just wait for the upload
+		const StartupGraph::Step step("Device wait");
+		uploader.wait(uploader.flush());
+	}
+	{
+		DescriptorHeap& heap = *sky_info.Heap;
+		this->SkyBox.ImageSlot = heap.addSampledImage(this->SkyBox.ImageView);
+		this->SkyBox.SamplerSlot = heap.addSampler(this->SkyBox.Sampler);
+	}
+}
+
+inline VkDevice DrawSky::getDevice() const noexcept {
+	return this->SkyIndirectCommand.second->get_deleter().Device;
+}
+
+void DrawSky::createSkyBoxFromTexture(const VulkanContext& ctx, const ImageManager::ImageReadResult& cubemap,
+	StagingUploader& uploader) {
+	const VkImageUsageFlags usage = uploader.imageUsage(cubemap.Format, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, VK_IMAGE_USAGE_SAMPLED_BIT);
+	this->SkyBox.Image = ImageManager::createImage(cubemap, {
+		.Device = this->getDevice(),
+		.Allocator = ctx.Allocator,
+		.Flag = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
+		//mip-maps are only used if provided by a pre-compressed cubemap
+		.Level = static_cast<uint32_t>(cubemap.Level.size()),
+		.Usage = usage,
+		.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+	});
+	const auto [w, h] = cubemap.Extent;
+	uploader.upload({
+		.Destination = this->SkyBox.Image.second,
+		.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+		.Extent = { w, h, 1u },
+		.Layer = cubemap.Layer,
+		.Level = cubemap.Level,
+		.TargetLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		.Target = { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT },
+		.Usage = usage
+	}, cubemap.Pixel);
+	this->SkyBox.ImageView = ImageManager::createFullImageView({
+		.Device = this->getDevice(),
+		.Image = this->SkyBox.Image.second,
+		.ViewType = VK_IMAGE_VIEW_TYPE_CUBE,
+		.Format = cubemap.Format,
+		.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+	});
+}
+
+void DrawSky::createSkyBoxFromAtmosphere(const VulkanContext& ctx, const AtmosphereInfo& atmosphere_info, ostream& msg) {
+	const VkDevice device = this->getDevice();
+	const auto [sun_direction, sun_intensity, extent] = atmosphere_info;
+
+	/******************
+	 * Prepare memory
+	 *****************/
+	this->SkyBox.Image = ImageManager::createImage({
+		.Device = device,
+		.Allocator = ctx.Allocator,
+		.Category = VKO::AllocationCategory::Texture,
+
+		.Flag = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
+		.ImageType = VK_IMAGE_TYPE_2D,
+		.Format = ::AtmosphereFormat,
+		.Extent = { extent, extent, 1u },
+		.Layer = ::CubemapFaceCount,
+		.Usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+	});
+	this->SkyBox.ImageView = ImageManager::createFullImageView({
+		.Device = device,
+		.Image = this->SkyBox.Image.second,
+		.ViewType = VK_IMAGE_VIEW_TYPE_CUBE,
+		.Format = ::AtmosphereFormat,
+		.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+	});
+	//cube view cannot be used as storage image, so faces are written as layers
+	const VKO::ImageView face_view = ImageManager::createFullImageView({
+		.Device = device,
+		.Image = this->SkyBox.Image.second,
+		.ViewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+		.Format = ::AtmosphereFormat,
+		.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+	});
+
+	//the bake only runs once, so nothing of the pipeline is retained
+	const VKO::DescriptorSetLayout ds_layout = ::createAtmosphereDescriptorSetLayout(device);
+	const VKO::PipelineLayout pipeline_layout = ::createAtmospherePipelineLayout(device, ds_layout);
+	const VKO::Pipeline pipeline = ::createAtmospherePipeline(device, ctx.PipelineCache, pipeline_layout, msg);
+
+	const VKO::Semaphore bake_sema = SemaphoreManager::createTimelineSemaphore(device, 0ull);
+	const VKO::CommandBuffer bake_cmd = VKO::allocateCommandBuffer(device, {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = ctx.CommandPool.Transient,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1u
+	});
+	CommandBufferManager::beginOneTimeSubmit(bake_cmd);
+
+	/*************
+	 * Dispatch
+	 ************/
+	{
+		PipelineBarrier<0u, 0u, 1u> barrier;
 		barrier.addImageBarrier({
-			VK_PIPELINE_STAGE_2_COPY_BIT,
-			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_NONE,
+			VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		}, {
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL
+		}, this->SkyBox.Image.second, ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT));
+		barrier.record(bake_cmd);
+	}
+	vkCmdBindPipeline(bake_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+	const VkDescriptorImageInfo cubemap_info {
+		.imageView = face_view,
+		.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+	};
+	const VkWriteDescriptorSet cubemap_write {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstBinding = 0u,
+		.dstArrayElement = 0u,
+		.descriptorCount = 1u,
+		.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		.pImageInfo = &cubemap_info
+	};
+	vkCmdPushDescriptorSetKHR(bake_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout, 0u, 1u, &cubemap_write);
+
+	const ::AtmospherePushConstant atmosphere_pc {
+		.SunDirection = glm::normalize(sun_direction),
+		.SunIntensity = sun_intensity
+	};
+	vkCmdPushConstants(bake_cmd, pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0u, sizeof(atmosphere_pc), &atmosphere_pc);
+
+	const uint32_t group_count = (extent + ::AtmosphereGroupSize - 1u) / ::AtmosphereGroupSize;
+	vkCmdDispatch(bake_cmd, group_count, group_count, ::CubemapFaceCount);
+
+	/**************
+	 * Finalise
+	 *************/
+	{
+		PipelineBarrier<0u, 0u, 1u> barrier;
+		barrier.addImageBarrier({
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
 			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
 			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
 		}, {
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_GENERAL,
 			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 		}, this->SkyBox.Image.second, ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT));
-		barrier.record(cmd);
-
-		CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
-		CommandBufferManager::submit<1u, 0u, 1u>({ this->getDevice(), ctx.Queue.Render }, { cmd }, {{ }},
-			{{{ sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}});
-		SemaphoreManager::wait<1u>(this->getDevice(), { }, {{{ sema, 1ull }}});
+		barrier.record(bake_cmd);
 	}
-	{
-		const auto sky_ds_layout = array { *this->SkyShaderLayout };
-		this->SkyShaderDescriptorBuffer = DescriptorBufferManager(ctx, sky_ds_layout,
-			VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT);
-
-		const VkDescriptorImageInfo skybox_image_info {
-			.sampler = this->SkyBox.Sampler,
-			.imageView = this->SkyBox.ImageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-
-		using DU = DescriptorBufferManager::DescriptorUpdater;
-		const DU sky_ds_updater = this->SkyShaderDescriptorBuffer.createUpdater(ctx);
-		sky_ds_updater.update({
-			.SetLayout = this->SkyShaderLayout,
-			.SetIndex = 0u,
-			.GetInfo = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { .pCombinedImageSampler = &skybox_image_info } }
-		});
-	}
-}
+	CHECK_VULKAN_ERROR(vkEndCommandBuffer(bake_cmd));
 
-inline VkDevice DrawSky::getDevice() const noexcept {
-	return this->SkyIndirectCommand.second->get_deleter().Device;
+	CommandBufferManager::submit<1u, 0u, 1u>({ device, ctx.Queue.Render }, { bake_cmd }, {{ }},
+		{{{ bake_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}}, VK_NULL_HANDLE);
+	const StartupGraph::Step step("Device wait");
+	SemaphoreManager::wait<1u>(device, { }, {{{ bake_sema, 1ull }}});
 }
 
-VkDescriptorImageInfo DrawSky::skyImageDescriptor() const noexcept {
+DrawSky::SkyBoxHeapIndex DrawSky::skyBoxHeapIndex() const noexcept {
 	return {
-		.sampler = this->SkyBox.Sampler,
-		.imageView = this->SkyBox.ImageView,
-		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		.Image = this->SkyBox.ImageSlot.index(),
+		.Sampler = this->SkyBox.SamplerSlot.index()
 	};
 }
 
-RendererInterface::DrawResult DrawSky::draw(const DrawInfo& draw_info) const {
-	const auto [inherited_draw_info, fbo_input, depth_layout] = draw_info;
-	const auto& [ctx, camera, delta_time, frame_idx, vp, draw_area, resolve_img, resolve_img_view] = *inherited_draw_info;
+void DrawSky::recordSky(const VkCommandBuffer cmd, const DrawInfo& draw_info) const {
+	const auto [inherited_draw_info, fbo_input, depth_layout, worker_idx] = draw_info;
+	const auto& [ctx, camera, heap, profiler, job, worker_cmd, frame_memory, delta_time, frame_idx, vp, draw_area, resolve_img, resolve_img_view] =
+		*inherited_draw_info;
 
-	const VkCommandBuffer cmd = this->SkyCommand[frame_idx];
-	CommandBufferManager::beginOneTimeSubmitSecondary(cmd);
+	CommandBufferManager::beginReusableSecondary(cmd);
+	profiler->beginRegion(cmd, frame_idx, this->ProfileRegion);
 
 	/******************
 	 * Dependencies
@@ -255,11 +419,11 @@ RendererInterface::DrawResult DrawSky::draw(const DrawInfo& draw_info) const {
 	const FramebufferManager::PrepareFramebufferInfo prepare_info {
 		.DepthLayout = depth_layout
 	};
+	//dependencies of the input framebuffer and the resolve image are issued by the caller
 	const FramebufferManager::SubpassOutputDependencyIssueInfo dep_issue_info {
 		.PrepareInfo = &prepare_info,
 		.ResolveOutput = resolve_img
 	};
-	FramebufferManager::issueSubpassOutputDependency(cmd, *fbo_input, dep_issue_info);
 
 	/******************
 	 * Rendering
@@ -267,6 +431,7 @@ RendererInterface::DrawResult DrawSky::draw(const DrawInfo& draw_info) const {
 	FramebufferManager::beginInitialRendering(cmd, *fbo_input, {
 		.DependencyInfo = &dep_issue_info,
 		.RenderArea = draw_area,
+		.ViewMask = this->ViewMask,
 		.ResolveOutput = {
 			.Colour = resolve_img_view
 		},
@@ -276,7 +441,7 @@ RendererInterface::DrawResult DrawSky::draw(const DrawInfo& draw_info) const {
 		}
 	});
 
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->Pipeline);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->Pipeline.get());
 	vkCmdSetScissor(cmd, 0u, 1u, &draw_area);
 	vkCmdSetViewport(cmd, 0u, 1u, &vp);
 
@@ -285,31 +450,56 @@ RendererInterface::DrawResult DrawSky::draw(const DrawInfo& draw_info) const {
 	 **************/
 	const auto ds = array {
 		camera->descriptorBufferBindingInfo(),
-		VkDescriptorBufferBindingInfoEXT {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
-			.address = BufferManager::addressOf(this->getDevice(), this->SkyShaderDescriptorBuffer.buffer()),
-			.usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT
-		}
+		heap->descriptorBufferBindingInfo()
 	};
 
 	array<uint32_t, ds.size()> ds_idx;
 	std::iota(ds_idx.begin(), ds_idx.end(), 0u);
 	const auto offset = array {
 		camera->descriptorBufferOffset(frame_idx),
-		this->SkyShaderDescriptorBuffer.offset(0u)
+		VkDeviceSize { 0 }
 	};
 
 	vkCmdBindDescriptorBuffersEXT(cmd, static_cast<uint32_t>(ds.size()), ds.data());
 	vkCmdSetDescriptorBufferOffsetsEXT(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->PipelineLayout,
 		0u, static_cast<uint32_t>(ds.size()), ds_idx.data(), offset.data());
 
+	const ::SkyPushConstant sky_pc {
+		.SkyBoxImage = this->SkyBox.ImageSlot.index(),
+		.SkyBoxSampler = this->SkyBox.SamplerSlot.index()
+	};
+	vkCmdPushConstants(cmd, this->PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0u, sizeof(sky_pc), &sky_pc);
+
 	/**************
 	 * Draw
 	 **************/
 	vkCmdDrawIndirect(cmd, this->SkyIndirectCommand.second, 0ull, 1u, 0u);
 	vkCmdEndRendering(cmd);
 
+	profiler->endRegion(cmd, frame_idx, this->ProfileRegion);
+
 	CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
+}
+
+void DrawSky::reshape() noexcept {
+	//command buffers are returned to the reshape pool, which has been reset by the engine
+	this->DrawCache.clear();
+}
+
+RendererInterface::DrawResult DrawSky::draw(const DrawInfo& draw_info) {
+	const RendererInterface::DrawInfo& inherited_draw_info = *draw_info.InheritedDrawInfo;
+	const VkImageView output = inherited_draw_info.PresentImageView;
+
+	//there are only as many outputs as swap chain images, which are few enough to be searched linearly
+	auto cache = std::ranges::find(this->DrawCache, output, &CachedDraw::Output);
+	if (cache == this->DrawCache.end()) {
+		cache = this->DrawCache.emplace(cache, CachedDraw { .Output = output });
+	}
+	VKO::CommandBuffer& cmd = cache->Command[inherited_draw_info.FrameInFlightIndex];
+	if (!cmd) {
+		cmd = inherited_draw_info.WorkerCommand->allocateReshapeSecondary(draw_info.WorkerIndex);
+		this->recordSky(cmd, draw_info);
+	}
 	return {
 		.DrawCommand = cmd,
 		.WaitStage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT
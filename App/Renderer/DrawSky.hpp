@@ -1,24 +1,36 @@
 #pragma once
 
 #include "../Engine/CameraInterface.hpp"
+#include "../Engine/DescriptorHeap.hpp"
+#include "../Engine/EngineSetting.hpp"
 #include "../Engine/RendererInterface.hpp"
+#include "../Engine/StagingUploader.hpp"
+#include "../Engine/TimestampProfiler.hpp"
 #include "../Engine/VulkanContext.hpp"
 
 #include "../Engine/Abstraction/CommandBufferManager.hpp"
-#include "../Engine/Abstraction/DescriptorBufferManager.hpp"
 #include "../Engine/Abstraction/FramebufferManager.hpp"
 #include "../Engine/Abstraction/ImageManager.hpp"
+#include "../Engine/Abstraction/PipelineManager.hpp"
 
 #include "../Common/VulkanObject.hpp"
 
+#include <glm/vec3.hpp>
+
 #include <ostream>
+#include <array>
+#include <vector>
+
+#include <cstdint>
 
 namespace LearnVulkan {
 
 	/**
-	 * @brief Draw a sky using a cubemap texture.
+	 * @brief Draw a sky using a cubemap, either from a texture or baked from a procedural atmosphere.
+	 * Sky is drawn at the far plane after all opaque geometries, such that covered pixels are rejected by early depth test.
 	 * This renderer does not allocate a framebuffer (thus does not own any rendering memory),
 	 * hence it should be used with a primary renderer.
+	 * Nothing drawn by the sky changes between reshapes, so draw commands are recorded once and replayed every frame.
 	*/
 	class DrawSky final {
 	public:
@@ -30,6 +42,20 @@ namespace LearnVulkan {
 
 			VkFormat ColourFormat, DepthFormat;
 			VkSampleCountFlagBits Sample;
+			//Draw every view of this mask with multiview into the layer of the same index, or zero if not using multiview.
+			//The input framebuffer and the resolve image should have a layer for each view.
+			uint32_t ViewMask = 0u;
+
+		};
+
+		/**
+		 * @brief Information to bake a sky from single scattering of sunlight in a planetary atmosphere.
+		*/
+		struct AtmosphereInfo {
+
+			glm::vec3 SunDirection;/**< From the ground towards the sun, not necessarily normalised. */
+			float SunIntensity = 20.0f;
+			uint32_t Extent = 128u;/**< The width and height of each face of the baked cubemap. */
 
 		};
 
@@ -39,10 +65,17 @@ namespace LearnVulkan {
 		struct SkyCreateInfo {
 
 			VkDescriptorSetLayout CameraDescriptorSetLayout;
+			DescriptorHeap* Heap;/**< The sky box is added to the heap. */
 			DrawFormat OutputFormat;
 
 			const ImageManager::ImageReadResult* Cubemap;/**< The cubemap texture containing the sky to be drawn. */
+			//Set to bake the sky once into a small cubemap, in place of the cubemap texture which is then ignored.
+			//Sky is only as detailed as the atmosphere model, but is much cheaper to sample than a large texture.
+			const AtmosphereInfo* Atmosphere = nullptr;
 
+			TimestampProfiler* Profiler;
+			StagingUploader* Uploader;
+			PipelineManager::GraphicsPipelineLibrary* PipelineLibrary;
 			std::ostream* DebugMessage;
 
 		};
@@ -57,12 +90,24 @@ namespace LearnVulkan {
 			//Note that sky should be the last renderer invoked in a frame,
 			//as all contents in this framebuffer become undefined after renderer finishes,
 			//and final colour will be written to the present image.
+			//The caller synchronises the framebuffer and the present image before sky is drawn.
+			//It must remain the same until the sky is reshaped.
 			const FramebufferManager::SimpleFramebuffer* InputFramebuffer;
 
 			VkImageLayout DepthLayout;
+			uint32_t WorkerIndex;/**< The worker of the job system recording the sky. */
 		
 		};
 
+		/**
+		 * @brief The indices of sky box descriptors in the descriptor heap.
+		*/
+		struct SkyBoxHeapIndex {
+
+			uint32_t Image, Sampler;
+
+		};
+
 	private:
 
 		struct {
@@ -71,19 +116,37 @@ namespace LearnVulkan {
 			VulkanObject::ImageView ImageView;
 			VulkanObject::Sampler Sampler;
 
+			DescriptorHeap::Slot ImageSlot, SamplerSlot;
+
 		} SkyBox;
 
 		const VulkanObject::BufferAllocation SkyIndirectCommand;
 
-		const VulkanObject::DescriptorSetLayout SkyShaderLayout;
 		const VulkanObject::PipelineLayout PipelineLayout;
-		const VulkanObject::Pipeline Pipeline;
+		const PipelineManager::GraphicsPipelineLibrary::LinkedPipeline Pipeline;
+		const uint32_t ViewMask;
+
+		const TimestampProfiler::RegionIdentifier ProfileRegion;
+
+		//Draw commands resolving to an output image, one for each in-flight frame which are recorded on first use.
+		struct CachedDraw {
+
+			VkImageView Output;
+			std::array<VulkanObject::CommandBuffer, EngineSetting::MaxFrameInFlight> Command;
 
-		const CommandBufferManager::InFlightCommandBufferArray SkyCommand;
-		DescriptorBufferManager SkyShaderDescriptorBuffer;
+		};
+		std::vector<CachedDraw> DrawCache;
 
 		VkDevice getDevice() const noexcept;
 
+		//Create the sky box from a cubemap texture.
+		void createSkyBoxFromTexture(const VulkanContext&, const ImageManager::ImageReadResult&, StagingUploader&);
+		//Create the sky box by baking the atmosphere on the device, and wait for it to complete.
+		void createSkyBoxFromAtmosphere(const VulkanContext&, const AtmosphereInfo&, std::ostream&);
+
+		//Record sky drawing to a secondary command buffer that can be replayed in every frame of the same in-flight index.
+		void recordSky(VkCommandBuffer, const DrawInfo&) const;
+
 	public:
 
 		/**
@@ -104,17 +167,25 @@ namespace LearnVulkan {
 		~DrawSky() = default;
 
 		/**
-		 * @brief Get the descriptor data of sky image.
-		 * @return The sky image descriptor.
+		 * @brief Get the indices of sky image in the descriptor heap, such that other renderers can sample from it.
+		 * @return The sky box heap index.
+		*/
+		SkyBoxHeapIndex skyBoxHeapIndex() const noexcept;
+
+		/**
+		 * @brief Discard every recorded draw command, such that they are recorded again with the new input framebuffer and extent.
+		 * This must be called whenever the primary renderer is reshaped, after the device has finished all frames in flight.
 		*/
-		VkDescriptorImageInfo skyImageDescriptor() const noexcept;
+		void reshape() noexcept;
 
 		/**
 		 * @brief Draw sky.
+		 * The draw command is recorded from the reshape command pool of the given worker the first time the output is drawn to
+		 * in an in-flight frame, hence it can be called by a job concurrently with other renderers.
 		 * @param draw_info Draw information.
-		 * @return The draw result.
+		 * @return The draw result, whose command buffer is owned by the sky renderer and remains valid until reshape.
 		*/
-		RendererInterface::DrawResult draw(const DrawInfo&) const;
+		RendererInterface::DrawResult draw(const DrawInfo&);
 	
 	};
 
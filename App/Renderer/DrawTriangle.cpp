@@ -12,18 +12,21 @@
 #include "../Engine/Abstraction/ShaderModuleManager.hpp"
 #include "../Engine/EngineSetting.hpp"
 #include "../Engine/IndirectCommand.hpp"
+#include "../Engine/StartupGraph.hpp"
 
 #include <shaderc/shaderc.h>
 
 #include <string_view>
 #include <array>
-#include <initializer_list>
+#include <span>
+#include <optional>
 #include <utility>
 #include <numeric>
-#include <ranges>
+#include <algorithm>
 
 #include <ostream>
 #include <cstddef>
+#include <cmath>
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -31,14 +34,13 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/trigonometric.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
 using glm::u8vec2;
 using glm::vec3, glm::dvec3, glm::i8vec3;
 using glm::vec4, glm::dvec4;
 using glm::mat4, glm::dmat4;
 
-using std::array, std::string_view;
+using std::array, std::span, std::string_view;
 using std::ostream, std::endl;
 
 using namespace LearnVulkan;
@@ -99,6 +101,46 @@ namespace {
 
 	} InstanceOffsetData = { -1.5f, 35.5f, glm::radians(31.5f) };
 
+	//indices are in the descriptor heap
+	struct TrianglePushConstant {
+
+		mat4 Model;
+		uint32_t InstanceOffset, SurfaceTexture, SurfaceSampler;
+		VkDeviceAddress StressInstance;/**< Compacted instances, only used by instancing stress mode. */
+
+	};
+	constexpr VkShaderStageFlags TrianglePushConstantStage = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	/*********************
+	 * Instancing stress
+	 *********************/
+	//must match the shader
+	constexpr uint32_t StressLocalSize = 64u;
+	constexpr float StressInstanceScale = 0.1f;
+	//the triangle is flat, and only rotates around vertical axis
+	constexpr float StressBoundRadius = static_cast<float>(TriangleScale * glm::root_two<double>()) * StressInstanceScale;
+
+	//xyz: position; w: rotation around vertical axis
+	using StressInstanceTransform = vec4;
+	//draw count and the total number of visible instance, followed by draw commands
+	constexpr VkDeviceSize StressCommandOffset = sizeof(uint32_t) * 2u;
+
+	struct StressGenerateArgument {
+
+		VkDeviceAddress Instance;
+		uint32_t InstanceCount, FieldWidth;
+		float Spacing;
+
+	};
+
+	struct StressCullArgument {
+
+		VkDeviceAddress Instance, Compacted, Command, Draw;
+		uint32_t InstanceCount, IndexCount;
+		float BoundRadius;
+
+	};
+
 	/*****************
 	 * Shader
 	 *****************/
@@ -108,6 +150,10 @@ namespace {
 	constexpr auto TriangleShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, TriangleVS, TriangleFS>();
 	constexpr auto TriangleShaderFilename = File::batchRawStringToView(TriangleShaderFilenameRaw);
 
+	constexpr string_view StressGenerateCS = "/DrawTriangleGenerate.comp", StressCullCS = "/DrawTriangleCull.comp";
+	constexpr auto StressShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, StressGenerateCS, StressCullCS>();
+	constexpr auto StressShaderFilename = File::batchRawStringToView(StressShaderFilenameRaw);
+
 	/***************
 	 * Setup
 	 ***************/
@@ -124,24 +170,43 @@ namespace {
 
 	template<size_t LayoutCount>
 	inline VKO::PipelineLayout createTrianglePipelineLayout(const VkDevice device, const array<VkDescriptorSetLayout, LayoutCount>& ds_layout) {
-		constexpr static VkPushConstantRange vertex_pc {
-			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		constexpr static VkPushConstantRange triangle_pc {
+			.stageFlags = ::TrianglePushConstantStage,
 			.offset = 0u,
-			.size = sizeof(mat4)
+			.size = static_cast<uint32_t>(sizeof(::TrianglePushConstant))
 		};
 		const VkPipelineLayoutCreateInfo triangle_layout {
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 			.setLayoutCount = static_cast<uint32_t>(ds_layout.size()),
 			.pSetLayouts = ds_layout.data(),
 			.pushConstantRangeCount = 1u,
-			.pPushConstantRanges = &vertex_pc
+			.pPushConstantRanges = &triangle_pc
 		};
 		return VKO::createPipelineLayout(device, triangle_layout);
 	}
 
-	VKO::Pipeline createTriangleGraphicsPipeline(const VkDevice device, const VkPipelineLayout layout, ostream& out) {
+	VKO::Pipeline createTriangleGraphicsPipeline(const VkDevice device, const VkPipelineCache cache,
+		const VkPipelineLayout layout, ostream& out, const bool stress) {
+		const StartupGraph::Step step("Pipeline creation");
 		const auto triangle_shader_gen = compileTriangleShader(device, out);
 
+		//instancing mode is specialised in vertex shader
+		const VkBool32 stress_instancing = stress ? VK_TRUE : VK_FALSE;
+		constexpr static VkSpecializationMapEntry stress_entry {
+			.constantID = 0u,
+			.offset = 0u,
+			.size = sizeof(VkBool32)
+		};
+		const VkSpecializationInfo stress_spec {
+			.mapEntryCount = 1u,
+			.pMapEntries = &stress_entry,
+			.dataSize = sizeof(stress_instancing),
+			.pData = &stress_instancing
+		};
+		array<VkPipelineShaderStageCreateInfo, TriangleShaderKind.size()> triangle_stage;
+		std::ranges::copy(triangle_shader_gen.promise().ShaderStage, triangle_stage.begin());
+		triangle_stage[0].pSpecializationInfo = &stress_spec;
+
 		////////////////////////
 		/// Vertex input state
 		////////////////////////
@@ -182,8 +247,8 @@ namespace {
 			.depthAttachmentFormat = ::DepthFormat
 		};
 
-		return PipelineManager::createSimpleGraphicsPipeline(device, layout, {
-			.ShaderStage = triangle_shader_gen.promise().ShaderStage,
+		return PipelineManager::createSimpleGraphicsPipeline(device, cache, layout, {
+			.ShaderStage = triangle_stage,
 			.VertexInputState = &triangle_vertex_input,
 			.Rendering = &triangle_rendering,
 			.PrimitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
@@ -198,37 +263,69 @@ namespace {
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT |
 			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
 			VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VKO::AllocationCategory::Geometry
 		);
 	}
 
-	inline VKO::DescriptorSetLayout createTriangleDescriptorSetLayout(const VkDevice device) {
-		const array triangle_binding = {
-			VkDescriptorSetLayoutBinding {
-				.binding = 0u,
-				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				.descriptorCount = 1u,
-				.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
-			},
-			VkDescriptorSetLayoutBinding {
-				.binding = 1u,
-				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-				.descriptorCount = 1u,
-				.stageFlags = VK_SHADER_STAGE_VERTEX_BIT
-			}
+	inline VKO::PipelineLayout createStressPipelineLayout(const VkDevice device, const span<const VkDescriptorSetLayout> ds_layout,
+		const uint32_t argument_size) {
+		const VkPushConstantRange stress_pc {
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0u,
+			.size = argument_size
+		};
+		return VKO::createPipelineLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = static_cast<uint32_t>(ds_layout.size()),
+			.pSetLayouts = ds_layout.data(),
+			.pushConstantRangeCount = 1u,
+			.pPushConstantRanges = &stress_pc
+		});
+	}
+
+	//Create the pipelines generating and culling stress instances, in this order.
+	array<VKO::Pipeline, 2u> createStressPipeline(const VkDevice device, const VkPipelineCache cache,
+		const VkPipelineLayout generate_layout, const VkPipelineLayout cull_layout, ostream& out) {
+		const StartupGraph::Step step("Pipeline creation");
+		out << "Compiling triangle instancing stress shader" << endl;
+
+		constexpr static array<shaderc_shader_kind, 2u> compute_shader = { shaderc_compute_shader, shaderc_compute_shader };
+		const ShaderModuleManager::ShaderBatchCompilationInfo stress_info {
+			.Device = device,
+			.ShaderFilename = ::StressShaderFilename.data(),
+			.ShaderKind = compute_shader.data()
 		};
-		const VkDescriptorSetLayoutCreateInfo triangle_ds_layout {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT,
-			.bindingCount = static_cast<uint32_t>(triangle_binding.size()),
-			.pBindings = triangle_binding.data()
+		const auto stress_shader_gen = ShaderModuleManager::batchShaderCompilation<StressShaderFilename.size()>(&stress_info, &out);
+		const auto& stress_stage = stress_shader_gen.promise().ShaderStage;
+
+		const auto createPipeline = [device, cache](const VkPipelineShaderStageCreateInfo& stage, const VkPipelineLayout layout) {
+			return VKO::createComputePipeline(device, cache, {
+				.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+				.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+#ifndef NDEBUG
+				| VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT
+#endif
+				,
+				.stage = stage,
+				.layout = layout
+			});
 		};
-		return VKO::createDescriptorSetLayout(device, triangle_ds_layout);
+		return { createPipeline(stress_stage[0], generate_layout), createPipeline(stress_stage[1], cull_layout) };
+	}
+
+	inline VKO::BufferAllocation createStressBuffer(const VkDevice device, const VmaAllocator allocator, const VkDeviceSize size,
+		const VkBufferUsageFlags usage) {
+		return BufferManager::createDeviceBuffer({ device, allocator, size },
+			usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			VKO::AllocationCategory::Geometry
+		);
 	}
 
 	inline VKO::BufferAllocation createTriangleInstanceOffsetBuffer(const VkDevice device, const VmaAllocator allocator) {
 		return BufferManager::createDeviceBuffer({ device, allocator, sizeof(InstanceOffsetData) },
-			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			VKO::AllocationCategory::Geometry
 		);
 	}
 
@@ -240,10 +337,9 @@ DrawTriangle::DrawTriangle(const VulkanContext& ctx, const TriangleCreateInfo& t
 	VertexBuffer(createTriangleBuffer(ctx.Device, ctx.Allocator)),
 	VertexShaderInstanceOffset(createTriangleInstanceOffsetBuffer(this->getDevice(), this->getAllocator())),
 
-	TriangleShaderLayout(createTriangleDescriptorSetLayout(this->getDevice())),
-
-	PipelineLayout(createTrianglePipelineLayout(this->getDevice(), array { triangle_info.CameraDescriptorSetLayout, *this->TriangleShaderLayout })),
-	Pipeline(createTriangleGraphicsPipeline(this->getDevice(), this->PipelineLayout, *triangle_info.DebugMessage)),
+	PipelineLayout(createTrianglePipelineLayout(this->getDevice(), array { triangle_info.CameraDescriptorSetLayout, triangle_info.Heap->descriptorSetLayout() })),
+	Pipeline(createTriangleGraphicsPipeline(this->getDevice(), ctx.PipelineCache, this->PipelineLayout, *triangle_info.DebugMessage,
+		triangle_info.Stress != nullptr)),
 
 	TriangleDrawCmd(std::get<CommandBufferManager::InFlightCommandBufferArray>(
 		CommandBufferManager::allocateCommandBuffer(ctx, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
@@ -256,77 +352,48 @@ DrawTriangle::DrawTriangle(const VulkanContext& ctx, const TriangleCreateInfo& t
 	CurrentAngle(0.0) {
 	//upload data using high performance staging buffer
 	{
-		const VKO::Semaphore copy_sema = SemaphoreManager::createTimelineSemaphore(this->getDevice(), 0ull);
-		const VKO::CommandBuffer copy_cmd = VKO::allocateCommandBuffer(this->getDevice(), {
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-			.commandPool = ctx.CommandPool.Transient,
-			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			.commandBufferCount = 1u
-		});
-		CommandBufferManager::beginOneTimeSubmit(copy_cmd);
-
-		/***********************
-		 * Setup vertex buffer
-		 **********************/
-		const VKO::BufferAllocation vbo_staging = BufferManager::createStagingBuffer({
-			this->getDevice(), this->getAllocator(), sizeof(TriangleVertexIndexData)
-		}, BufferManager::HostAccessPattern::Sequential);
-
-		VKO::MappedAllocation vbo_data = VKO::mapAllocation<::TriangleInput>(this->getAllocator(), vbo_staging.first);
-		*vbo_data = TriangleVertexIndexData;
-
-		/******************************
-		 * Setup instance offset data
-		 *****************************/
-		const VKO::BufferAllocation instance_offset_staging = BufferManager::createStagingBuffer({
-			this->getDevice(), this->getAllocator(), sizeof(InstanceOffsetData)
-		}, BufferManager::HostAccessPattern::Sequential);
-
-		VKO::MappedAllocation ins_off_data = VKO::mapAllocation<::InstanceOffsetUniform>(
-			this->getAllocator(), instance_offset_staging.first);
-		*ins_off_data = InstanceOffsetData;
+		StagingUploader& uploader = *triangle_info.Uploader;
 
 		/****************************
 		 * Transfer buffer data
 		 ***************************/
-		//flush both buffers together
-		const array flush_alloc = { *vbo_staging.first, *instance_offset_staging.first };
-		CHECK_VULKAN_ERROR(vmaFlushAllocations(this->getAllocator(), static_cast<uint32_t>(flush_alloc.size()),
-			flush_alloc.data(), nullptr, nullptr));
-
-		vbo_data.reset();
-		ins_off_data.reset();
-
-		BufferManager::recordCopyBuffer(vbo_staging.second, this->VertexBuffer.second, copy_cmd, sizeof(TriangleVertexIndexData));
-		BufferManager::recordCopyBuffer(instance_offset_staging.second, this->VertexShaderInstanceOffset.second,
-			copy_cmd, sizeof(InstanceOffsetData));
-
-		//need some barriers to ensure copy has finished before rendering
-		PipelineBarrier<0u, 2u, 0u> barrier;
 		//vertex, index, indirect command
-		barrier.addBufferBarrier({
-			VK_PIPELINE_STAGE_2_COPY_BIT,
-			VK_ACCESS_2_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
-			VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT
-		}, this->VertexBuffer.second);
+		uploader.upload({
+			.Destination = this->VertexBuffer.second,
+			.Target = {
+				VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
+				VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT
+			}
+		}, std::as_bytes(span(&TriangleVertexIndexData, 1u)));
 		//SSBO in vertex shader
-		barrier.addBufferBarrier({
-			VK_PIPELINE_STAGE_2_COPY_BIT,
-			VK_ACCESS_2_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
-			VK_ACCESS_2_SHADER_STORAGE_READ_BIT
-		}, this->VertexShaderInstanceOffset.second);
-		barrier.record(copy_cmd);
+		uploader.upload({
+			.Destination = this->VertexShaderInstanceOffset.second,
+			.Target = { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT }
+		}, std::as_bytes(span(&InstanceOffsetData, 1u)));
 
 		/************************
 		 * Setup texture data
 		 ************************/
-		this->Texture.Image = ImageManager::createImageFromReadResult(copy_cmd, *triangle_info.SurfaceTexture, {
+		const ImageManager::ImageReadResult& surface_texture = *triangle_info.SurfaceTexture;
+		//use mip-maps provided by the read result if there is any
+		const bool generate_mip_map = ImageManager::requireMipMapGeneration(surface_texture);
+		const uint32_t texture_level = generate_mip_map ? TextureMipMapLevel
+			: std::min(TextureMipMapLevel, static_cast<uint32_t>(surface_texture.Level.size()));
+		//prefer generating all levels in a single compute dispatch, and fall back to blit
+		const MipMapGenerator& mip_map_generator = *triangle_info.MipMap;
+		const bool compute_mip_map = generate_mip_map
+			&& mip_map_generator.isSupported(surface_texture.Format, surface_texture.Extent, texture_level);
+		const VkImageCreateFlags texture_flag = compute_mip_map
+			? MipMapGenerator::requiredCreateFlag(surface_texture.Format) : VkImageCreateFlags { };
+		const VkImageUsageFlags texture_usage = uploader.imageUsage(surface_texture.Format, texture_flag,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+			| (compute_mip_map ? MipMapGenerator::RequiredUsage : VkImageUsageFlags { }));
+		this->Texture.Image = ImageManager::createImage(surface_texture, {
 			.Device = this->getDevice(),
 			.Allocator = this->getAllocator(),
-			.Level = TextureMipMapLevel,
-			.Usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			.Flag = texture_flag,
+			.Level = texture_level,
+			.Usage = texture_usage,
 			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
 		});
 		this->Texture.ImageView = ImageManager::createFullImageView({
@@ -334,69 +401,169 @@ DrawTriangle::DrawTriangle(const VulkanContext& ctx, const TriangleCreateInfo& t
 			.Image = this->Texture.Image.second,
 			.ViewType = VK_IMAGE_VIEW_TYPE_2D,
 			.Format = VK_FORMAT_R8G8B8A8_SRGB,
-			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+			.Usage = VK_IMAGE_USAGE_SAMPLED_BIT
 		});
 		this->Texture.Sampler = ImageManager::createTextureSampler(this->getDevice(), 14.5f);
 
-		//generate mip-map
-		const auto [w, h] = triangle_info.SurfaceTexture->Extent;
-		ImageManager::recordFullMipMapGeneration<TextureMipMapLevel>(copy_cmd, this->Texture.Image.second, {
-			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
-			.Extent = { w, h, 1u },
-			.LayerCount = triangle_info.SurfaceTexture->Layer,
-
-			.InputStage = VK_PIPELINE_STAGE_2_COPY_BIT,
-			.InputAccess = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-			.OutputStage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-			.OutputAccess = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+		const auto [w, h] = surface_texture.Extent;
+		if (!generate_mip_map) {
+			uploader.upload({
+				.Destination = this->Texture.Image.second,
+				.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+				.Extent = { w, h, 1u },
+				.Layer = surface_texture.Layer,
+				.Level = span(surface_texture.Level).first(texture_level),
+				.TargetLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.Target = { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT },
+				.Usage = texture_usage
+			}, surface_texture.Pixel);
+			uploader.wait(uploader.flush());
+		} else {
+			//mip-map is generated on the rendering queue, because transfer queue does not support blit
+			const StagingUploader::UploadTarget mip_map_input = compute_mip_map
+				? StagingUploader::UploadTarget { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT }
+				: StagingUploader::UploadTarget { VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT };
+			uploader.upload({
+				.Destination = this->Texture.Image.second,
+				.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+				.Extent = { w, h, 1u },
+				.Layer = surface_texture.Layer,
+				.TargetLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				.Target = mip_map_input,
+				.Usage = texture_usage
+			}, surface_texture.Pixel);
+			const StagingUploader::Ticket upload_ticket = uploader.flush();
+
+			//generate mip-map
+			const VKO::Semaphore mip_map_sema = SemaphoreManager::createTimelineSemaphore(this->getDevice(), 0ull);
+			const VKO::CommandBuffer mip_map_cmd = VKO::allocateCommandBuffer(this->getDevice(), {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = ctx.CommandPool.Transient,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 1u
+			});
+			CommandBufferManager::beginOneTimeSubmit(mip_map_cmd);
+
+			//resources of compute generation are retained until the submission completes
+			std::optional<MipMapGenerator::Generation> mip_map_generation;
+			if (compute_mip_map) {
+				mip_map_generation = mip_map_generator.record(mip_map_cmd, {
+					.Image = this->Texture.Image.second,
+					.Format = surface_texture.Format,
+					.Extent = surface_texture.Extent,
+					.Layer = surface_texture.Layer,
+					.Level = texture_level,
+
+					.InputStage = mip_map_input.Stage,
+					.InputAccess = VK_ACCESS_2_NONE,
+					.InputLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					.OutputStage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+					.OutputAccess = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+					.OutputLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+				});
+			} else {
+				ImageManager::recordFullMipMapGeneration<TextureMipMapLevel>(mip_map_cmd, this->Texture.Image.second, {
+					.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+					.Extent = { w, h, 1u },
+					.LayerCount = surface_texture.Layer,
+
+					.InputStage = VK_PIPELINE_STAGE_2_BLIT_BIT,
+					.InputAccess = VK_ACCESS_2_NONE,
+					.OutputStage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+					.OutputAccess = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+
+					.InputLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					.OutputLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+				});
+			}
 
-			.InputLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			.OutputLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		});
+			/****************
+			 * Submission
+			 ****************/
+			CHECK_VULKAN_ERROR(vkEndCommandBuffer(mip_map_cmd));
+			//mip-map generation waits for the upload, so both are complete
+			CommandBufferManager::submit<1u, 1u, 1u>({ this->getDevice(), ctx.Queue.Render }, { mip_map_cmd },
+				{{ uploader.waitOperation(upload_ticket, mip_map_input.Stage) }},
+				{{{ mip_map_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}}, VK_NULL_HANDLE);
+			SemaphoreManager::wait<1u>(this->getDevice(), { }, {{{ mip_map_sema, 1ull }}});
+		}
+	}
+	//generate instances of stress mode
+	if (triangle_info.Stress) {
+		const auto [instance_count, spacing] = *triangle_info.Stress;
+		const VkDevice device = this->getDevice();
+		const uint32_t max_draw = (instance_count + ::StressLocalSize - 1u) / ::StressLocalSize;
+		this->Stress.InstanceCount = instance_count;
+		this->Stress.MaxDrawCount = max_draw;
+
+		/******************
+		 * Prepare memory
+		 *****************/
+		const VkDeviceSize instance_size = sizeof(::StressInstanceTransform) * instance_count;
+		this->Stress.Instance = ::createStressBuffer(device, this->getAllocator(), instance_size, { });
+		this->Stress.Compacted = ::createStressBuffer(device, this->getAllocator(), instance_size, { });
+		this->Stress.Draw = ::createStressBuffer(device, this->getAllocator(),
+			::StressCommandOffset + sizeof(IndirectCommand::VkDrawIndexedIndirectCommand) * max_draw,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+		/*******************
+		 * Prepare pipeline
+		 ******************/
+		//generation only runs once, so its pipeline is not retained
+		const VKO::PipelineLayout generate_layout = ::createStressPipelineLayout(device, { },
+			static_cast<uint32_t>(sizeof(::StressGenerateArgument)));
+		this->Stress.CullLayout = ::createStressPipelineLayout(device, span(&triangle_info.CameraDescriptorSetLayout, 1u),
+			static_cast<uint32_t>(sizeof(::StressCullArgument)));
+		auto [generate_pipeline, cull_pipeline] = ::createStressPipeline(device, ctx.PipelineCache,
+			generate_layout, this->Stress.CullLayout, *triangle_info.DebugMessage);
+		this->Stress.CullPipeline = std::move(cull_pipeline);
 
 		/****************
-		 * Submission
-		 ****************/
-		CHECK_VULKAN_ERROR(vkEndCommandBuffer(copy_cmd));
-		//all we need is to wait for the host-to-device transfer to finish, before destroying the staging buffer
-		//we can proceed safely while device-only operations are in-progress.
-		CommandBufferManager::submit<1u, 0u, 1u>({ this->getDevice(), ctx.Queue.Render }, { copy_cmd }, {{ }},
-			{{{ copy_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}}, VK_NULL_HANDLE);
-		SemaphoreManager::wait<1u>(this->getDevice(), { }, {{{ copy_sema, 1ull }}});
-	}
-	//allocate descriptor set
-	{
-		//we don't need to create one descriptor set for each in-flight frame because our data are not going to change
-		const auto triangle_ds_layout = array { *this->TriangleShaderLayout };
-		this->TriangleShaderDescriptorBuffer = DescriptorBufferManager(ctx, triangle_ds_layout,
-			VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT);
-
-		const VkDescriptorImageInfo triangle_shader_img_sampler {
-			.sampler = this->Texture.Sampler,
-			.imageView = this->Texture.ImageView,
-			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		};
-		const VkDescriptorAddressInfoEXT triangle_shader_ssbo {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
-			.address = BufferManager::addressOf(this->getDevice(), this->VertexShaderInstanceOffset.second),
-			.range = sizeof(::InstanceOffsetUniform),
+		 * Generation
+		 ***************/
+		const VKO::Semaphore generate_sema = SemaphoreManager::createTimelineSemaphore(device, 0ull);
+		const VKO::CommandBuffer generate_cmd = VKO::allocateCommandBuffer(device, {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = ctx.CommandPool.Transient,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1u
+		});
+		CommandBufferManager::beginOneTimeSubmit(generate_cmd);
+
+		vkCmdBindPipeline(generate_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, generate_pipeline);
+		const ::StressGenerateArgument generate_arg {
+			.Instance = BufferManager::addressOf(device, this->Stress.Instance.second),
+			.InstanceCount = instance_count,
+			//the field is as square as possible
+			.FieldWidth = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instance_count)))),
+			.Spacing = spacing
 		};
+		vkCmdPushConstants(generate_cmd, generate_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0u, sizeof(generate_arg), &generate_arg);
+		vkCmdDispatch(generate_cmd, max_draw, 1u, 1u);
 
-		using DU = DescriptorBufferManager::DescriptorUpdater;
-		const std::initializer_list<DU::DescriptorGetInfo> triangle_ds_update = {
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { .pCombinedImageSampler = &triangle_shader_img_sampler } },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { .pStorageBuffer = &triangle_shader_ssbo } }
-		};
+		PipelineBarrier<0u, 1u, 0u> barrier;
+		barrier.addBufferBarrier({
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+		}, this->Stress.Instance.second);
+		barrier.record(generate_cmd);
 
-		const DU camera_ds_updater = this->TriangleShaderDescriptorBuffer.createUpdater(ctx);
-		for (const auto i : std::views::iota(0u, triangle_ds_update.size())) {
-			camera_ds_updater.update({
-				.SetLayout = this->TriangleShaderLayout,
-				.SetIndex = 0u,
-				.Binding = i,
-				.GetInfo = *(triangle_ds_update.begin() + i)
-			});
-		}
+		CHECK_VULKAN_ERROR(vkEndCommandBuffer(generate_cmd));
+		CommandBufferManager::submit<1u, 0u, 1u>({ device, ctx.Queue.Render }, { generate_cmd }, {{ }},
+			{{{ generate_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}}, VK_NULL_HANDLE);
+		SemaphoreManager::wait<1u>(device, { }, {{{ generate_sema, 1ull }}});
+	}
+	//allocate descriptor
+	{
+		//we don't need to create one descriptor for each in-flight frame because our data are not going to change
+		DescriptorHeap& heap = *triangle_info.Heap;
+		this->HeapSlot.InstanceOffset = heap.addStorageBuffer(
+			BufferManager::addressOf(this->getDevice(), this->VertexShaderInstanceOffset.second), sizeof(::InstanceOffsetUniform));
+		this->HeapSlot.SurfaceTexture = heap.addSampledImage(this->Texture.ImageView);
+		this->HeapSlot.SurfaceSampler = heap.addSampler(this->Texture.Sampler);
 	}
 }
 
@@ -418,6 +585,79 @@ inline mat4 DrawTriangle::animateTriangle(const double delta) noexcept {
 	return glm::rotate(model, this->CurrentAngle, yAxis);
 }
 
+void DrawTriangle::recordStressCulling(const VkCommandBuffer cmd, const CameraInterface& camera, const unsigned int frame_index) const {
+	const VkDevice device = this->getDevice();
+	const VkBuffer draw = this->Stress.Draw.second,
+		compacted = this->Stress.Compacted.second;
+
+	//the same buffers are used by every frame, and are overwritten only after the last frame has drawn from them
+	{
+		PipelineBarrier<0u, 2u, 0u> barrier;
+		barrier.addBufferBarrier({
+			VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+			VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_NONE
+		}, draw);
+		barrier.addBufferBarrier({
+			VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+			VK_ACCESS_2_NONE,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_NONE
+		}, compacted);
+		barrier.record(cmd);
+	}
+	vkCmdFillBuffer(cmd, draw, 0ull, ::StressCommandOffset, 0u);
+	{
+		PipelineBarrier<0u, 1u, 0u> barrier;
+		barrier.addBufferBarrier({
+			VK_PIPELINE_STAGE_2_CLEAR_BIT,
+			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		}, { }, draw, 0ull, ::StressCommandOffset);
+		barrier.record(cmd);
+	}
+
+	/*************
+	 * Dispatch
+	 ************/
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->Stress.CullPipeline);
+	{
+		constexpr static uint32_t ds_idx = 0u;
+		const VkDeviceSize ds_offset = camera.descriptorBufferOffset(frame_index);
+		vkCmdSetDescriptorBufferOffsetsEXT(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->Stress.CullLayout, 0u, 1u, &ds_idx, &ds_offset);
+	}
+
+	const VkDeviceAddress draw_addr = BufferManager::addressOf(device, draw);
+	const ::StressCullArgument cull_arg {
+		.Instance = BufferManager::addressOf(device, this->Stress.Instance.second),
+		.Compacted = BufferManager::addressOf(device, compacted),
+		.Command = draw_addr + ::StressCommandOffset,
+		.Draw = draw_addr,
+		.InstanceCount = this->Stress.InstanceCount,
+		.IndexCount = TriangleInput::IndexCount,
+		.BoundRadius = ::StressBoundRadius
+	};
+	vkCmdPushConstants(cmd, this->Stress.CullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0u, sizeof(cull_arg), &cull_arg);
+	vkCmdDispatch(cmd, this->Stress.MaxDrawCount, 1u, 1u);
+
+	PipelineBarrier<0u, 2u, 0u> barrier;
+	barrier.addBufferBarrier({
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+		VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT
+	}, draw);
+	barrier.addBufferBarrier({
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+		VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+	}, compacted);
+	barrier.record(cmd);
+}
+
 void DrawTriangle::reshape(const ReshapeInfo& reshape_info) {
 	const auto [ctx, extent] = reshape_info;
 
@@ -430,7 +670,9 @@ void DrawTriangle::reshape(const ReshapeInfo& reshape_info) {
 		.DepthFormat = ::DepthFormat,
 		.Sample = ::TriangleMultiSample,
 
-		.Extent = this->OutputExtent
+		.Extent = this->OutputExtent,
+		//the attachments are cleared every frame and resolved, and are never read outside of the frame
+		.Pool = &ctx->TransientAttachment
 	});
 
 	const VkCommandBuffer cmd = this->TriangleReshapeCmd;
@@ -443,11 +685,23 @@ void DrawTriangle::reshape(const ReshapeInfo& reshape_info) {
 }
 
 DrawTriangle::DrawResult DrawTriangle::draw(const DrawInfo& draw_info) {
-	const auto& [ctx, camera, delta_time, frame_index, vp, draw_area, present_img, present_img_view] = draw_info;
+	const auto& [ctx, camera, heap, profiler, job, worker_cmd, frame_memory, delta_time, frame_index, vp, draw_area, present_img, present_img_view] =
+		draw_info;
 
 	const VkCommandBuffer cmd = this->TriangleDrawCmd[frame_index];
 	CommandBufferManager::beginOneTimeSubmit(cmd);
 
+	const auto ds = array {
+		camera->descriptorBufferBindingInfo(),
+		heap->descriptorBufferBindingInfo()
+	};
+	vkCmdBindDescriptorBuffersEXT(cmd, static_cast<uint32_t>(ds.size()), ds.data());
+
+	//instances of stress mode are culled before rendering begins
+	if (this->Stress.InstanceCount > 0u) {
+		this->recordStressCulling(cmd, *camera, frame_index);
+	}
+
 	/****************************
 	 * Initial pipeline barrier
 	 ****************************/
@@ -481,28 +735,25 @@ DrawTriangle::DrawResult DrawTriangle::draw(const DrawInfo& draw_info) {
 	vkCmdSetViewport(cmd, 0u, 1u, &vp);
 	vkCmdSetScissor(cmd, 0u, 1u, &draw_area);
 
-	const mat4 model = this->animateTriangle(delta_time);
-	vkCmdPushConstants(cmd, this->PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0u, sizeof(model), glm::value_ptr(model));
+	const ::TrianglePushConstant triangle_pc {
+		.Model = this->animateTriangle(delta_time),
+		.InstanceOffset = this->HeapSlot.InstanceOffset.index(),
+		.SurfaceTexture = this->HeapSlot.SurfaceTexture.index(),
+		.SurfaceSampler = this->HeapSlot.SurfaceSampler.index(),
+		.StressInstance = this->Stress.InstanceCount > 0u
+			? BufferManager::addressOf(this->getDevice(), this->Stress.Compacted.second) : VkDeviceAddress { 0 }
+	};
+	vkCmdPushConstants(cmd, this->PipelineLayout, ::TrianglePushConstantStage, 0u, sizeof(triangle_pc), &triangle_pc);
 
 	/****************
 	 * Descriptor
 	 ****************/
-	const auto ds = array {
-		camera->descriptorBufferBindingInfo(),
-		VkDescriptorBufferBindingInfoEXT {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
-			.address = BufferManager::addressOf(this->getDevice(), this->TriangleShaderDescriptorBuffer.buffer()),
-			.usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT
-		}
-	};
 	array<uint32_t, ds.size()> ds_idx;
 	std::iota(ds_idx.begin(), ds_idx.end(), 0u);
 	const auto ds_offset = array {
 		camera->descriptorBufferOffset(frame_index),
-		this->TriangleShaderDescriptorBuffer.offset(0u)
+		VkDeviceSize { 0 }
 	};
-	
-	vkCmdBindDescriptorBuffersEXT(cmd, static_cast<uint32_t>(ds.size()), ds.data());
 	vkCmdSetDescriptorBufferOffsetsEXT(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->PipelineLayout, 0u,
 		static_cast<uint32_t>(ds.size()), ds_idx.data(), ds_offset.data());
 
@@ -518,13 +769,19 @@ DrawTriangle::DrawResult DrawTriangle::draw(const DrawInfo& draw_info) {
 	/************
 	 * Draw
 	 ************/
-	vkCmdDrawIndexedIndirect(cmd, vbo, offsetof(TriangleInput, Indirect), 1u, 0u);
+	if (this->Stress.InstanceCount > 0u) {
+		const VkBuffer stress_draw = this->Stress.Draw.second;
+		vkCmdDrawIndexedIndirectCount(cmd, stress_draw, ::StressCommandOffset, stress_draw, 0ull, this->Stress.MaxDrawCount,
+			sizeof(IndirectCommand::VkDrawIndexedIndirectCommand));
+	} else {
+		vkCmdDrawIndexedIndirect(cmd, vbo, offsetof(TriangleInput, Indirect), 1u, 0u);
+	}
 	vkCmdEndRendering(cmd);
 
 	/*************************
 	 * Final pipeline barrier
 	 ************************/
-	FramebufferManager::transitionAttachmentToPresent(cmd, present_img);
+	FramebufferManager::transitionAttachmentToPresent(cmd, present_img, ctx->PresentLayout);
 
 	CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
 	return {
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "../Engine/CameraInterface.hpp"
+#include "../Engine/DescriptorHeap.hpp"
+#include "../Engine/MipMapGenerator.hpp"
 #include "../Engine/RendererInterface.hpp"
+#include "../Engine/StagingUploader.hpp"
 #include "../Engine/VulkanContext.hpp"
 
 #include "../Engine/Abstraction/CommandBufferManager.hpp"
-#include "../Engine/Abstraction/DescriptorBufferManager.hpp"
 #include "../Engine/Abstraction/FramebufferManager.hpp"
 #include "../Engine/Abstraction/ImageManager.hpp"
 
@@ -34,20 +37,36 @@ namespace LearnVulkan {
 			VulkanObject::Sampler Sampler;
 
 		} Texture;
+		/**
+		 * In descriptor heap
+		 * vertex shader SSBO, fragment shader image and sampler
+		*/
+		struct {
+
+			DescriptorHeap::Slot InstanceOffset, SurfaceTexture, SurfaceSampler;
+
+		} HeapSlot;
+		/**
+		 * Instancing stress mode, all empty if disabled.
+		 * Instance transforms are generated once, then culled every frame into the compacted instance buffer,
+		 * along with one draw command for each batch of instances having any visible instance.
+		*/
+		struct {
+
+			VulkanObject::BufferAllocation Instance, Compacted, Draw;
+
+			VulkanObject::PipelineLayout CullLayout;
+			VulkanObject::Pipeline CullPipeline;
+
+			uint32_t InstanceCount = 0u, MaxDrawCount = 0u;
 
-		const VulkanObject::DescriptorSetLayout TriangleShaderLayout;
+		} Stress;
 
 		const VulkanObject::PipelineLayout PipelineLayout;
 		const VulkanObject::Pipeline Pipeline;
 
 		const CommandBufferManager::InFlightCommandBufferArray TriangleDrawCmd;
 		const VulkanObject::CommandBuffer TriangleReshapeCmd;
-		/**
-		 * set 1
-		 * binding 0: fragment shader sampler
-		 * binding 1: vertex shader SSBO
-		*/
-		DescriptorBufferManager TriangleShaderDescriptorBuffer;
 
 		double CurrentAngle;
 
@@ -61,22 +80,42 @@ namespace LearnVulkan {
 		*/
 		glm::mat4 animateTriangle(double) noexcept;
 
+		//Record culling of stress instances, and make the compacted instances and draw commands visible to the draw.
+		//The camera descriptor buffer must have been bound.
+		void recordStressCulling(VkCommandBuffer, const CameraInterface&, unsigned int) const;
+
 	public:
 
+		/**
+		 * @brief Information to enable instancing stress mode, which draws a massive field of instances made on the device,
+		 * to benchmark vertex and draw throughput independent of scene complexity.
+		*/
+		struct StressInfo {
+
+			uint32_t InstanceCount = 1u << 21u;
+			float Spacing = 2.0f;/**< The distance between adjacent instances on the grid they are laid out. */
+
+		};
+
 		/**
 		 * @brief Information to create a triangle renderer.
 		*/
 		struct TriangleCreateInfo {
 
 			VkDescriptorSetLayout CameraDescriptorSetLayout;
+			DescriptorHeap* Heap;
 
 			/**
 			 * @brief The image data to be displaced on the surface of the triangle.
 			 * This information is not retained and can be destroyed after the triangle renderer has been initialised.
 			*/
 			const ImageManager::ImageReadResult* SurfaceTexture;
+			StagingUploader* Uploader;
+			const MipMapGenerator* MipMap;
 			std::ostream* DebugMessage;/**< Must NOT be null and its lifetime should be retained. */
 
+			const StressInfo* Stress = nullptr;/**< Set to enable instancing stress mode in place of the fixed instances. */
+
 		};
 
 		DrawTriangle(const VulkanContext&, const TriangleCreateInfo&);
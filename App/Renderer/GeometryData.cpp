@@ -1,19 +1,49 @@
 #include "GeometryData.hpp"
 
-#include "../Engine/Abstraction/BufferManager.hpp"
 #include "../Engine/Abstraction/PipelineBarrier.hpp"
+#include "../Engine/IndirectCommand.hpp"
+
+#include <tuple>
+#include <utility>
 
 #include <stdexcept>
 
 using namespace LearnVulkan;
 namespace VKO = VulkanObject;
 
+namespace {
+
+	std::pair<VkPipelineStageFlags2, VkAccessFlags2> getStageAccess(const GeometryData::BarrierTarget target) {
+		using enum GeometryData::BarrierTarget;
+		switch (target) {
+		case Generation: return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
+		case Displacement: return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
+		//chunks may be read by compute shader for culling before rendering,
+		//and generation parameters by vertex shader to reconstruct geometry without vertex input
+		case Rendering: return {
+			VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT
+				| VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+			VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT
+				| VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+		};
+		case AccelStructBuild: return {
+			VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+			VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
+		};
+		default:
+			throw std::runtime_error("Unable to determine the barrier target.");
+		}
+	}
+
+}
+
 GeometryData::GeometryData() noexcept : Type(GeometryType::Uninitialised), Attribute { } {
 
 }
 
 VkBuffer GeometryData::buffer() const noexcept {
-	return this->Memory.Geometry.second;
+	return this->Memory.Geometry.Buffer;
 }
 
 void GeometryData::releaseTemporary() noexcept {
@@ -24,11 +54,28 @@ const GeometryData::AttributeInfo& GeometryData::attributeInfo() const noexcept
 	return this->Attribute;
 }
 
-void GeometryData::accelerationStructureGeometry(VkAccelerationStructureGeometryKHR& as_geo, const VkDeviceAddress transform_addr) const noexcept {
-	using BufferManager::addressOf;
+const BufferArena::Range& GeometryData::inputParameter() const noexcept {
+	return this->Memory.InputParameter;
+}
+
+GeometryData::CulledDrawInfo GeometryData::culledDraw(const unsigned int frame) const noexcept {
+	const BufferArena::Range& draw = this->Memory.Draw;
+	const uint32_t chunk_count = this->Attribute.Count.Chunk;
+	const VkDeviceSize frame_offset = (sizeof(uint32_t) + sizeof(IndirectCommand::VkDrawIndexedIndirectCommand) * chunk_count) * frame;
+	return {
+		.Buffer = draw.Buffer,
+		.CountOffset = draw.Offset + frame_offset,
+		.CommandOffset = draw.Offset + frame_offset + sizeof(uint32_t),
+		.CountAddress = draw.Address + frame_offset,
+		.CommandAddress = draw.Address + frame_offset + sizeof(uint32_t),
+		.MaxCount = chunk_count
+	};
+}
 
-	const VkDeviceAddress geometry_addr = addressOf(this->Memory.Geometry.second->get_deleter().Device, this->Memory.Geometry.second);
-	const auto [vertex_offset, index_offset, indirect_offset] = this->Attribute.Offset;
+void GeometryData::accelerationStructureGeometry(VkAccelerationStructureGeometryKHR& as_geo, const VkDeviceAddress transform_addr) const noexcept {
+	//attribute offsets are from the beginning of the buffer, rather than the range
+	const VkDeviceAddress geometry_addr = this->Memory.Geometry.Address - this->Memory.Geometry.Offset;
+	const auto [vertex_offset, index_offset, indirect_offset, chunk_offset] = this->Attribute.Offset;
 	const auto [vertex_type, index_type] = this->Attribute.Type;
 	as_geo = {
 		.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
@@ -59,33 +106,36 @@ void GeometryData::accelerationStructureRange(VkAccelerationStructureBuildRangeI
 }
 
 void GeometryData::barrier(const VkCommandBuffer cmd, const BarrierTarget src_target, const BarrierTarget dst_target) const {
-	constexpr static auto get_stage_access = [](const BarrierTarget target) -> std::pair<VkPipelineStageFlags2, VkAccessFlags2> {
-		using enum BarrierTarget;
-		switch (target) {
-		case Generation: return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
-		case Displacement: return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
-			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
-		case Rendering: return {
-			VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
-			VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT | VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT
-		};
-		case AccelStructBuild: return {
-			VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
-			VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
-		};
-		default:
-			throw std::runtime_error("Unable to determine the barrier target.");
-		}
-	};
-	const auto [src_stage, src_access] = get_stage_access(src_target);
-	const auto [dst_stage, dst_access] = get_stage_access(dst_target);
+	const auto [src_stage, src_access] = ::getStageAccess(src_target);
+	const auto [dst_stage, dst_access] = ::getStageAccess(dst_target);
 	
+	const BufferArena::Range& geometry = this->Memory.Geometry;
 	PipelineBarrier<0u, 1u, 0u> barrier;
 	barrier.addBufferBarrier({
 		src_stage,
 		src_access,
 		dst_stage,
 		dst_access
-	}, this->Memory.Geometry.second);
+	}, { }, geometry.Buffer, geometry.Offset, geometry.Size);
+	barrier.record(cmd);
+}
+
+void GeometryData::transferOwnership(const VkCommandBuffer cmd, const OwnershipTransfer op, const BarrierTarget src_target,
+	const BarrierTarget dst_target, const PipelineBarrierInfo::QueueFamilyTransitionInfo& queue_family) const {
+	//The destination scope of a release, and the source scope of an acquire, are ignored.
+	PipelineBarrierInfo::BarrierInfo barrier_info { };
+	if (op == OwnershipTransfer::Release) {
+		std::tie(barrier_info.SourceStage, barrier_info.SourceAccess) = ::getStageAccess(src_target);
+	} else {
+		std::tie(barrier_info.TargetStage, barrier_info.TargetAccess) = ::getStageAccess(dst_target);
+	}
+
+	//only the ranges are transferred, other ranges in the same buffer are unaffected
+	//generation parameters are transferred along, as they are read when rendering geometry without vertex input
+	const BufferArena::Range& geometry = this->Memory.Geometry,
+		& input_param = this->Memory.InputParameter;
+	PipelineBarrier<0u, 2u, 0u> barrier;
+	barrier.addBufferBarrier(barrier_info, queue_family, geometry.Buffer, geometry.Offset, geometry.Size);
+	barrier.addBufferBarrier(barrier_info, queue_family, input_param.Buffer, input_param.Offset, input_param.Size);
 	barrier.record(cmd);
 }
\ No newline at end of file
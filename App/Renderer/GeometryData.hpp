@@ -2,12 +2,16 @@
 
 #include "../Engine/Abstraction/AccelStructManager.hpp"
 #include "../Engine/Abstraction/DescriptorBufferManager.hpp"
+#include "../Engine/Abstraction/PipelineBarrier.hpp"
+#include "../Engine/AccelStructPool.hpp"
+#include "../Engine/BufferArena.hpp"
 #include "../Engine/VulkanContext.hpp"
 
 #include "../Common/VulkanObject.hpp"
 
 #include <array>
 #include <any>
+#include <span>
 #include <cstdint>
 
 namespace LearnVulkan {
@@ -38,6 +42,14 @@ namespace LearnVulkan {
 			AccelStructBuild = 0x20u/**< Acceleration structure build operation uses geometry data. */
 		};
 
+		/**
+		 * @brief Specify which half of a queue family ownership transfer is to be recorded.
+		*/
+		enum class OwnershipTransfer : uint8_t {
+			Release = 0x00u,/**< Recorded on a queue from the source queue family. */
+			Acquire = 0x01u/**< Recorded on a queue from the target queue family. */
+		};
+
 		/**
 		 * @brief Containing information regarding attribute.
 		*/
@@ -45,12 +57,13 @@ namespace LearnVulkan {
 
 			struct {
 
-				VkDeviceSize Vertex, Index, Indirect;
+				VkDeviceSize Vertex, Index, Indirect,
+					Chunk;/**< An array of chunk, each with a bound and a range of index. */
 
-			} Offset;/**< Offset information into different fields of geometry buffer, in byte. */
+			} Offset;/**< Offset information into different fields of geometry buffer, in byte, from the beginning of the buffer. */
 			struct {
 			
-				uint32_t Primitive, Vertex;
+				uint32_t Primitive, Vertex, Chunk;
 			
 			} Count;
 
@@ -60,7 +73,22 @@ namespace LearnVulkan {
 				VkFormat Vertex;
 				VkIndexType Index;
 
-			} Type;/**< Format of vertex and index. */
+			} Type;/**< Format of vertex and index. Geometry without vertex and index has undefined format and none index type. */
+
+		};
+
+		/**
+		 * @brief Location of culled draw commands of an in-flight frame.
+		 * It consists of a draw count followed by an array of indexed indirect draw command, one for each visible chunk.
+		 * For geometry without index, each command is also a valid non-indexed indirect draw command with the same stride,
+		 * whose first vertex is the first index.
+		*/
+		struct CulledDrawInfo {
+
+			VkBuffer Buffer;
+			VkDeviceSize CountOffset, CommandOffset;/**< In byte, from the beginning of the buffer. */
+			VkDeviceAddress CountAddress, CommandAddress;
+			uint32_t MaxCount;/**< The number of chunk, which is the maximum number of visible chunk. */
 
 		};
 
@@ -86,8 +114,10 @@ namespace LearnVulkan {
 
 		struct {
 
-			VulkanObject::BufferAllocation Geometry,/**< Vertex, index and indirect draw command. */
-				InputParameter;/**< Opaque generation parameters. */
+			//Ranges are sub-allocated from an arena, thus the buffers are shared with other data.
+			BufferArena::Range Geometry,/**< Vertex, index and indirect draw command. */
+				InputParameter,/**< Opaque generation parameters. */
+				Draw;/**< Culled draw commands of each in-flight frame. */
 
 		} Memory;
 
@@ -118,6 +148,7 @@ namespace LearnVulkan {
 
 		/**
 		 * @brief Get the buffer containing geometry data.
+		 * The buffer is shared with other data, and geometry data are located by the offsets in attribute information.
 		 * @return The geometry buffer.
 		*/
 		VkBuffer buffer() const noexcept;
@@ -134,9 +165,25 @@ namespace LearnVulkan {
 		*/
 		const AttributeInfo& attributeInfo() const noexcept;
 
+		/**
+		 * @brief Get the opaque generation parameters, to be read by shaders that reconstruct geometry without vertex input.
+		 * The layout of parameters depends on the type of geometry.
+		 * @return The range of generation parameters.
+		*/
+		const BufferArena::Range& inputParameter() const noexcept;
+
+		/**
+		 * @brief Get the culled draw commands of an in-flight frame.
+		 * Content is written by chunk culling, and undefined before that.
+		 * @param frame The in-flight frame index.
+		 * @return Culled draw info.
+		*/
+		CulledDrawInfo culledDraw(unsigned int) const noexcept;
+
 		/**
 		 * @brief Get the geometry data for acceleration structure.
 		 * The geometry is assumed to consist of triangles only, and is opaque.
+		 * The geometry must have vertex and index.
 		 * @param as_geo The output geometry for acceleration structure build.
 		 * @param transform_addr The address to the transform matrix.
 		*/
@@ -153,16 +200,16 @@ namespace LearnVulkan {
 		 * @brief Record an acceleration structure build command from an array of geometry data.
 		 * The acceleration structure will be a BLAS.
 		 * @tparam GeometryCount The number of geometry data.
-		 * @param ctx The vulkan context.
+		 * @param pool The pool where memory of the acceleration structure is allocated.
 		 * @param cmd The command buffer.
 		 * @param flag Specify any acceleration structure build flag.
 		 * @param geometry An array of geometry data.
 		 * @param query_info An optional pointer to query compaction size of acceleration structure.
-		 * @return The acceleration structure build result.
+		 * @return The built acceleration structure.
 		*/
 		template<size_t GeometryCount>
-		static AccelStructManager::AccelStructBuildResult buildAccelStruct(
-			const VulkanContext& ctx,
+		static AccelStructPool::AccelStruct buildAccelStruct(
+			AccelStructPool& pool,
 			const VkCommandBuffer cmd,
 			const VkBuildAccelerationStructureFlagsKHR flag,
 			const std::array<GeometryDataEntry, GeometryCount>& geometry,
@@ -178,16 +225,51 @@ namespace LearnVulkan {
 				current_geo->accelerationStructureRange(as_range[i], trans_offset);
 			}
 			
-			return AccelStructManager::buildAccelStruct({
-				.Device = ctx.Device,
-				.Allocator = ctx.Allocator,
-				.Command = cmd,
-				
+			return pool.build(cmd, AccelStructManager::AccelStructBuildRequest {
 				.Type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
 				.Flag = flag,
-
+				.Geometry = as_geometry,
+				.Range = as_range,
 				.CompactionSizeQuery = query_info
-			}, as_geometry, as_range);
+			});
+		}
+
+		/**
+		 * @brief Record a command to refit a BLAS in place after vertices of its geometry data have changed,
+		 * such as after a region of the geometry has been displaced, which is cheaper than a rebuild.
+		 * @tparam GeometryCount The number of geometry data.
+		 * @param pool The pool whose scratch memory is used by the update.
+		 * @param cmd The command buffer.
+		 * @param flag The same build flag as the BLAS was built with, which must include allow update.
+		 * @param geometry The same array of geometry data as the BLAS was built from.
+		 * @param as The BLAS to be refitted.
+		 * The device must have finished reading from it, or a barrier must have been recorded by the application.
+		*/
+		template<size_t GeometryCount>
+		static void refitAccelStruct(
+			AccelStructPool& pool,
+			const VkCommandBuffer cmd,
+			const VkBuildAccelerationStructureFlagsKHR flag,
+			const std::array<GeometryDataEntry, GeometryCount>& geometry,
+			const VkAccelerationStructureKHR as
+		) {
+			using std::array;
+			array<VkAccelerationStructureGeometryKHR, GeometryCount> as_geometry;
+			array<VkAccelerationStructureBuildRangeInfoKHR, GeometryCount> as_range;
+
+			for (size_t i = 0u; i < GeometryCount; i++) {
+				const auto [current_geo, trans_addr, trans_offset] = geometry[i];
+				current_geo->accelerationStructureGeometry(as_geometry[i], trans_addr);
+				current_geo->accelerationStructureRange(as_range[i], trans_offset);
+			}
+
+			const AccelStructManager::AccelStructBuildRequest request {
+				.Type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+				.Flag = flag,
+				.Geometry = as_geometry,
+				.Range = as_range
+			};
+			pool.update(cmd, std::span(&request, 1u), std::span(&as, 1u));
 		}
 
 		/**
@@ -198,6 +280,19 @@ namespace LearnVulkan {
 		*/
 		void barrier(VkCommandBuffer, BarrierTarget, BarrierTarget) const;
 
+		/**
+		 * @brief Issue one half of a queue family ownership transfer for geometry data.
+		 * Both halves must be recorded with the same targets and queue families,
+		 * and the acquire operation must be ordered after the release using a semaphore.
+		 * @param cmd The command buffer where barrier is issued.
+		 * @param op Specify if this is a release or acquire operation.
+		 * @param src_target The source target on the source queue family.
+		 * @param dst_target The destination target on the target queue family.
+		 * @param queue_family The source and target queue family.
+		*/
+		void transferOwnership(VkCommandBuffer, OwnershipTransfer, BarrierTarget, BarrierTarget,
+			const PipelineBarrierInfo::QueueFamilyTransitionInfo&) const;
+
 	};
 
 }
\ No newline at end of file
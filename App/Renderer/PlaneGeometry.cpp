@@ -11,10 +11,13 @@
 #include "../Engine/Abstraction/ShaderModuleManager.hpp"
 #include "../Engine/EngineSetting.hpp"
 #include "../Engine/IndirectCommand.hpp"
+#include "../Engine/StartupGraph.hpp"
 
 #include <shaderc/shaderc.h>
 
 #include <glm/vec3.hpp>
+#include <glm/common.hpp>
+#include <glm/vector_relational.hpp>
 
 #include <array>
 #include <string_view>
@@ -41,6 +44,8 @@ namespace {
 
 	constexpr auto GeneratorLocalSize = uvec2(16u, 16u);
 	constexpr VkFormat VertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+	//vec3 in std430 layout is aligned to 16 byte
+	constexpr VkDeviceSize ChunkAlignment = 16ull;
 
 	/**
 	 * @brief Used to index individual command buffer with an array of allocated command buffers.
@@ -60,9 +65,14 @@ namespace {
 		u16vec2 UV;
 
 	};
-	struct IndexAttribute {
+	//std430 rounds the size of structure up to the alignment of vec3
+	struct alignas(16) ChunkAttribute {
 
-		uint32_t I[6];
+		vec3 Min;
+		uint32_t FI;
+		vec3 Max;
+		uint32_t IC;
+		int32_t VO;
 
 	};
 	struct PlaneInputParameter {
@@ -70,20 +80,20 @@ namespace {
 		//This order of member perfectly satisfies std430 alignment requirement,
 		//and no padding is required, Hooray!!!
 		dvec2 Dim, TotPln;
-		uvec2 Sub, VerDim;
-		uint32_t IC;
+		uvec2 Sub, VerDim, ChkSub, ChkCnt;
+		uint32_t IC, IdxSz;
 
 	};
 	struct PlaneAttribute {
 
 		struct {
 
-			uint32_t Vertex, Index;
+			uint32_t Vertex, Index, Chunk;
 
 		} Size;/**< The size of vertex attribute in plane geometry buffer, in byte. */
 		struct {
 
-			uint32_t Primitive, Vertex;
+			uint32_t Primitive, Vertex, Chunk;
 
 		} Count;/**< The number of each attribute. */
 		uvec2 ThreadCount;
@@ -91,12 +101,14 @@ namespace {
 	};
 	struct GenerateInfo {
 
-		VkDeviceAddress V, I, C;
+		VkDeviceAddress V, I, C, Ch;
+		float Alt;/**< Only used by the fused generator. */
 
 	};
 	struct DisplaceInfo {
 		
 		VkDeviceAddress V;
+		uvec2 Org, Ext;/**< The region of stored vertex grid to be displaced. */
 		float Alt;
 
 	};
@@ -104,6 +116,8 @@ namespace {
 	struct PlanePrivateData {
 
 		uvec2 ThreadCount;
+		bool VertexAttribute;/**< False if only chunks are generated, and vertices are reconstructed by the renderer. */
+		::PlaneInputParameter Parameter;
 
 	};
 
@@ -114,6 +128,13 @@ namespace {
 	constexpr auto PlaneShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, PlaneGeneratorCS, PlaneDisplacerCS>();
 	constexpr auto PlaneShaderFilename = File::batchRawStringToView(PlaneShaderFilenameRaw);
 
+	/**
+	 * @brief Each pipeline is created from a shader, and the generator is specialised once more with displacement fused.
+	 * In order of generator, displacer and fused generator.
+	*/
+	constexpr auto PlanePipelineShaderIndex = array { 0u, 1u, 0u };
+	constexpr auto PlanePipelineFuseDisplacement = array<VkBool32, PlanePipelineShaderIndex.size()> { VK_FALSE, VK_FALSE, VK_TRUE };
+
 	////////////////////////
 	/// Setup
 	///////////////////////
@@ -182,18 +203,15 @@ namespace {
 		});
 	}
 
-	//Returns an array of pipelines, depends on how many compute shaders we have.
-	template<size_t LayoutCount>
-	auto createPlanePipeline(const VkDevice device, const array<VkPipelineLayout, LayoutCount> layout, ostream& msg) {
+	//Returns an array of pipelines, in the order given by the pipeline shader index.
+	auto createPlanePipeline(const VkDevice device, const VkPipelineCache cache,
+		const array<VkPipelineLayout, PlanePipelineShaderIndex.size()> layout, ostream& msg) {
+		const StartupGraph::Step step("Pipeline creation");
 		const auto plane_shader_gen = compilePlaneShader(device, msg);
+		const auto& shader_stage = plane_shader_gen.promise().ShaderStage;
 
-		using Constant_t = array<uint32_t, 2u>;
-		constexpr static Constant_t constant = {
-			//FIXME: It's better to determine local size from physical device attribute, rather than fixed hand typed.
-			//local size
-			::GeneratorLocalSize.x, ::GeneratorLocalSize.y
-		};
-		array<VkSpecializationMapEntry, constant.size()> map_entry;
+		using Constant_t = array<uint32_t, 3u>;
+		array<VkSpecializationMapEntry, std::tuple_size_v<Constant_t>> map_entry;
 		transform(iota(size_t { 0 }, map_entry.size()), map_entry.begin(), [](const auto i) constexpr noexcept {
 			constexpr static uint32_t entry_size = static_cast<uint32_t>(sizeof(Constant_t::value_type));
 			const uint32_t index = static_cast<uint32_t>(i);
@@ -204,21 +222,27 @@ namespace {
 				.size = entry_size
 			};
 		});
-		//we will be using the same specialisation across all shaders
-		const VkSpecializationInfo spec_info {
-			.mapEntryCount = static_cast<uint32_t>(constant.size()),
-			.pMapEntries = map_entry.data(),
-			.dataSize = static_cast<uint32_t>(constant.size() * sizeof(Constant_t::value_type)),
-			.pData = constant.data()
-		};
 
-		array<VKO::Pipeline, PlaneShaderFilename.size()> pipeline;
-		transform(plane_shader_gen.promise().ShaderStage, layout, pipeline.begin(),
-			[device, &spec_info](const auto& stage, const VkPipelineLayout layout) {
-				VkPipelineShaderStageCreateInfo spec_stage = stage;
+		array<VKO::Pipeline, PlanePipelineShaderIndex.size()> pipeline;
+		transform(iota(size_t { 0 }, pipeline.size()), pipeline.begin(),
+			[device, cache, &shader_stage, &layout, &map_entry](const auto i) {
+				//constants not used by a shader are ignored
+				const Constant_t constant = {
+					//FIXME: It's better to determine local size from physical device attribute, rather than fixed hand typed.
+					//local size
+					::GeneratorLocalSize.x, ::GeneratorLocalSize.y,
+					::PlanePipelineFuseDisplacement[i]
+				};
+				const VkSpecializationInfo spec_info {
+					.mapEntryCount = static_cast<uint32_t>(map_entry.size()),
+					.pMapEntries = map_entry.data(),
+					.dataSize = static_cast<uint32_t>(sizeof(constant)),
+					.pData = constant.data()
+				};
+				VkPipelineShaderStageCreateInfo spec_stage = shader_stage[::PlanePipelineShaderIndex[i]];
 				spec_stage.pSpecializationInfo = &spec_info;
 
-				return VKO::createComputePipeline(device, VK_NULL_HANDLE, {
+				return VKO::createComputePipeline(device, cache, {
 					.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
 					.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
 #ifndef NDEBUG
@@ -226,7 +250,7 @@ namespace {
 #endif
 					,
 					.stage = spec_stage,
-					.layout = layout
+					.layout = layout[i]
 				});	
 			});
 		return pipeline;
@@ -241,149 +265,226 @@ namespace {
 		});
 	}
 
-	inline VKO::BufferAllocation createPlaneGeometryDataBuffer(const VkDevice device, const VmaAllocator allocator, const size_t size,
-		const bool require_as) {
-		VkBufferUsageFlags flag = VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
-			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
-		if (require_as) {
-			flag |= VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+	//The size of index in byte. Plane without index is treated as if it has 32-bit global index.
+	constexpr uint32_t getIndexSize(const VkIndexType index_type) noexcept {
+		switch (index_type) {
+		case VK_INDEX_TYPE_UINT16: return 2u;
+		case VK_INDEX_TYPE_UINT8_EXT: return 1u;
+		default: return 4u;
 		}
-		return BufferManager::createDeviceBuffer({ device, allocator, size }, flag);
 	}
 
-	constexpr ::PlaneAttribute calcPlaneAttribute(const PlaneGeometry::Property& prop, ::PlaneInputParameter& input_param) noexcept {
-		const auto& [dim, subdivision, require_build_accel_struct] = prop;
+	constexpr uvec2 getChunkSubdivision(const PlaneGeometry::Property& prop) noexcept {
+		return prop.ChunkSubdivision == uvec2(0u) ? prop.Subdivision : prop.ChunkSubdivision;
+	}
 
-		const uvec2 vertex_dimension = subdivision + 1u;
+	constexpr ::PlaneAttribute calcPlaneAttribute(const PlaneGeometry::Property& prop, ::PlaneInputParameter& input_param) noexcept {
+		const auto& [dim, subdivision, chunk_subdivision, index_type, require_build_accel_struct, reuse] = prop;
+		const bool has_vertex = index_type != VK_INDEX_TYPE_NONE_KHR;
+		const uint32_t index_size = ::getIndexSize(index_type);
+
+		const uvec2 chunk_sub = ::getChunkSubdivision(prop),
+			chunk_count = subdivision / chunk_sub,
+			//local index requires vertices on chunk borders to be duplicated
+			vertex_dimension = index_size < 4u ? chunk_count * (chunk_sub + 1u) : subdivision + 1u;
 		const uint32_t vertex_data_count = vertex_dimension.x * vertex_dimension.y,
 			index_data_count = subdivision.x * subdivision.y,
+			chunk_data_count = chunk_count.x * chunk_count.y,
 			
-			vertex_data_size = vertex_data_count * sizeof(::VertexAttribute),
-			index_data_size = index_data_count * sizeof(::IndexAttribute);
+			//vertex and index are only stored when they need to be read from memory
+			vertex_data_size = has_vertex ? vertex_data_count * sizeof(::VertexAttribute) : 0u,
+			//6 indices per subdivision
+			index_data_size = has_vertex ? index_data_count * 6u * index_size : 0u,
+			chunk_data_size = chunk_data_count * sizeof(::ChunkAttribute);
 
 		input_param = {
 			.Dim = dim,
 			.TotPln = dvec2(subdivision),
 			.Sub = subdivision,
 			.VerDim = vertex_dimension,
-			//6 indices per subdivision
-			.IC = index_data_count * 6u
+			.ChkSub = chunk_sub,
+			.ChkCnt = chunk_count,
+			.IC = index_data_count * 6u,
+			.IdxSz = index_size
 		};
 		return {
 			.Size = {
 				.Vertex = vertex_data_size,
-				.Index = index_data_size
+				.Index = index_data_size,
+				.Chunk = chunk_data_size
 			},
 			.Count = {
 				//Each subdivision is a quad, which contains 2 triangles.
 				//Our primitive unit is triangle, so the primitive count is twice the number of subdivision.
 				.Primitive = index_data_count * 2u,
-				.Vertex = vertex_data_count
+				.Vertex = vertex_data_count,
+				.Chunk = chunk_data_count
 			},
-			.ThreadCount = vertex_dimension
+			.ThreadCount = has_vertex ? vertex_dimension : chunk_count
 		};
 	}
 
 }
 
 VkCommandBuffer PlaneGeometry::prepareGeometryData(const VulkanContext& ctx, const Property& prop, GeometryData& geo) const {
+	if (const uvec2 chunk = prop.ChunkSubdivision;
+		chunk != uvec2(0u) && (chunk.x == 0u || chunk.y == 0u || prop.Subdivision % chunk != uvec2(0u))) {
+		throw std::runtime_error("The plane subdivision must be a multiple of the chunk subdivision.");
+	}
+	{
+		const VkIndexType index_type = prop.IndexType;
+		if (index_type != VK_INDEX_TYPE_NONE_KHR && index_type != VK_INDEX_TYPE_UINT32
+			&& index_type != VK_INDEX_TYPE_UINT16 && index_type != VK_INDEX_TYPE_UINT8_EXT) {
+			throw std::runtime_error("The plane index type is not supported.");
+		}
+
+		const uvec2 chunk_sub = ::getChunkSubdivision(prop);
+		if (const uint32_t index_size = ::getIndexSize(index_type); index_size < 4u) {
+			const uint64_t chunk_vertex_count = static_cast<uint64_t>(chunk_sub.x + 1u) * (chunk_sub.y + 1u);
+			if (chunk_vertex_count > 1ull << (8u * index_size)) {
+				throw std::runtime_error("The number of vertex in a chunk exceeds the range of its local index.");
+			}
+		}
+		//acceleration structure takes neither 8-bit index nor vertex offset of each chunk
+		if (prop.RequireAccelStructInput && index_type != VK_INDEX_TYPE_UINT32
+			&& !(index_type == VK_INDEX_TYPE_UINT16 && chunk_sub == prop.Subdivision)) {
+			throw std::runtime_error("Acceleration structure input requires 32-bit index, or 16-bit index with a single chunk.");
+		}
+	}
+	//pooled generation reuses every object created by the last generation into the same geometry data
+	const bool reuse = prop.Reuse && geo.Type == GeometryData::GeometryType::Plane;
+
+	::PlaneInputParameter plane_input_param;
 	VKO::BufferAllocation& input_param_staging = geo.Temporary.InputParameterStaging;
 	{
 		/*****************************
 		 * Populate input parameters
 		 ****************************/
-		input_param_staging = BufferManager::createStagingBuffer({ ctx.Device, ctx.Allocator,
-			sizeof(::PlaneInputParameter) }, BufferManager::HostAccessPattern::Sequential);
-
-		void* geo_input_mem;
-		CHECK_VULKAN_ERROR(vmaMapMemory(ctx.Allocator, input_param_staging.first, &geo_input_mem));
-		::PlaneInputParameter* const plane_input_param = new(geo_input_mem) ::PlaneInputParameter;
-
-		const ::PlaneAttribute plane_attr = ::calcPlaneAttribute(prop, *plane_input_param);
-
-		CHECK_VULKAN_ERROR(vmaFlushAllocation(ctx.Allocator, input_param_staging.first, 0ull, VK_WHOLE_SIZE));
-		vmaUnmapMemory(ctx.Allocator, input_param_staging.first);
-		(void)geo_input_mem;
+		const ::PlaneAttribute plane_attr = ::calcPlaneAttribute(prop, plane_input_param);
+		//parameters are small enough to be updated inline when reused, otherwise they are staged
+		if (!reuse) {
+			input_param_staging = BufferManager::createStagingBuffer({ ctx.Device, ctx.Allocator,
+				sizeof(::PlaneInputParameter) }, BufferManager::HostAccessPattern::Sequential);
+
+			void* geo_input_mem;
+			CHECK_VULKAN_ERROR(vmaMapMemory(ctx.Allocator, input_param_staging.first, &geo_input_mem));
+			new(geo_input_mem) ::PlaneInputParameter(plane_input_param);
+
+			CHECK_VULKAN_ERROR(vmaFlushAllocation(ctx.Allocator, input_param_staging.first, 0ull, VK_WHOLE_SIZE));
+			vmaUnmapMemory(ctx.Allocator, input_param_staging.first);
+			(void)geo_input_mem;
+		}
 
 		/****************************
 		 * Initialise geometry data
 		 ***************************/
-		const auto [vertex_size, index_size] = plane_attr.Size;
-		const auto [primitive_count, vertex_count] = plane_attr.Count;
-		const VkDeviceSize vi_size = vertex_size + index_size;
+		const auto [vertex_size, index_size, chunk_size] = plane_attr.Size;
+		const auto [primitive_count, vertex_count, chunk_count] = plane_attr.Count;
+		const bool has_vertex = prop.IndexType != VK_INDEX_TYPE_NONE_KHR;
+		const VkDeviceSize vi_size = vertex_size + index_size,
+			chunk_offset = (vi_size + ::ChunkAlignment - 1ull) & ~(::ChunkAlignment - 1ull),
+			indirect_offset = chunk_offset + chunk_size;
+
+		//Buffers from the arena are always usable as acceleration structure build input, regardless of the property.
+		//When reused, input parameters have constant size, and other ranges are kept if they are large enough.
+		const VkDeviceSize geometry_size = indirect_offset + sizeof(IndirectCommand::VkDrawIndexedIndirectCommand),
+			//at most every chunk is visible, with a draw count in front
+			draw_size = (sizeof(uint32_t) + chunk_count * sizeof(IndirectCommand::VkDrawIndexedIndirectCommand))
+				* ctx.FrameInFlight;
+		if (!reuse) {
+			geo.Memory.InputParameter = this->Arena->allocate(sizeof(::PlaneInputParameter));
+		}
+		if (!reuse || geo.Memory.Geometry.Size < geometry_size) {
+			geo.Memory.Geometry = this->Arena->allocate(geometry_size);
+		}
+		if (!reuse || geo.Memory.Draw.Size < draw_size) {
+			geo.Memory.Draw = this->Arena->allocate(draw_size);
+		}
+		const VkDeviceSize base = geo.Memory.Geometry.Offset;
 
 		geo.Type = GeometryData::GeometryType::Plane;
 		geo.Attribute = {
 			.Offset = {
-				.Vertex = 0ull,
-				.Index = vertex_size,
-				.Indirect = vi_size
+				.Vertex = base,
+				.Index = base + vertex_size,
+				.Indirect = base + indirect_offset,
+				.Chunk = base + chunk_offset
 			},
 			.Count = {
 				.Primitive = primitive_count,
-				.Vertex = vertex_count
+				.Vertex = vertex_count,
+				.Chunk = chunk_count
 			},
-			.Stride = static_cast<VkDeviceSize>(sizeof(::VertexAttribute)),
+			.Stride = has_vertex ? static_cast<VkDeviceSize>(sizeof(::VertexAttribute)) : VkDeviceSize { 0 },
 			.Type = {
-				.Vertex = ::VertexFormat,
-				.Index = VK_INDEX_TYPE_UINT32
+				.Vertex = has_vertex ? ::VertexFormat : VK_FORMAT_UNDEFINED,
+				.Index = prop.IndexType
 			}
 		};
-		geo.PrivateData.emplace<::PlanePrivateData>(::PlanePrivateData {
-			.ThreadCount = plane_attr.ThreadCount
-		});
-
-		geo.Command = createPlaneCommandBuffer(ctx.Device, ctx.CommandPool.General);
-
-		//TODO: As an optimisation, we can check if the input geometry data was previously used as the same geometry type,
-		//(in this case, plane geometry). If so, we don't need to reallocate memory for input parameters and its descriptor buffer,
-		//since the size is constant.
-		//If this approach is taken, remember to check if the temporary memories are released.
-		geo.Memory = {
-			.Geometry = createPlaneGeometryDataBuffer(ctx.Device, ctx.Allocator,
-				vi_size + sizeof(IndirectCommand::VkDrawIndexedIndirectCommand), prop.RequireAccelStructInput),
-			.InputParameter = BufferManager::createDeviceBuffer({ ctx.Device, ctx.Allocator, sizeof(::PlaneInputParameter) },
-				VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+		const ::PlanePrivateData private_data {
+			.ThreadCount = plane_attr.ThreadCount,
+			.VertexAttribute = has_vertex,
+			.Parameter = plane_input_param
 		};
+		//avoid reallocating the type-erased storage
+		if (reuse) {
+			std::any_cast<::PlanePrivateData&>(geo.PrivateData) = private_data;
+		} else {
+			geo.PrivateData.emplace<::PlanePrivateData>(private_data);
+		}
+
+		//generation is done asynchronously on the compute queue
+		if (!reuse) {
+			geo.Command = createPlaneCommandBuffer(ctx.Device, ctx.CommandPool.ComputeGeneral);
+		}
 	}
 	const VkCommandBuffer copy_cmd = geo.Command[PLANE_COMMAND_BUFFER_INDEX(Generate)];
 	/***************************************
 	 * Prepare plane input parameter buffer
 	 ***************************************/
 	{
+		if (reuse) {
+			CHECK_VULKAN_ERROR(vkResetCommandBuffer(copy_cmd, { }));
+		}
 		CommandBufferManager::beginOneTimeSubmitSecondary(copy_cmd);
 
 		/*******************
 		 * Copy to device
 		 ******************/
-		BufferManager::recordCopyBuffer(input_param_staging.second, geo.Memory.InputParameter.second, copy_cmd, sizeof(::PlaneInputParameter));
+		const BufferArena::Range& input_param = geo.Memory.InputParameter;
+		if (reuse) {
+			vkCmdUpdateBuffer(copy_cmd, input_param.Buffer, input_param.Offset, sizeof(::PlaneInputParameter), &plane_input_param);
+		} else {
+			BufferManager::recordCopyBuffer(input_param_staging.second, input_param.Buffer, copy_cmd, sizeof(::PlaneInputParameter),
+				input_param.Offset);
+		}
 		
 		PipelineBarrier<0u, 1u, 0u> barrier;
 		barrier.addBufferBarrier({
-			VK_PIPELINE_STAGE_2_COPY_BIT,
+			//buffer update is a clear command
+			reuse ? VK_PIPELINE_STAGE_2_CLEAR_BIT : VK_PIPELINE_STAGE_2_COPY_BIT,
 			VK_ACCESS_2_TRANSFER_WRITE_BIT,
 			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
 			VK_ACCESS_2_SHADER_STORAGE_READ_BIT
-		}, geo.Memory.InputParameter.second);
+		}, { }, input_param.Buffer, input_param.Offset, input_param.Size);
 		barrier.record(copy_cmd);
 	}
 	/*****************************
 	 * Prepare descriptor buffer
 	 ****************************/
-	{
+	//the descriptor refers to the input parameter range, which is unchanged when reused
+	if (!reuse) {
 		const auto plane_ds_layout = array { *this->DescriptorSet.PlaneProperty };
 		geo.InputParameterDescriptorBuffer = DescriptorBufferManager(ctx, plane_ds_layout,
 			VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT);
 
 		const VkDescriptorAddressInfoEXT storage_addr {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
-			.address = BufferManager::addressOf(ctx.Device, geo.Memory.InputParameter.second),
+			.address = geo.Memory.InputParameter.Address,
 			.range = sizeof(::PlaneInputParameter)
 		};
 
-		const DescriptorBufferManager::DescriptorUpdater plane_updater = geo.InputParameterDescriptorBuffer.createUpdater(ctx);
+		DescriptorBufferManager::DescriptorUpdater plane_updater = geo.InputParameterDescriptorBuffer.createUpdater(ctx);
 		plane_updater.update({
 			.SetLayout = this->DescriptorSet.PlaneProperty,
 			.SetIndex = 0u,
@@ -410,31 +511,54 @@ inline void PlaneGeometry::bindDescriptorBuffer(const VkDevice device, const VkC
 		0u, 1u, &buf_idx, geo.InputParameterDescriptorBuffer.offset().data());
 }
 
+inline void PlaneGeometry::pushDisplacementMap(const VkCommandBuffer cmd, const VkPipelineLayout layout,
+	const Displacement& disp) noexcept {
+	const VkWriteDescriptorSet disp_map {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.dstBinding = 0u,
+		.dstArrayElement = 0u,
+		.descriptorCount = 1u,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.pImageInfo = &disp.DisplacementMap
+	};
+	vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 1u, 1u, &disp_map);
+}
+
 inline void PlaneGeometry::dispatch(const VkCommandBuffer cmd, const GeometryData& geo, const uint32_t workgroup_count_z) {
-	const uvec2 workgroup_count = (std::any_cast<const ::PlanePrivateData&>(geo.PrivateData).ThreadCount
-		+ ::GeneratorLocalSize - 1u) / ::GeneratorLocalSize;
+	PlaneGeometry::dispatch(cmd, std::any_cast<const ::PlanePrivateData&>(geo.PrivateData).ThreadCount, workgroup_count_z);
+}
+
+inline void PlaneGeometry::dispatch(const VkCommandBuffer cmd, const uvec2& thread_count, const uint32_t workgroup_count_z) {
+	const uvec2 workgroup_count = (thread_count + ::GeneratorLocalSize - 1u) / ::GeneratorLocalSize;
 	vkCmdDispatch(cmd, workgroup_count.x, workgroup_count.y, workgroup_count_z);
 }
 
-PlaneGeometry::PlaneGeometry(const VulkanContext& ctx, ostream& msg) :
+PlaneGeometry::PlaneGeometry(const VulkanContext& ctx, BufferArena& arena, ostream& msg) :
+	Arena(&arena),
 	DescriptorSet {
 		.PlaneProperty = createPlanePropertyDescriptorSetLayout(ctx.Device),
 		.DisplacementMap = createPlaneDisplacementMapDescriptorSetLayout(ctx.Device)
 	},
 	PipelineLayout {
-		.Generator = createPlanePipelineLayout<::GenerateInfo>(ctx.Device, array { *this->DescriptorSet.PlaneProperty }),
+		//the displacement map is statically used by the generator, even if it is only bound when displacement is fused
+		.Generator = createPlanePipelineLayout<::GenerateInfo>(ctx.Device, array {
+			*this->DescriptorSet.PlaneProperty,
+			*this->DescriptorSet.DisplacementMap
+		}),
 		.Displacer = createPlanePipelineLayout<::DisplaceInfo>(ctx.Device, array {
 			*this->DescriptorSet.PlaneProperty,
 			*this->DescriptorSet.DisplacementMap
 		})
 	} {
 	const auto& [gen_layout, disp_layout] = this->PipelineLayout;
-	auto [gen_pipeline, disp_pipeline] = createPlanePipeline(ctx.Device, array { *gen_layout, *disp_layout }, msg);
+	auto [gen_pipeline, disp_pipeline, fused_gen_pipeline] = createPlanePipeline(ctx.Device, ctx.PipelineCache,
+		array { *gen_layout, *disp_layout, *gen_layout }, msg);
 
 	using std::move;
 	this->Pipeline = {
 		.Generator = move(gen_pipeline),
-		.Displacer = move(disp_pipeline)
+		.Displacer = move(disp_pipeline),
+		.FusedGenerator = move(fused_gen_pipeline)
 	};
 }
 
@@ -469,40 +593,64 @@ PlaneGeometry::VertexInput PlaneGeometry::vertexInput(const VertexInputCustomisa
 	};
 }
 
-VkCommandBuffer PlaneGeometry::generate(const VulkanContext& ctx, const Property& prop, GeometryData& geo) const {
+VkCommandBuffer PlaneGeometry::recordGeneration(const VulkanContext& ctx, const Property& prop, const Displacement* const disp,
+	GeometryData& geo) const {
 	const VkCommandBuffer cmd = this->prepareGeometryData(ctx, prop, geo);
 	const VkDevice device = ctx.Device;
 	
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->Pipeline.Generator);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, disp ? this->Pipeline.FusedGenerator : this->Pipeline.Generator);
 	PlaneGeometry::bindDescriptorBuffer(device, cmd, this->PipelineLayout.Generator, geo);
 
 	///////////////////////////
 	/// Prepare input argument
 	///////////////////////////
-	const VkDeviceAddress output = BufferManager::addressOf(device, geo.Memory.Geometry.second);
-	const auto [vertex_offset, index_offset, cmd_offset] = geo.Attribute.Offset;
+	const VkDeviceAddress output = BufferManager::addressOf(device, geo.Memory.Geometry.Buffer);
+	const auto [vertex_offset, index_offset, cmd_offset, chunk_offset] = geo.Attribute.Offset;
 	const ::GenerateInfo gen_info {
 		output + vertex_offset,
 		output + index_offset,
-		output + cmd_offset
+		output + cmd_offset,
+		output + chunk_offset,
+		disp ? disp->Altitude : 0.0f
 	};
 	vkCmdPushConstants(cmd, this->PipelineLayout.Generator, VK_SHADER_STAGE_COMPUTE_BIT, 0u,
 		static_cast<uint32_t>(sizeof(gen_info)), &gen_info);
+	if (disp) {
+		PlaneGeometry::pushDisplacementMap(cmd, this->PipelineLayout.Generator, *disp);
+	}
 
 	//////////////
 	/// Dispatch
 	//////////////
-	//Z-axis has dimension of 2, one for vertex and the other for index.
-	PlaneGeometry::dispatch(cmd, geo, 2u);
+	//Z-axis has dimension of 3, for chunk, vertex and index respectively.
+	//There are never more chunks than vertices, so the same thread count suffices.
+	//Without vertex attribute, only chunks are generated, and thread count is reduced to the number of chunk.
+	PlaneGeometry::dispatch(cmd, geo, prop.IndexType != VK_INDEX_TYPE_NONE_KHR ? 3u : 1u);
 
 	CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
 	return cmd;
 }
 
-VkCommandBuffer PlaneGeometry::displace(const VulkanContext& ctx, const Displacement& disp, GeometryData& geo) const {
+VkCommandBuffer PlaneGeometry::generate(const VulkanContext& ctx, const Property& prop, GeometryData& geo) const {
+	return this->recordGeneration(ctx, prop, nullptr, geo);
+}
+
+VkCommandBuffer PlaneGeometry::generate(const VulkanContext& ctx, const Property& prop, const Displacement& disp,
+	GeometryData& geo) const {
+	if (prop.IndexType == VK_INDEX_TYPE_NONE_KHR) {
+		throw std::runtime_error("Cannot perform displacement on plane geometry without vertex attribute.");
+	}
+	return this->recordGeneration(ctx, prop, &disp, geo);
+}
+
+VkCommandBuffer PlaneGeometry::recordDisplacement(const VulkanContext& ctx, const Displacement& disp, const uvec2& origin,
+	const uvec2& extent, GeometryData& geo) const {
 	if (geo.Type != GeometryData::GeometryType::Plane) {
 		throw std::runtime_error("Cannot perform displacement on non-plane geometry.");
 	}
+	if (!std::any_cast<const ::PlanePrivateData&>(geo.PrivateData).VertexAttribute) {
+		throw std::runtime_error("Cannot perform displacement on plane geometry without vertex attribute.");
+	}
 	const VkCommandBuffer cmd = geo.Command[PLANE_COMMAND_BUFFER_INDEX(Displace)];
 	const VkDevice device = ctx.Device;
 
@@ -515,29 +663,85 @@ VkCommandBuffer PlaneGeometry::displace(const VulkanContext& ctx, const Displace
 	//////////////////
 	/// Shader input
 	//////////////////
-	const VkDeviceAddress addr = BufferManager::addressOf(device, geo.Memory.Geometry.second);
+	const VkDeviceAddress addr = BufferManager::addressOf(device, geo.Memory.Geometry.Buffer);
 	const ::DisplaceInfo disp_info {
 		addr + geo.Attribute.Offset.Vertex,
+		origin,
+		extent,
 		disp.Altitude
 	};
 	vkCmdPushConstants(cmd, this->PipelineLayout.Displacer, VK_SHADER_STAGE_COMPUTE_BIT, 0u,
 		static_cast<uint32_t>(sizeof(disp_info)), &disp_info);
 
-	const VkWriteDescriptorSet disp_map {
-		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-		.dstBinding = 0u,
-		.dstArrayElement = 0u,
-		.descriptorCount = 1u,
-		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-		.pImageInfo = &disp.DisplacementMap
-	};
-	vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, this->PipelineLayout.Displacer, 1u, 1u, &disp_map);
+	PlaneGeometry::pushDisplacementMap(cmd, this->PipelineLayout.Displacer, disp);
 
 	/////////////
 	/// Dispatch
 	/////////////
-	PlaneGeometry::dispatch(cmd, geo, 1u);
+	//only workgroups covering the region are dispatched
+	PlaneGeometry::dispatch(cmd, extent, 1u);
 
 	CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
 	return cmd;
+}
+
+VkCommandBuffer PlaneGeometry::displace(const VulkanContext& ctx, const Displacement& disp, GeometryData& geo) const {
+	const uvec2 vertex_dimension = geo.Type == GeometryData::GeometryType::Plane
+		? std::any_cast<const ::PlanePrivateData&>(geo.PrivateData).ThreadCount : uvec2(0u);
+	return this->recordDisplacement(ctx, disp, uvec2(0u), vertex_dimension, geo);
+}
+
+PlaneGeometry::RegionDisplacementResult PlaneGeometry::displace(const VulkanContext& ctx, const Displacement& disp,
+	const DisplacementRegion& region, GeometryData& geo) const {
+	const auto [region_min, region_max] = region;
+	if (glm::any(glm::greaterThan(region_min, region_max))) {
+		throw std::runtime_error("The minimum of displacement region must not be greater than its maximum.");
+	}
+	if (geo.Type != GeometryData::GeometryType::Plane) {
+		throw std::runtime_error("Cannot perform displacement on non-plane geometry.");
+	}
+	const ::PlaneInputParameter& param = std::any_cast<const ::PlanePrivateData&>(geo.PrivateData).Parameter;
+
+	/*******************************
+	 * Find the stored vertex grid
+	 ******************************/
+	//every vertex on the plane within the region, inclusive
+	const uvec2 location_min = uvec2(glm::clamp(glm::floor(region_min * param.TotPln), dvec2(0.0), param.TotPln)),
+		location_max = uvec2(glm::clamp(glm::ceil(region_max * param.TotPln), dvec2(0.0), param.TotPln));
+	uvec2 grid_min = location_min, grid_max = location_max;
+	if (param.IdxSz < 4u) {
+		//vertices on chunk borders are duplicated, the first one is stored in the previous chunk
+		const uvec2 chunk_sub = param.ChkSub,
+			chunk_vertex = chunk_sub + 1u;
+		grid_min = location_min / chunk_sub * chunk_vertex + location_min % chunk_sub;
+		grid_min -= uvec2(glm::greaterThan(location_min, uvec2(0u)) && glm::equal(location_min % chunk_sub, uvec2(0u)));
+		//the last vertex on the plane is only stored in the last chunk
+		grid_max = glm::min(location_max / chunk_sub * chunk_vertex + location_max % chunk_sub, param.VerDim - 1u);
+	}
+	const uvec2 extent = grid_max - grid_min + 1u;
+
+	/***********************
+	 * Report dirty range
+	 **********************/
+	//the first and the last vertex of the region bound every vertex in between regardless of layout,
+	//because chunks and vertices in each chunk are both stored in row-major order
+	const auto calcVertexIndex = [&param](const uvec2& id) noexcept -> uint32_t {
+		if (param.IdxSz < 4u) {
+			const uvec2 chunk_vertex = param.ChkSub + 1u,
+				chunk = id / chunk_vertex,
+				local = id % chunk_vertex;
+			return (chunk.x + chunk.y * param.ChkCnt.x) * (chunk_vertex.x * chunk_vertex.y) + local.x + local.y * chunk_vertex.x;
+		}
+		return id.x + id.y * param.VerDim.x;
+	};
+	const uint32_t first_vertex = calcVertexIndex(grid_min),
+		vertex_count = calcVertexIndex(grid_max) - first_vertex + 1u;
+
+	return {
+		.Command = this->recordDisplacement(ctx, disp, grid_min, extent, geo),
+		.FirstVertex = first_vertex,
+		.VertexCount = vertex_count,
+		.Offset = geo.Attribute.Offset.Vertex + first_vertex * geo.Attribute.Stride,
+		.Size = vertex_count * geo.Attribute.Stride
+	};
 }
\ No newline at end of file
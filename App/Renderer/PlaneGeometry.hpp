@@ -2,6 +2,7 @@
 
 #include "GeometryData.hpp"
 
+#include "../Engine/BufferArena.hpp"
 #include "../Engine/VulkanContext.hpp"
 #include "../Common/VulkanObject.hpp"
 #include "../Common/FixedArray.hpp"
@@ -28,8 +29,36 @@ namespace LearnVulkan {
 
 			glm::dvec2 Dimension;
 			glm::uvec2 Subdivision;
-			//Specify that if the generated geometry data will be used for building a GAS.
+			/**
+			 * @brief The number of subdivision in each chunk, which must divide the subdivision.
+			 * Indices are grouped by chunk, and each chunk has a bound and a range of index for culling and drawing.
+			 * If zero, the whole plane is a single chunk.
+			*/
+			glm::uvec2 ChunkSubdivision;
+			/**
+			 * @brief The type of index of the generated geometry.
+			 * If none, neither vertex nor index is generated but only chunks and the plane property,
+			 * and the plane should be drawn without vertex and index input;
+			 * vertices are reconstructed from the plane property, see `PlaneGeometryAttribute.glsl`.
+			 * 32-bit index is global to the plane.
+			 * 16-bit and 8-bit index are local to each chunk, whose vertices are stored contiguously,
+			 * with vertices on chunk borders duplicated, and the vertex offset of each chunk is given in its draw command.
+			 * The number of vertex in each chunk must be addressable by such index.
+			*/
+			VkIndexType IndexType = VK_INDEX_TYPE_NONE_KHR;
+			/**
+			 * @brief Specify that if the generated geometry data will be used for building a GAS.
+			 * The geometry must have 32-bit index, or 16-bit index with a single chunk.
+			*/
 			bool RequireAccelStructInput;
+			/**
+			 * @brief Generate in pooled mode, if the geometry data was generated as a plane before.
+			 * Command buffers, input parameters and their descriptor buffer are reused, and parameters are updated inline,
+			 * other memory is reused if it is large enough for the new property, such that regenerating a plane of
+			 * the same or smaller size allocates nothing.
+			 * Geometry data are otherwise initialised from scratch, as if pooled mode is disabled.
+			*/
+			bool Reuse = false;
 
 		};
 
@@ -43,8 +72,33 @@ namespace LearnVulkan {
 
 		};
 
+		/**
+		 * @brief A rectangular region of the plane to be displaced, in UV.
+		 * The region should cover the filter footprint of every modified texel of the displacement map.
+		*/
+		struct DisplacementRegion {
+
+			glm::dvec2 Min, Max;
+
+		};
+
+		/**
+		 * @brief The result of displacing a region of the plane.
+		*/
+		struct RegionDisplacementResult {
+
+			VkCommandBuffer Command;/**< The displacement command buffer, owned by geometry data. */
+			//The range of vertex that may have been modified, such that the last vertex is at index first + count - 1.
+			//Vertices outside the region may be included in the range, but are left unchanged.
+			uint32_t FirstVertex, VertexCount;
+			VkDeviceSize Offset, Size;/**< The same vertex range in byte, in the geometry data buffer. */
+
+		};
+
 	private:
 
+		BufferArena* const Arena;
+
 		const struct {
 		
 			VulkanObject::DescriptorSetLayout PlaneProperty, DisplacementMap;
@@ -57,7 +111,9 @@ namespace LearnVulkan {
 		} PipelineLayout;
 		struct {
 			
-			VulkanObject::Pipeline Generator, Displacer;
+			VulkanObject::Pipeline Generator, Displacer,
+				//Same as the generator, but also displaces vertices, using the generator layout.
+				FusedGenerator;
 		
 		} Pipeline;
 
@@ -76,12 +132,29 @@ namespace LearnVulkan {
 		*/
 		static void bindDescriptorBuffer(VkDevice, VkCommandBuffer, VkPipelineLayout, const GeometryData&) noexcept;
 
+		/**
+		 * @brief Push the displacement map descriptor to set 1.
+		*/
+		static void pushDisplacementMap(VkCommandBuffer, VkPipelineLayout, const Displacement&) noexcept;
+
 		/**
 		 * @brief Dispatch compute on a geometry data.
 		 * The last argument specify the number workgroup in Z-axis.
 		*/
 		static void dispatch(VkCommandBuffer, const GeometryData&, uint32_t);
 
+		/**
+		 * @brief Dispatch compute with a given number of thread in X and Y axis.
+		*/
+		static void dispatch(VkCommandBuffer, const glm::uvec2&, uint32_t);
+
+		//Record plane generation, and displace vertices in the same pass if displacement is not null.
+		VkCommandBuffer recordGeneration(const VulkanContext&, const Property&, const Displacement*, GeometryData&) const;
+
+		//Record displacement of a region of the stored vertex grid, given by its origin and extent.
+		VkCommandBuffer recordDisplacement(const VulkanContext&, const Displacement&, const glm::uvec2&, const glm::uvec2&,
+			GeometryData&) const;
+
 	public:
 
 		constexpr static VkPipelineStageFlagBits2 DisplacementStage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
@@ -115,9 +188,11 @@ namespace LearnVulkan {
 		/**
 		 * @brief Initial the plane geometry generator.
 		 * @param ctx The vulkan context.
+		 * @param arena The arena where memory of generated geometry data is allocated from.
+		 * The arena must remain valid until all generated geometry data are destroyed.
 		 * @param msg A stream to receive diagnostic messages.
 		*/
-		PlaneGeometry(const VulkanContext&, std::ostream&);
+		PlaneGeometry(const VulkanContext&, BufferArena&, std::ostream&);
 
 		PlaneGeometry(const PlaneGeometry&) = delete;
 
@@ -142,23 +217,55 @@ namespace LearnVulkan {
 		 * @param ctx The context.
 		 * @param prop The plane property.
 		 * @param geo The output where geometry data will be stored.
-		 * All old data will be destroyed. The behaviour is undefined if
-		 * the geometry data is still being used a previously unfinished generate command.
+		 * All old data will be destroyed, or overwritten in pooled mode. The behaviour is undefined if
+		 * the geometry data is still being used a previously unfinished generate command,
+		 * or in pooled mode, by any pending command.
 		 * @return The generation command buffer, which is owned by geometry data, and which is a secondary command buffer.
+		 * It is allocated for the compute queue family and must be executed by a primary command buffer on the compute queue.
+		 * @exception If the chunk subdivision does not divide the subdivision, or the index type is not supported by the property.
 		*/
 		VkCommandBuffer generate(const VulkanContext&, const Property&, GeometryData&) const;
 
 		/**
-		 * @brief Displace each vertex in the plane geometry in vertical direction based on a displacement map.
+		 * @brief Initiate plane generation, and displace each vertex in the same pass.
+		 * The result is the same as generation followed by displacement, but vertices are only written once,
+		 * removing the barrier and the round trip of the vertex buffer between them.
+		 * Chunk bounds are not displaced, just like a separate displacement.
+		 * @param ctx The context.
+		 * @param prop The plane property.
+		 * @param disp The displacement info. The displacement map must be ready to be read in the displacement stage.
+		 * @param geo The output where geometry data will be stored.
+		 * @return The generation command buffer, with the same requirement as a generation without displacement.
+		 * @exception If the property is invalid, like generation without displacement, or has no vertex attribute.
+		*/
+		VkCommandBuffer generate(const VulkanContext&, const Property&, const Displacement&, GeometryData&) const;
+
+		/**
+		 * @brief Displace each vertex in an existing plane geometry in vertical direction based on a displacement map.
 		 * @param ctx The context.
 		 * @param disp The displacement info.
 		 * @param geo The geometry where displacement will be applied.
-		 * The geometry must be a valid plane geometry.
+		 * The geometry must be a valid plane geometry with vertex attribute.
 		 * @return The displacement command buffer, owned by geometry data.
-		 * @exception If the geometry data is not a valid plane geometry.
+		 * Like the generation command buffer, it must be executed on the compute queue.
+		 * @exception If the geometry data is not a valid plane geometry, or has no vertex attribute.
 		*/
 		VkCommandBuffer displace(const VulkanContext&, const Displacement&, GeometryData&) const;
 
+		/**
+		 * @brief Displace vertices within a region of the plane geometry only, such as after editing part of the displacement map.
+		 * Only workgroups covering the region are dispatched.
+		 * The command buffer is the same as the one used to displace the whole plane, and is re-recorded.
+		 * @param ctx The context.
+		 * @param disp The displacement info.
+		 * @param region The region of the plane to be displaced, which is clamped to the plane.
+		 * @param geo The geometry where displacement will be applied, with the same requirement as displacing the whole plane.
+		 * @return The displacement command buffer, and the range of vertex that may have been modified,
+		 * which can be used to limit subsequent barriers and acceleration structure refit.
+		 * @exception If the region is invalid, or the geometry data is not a valid plane geometry, or has no vertex attribute.
+		*/
+		RegionDisplacementResult displace(const VulkanContext&, const Displacement&, const DisplacementRegion&, GeometryData&) const;
+
 	};
 
 }
\ No newline at end of file
@@ -13,17 +13,19 @@
 #include "../Engine/Abstraction/SemaphoreManager.hpp"
 #include "../Engine/Abstraction/ShaderModuleManager.hpp"
 #include "../Engine/EngineSetting.hpp"
+#include "../Engine/IndirectCommand.hpp"
+#include "../Engine/StartupGraph.hpp"
 
 #include <shaderc/shaderc.h>
 
-#include <initializer_list>
 #include <array>
 #include <string_view>
+#include <optional>
+#include <utility>
 
 #include <execution>
 #include <numeric>
 #include <algorithm>
-#include <ranges>
 #include <limits>
 
 #include <stdexcept>
@@ -34,13 +36,13 @@
 #include <glm/vec4.hpp>
 #include <glm/mat3x4.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
 
 using glm::uvec2, glm::vec2, glm::dvec2;
 using glm::mat4;
 
 using std::array, std::span, std::string_view;
-using std::tuple, std::make_tuple;
-using std::views::iota, std::ranges::transform;
+using std::pair, std::optional, std::nullopt;
 using std::ostream, std::endl, std::runtime_error;
 
 using namespace LearnVulkan;
@@ -52,6 +54,15 @@ namespace {
 	constexpr VkFormat ColourFormat = VK_FORMAT_R8G8B8A8_UNORM,
 		DepthFormat = VK_FORMAT_D32_SFLOAT;
 
+	constexpr FramebufferManager::PrepareFramebufferInfo TerrainPrepareInfo {
+		.DepthLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
+	};
+	constexpr SimpleWater::SceneDepthRecordInfo TerrainSceneDepthRecordInfo {
+		.Stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+		.Access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+		.Layout = TerrainPrepareInfo.DepthLayout
+	};
+
 	/*******************
 	 * Uniform
 	 ******************/
@@ -70,7 +81,8 @@ namespace {
 		} TerrainTransform;
 		alignas(float) struct {
 
-			float A = 15.5f, B = 3.5f, C = 389.5f, D = 87.5f;
+			float MinLevel = 1.0f, MaxLevel = 32.0f,
+				EdgeLength = 14.5f;/**< In pixel. */
 
 		} TessellationSetting;
 		alignas(float) struct {
@@ -81,8 +93,32 @@ namespace {
 
 	} TerrainUniformData = { };
 
+	//indices are in the descriptor heap
+	struct TerrainPushConstant {
+
+		uint32_t Transform, Tessellation, Displacement, HeightfieldTexture, HeightfieldSampler, PlaneProperty;
+		VkDeviceAddress Clipmap;
+
+	};
+	constexpr VkShaderStageFlags TerrainPushConstantStage = VK_SHADER_STAGE_VERTEX_BIT
+		| VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT | VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		TerrainMeshPushConstantStage = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	//Stages where terrain data are read, other than fragment shader.
+	constexpr VkPipelineStageFlags2 TerrainGeometryStage = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT
+		| VK_PIPELINE_STAGE_2_TESSELLATION_CONTROL_SHADER_BIT | VK_PIPELINE_STAGE_2_TESSELLATION_EVALUATION_SHADER_BIT,
+		TerrainMeshGeometryStage = VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+
+	constexpr VkShaderStageFlags getTerrainPushConstantStage(const bool mesh_shader) noexcept {
+		return mesh_shader ? ::TerrainMeshPushConstantStage : ::TerrainPushConstantStage;
+	}
+
+	constexpr VkPipelineStageFlags2 getTerrainGeometryStage(const bool mesh_shader) noexcept {
+		return mesh_shader ? ::TerrainMeshGeometryStage : ::TerrainGeometryStage;
+	}
+
 	constexpr auto TerrainSize = dvec2(1755.5);
 	constexpr auto TerrainSubdivision = uvec2(20u),
+		TerrainChunkSubdivision = uvec2(4u),
 		AccelStructTerrainSubdivision = uvec2(80u);
 
 	/*********************
@@ -96,10 +132,27 @@ namespace {
 	constexpr auto TerrainShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, TerrainVS, TerrainTEC, TerrainTEE, TerrainFS>();
 	constexpr auto TerrainShaderFilename = File::batchRawStringToView(TerrainShaderFilenameRaw);
 
+	//mesh shading replaces vertex and tessellation, and shares the same fragment shader
+	constexpr string_view TerrainTS = "/SimpleTerrain.task", TerrainMS = "/SimpleTerrain.mesh";
+	constexpr array TerrainMeshShaderKind = { shaderc_task_shader, shaderc_mesh_shader, shaderc_fragment_shader };
+
+	constexpr auto TerrainMeshShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, TerrainTS, TerrainMS, TerrainFS>();
+	constexpr auto TerrainMeshShaderFilename = File::batchRawStringToView(TerrainMeshShaderFilenameRaw);
+
 	/********************
 	 * Setup
 	 *******************/
-	inline ShaderModuleManager::ShaderOutputGenerator compileTerrainShader(const VkDevice device, ostream& out) {
+	inline ShaderModuleManager::ShaderOutputGenerator compileTerrainShader(const VkDevice device, const bool mesh_shader, ostream& out) {
+		if (mesh_shader) {
+			out << "Compiling terrain mesh shader" << endl;
+
+			const ShaderModuleManager::ShaderBatchCompilationInfo terrain_mesh_info {
+				.Device = device,
+				.ShaderFilename = TerrainMeshShaderFilename.data(),
+				.ShaderKind = TerrainMeshShaderKind.data()
+			};
+			return ShaderModuleManager::batchShaderCompilation<TerrainMeshShaderFilename.size()>(&terrain_mesh_info, &out);
+		}
 		out << "Compiling terrain shader" << endl;
 
 		const ShaderModuleManager::ShaderBatchCompilationInfo terrain_info {
@@ -111,64 +164,32 @@ namespace {
 	}
 
 	template<size_t LayoutCount>
-	inline VKO::PipelineLayout createTerrainPipelineLayout(const VkDevice device, const array<VkDescriptorSetLayout, LayoutCount>& ds_layout) {
+	inline VKO::PipelineLayout createTerrainPipelineLayout(const VkDevice device, const array<VkDescriptorSetLayout, LayoutCount>& ds_layout,
+		const bool mesh_shader) {
+		const VkPushConstantRange terrain_pc {
+			.stageFlags = ::getTerrainPushConstantStage(mesh_shader),
+			.offset = 0u,
+			.size = static_cast<uint32_t>(sizeof(::TerrainPushConstant))
+		};
 		const VkPipelineLayoutCreateInfo terrain_layout {
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 			.setLayoutCount = static_cast<uint32_t>(ds_layout.size()),
-			.pSetLayouts = ds_layout.data()
+			.pSetLayouts = ds_layout.data(),
+			.pushConstantRangeCount = 1u,
+			.pPushConstantRanges = &terrain_pc
 		};
 		return VKO::createPipelineLayout(device, terrain_layout);
 	}
 
-	inline VKO::DescriptorSetLayout createTerrainDescriptorSetLayout(const VkDevice device) {
-		constexpr static size_t BindingCount = 4u;
-		constexpr static auto terrain_ds_info = array<tuple<VkDescriptorType, VkShaderStageFlags>, BindingCount> {
-			tuple { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT },
-			tuple { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT },
-			tuple { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT },
-			tuple { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT | VK_SHADER_STAGE_FRAGMENT_BIT },
-		};
+	using TerrainPipeline = pair<PipelineManager::GraphicsPipelineLibrary::LinkedPipeline,
+		optional<PipelineManager::GraphicsPipelineLibrary::LinkedPipeline>>;
 
-		array<VkDescriptorSetLayoutBinding, BindingCount> terrain_binding;
-		transform(iota(size_t { 0 }, terrain_binding.size()), terrain_ds_info, terrain_binding.begin(), [](const auto i, const auto& info) {
-			const auto [type, shader] = info;
-			return 	VkDescriptorSetLayoutBinding {
-				.binding = static_cast<uint32_t>(i),
-				.descriptorType = type,
-				.descriptorCount = 1u,
-				.stageFlags = shader
-			};
-		});
-		
-		const VkDescriptorSetLayoutCreateInfo terrain_ds_layout {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT,
-			.bindingCount = static_cast<uint32_t>(BindingCount),
-			.pBindings = terrain_binding.data()
-		};
-		return VKO::createDescriptorSetLayout(device, terrain_ds_layout);
-	}
-
-	VKO::Pipeline createTerrainGraphicsPipeline(const VkDevice device, const VkPipelineLayout layout, ostream& out) {
-		const auto terrain_shader_gen = compileTerrainShader(device, out);
-
-		////////////////////////////
-		/// Vertex input state
-		///////////////////////////
-		const auto [terrain_vertex_binding, terrain_vertex_attribute] = PlaneGeometry::vertexInput({
-			.BindingIndex = 0u,
-			.Location = {
-				.Position = 0u,
-				.UV = 1u
-			}
-		});
-		const VkPipelineVertexInputStateCreateInfo terrain_vertex_input {
-			.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-			.vertexBindingDescriptionCount = 1u,
-			.pVertexBindingDescriptions = &terrain_vertex_binding,
-			.vertexAttributeDescriptionCount = static_cast<uint32_t>(terrain_vertex_attribute.size()),
-			.pVertexAttributeDescriptions = terrain_vertex_attribute.data()
-		};
+	TerrainPipeline createTerrainGraphicsPipeline(const VkDevice device, PipelineManager::GraphicsPipelineLibrary& library,
+		const VkPipelineLayout layout, const bool mesh_shader, const bool depth_pre_pass, ostream& out) {
+		const StartupGraph::Step step("Pipeline creation");
+		using PipelineManager::DepthComparator;
+		const auto terrain_shader_gen = compileTerrainShader(device, mesh_shader, out);
+		const span<const VkPipelineShaderStageCreateInfo> terrain_stage = terrain_shader_gen.promise().ShaderStage;
 
 		////////////////////
 		/// Create pipeline
@@ -180,32 +201,57 @@ namespace {
 			.depthAttachmentFormat = ::DepthFormat
 		};
 
-		return PipelineManager::createSimpleGraphicsPipeline(device, layout, {
-			.ShaderStage = terrain_shader_gen.promise().ShaderStage,
-			.VertexInputState = &terrain_vertex_input,
+		PipelineManager::SimpleGraphicsPipelineCreateInfo terrain_info {
+			//vertices are reconstructed from the plane property
+			.ShaderStage = terrain_stage,
 			.Rendering = &terrain_rendering,
-			.PrimitiveTopology = VK_PRIMITIVE_TOPOLOGY_PATCH_LIST,
+			//topology is ignored by mesh shading
+			.PrimitiveTopology = mesh_shader ? VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST : VK_PRIMITIVE_TOPOLOGY_PATCH_LIST,
 			.Sample = TerrainSampleCount
-		});
-	}
+		};
+		if (!depth_pre_pass) {
+			return { library.createPipeline(layout, terrain_info), nullopt };
+		}
 
-	inline VKO::BufferAllocation createTerrainUniformBuffer(const VkDevice device, const VmaAllocator allocator) {
-		return BufferManager::createDeviceBuffer({ device, allocator, sizeof(::TerrainUniform) },
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
-		);
+		//depth pre-pass has no fragment shader and writes no colour, but shares the other parts of the shading pipeline,
+		//so the pre-rasterisation library is reused and depth of every sample is identical
+		constexpr static VkPipelineColorBlendAttachmentState depth_only_blend { };
+		PipelineManager::SimpleGraphicsPipelineCreateInfo depth_info = terrain_info;
+		//fragment shader is the last stage
+		depth_info.ShaderStage = terrain_stage.first(terrain_stage.size() - 1u);
+		depth_info.Blending = { &depth_only_blend, 1u };
+
+		//shading only passes fragments that are visible, and depth is left unchanged
+		terrain_info.Depth = {
+			.Write = false,
+			.Comparator = DepthComparator::Equal
+		};
+		return { library.createPipeline(layout, terrain_info), library.createPipeline(layout, depth_info) };
 	}
 
 }
 
 SimpleTerrain::SimpleTerrain(const VulkanContext& ctx, const TerrainCreateInfo& terrain_info) :
+	Context(&ctx),
 	OutputExtent { },
-
-	UniformBuffer(createTerrainUniformBuffer(ctx.Device, ctx.Allocator)),
-	
-	TerrainShaderLayout(createTerrainDescriptorSetLayout(this->getDevice())),
+	SceneDepthHistory(false),
+	MeshShader(terrain_info.MeshShader && ctx.Feature.MeshShader),
+
+	UniformBuffer(terrain_info.Arena->allocate(sizeof(::TerrainUniform))),
+	Clipmap(ctx, {
+		.Filename = terrain_info.Heightfield,
+		.Stage = ::getTerrainGeometryStage(this->MeshShader) | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+		.Heap = terrain_info.Heap,
+		.Uploader = terrain_info.Uploader,
+		.FrameMemory = terrain_info.FrameMemory
+	}),
 	
-	PipelineLayout(createTerrainPipelineLayout(this->getDevice(), array { terrain_info.CameraDescriptorSetLayout, *this->TerrainShaderLayout })),
-	Pipeline(createTerrainGraphicsPipeline(this->getDevice(), this->PipelineLayout, *terrain_info.DebugMessage)),
+	PipelineLayout(createTerrainPipelineLayout(this->getDevice(), array { terrain_info.CameraDescriptorSetLayout, terrain_info.Heap->descriptorSetLayout() },
+		this->MeshShader)),
+	Pipeline(createTerrainGraphicsPipeline(this->getDevice(), *terrain_info.PipelineLibrary, this->PipelineLayout,
+		this->MeshShader, terrain_info.DepthPrePass && !this->MeshShader, *terrain_info.DebugMessage)),
+	Culling(ctx, terrain_info.CameraDescriptorSetLayout, terrain_info.Heap->descriptorSetLayout(), *terrain_info.Arena,
+		*terrain_info.DebugMessage),
 	
 	TerrainDrawCmd(std::get<CommandBufferManager::InFlightCommandBufferArray>(
 		CommandBufferManager::allocateCommandBuffer(ctx, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
@@ -215,78 +261,83 @@ SimpleTerrain::SimpleTerrain(const VulkanContext& ctx, const TerrainCreateInfo&
 		CommandBufferManager::allocateCommandBuffer(ctx, VK_COMMAND_BUFFER_LEVEL_PRIMARY,
 			CommandBufferManager::CommandBufferType::Reshape)
 	)),
+	ProfileRegion(terrain_info.Profiler->registerRegion("Terrain", true)),
 	
 	SkyRenderer(ctx, DrawSky::SkyCreateInfo {
 		.CameraDescriptorSetLayout = terrain_info.CameraDescriptorSetLayout,
+		.Heap = terrain_info.Heap,
 		.OutputFormat = {
 			.ColourFormat = ::ColourFormat,
 			.DepthFormat = ::DepthFormat,
 			.Sample = ::TerrainSampleCount
 		},
 		.Cubemap = terrain_info.SkyInfo->SkyBox,
+		.Atmosphere = terrain_info.SkyInfo->Atmosphere,
+		.Profiler = terrain_info.Profiler,
+		.Uploader = terrain_info.Uploader,
+		.PipelineLibrary = terrain_info.PipelineLibrary,
 		.DebugMessage = terrain_info.DebugMessage
 	}) {
+	if (terrain_info.MeshShader && !this->MeshShader) {
+		*terrain_info.DebugMessage << "Mesh shader is not supported by the device, terrain is rendered with tessellation" << endl;
+	}
+	const VkPipelineStageFlags2 geometry_stage = ::getTerrainGeometryStage(this->MeshShader);
+
 	//needs to ensure the plane generator survives until generation is complete
-	const auto plane_generator = PlaneGeometry(ctx, *terrain_info.DebugMessage);
+	const auto plane_generator = PlaneGeometry(ctx, *terrain_info.Arena, *terrain_info.DebugMessage);
 	const bool render_water = terrain_info.WaterInfo != nullptr;
+	//geometry and acceleration structure are prepared on the compute queue, then handed over to the rendering queue
+	const PipelineBarrierInfo::QueueFamilyTransitionInfo compute_to_render {
+		.Source = ctx.QueueIndex.Compute,
+		.Target = ctx.QueueIndex.Render
+	};
 
 	VKO::QueryPool accel_struct_query;
-	const VKO::Semaphore copy_sema = SemaphoreManager::createTimelineSemaphore(this->getDevice(), 0ull);
-	const VKO::CommandBufferArray cmd_array = VKO::allocateCommandBuffers(this->getDevice(), {
+	const VKO::Semaphore compute_sema = SemaphoreManager::createTimelineSemaphore(this->getDevice(), 0ull),
+		render_sema = SemaphoreManager::createTimelineSemaphore(this->getDevice(), 0ull);
+	const VKO::CommandBuffer geometry_cmd = VKO::allocateCommandBuffer(this->getDevice(), {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = ctx.CommandPool.ComputeTransient,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1u
+	});
+	const VKO::CommandBuffer copy_cmd = VKO::allocateCommandBuffer(this->getDevice(), {
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
 		.commandPool = ctx.CommandPool.Transient,
 		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandBufferCount = 2u
+		.commandBufferCount = 1u
 	});
-	const VkCommandBuffer copy_cmd = cmd_array[0],
-		compact_cmd = cmd_array[1];
-
-	const auto submit_command = [device = this->getDevice(), queue = ctx.Queue.Render, sema = *copy_sema]
-		(const VkCommandBuffer cmd, const uint32_t timeline) {
-		CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
-		CommandBufferManager::submit<1u, 0u, 1u>({ device, queue }, { cmd }, {{ }},
-			{{{ sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, timeline }}}, VK_NULL_HANDLE);
-		SemaphoreManager::wait<1u>(device, { }, {{{ sema, timeline }}});
-	};
 
 	{
-		CommandBufferManager::beginOneTimeSubmit(copy_cmd);
-
-		/**********************
-		 * Prepare uniform
-		 *********************/
-		const VKO::BufferAllocation uniform_staging = BufferManager::createStagingBuffer(
-			{ this->getDevice(), this->getAllocator(), sizeof(TerrainUniformData) }, BufferManager::HostAccessPattern::Sequential);
-
-		VKO::MappedAllocation uni_data = VKO::mapAllocation<::TerrainUniform>(this->getAllocator(), uniform_staging.first);
-		*uni_data = TerrainUniformData;
-
-		/****************
-		 * Transfer
-		 ****************/
-		CHECK_VULKAN_ERROR(vmaFlushAllocation(this->getAllocator(), uniform_staging.first, VkDeviceSize { 0 }, VK_WHOLE_SIZE));
-		uni_data.reset();
-
-		BufferManager::recordCopyBuffer(uniform_staging.second, this->UniformBuffer.second, copy_cmd, sizeof(::TerrainUniformData));
+		//this memory needs to be preserved until all commands are finished by the device
+		AccelStructBuildTempMemory as_temp_mem;
+		CommandBufferManager::beginOneTimeSubmit(geometry_cmd);
 
 		/**********************
 		 * Prepare terrain map
 		 **********************/
+		//the coarsest level of heightfield is uploaded on the compute queue because it is needed by displacement before rendering
+		const ImageManager::ImageReadResult heightfield = this->Clipmap.readCoarseLevel();
 		const ImageManager::ImageCreateFromReadResultInfo terrain_map_read_info {
 			.Device = this->getDevice(),
 			.Allocator = this->getAllocator(),
 			//it's just a heightmap and normalmap, we don't need mipmaps for this
 			.Level = 1u,
-			.Usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			.Usage = terrain_info.Uploader->imageUsage(heightfield.Format, { }, VK_IMAGE_USAGE_SAMPLED_BIT),
 			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
 		};
-		this->Heightfield.Image = ImageManager::createImageFromReadResult(copy_cmd, *terrain_info.Heightfield, terrain_map_read_info);
+		//the host copies straight into the image if possible, which needs neither copy command nor barrier
+		const bool host_copy_heightfield = terrain_info.Uploader->canHostCopy(terrain_map_read_info.Usage,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		this->Heightfield.Image = host_copy_heightfield
+			? ImageManager::createImageFromReadResult(heightfield, terrain_map_read_info, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+			: ImageManager::createImageFromReadResult(geometry_cmd, heightfield, terrain_map_read_info);
 		
 		ImageManager::ImageViewCreateInfo heightfield_img_view_info {
 			.Device = this->getDevice(),
 			.Image = this->Heightfield.Image.second,
 			.ViewType = VK_IMAGE_VIEW_TYPE_2D,
-			.Format = terrain_info.Heightfield->Format,
+			.Format = heightfield.Format,
 			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
 		};
 		this->Heightfield.FullView = ImageManager::createFullImageView(heightfield_img_view_info);
@@ -318,44 +369,30 @@ SimpleTerrain::SimpleTerrain(const VulkanContext& ctx, const TerrainCreateInfo&
 		};
 		this->Heightfield.Sampler = VKO::createSampler(this->getDevice(), texture_sampler_info);
 
-		/*********************
-		 * Barrier
-		 ********************/
-		PipelineBarrier<0u, 1u, 1u> barrier;
-		//uniform data
-		barrier.addBufferBarrier({
-			VK_PIPELINE_STAGE_2_COPY_BIT,
-			VK_ACCESS_2_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT
-			| VK_PIPELINE_STAGE_2_TESSELLATION_CONTROL_SHADER_BIT
-			| VK_PIPELINE_STAGE_2_TESSELLATION_EVALUATION_SHADER_BIT
-			| VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-			VK_ACCESS_2_SHADER_STORAGE_READ_BIT
-		}, this->UniformBuffer.second);
-		
 		const VkImageSubresourceRange full_image = ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
-		//heightfield
-		barrier.addImageBarrier({
-			VK_PIPELINE_STAGE_2_COPY_BIT,
-			VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		if (!host_copy_heightfield) {
+			PipelineBarrier<0u, 0u, 1u> barrier;
 			//we will be using heightmap when displacing the plane later
-			//EBI: optionally include displacement stage and access flags only when we need to perform a displacement computation
-			VK_PIPELINE_STAGE_2_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT
-				| PlaneGeometry::DisplacementStage | SimpleWater::WaterCreateInfo::TextureStage,
-			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
-				| PlaneGeometry::DisplacementAccess | SimpleWater::WaterCreateInfo::TextureAccess
-		}, {
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		}, this->Heightfield.Image.second, full_image);
-		barrier.record(copy_cmd);
+			barrier.addImageBarrier({
+				VK_PIPELINE_STAGE_2_COPY_BIT,
+				VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				PlaneGeometry::DisplacementStage,
+				PlaneGeometry::DisplacementAccess
+			}, {
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			}, this->Heightfield.Image.second, full_image);
+			barrier.record(geometry_cmd);
+		}
 
 		/****************************
 		 * Prepare terrain geometry
 		 ***************************/
-		//this memory needs to be preserved until all commands are finished by the device
-		AccelStructBuildTempMemory as_temp_mem;
+		using enum GeometryData::BarrierTarget;
+		using enum GeometryData::OwnershipTransfer;
 		{
+			const StartupGraph::Step step("Geometry and BLAS recording");
+
 			///////////////
 			/// Generation
 			///////////////
@@ -363,74 +400,157 @@ SimpleTerrain::SimpleTerrain(const VulkanContext& ctx, const TerrainCreateInfo&
 
 			subcommand.pushBack(plane_generator.generate(ctx, {
 				.Dimension = ::TerrainSize,
-				.Subdivision = ::TerrainSubdivision
+				.Subdivision = ::TerrainSubdivision,
+				.ChunkSubdivision = ::TerrainChunkSubdivision
 			}, this->Plane));
 			if (render_water) {
-				//generate a plane for water scene acceleration structure using different LoD
+				//generate a displaced plane for water scene acceleration structure using different LoD
 				subcommand.pushBack(plane_generator.generate(ctx, {
 					.Dimension = ::TerrainSize,
 					.Subdivision = ::AccelStructTerrainSubdivision,
+					//a single chunk has few enough vertices for 16-bit index
+					.IndexType = VK_INDEX_TYPE_UINT16,
 					.RequireAccelStructInput = true
+				}, {
+					.Altitude = ::TerrainUniformData.DisplacementSetting.Alt,
+					.DisplacementMap = {
+						.sampler = this->Heightfield.Sampler,
+						.imageView = this->Heightfield.DisplacementSwizzleView,
+						.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+					}
 				}, this->AccelStructPlane));
 			}
 
-			vkCmdExecuteCommands(copy_cmd, static_cast<uint32_t>(subcommand.size()), subcommand.data());
+			vkCmdExecuteCommands(geometry_cmd, static_cast<uint32_t>(subcommand.size()), subcommand.data());
+
+			this->Plane.transferOwnership(geometry_cmd, Release, Generation, Rendering, compute_to_render);
 
 			//////////////////////
 			/// Prepare for water
 			//////////////////////
-			using enum GeometryData::BarrierTarget;
-			this->Plane.barrier(copy_cmd, Generation, Rendering);
-			
 			if (render_water) {
-				this->AccelStructPlane.barrier(copy_cmd, Generation, Displacement);
-
-				const VkCommandBuffer disp_cmd = plane_generator.displace(ctx, {
-					.Altitude = ::TerrainUniformData.DisplacementSetting.Alt,
-					.DisplacementMap = {
-						.sampler = this->Heightfield.Sampler,
-						.imageView = this->Heightfield.DisplacementSwizzleView,
-						.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-					}
-				}, this->AccelStructPlane);
-				vkCmdExecuteCommands(copy_cmd, 1u, &disp_cmd);
-
-				this->AccelStructPlane.barrier(copy_cmd, Displacement, AccelStructBuild);
+				this->AccelStructPlane.barrier(geometry_cmd, Generation, AccelStructBuild);
 
 				accel_struct_query = VKO::createQueryPool(this->getDevice(), {
 					.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
 					.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
 					.queryCount = 1u
 				});
-				vkCmdResetQueryPool(copy_cmd, accel_struct_query, 0u, 1u);
-				as_temp_mem = this->buildTerrainAccelStruct(ctx, copy_cmd, accel_struct_query);
+				vkCmdResetQueryPool(geometry_cmd, accel_struct_query, 0u, 1u);
+				as_temp_mem = this->buildTerrainAccelStruct(*terrain_info.WaterInfo->AccelStructMemory,
+					geometry_cmd, accel_struct_query);
 			}
 		}
+		{
+			//release heightfield to the rendering queue, the layout is unchanged
+			PipelineBarrier<0u, 0u, 1u> barrier;
+			barrier.addImageBarrier({
+				PlaneGeometry::DisplacementStage,
+				VK_ACCESS_2_NONE,
+				VK_PIPELINE_STAGE_2_NONE,
+				VK_ACCESS_2_NONE
+			}, {
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			}, compute_to_render, this->Heightfield.Image.second, full_image);
+			barrier.record(geometry_cmd);
+		}
+
+		CHECK_VULKAN_ERROR(vkEndCommandBuffer(geometry_cmd));
+		CommandBufferManager::submit<1u, 0u, 1u>({ this->getDevice(), ctx.Queue.Compute }, { geometry_cmd }, {{ }},
+			{{{ compute_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}}, VK_NULL_HANDLE);
+
+		/**********************
+		 * Prepare uniform
+		 *********************/
+		//uniform is only used for rendering, so it can be uploaded while geometry is being generated
+		StagingUploader& uploader = *terrain_info.Uploader;
+		uploader.upload({
+			.Destination = this->UniformBuffer.Buffer,
+			.Offset = this->UniformBuffer.Offset,
+			.Target = {
+				geometry_stage
+				| VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT
+				| VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+			}
+		}, std::as_bytes(span(&::TerrainUniformData, 1u)));
+		const StagingUploader::Ticket uniform_ticket = uploader.flush();
+
+		/*********************
+		 * Barrier
+		 ********************/
+		CommandBufferManager::beginOneTimeSubmit(copy_cmd);
+
+		PipelineBarrier<0u, 0u, 1u> barrier;
+		//acquire heightfield from the compute queue
+		barrier.addImageBarrier({
+			VK_PIPELINE_STAGE_2_NONE,
+			VK_ACCESS_2_NONE,
+			geometry_stage | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | SimpleWater::WaterCreateInfo::TextureStage,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | SimpleWater::WaterCreateInfo::TextureAccess
+		}, {
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		}, compute_to_render, this->Heightfield.Image.second, full_image);
+		barrier.record(copy_cmd);
+		this->Plane.transferOwnership(copy_cmd, Acquire, Generation, Rendering, compute_to_render);
+		if (this->MeshShader) {
+			//plane property is acquired for vertex shader, and is read by task and mesh shader instead
+			const BufferArena::Range& plane_prop = this->Plane.inputParameter();
+
+			PipelineBarrier<0u, 1u, 0u> plane_barrier;
+			plane_barrier.addBufferBarrier({
+				VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+				VK_ACCESS_2_NONE,
+				::TerrainMeshGeometryStage,
+				VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+			}, { }, plane_prop.Buffer, plane_prop.Offset, plane_prop.Size);
+			plane_barrier.record(copy_cmd);
+		}
 
 		/*********************
 		 * Submission
 		 ********************/
-		submit_command(copy_cmd, 1u);
+		CHECK_VULKAN_ERROR(vkEndCommandBuffer(copy_cmd));
+		CommandBufferManager::submit<1u, 2u, 1u>({ this->getDevice(), ctx.Queue.Render }, { copy_cmd },
+			{{
+				{ compute_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull },
+				uploader.waitOperation(uniform_ticket, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT)
+			}},
+			{{{ render_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}}, VK_NULL_HANDLE);
+		//rendering submission waits for the compute submission and the upload, so all of them are complete
+		{
+			const StartupGraph::Step step("Device wait");
+			SemaphoreManager::wait<1u>(this->getDevice(), { }, {{{ render_sema, 1ull }}});
+		}
+
 		this->Plane.releaseTemporary();
 		if (render_water) {
 			this->AccelStructPlane.releaseTemporary();
 		}
 	}
+	using enum AccelStructCompaction::CompactionStatus;
+	this->FrameCount = 0ull;
+	this->TerrainCompaction = {
+		.Status = Complete
+	};
 	if (render_water) {
-		/***********************
-		 * Compact GAS
-		 **********************/
-		CommandBufferManager::beginOneTimeSubmit(compact_cmd);
-		AccelStructManager::AccelStruct compacted_as = this->compactTerrainAccelStruct(compact_cmd, accel_struct_query);
-		submit_command(compact_cmd, 2u);
-		
-		this->TerrainAccelStruct = std::move(compacted_as);
+		//water is drawn with the uncompacted GAS, which remains owned by the compute queue until water renderer has built IAS using it
+		AccelStructPool& accel_struct_pool = *terrain_info.WaterInfo->AccelStructMemory;
+		this->TerrainCompaction = {
+			.Status = Querying,
+			.Pool = &accel_struct_pool,
+			.Message = terrain_info.DebugMessage,
+			.Query = std::move(accel_struct_query)
+		};
 
 		/*****************************
 		 * Initialise water renderer
 		 ****************************/
 		this->WaterRenderer.emplace(ctx, SimpleWater::WaterCreateInfo {
 			.CameraDescriptorSetLayout = terrain_info.CameraDescriptorSetLayout,
+			.Heap = terrain_info.Heap,
 			.OutputFormat = {
 				.ColourFormat = ::ColourFormat,
 				.DepthFormat = ::DepthFormat,
@@ -439,7 +559,9 @@ SimpleTerrain::SimpleTerrain(const VulkanContext& ctx, const TerrainCreateInfo&
 
 			.SkyRenderer = &this->SkyRenderer,
 			.PlaneGenerator = &plane_generator,
+			.Culling = &this->Culling,
 			.SceneGAS = this->TerrainAccelStruct.AccelStruct,
+			.SceneGASMemory = &this->TerrainAccelStruct.Memory,
 			.SceneTexture = {
 				.sampler = this->Heightfield.Sampler,
 				.imageView = this->Heightfield.NormalOnlyView,
@@ -450,69 +572,48 @@ SimpleTerrain::SimpleTerrain(const VulkanContext& ctx, const TerrainCreateInfo&
 			.WaterDistortion = terrain_info.WaterInfo->WaterDistortion,
 
 			.ModelMatrix = &::TerrainUniformData.TerrainTransform.M,
-
+			.RayTracingPipeline = terrain_info.WaterInfo->RayTracingPipeline,
+			.RayTracingResolution = terrain_info.WaterInfo->RayTracingResolution,
+			.Surface = terrain_info.WaterInfo->Surface,
+
+			.Profiler = terrain_info.Profiler,
+			.Uploader = terrain_info.Uploader,
+			.PipelineLibrary = terrain_info.PipelineLibrary,
+			.MipMap = terrain_info.MipMap,
+			.Arena = terrain_info.Arena,
+			.AccelStructMemory = &accel_struct_pool,
 			.DebugMessage = terrain_info.DebugMessage
 		});
 	}
 	{
-		const auto terrain_ds_layout = array { *this->TerrainShaderLayout };
-		this->TerrainShaderDescriptorBuffer = DescriptorBufferManager(ctx, terrain_ds_layout,
-			VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT);
-
-		const auto map_ds = array {
-			VkDescriptorImageInfo {
-				.sampler = this->Heightfield.Sampler,
-				.imageView = this->Heightfield.FullView,
-				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-			}
-		};
+		DescriptorHeap& heap = *terrain_info.Heap;
 
-		const VkDeviceAddress uniform_addr = BufferManager::addressOf(this->getDevice(), this->UniformBuffer.second);
-		const std::initializer_list<tuple<VkDeviceAddress, VkDeviceSize>> terrain_uniform {
-			{ uniform_addr + offsetof(::TerrainUniform, TerrainTransform), sizeof(::TerrainUniform::TerrainTransform) },
-			{ uniform_addr + offsetof(::TerrainUniform, TessellationSetting), sizeof(::TerrainUniform::TessellationSetting) },
-			{ uniform_addr + offsetof(::TerrainUniform, DisplacementSetting), sizeof(::TerrainUniform::DisplacementSetting) }
-		};
-		array<VkDescriptorAddressInfoEXT, 3u> uniform_ds;
-		transform(terrain_uniform, uniform_ds.begin(), [](const auto& info) {
-			const auto [addr, range] = info;
-			return VkDescriptorAddressInfoEXT {
-				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
-				.address = addr,
-				.range = range
-			};
-		});
+		const VkDeviceAddress uniform_addr = this->UniformBuffer.Address;
+		this->HeapSlot.Transform = heap.addStorageBuffer(uniform_addr + offsetof(::TerrainUniform, TerrainTransform),
+			sizeof(::TerrainUniform::TerrainTransform));
+		this->HeapSlot.Tessellation = heap.addStorageBuffer(uniform_addr + offsetof(::TerrainUniform, TessellationSetting),
+			sizeof(::TerrainUniform::TessellationSetting));
+		this->HeapSlot.Displacement = heap.addStorageBuffer(uniform_addr + offsetof(::TerrainUniform, DisplacementSetting),
+			sizeof(::TerrainUniform::DisplacementSetting));
 
-		using DU = DescriptorBufferManager::DescriptorUpdater;
-		array<DU::DescriptorGetInfo, uniform_ds.size() + map_ds.size()> terrain_ds_update;
-		const auto terrain_sample_update = transform(uniform_ds, terrain_ds_update.begin(), [](const auto& info) {
-			return DU::DescriptorGetInfo { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { .pStorageBuffer = &info } };
-		}).out;
-		transform(map_ds, terrain_sample_update, [](const auto& sampler_info) {
-			return DU::DescriptorGetInfo {
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				{ .pCombinedImageSampler = &sampler_info }
-			};
-		});
+		this->HeapSlot.HeightfieldTexture = heap.addSampledImage(this->Heightfield.FullView);
+		this->HeapSlot.HeightfieldSampler = heap.addSampler(this->Heightfield.Sampler);
 
-		const DU terrain_ds_updater = this->TerrainShaderDescriptorBuffer.createUpdater(ctx);
-		for (const auto i : iota(0u, terrain_ds_update.size())) {
-			terrain_ds_updater.update({
-				.SetLayout = this->TerrainShaderLayout,
-				.SetIndex = 0u,
-				.Binding = i,
-				.GetInfo = terrain_ds_update[i]
-			});
-		}
+		const BufferArena::Range& plane_prop = this->Plane.inputParameter();
+		this->HeapSlot.PlaneProperty = heap.addStorageBuffer(plane_prop.Address, plane_prop.Size);
+	}
+	if (render_water) {
+		//scene depth of water renderer is reused as occluder of the next frame
+		this->SceneDepthPyramid.emplace(ctx, *terrain_info.Heap, *terrain_info.DebugMessage);
 	}
 }
 
 inline VkDevice SimpleTerrain::getDevice() const noexcept {
-	return this->UniformBuffer.second->get_deleter().Device;
+	return this->Context->Device;
 }
 
 inline VmaAllocator SimpleTerrain::getAllocator() const noexcept {
-	return this->UniformBuffer.first->get_deleter().Allocator;
+	return this->Context->Allocator;
 }
 
 constexpr AccelStructManager::CompactionSizeQueryInfo SimpleTerrain::createCompactionQueryInfo(const VkQueryPool qp) const noexcept {
@@ -522,7 +623,7 @@ constexpr AccelStructManager::CompactionSizeQueryInfo SimpleTerrain::createCompa
 	};
 }
 
-SimpleTerrain::AccelStructBuildTempMemory SimpleTerrain::buildTerrainAccelStruct(const VulkanContext& ctx,
+SimpleTerrain::AccelStructBuildTempMemory SimpleTerrain::buildTerrainAccelStruct(AccelStructPool& pool,
 	const VkCommandBuffer cmd, const VkQueryPool query) {
 	using glm::mat3x4;
 	static_assert(sizeof(VkTransformMatrixKHR) == sizeof(mat3x4));
@@ -533,7 +634,7 @@ SimpleTerrain::AccelStructBuildTempMemory SimpleTerrain::buildTerrainAccelStruct
 	VKO::BufferAllocation terrain_transform_mem = BufferManager::createTransientHostBuffer(
 		{ this->getDevice(), this->getAllocator(), sizeof(VkTransformMatrixKHR) },
 		VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-		BufferManager::HostAccessPattern::Sequential);
+		BufferManager::HostAccessPattern::Sequential, VKO::AllocationCategory::AccelStruct);
 
 	VKO::MappedAllocation transform_data = VKO::mapAllocation<mat3x4>(this->getAllocator(), terrain_transform_mem.first);
 	*transform_data = mat3x4(glm::transpose(::TerrainUniformData.TerrainTransform.M));
@@ -552,52 +653,87 @@ SimpleTerrain::AccelStructBuildTempMemory SimpleTerrain::buildTerrainAccelStruct
 			0u
 		}
 	};
-	auto [gas, scratch] = GeometryData::buildAccelStruct(ctx, cmd,
+	AccelStructPool::AccelStruct gas = GeometryData::buildAccelStruct(pool, cmd,
 		VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR |
 		VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR, gas_entry, &compaction_query_info);
 
-	//////////////////////////////////
-	/// Barrier for later compaction
-	///////////////////////////////////
+	////////////////////////////////////////////
+	/// Barrier for IAS build and compaction
+	////////////////////////////////////////////
 	PipelineBarrier<0u, 1u, 0u> barrier;
 	barrier.addBufferBarrier({
 		VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
 		VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
 		VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
 		VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
-	}, gas.AccelStructMemory.second);
+	}, { }, gas.Memory.Buffer, gas.Memory.Offset, gas.Memory.Size);
 	barrier.record(cmd);
 
-	using std::move;
-	this->TerrainAccelStruct = move(gas);
-	return make_tuple(
-		move(terrain_transform_mem),
-		move(scratch)
-	);
+	this->TerrainAccelStruct = std::move(gas);
+	return terrain_transform_mem;
 }
 
-AccelStructManager::AccelStruct SimpleTerrain::compactTerrainAccelStruct(const VkCommandBuffer cmd, const VkQueryPool query) const {
-	const auto compaction_query_info = this->createCompactionQueryInfo(query);
-
-	AccelStructManager::AccelStruct as = AccelStructManager::compactAccelStruct(this->TerrainAccelStruct.AccelStruct, {
-		.Device = this->getDevice(),
-		.Allocator = this->getAllocator(),
-		.Command = cmd,
-		
-		.Type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
-		.CompactionSizeQuery = &compaction_query_info
-	});
+void SimpleTerrain::compactTerrainAccelStruct(const VkCommandBuffer cmd) {
+	AccelStructCompaction& compaction = this->TerrainCompaction;
+	//every frame up to an in-flight cycle earlier has completed
+	const bool frame_complete = this->FrameCount >= compaction.Frame + this->Context->FrameInFlight;
 
-	PipelineBarrier<0u, 1u, 0u> barrier;
-	barrier.addBufferBarrier({
-		VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
-		VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
-		SimpleWater::WaterCreateInfo::GASStage,
-		SimpleWater::WaterCreateInfo::GASAccess
-	}, as.AccelStructMemory.second);
-	barrier.record(cmd);
+	using enum AccelStructCompaction::CompactionStatus;
+	switch (compaction.Status) {
+	case Querying:
+	{
+		const std::optional<VkDeviceSize> size = AccelStructManager::tryGetCompactedSize(this->getDevice(),
+			this->createCompactionQueryInfo(compaction.Query));
+		if (!size) {
+			break;
+		}
+		//the uncompacted GAS has been acquired by the rendering queue, so compaction is recorded in the frame using it
+		compaction.Pending = compaction.Pool->compact(cmd, this->TerrainAccelStruct.AccelStruct,
+			VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, *size);
+		const BufferArena::Range& pending_mem = compaction.Pending.Memory;
 
-	return as;
+		PipelineBarrier<0u, 1u, 0u> barrier;
+		barrier.addBufferBarrier({
+			VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+			VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+			this->WaterRenderer->getSceneGASStage(),
+			VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
+		}, { }, pending_mem.Buffer, pending_mem.Offset, pending_mem.Size);
+		barrier.record(cmd);
+
+		compaction.Status = Compacting;
+		compaction.Frame = this->FrameCount;
+	}
+		break;
+	case Compacting:
+		if (!frame_complete) {
+			break;
+		}
+		//this frame has been recorded with the uncompacted GAS
+		std::swap(this->TerrainAccelStruct, compaction.Pending);
+		this->WaterRenderer->replaceSceneGAS(this->TerrainAccelStruct.AccelStruct);
+
+		compaction.Status = Retiring;
+		compaction.Frame = this->FrameCount;
+		break;
+	case Retiring:
+		if (!frame_complete) {
+			break;
+		}
+		compaction.Pending = { };
+		compaction.Query = { };
+		//storage emptied by the uncompacted GAS is returned
+		compaction.Pool->trim();
+
+		//every build and compaction of the scene has completed, so the memory footprint is settled
+		compaction.Pool->statistics().resolve();
+		compaction.Pool->statistics().print(*compaction.Message);
+
+		compaction.Status = Complete;
+		break;
+	default:
+		break;
+	}
 }
 
 void SimpleTerrain::reshape(const ReshapeInfo& reshape_info) {
@@ -612,9 +748,15 @@ void SimpleTerrain::reshape(const ReshapeInfo& reshape_info) {
 		.DepthFormat = ::DepthFormat,
 		.Sample = ::TerrainSampleCount,
 
-		.Extent = this->OutputExtent
+		.Extent = this->OutputExtent,
+		//the attachments are cleared every frame, and only loaded by water and sky of the same frame
+		.Pool = &ctx->TransientAttachment
 	});
 
+	//cached rendering refers to the old attachments and extent, and has been reset with the reshape pool
+	this->TerrainRenderCmd = { };
+	this->SkyRenderer.reshape();
+
 	const VkCommandBuffer cmd = this->TerrainReshapeCmd;
 	CommandBufferManager::beginOneTimeSubmit(cmd);
 
@@ -625,46 +767,174 @@ void SimpleTerrain::reshape(const ReshapeInfo& reshape_info) {
 
 	if (this->WaterRenderer) {
 		this->WaterRenderer->reshape(reshape_info);
+		this->SceneDepthPyramid->reshape(extent);
 	}
+
+	/*****************
+	 * Render graph
+	 ****************/
+	constexpr VkPipelineStageFlags2 fragment_test = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+	constexpr RenderGraph::ResourceState colour_write {
+		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	}, colour_load_write {
+		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	}, depth_test {
+		fragment_test,
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		::TerrainPrepareInfo.DepthLayout
+	};
+
+	RenderGraph& graph = this->FrameGraph.emplace(*ctx);
+	//the last frame leaves the attachments as sky renderer uses them
+	const RenderGraph::ResourceIdentifier colour = graph.importImage({
+		.Image = this->OutputAttachment.Colour.second,
+		.Range = ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT),
+		.Initial = colour_write
+	}), depth = graph.importImage({
+		.Image = this->OutputAttachment.Depth.second,
+		.Range = ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_DEPTH_BIT),
+		.Initial = {
+			fragment_test,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			::TerrainPrepareInfo.DepthLayout
+		}
+	});
+	//acquisition of the present image is waited at colour output, and sky renderer resolves colour into it
+	this->PresentResource = graph.importImage({
+		.Range = ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT),
+		.Initial = {
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_2_NONE,
+			VK_IMAGE_LAYOUT_UNDEFINED
+		},
+		.Final = RenderGraph::ResourceState {
+			VK_PIPELINE_STAGE_2_NONE,
+			VK_ACCESS_2_NONE,
+			this->Context->PresentLayout
+		}
+	});
+
+	//terrain clears both attachments
+	const auto terrain_usage = array<RenderGraph::ResourceUsage, 2u> {{
+		{ colour, colour_write },
+		{ depth, depth_test }
+	}};
+	graph.addPass({ "Terrain", terrain_usage });
+	if (this->WaterRenderer) {
+		const auto water_usage = array<RenderGraph::ResourceUsage, 2u> {{
+			{ colour, colour_load_write },
+			{ depth, depth_test }
+		}};
+		graph.addPass({ "Water", water_usage });
+	}
+	//sky discards both attachments after rendering, which is a write to their content
+	const auto sky_usage = array<RenderGraph::ResourceUsage, 3u> {{
+		{ colour, colour_load_write },
+		{ depth, depth_test },
+		{ this->PresentResource, colour_write }
+	}};
+	graph.addPass({ "Sky", sky_usage });
+	graph.compile();
+	//scene depth is recreated with undefined content
+	this->SceneDepthHistory = false;
 }
 
-SimpleTerrain::DrawResult SimpleTerrain::draw(const DrawInfo& draw_info) {
-	const auto& [ctx, camera, delta_time, frame_index, vp, draw_area, present_img, present_img_view] = draw_info;
-	/*
-	If we need to render water, we do not need to render and resolve the terrain to present image straight away,
-	and pass the present image to water renderer, letting it finishes the rest.
-	*/
+VkCommandBuffer SimpleTerrain::recordTerrainPrepare(const DrawInfo& draw_info, const uint32_t worker_idx, const bool occlusion) const {
+	const auto& [ctx, camera, heap, profiler, job, worker_cmd, frame_memory, delta_time, frame_index, vp, draw_area, present_img, present_img_view] =
+		draw_info;
 	const bool draw_water = this->WaterRenderer.has_value();
 
-	const VkCommandBuffer cmd = this->TerrainDrawCmd[frame_index];
-	CommandBufferManager::beginOneTimeSubmit(cmd);
+	const VkCommandBuffer cmd = worker_cmd->allocateSecondary(worker_idx, frame_index);
+	CommandBufferManager::beginOneTimeSubmitSecondary(cmd);
+
+	//culling sets offsets of its own pipeline layout
+	const auto ds = array {
+		camera->descriptorBufferBindingInfo(),
+		heap->descriptorBufferBindingInfo()
+	};
+	vkCmdBindDescriptorBuffersEXT(cmd, static_cast<uint32_t>(ds.size()), ds.data());
 
 	/************************
-	 * Subpass dependencies
+	 * Build depth pyramid
 	 ***********************/
-	constexpr static FramebufferManager::PrepareFramebufferInfo prepare_info {
-		.DepthLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
-	};
-	const FramebufferManager::SubpassOutputDependencyIssueInfo issue_info {
-		.PrepareInfo = &prepare_info
-	};
-	FramebufferManager::issueSubpassOutputDependency(cmd, this->OutputAttachment, issue_info);
+	//scene depth still holds depth of the last frame, before it is overwritten by terrain rendering
+	if (occlusion) {
+		this->SceneDepthPyramid->record(cmd, {
+			.Depth = this->WaterRenderer->getSceneDepthImage(),
+			.DepthView = this->WaterRenderer->getSceneDepth(),
+			.DepthLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			.DepthStage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			.DepthAccess = VK_ACCESS_2_NONE
+		});
+	}
 
-	SimpleWater::SceneDepthRecordInfo scene_depth_record_info;
+	/************************
+	 * Cull terrain chunks
+	 ***********************/
+	//the terrain is only ever displaced upwards, by as much as the altitude
+	//mesh shading culls chunks in task shader, but culling is still needed to record view for occlusion test of water
+	if (!this->MeshShader || draw_water) {
+		this->Culling.record(cmd, *camera, {
+			.Geometry = &this->Plane,
+			.FrameIndex = frame_index,
+			.FrameCount = this->FrameCount,
+			.Transform = this->HeapSlot.Transform.index(),
+			.MinHeight = 0.0f,
+			.MaxHeight = ::TerrainUniformData.DisplacementSetting.Alt,
+			.RecordView = draw_water,
+			.Occluder = occlusion ? &*this->SceneDepthPyramid : nullptr
+		});
+	}
 	if (draw_water) {
-		scene_depth_record_info = {
-			.Stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-			.Access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-			.Layout = prepare_info.DepthLayout
-		};
-		this->WaterRenderer->beginSceneDepthRecord(cmd, scene_depth_record_info);
+		this->WaterRenderer->beginSceneDepthRecord(cmd, ::TerrainSceneDepthRecordInfo);
 	}
 
+	CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
+	return cmd;
+}
+
+void SimpleTerrain::recordTerrainRendering(const VkCommandBuffer cmd, const DrawInfo& draw_info) const {
+	const auto& [ctx, camera, heap, profiler, job, worker_cmd, frame_memory, delta_time, frame_index, vp, draw_area, present_img, present_img_view] =
+		draw_info;
+	const bool draw_water = this->WaterRenderer.has_value();
+
+	CommandBufferManager::beginReusableSecondary(cmd);
+	//pipeline statistics query cannot span command buffers, so the profiled region excludes culling
+	profiler->beginRegion(cmd, frame_index, this->ProfileRegion);
+
+	/**************
+	 * Descriptor
+	 *************/
+	const auto ds = array {
+		camera->descriptorBufferBindingInfo(),
+		heap->descriptorBufferBindingInfo()
+	};
+	array<uint32_t, ds.size()> ds_idx;
+	std::iota(ds_idx.begin(), ds_idx.end(), 0u);
+	const auto ds_offset = array {
+		camera->descriptorBufferOffset(frame_index),
+		VkDeviceSize { 0 }
+	};
+
+	vkCmdBindDescriptorBuffersEXT(cmd, static_cast<uint32_t>(ds.size()), ds.data());
+	vkCmdSetDescriptorBufferOffsetsEXT(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->PipelineLayout, 0u,
+		static_cast<uint32_t>(ds.size()), ds_idx.data(), ds_offset.data());
+
+	/************************
+	 * Subpass dependencies
+	 ***********************/
+	//dependencies of the output attachment are issued by the render graph
+	const FramebufferManager::SubpassOutputDependencyIssueInfo issue_info {
+		.PrepareInfo = &::TerrainPrepareInfo
+	};
+
 	/*********************
 	 * Begin rendering
 	 ********************/
-	//BUG: I believe this is due to a bug in validation layer that reports undefined layout on the water scene depth image.
-	CONTEXT_DISABLE_MESSAGE(msg_id, *ctx, 0x5D1FD459);
 	FramebufferManager::beginInitialRendering(cmd, this->OutputAttachment, {
 		.DependencyInfo = &issue_info,
 		.ClearColour = glm::vec4(1.0f),
@@ -678,87 +948,164 @@ SimpleTerrain::DrawResult SimpleTerrain::draw(const DrawInfo& draw_info) {
 			.Depth = true
 		}
 	});
-	CONTEXT_ENABLE_MESSAGE(*ctx, msg_id);
 
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->Pipeline);
 	vkCmdSetViewport(cmd, 0u, 1u, &vp);
 	vkCmdSetScissor(cmd, 0u, 1u, &draw_area);
 
-	/**************
-	 * Descriptor
-	 *************/
-	const auto ds = array {
-		camera->descriptorBufferBindingInfo(),
-		VkDescriptorBufferBindingInfoEXT {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
-			.address = BufferManager::addressOf(this->getDevice(), this->TerrainShaderDescriptorBuffer.buffer()),
-			.usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT
-		}
+	const ::TerrainPushConstant terrain_pc {
+		.Transform = this->HeapSlot.Transform.index(),
+		.Tessellation = this->HeapSlot.Tessellation.index(),
+		.Displacement = this->HeapSlot.Displacement.index(),
+		.HeightfieldTexture = this->HeapSlot.HeightfieldTexture.index(),
+		.HeightfieldSampler = this->HeapSlot.HeightfieldSampler.index(),
+		.PlaneProperty = this->HeapSlot.PlaneProperty.index(),
+		//clipmap data are updated in place every frame
+		.Clipmap = this->Clipmap.address(frame_index)
 	};
-	array<uint32_t, ds.size()> ds_idx;
-	std::iota(ds_idx.begin(), ds_idx.end(), 0u);
-	const auto ds_offset = array {
-		camera->descriptorBufferOffset(frame_index),
-		this->TerrainShaderDescriptorBuffer.offset(0u)
+	vkCmdPushConstants(cmd, this->PipelineLayout, ::getTerrainPushConstantStage(this->MeshShader), 0u, sizeof(terrain_pc), &terrain_pc);
+
+	/****************
+	 * Draw terrain
+	 ***************/
+	const auto drawTerrain = [this, cmd, frame_index](const VkPipeline pipeline) -> void {
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		if (this->MeshShader) {
+			//one task workgroup for each chunk, which culls the chunk and its meshlets
+			vkCmdDrawMeshTasksEXT(cmd, this->Plane.attributeInfo().Count.Chunk, 1u, 1u);
+		} else {
+			//only visible chunks are drawn, with commands compacted by culling
+			//the plane has no vertex and index buffer, and indexed commands are read as non-indexed with the same stride
+			const GeometryData::CulledDrawInfo culled_draw = this->Plane.culledDraw(frame_index);
+			vkCmdDrawIndirectCount(cmd, culled_draw.Buffer, culled_draw.CommandOffset, culled_draw.Buffer, culled_draw.CountOffset,
+				culled_draw.MaxCount, static_cast<uint32_t>(sizeof(IndirectCommand::VkDrawIndexedIndirectCommand)));
+		}
 	};
+	//both draws are in the same rendering, depth attachment writes are ordered by rasterisation order
+	//and the resolved scene depth is complete at the end of rendering as before
+	if (const auto& depth_pre_pass = this->Pipeline.second;
+		depth_pre_pass) {
+		drawTerrain(depth_pre_pass->get());
+	}
+	drawTerrain(this->Pipeline.first.get());
+	vkCmdEndRendering(cmd);
+	profiler->endRegion(cmd, frame_index, this->ProfileRegion);
 
-	vkCmdBindDescriptorBuffersEXT(cmd, static_cast<uint32_t>(ds.size()), ds.data());
-	vkCmdSetDescriptorBufferOffsetsEXT(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->PipelineLayout, 0u,
-		static_cast<uint32_t>(ds.size()), ds_idx.data(), ds_offset.data());
+	if (draw_water) {
+		this->WaterRenderer->endSceneDepthRecord(cmd, ::TerrainSceneDepthRecordInfo);
+	}
 
-	/*******************
-	 * Buffer binding
-	 ******************/
-	const GeometryData::AttributeInfo& attr_info = this->Plane.attributeInfo();
-	const auto [vertex_offset, index_offset, indirect_offset] = attr_info.Offset;
-	const VkBuffer vbo = this->Plane.buffer();
+	CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
+}
+
+SimpleTerrain::DrawResult SimpleTerrain::draw(const DrawInfo& draw_info) {
+	const auto& [ctx, camera, heap, profiler, job, worker_cmd, frame_memory, delta_time, frame_index, vp, draw_area, present_img, present_img_view] =
+		draw_info;
+	/*
+	If we need to render water, we do not need to render and resolve the terrain to present image straight away,
+	and pass the present image to water renderer, letting it finishes the rest.
+	*/
+	const bool draw_water = this->WaterRenderer.has_value(),
+		//depth of the last frame is only valid if it has the same extent as the current frame
+		occlusion = draw_water && this->SceneDepthHistory;
+	const DepthPyramid* const occluder = occlusion ? &*this->SceneDepthPyramid : nullptr;
+
+	/***********************
+	 * Stream heightfield
+	 **********************/
+	//the clipmap is centred around the camera projected onto the plane
+	const glm::dvec4 camera_plane = glm::inverse(glm::dmat4(::TerrainUniformData.TerrainTransform.M))
+		* glm::dvec4(camera->position(), 1.0);
+	this->Clipmap.update(frame_index, dvec2(camera_plane.x, camera_plane.z) / ::TerrainSize);
+
+	//BUG: I believe this is due to a bug in validation layer that reports undefined layout on the water scene depth image.
+	//Message control is not thread-safe, so disable it for the whole duration of recording.
+	CONTEXT_DISABLE_MESSAGE(msg_id, *ctx, 0x5D1FD459);
 
-	vkCmdBindVertexBuffers(cmd, 0u, 1u, &vbo, &vertex_offset);
-	vkCmdBindIndexBuffer(cmd, vbo, index_offset, attr_info.Type.Index);
+	/*
+	Terrain, water and sky are executed by the render graph, which adds passes in the same order as draw commands.
+	Per-frame work before terrain rendering, and secondary command buffers of every renderer are recorded in parallel, each by a job,
+	and all jobs are joined once before they are executed.
+	Terrain rendering and sky only change on reshape, and are recorded from the reshape command pool of a worker
+	the first time an in-flight frame is drawn.
+	*/
+	array<VkCommandBuffer, 3u> draw_cmd;
+	size_t draw_count = 0u;
+	VkCommandBuffer prepare_cmd;
+	array<JobSystem::Job, 4u> draw_job;
+	size_t job_count = 0u;
+
+	/******************
+	 * Prepare terrain
+	 *****************/
+	draw_job[job_count++] = [this, &draw_info, &prepare_cmd, occlusion](const uint32_t worker_idx) {
+		prepare_cmd = this->recordTerrainPrepare(draw_info, worker_idx, occlusion);
+	};
 
 	/****************
 	 * Draw terrain
 	 ***************/
-	vkCmdDrawIndexedIndirect(cmd, vbo, indirect_offset, 1u, 0u);
-	vkCmdEndRendering(cmd);
+	if (VKO::CommandBuffer& terrain_cmd = this->TerrainRenderCmd[frame_index];
+		!terrain_cmd) {
+		draw_job[job_count++] = [this, &draw_info, &terrain_cmd](const uint32_t worker_idx) {
+			terrain_cmd = draw_info.WorkerCommand->allocateReshapeSecondary(worker_idx);
+			this->recordTerrainRendering(terrain_cmd, draw_info);
+		};
+	}
+	const size_t terrain_pass = draw_count++;
 
 	/**************
 	 * Draw water
 	 *************/
-	FixedArray<VkCommandBuffer, 2u> draw_cmd;
 	if (draw_water) {
-		this->WaterRenderer->endSceneDepthRecord(cmd, scene_depth_record_info);
-
-		const auto [water_cmd, water_wait_stage] = this->WaterRenderer->draw({
-			.InheritedDrawInfo = &draw_info,
-			.SceneGeometry = &this->AccelStructPlane,
-			.InputFramebuffer = &this->OutputAttachment,
-			.DepthLayout = prepare_info.DepthLayout
-		});
-		assert(water_wait_stage == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
-
-		draw_cmd.pushBack(water_cmd);
+		draw_job[job_count++] = [this, &draw_info, &water_cmd = draw_cmd[draw_count++], occluder](const uint32_t worker_idx) {
+			const auto [cmd, wait_stage] = this->WaterRenderer->draw({
+				.InheritedDrawInfo = &draw_info,
+				.SceneGeometry = &this->AccelStructPlane,
+				.InputFramebuffer = &this->OutputAttachment,
+				.DepthLayout = ::TerrainPrepareInfo.DepthLayout,
+				.WorkerIndex = worker_idx,
+				.FrameCount = this->FrameCount,
+				.Occluder = occluder
+			});
+			assert(wait_stage == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+			water_cmd = cmd;
+		};
 	}
 
 	/***********
 	 * Draw sky
 	 ***********/
-	{
-		const auto [sky_cmd, sky_wait_stage] = this->SkyRenderer.draw({
+	draw_job[job_count++] = [this, &draw_info, &sky_cmd = draw_cmd[draw_count++]](const uint32_t worker_idx) {
+		const auto [cmd, wait_stage] = this->SkyRenderer.draw({
 			.InheritedDrawInfo = &draw_info,
 			.InputFramebuffer = &this->OutputAttachment,
-			.DepthLayout = prepare_info.DepthLayout
+			.DepthLayout = ::TerrainPrepareInfo.DepthLayout,
+			.WorkerIndex = worker_idx
 		});
-		assert(sky_wait_stage == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+		assert(wait_stage == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+		sky_cmd = cmd;
+	};
 
-		draw_cmd.pushBack(sky_cmd);
-	}
+	job->run(span(draw_job.data(), job_count));
+	CONTEXT_ENABLE_MESSAGE(*ctx, msg_id);
+	draw_cmd[terrain_pass] = this->TerrainRenderCmd[frame_index];
+	this->SceneDepthHistory = draw_water;
 
 	/****************************
 	 * Prepare for presentation
 	 ***************************/
-	vkCmdExecuteCommands(cmd, static_cast<uint32_t>(draw_cmd.size()), draw_cmd.data());
-	FramebufferManager::transitionAttachmentToPresent(cmd, present_img);
+	const VkCommandBuffer cmd = this->TerrainDrawCmd[frame_index];
+	CommandBufferManager::beginOneTimeSubmit(cmd);
+
+	//culling and scene depth transitions only touch resources not declared to the graph
+	vkCmdExecuteCommands(cmd, 1u, &prepare_cmd);
+	//the present image is transitioned to present after the last pass
+	this->FrameGraph->bindImage(this->PresentResource, present_img);
+	this->FrameGraph->execute(cmd, span(draw_cmd.data(), draw_count));
+	if (draw_water) {
+		this->compactTerrainAccelStruct(cmd);
+	}
+	this->FrameCount++;
 
 	CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
 	return {
@@ -1,41 +1,92 @@
 #pragma once
 
+#include "ChunkCulling.hpp"
 #include "DrawSky.hpp"
 #include "SimpleWater.hpp"
 #include "GeometryData.hpp"
 
+#include "../Engine/AccelStructPool.hpp"
+#include "../Engine/BufferArena.hpp"
+#include "../Engine/DepthPyramid.hpp"
+#include "../Engine/DescriptorHeap.hpp"
+#include "../Engine/EngineSetting.hpp"
+#include "../Engine/FrameAllocator.hpp"
+#include "../Engine/HeightfieldClipmap.hpp"
+#include "../Engine/MipMapGenerator.hpp"
+#include "../Engine/RenderGraph.hpp"
 #include "../Engine/RendererInterface.hpp"
+#include "../Engine/StagingUploader.hpp"
+#include "../Engine/TimestampProfiler.hpp"
 #include "../Engine/VulkanContext.hpp"
 
 #include "../Engine/Abstraction/AccelStructManager.hpp"
 #include "../Engine/Abstraction/CommandBufferManager.hpp"
-#include "../Engine/Abstraction/DescriptorBufferManager.hpp"
 #include "../Engine/Abstraction/FramebufferManager.hpp"
 #include "../Engine/Abstraction/ImageManager.hpp"
+#include "../Engine/Abstraction/PipelineManager.hpp"
 
 #include "../Common/VulkanObject.hpp"
 
 #include <ostream>
+#include <array>
 #include <optional>
 #include <span>
-#include <tuple>
+#include <utility>
 #include <cstdint>
 
 namespace LearnVulkan {
 
 	/**
 	 * @brief Demonstration of terrain rendering using pre-generated 2D heightmap and tessellation shader.
+	 * Alternatively, the terrain can be rendered with task and mesh shader,
+	 * where the task shader culls each chunk and selects its LoD, and the mesh shader emits displaced grid meshlets.
+	 * The heightfield is streamed around the camera with a clipmap, and only its always resident coarsest level
+	 * is used to displace the geometry of acceleration structure and to be sampled by water.
 	*/
 	class SimpleTerrain final : public RendererInterface {
 	private:
 
-		using AccelStructBuildTempMemory = std::tuple<VulkanObject::BufferAllocation, VulkanObject::BufferAllocation>;
+		//The transform matrix input of acceleration structure build.
+		using AccelStructBuildTempMemory = VulkanObject::BufferAllocation;
+
+		/**
+		 * @brief The terrain GAS is built uncompacted such that water can be drawn with it right away,
+		 * and is compacted in the background on a later frame.
+		*/
+		struct AccelStructCompaction {
+
+			enum class CompactionStatus : uint8_t {
+				Complete = 0x00u,/**< Or there is nothing to compact. */
+				Querying = 0x01u,/**< Waiting for the compacted size to become available. */
+				Compacting = 0x02u,/**< Waiting for the frame where compaction is recorded to complete. */
+				Retiring = 0x03u/**< Waiting for every frame drawn with the uncompacted GAS to complete. */
+			};
+
+			CompactionStatus Status;
+			AccelStructPool* Pool;
+			std::ostream* Message;/**< Statistics of the pool are printed once compaction has completed. */
+			VulkanObject::QueryPool Query;
+			//The compacted GAS while compacting, or the uncompacted GAS while retiring.
+			AccelStructPool::AccelStruct Pending;
+			uint64_t Frame;/**< The frame to be completed in the current status. */
+
+		};
+
+		const VulkanContext* const Context;
 
 		FramebufferManager::SimpleFramebuffer OutputAttachment;
 		VkExtent2D OutputExtent;
+		//Terrain, water and sky passes over the output attachment and the present image, rebuilt on reshape.
+		//Passes are added in the order they are drawn, such that their secondary command buffers are indexed by pass.
+		std::optional<RenderGraph> FrameGraph;
+		RenderGraph::ResourceIdentifier PresentResource;
+		bool SceneDepthHistory;/**< True if scene depth contains depth of the last frame. */
+		const bool MeshShader;/**< True if the terrain is rendered with mesh shading. */
 
 		GeometryData Plane, AccelStructPlane;
-		const VulkanObject::BufferAllocation UniformBuffer;
+		const BufferArena::Range UniformBuffer;
+		HeightfieldClipmap Clipmap;
+		//The coarsest level of heightfield.
 		struct {
 
 			VulkanObject::ImageAllocation Image;
@@ -43,27 +94,38 @@ namespace LearnVulkan {
 			VulkanObject::Sampler Sampler;
 
 		} Heightfield;
+		/**
+		 * @brief In descriptor heap
+		 * vertex, tessellation control and tessellation evaluation (or task and mesh) SSBO, heightfield and plane property
+		*/
+		struct {
 
-		const VulkanObject::DescriptorSetLayout TerrainShaderLayout;
+			DescriptorHeap::Slot Transform, Tessellation, Displacement, HeightfieldTexture, HeightfieldSampler, PlaneProperty;
+
+		} HeapSlot;
 
 		const VulkanObject::PipelineLayout PipelineLayout;
-		const VulkanObject::Pipeline Pipeline;
+		//The shading pipeline, and if depth pre-pass is enabled, the depth-only pipeline sharing the same pre-rasterisation shaders.
+		const std::pair<PipelineManager::GraphicsPipelineLibrary::LinkedPipeline,
+			std::optional<PipelineManager::GraphicsPipelineLibrary::LinkedPipeline>> Pipeline;
+		//Chunks of terrain and water are culled on the device, and visible chunks are drawn from the compacted draw commands.
+		const ChunkCulling Culling;
 
 		const CommandBufferManager::InFlightCommandBufferArray TerrainDrawCmd;
 		const VulkanObject::CommandBuffer TerrainReshapeCmd;
-		/**
-		 * @brief set 1
-		 * binding 0: vertex SSBO
-		 * binding 1: tessellation control SSBO
-		 * binding 2: tessellation evaluation SSBO
-		 * binding 3: heightfield
-		*/
-		DescriptorBufferManager TerrainShaderDescriptorBuffer;
+		//Terrain rendering only depends on states that change on reshape, and is replayed every frame of the same in-flight index.
+		//They are recorded from the reshape command pool of a worker on first use after reshape.
+		std::array<VulkanObject::CommandBuffer, EngineSetting::MaxFrameInFlight> TerrainRenderCmd;
+
+		const TimestampProfiler::RegionIdentifier ProfileRegion;
 
 		//The following fields are used by water renderer and are hence optional.
-		AccelStructManager::AccelStruct TerrainAccelStruct;
+		AccelStructPool::AccelStruct TerrainAccelStruct;
+		AccelStructCompaction TerrainCompaction;
+		uint64_t FrameCount;
 		DrawSky SkyRenderer;
 		std::optional<SimpleWater> WaterRenderer;
+		std::optional<DepthPyramid> SceneDepthPyramid;/**< Built from scene depth of the last frame for occlusion culling. */
 
 		VkDevice getDevice() const noexcept;
 		VmaAllocator getAllocator() const noexcept;
@@ -72,11 +134,23 @@ namespace LearnVulkan {
 
 		//Record command to build an acceleration structure for the terrain geometry.
 		//Returns some temporary buffer that must be preserved until build operation is finished.
-		AccelStructBuildTempMemory buildTerrainAccelStruct(const VulkanContext&, VkCommandBuffer, VkQueryPool);
+		AccelStructBuildTempMemory buildTerrainAccelStruct(AccelStructPool&, VkCommandBuffer, VkQueryPool);
+
+		//Advance compaction of the terrain GAS by a frame, after the water of this frame has been recorded.
+		//Compaction is recorded to the given command buffer once the compacted size is available,
+		//and the compacted GAS replaces the original for water from the next frame after it has completed.
+		//Build statistics of the pool are printed when the uncompacted GAS has been retired.
+		void compactTerrainAccelStruct(VkCommandBuffer);
+
+		//Record work that must be redone every frame before terrain rendering to a secondary command buffer allocated for the given worker,
+		//which is executed before the render graph.
+		//If occlusion is enabled, the depth pyramid is built from scene depth of the last frame before it is overwritten,
+		//then terrain chunks are culled, and scene depth recording for the water renderer, if any, begins.
+		VkCommandBuffer recordTerrainPrepare(const DrawInfo&, uint32_t, bool) const;
 
-		//Record command to compact an acceleration structure for the terrain geometry.
-		//Return the compacted acceleration structure.
-		AccelStructManager::AccelStruct compactTerrainAccelStruct(VkCommandBuffer, VkQueryPool) const;
+		//Record terrain rendering to a secondary command buffer that can be replayed in every frame of the same in-flight index.
+		//Scene depth recording for the water renderer, if any, ends in this command buffer.
+		void recordTerrainRendering(VkCommandBuffer, const DrawInfo&) const;
 
 	public:
 
@@ -86,6 +160,7 @@ namespace LearnVulkan {
 		struct TerrainSkyCreateInfo {
 
 			const ImageManager::ImageReadResult* SkyBox;
+			const DrawSky::AtmosphereInfo* Atmosphere = nullptr;/**< @see DrawSky::SkyCreateInfo::Atmosphere */
 
 		};
 
@@ -95,6 +170,11 @@ namespace LearnVulkan {
 		struct TerrainWaterCreateInfo {
 
 			const ImageManager::ImageReadResult* WaterNormalmap, *WaterDistortion;
+			AccelStructPool* AccelStructMemory;/**< Acceleration structures of terrain and water are allocated from the pool. */
+			bool RayTracingPipeline = false;/**< @see SimpleWater::WaterCreateInfo::RayTracingPipeline */
+			//@see SimpleWater::WaterCreateInfo::RayTracingResolution
+			SimpleWater::TraceResolution RayTracingResolution = SimpleWater::TraceResolution::Full;
+			SimpleWater::SurfaceGeometry Surface = SimpleWater::SurfaceGeometry::Plane;/**< @see SimpleWater::WaterCreateInfo::Surface */
 
 		};
 
@@ -104,6 +184,7 @@ namespace LearnVulkan {
 		struct TerrainCreateInfo {
 		
 			VkDescriptorSetLayout CameraDescriptorSetLayout;
+			DescriptorHeap* Heap;/**< Descriptors of terrain, sky and water are added to the heap. */
 
 			const TerrainSkyCreateInfo* SkyInfo;
 			/**
@@ -111,12 +192,38 @@ namespace LearnVulkan {
 			 * Require support for acceleration structure and ray query.
 			*/
 			const TerrainWaterCreateInfo* WaterInfo = nullptr;
-			//The heightfield should contains RGB as normalmap and A as displacementmap.
-			const ImageManager::ImageReadResult* Heightfield;
+			/**
+			 * @brief A tiled image file of the heightfield, which should contain RGB as normalmap and A as displacementmap.
+			 * The file remains mapped and is streamed from until the renderer is destroyed.
+			*/
+			const char* Heightfield;
+			/**
+			 * @brief Render the terrain with task and mesh shader instead of tessellation.
+			 * It falls back to tessellation if mesh shader is not supported by the device.
+			*/
+			bool MeshShader = false;
+			/**
+			 * @brief Fill depth of the terrain with a depth-only draw before it is shaded,
+			 * such that shading is tested for equal depth and every sample is shaded at most once.
+			 * The same depth is resolved as the scene depth of water. It is ignored when the terrain is rendered with mesh shading.
+			*/
+			bool DepthPrePass = false;
+
+			TimestampProfiler* Profiler;
+			StagingUploader* Uploader;
+			FrameAllocator* FrameMemory;/**< Clipmap data are reserved from the frame allocator. */
+			PipelineManager::GraphicsPipelineLibrary* PipelineLibrary;
+			const MipMapGenerator* MipMap;
+			BufferArena* Arena;/**< Geometry and uniform buffer are allocated from the arena. */
 			std::ostream* DebugMessage;
 
 		};
 
+		/**
+		 * @brief Construct a terrain renderer.
+		 * @param ctx The context. The context is retained and must remain valid until the renderer is destroyed.
+		 * @param terrain_info The terrain renderer create info.
+		*/
 		SimpleTerrain(const VulkanContext&, const TerrainCreateInfo&);
 
 		SimpleTerrain(const SimpleTerrain&) = delete;
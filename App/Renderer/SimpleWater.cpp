@@ -12,6 +12,8 @@
 #include "../Engine/Abstraction/SemaphoreManager.hpp"
 #include "../Engine/Abstraction/ShaderModuleManager.hpp"
 #include "../Engine/EngineSetting.hpp"
+#include "../Engine/IndirectCommand.hpp"
+#include "../Engine/StartupGraph.hpp"
 
 #include <shaderc/shaderc.h>
 
@@ -20,22 +22,28 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/mat3x4.hpp>
+#include <glm/matrix.hpp>
+#include <glm/common.hpp>
 
 #include <array>
+#include <vector>
+#include <span>
 #include <string_view>
+#include <optional>
 #include <tuple>
+#include <utility>
 
 #include <algorithm>
 #include <ranges>
 #include <numeric>
+#include <cstddef>
 #include <cstring>
 
-using glm::uvec2, glm::dvec2,
-	glm::vec3;
-using glm::mat4;
+using glm::uvec2, glm::vec2, glm::dvec2,
+	glm::vec3, glm::dvec3, glm::dvec4;
+using glm::mat4, glm::dmat4;
 
-using std::array, std::string_view, std::tuple;
-using std::views::iota, std::ranges::transform;
+using std::array, std::span, std::string_view;
 using std::ostream, std::endl;
 
 using namespace LearnVulkan;
@@ -45,6 +53,8 @@ namespace {
 
 	constexpr double WaterNormalScale = 18.0,
 		WaterAnimationSpeed = 0.02;
+	//water surface is flat, and is raised by this amount
+	constexpr float WaterAltitudeOffset = 278.5f;
 
 	struct WaterData {
 
@@ -54,7 +64,7 @@ namespace {
 		float IoR = 1.0f / 1.333f,
 			DoI = 158.8f,
 			FS = 0.5f,
-			AltOs = 278.5f,
+			AltOs = ::WaterAltitudeOffset,
 			TD = 15.5f,
 			NScl = ::WaterNormalScale,
 			NStr = 0.2f,
@@ -62,18 +72,130 @@ namespace {
 
 	};
 
-	struct FragmentPushConstant {
-		
+	//indices are in the descriptor heap, only water data and plane property are used by vertex shader
+	struct WaterPushConstant {
+
+		uint32_t WaterData, WaterPlane,
+			SceneTexture, Normalmap, Distortion, SceneDepth, EnvironmentMap,
+			SceneTextureSampler, TextureSampler, SceneDepthSampler, EnvironmentMapSampler,
+			TraceImage, TraceScale, TraceJitter;
+		float AniTim, ClipCel;
+		vec2 ClipFoc;
 		VkDeviceAddress V, I;
-		float AniTim;
 
 	};
+	constexpr VkShaderStageFlags WaterPushConstantStage = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		WaterTracePushConstantStage = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+
+	//hit colour and ray length of reflection and refraction
+	constexpr VkFormat WaterTraceFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+	constexpr uint32_t WaterTraceLayer = 2u;
+
+	//indices are in the descriptor heap
+	struct WaterResolvePushConstant {
+
+		VkDeviceAddress CurrentView, PreviousView;
+		uint32_t WaterData, WaterPlane, SceneDepth, SceneDepthSampler,
+			TraceImage, History, HistorySampler,
+			TraceScale, TraceJitter, ResolveFlag;
+		float Blend;
+
+	};
+	constexpr uint32_t WaterResolveLocalSize = 8u,
+		WaterResolveHistoryBit = 1u << 0u;
+	//the lower bound of weight of the current frame when accumulated, such that the history fades out reasonably fast
+	constexpr float WaterResolveMinBlend = 0.1f;
+
+	//Get the index of a pixel in a block of power of 2 width in the Bayer order.
+	constexpr uint32_t calcBayerIndex(const uint32_t x, const uint32_t y, const uint32_t width) noexcept {
+		if (width == 1u) {
+			return 0u;
+		}
+		constexpr auto quadrant_order = array { 0u, 2u, 3u, 1u };
+		const uint32_t half = width / 2u;
+		return 4u * calcBayerIndex(x % half, y % half, half) + quadrant_order[y / half * 2u + x / half];
+	}
+
+	//Get the pixel in a block being traced in a frame, in row-major order.
+	//Pixels are visited in the Bayer order, such that pixels traced in consecutive frames are far apart.
+	constexpr uint32_t calcTraceJitter(const uint64_t frame, const uint32_t scale) noexcept {
+		const uint32_t block_size = scale * scale,
+			order = static_cast<uint32_t>(frame % block_size);
+		for (uint32_t pixel = 0u; pixel < block_size; pixel++) {
+			if (::calcBayerIndex(pixel % scale, pixel / scale, scale) == order) {
+				return pixel;
+			}
+		}
+		return 0u;
+	}
 
 	constexpr auto WaterDimension = dvec2(1755.5);
-	constexpr auto WaterSubdivision = uvec2(8u);
+	constexpr auto WaterSubdivision = uvec2(8u),
+		WaterChunkSubdivision = uvec2(2u);
+	//the number of cell along each side of each level of the surface clipmap, and the number of level
+	constexpr uint32_t WaterClipmapGrid = 16u,
+		WaterClipmapLevel = 6u;
+	static_assert(WaterClipmapGrid % 4u == 0u, "The finer clipmap level must be able to move by a cell inside the coarser level.");
 	constexpr uint32_t WaterTextureMipMapCount = 6u;
 	constexpr float WaterTextureAnisotropy = 5.5f;
 
+	/*******************************
+	 * Scene acceleration structure
+	 *******************************/
+	//IAS is updated every frame with the scene instance, rather than rebuilt
+	constexpr VkBuildAccelerationStructureFlagsKHR SceneAccelStructFlag =
+		VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+	constexpr auto SceneInstanceRange = array {
+		VkAccelerationStructureBuildRangeInfoKHR {
+			.primitiveCount = 1u,
+			.primitiveOffset = 0u
+			//the rests are ignored for IAS
+		}
+	};
+	constexpr VkDeviceSize SceneInstanceAlignment = 16ull;
+
+	VkAccelerationStructureInstanceKHR createSceneInstance(const VkDeviceAddress gas, const mat4& transform) noexcept {
+		using glm::mat3x4;
+		static_assert(sizeof(VkTransformMatrixKHR) == sizeof(mat3x4));
+
+		VkAccelerationStructureInstanceKHR instance {
+			.instanceCustomIndex = 0u,
+			.mask = 0xFFu,
+			.instanceShaderBindingTableRecordOffset = 0u,
+			.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR | VK_GEOMETRY_INSTANCE_FORCE_OPAQUE_BIT_KHR,
+			.accelerationStructureReference = gas
+		};
+		//the transform is row-major
+		const mat3x4 row_transform = mat3x4(glm::transpose(transform));
+		std::memcpy(&instance.transform, glm::value_ptr(row_transform), sizeof(row_transform));
+		return instance;
+	}
+
+	constexpr VkAccelerationStructureGeometryKHR createSceneInstanceGeometry(const VkDeviceAddress instance) noexcept {
+		return {
+			.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+			.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+			.geometry = {
+				.instances = {
+					.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+					.arrayOfPointers = VK_FALSE,
+					.data = { .deviceAddress = instance }
+				}
+			},
+			.flags = VK_GEOMETRY_OPAQUE_BIT_KHR
+		};
+	}
+
+	constexpr AccelStructManager::AccelStructBuildRequest createSceneAccelStructRequest(
+		const span<const VkAccelerationStructureGeometryKHR> ias) noexcept {
+		return {
+			.Type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
+			.Flag = ::SceneAccelStructFlag,
+			.Geometry = ias,
+			.Range = ::SceneInstanceRange
+		};
+	}
+
 	/******************
 	 * Shader
 	 ******************/
@@ -84,6 +206,19 @@ namespace {
 	constexpr auto WaterShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, WaterVS, WaterFS>();
 	constexpr auto WaterShaderFilename = File::batchRawStringToView(WaterShaderFilenameRaw);
 
+	constexpr string_view WaterRGen = "/SimpleWater.rgen",
+		WaterRMiss = "/SimpleWater.rmiss",
+		WaterRCHit = "/SimpleWater.rchit";
+	//in the same order as shader groups
+	constexpr array WaterTraceShaderKind = { shaderc_raygen_shader, shaderc_miss_shader, shaderc_closesthit_shader };
+
+	constexpr auto WaterTraceShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, WaterRGen, WaterRMiss, WaterRCHit>();
+	constexpr auto WaterTraceShaderFilename = File::batchRawStringToView(WaterTraceShaderFilenameRaw);
+
+	constexpr string_view WaterResolveCS = "/SimpleWaterResolve.comp";
+	constexpr auto WaterResolveShaderFilenameRaw = File::toAbsolutePath<ResourcePath::ShaderRoot, WaterResolveCS>();
+	constexpr auto WaterResolveShaderFilename = File::batchRawStringToView(WaterResolveShaderFilenameRaw);
+
 	/****************
 	 * Setup
 	 ****************/
@@ -98,44 +233,28 @@ namespace {
 		return ShaderModuleManager::batchShaderCompilation<WaterShaderFilename.size()>(&water_info, &out);
 	}
 
-	VKO::DescriptorSetLayout createWaterDescriptorSetLayout(const VkDevice device) {
-		constexpr static size_t BindingCount = 4u;
-		using WaterDSInfoEntry = tuple<VkDescriptorType, VkShaderStageFlags>;
-		constexpr static auto water_ds_info = array<WaterDSInfoEntry, BindingCount> {
-			tuple { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT },
-			tuple { VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, VK_SHADER_STAGE_FRAGMENT_BIT },
-			tuple { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT },
-			tuple { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT }
-		};
-
-		array<VkDescriptorSetLayoutBinding, BindingCount> water_binding;
-		transform(iota(size_t { 0 }, water_ds_info.size()), water_ds_info, water_binding.begin(),
-			[](const auto i, const auto& info) constexpr noexcept {
-			const auto [type, stage] = info;
-			return VkDescriptorSetLayoutBinding {
-				.binding = static_cast<uint32_t>(i),
-				.descriptorType = type,
-				.descriptorCount = 1u,
-				.stageFlags = stage
-			};
-		});
-		//texture samplers in fragment shader are arranged in an array
-		water_binding[3].descriptorCount = 4u;
-
+	inline VKO::DescriptorSetLayout createWaterSceneDescriptorSetLayout(const VkDevice device) {
+		constexpr static VkDescriptorSetLayoutBinding scene_binding {
+			.binding = 0u,
+			.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR,
+			.descriptorCount = 1u,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+		};
 		return VKO::createDescriptorSetLayout(device, {
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT,
-			.bindingCount = static_cast<uint32_t>(water_binding.size()),
-			.pBindings = water_binding.data()
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT | VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR,
+			.bindingCount = 1u,
+			.pBindings = &scene_binding
 		});
 	}
 
 	template<size_t LayoutCount>
-	inline VKO::PipelineLayout createWaterPipelineLayout(const VkDevice device, const array<VkDescriptorSetLayout, LayoutCount>& layout) {
-		constexpr static VkPushConstantRange water_pc {
-			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+	inline VKO::PipelineLayout createWaterPipelineLayout(const VkDevice device, const array<VkDescriptorSetLayout, LayoutCount>& layout,
+		const VkShaderStageFlags stage) {
+		const VkPushConstantRange water_pc {
+			.stageFlags = stage,
 			.offset = 0u,
-			.size = static_cast<uint32_t>(sizeof(::FragmentPushConstant))
+			.size = static_cast<uint32_t>(sizeof(::WaterPushConstant))
 		};
 		return VKO::createPipelineLayout(device, {
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
@@ -146,28 +265,60 @@ namespace {
 		});
 	}
 
-	VKO::Pipeline createWaterPipeline(const VkDevice device, VkPipelineLayout layout, ostream& out,
-		const SimpleWater::DrawFormat& format) {
+	PipelineManager::GraphicsPipelineLibrary::LinkedPipeline createWaterPipeline(const VkDevice device,
+		PipelineManager::GraphicsPipelineLibrary& library, const VkPipelineLayout layout, ostream& out, const SimpleWater::DrawFormat& format,
+		const bool trace_image, const bool clipmap) {
+		const StartupGraph::Step step("Pipeline creation");
 		const auto water_shader_gen = compileWaterShader(device, out);
 
-		/////////////////////////
-		/// Vertex input
-		////////////////////////
-		const auto [water_vertex_binding, water_vertex_attribute] = PlaneGeometry::vertexInput({
-			.BindingIndex = 0u,
-			.Location = {
-				.Position = 0u,
-				.UV = 1u
+		//vertex shader reconstructs the surface as a clipmap rather than the plane
+		struct ClipmapSpecialisation {
+
+			VkBool32 Clipmap;
+			uint32_t Grid;
+
+		};
+		constexpr static auto clipmap_entry = array {
+			VkSpecializationMapEntry {
+				.constantID = 0u,
+				.offset = offsetof(ClipmapSpecialisation, Clipmap),
+				.size = sizeof(VkBool32)
+			},
+			VkSpecializationMapEntry {
+				.constantID = 1u,
+				.offset = offsetof(ClipmapSpecialisation, Grid),
+				.size = sizeof(uint32_t)
 			}
-		});
-		const VkPipelineVertexInputStateCreateInfo water_vertex_input {
-			.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-			.vertexBindingDescriptionCount = 1u,
-			.pVertexBindingDescriptions = &water_vertex_binding,
-			.vertexAttributeDescriptionCount = static_cast<uint32_t>(water_vertex_attribute.size()),
-			.pVertexAttributeDescriptions = water_vertex_attribute.data()
+		};
+		const ClipmapSpecialisation clipmap_spec {
+			.Clipmap = clipmap ? VK_TRUE : VK_FALSE,
+			.Grid = ::WaterClipmapGrid
+		};
+		const VkSpecializationInfo clipmap_spec_info {
+			.mapEntryCount = static_cast<uint32_t>(clipmap_entry.size()),
+			.pMapEntries = clipmap_entry.data(),
+			.dataSize = sizeof(clipmap_spec),
+			.pData = &clipmap_spec
 		};
 
+		//fragment shader reads reflection and refraction from the trace image rather than ray query
+		constexpr static VkSpecializationMapEntry trace_image_entry {
+			.constantID = 0u,
+			.offset = 0u,
+			.size = sizeof(VkBool32)
+		};
+		const VkBool32 use_trace_image = trace_image ? VK_TRUE : VK_FALSE;
+		const VkSpecializationInfo spec_info {
+			.mapEntryCount = 1u,
+			.pMapEntries = &trace_image_entry,
+			.dataSize = sizeof(use_trace_image),
+			.pData = &use_trace_image
+		};
+		array<VkPipelineShaderStageCreateInfo, WaterShaderKind.size()> water_stage;
+		std::ranges::copy(water_shader_gen.promise().ShaderStage, water_stage.begin());
+		water_stage.front().pSpecializationInfo = &clipmap_spec_info;
+		water_stage.back().pSpecializationInfo = &spec_info;
+
 		//////////////////////
 		/// Blending
 		/////////////////////
@@ -194,9 +345,9 @@ namespace {
 			.pColorAttachmentFormats = &colour_format,
 			.depthAttachmentFormat = depth_format
 		};
-		return PipelineManager::createSimpleGraphicsPipeline(device, layout, {
-			.ShaderStage = water_shader_gen.promise().ShaderStage,
-			.VertexInputState = &water_vertex_input,
+		return library.createPipeline(layout, {
+			//vertices are reconstructed from the plane property
+			.ShaderStage = water_stage,
 			.Rendering = &water_rendering,
 			.PrimitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
 			.CullMode = VK_CULL_MODE_NONE,
@@ -205,139 +356,387 @@ namespace {
 		});
 	}
 
-	inline VKO::BufferAllocation createWaterUniformBuffer(const VkDevice device, const VmaAllocator allocator) {
-		return BufferManager::createDeviceBuffer({ device, allocator, sizeof(::WaterData) },
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_EXT
-		);
+	/*************************
+	 * Ray tracing pipeline
+	 *************************/
+	inline VKO::DescriptorSetLayout createWaterTraceDescriptorSetLayout(const VkDevice device) {
+		constexpr static auto trace_binding = array {
+			VkDescriptorSetLayoutBinding {
+				.binding = 0u,
+				.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR,
+				.descriptorCount = 1u,
+				.stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR
+			},
+			VkDescriptorSetLayoutBinding {
+				.binding = 1u,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.descriptorCount = 1u,
+				.stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR
+			}
+		};
+		return VKO::createDescriptorSetLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT | VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR,
+			.bindingCount = static_cast<uint32_t>(trace_binding.size()),
+			.pBindings = trace_binding.data()
+		});
+	}
+
+	VKO::Pipeline createWaterTracePipeline(const VkDevice device, const VkPipelineCache cache, const VkPipelineLayout layout, ostream& out) {
+		const StartupGraph::Step step("Pipeline creation");
+		out << "Compiling water ray tracing shader" << endl;
+
+		const ShaderModuleManager::ShaderBatchCompilationInfo trace_info {
+			.Device = device,
+			.ShaderFilename = WaterTraceShaderFilename.data(),
+			.ShaderKind = WaterTraceShaderKind.data()
+		};
+		const auto trace_shader_gen = ShaderModuleManager::batchShaderCompilation<WaterTraceShaderFilename.size()>(&trace_info, &out);
+		const span<const VkPipelineShaderStageCreateInfo> trace_stage = trace_shader_gen.promise().ShaderStage;
+
+		//raygen and miss shader are in general groups, and the scene has triangles only
+		constexpr static auto createGeneralGroup = [](const uint32_t shader) constexpr noexcept {
+			return VkRayTracingShaderGroupCreateInfoKHR {
+				.sType = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR,
+				.type = VK_RAY_TRACING_SHADER_GROUP_TYPE_GENERAL_KHR,
+				.generalShader = shader,
+				.closestHitShader = VK_SHADER_UNUSED_KHR,
+				.anyHitShader = VK_SHADER_UNUSED_KHR,
+				.intersectionShader = VK_SHADER_UNUSED_KHR
+			};
+		};
+		constexpr static auto trace_group = array {
+			createGeneralGroup(0u),
+			createGeneralGroup(1u),
+			VkRayTracingShaderGroupCreateInfoKHR {
+				.sType = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR,
+				.type = VK_RAY_TRACING_SHADER_GROUP_TYPE_TRIANGLES_HIT_GROUP_KHR,
+				.generalShader = VK_SHADER_UNUSED_KHR,
+				.closestHitShader = 2u,
+				.anyHitShader = VK_SHADER_UNUSED_KHR,
+				.intersectionShader = VK_SHADER_UNUSED_KHR
+			}
+		};
+		return VKO::createRayTracingPipelineKHR(device, cache, {
+			.sType = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR,
+			.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+#ifndef NDEBUG
+			| VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT
+#endif
+			,
+			.stageCount = static_cast<uint32_t>(trace_stage.size()),
+			.pStages = trace_stage.data(),
+			.groupCount = static_cast<uint32_t>(trace_group.size()),
+			.pGroups = trace_group.data(),
+			//rays are only traced from raygen shader
+			.maxPipelineRayRecursionDepth = 1u,
+			.layout = layout
+		});
+	}
+
+	using ShaderBindingTableRegion = array<VkStridedDeviceAddressRegionKHR, 4u>;
+
+	//Create a shader binding table with one record of each shader group, none of which has any parameter.
+	//The buffer is written by the host once, and is not changed afterwards.
+	std::pair<VKO::BufferAllocation, ShaderBindingTableRegion> createWaterShaderBindingTable(const VulkanContext& ctx,
+		const VkPipeline pipeline) {
+		const VkPhysicalDeviceRayTracingPipelinePropertiesKHR& prop = ctx.PhysicalDeviceProperty.RayTracingPipeline;
+		const auto align_up = [](const VkDeviceSize value, const VkDeviceSize alignment) constexpr noexcept -> VkDeviceSize {
+			return (value + alignment - 1ull) / alignment * alignment;
+		};
+		const VkDeviceSize handle_size = prop.shaderGroupHandleSize,
+			record_stride = align_up(handle_size, prop.shaderGroupHandleAlignment),
+			region_size = align_up(record_stride, prop.shaderGroupBaseAlignment),
+			group_count = ::WaterTraceShaderKind.size();
+
+		std::vector<std::byte> handle(handle_size * group_count);
+		CHECK_VULKAN_ERROR(vkGetRayTracingShaderGroupHandlesKHR(ctx.Device, pipeline, 0u, static_cast<uint32_t>(group_count),
+			handle.size(), handle.data()));
+
+		//buffer alignment is not guaranteed to satisfy the base alignment, so the table is placed at the first aligned address
+		VKO::BufferAllocation sbt = BufferManager::createStreamingBuffer({
+			ctx.Device,
+			ctx.Allocator,
+			region_size * group_count + prop.shaderGroupBaseAlignment
+		}, VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR, BufferManager::HostAccessPattern::Sequential);
+		const VkDeviceAddress sbt_addr = BufferManager::addressOf(ctx.Device, sbt.second),
+			table_addr = align_up(sbt_addr, prop.shaderGroupBaseAlignment);
+
+		VKO::MappedAllocation sbt_data = VKO::mapAllocation<std::byte>(ctx.Allocator, sbt.first);
+		for (VkDeviceSize group = 0ull; group < group_count; group++) {
+			std::memcpy(sbt_data.get() + (table_addr - sbt_addr) + region_size * group, handle.data() + handle_size * group, handle_size);
+		}
+		CHECK_VULKAN_ERROR(vmaFlushAllocation(ctx.Allocator, sbt.first, 0ull, VK_WHOLE_SIZE));
+		sbt_data.reset();
+
+		//the size of raygen region must be equal to its stride
+		return {
+			std::move(sbt),
+			ShaderBindingTableRegion {
+				VkStridedDeviceAddressRegionKHR { table_addr, region_size, region_size },
+				VkStridedDeviceAddressRegionKHR { table_addr + region_size, record_stride, record_stride },
+				VkStridedDeviceAddressRegionKHR { table_addr + region_size * 2ull, record_stride, record_stride },
+				VkStridedDeviceAddressRegionKHR { }
+			}
+		};
+	}
+
+	/****************************
+	 * Reconstruction
+	 ****************************/
+	inline VKO::DescriptorSetLayout createWaterResolveDescriptorSetLayout(const VkDevice device) {
+		constexpr static VkDescriptorSetLayoutBinding output_binding {
+			.binding = 0u,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.descriptorCount = 1u,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+		};
+		return VKO::createDescriptorSetLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT | VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR,
+			.bindingCount = 1u,
+			.pBindings = &output_binding
+		});
+	}
+
+	inline VKO::PipelineLayout createWaterResolvePipelineLayout(const VkDevice device, const array<VkDescriptorSetLayout, 3u>& layout) {
+		constexpr static VkPushConstantRange resolve_pc {
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.offset = 0u,
+			.size = static_cast<uint32_t>(sizeof(::WaterResolvePushConstant))
+		};
+		return VKO::createPipelineLayout(device, {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = static_cast<uint32_t>(layout.size()),
+			.pSetLayouts = layout.data(),
+			.pushConstantRangeCount = 1u,
+			.pPushConstantRanges = &resolve_pc
+		});
+	}
+
+	VKO::Pipeline createWaterResolvePipeline(const VkDevice device, const VkPipelineCache cache, const VkPipelineLayout layout,
+		ostream& out) {
+		const StartupGraph::Step step("Pipeline creation");
+		out << "Compiling water reconstruction shader" << endl;
+
+		constexpr static shaderc_shader_kind compute_shader = shaderc_compute_shader;
+		const ShaderModuleManager::ShaderBatchCompilationInfo resolve_info {
+			.Device = device,
+			.ShaderFilename = WaterResolveShaderFilename.data(),
+			.ShaderKind = &compute_shader
+		};
+		const auto resolve_shader_gen = ShaderModuleManager::batchShaderCompilation<1u>(&resolve_info, &out);
+
+		return VKO::createComputePipeline(device, cache, {
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT
+#ifndef NDEBUG
+			| VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT
+#endif
+			,
+			.stage = resolve_shader_gen.promise().ShaderStage.front(),
+			.layout = layout
+		});
+	}
+
+	//Create a colour image of the trace layout for a compute or ray tracing shader to write, and for shaders to read.
+	std::pair<VKO::ImageAllocation, VKO::ImageView> createWaterTraceImage(const VkDevice device, const VmaAllocator allocator,
+		const VkExtent2D& extent) {
+		const auto [w, h] = extent;
+		VKO::ImageAllocation image = ImageManager::createImage({
+			.Device = device,
+			.Allocator = allocator,
+			.Category = VKO::AllocationCategory::Attachment,
+
+			.ImageType = VK_IMAGE_TYPE_2D,
+			.Format = ::WaterTraceFormat,
+			.Extent = { w, h, 1u },
+			.Layer = ::WaterTraceLayer,
+			.Usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+		});
+		VKO::ImageView image_view = ImageManager::createFullImageView({
+			.Device = device,
+			.Image = image.second,
+			.ViewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+			.Format = ::WaterTraceFormat,
+			.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+		});
+		return { std::move(image), std::move(image_view) };
+	}
+
+	//Determine if rays should be traced by the ray tracing pipeline.
+	bool useWaterTrace(const VulkanContext& ctx, const SimpleWater::WaterCreateInfo& water_info) {
+		if (!water_info.RayTracingPipeline) {
+			return false;
+		}
+		if (!ctx.Feature.RayTracingPipeline) {
+			*water_info.DebugMessage << "Ray tracing pipeline is not supported, water falls back to ray query" << endl;
+			return false;
+		}
+		return true;
 	}
 
 }
 
 SimpleWater::SimpleWater(const VulkanContext& ctx, const WaterCreateInfo& water_info) :
+	Context(&ctx),
+	Heap(water_info.Heap),
+	Culling(water_info.Culling),
 	DepthFormat(water_info.OutputFormat.DepthFormat),
-	UniformBuffer(createWaterUniformBuffer(ctx.Device, ctx.Allocator)),
+	UniformBuffer(water_info.Arena->allocate(sizeof(::WaterData))),
 
-	WaterShaderLayout(createWaterDescriptorSetLayout(this->getDevice())),
+	RayStage(::useWaterTrace(ctx, water_info) ? VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR : VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT),
+	SceneLayout(createWaterSceneDescriptorSetLayout(this->getDevice())),
 	PipelineLayout(createWaterPipelineLayout(this->getDevice(), array {
 		water_info.CameraDescriptorSetLayout,
-		*this->WaterShaderLayout
-	})),
-	Pipeline(createWaterPipeline(this->getDevice(), this->PipelineLayout, *water_info.DebugMessage, water_info.OutputFormat)),
-
-	WaterCommand(std::get<CommandBufferManager::InFlightCommandBufferArray>(
-		CommandBufferManager::allocateCommandBuffer(ctx, VK_COMMAND_BUFFER_LEVEL_SECONDARY,
-			CommandBufferManager::CommandBufferType::InFlight)
-	)),
+		water_info.Heap->descriptorSetLayout(),
+		*this->SceneLayout
+	}, ::WaterPushConstantStage)),
+	Pipeline(createWaterPipeline(this->getDevice(), *water_info.PipelineLibrary, this->PipelineLayout,
+		*water_info.DebugMessage, water_info.OutputFormat, this->RayStage == VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+		water_info.Surface == SurfaceGeometry::Clipmap)),
+
+	ProfileRegion(water_info.Profiler->registerRegion("Water", true)),
 	Animator(0.0) {
 	{
-		const VKO::Semaphore sema = SemaphoreManager::createTimelineSemaphore(this->getDevice(), 0ull);
+		//water plane and IAS are built on the compute queue, then handed over to the rendering queue
+		const PipelineBarrierInfo::QueueFamilyTransitionInfo compute_to_render {
+			.Source = ctx.QueueIndex.Compute,
+			.Target = ctx.QueueIndex.Render
+		};
+		const VKO::Semaphore compute_sema = SemaphoreManager::createTimelineSemaphore(this->getDevice(), 0ull),
+			render_sema = SemaphoreManager::createTimelineSemaphore(this->getDevice(), 0ull);
+		const VKO::CommandBuffer compute_cmd = VKO::allocateCommandBuffer(this->getDevice(), {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = ctx.CommandPool.ComputeTransient,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1u
+		});
 		const VKO::CommandBuffer cmd = VKO::allocateCommandBuffer(this->getDevice(), {
 			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
 			.commandPool = ctx.CommandPool.Transient,
 			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
 			.commandBufferCount = 1u
 		});
-		CommandBufferManager::beginOneTimeSubmit(cmd);
+		CommandBufferManager::beginOneTimeSubmit(compute_cmd);
 
+		using enum GeometryData::BarrierTarget;
+		using enum GeometryData::OwnershipTransfer;
 		//////////////////////////
 		/// Generate water plane
 		/////////////////////////
 		{
+			const StartupGraph::Step step("Geometry and BLAS recording");
 			const VkCommandBuffer water_gen_cmd = water_info.PlaneGenerator->generate(ctx, {
 				.Dimension = ::WaterDimension,
-				.Subdivision = ::WaterSubdivision
+				.Subdivision = ::WaterSubdivision,
+				.ChunkSubdivision = ::WaterChunkSubdivision
 			}, this->WaterSurface);
-			vkCmdExecuteCommands(cmd, 1u, &water_gen_cmd);
+			vkCmdExecuteCommands(compute_cmd, 1u, &water_gen_cmd);
 
-			using enum GeometryData::BarrierTarget;
-			this->WaterSurface.barrier(cmd, Generation, Rendering);
+			this->WaterSurface.transferOwnership(compute_cmd, Release, Generation, Rendering, compute_to_render);
 		}
 
-		///////////////////////////
-		/// Prepare shader uniform
-		///////////////////////////
-		const VKO::BufferAllocation water_data_staging = BufferManager::createStagingBuffer({
-			this->getDevice(),
-			this->getAllocator(),
-			sizeof(::WaterData)
-		}, BufferManager::HostAccessPattern::Sequential);
-
-		VKO::MappedAllocation water_data = VKO::mapAllocation<::WaterData>(this->getAllocator(), water_data_staging.first);
-		*water_data = {
-			.M = *water_info.ModelMatrix
-		};
-
-		BufferManager::recordCopyBuffer(water_data_staging.second, this->UniformBuffer.second, cmd, sizeof(::WaterData));
-
 		////////////////////////
 		/// Build IAS
 		////////////////////////
-		using glm::mat3x4;
-		static_assert(sizeof(VkTransformMatrixKHR) == sizeof(mat3x4));
-
+		//every in-flight frame has an IAS of its own, such that an IAS is updated only after the device has finished using it
+		const VkDeviceAddress scene_gas_addr = AccelStructManager::addressOf(this->getDevice(), water_info.SceneGAS);
 		const VKO::BufferAllocation instance = BufferManager::createTransientHostBuffer({
 			this->getDevice(),
 			this->getAllocator(),
 			sizeof(VkAccelerationStructureInstanceKHR)
 		}, VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-			BufferManager::HostAccessPattern::Sequential);
+			BufferManager::HostAccessPattern::Sequential, VKO::AllocationCategory::AccelStruct);
 		
 		VKO::MappedAllocation instance_data = VKO::mapAllocation<VkAccelerationStructureInstanceKHR>(this->getAllocator(), instance.first);
-		*instance_data = {
-			.instanceCustomIndex = 0u,
-			.mask = 0xFFu,
-			.instanceShaderBindingTableRecordOffset = 0u,
-			.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR | VK_GEOMETRY_INSTANCE_FORCE_OPAQUE_BIT_KHR,
-			.accelerationStructureReference = AccelStructManager::addressOf(this->getDevice(), water_info.SceneGAS)
-		};
-
-		constexpr static auto identity = glm::identity<mat3x4>();
-		//no need to transform from column-major to row-major, because the order of each number is the same
-		std::memcpy(&instance_data->transform, glm::value_ptr(identity), sizeof(identity));
-
-		const auto ias  = array {
-			VkAccelerationStructureGeometryKHR {
-				.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
-				.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
-				.geometry = {
-					.instances = {
-						.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
-						.arrayOfPointers = VK_FALSE,
-						.data = { .deviceAddress = BufferManager::addressOf(this->getDevice(), instance.second) }
-					}
-				},
-				.flags = VK_GEOMETRY_OPAQUE_BIT_KHR
+		*instance_data = ::createSceneInstance(scene_gas_addr, glm::identity<mat4>());
+
+		CHECK_VULKAN_ERROR(vmaFlushAllocation(this->getAllocator(), instance.first, 0ull, VK_WHOLE_SIZE));
+		instance_data.reset();
+
+		const auto ias = array { ::createSceneInstanceGeometry(BufferManager::addressOf(this->getDevice(), instance.second)) };
+		const AccelStructManager::AccelStructBuildRequest ias_request = ::createSceneAccelStructRequest(ias);
+		array<AccelStructManager::AccelStructBuildRequest, EngineSetting::MaxFrameInFlight> ias_batch;
+		const auto frame_ias_batch = span(ias_batch).first(ctx.FrameInFlight);
+		std::ranges::fill(frame_ias_batch, ias_request);
+
+		std::ranges::move(water_info.AccelStructMemory->build(compute_cmd, frame_ias_batch), this->SceneAccelStruct.begin());
+		this->SceneGASAddress = scene_gas_addr;
+
+		//scratch of each in-flight frame for updating its IAS
+		const VkDeviceSize scratch_alignment = ctx.PhysicalDeviceProperty.AccelStruct.minAccelerationStructureScratchOffsetAlignment;
+		this->SceneUpdateScratchStride = (AccelStructManager::getBuildSize(this->getDevice(), ias_request).updateScratchSize
+			+ scratch_alignment - 1ull) / scratch_alignment * scratch_alignment;
+		this->SceneUpdateScratch = water_info.Arena->allocate(this->SceneUpdateScratchStride * ctx.FrameInFlight,
+			scratch_alignment);
+
+		//release every IAS and the referenced GAS, ray query traverses through both of them
+		array<const BufferArena::Range*, EngineSetting::MaxFrameInFlight + 1u> accel_struct_memory;
+		for (const auto i : std::views::iota(0u, ctx.FrameInFlight)) {
+			accel_struct_memory[i] = &this->SceneAccelStruct[i].Memory;
+		}
+		accel_struct_memory[ctx.FrameInFlight] = water_info.SceneGASMemory;
+		{
+			PipelineBarrier<0u, std::tuple_size_v<decltype(accel_struct_memory)>, 0u> barrier;
+			for (const auto as_mem : span(accel_struct_memory).first(ctx.FrameInFlight + 1u)) {
+				//the GAS was not written by this build
+				barrier.addBufferBarrier({
+					VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+					as_mem == water_info.SceneGASMemory ? VK_ACCESS_2_NONE : VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+					VK_PIPELINE_STAGE_2_NONE,
+					VK_ACCESS_2_NONE
+				}, compute_to_render, as_mem->Buffer, as_mem->Offset, as_mem->Size);
 			}
+			barrier.record(compute_cmd);
+		}
+
+		CHECK_VULKAN_ERROR(vkEndCommandBuffer(compute_cmd));
+		CommandBufferManager::submit<1u, 0u, 1u>({ this->getDevice(), ctx.Queue.Compute }, { compute_cmd }, {{ }},
+			{{{ compute_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}});
+
+		///////////////////////////
+		/// Prepare shader uniform
+		///////////////////////////
+		StagingUploader& uploader = *water_info.Uploader;
+		const ::WaterData water_data {
+			.M = *water_info.ModelMatrix
 		};
-		constexpr static auto ias_range = array {
-			VkAccelerationStructureBuildRangeInfoKHR {
-				.primitiveCount = 1u,
-				.primitiveOffset = 0u
-				//the rests are ignored for IAS
+		uploader.upload({
+			.Destination = this->UniformBuffer.Buffer,
+			.Offset = this->UniformBuffer.Offset,
+			.Target = {
+				VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_SHADER_STORAGE_READ_BIT
 			}
-		};
-		auto [accel_struct, scratch] = AccelStructManager::buildAccelStruct({
-			.Device = this->getDevice(),
-			.Allocator = this->getAllocator(),
-			.Command = cmd,
-
-			.Type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR,
-			.Flag = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR
-		}, ias, ias_range);
-		this->SceneAccelStruct = std::move(accel_struct);
+		}, std::as_bytes(span(&water_data, 1u)));
 
 		/////////////////////////
 		/// Create water texture
 		////////////////////////
-		const auto create_water_texture = [device = this->getDevice(), allocator = this->getAllocator(), cmd = *cmd]
+		//prefer generating all levels in a single compute dispatch, and fall back to blit
+		const MipMapGenerator& mip_map_generator = *water_info.MipMap;
+		const auto use_compute_mip_map = [&mip_map_generator](const ImageManager::ImageReadResult& input) -> bool {
+			return ImageManager::requireMipMapGeneration(input)
+				&& mip_map_generator.isSupported(input.Format, input.Extent, ::WaterTextureMipMapCount);
+		};
+		const auto create_water_texture = [device = this->getDevice(), allocator = this->getAllocator(), &uploader, &use_compute_mip_map]
 			(const ImageManager::ImageReadResult& input, auto& output) -> void {
-			output.Image = ImageManager::createImageFromReadResult(cmd, input, {
+			//use mip-maps provided by the read result if there is any
+			const bool generate_mip_map = ImageManager::requireMipMapGeneration(input),
+				compute_mip_map = use_compute_mip_map(input);
+			const uint32_t level = generate_mip_map ? ::WaterTextureMipMapCount
+				: std::min(::WaterTextureMipMapCount, static_cast<uint32_t>(input.Level.size()));
+			const VkImageCreateFlags flag = compute_mip_map ? MipMapGenerator::requiredCreateFlag(input.Format) : VkImageCreateFlags { };
+			const VkImageUsageFlags usage = uploader.imageUsage(input.Format, flag,
+				VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+				| (compute_mip_map ? MipMapGenerator::RequiredUsage : VkImageUsageFlags { }));
+			output.Image = ImageManager::createImage(input, {
 				.Device = device,
 				.Allocator = allocator,
-				.Level = ::WaterTextureMipMapCount,
-				.Usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+				.Flag = flag,
+				.Level = level,
+				.Usage = usage,
 				.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
 			});
 			output.ImageView = ImageManager::createFullImageView({
@@ -345,17 +744,76 @@ SimpleWater::SimpleWater(const VulkanContext& ctx, const WaterCreateInfo& water_
 				.Image = output.Image.second,
 				.ViewType = VK_IMAGE_VIEW_TYPE_2D,
 				.Format = input.Format,
-				.Aspect = VK_IMAGE_ASPECT_COLOR_BIT
+				.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+				.Usage = VK_IMAGE_USAGE_SAMPLED_BIT
 			});
 
+			//mip-map is generated on the rendering queue, because transfer queue does not support blit
+			const auto [w, h] = input.Extent;
+			if (generate_mip_map) {
+				uploader.upload({
+					.Destination = output.Image.second,
+					.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+					.Extent = { w, h, 1u },
+					.Layer = input.Layer,
+					.TargetLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					.Target = compute_mip_map
+						? StagingUploader::UploadTarget { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT }
+						: StagingUploader::UploadTarget { VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT },
+					.Usage = usage
+				}, input.Pixel);
+			} else {
+				uploader.upload({
+					.Destination = output.Image.second,
+					.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+					.Extent = { w, h, 1u },
+					.Layer = input.Layer,
+					.Level = span(input.Level).first(level),
+					.TargetLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					.Target = { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT },
+					.Usage = usage
+				}, input.Pixel);
+			}
+		};
+		create_water_texture(*water_info.WaterNormalmap, this->Normalmap);
+		create_water_texture(*water_info.WaterDistortion, this->Distortion);
+		const StagingUploader::Ticket upload_ticket = uploader.flush();
+
+		CommandBufferManager::beginOneTimeSubmit(cmd);
+		//resources of compute generation are retained until the submission completes
+		array<std::optional<MipMapGenerator::Generation>, 2u> mip_map_generation;
+		const auto generate_water_mip_map = [cmd = *cmd, &mip_map_generator, &use_compute_mip_map](
+			const ImageManager::ImageReadResult& input, const auto& output, const MipMapGenerator::ReductionFilter filter,
+			std::optional<MipMapGenerator::Generation>& generation) -> void {
+			if (!ImageManager::requireMipMapGeneration(input)) {
+				return;
+			}
+			if (use_compute_mip_map(input)) {
+				generation = mip_map_generator.record(cmd, {
+					.Image = output.Image.second,
+					.Format = input.Format,
+					.Extent = input.Extent,
+					.Layer = input.Layer,
+					.Level = ::WaterTextureMipMapCount,
+					.Filter = filter,
+
+					.InputStage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					.InputAccess = VK_ACCESS_2_NONE,
+					.InputLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					.OutputStage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+					.OutputAccess = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+					.OutputLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+				});
+				return;
+			}
 			const auto [w, h] = input.Extent;
 			ImageManager::recordFullMipMapGeneration<::WaterTextureMipMapCount>(cmd, output.Image.second, {
 				.Aspect = VK_IMAGE_ASPECT_COLOR_BIT,
 				.Extent = { w, h, 1u },
 				.LayerCount = input.Layer,
 
-				.InputStage = VK_PIPELINE_STAGE_2_COPY_BIT,
-				.InputAccess = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				.InputStage = VK_PIPELINE_STAGE_2_BLIT_BIT,
+				.InputAccess = VK_ACCESS_2_NONE,
 				.OutputStage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
 				.OutputAccess = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
 
@@ -363,8 +821,9 @@ SimpleWater::SimpleWater(const VulkanContext& ctx, const WaterCreateInfo& water_
 				.OutputLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 			});
 		};
-		create_water_texture(*water_info.WaterNormalmap, this->Normalmap);
-		create_water_texture(*water_info.WaterDistortion, this->Distortion);
+		//normal is renormalised on each level so it does not flatten out in the distance
+		generate_water_mip_map(*water_info.WaterNormalmap, this->Normalmap, MipMapGenerator::ReductionFilter::Normal, mip_map_generation[0]);
+		generate_water_mip_map(*water_info.WaterDistortion, this->Distortion, MipMapGenerator::ReductionFilter::Average, mip_map_generation[1]);
 		this->TextureSampler = ImageManager::createTextureSampler(this->getDevice(), ::WaterTextureAnisotropy);
 		this->SceneDepthSampler = VKO::createSampler(this->getDevice(), {
 			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
@@ -377,138 +836,187 @@ SimpleWater::SimpleWater(const VulkanContext& ctx, const WaterCreateInfo& water_
 			.maxLod = VK_LOD_CLAMP_NONE
 		});
 
-		///////////////////
-		/// Flush memory
-		///////////////////
-		const auto flush_allocation = array {
-			*water_data_staging.first,
-			*instance.first
-		};
-		CHECK_VULKAN_ERROR(vmaFlushAllocations(this->getAllocator(), static_cast<uint32_t>(flush_allocation.size()), flush_allocation.data(),
-			nullptr, nullptr));
-
-		instance_data.reset();
-		water_data.reset();
-
 		/////////////
 		/// Barrier
 		/////////////
-		PipelineBarrier<0u, 2u, 0u> barrier;
-		barrier.addBufferBarrier({
-			VK_PIPELINE_STAGE_2_COPY_BIT,
-			VK_ACCESS_2_TRANSFER_WRITE_BIT,
-			VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-			VK_ACCESS_2_SHADER_STORAGE_READ_BIT
-		}, this->UniformBuffer.second);
-		barrier.addBufferBarrier({
-			VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
-			VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
-			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-			VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
-		}, this->SceneAccelStruct.AccelStructMemory.second);
+		PipelineBarrier<1u, std::tuple_size_v<decltype(accel_struct_memory)>, 0u> barrier;
+		//acquire acceleration structures from the compute queue, every IAS is also updated in place when drawing
+		for (const auto as_mem : accel_struct_memory) {
+			barrier.addBufferBarrier({
+				VK_PIPELINE_STAGE_2_NONE,
+				VK_ACCESS_2_NONE,
+				this->RayStage | VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+				as_mem == water_info.SceneGASMemory ? VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
+					: VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR
+			}, compute_to_render, as_mem->Buffer, as_mem->Offset, as_mem->Size);
+		}
+		if (this->RayStage != VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT) {
+			//every other input was made visible to shaders of rasterisation, they are also read by ray tracing shaders
+			barrier.addMemoryBarrier({
+				VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_NONE,
+				this->RayStage,
+				VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+			});
+		}
 
 		barrier.record(cmd);
+		this->WaterSurface.transferOwnership(cmd, Acquire, Generation, Rendering, compute_to_render);
 
 		////////////////////
 		/// Submission
 		////////////////////
 		CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
-		CommandBufferManager::submit<1u, 0u, 1u>({ this->getDevice(), ctx.Queue.Render }, { cmd }, {{ }},
-			{{{ sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}});
-		SemaphoreManager::wait<1u>(this->getDevice(), { }, {{{ sema, 1ull }}});
+		CommandBufferManager::submit<1u, 2u, 1u>({ this->getDevice(), ctx.Queue.Render }, { cmd },
+			{{
+				{ compute_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull },
+				uploader.waitOperation(upload_ticket, VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT)
+			}},
+			{{{ render_sema, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, 1ull }}});
+		//rendering submission waits for the compute submission and the upload, so all of them are complete
+		{
+			const StartupGraph::Step step("Device wait");
+			SemaphoreManager::wait<1u>(this->getDevice(), { }, {{{ render_sema, 1ull }}});
+		}
 
 		this->WaterSurface.releaseTemporary();
 	}
 	//////////////////////
-	/// Descriptor buffer
+	/// Descriptor heap
 	//////////////////////
 	{
-		const auto water_ds_layout = array { *this->WaterShaderLayout };
-		this->WaterShaderDescriptorBuffer = DescriptorBufferManager(ctx, water_ds_layout,
-			VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT);
-
-		const VkDescriptorAddressInfoEXT water_data_addr {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
-			.address = BufferManager::addressOf(this->getDevice(), this->UniformBuffer.second),
-			.range = sizeof(::WaterData)
-		};
-		array<VkDescriptorImageInfo, 2u> water_texture_info;
-		transform(array { *this->Normalmap.ImageView, *this->Distortion.ImageView }, water_texture_info.begin(),
-			[sampler = *this->TextureSampler](const VkImageView iv) noexcept {
-				return VkDescriptorImageInfo {
-					.sampler = sampler,
-					.imageView = iv,
-					.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-				};
-			});
-
-		using DU = DescriptorBufferManager::DescriptorUpdater;
-		const DU water_ds_updater = this->WaterShaderDescriptorBuffer.createUpdater(ctx);
-
-		//we update those non-array bindings first
-		const VkDescriptorImageInfo env_map_info = water_info.SkyRenderer->skyImageDescriptor();
-		const auto water_ds_get = array<DU::DescriptorGetInfo, 3u> {{
-			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, { .pStorageBuffer = &water_data_addr } },
-			{ VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, {
-				.accelerationStructure = AccelStructManager::addressOf(this->getDevice(), this->SceneAccelStruct.AccelStruct) 
-			}},
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { .pCombinedImageSampler = &env_map_info } }
-		}};
-		for (const auto i : iota(0u, water_ds_get.size())) {
-			water_ds_updater.update({
-				.SetLayout = this->WaterShaderLayout,
-				.SetIndex = 0u,
-				.Binding = i,
-				.GetInfo = water_ds_get[i]
-			});
-		}
-
-		//samplers are arranged in an array in the same binding slot
-		array<DU::DescriptorGetInfo, 3u> water_sampler_ds_get;
-		std::ranges::for_each(water_sampler_ds_get, [](auto& get_info) constexpr noexcept {
-			get_info.Type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		DescriptorHeap& heap = *this->Heap;
+		const VkDescriptorImageInfo& scene_texture = water_info.SceneTexture;
+
+		this->HeapSlot.WaterData = heap.addStorageBuffer(this->UniformBuffer.Address, sizeof(::WaterData));
+		const BufferArena::Range& plane_prop = this->WaterSurface.inputParameter();
+		this->HeapSlot.WaterPlane = heap.addStorageBuffer(plane_prop.Address, plane_prop.Size);
+		this->HeapSlot.SceneTexture = heap.addSampledImage(scene_texture.imageView, scene_texture.imageLayout);
+		this->HeapSlot.Normalmap = heap.addSampledImage(this->Normalmap.ImageView);
+		this->HeapSlot.Distortion = heap.addSampledImage(this->Distortion.ImageView);
+		//scene depth texture will be written by reshape function
+		this->HeapSlot.SceneDepth = heap.allocate(DescriptorHeap::DescriptorType::SampledImage);
+
+		this->HeapSlot.SceneTextureSampler = heap.addSampler(scene_texture.sampler);
+		this->HeapSlot.TextureSampler = heap.addSampler(this->TextureSampler);
+		this->HeapSlot.SceneDepthSampler = heap.addSampler(this->SceneDepthSampler);
+		this->HeapSlot.EnvironmentMap = water_info.SkyRenderer->skyBoxHeapIndex();
+	}
+	////////////////////
+	/// Surface clipmap
+	////////////////////
+	if (water_info.Surface == SurfaceGeometry::Clipmap) {
+		//the focus is kept on the plane and every level is snapped by up to a cell,
+		//so the coarsest level covers the whole plane if it extends the plane dimension plus a cell from its centre
+		const double coarsest_cell = std::max(::WaterDimension.x, ::WaterDimension.y) / (::WaterClipmapGrid / 2u - 1u);
+		this->Clipmap.emplace(SurfaceClipmap {
+			.InverseModel = glm::inverse(dmat4(*water_info.ModelMatrix)),
+			.CellSize = static_cast<float>(coarsest_cell / (1u << (::WaterClipmapLevel - 1u))),
+			.VertexCount = ::WaterClipmapGrid * ::WaterClipmapGrid * 6u * ::WaterClipmapLevel
 		});
-		water_sampler_ds_get[0].Data.pCombinedImageSampler = &water_info.SceneTexture;
-		//there is one descriptor for scene depth texture, which will be initialised by reshape function
-		transform(water_texture_info, water_sampler_ds_get.begin() + 1u, [](const auto& img_info) constexpr noexcept {
-			return DU::DescriptorGetInfo {
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, { .pCombinedImageSampler = &img_info }
-			};
+	}
+	/////////////////////////
+	/// Ray tracing pipeline
+	/////////////////////////
+	if (this->RayStage == VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR) {
+		VKO::DescriptorSetLayout trace_layout = ::createWaterTraceDescriptorSetLayout(this->getDevice());
+		VKO::PipelineLayout trace_pipeline_layout = ::createWaterPipelineLayout(this->getDevice(), array {
+			water_info.CameraDescriptorSetLayout,
+			water_info.Heap->descriptorSetLayout(),
+			*trace_layout
+		}, ::WaterTracePushConstantStage);
+		VKO::Pipeline trace_pipeline = ::createWaterTracePipeline(this->getDevice(), ctx.PipelineCache, trace_pipeline_layout,
+			*water_info.DebugMessage);
+		auto [sbt, sbt_region] = ::createWaterShaderBindingTable(ctx, trace_pipeline);
+
+		//trace image will be created by reshape function
+		this->Trace.emplace(TracePipeline {
+			.SceneLayout = std::move(trace_layout),
+			.PipelineLayout = std::move(trace_pipeline_layout),
+			.Pipeline = std::move(trace_pipeline),
+			.ShaderBindingTable = std::move(sbt),
+			.Region = sbt_region,
+			.HeapSlot = this->Heap->allocate(DescriptorHeap::DescriptorType::SampledImage),
+			.Scale = static_cast<uint32_t>(water_info.RayTracingResolution)
 		});
-		
-		for (const auto i : iota(0u, water_sampler_ds_get.size())) {
-			water_ds_updater.update({
-				.SetLayout = this->WaterShaderLayout,
-				.SetIndex = 0u,
-				.Binding = 3u,
-				.ArrayLayer = i,
-				.GetInfo = water_sampler_ds_get[i]
+
+		if (this->Trace->Scale > 1u) {
+			VKO::DescriptorSetLayout output_layout = ::createWaterResolveDescriptorSetLayout(this->getDevice());
+			VKO::PipelineLayout resolve_pipeline_layout = ::createWaterResolvePipelineLayout(this->getDevice(), {
+				water_info.CameraDescriptorSetLayout,
+				water_info.Heap->descriptorSetLayout(),
+				*output_layout
+			});
+			VKO::Pipeline resolve_pipeline = ::createWaterResolvePipeline(this->getDevice(), ctx.PipelineCache, resolve_pipeline_layout,
+				*water_info.DebugMessage);
+			//history is reprojected to arbitrary positions
+			VKO::Sampler history_sampler = VKO::createSampler(this->getDevice(), {
+				.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+				.magFilter = VK_FILTER_LINEAR,
+				.minFilter = VK_FILTER_LINEAR,
+				.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+				.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+				.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+				.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+				.maxLod = VK_LOD_CLAMP_NONE
+			});
+			DescriptorHeap::Slot history_sampler_slot = this->Heap->addSampler(history_sampler);
+
+			//accumulation images will be created by reshape function
+			this->Reconstruction.emplace(TraceReconstruction {
+				.OutputLayout = std::move(output_layout),
+				.PipelineLayout = std::move(resolve_pipeline_layout),
+				.Pipeline = std::move(resolve_pipeline),
+				.HistorySampler = std::move(history_sampler),
+				.HistorySamplerSlot = std::move(history_sampler_slot),
+				.ViewHistory = water_info.Arena->allocate(sizeof(mat4) * 2u),
+				.Accumulation = {{
+					{ .HeapSlot = this->Heap->allocate(DescriptorHeap::DescriptorType::SampledImage) },
+					{ .HeapSlot = this->Heap->allocate(DescriptorHeap::DescriptorType::SampledImage) }
+				}},
+				.Frame = 0ull
 			});
 		}
+	} else if (water_info.RayTracingResolution != TraceResolution::Full) {
+		*water_info.DebugMessage << "Water rays are traced at full resolution by ray query" << endl;
 	}
 }
 
 inline VkDevice SimpleWater::getDevice() const noexcept {
-	return this->UniformBuffer.second->get_deleter().Device;
+	return this->Context->Device;
 }
 
 inline VmaAllocator SimpleWater::getAllocator() const noexcept {
-	return this->UniformBuffer.first->get_deleter().Allocator;
+	return this->Context->Allocator;
 }
 
 VkImageView SimpleWater::getSceneDepth() const noexcept {
 	return this->SceneDepth.ImageView;
 }
 
+VkImage SimpleWater::getSceneDepthImage() const noexcept {
+	return this->SceneDepth.Image.second;
+}
+
+VkPipelineStageFlags2 SimpleWater::getSceneGASStage() const noexcept {
+	//IAS update references the GAS, and rays traverse through it
+	return this->RayStage | VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+}
+
+void SimpleWater::replaceSceneGAS(const VkAccelerationStructureKHR gas) noexcept {
+	this->SceneGASAddress = AccelStructManager::addressOf(this->getDevice(), gas);
+}
+
 #define EXPAND_RECORD_INFO const auto [stage, access, layout] = record_info
 
 void SimpleWater::beginSceneDepthRecord(const VkCommandBuffer cmd, const SceneDepthRecordInfo& record_info) const noexcept {
 	EXPAND_RECORD_INFO;
 
+	//scene depth of the last frame may be read by water and by the depth pyramid build
 	PipelineBarrier<0u, 0u, 1u> barrier;
 	barrier.addImageBarrier({
-		VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-		VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+		VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | this->RayStage,
+		VK_ACCESS_2_NONE,
 		stage,
 		access
 	}, {
@@ -525,7 +1033,7 @@ void SimpleWater::endSceneDepthRecord(const VkCommandBuffer cmd, const SceneDept
 	barrier.addImageBarrier({
 		stage,
 		access,
-		VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | this->RayStage,
 		VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
 	}, {
 		layout,
@@ -547,6 +1055,7 @@ void SimpleWater::reshape(const RendererInterface::ReshapeInfo& reshape_info) {
 	depth.Image = ImageManager::createImage({
 		.Device = this->getDevice(),
 		.Allocator = this->getAllocator(),
+		.Category = VKO::AllocationCategory::Attachment,
 
 		.ImageType = VK_IMAGE_TYPE_2D,
 		.Format = this->DepthFormat,
@@ -561,108 +1070,376 @@ void SimpleWater::reshape(const RendererInterface::ReshapeInfo& reshape_info) {
 		.Aspect = VK_IMAGE_ASPECT_DEPTH_BIT
 	});
 
-	const VkDescriptorImageInfo scene_depth_img {
-		.sampler = this->SceneDepthSampler,
-		.imageView = this->SceneDepth.ImageView,
-		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-	};
+	this->Heap->writeSampledImage(this->HeapSlot.SceneDepth, depth.ImageView);
 
-	const DescriptorBufferManager::DescriptorUpdater updater = this->WaterShaderDescriptorBuffer.createUpdater(*ctx);
-	updater.update({
-		.SetLayout = this->WaterShaderLayout,
-		.SetIndex = 0u,
-		.Binding = 3u,
-		.ArrayLayer = 3u,
-		.GetInfo = {
-			.Type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			.Data = { .pCombinedImageSampler = &scene_depth_img }
+	if (this->Trace) {
+		auto& trace = *this->Trace;
+		//every partially covered block also has a traced pixel
+		trace.Extent = {
+			(w + trace.Scale - 1u) / trace.Scale,
+			(h + trace.Scale - 1u) / trace.Scale
+		};
+		trace.ImageView = { };
+		std::tie(trace.Image, trace.ImageView) = ::createWaterTraceImage(this->getDevice(), this->getAllocator(), trace.Extent);
+
+		//written by ray tracing and read by water shading or reconstruction without changing layout
+		this->Heap->writeSampledImage(trace.HeapSlot, trace.ImageView, VK_IMAGE_LAYOUT_GENERAL);
+	}
+	if (this->Reconstruction) {
+		auto& recon = *this->Reconstruction;
+		for (auto& accum : recon.Accumulation) {
+			accum.ImageView = { };
+			std::tie(accum.Image, accum.ImageView) = ::createWaterTraceImage(this->getDevice(), this->getAllocator(), extent);
+			this->Heap->writeSampledImage(accum.HeapSlot, accum.ImageView, VK_IMAGE_LAYOUT_GENERAL);
 		}
-	});
+		recon.Extent = extent;
+		//history of the old size is discarded
+		recon.Frame = 0ull;
+	}
 }
 
 RendererInterface::DrawResult SimpleWater::draw(const DrawInfo& draw_info) const {
-	const auto [inherited_draw_info, geometry, fbo_input, depth_layout] = draw_info;
-	const auto& [ctx, camera, delta_time, frame_idx, vp, render_area, resolve_img, resolve_img_view] = *inherited_draw_info;
+	const auto [inherited_draw_info, geometry, fbo_input, depth_layout, worker_idx, frame_count, occluder, scene_transform] = draw_info;
+	const auto& [ctx, camera, heap, profiler, job, worker_cmd, frame_memory, delta_time, frame_idx, vp, render_area, resolve_img, resolve_img_view] =
+		*inherited_draw_info;
 
-	const VkCommandBuffer cmd = this->WaterCommand[frame_idx];
+	const VkCommandBuffer cmd = worker_cmd->allocateSecondary(worker_idx, frame_idx);
 	CommandBufferManager::beginOneTimeSubmitSecondary(cmd);
-
-	/***********************
-	 * Subpass dependencies
-	 ***********************/
-	const FramebufferManager::PrepareFramebufferInfo prepare_info {
-		.DepthLayout = depth_layout
-	};
-	const FramebufferManager::SubpassOutputDependencyIssueInfo issue_info {
-		.PrepareInfo = &prepare_info
-	};
-	FramebufferManager::issueSubpassOutputDependency(cmd, *fbo_input, issue_info);
-
-	/*******************
-	 * Rendering
-	 ******************/
-	//we will draw on the existing input framebuffer, so no need to clear
-	FramebufferManager::beginInitialRendering(cmd, *fbo_input, {
-		.DependencyInfo = &issue_info,
-		.RenderArea = render_area
-	});
-
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->Pipeline);
-	vkCmdSetViewport(cmd, 0u, 1u, &vp);
-	vkCmdSetScissor(cmd, 0u, 1u, &render_area);
+	profiler->beginRegion(cmd, frame_idx, this->ProfileRegion);
 
 	/********************
 	 * Descriptor buffer
 	 *******************/
+	//culling and rendering share the same descriptor buffers
 	const auto ds = array {
 		camera->descriptorBufferBindingInfo(),
-		VkDescriptorBufferBindingInfoEXT {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
-			.address = BufferManager::addressOf(this->getDevice(), this->WaterShaderDescriptorBuffer.buffer()),
-			.usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT
-		}
+		heap->descriptorBufferBindingInfo()
 	};
 
 	array<uint32_t, ds.size()> ds_idx;
 	std::iota(ds_idx.begin(), ds_idx.end(), 0u);
 	const auto ds_offset = array {
 		camera->descriptorBufferOffset(frame_idx),
-		this->WaterShaderDescriptorBuffer.offset(0u)
+		VkDeviceSize { 0 }
 	};
 
 	vkCmdBindDescriptorBuffersEXT(cmd, static_cast<uint32_t>(ds.size()), ds.data());
 	vkCmdSetDescriptorBufferOffsetsEXT(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->PipelineLayout, 0u,
 		static_cast<uint32_t>(ds.size()), ds_idx.data(), ds_offset.data());
 
+	/*******************
+	 * Push constant
+	 ******************/
+	//shared by ray tracing and water shading
+	this->Animator = glm::mod(this->Animator + delta_time * ::WaterAnimationSpeed, ::WaterNormalScale);
+
+	const VkDeviceAddress geo_addr = BufferManager::addressOf(this->getDevice(), geometry->buffer());
+	const auto [vertex_offset, index_offset, indirect_offset, chunk_offset] = geometry->attributeInfo().Offset;
+	const auto& slot = this->HeapSlot;
+	//water shading reads the reconstruction of this frame if there is one, otherwise reads the trace image directly
+	const uint32_t trace_scale = this->Trace ? this->Trace->Scale : 1u,
+		trace_jitter = this->Reconstruction ? ::calcTraceJitter(this->Reconstruction->Frame, trace_scale) : 0u,
+		current_accum = this->Reconstruction ? static_cast<uint32_t>(this->Reconstruction->Frame % 2ull) : 0u;
+	const uint32_t trace_image = this->Reconstruction ? this->Reconstruction->Accumulation[current_accum].HeapSlot.index()
+		: this->Trace ? this->Trace->HeapSlot.index() : 0u;
+	//the clipmap is centred around the camera projected onto the plane
+	vec2 clipmap_focus(0.0f);
+	if (this->Clipmap) {
+		const dvec4 camera_plane = this->Clipmap->InverseModel
+			* dvec4(camera->position() - dvec3(0.0, ::WaterAltitudeOffset, 0.0), 1.0);
+		clipmap_focus = vec2(glm::clamp(dvec2(camera_plane.x, camera_plane.z), dvec2(0.0), ::WaterDimension));
+	}
+	const ::WaterPushConstant water_pc {
+		.WaterData = slot.WaterData.index(),
+		.WaterPlane = slot.WaterPlane.index(),
+		.SceneTexture = slot.SceneTexture.index(),
+		.Normalmap = slot.Normalmap.index(),
+		.Distortion = slot.Distortion.index(),
+		.SceneDepth = slot.SceneDepth.index(),
+		.EnvironmentMap = slot.EnvironmentMap.Image,
+		.SceneTextureSampler = slot.SceneTextureSampler.index(),
+		.TextureSampler = slot.TextureSampler.index(),
+		.SceneDepthSampler = slot.SceneDepthSampler.index(),
+		.EnvironmentMapSampler = slot.EnvironmentMap.Sampler,
+		.TraceImage = trace_image,
+		.TraceScale = trace_scale,
+		.TraceJitter = trace_jitter,
+		.AniTim = static_cast<float>(this->Animator),
+		.ClipCel = this->Clipmap ? this->Clipmap->CellSize : 0.0f,
+		.ClipFoc = clipmap_focus,
+		.V = geo_addr + vertex_offset,
+		.I = geo_addr + index_offset
+	};
+
+	/********************
+	 * Update scene IAS
+	 *******************/
+	//the IAS of this in-flight frame was last used by the device a whole in-flight cycle earlier, so it is updated in place
+	const VkAccelerationStructureKHR scene_as = this->SceneAccelStruct[frame_idx].AccelStruct;
 	{
-		this->Animator = glm::mod(this->Animator + delta_time * ::WaterAnimationSpeed, ::WaterNormalScale);
+		const VkAccelerationStructureInstanceKHR instance_data = ::createSceneInstance(this->SceneGASAddress,
+			scene_transform ? *scene_transform : glm::identity<mat4>());
+		const FrameAllocator::Allocation instance = frame_memory->allocate(frame_idx, sizeof(instance_data), ::SceneInstanceAlignment);
+		std::memcpy(instance.Data, &instance_data, sizeof(instance_data));
+
+		const auto ias = array { ::createSceneInstanceGeometry(instance.Address) };
+		const AccelStructManager::AccelStructBuildRequest ias_request = ::createSceneAccelStructRequest(ias);
+		const AccelStructManager::AccelStructBuildTarget ias_target {
+			.AccelStruct = scene_as,
+			.Scratch = this->SceneUpdateScratch.Address + this->SceneUpdateScratchStride * frame_idx,
+			.Source = scene_as
+		};
+		AccelStructManager::recordBuild(cmd, span(&ias_request, 1u), span(&ias_target, 1u));
+
+		PipelineBarrier<1u, 0u, 0u> barrier;
+		barrier.addMemoryBarrier({
+			VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+			VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+			this->RayStage,
+			VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR
+		});
+		barrier.record(cmd);
+	}
+
+	/*********************************
+	 * Trace reflection and refraction
+	 *********************************/
+	if (this->Trace) {
+		const TracePipeline& trace = *this->Trace;
+		const VkImageSubresourceRange trace_range = ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+		{
+			//the trace image of the last frame may still be read by water shading or reconstruction, its content is discarded
+			PipelineBarrier<0u, 0u, 1u> barrier;
+			barrier.addImageBarrier({
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_NONE,
+				VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+				VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+			}, {
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_GENERAL
+			}, trace.Image.second, trace_range);
+			barrier.record(cmd);
+		}
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, trace.Pipeline);
+		vkCmdSetDescriptorBufferOffsetsEXT(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, trace.PipelineLayout, 0u,
+			static_cast<uint32_t>(ds.size()), ds_idx.data(), ds_offset.data());
+		{
+			const VkWriteDescriptorSetAccelerationStructureKHR scene_as_info {
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
+				.accelerationStructureCount = 1u,
+				.pAccelerationStructures = &scene_as
+			};
+			const VkDescriptorImageInfo trace_image_info {
+				.imageView = trace.ImageView,
+				.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+			};
+			const auto trace_ds = array {
+				VkWriteDescriptorSet {
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.pNext = &scene_as_info,
+					.dstBinding = 0u,
+					.dstArrayElement = 0u,
+					.descriptorCount = 1u,
+					.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR
+				},
+				VkWriteDescriptorSet {
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.dstBinding = 1u,
+					.dstArrayElement = 0u,
+					.descriptorCount = 1u,
+					.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+					.pImageInfo = &trace_image_info
+				}
+			};
+			vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, trace.PipelineLayout, 2u,
+				static_cast<uint32_t>(trace_ds.size()), trace_ds.data());
+		}
+		vkCmdPushConstants(cmd, trace.PipelineLayout, ::WaterTracePushConstantStage, 0u, sizeof(water_pc), &water_pc);
+
+		//a ray is launched from every traced pixel, and those not landing on visible water surface are terminated early
+		const auto& [raygen, miss, hit, callable] = trace.Region;
+		vkCmdTraceRaysKHR(cmd, &raygen, &miss, &hit, &callable, trace.Extent.width, trace.Extent.height, 1u);
+
+		PipelineBarrier<0u, 0u, 1u> barrier;
+		barrier.addImageBarrier({
+			VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			this->Reconstruction ? VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
+		}, {
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_GENERAL
+		}, trace.Image.second, trace_range);
+		barrier.record(cmd);
+	}
+
+	/********************************
+	 * Reconstruct full resolution
+	 ********************************/
+	if (this->Reconstruction) {
+		const TraceReconstruction& recon = *this->Reconstruction;
+		const auto& output = recon.Accumulation[current_accum],
+			&history = recon.Accumulation[1u - current_accum];
+		const BufferArena::Range& view_history = recon.ViewHistory;
+		const VkImageSubresourceRange accum_range = ImageManager::createFullSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
+		{
+			PipelineBarrier<0u, 1u, 1u> barrier;
+			//the output was the history of the last frame, and was read by reconstruction and water shading two frames ago
+			barrier.addImageBarrier({
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_NONE,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+			}, {
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_GENERAL
+			}, output.Image.second, accum_range);
+			//view is written by reconstruction in one frame and read in the next
+			barrier.addBufferBarrier({
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+			}, { }, view_history.Buffer, view_history.Offset, view_history.Size);
+			barrier.record(cmd);
+		}
+
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, recon.Pipeline);
+		vkCmdSetDescriptorBufferOffsetsEXT(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, recon.PipelineLayout, 0u,
+			static_cast<uint32_t>(ds.size()), ds_idx.data(), ds_offset.data());
+		{
+			const VkDescriptorImageInfo output_info {
+				.imageView = output.ImageView,
+				.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+			};
+			const VkWriteDescriptorSet output_ds {
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstBinding = 0u,
+				.dstArrayElement = 0u,
+				.descriptorCount = 1u,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.pImageInfo = &output_info
+			};
+			vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, recon.PipelineLayout, 2u, 1u, &output_ds);
+		}
 
-		const VkDeviceAddress geo_addr = BufferManager::addressOf(this->getDevice(), geometry->buffer());
-		const auto [vertex_offset, index_offset, indirect_offset] = geometry->attributeInfo().Offset;
-		const ::FragmentPushConstant frag_pc {
-			geo_addr + vertex_offset,
-			geo_addr + index_offset,
-			static_cast<float>(this->Animator)
+		//view history alternates like the accumulation images
+		const VkDeviceSize current_view = sizeof(mat4) * current_accum,
+			previous_view = sizeof(mat4) * (1u - current_accum);
+		const ::WaterResolvePushConstant resolve_pc {
+			.CurrentView = view_history.Address + current_view,
+			.PreviousView = view_history.Address + previous_view,
+			.WaterData = slot.WaterData.index(),
+			.WaterPlane = slot.WaterPlane.index(),
+			.SceneDepth = slot.SceneDepth.index(),
+			.SceneDepthSampler = slot.SceneDepthSampler.index(),
+			.TraceImage = this->Trace->HeapSlot.index(),
+			.History = history.HeapSlot.index(),
+			.HistorySampler = recon.HistorySamplerSlot.index(),
+			.TraceScale = trace_scale,
+			.TraceJitter = trace_jitter,
+			//neither the history nor the view of the last frame exists on the first frame
+			.ResolveFlag = recon.Frame > 0ull ? ::WaterResolveHistoryBit : 0u,
+			//every pixel in a block is traced once over this many frames
+			.Blend = std::max(1.0f / static_cast<float>(trace_scale * trace_scale), ::WaterResolveMinBlend)
 		};
-		vkCmdPushConstants(cmd, this->PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0u, sizeof(frag_pc), &frag_pc);
+		vkCmdPushConstants(cmd, recon.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0u, sizeof(resolve_pc), &resolve_pc);
+		vkCmdDispatch(cmd, (recon.Extent.width + ::WaterResolveLocalSize - 1u) / ::WaterResolveLocalSize,
+			(recon.Extent.height + ::WaterResolveLocalSize - 1u) / ::WaterResolveLocalSize, 1u);
+
+		PipelineBarrier<0u, 0u, 1u> barrier;
+		//the output is read by water shading in this frame, and by reconstruction in the next as history
+		barrier.addImageBarrier({
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
+		}, {
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_GENERAL
+		}, output.Image.second, accum_range);
+		barrier.record(cmd);
+
+		recon.Frame++;
+	}
+
+	/*******************
+	 * Cull water tiles
+	 ******************/
+	//water data begins with the model matrix, the clipmap has no tile and is always drawn whole
+	if (!this->Clipmap) {
+		this->Culling->record(cmd, *camera, {
+			.Geometry = &this->WaterSurface,
+			.FrameIndex = frame_idx,
+			.FrameCount = frame_count,
+			.Transform = this->HeapSlot.WaterData.index(),
+			.MinHeight = ::WaterAltitudeOffset,
+			.MaxHeight = ::WaterAltitudeOffset,
+			.RecordView = false,
+			.Occluder = occluder
+		});
 	}
 
+	/***********************
+	 * Subpass dependencies
+	 ***********************/
+	const FramebufferManager::PrepareFramebufferInfo prepare_info {
+		.DepthLayout = depth_layout
+	};
+	//dependencies of the input framebuffer are issued by the caller
+	const FramebufferManager::SubpassOutputDependencyIssueInfo issue_info {
+		.PrepareInfo = &prepare_info
+	};
+
 	/*******************
-	 * Vertex input
+	 * Rendering
 	 ******************/
-	const GeometryData::AttributeInfo& attr_info = this->WaterSurface.attributeInfo();
-	const auto [vertex_offset, index_offset, indirect_offset] = attr_info.Offset;
-	const VkBuffer vbo = this->WaterSurface.buffer();
+	//we will draw on the existing input framebuffer, so no need to clear
+	FramebufferManager::beginInitialRendering(cmd, *fbo_input, {
+		.DependencyInfo = &issue_info,
+		.RenderArea = render_area
+	});
 
-	vkCmdBindVertexBuffers(cmd, 0u, 1u, &vbo, &vertex_offset);
-	vkCmdBindIndexBuffer(cmd, vbo, index_offset, attr_info.Type.Index);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->Pipeline.get());
+	vkCmdSetViewport(cmd, 0u, 1u, &vp);
+	vkCmdSetScissor(cmd, 0u, 1u, &render_area);
+
+	{
+		const VkWriteDescriptorSetAccelerationStructureKHR scene_as_info {
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR,
+			.accelerationStructureCount = 1u,
+			.pAccelerationStructures = &scene_as
+		};
+		const VkWriteDescriptorSet scene_ds {
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext = &scene_as_info,
+			.dstBinding = 0u,
+			.dstArrayElement = 0u,
+			.descriptorCount = 1u,
+			.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR
+		};
+		vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->PipelineLayout, 2u, 1u, &scene_ds);
+	}
+	vkCmdPushConstants(cmd, this->PipelineLayout, ::WaterPushConstantStage, 0u, sizeof(water_pc), &water_pc);
 
 	/********
 	 * Draw
 	 *******/
-	vkCmdDrawIndexedIndirect(cmd, vbo, indirect_offset, 1u, 0u);
+	if (this->Clipmap) {
+		//vertices are reconstructed from the vertex index alone
+		vkCmdDraw(cmd, this->Clipmap->VertexCount, 1u, 0u, 0u);
+	} else {
+		//only visible tiles are drawn, with commands compacted by culling
+		//the plane has no vertex and index buffer, and indexed commands are read as non-indexed with the same stride
+		const GeometryData::CulledDrawInfo culled_draw = this->WaterSurface.culledDraw(frame_idx);
+		vkCmdDrawIndirectCount(cmd, culled_draw.Buffer, culled_draw.CommandOffset, culled_draw.Buffer, culled_draw.CountOffset,
+			culled_draw.MaxCount, static_cast<uint32_t>(sizeof(IndirectCommand::VkDrawIndexedIndirectCommand)));
+	}
 	vkCmdEndRendering(cmd);
 
+	profiler->endRegion(cmd, frame_idx, this->ProfileRegion);
 	CHECK_VULKAN_ERROR(vkEndCommandBuffer(cmd));
 	return {
 		.DrawCommand = cmd,
@@ -1,23 +1,34 @@
 #pragma once
 
+#include "ChunkCulling.hpp"
 #include "DrawSky.hpp"
 #include "GeometryData.hpp"
 #include "PlaneGeometry.hpp"
 
+#include "../Engine/AccelStructPool.hpp"
 #include "../Engine/CameraInterface.hpp"
+#include "../Engine/BufferArena.hpp"
+#include "../Engine/DepthPyramid.hpp"
+#include "../Engine/DescriptorHeap.hpp"
+#include "../Engine/EngineSetting.hpp"
+#include "../Engine/MipMapGenerator.hpp"
 #include "../Engine/RendererInterface.hpp"
+#include "../Engine/StagingUploader.hpp"
+#include "../Engine/TimestampProfiler.hpp"
 #include "../Engine/VulkanContext.hpp"
 
 #include "../Engine/Abstraction/AccelStructManager.hpp"
 #include "../Engine/Abstraction/CommandBufferManager.hpp"
-#include "../Engine/Abstraction/DescriptorBufferManager.hpp"
 #include "../Engine/Abstraction/FramebufferManager.hpp"
 #include "../Engine/Abstraction/ImageManager.hpp"
+#include "../Engine/Abstraction/PipelineManager.hpp"
 
 #include "../Common/VulkanObject.hpp"
 
 #include <glm/mat4x4.hpp>
 
+#include <array>
+#include <optional>
 #include <ostream>
 
 namespace LearnVulkan {
@@ -25,6 +36,10 @@ namespace LearnVulkan {
 	/**
 	 * @brief Demonstration of real-time rendering of water reflection and refraction using ray-tracing.
 	 * The water renderer must not be used as a stand-alone renderer, hence water will be drawn to an existing framebuffer.
+	 * Rays are either traced by ray query when shading the water surface,
+	 * or by a ray tracing pipeline into an image ahead of drawing, which the water surface then composites.
+	 * The ray tracing pipeline may trace at a reduced resolution, from which full resolution is reconstructed
+	 * by a depth-aware upsample and temporal accumulation.
 	*/
 	class SimpleWater final {
 	public:
@@ -39,6 +54,26 @@ namespace LearnVulkan {
 
 		};
 
+		/**
+		 * @brief The resolution at which reflection and refraction rays are traced, relative to the output.
+		 * The value is the width of a square block of output pixels covered by each traced pixel.
+		*/
+		enum class TraceResolution : uint8_t {
+			Full = 1u,
+			Half = 2u,
+			Quarter = 4u
+		};
+
+		/**
+		 * @brief The geometry of water surface.
+		*/
+		enum class SurfaceGeometry : uint8_t {
+			Plane = 0x00u,/**< A plane of fixed subdivision over the whole water extent, whose tiles are culled. */
+			//Nested levels of grid centred at the camera, each with cells twice the size of the finer level, clamped to the water extent.
+			//The vertex count is fixed regardless of the water extent, and the density is the highest close to the camera.
+			Clipmap = 0x01u
+		};
+
 		/**
 		 * @brief Information to create a simple water renderer.
 		*/
@@ -51,23 +86,42 @@ namespace LearnVulkan {
 			constexpr static VkAccessFlagBits2 TextureAccess = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
 
 			VkDescriptorSetLayout CameraDescriptorSetLayout;
+			DescriptorHeap* Heap;/**< The heap is retained to update scene depth when reshaped. */
 			DrawFormat OutputFormat;
 
 			const DrawSky* SkyRenderer;
 			const PlaneGeometry* PlaneGenerator;/**< Provide an existing plane geometry generator to avoid rebuilding the pipeline. */
+			const ChunkCulling* Culling;/**< Tiles of water surface are culled before drawing. The culler is retained. */
 			/**
 			 * @brief The geometry acceleration structure (a.k.a., BLAS) of the scene.
 			 * Currently only a single GAS is supported.
 			 * An IAS will be built referencing this GAS,
 			 * thus a pipeline barrier must be issued by the application prior to construction of water renderer.
+			 * The GAS is expected to be owned by the compute queue family; the IAS is built on the compute queue,
+			 * after which ownership of both is transferred to the rendering queue family.
 			*/
 			VkAccelerationStructureKHR SceneGAS;
+			const BufferArena::Range* SceneGASMemory;/**< The memory backing the scene GAS. */
 			VkDescriptorImageInfo SceneTexture;
 
 			const ImageManager::ImageReadResult* WaterNormalmap, *WaterDistortion;
 
 			const glm::mat4* ModelMatrix;
-
+			//Trace reflection and refraction with a ray tracing pipeline ahead of drawing, rather than ray query when shading.
+			//Ray query is used if ray tracing pipeline is not supported by the device.
+			bool RayTracingPipeline = false;
+			//Only one pixel in each block is traced every frame, visiting every pixel of the block in turn,
+			//and full resolution is reconstructed from traced pixels and the last frame.
+			//Rays are always traced at full resolution by ray query.
+			TraceResolution RayTracingResolution = TraceResolution::Full;
+			SurfaceGeometry Surface = SurfaceGeometry::Plane;
+
+			TimestampProfiler* Profiler;
+			StagingUploader* Uploader;
+			PipelineManager::GraphicsPipelineLibrary* PipelineLibrary;
+			const MipMapGenerator* MipMap;
+			BufferArena* Arena;/**< Uniform buffer is allocated from the arena. */
+			AccelStructPool* AccelStructMemory;/**< The IAS is allocated from the pool. */
 			std::ostream* DebugMessage;
 
 		};
@@ -85,11 +139,20 @@ namespace LearnVulkan {
 
 	private:
 
+		const VulkanContext* const Context;
+		DescriptorHeap* const Heap;
+		const ChunkCulling* const Culling;
 		const VkFormat DepthFormat;
 
 		GeometryData WaterSurface;
-		AccelStructManager::AccelStruct SceneAccelStruct;
-		const VulkanObject::BufferAllocation UniformBuffer;
+		//The IAS of each in-flight frame, updated in place every frame with the scene instance of that frame.
+		//Only the first VulkanContext::FrameInFlight are built.
+		std::array<AccelStructPool::AccelStruct, EngineSetting::MaxFrameInFlight> SceneAccelStruct;
+		VkDeviceAddress SceneGASAddress;
+		//Scratch memory of IAS update of each in-flight frame, which are the stride apart.
+		BufferArena::Range SceneUpdateScratch;
+		VkDeviceSize SceneUpdateScratchStride;
+		const BufferArena::Range UniformBuffer;
 		VulkanObject::Sampler TextureSampler, SceneDepthSampler;
 		struct {
 
@@ -97,14 +160,96 @@ namespace LearnVulkan {
 			VulkanObject::ImageView ImageView;
 
 		} Normalmap, Distortion, SceneDepth;
+		/**
+		 * @brief In descriptor heap
+		 * water data and plane property SSBO, scene, normal, distortion and scene depth texture, and their samplers
+		*/
+		struct {
 
-		const VulkanObject::DescriptorSetLayout WaterShaderLayout;
-		const VulkanObject::PipelineLayout PipelineLayout;
-		const VulkanObject::Pipeline Pipeline;
+			DescriptorHeap::Slot WaterData, WaterPlane,
+				SceneTexture, Normalmap, Distortion, SceneDepth,
+				SceneTextureSampler, TextureSampler, SceneDepthSampler;
+			DrawSky::SkyBoxHeapIndex EnvironmentMap;
+
+		} HeapSlot;
+
+		/**
+		 * @brief Ray tracing pipeline that traces reflection and refraction of every pixel on the water surface.
+		*/
+		struct TracePipeline {
+
+			//set 2: the scene acceleration structure and the trace image as push descriptor
+			VulkanObject::DescriptorSetLayout SceneLayout;
+			VulkanObject::PipelineLayout PipelineLayout;
+			VulkanObject::Pipeline Pipeline;
+
+			VulkanObject::BufferAllocation ShaderBindingTable;
+			//raygen, miss, hit and callable shader binding table
+			std::array<VkStridedDeviceAddressRegionKHR, 4u> Region;
+
+			//hit colour and ray length of reflection and refraction in each layer, recreated on reshape
+			VulkanObject::ImageAllocation Image;
+			VulkanObject::ImageView ImageView;
+			VkExtent2D Extent;/**< Of the trace, which is reduced from the output. */
+			DescriptorHeap::Slot HeapSlot;
+			uint32_t Scale;/**< The width of a block of output pixels covered by a traced pixel. */
+
+		};
+		//Not created if rays are traced by ray query.
+		std::optional<TracePipeline> Trace;
+
+		/**
+		 * @brief Reconstruction of full resolution reflection and refraction from rays traced at a reduced resolution.
+		*/
+		struct TraceReconstruction {
+
+			//set 2: the output image as push descriptor
+			VulkanObject::DescriptorSetLayout OutputLayout;
+			VulkanObject::PipelineLayout PipelineLayout;
+			VulkanObject::Pipeline Pipeline;
+
+			VulkanObject::Sampler HistorySampler;
+			DescriptorHeap::Slot HistorySamplerSlot;
+			BufferArena::Range ViewHistory;/**< Projection view matrix of the current and the last frame, alternating like accumulation. */
+
+			struct AccumulationImage {
+
+				VulkanObject::ImageAllocation Image;
+				VulkanObject::ImageView ImageView;
+				DescriptorHeap::Slot HeapSlot;
+
+			};
+			//Output of reconstruction at full resolution in the same layout as the trace image, recreated on reshape.
+			//Output of one frame is the history of the next, and they alternate every frame.
+			std::array<AccumulationImage, 2u> Accumulation;
+			VkExtent2D Extent;
+			mutable uint64_t Frame;/**< The number of frame reconstructed since the history was discarded. */
 
-		const CommandBufferManager::InFlightCommandBufferArray WaterCommand;
-		DescriptorBufferManager WaterShaderDescriptorBuffer;
+		};
+		//Only created if rays are traced at a reduced resolution.
+		std::optional<TraceReconstruction> Reconstruction;
+		/**
+		 * @brief Water surface drawn as a clipmap in place of the plane, which is still used for its property.
+		*/
+		struct SurfaceClipmap {
+
+			glm::dmat4 InverseModel;/**< Transform the camera to plane space. */
+			float CellSize;/**< Of the finest level, in plane space. */
+			uint32_t VertexCount;
+
+		};
+		//Not created if the surface is drawn as the plane.
+		std::optional<SurfaceClipmap> Clipmap;
 
+		//Shader stage where reflection and refraction rays are traced, and scene resources are read.
+		const VkPipelineStageFlags2 RayStage;
+
+		//set 2: the scene acceleration structure as push descriptor
+		const VulkanObject::DescriptorSetLayout SceneLayout;
+		const VulkanObject::PipelineLayout PipelineLayout;
+		const PipelineManager::GraphicsPipelineLibrary::LinkedPipeline Pipeline;
+
+		const TimestampProfiler::RegionIdentifier ProfileRegion;
 		mutable double Animator;
 
 		VkDevice getDevice() const noexcept;
@@ -120,19 +265,27 @@ namespace LearnVulkan {
 			const RendererInterface::DrawInfo* InheritedDrawInfo;
 			//The geometry data of the scene.
 			//Must be a compatible geometry as the scene acceleration structure
-			//passed during construction of water renderer.
+			//passed during construction of water renderer, and a plane with 16-bit index.
 			const GeometryData* SceneGeometry;
 
 			//This is the framebuffer to be rendered onto.
 			//Content in this framebuffer will be preserved after water renderer finishes.
+			//The caller synchronises the framebuffer before water is drawn.
 			const FramebufferManager::SimpleFramebuffer* InputFramebuffer;
 			VkImageLayout DepthLayout;
+			uint32_t WorkerIndex;/**< The worker of the job system recording the water. */
+			uint64_t FrameCount;/**< The number of frame drawn before, as given to the culler by the caller. */
+			//The depth pyramid built in the current frame, or null to disable occlusion culling of water tiles.
+			const DepthPyramid* Occluder = nullptr;
+			//The transform of the scene GAS instance in this frame, which is written to a per-frame instance buffer
+			//to update the IAS of this frame. The GAS is not transformed if null.
+			const glm::mat4* SceneTransform = nullptr;
 
 		};
 
 		/**
 		 * @brief Construct a simple water renderer.
-		 * @param ctx The context.
+		 * @param ctx The context. The context is retained and must remain valid until the renderer is destroyed.
 		 * @param water_info The water renderer create info.
 		*/
 		SimpleWater(const VulkanContext&, const WaterCreateInfo&);
@@ -153,6 +306,26 @@ namespace LearnVulkan {
 		*/
 		VkImageView getSceneDepth() const noexcept;
 
+		/**
+		 * @brief Get the scene depth texture.
+		 * @return The scene depth image.
+		*/
+		VkImage getSceneDepthImage() const noexcept;
+
+		/**
+		 * @brief Get the stage where the scene GAS is read on the rendering queue, with acceleration structure read access.
+		 * @return The pipeline stage.
+		*/
+		VkPipelineStageFlags2 getSceneGASStage() const noexcept;
+
+		/**
+		 * @brief Replace the scene GAS with another of the same geometry, such as its compacted copy.
+		 * The IAS of each in-flight frame references the new GAS the next time it is updated by drawing,
+		 * so the old GAS must remain valid until every frame drawn before the replacement has completed.
+		 * @param gas The new GAS owned by the rendering queue family, whose write must have been made visible to the scene GAS stage.
+		*/
+		void replaceSceneGAS(VkAccelerationStructureKHR) noexcept;
+
 		/**
 		 * @brief Begin recording to scene depth.
 		 * Barrier and layout transition are performed automatically.
@@ -1,14 +1,27 @@
 #ifndef _CAMERA_DATA_GLSL_
 #define _CAMERA_DATA_GLSL_
 
+//The maximum number of view rendered with multiview, see EngineSetting::MaxViewCount.
+#define CAMERA_MAX_VIEW 6
+
 layout(std430, set = 0, binding = 0) readonly restrict buffer CameraData {
-	mat4 View, ProjectionView,
-		//inverse(mat4(mat3(V))) * inverse(P)
-		InvProjectionViewRotation;
+	mat4 View;
 	vec3 Position;
 
 	//far * near, far - near, far
 	vec3 LinearDepthFactor;
+
+	//width and height of the viewport, in pixel
+	vec2 Resolution;
+	//the number of pixel covered by a unit length at a unit distance in front of the camera, along the vertical axis
+	float PixelScale;
+	//The number of view, where the first view is always the camera itself unless multiview has been set.
+	uint ViewCount;
+
+	//one for each view, indexed by gl_ViewIndex in shader stages of multiview rendering, otherwise the first view is used
+	mat4 ProjectionView[CAMERA_MAX_VIEW],
+		//inverse(mat4(mat3(V))) * inverse(P)
+		InvProjectionViewRotation[CAMERA_MAX_VIEW];
 } Camera;
 
 float lineariseDepth(const float depth) {
@@ -0,0 +1,25 @@
+#ifndef _DESCRIPTOR_HEAP_GLSL_
+#define _DESCRIPTOR_HEAP_GLSL_
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+/*
+The engine-wide descriptor heap is always bound to set 1.
+Resources are referenced by their indices into the array of their descriptor type, usually given by push constant.
+Images of different dimensions alias the same binding, so do storage buffers of different block types;
+a storage buffer array is declared by the user with a block type of choice as:
+HEAP_STORAGE_BUFFER readonly restrict buffer BlockType { ... } HeapBlock[];
+*/
+#define HEAP_STORAGE_BUFFER layout(std430, set = 1, binding = 2)
+
+layout(set = 1, binding = 0) uniform sampler HeapSampler[];
+layout(set = 1, binding = 1) uniform texture2D HeapTexture2D[];
+layout(set = 1, binding = 1) uniform textureCube HeapTextureCube[];
+layout(set = 1, binding = 1) uniform texture2DArray HeapTexture2DArray[];
+
+//Combine an image and a sampler given their indices into the heap.
+#define HEAP_SAMPLER_2D(T, S) sampler2D(HeapTexture2D[T], HeapSampler[S])
+#define HEAP_SAMPLER_CUBE(T, S) samplerCube(HeapTextureCube[T], HeapSampler[S])
+#define HEAP_SAMPLER_2D_ARRAY(T, S) sampler2DArray(HeapTexture2DArray[T], HeapSampler[S])
+
+#endif//_DESCRIPTOR_HEAP_GLSL_
\ No newline at end of file
@@ -1,4 +1,5 @@
 #version 460 core
+#include "DescriptorHeap.glsl"
 
 layout(early_fragment_tests) in;
 
@@ -6,8 +7,10 @@ layout(location = 0) in vec3 RayDirection;
 
 layout(location = 0) out vec4 FragColour;
 
-layout(set = 1, binding = 0) uniform samplerCube SkyBox;
+layout(std430, push_constant) readonly restrict uniform SkyBoxIndex {
+	uint SkyBoxImage, SkyBoxSampler;
+};
 
 void main() {
-	FragColour = vec4(textureLod(SkyBox, normalize(RayDirection), 0.0f).rgb, 1.0f);
+	FragColour = vec4(textureLod(HEAP_SAMPLER_CUBE(SkyBoxImage, SkyBoxSampler), normalize(RayDirection), 0.0f).rgb, 1.0f);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #version 460 core
+#extension GL_EXT_multiview : require
 #include "CameraData.glsl"
 
 layout(location = 0) out vec3 RayDirection;
@@ -27,7 +28,7 @@ void main() {
 	and we shall let depth test pass for sky pixels, therefore depth test needs to have compare mode set to equal.
 	*/
 	const vec4 inf_quad = vec4(QuadVertex[gl_VertexIndex], 0.0f, 1.0f);
-	RayDirection = (Camera.InvProjectionViewRotation * inf_quad).xyz;
+	RayDirection = (Camera.InvProjectionViewRotation[gl_ViewIndex] * inf_quad).xyz;
 
 	gl_Position = inf_quad;
 }
\ No newline at end of file
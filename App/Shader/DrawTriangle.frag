@@ -1,4 +1,5 @@
 #version 460 core
+#include "DescriptorHeap.glsl"
 
 layout(early_fragment_tests) in;
 
@@ -6,8 +7,10 @@ layout(location = 0) in vec2 FragUV;
 
 layout(location = 0) out vec4 FragColour;
 
-layout(set = 1, binding = 0) uniform sampler2D SurfaceTexture;
+layout(std430, push_constant) readonly restrict uniform TriangleTransform {
+	layout(offset = 68) uint SurfaceTextureIndex, SurfaceSamplerIndex;
+};
 
 void main() {
-	FragColour = vec4(texture(SurfaceTexture, FragUV).rgb, 1.0f);
+	FragColour = vec4(texture(HEAP_SAMPLER_2D(SurfaceTextureIndex, SurfaceSamplerIndex), FragUV).rgb, 1.0f);
 }
\ No newline at end of file
@@ -1,20 +1,28 @@
 #version 460 core
 
+#define TRIANGLE_INSTANCE_ACCESS readonly
 #include "CameraData.glsl"
+#include "DescriptorHeap.glsl"
+#include "DrawTriangleInstance.glsl"
+
+//Place every instance by its own transform, compacted by culling, instead of the fixed instance offset.
+layout(constant_id = 0) const bool StressInstancing = false;
 
 layout(location = 0) in vec3 Position;
 layout(location = 1) in vec2 TexCoord;
 
 layout(location = 0) out vec2 FragUV;
 
-layout(std430, set = 1, binding = 1) readonly restrict buffer InstanceOffset {
+HEAP_STORAGE_BUFFER readonly restrict buffer InstanceOffset {
     float VerticalOffset;
     //control rotation
     float Radius, Angle;
-};
+} Instance[];
 
 layout(std430, push_constant) readonly restrict uniform TriangleTransform {
     mat4 Model;
+    uint InstanceOffsetIndex;
+    layout(offset = 80) TriangleInstance StressInstance;
 };
 
 mat2 rotation(const float theta) {
@@ -27,11 +35,24 @@ mat2 rotation(const float theta) {
 }
 
 void main() {
+    FragUV = TexCoord;
+    if (StressInstancing) {
+        const vec4 transform = StressInstance.Transform[gl_InstanceIndex];
+
+        vec4 instance_position = Model * vec4(Position, 1.0f);
+        instance_position.xz = rotation(transform.w) * (instance_position.xz * StressInstanceScale);
+        gl_Position = Camera.ProjectionView[0] * vec4(instance_position.xyz + transform.xyz, 1.0f);
+        return;
+    }
+
+    const float vertical_offset = Instance[InstanceOffsetIndex].VerticalOffset,
+        radius = Instance[InstanceOffsetIndex].Radius,
+        angle = Instance[InstanceOffsetIndex].Angle;
+
     vec4 instance_position = Model * vec4(Position, 1.0f);
-    instance_position.x += Radius;
-    instance_position.y += gl_InstanceIndex * VerticalOffset;
-    instance_position.xz = rotation(gl_InstanceIndex * Angle) * instance_position.xz;
+    instance_position.x += radius;
+    instance_position.y += gl_InstanceIndex * vertical_offset;
+    instance_position.xz = rotation(gl_InstanceIndex * angle) * instance_position.xz;
 
-    gl_Position = Camera.ProjectionView * instance_position;
-    FragUV = TexCoord;
+    gl_Position = Camera.ProjectionView[0] * instance_position;
 }
\ No newline at end of file
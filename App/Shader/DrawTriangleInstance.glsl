@@ -0,0 +1,18 @@
+#ifndef _DRAW_TRIANGLE_INSTANCE_GLSL_
+#define _DRAW_TRIANGLE_INSTANCE_GLSL_
+#extension GL_EXT_buffer_reference2 : require
+
+//Define the memory qualifier of instance transform before inclusion, or the transform is read-write.
+#ifndef TRIANGLE_INSTANCE_ACCESS
+#define TRIANGLE_INSTANCE_ACCESS
+#endif
+
+//Scale of every instance of the instancing stress mode relative to the triangle model, must match the host.
+const float StressInstanceScale = 0.1f;
+
+layout(std430, buffer_reference, buffer_reference_align = 16) TRIANGLE_INSTANCE_ACCESS restrict buffer TriangleInstance {
+	//xyz: position; w: rotation around vertical axis
+	vec4 Transform[];
+};
+
+#endif//_DRAW_TRIANGLE_INSTANCE_GLSL_
\ No newline at end of file
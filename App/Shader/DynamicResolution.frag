@@ -0,0 +1,36 @@
+#version 460 core
+
+layout(location = 0) in vec2 UV;
+
+layout(location = 0) out vec4 FragColour;
+
+layout(set = 0, binding = 0) uniform sampler2D Source;
+
+layout(push_constant) uniform UpscaleSetting {
+	float Sharpness;
+};
+
+/*
+The source is bilinearly filtered to the output extent,
+and then sharpened with a contrast adaptive filter to restore some details lost by the upscale.
+The filter is a cross-shaped negative lobe, whose weight is reduced where the local contrast is high,
+such that edges are not over-sharpened into halos.
+*/
+void main() {
+	const vec2 texel = 1.0f / vec2(textureSize(Source, 0));
+
+	const vec3 centre = textureLod(Source, UV, 0.0f).rgb,
+		north = textureLod(Source, UV + vec2(0.0f, -texel.y), 0.0f).rgb,
+		south = textureLod(Source, UV + vec2(0.0f, texel.y), 0.0f).rgb,
+		west = textureLod(Source, UV + vec2(-texel.x, 0.0f), 0.0f).rgb,
+		east = textureLod(Source, UV + vec2(texel.x, 0.0f), 0.0f).rgb;
+
+	const vec3 local_min = min(centre, min(min(north, south), min(west, east))),
+		local_max = max(centre, max(max(north, south), max(west, east)));
+	//amount of sharpening is smaller when the neighbourhood is close to either end of the range
+	const vec3 amount = sqrt(clamp(min(local_min, 1.0f - local_max) / max(local_max, 1e-4f), 0.0f, 1.0f));
+	const vec3 weight = -amount * mix(0.125f, 0.2f, Sharpness);
+
+	const vec3 sharpened = (centre + (north + south + west + east) * weight) / (1.0f + 4.0f * weight);
+	FragColour = vec4(clamp(sharpened, 0.0f, 1.0f), 1.0f);
+}
\ No newline at end of file
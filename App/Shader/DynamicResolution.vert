@@ -0,0 +1,18 @@
+#version 460 core
+
+layout(location = 0) out vec2 UV;
+
+//A full-screen triangle, see the sky shader for more details.
+const vec2 QuadVertex[] = vec2[](
+	vec2(-1.0f, -1.0f),
+	vec2(3.0f, -1.0f),
+	vec2(-1.0f, 3.0f)
+);
+
+void main() {
+	const vec2 position = QuadVertex[gl_VertexIndex];
+	//both the source and output have the first row on top, so no flip is required
+	UV = position * 0.5f + 0.5f;
+
+	gl_Position = vec4(position, 0.0f, 1.0f);
+}
\ No newline at end of file
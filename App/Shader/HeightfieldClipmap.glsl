@@ -0,0 +1,47 @@
+#ifndef _HEIGHTFIELD_CLIPMAP_GLSL_
+#define _HEIGHTFIELD_CLIPMAP_GLSL_
+#extension GL_EXT_buffer_reference : require
+
+#include "DescriptorHeap.glsl"
+
+//The width of band inside the edge of a resident region where a clip level is blended with coarser levels, in texel.
+const float ClipmapBlendWidth = 16.0f;
+
+struct HeightfieldClipLevel {
+
+	//Resident region of this level in texel, from the minimum to the maximum corner.
+	//The region is unbounded on sides reaching the edge of the level.
+	vec4 Region;
+	vec2 Extent;/**< Of this level, in texel. */
+
+};
+
+//Published by the host every frame, see Engine/HeightfieldClipmap.hpp.
+layout(std430, buffer_reference, buffer_reference_align = 16) restrict readonly buffer HeightfieldClipmap {
+	uint LevelCount, Image, Sampler;
+	float WindowSize;/**< Of each clip layer, in texel. */
+	HeightfieldClipLevel Level[];
+};
+
+//Sample a heightfield from the finest resident data.
+//The coarsest level is always resident and given as an ordinary texture, clip levels are blended over it from coarse to fine.
+vec4 sampleHeightfield(const HeightfieldClipmap clipmap, const uint coarse_image, const uint coarse_sampler, const vec2 uv) {
+	vec4 value = textureLod(HEAP_SAMPLER_2D(coarse_image, coarse_sampler), uv, 0.0f);
+	for (uint l = clipmap.LevelCount; l-- > 0u;) {
+		const vec4 region = clipmap.Level[l].Region;
+		const vec2 extent = clipmap.Level[l].Extent,
+			texel = clamp(uv * extent, vec2(0.5f), extent - 0.5f),
+			//keep the filter footprint inside the region
+			border = min(texel - region.xy, region.zw - texel) - 1.0f;
+		const float weight = clamp(min(border.x, border.y) / ClipmapBlendWidth, 0.0f, 1.0f);
+		if (weight > 0.0f) {
+			//tiles are addressed toroidally, the window wraps around the layer with repeat addressing
+			const vec4 clip = textureLod(HEAP_SAMPLER_2D_ARRAY(clipmap.Image, clipmap.Sampler),
+				vec3(texel / clipmap.WindowSize, float(l)), 0.0f);
+			value = mix(value, clip, weight);
+		}
+	}
+	return value;
+}
+
+#endif//_HEIGHTFIELD_CLIPMAP_GLSL_
\ No newline at end of file
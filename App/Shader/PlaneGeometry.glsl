@@ -8,14 +8,39 @@
 #ifndef PLANE_HIDE_PLANE_PROPERTY
 layout(std430, set = 0, binding = 0) readonly restrict buffer PlaneProperty {
 	dvec2 Dimension, TotalPlane;
-	uvec2 Subdivision, VertexDimension;
-	uint32_t IndexCount;
+	uvec2 Subdivision, VertexDimension,
+		//number of subdivision in each chunk, and number of chunk in the plane
+		ChunkSubdivision, ChunkCount;
+	uint32_t IndexCount,
+		//size of index in byte, index of 4 bytes is global to the plane, otherwise local to each chunk
+		IndexSize;
 };
 
+//Vertices of plane with local index are stored chunk by chunk, such that vertices on chunk borders are duplicated.
+bool hasLocalIndex() {
+	return IndexSize < 4u;
+}
+
 //Convert 2D location of a vertex to 1D index (this index is not the geometry index, btw).
+//The location is in the grid of stored vertex, whose dimension is the vertex dimension.
 uint calcVertexIndex(const uvec2 id) {
+	if (hasLocalIndex()) {
+		const uvec2 chunk_vertex = ChunkSubdivision + 1u,
+			chunk = id / chunk_vertex,
+			local = id % chunk_vertex;
+		return (chunk.x + chunk.y * ChunkCount.x) * (chunk_vertex.x * chunk_vertex.y) + local.x + local.y * chunk_vertex.x;
+	}
 	return id.x + id.y * VertexDimension.x;
 }
+
+//Convert 2D location of a vertex in the grid of stored vertex to the location on the plane.
+uvec2 calcPlaneLocation(const uvec2 id) {
+	if (hasLocalIndex()) {
+		const uvec2 chunk_vertex = ChunkSubdivision + 1u;
+		return id / chunk_vertex * ChunkSubdivision + id % chunk_vertex;
+	}
+	return id;
+}
 #endif//PLANE_HIDE_PLANE_PROPERTY
 
 #ifdef PLANE_VERTEX_ACCESS
@@ -25,9 +50,17 @@ layout(std430, buffer_reference, buffer_reference_align = 4) PLANE_VERTEX_ACCESS
 };
 #endif//PLANE_VERTEX_ACCESS
 #ifdef PLANE_INDEX_ACCESS
+//Indices of a quad of each supported size, all of which share the same address.
 layout(std430, buffer_reference, buffer_reference_align = 4) PLANE_INDEX_ACCESS restrict buffer PlaneIndex {
 	uint32_t Index[6];
 };
+layout(std430, buffer_reference, buffer_reference_align = 2) PLANE_INDEX_ACCESS restrict buffer PlaneIndex16 {
+	uint16_t Index[6];
+};
+//8-bit index is packed in pairs, because only 16-bit storage is available.
+layout(std430, buffer_reference, buffer_reference_align = 2) PLANE_INDEX_ACCESS restrict buffer PlaneIndex8 {
+	uint16_t Index[3];
+};
 #endif//PLANE_INDEX_ACCESS
 #ifdef PLANE_COMMAND_ACCESS
 layout(std430, buffer_reference, buffer_reference_align = 4) PLANE_COMMAND_ACCESS restrict buffer PlaneCommand {
@@ -37,5 +70,16 @@ layout(std430, buffer_reference, buffer_reference_align = 4) PLANE_COMMAND_ACCES
 	uint32_t E;
 };
 #endif//PLANE_COMMAND_ACCESS
+#ifdef PLANE_CHUNK_ACCESS
+layout(std430, buffer_reference, buffer_reference_align = 16) PLANE_CHUNK_ACCESS restrict buffer PlaneChunk {
+	//Axis-aligned bound of the chunk in plane space, before displacement.
+	vec3 Min;
+	uint32_t FirstIndex;
+	vec3 Max;
+	uint32_t IndexCount;
+	//Added to every index of the chunk, for plane with local index.
+	int32_t VertexOffset;
+};
+#endif//PLANE_CHUNK_ACCESS
 
 #endif//_PLANE_GEOMETRY_GLSL_
\ No newline at end of file
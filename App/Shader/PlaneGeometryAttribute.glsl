@@ -1,7 +1,50 @@
 #ifndef _PLANE_GEOMETRY_ATTRIBUTE_GLSL_
 #define _PLANE_GEOMETRY_ATTRIBUTE_GLSL_
+#extension GL_EXT_shader_explicit_arithmetic_types_float64 : require
+#extension GL_EXT_shader_explicit_arithmetic_types_int32 : require
 
+#include "DescriptorHeap.glsl"
+
+//Vertex input of plane generated with vertex attribute.
 #define PLANE_ATTRIBUTE_POSITION(LOC, NAME) layout(location = LOC) in vec3 NAME
 #define PLANE_ATTRIBUTE_UV(LOC, NAME) layout(location = LOC) in vec2 NAME
 
+//Property of plane generated without vertex attribute, indexed by the user.
+HEAP_STORAGE_BUFFER readonly restrict buffer PlaneProperty {
+	dvec2 Dimension, TotalPlane;
+	uvec2 Subdivision, VertexDimension,
+		ChunkSubdivision, ChunkCount;
+	uint32_t IndexCount, IndexSize;
+} PlanePropertyHeap[];
+
+//Corners of a quad in the same order as indices from plane generator.
+const uvec2 PlaneQuadCorner[6] = {
+	{ 0u, 0u },//nw
+	{ 1u, 0u },//ne
+	{ 1u, 1u },//se
+	{ 0u, 0u },//nw
+	{ 1u, 1u },//se
+	{ 0u, 1u } //sw
+};
+
+//Reconstruct position and UV of a vertex of plane generated without vertex attribute.
+//Every quad has 6 vertices of its own, grouped by chunk, such that the vertex index is the same as the index of an indexed plane,
+//and chunk draw commands can be used as non-indexed draw commands.
+void reconstructPlaneVertex(const uint plane, const uint vertex, out vec3 position, out vec2 uv) {
+	const uvec2 chunk_subdivision = PlanePropertyHeap[plane].ChunkSubdivision;
+	const uint chunk_count = PlanePropertyHeap[plane].ChunkCount.x,
+		chunk_quad = chunk_subdivision.x * chunk_subdivision.y,
+		quad = vertex / 6u,
+		chunk = quad / chunk_quad,
+		local = quad % chunk_quad;
+	const uvec2 id = uvec2(chunk % chunk_count, chunk / chunk_count) * chunk_subdivision
+		+ uvec2(local % chunk_subdivision.x, local / chunk_subdivision.x) + PlaneQuadCorner[vertex % 6u];
+
+	//same as the generator, such that vertices shared by adjacent quads are exactly the same
+	const dvec2 normalised_position = dvec2(id) / PlanePropertyHeap[plane].TotalPlane,
+		position_2d = normalised_position * PlanePropertyHeap[plane].Dimension;
+	position = vec3(position_2d.x, 0.0f, position_2d.y);
+	uv = vec2(normalised_position);
+}
+
 #endif//_PLANE_GEOMETRY_ATTRIBUTE_GLSL_
\ No newline at end of file
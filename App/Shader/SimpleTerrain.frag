@@ -1,4 +1,5 @@
 #version 460 core
+#include "SimpleTerrain.glsl"
 
 layout(early_fragment_tests) in;
 
@@ -8,10 +9,8 @@ layout(location = 0) in FSIn {
 
 layout(location = 0) out vec4 FragColour;
 
-layout(set = 1, binding = 3) uniform sampler2D Heightfield;
-
 void main() {
-	const vec3 normal = textureLod(Heightfield, fs_in.UV, 0.0f).rgb;
+	const vec3 normal = sampleTerrainHeightfield(fs_in.UV).rgb;
 
 	//undo gamma correction because presentation will do it later
 	FragColour = vec4(pow(normal, vec3(2.2f)), 1.0f);
@@ -0,0 +1,20 @@
+#ifndef _SIMPLE_TERRAIN_GLSL_
+#define _SIMPLE_TERRAIN_GLSL_
+
+#include "DescriptorHeap.glsl"
+#include "HeightfieldClipmap.glsl"
+
+//indices into the descriptor heap, shared by all stages
+layout(std430, push_constant) readonly restrict uniform TerrainHeapIndex {
+	uint TransformIndex, TessellationIndex, DisplacementIndex,
+		//the coarsest level of heightfield, which is always resident
+		HeightfieldTextureIndex, HeightfieldSamplerIndex, PlanePropertyIndex;
+	HeightfieldClipmap Clipmap;
+};
+
+//Sample the heightfield at its finest resident level.
+vec4 sampleTerrainHeightfield(const vec2 uv) {
+	return sampleHeightfield(Clipmap, HeightfieldTextureIndex, HeightfieldSamplerIndex, uv);
+}
+
+#endif//_SIMPLE_TERRAIN_GLSL_
\ No newline at end of file
@@ -1,20 +1,19 @@
 #version 460 core
 #include "PlaneGeometryAttribute.glsl"
-
-PLANE_ATTRIBUTE_POSITION(0, PlanePosition);
-PLANE_ATTRIBUTE_UV(1, UV);
+#include "SimpleTerrain.glsl"
 
 layout(location = 0) out VSOut {
 	vec2 UV;
 } vs_out;
 
-layout(std430, set = 1, binding = 0) restrict readonly buffer TerrainTransform {
-	mat4 Model;	
-};
+HEAP_STORAGE_BUFFER restrict readonly buffer TerrainTransform {
+	mat4 Model;
+} Transform[];
 
 void main() {
-	//override input height to make it a flat plane
+	//the reconstructed plane is flat before displacement,
 	//to make sure adaptive LoD calculation in tessellation control shader is correct
-	gl_Position = Model * vec4(vec3(PlanePosition.x, 0.0f, PlanePosition.z), 1.0f);
-	vs_out.UV = UV;
+	vec3 plane_position;
+	reconstructPlaneVertex(PlanePropertyIndex, uint(gl_VertexIndex), plane_position, vs_out.UV);
+	gl_Position = Transform[TransformIndex].Model * vec4(plane_position, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef _SIMPLE_TERRAIN_MESH_GLSL_
+#define _SIMPLE_TERRAIN_MESH_GLSL_
+#extension GL_EXT_mesh_shader : require
+
+#include "PlaneGeometryAttribute.glsl"
+#include "SimpleTerrain.glsl"
+
+/*
+Each chunk of the plane is drawn by a task workgroup, as a grid of meshlets emitted to mesh workgroups.
+Resolution of a chunk is the number of quads along each side, which is a power of two.
+All vertices lie on a lattice of the finest resolution, addressed by integer coordinates,
+such that vertices shared by adjacent chunks are calculated from the same coordinate and are exactly the same.
+*/
+const uint TerrainMeshLocalSize = 32u,
+	//number of quads along each side of a meshlet
+	TerrainMeshletQuad = 8u,
+	TerrainMeshletVertex = (TerrainMeshletQuad + 1u) * (TerrainMeshletQuad + 1u),
+	TerrainMeshletPrimitive = TerrainMeshletQuad * TerrainMeshletQuad * 2u,
+	TerrainChunkMaxResolution = 128u,
+	TerrainChunkMaxMeshlet = (TerrainChunkMaxResolution / TerrainMeshletQuad) * (TerrainChunkMaxResolution / TerrainMeshletQuad);
+
+//Index of each chunk edge.
+const uint TerrainEdgeWest = 0u,
+	TerrainEdgeEast = 1u,
+	TerrainEdgeNorth = 2u,
+	TerrainEdgeSouth = 3u;
+
+struct TerrainMeshPayload {
+	uint Chunk, Resolution;
+	//Resolution along each edge, which is never finer than the chunk.
+	//The edge resolution is shared by both chunks on the edge.
+	uint EdgeResolution[4];
+	//Index of visible meshlets in the chunk, in row-major order.
+	uint Meshlet[TerrainChunkMaxMeshlet];
+};
+
+HEAP_STORAGE_BUFFER restrict readonly buffer TerrainTransform {
+	mat4 Model;
+} Transform[];
+
+HEAP_STORAGE_BUFFER restrict readonly buffer DisplacementSetting {
+	float Altitude;
+} Displacement[];
+
+//Lattice coordinate of the north-west corner of a chunk.
+uvec2 calcTerrainChunkLattice(const uint chunk) {
+	const uint chunk_count = PlanePropertyHeap[PlanePropertyIndex].ChunkCount.x;
+	return uvec2(chunk % chunk_count, chunk / chunk_count) * TerrainChunkMaxResolution;
+}
+
+vec2 calcTerrainLatticeUV(const uvec2 lattice) {
+	return vec2(lattice) * (vec2(PlanePropertyHeap[PlanePropertyIndex].ChunkSubdivision)
+		/ (float(TerrainChunkMaxResolution) * vec2(PlanePropertyHeap[PlanePropertyIndex].TotalPlane)));
+}
+
+//Position in plane space before displacement.
+vec3 calcTerrainPlanePosition(const vec2 uv) {
+	const vec2 position = uv * vec2(PlanePropertyHeap[PlanePropertyIndex].Dimension);
+	return vec3(position.x, 0.0f, position.y);
+}
+
+#endif//_SIMPLE_TERRAIN_MESH_GLSL_
\ No newline at end of file
@@ -1,11 +1,7 @@
 #version 460 core
 #extension GL_EXT_ray_query : require
-#include "SimpleWater.glsl"
-#include "CameraData.glsl"
-#define PLANE_HIDE_PLANE_PROPERTY
-#define PLANE_VERTEX_ACCESS readonly
-#define PLANE_INDEX_ACCESS readonly
-#include "PlaneGeometry.glsl"
+#define WATER_IMPLICIT_DERIVATIVE
+#include "SimpleWaterRay.glsl"
 
 layout(early_fragment_tests) in;
 
@@ -13,33 +9,12 @@ WATER_RAY_PROPERTY(in);
 
 layout(location = 0) out vec4 FragColour;
 
-//This scene should consist of exactly one plane geometry.
-layout(set = 1, binding = 1) uniform accelerationStructureEXT Scene;
-layout(set = 1, binding = 2) uniform samplerCube EnvironmentMap;
-layout(set = 1, binding = 3) uniform sampler2D WaterTextureCollection[4];
-
-#define INDEX_WATER_TEXTURE(IDX) WaterTextureCollection[IDX]
-#define SceneTexture INDEX_WATER_TEXTURE(0u)
-#define WaterNormal INDEX_WATER_TEXTURE(1u)
-#define WaterDistortion INDEX_WATER_TEXTURE(2u)
-#define SceneDepth INDEX_WATER_TEXTURE(3u)
-
-layout(std430, push_constant) readonly restrict uniform Argument {
-	PlaneVertex Vertex;
-	PlaneIndex Index;
-	float AnimationTimer;//increment and wrapped over between [0.0f, NormalScale)
-};
+//Reflection and refraction are read from the trace image written by the ray tracing pipeline ahead of drawing,
+//rather than traced by ray query.
+layout(constant_id = 0) const bool UseTraceImage = false;
 
-//HACK: We treat water as a perfect flat plane that points directly upwards.
-//If we wish to incorporate complex vertex animation (like water waves), then we should avoid using hard-coded value.
-//This matrix is to convert from tangent to world space for upward-facing plane.
-const mat3 PlaneTBN = mat3(
-	vec3(1.0f, 0.0f, 0.0f),
-	vec3(0.0f, 0.0f, -1.0f),
-	vec3(0.0f, 1.0f, 0.0f)
-);
-
-const float minRayTime = 1e-4f, maxRayTime = 1e4f;
+//This scene should consist of exactly one plane geometry.
+layout(set = 2, binding = 0) uniform accelerationStructureEXT Scene;
 
 //Return hit colour and ray length.
 vec4 findHitColour(const vec3 dir) {
@@ -51,27 +26,12 @@ vec4 findHitColour(const vec3 dir) {
 	rayQueryProceedEXT(query);
 	if (rayQueryGetIntersectionTypeEXT(query, true) != gl_RayQueryCommittedIntersectionTriangleEXT) {
 		//miss
-		return vec4(textureLod(EnvironmentMap, dir, 0.0f).rgb, maxRayTime);
+		return shadeMiss(dir);
 	}
 	//closest hit
-	const vec2 bary2 = rayQueryGetIntersectionBarycentricsEXT(query, true);
-	const vec3 bary3 = vec3(1.0f - bary2.x - bary2.y, bary2);
-	
-	const uint primitive_idx = rayQueryGetIntersectionPrimitiveIndexEXT(query, true);
-	//the index in our geometry is packed as 6 integers per structure,
-	//while a primitive is packed as 3 integers per structure; need to convert the index.
-	const uint structure_idx = primitive_idx >> 1u,//equivalent to `primitive_idx / 2u`
-		within_structure_subset = primitive_idx & 1u;//equivalent to `primitive_idx % 2u`
-
-	vec2 hit_uv = vec2(0.0f);
-	for (uint i = 0u; i < bary3.length(); i++) {
-		const uint current_index = Index[structure_idx].Index[3u * within_structure_subset + i];
-		const vec2 vertex_uv = vec2(Vertex[current_index].UV) / float(~0us);
-
-		hit_uv += bary3[i] * vertex_uv;
-	}
-	const vec3 out_colour = textureLod(SceneTexture, hit_uv, 0.0f).rgb;
-	return vec4(pow(out_colour, vec3(2.2f)), rayQueryGetIntersectionTEXT(query, true));
+	const vec2 hit_uv = calcHitUV(rayQueryGetIntersectionPrimitiveIndexEXT(query, true),
+		rayQueryGetIntersectionBarycentricsEXT(query, true));
+	return shadeHit(hit_uv, rayQueryGetIntersectionTEXT(query, true));
 }
 
 void main() {
@@ -82,15 +42,7 @@ void main() {
 	The closest hit colour will be our reflection and refraction colour.
 	*/
 	//calculate water animation
-	const vec2 scaled_uv = TexCoord * Water.NormalScale,
-		uv_distortion1 = texture(WaterDistortion, scaled_uv + vec2(AnimationTimer, 0.0f)).rg,
-		uv_distortion2 = texture(WaterDistortion, scaled_uv + vec2(0.0f, AnimationTimer)).rg,
-		distortion = ((uv_distortion1 + uv_distortion2) * 2.0f - 1.0f) * Water.DistortionStrength;
-
-	const vec3 normal_tangent = normalize(texture(WaterNormal, distortion).rgb) * 2.0f - 1.0f,
-		normal_world = PlaneTBN * normal_tangent,//in world space
-
-		water_normal = mix(vec3(0.0f, 1.0f, 0.0f), normal_world, Water.NormalStrength),
+	const vec3 water_normal = calcWaterNormal(TexCoord, dFdx(TexCoord), dFdy(TexCoord)),//in world space
 		primary_ray_dir = normalize(RayOrigin - Camera.Position),//pointing from camera water surface
 
 		reflection_dir = reflect(primary_ray_dir, water_normal),
@@ -103,8 +55,15 @@ void main() {
 	/*
 	Trace and find intersection of reflection/refraction ray.
 	*/
-	const vec4 reflection_intersection = findHitColour(normalize(reflection_dir)),
+	vec4 reflection_intersection, refraction_intersection;
+	if (UseTraceImage) {
+		const ivec2 pixel = ivec2(gl_FragCoord.xy);
+		reflection_intersection = texelFetch(TraceImage, ivec3(pixel, 0), 0);
+		refraction_intersection = texelFetch(TraceImage, ivec3(pixel, 1), 0);
+	} else {
+		reflection_intersection = findHitColour(normalize(reflection_dir));
 		refraction_intersection = findHitColour(normalize(refraction_dir));
+	}
 
 	/*
 	Due to LoD difference of geometry presented in rendered scene and acceleration structure,
@@ -3,16 +3,59 @@
 #include "CameraData.glsl"
 #include "PlaneGeometryAttribute.glsl"
 
-PLANE_ATTRIBUTE_POSITION(0, WaterPosition);
-PLANE_ATTRIBUTE_UV(1, WaterUV);
-
 WATER_RAY_PROPERTY(out);
 
+//Draw the surface as a clipmap centred at the camera, rather than the plane.
+layout(constant_id = 0) const bool SurfaceClipmap = false;
+//The number of cell along each side of a clipmap level, which is a multiple of 4.
+layout(constant_id = 1) const uint ClipmapGrid = 16u;
+
+layout(std430, push_constant) readonly restrict uniform Argument {
+	uint WaterDataIndex, WaterPlaneIndex;
+	//cell size of the finest clipmap level, and the point where every level is centred, in plane space
+	layout(offset = 60) float ClipmapCellSize;
+	vec2 ClipmapFocus;
+};
+
+//Reconstruct position and UV of a vertex of the clipmap, every level has the same number of cell, each having 6 vertices.
+//A level is snapped to twice its cell size, so the finer level covers a block of whole cells of this level, which are collapsed.
+//Positions are clamped to the plane, cells outside of the plane are collapsed onto its edge.
+void reconstructClipmapVertex(const uint plane, const uint vertex, out vec3 position, out vec2 uv) {
+	const uint level_vertex = ClipmapGrid * ClipmapGrid * 6u,
+		level = vertex / level_vertex,
+		cell = vertex % level_vertex / 6u;
+	const uvec2 id = uvec2(cell % ClipmapGrid, cell / ClipmapGrid);
+	const float cell_size = ClipmapCellSize * float(1u << level);
+
+	//in cell of this level
+	const vec2 level_min = floor(ClipmapFocus / (2.0f * cell_size) + 0.5f) * 2.0f - float(ClipmapGrid / 2u);
+	if (level > 0u) {
+		const vec2 finer_min = floor(ClipmapFocus / cell_size + 0.5f) - float(ClipmapGrid / 4u) - level_min;
+		if (all(greaterThanEqual(vec2(id), finer_min)) && all(lessThan(vec2(id), finer_min + float(ClipmapGrid / 2u)))) {
+			//every vertex of the cell is the same, so it has no area
+			position = vec3(0.0f);
+			uv = vec2(0.0f);
+			return;
+		}
+	}
+
+	const vec2 dimension = vec2(PlanePropertyHeap[plane].Dimension),
+		position_2d = clamp((level_min + vec2(id + PlaneQuadCorner[vertex % 6u])) * cell_size, vec2(0.0f), dimension);
+	position = vec3(position_2d.x, 0.0f, position_2d.y);
+	uv = position_2d / dimension;
+}
+
 void main() {
-	vec4 position_world = Water.Model * vec4(WaterPosition, 1.0f);
+	vec3 water_position;
+	if (SurfaceClipmap) {
+		reconstructClipmapVertex(WaterPlaneIndex, uint(gl_VertexIndex), water_position, TexCoord);
+	} else {
+		reconstructPlaneVertex(WaterPlaneIndex, uint(gl_VertexIndex), water_position, TexCoord);
+	}
+
+	vec4 position_world = Water.Model * vec4(water_position, 1.0f);
 	position_world.y += Water.AltitudeOffset;
 
-	gl_Position = Camera.ProjectionView * position_world;
-	TexCoord = WaterUV;
+	gl_Position = Camera.ProjectionView[0] * position_world;
 	RayOrigin = vec3(position_world);
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef _SIMPLE_WATER_RAY_GLSL_
+#define _SIMPLE_WATER_RAY_GLSL_
+
+//Shading of reflection and refraction rays, shared by ray query and ray tracing pipeline.
+#include "SimpleWater.glsl"
+#include "CameraData.glsl"
+#define PLANE_HIDE_PLANE_PROPERTY
+#define PLANE_VERTEX_ACCESS readonly
+#define PLANE_INDEX_ACCESS readonly
+#include "PlaneGeometry.glsl"
+
+layout(std430, push_constant) readonly restrict uniform Argument {
+	uint WaterDataIndex, WaterPlaneIndex,
+		//indices into the descriptor heap
+		SceneTextureIndex, WaterNormalIndex, WaterDistortionIndex, SceneDepthIndex, EnvironmentMapIndex,
+		SceneTextureSamplerIndex, WaterTextureSamplerIndex, SceneDepthSamplerIndex, EnvironmentMapSamplerIndex,
+		//reflection and refraction traced ahead of drawing, only used with ray tracing pipeline
+		TraceImageIndex,
+		//each traced pixel covers a square block of pixels of this width, and the jitter is index of the traced pixel in the block
+		TraceScale, TraceJitter;
+	float AnimationTimer,//increment and wrapped over between [0.0f, NormalScale)
+		//only used by vertex shader when the surface is drawn as a clipmap
+		ClipmapCellSize;
+	vec2 ClipmapFocus;
+	PlaneVertex Vertex;
+	PlaneIndex16 Index;
+};
+
+#define EnvironmentMap HEAP_SAMPLER_CUBE(EnvironmentMapIndex, EnvironmentMapSamplerIndex)
+#define SceneTexture HEAP_SAMPLER_2D(SceneTextureIndex, SceneTextureSamplerIndex)
+#define WaterNormal HEAP_SAMPLER_2D(WaterNormalIndex, WaterTextureSamplerIndex)
+#define WaterDistortion HEAP_SAMPLER_2D(WaterDistortionIndex, WaterTextureSamplerIndex)
+#define SceneDepth HEAP_SAMPLER_2D(SceneDepthIndex, SceneDepthSamplerIndex)
+#define TraceImage HEAP_SAMPLER_2D_ARRAY(TraceImageIndex, SceneDepthSamplerIndex)
+
+//HACK: We treat water as a perfect flat plane that points directly upwards.
+//If we wish to incorporate complex vertex animation (like water waves), then we should avoid using hard-coded value.
+//This matrix is to convert from tangent to world space for upward-facing plane.
+const mat3 PlaneTBN = mat3(
+	vec3(1.0f, 0.0f, 0.0f),
+	vec3(0.0f, 0.0f, -1.0f),
+	vec3(0.0f, 1.0f, 0.0f)
+);
+
+const float minRayTime = 1e-4f, maxRayTime = 1e4f;
+
+//Calculate the animated water normal in world space.
+//The gradient of texture coordinate is given explicitly, because not every shader stage has implicit derivatives;
+//define `WATER_IMPLICIT_DERIVATIVE` in a fragment shader to use implicit derivatives wherever the gradient is unknown.
+vec3 calcWaterNormal(const vec2 tex_coord, const vec2 grad_x, const vec2 grad_y) {
+	const vec2 scaled_uv = tex_coord * Water.NormalScale,
+		scaled_grad_x = grad_x * Water.NormalScale,
+		scaled_grad_y = grad_y * Water.NormalScale,
+		uv_distortion1 = textureGrad(WaterDistortion, scaled_uv + vec2(AnimationTimer, 0.0f), scaled_grad_x, scaled_grad_y).rg,
+		uv_distortion2 = textureGrad(WaterDistortion, scaled_uv + vec2(0.0f, AnimationTimer), scaled_grad_x, scaled_grad_y).rg,
+		distortion = ((uv_distortion1 + uv_distortion2) * 2.0f - 1.0f) * Water.DistortionStrength;
+
+#ifdef WATER_IMPLICIT_DERIVATIVE
+	const vec3 normal_tangent = normalize(texture(WaterNormal, distortion).rgb) * 2.0f - 1.0f,
+#else
+	//distortion barely varies across a pixel, so the normal is sampled from the finest level
+	const vec3 normal_tangent = normalize(textureLod(WaterNormal, distortion, 0.0f).rgb) * 2.0f - 1.0f,
+#endif
+		normal_world = PlaneTBN * normal_tangent;
+	return mix(vec3(0.0f, 1.0f, 0.0f), normal_world, Water.NormalStrength);
+}
+
+//Interpolate UV of a hit on the scene geometry.
+vec2 calcHitUV(const uint primitive_idx, const vec2 bary2) {
+	const vec3 bary3 = vec3(1.0f - bary2.x - bary2.y, bary2);
+
+	//the index in our geometry is packed as 6 16-bit integers per structure,
+	//while a primitive is packed as 3 integers per structure; need to convert the index.
+	const uint structure_idx = primitive_idx >> 1u,//equivalent to `primitive_idx / 2u`
+		within_structure_subset = primitive_idx & 1u;//equivalent to `primitive_idx % 2u`
+
+	vec2 hit_uv = vec2(0.0f);
+	for (uint i = 0u; i < bary3.length(); i++) {
+		const uint current_index = uint(Index[structure_idx].Index[3u * within_structure_subset + i]);
+		const vec2 vertex_uv = vec2(Vertex[current_index].UV) / float(~0us);
+
+		hit_uv += bary3[i] * vertex_uv;
+	}
+	return hit_uv;
+}
+
+//Return hit colour and ray length of a closest hit.
+vec4 shadeHit(const vec2 hit_uv, const float hit_t) {
+	const vec3 out_colour = textureLod(SceneTexture, hit_uv, 0.0f).rgb;
+	return vec4(pow(out_colour, vec3(2.2f)), hit_t);
+}
+
+//Return hit colour and ray length of a miss.
+vec4 shadeMiss(const vec3 dir) {
+	return vec4(textureLod(EnvironmentMap, dir, 0.0f).rgb, maxRayTime);
+}
+
+#endif//_SIMPLE_WATER_RAY_GLSL_
\ No newline at end of file
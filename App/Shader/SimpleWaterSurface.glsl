@@ -0,0 +1,58 @@
+#ifndef _SIMPLE_WATER_SURFACE_GLSL_
+#define _SIMPLE_WATER_SURFACE_GLSL_
+
+//Reconstruction of the water surface seen through a pixel without rasterisation.
+#include "SimpleWater.glsl"
+#include "CameraData.glsl"
+#include "PlaneGeometryAttribute.glsl"
+
+//A texel of trace image where no water surface is seen, marked by a negative ray length.
+const vec4 NoWaterTrace = vec4(vec3(0.0f), -1.0f);
+
+struct WaterSurface {
+
+	vec3 Position, ViewDirection;/**< In world space, view direction points from camera to the surface. */
+	vec2 TexCoord;
+	float Distance;/**< From the camera. */
+
+};
+
+//Intersect the camera ray through a pixel with the water plane, given the index into the descriptor heap of water data.
+//Like shading the rasterised surface, water is treated as a flat plane that points directly upwards.
+//Return the distance from the camera, which is not positive if the ray does not hit the plane.
+float calcWaterDistance(const uint water, const ivec2 pixel, const vec2 resolution, out vec3 view_direction) {
+	const vec2 screen_uv = (vec2(pixel) + 0.5f) / resolution,
+		//viewport is flipped vertically
+		ndc = vec2(screen_uv.x, 1.0f - screen_uv.y) * 2.0f - 1.0f;
+	//reversed depth, so 0.0f is the infinite far
+	view_direction = normalize((Camera.InvProjectionViewRotation[0] * vec4(ndc, 0.0f, 1.0f)).xyz);
+
+	const float altitude = WaterHeap[water].Model[3].y + WaterHeap[water].AltitudeOffset,
+		distance = (altitude - Camera.Position.y) / view_direction.y;
+	//also rejects rays parallel to the plane
+	return distance > 0.0f ? distance : -1.0f;
+}
+
+//Find the water surface seen through a pixel, given the indices into the descriptor heap of water data,
+//water plane property, scene depth and its sampler.
+//Return false if the pixel does not see the water plane, or if the water is hidden behind the scene.
+bool findWaterSurface(const uint water, const uint plane, const uint scene_depth, const uint scene_depth_sampler,
+	const ivec2 pixel, const vec2 resolution, out WaterSurface surface) {
+	surface.Distance = calcWaterDistance(water, pixel, resolution, surface.ViewDirection);
+	if (surface.Distance <= 0.0f) {
+		return false;
+	}
+	surface.Position = Camera.Position + surface.Distance * surface.ViewDirection;
+
+	const vec3 altitude = vec3(0.0f, WaterHeap[water].AltitudeOffset, 0.0f);
+	surface.TexCoord = vec3(inverse(WaterHeap[water].Model) * vec4(surface.Position - altitude, 1.0f)).xz
+		/ vec2(PlanePropertyHeap[plane].Dimension);
+	if (any(lessThan(surface.TexCoord, vec2(0.0f))) || any(greaterThan(surface.TexCoord, vec2(1.0f)))) {
+		return false;
+	}
+	//depth is reversed, such that nearer is larger
+	const vec4 clip = Camera.ProjectionView[0] * vec4(surface.Position, 1.0f);
+	return clip.z / clip.w >= texelFetch(HEAP_SAMPLER_2D(scene_depth, scene_depth_sampler), pixel, 0).r;
+}
+
+#endif//_SIMPLE_WATER_SURFACE_GLSL_
\ No newline at end of file
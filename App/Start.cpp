@@ -3,10 +3,16 @@
 #include "Common/VulkanObject.hpp"
 
 #include "Engine/Camera.hpp"
+#include "Engine/CpuProfiler.hpp"
+#include "Engine/DynamicResolution.hpp"
 #include "Engine/EngineSetting.hpp"
 #include "Engine/MasterEngine.hpp"
+#include "Engine/PresentPacer.hpp"
+#include "Engine/StartupGraph.hpp"
+#include "Engine/TimestampProfiler.hpp"
 #include "Engine/VulkanContext.hpp"
 #include "Engine/Abstraction/ImageManager.hpp"
+#include "Engine/Abstraction/ShaderModuleManager.hpp"
 
 #include "Renderer/DrawTriangle.hpp"
 #include "Renderer/SimpleTerrain.hpp"
@@ -22,13 +28,34 @@
 #include <glm/trigonometric.hpp>
 
 #include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <filesystem>
 #include <source_location>
 #include <stdexcept>
 #include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
 
 #include <array>
+#include <span>
+#include <optional>
+#include <vector>
+#include <string>
 #include <string_view>
 #include <tuple>
+#include <utility>
+
+#include <algorithm>
+#include <numeric>
+#include <ranges>
+#include <charconv>
+#include <cmath>
 
 using glm::dvec2, glm::dvec3;
 using glm::radians;
@@ -39,14 +66,28 @@ using std::runtime_error;
 using std::cout, std::cerr, std::endl;
 
 using std::string_view;
+using std::vector;
+using std::views::iota;
 
 namespace VKO = LearnVulkan::VulkanObject;
 
 namespace {
 
-	constexpr double MinFrameTime = 1.0 / 65.5;/**< The minimum amount of time between two frames, in seconds. */
+	//The minimum amount of time between two frames, in seconds.
+	//The frame rate is also limited by the display refresh rate when presenting in FIFO mode.
+	constexpr double MinFrameTime = 1.0 / 65.5;
+	//The longest time between two updates of camera from input, in seconds, while the render thread draws independently.
+	//Any input event wakes up the simulation thread earlier.
+	constexpr double SimulationInterval = 1.0 / 240.0;
+	//The GPU time of rendering a frame held by dynamic resolution, in millisecond.
+	constexpr double DynamicResolutionTargetFrameTime = 1000.0 / 60.0;
+	constexpr double ProfileReportInterval = 1.0;/**< The time between two reports of GPU profiling result, in seconds. */
+	constexpr double MemoryReportInterval = 10.0;/**< The time between two reports of device memory usage, in seconds. */
+	//The timeline of CPU profiler written on exit, in the working directory, if the profiler is compiled in.
+	constexpr const char* CpuTraceFilename = "CpuTrace.json";
 
 	constexpr unsigned int InitialWidth = 720u, InitialHeight = 720u;
+	constexpr const char* CanvasTitle = "Vulkan Tutorial";
 	constexpr LearnVulkan::Camera::CameraData CameraData = {
 		.Yaw = radians(-90.0),
 		.Pitch = radians(-30.0),
@@ -60,13 +101,236 @@ namespace {
 		.Far = 1155.5
 	};
 
+	/////////////////////////////////////////////////////////////////////////////
+	///								Benchmark
+	////////////////////////////////////////////////////////////////////////////
+	constexpr unsigned int BenchmarkWidth = 1280u, BenchmarkHeight = 720u;
+	constexpr unsigned int BenchmarkDefaultFrameCount = 1000u,
+		//Frames rendered before recording, to allow caches to warm up and profiler results to become available.
+		BenchmarkWarmUpFrame = 30u;
+	constexpr double BenchmarkDeltaTime = 1.0 / 60.0;/**< Fixed frame time feeding the animation, so every run is identical. */
+	//Interactive rendering keeps a single frame in flight for the lowest input latency,
+	//while benchmark has no one waiting for its output and keeps more frames in flight for throughput.
+	//Either can be overridden from the command line.
+	constexpr unsigned int InteractiveFrameInFlight = 1u, BenchmarkFrameInFlight = 3u;
+	constexpr string_view FrameInFlightOption = "--frame-in-flight=";
+
+	/**
+	 * @brief A segment of scripted camera movement.
+	*/
+	struct CameraPathSegment {
+
+		unsigned int Frame;/**< The number of frame this segment lasts. */
+		LearnVulkan::Camera::MoveDirection Direction;
+		dvec2 Rotation;/**< The cursor offset applied on every frame. */
+
+	};
+	//The benchmark camera path. The path is repeated if the benchmark lasts longer than it.
+	constexpr auto BenchmarkCameraPath = [] {
+		using enum LearnVulkan::Camera::MoveDirection;
+		return std::array {
+			CameraPathSegment { 120u, Forward, dvec2(0.0) },
+			CameraPathSegment { 90u, Forward, dvec2(25.0, 0.0) },
+			CameraPathSegment { 60u, Up, dvec2(0.0, -10.0) },
+			CameraPathSegment { 120u, Right, dvec2(-25.0, 0.0) },
+			CameraPathSegment { 60u, Down, dvec2(0.0, 10.0) },
+			CameraPathSegment { 120u, Backward, dvec2(0.0) }
+		};
+	}();
+
+	/**
+	 * @brief Setting of a benchmark run.
+	*/
+	struct BenchmarkSetting {
+
+		string_view SampleName;
+		unsigned int FrameCount;
+		const char* OutputFilename;/**< Write report as JSON to this file, or null to skip. */
+
+	};
+
+	/**
+	 * @brief Statistics of a series of frame time, in millisecond.
+	*/
+	struct FrameTimeStatistics {
+
+		double Average, P50, P95, P99;
+
+	};
+
+	//The content of sample will be sorted.
+	FrameTimeStatistics computeFrameTimeStatistics(vector<double>& sample) {
+		if (sample.empty()) {
+			return { };
+		}
+		std::ranges::sort(sample);
+		//nearest-rank percentile
+		const auto percentile = [&sample](const double p) noexcept -> double {
+			const size_t rank = static_cast<size_t>(std::ceil(p * sample.size()));
+			return sample[std::clamp<size_t>(rank, 1u, sample.size()) - 1u];
+		};
+		return {
+			.Average = std::reduce(sample.cbegin(), sample.cend()) / sample.size(),
+			.P50 = percentile(0.5),
+			.P95 = percentile(0.95),
+			.P99 = percentile(0.99)
+		};
+	}
+
+	//Add pipeline statistics of a frame into a total.
+	void accumulatePipelineStatistics(LearnVulkan::TimestampProfiler::PipelineStatistics& total,
+		const LearnVulkan::TimestampProfiler::PipelineStatistics& frame) noexcept {
+		total.VertexShaderInvocation += frame.VertexShaderInvocation;
+		total.ClippingPrimitive += frame.ClippingPrimitive;
+		total.FragmentShaderInvocation += frame.FragmentShaderInvocation;
+		total.TessellationControlShaderPatch += frame.TessellationControlShaderPatch;
+		total.TessellationEvaluationShaderInvocation += frame.TessellationEvaluationShaderInvocation;
+		total.ComputeShaderInvocation += frame.ComputeShaderInvocation;
+	}
+
+	/**
+	 * @brief Render a fixed number of frames along the scripted camera path and report frame time statistics.
+	 * @param engine The engine with a renderer attached.
+	 * @param setting The benchmark setting.
+	*/
+	void runBenchmark(LearnVulkan::MasterEngine& engine, const BenchmarkSetting& setting) {
+		const auto [sample_name, frame_count, output_filename] = setting;
+		LearnVulkan::Camera& camera = engine.camera();
+		const auto region_time = engine.profiler().regionTime();
+
+		vector<double> cpu_time, gpu_time;
+		//GPU time of each profiled region, excluding the whole frame which is recorded separately
+		vector<vector<double>> region_sample(region_time.size());
+		//pipeline statistics of each region summed over every frame, only meaningful for regions recording them
+		vector<LearnVulkan::TimestampProfiler::PipelineStatistics> region_counter(region_time.size());
+		cpu_time.reserve(frame_count);
+		gpu_time.reserve(frame_count);
+		for (auto& sample : region_sample) {
+			sample.reserve(frame_count);
+		}
+
+		unsigned int segment_index = 0u, segment_frame = 0u;
+		for (const auto frame : iota(0u, BenchmarkWarmUpFrame + frame_count)) {
+			const auto& [segment_length, direction, rotation] = BenchmarkCameraPath[segment_index];
+			camera.move(direction, BenchmarkDeltaTime);
+			camera.rotate(rotation);
+			camera.publish();
+			if (++segment_frame == segment_length) {
+				segment_frame = 0u;
+				segment_index = (segment_index + 1u) % BenchmarkCameraPath.size();
+			}
+
+			const double begin = glfwGetTime();
+			engine.draw(BenchmarkDeltaTime);
+			const double end = glfwGetTime();
+
+			if (frame < BenchmarkWarmUpFrame) {
+				continue;
+			}
+			cpu_time.push_back((end - begin) * 1000.0);
+			gpu_time.push_back(engine.gpuFrameTime());
+			for (const auto i : iota(size_t { 0 }, region_time.size())) {
+				region_sample[i].push_back(region_time[i].Millisecond);
+				accumulatePipelineStatistics(region_counter[i], region_time[i].Statistics);
+			}
+		}
+
+		/*****************
+		 * Report
+		 *****************/
+		const FrameTimeStatistics cpu_stat = computeFrameTimeStatistics(cpu_time),
+			gpu_stat = computeFrameTimeStatistics(gpu_time);
+		vector<FrameTimeStatistics> region_stat(region_sample.size());
+		std::ranges::transform(region_sample, region_stat.begin(), &computeFrameTimeStatistics);
+
+		const auto printStatistics = [](std::ostream& out, const FrameTimeStatistics& stat) {
+			out << "{ \"average\": " << stat.Average << ", \"p50\": " << stat.P50
+				<< ", \"p95\": " << stat.P95 << ", \"p99\": " << stat.P99 << " }";
+		};
+		//average count per frame
+		const auto printPipelineStatistics = [frame_count](std::ostream& out, const LearnVulkan::TimestampProfiler::PipelineStatistics& total) {
+			const double frame = static_cast<double>(frame_count);
+			out << "{ \"vertex\": " << total.VertexShaderInvocation / frame
+				<< ", \"clipping\": " << total.ClippingPrimitive / frame
+				<< ", \"fragment\": " << total.FragmentShaderInvocation / frame
+				<< ", \"tessellation_control\": " << total.TessellationControlShaderPatch / frame
+				<< ", \"tessellation_evaluation\": " << total.TessellationEvaluationShaderInvocation / frame
+				<< ", \"compute\": " << total.ComputeShaderInvocation / frame << " }";
+		};
+
+		cout << "Benchmark \'" << sample_name << "\' finished after " << frame_count << " frames\n" << std::fixed << std::setprecision(3);
+		cout << "CPU (ms): ";
+		printStatistics(cout, cpu_stat);
+		cout << "\nGPU (ms): ";
+		printStatistics(cout, gpu_stat);
+		for (const auto i : iota(size_t { 0 }, region_stat.size())) {
+			cout << '\n' << region_time[i].Name << " (ms): ";
+			printStatistics(cout, region_stat[i]);
+			if (region_time[i].RecordStatistics) {
+				cout << '\n' << region_time[i].Name << " (per frame): ";
+				printPipelineStatistics(cout, region_counter[i]);
+			}
+		}
+		cout << endl;
+		engine.memoryTelemetry().print(cout);
+
+		if (!output_filename) {
+			return;
+		}
+		std::ofstream report(output_filename);
+		if (!report) {
+			throw runtime_error("Unable to open the benchmark report file for writing");
+		}
+		report << std::fixed << std::setprecision(4);
+		report << "{\n\t\"sample\": \"" << sample_name << "\",\n";
+		report << "\t\"frame\": " << frame_count << ",\n";
+		report << "\t\"extent\": [" << BenchmarkWidth << ", " << BenchmarkHeight << "],\n";
+		report << "\t\"cpu\": ";
+		printStatistics(report, cpu_stat);
+		report << ",\n\t\"gpu\": ";
+		printStatistics(report, gpu_stat);
+		report << ",\n\t\"region\": {";
+		for (const auto i : iota(size_t { 0 }, region_stat.size())) {
+			report << (i == 0u ? "\n" : ",\n") << "\t\t\"" << region_time[i].Name << "\": ";
+			printStatistics(report, region_stat[i]);
+		}
+		report << "\n\t},\n\t\"pipeline_statistics\": {";
+		bool first_counter = true;
+		for (const auto i : iota(size_t { 0 }, region_time.size())) {
+			if (!region_time[i].RecordStatistics) {
+				continue;
+			}
+			report << (first_counter ? "\n" : ",\n") << "\t\t\"" << region_time[i].Name << "\": ";
+			printPipelineStatistics(report, region_counter[i]);
+			first_counter = false;
+		}
+		report << "\n\t},\n\t\"memory\": ";
+		engine.memoryTelemetry().writeJson(report);
+		report << "\n}" << endl;
+	}
+
 	/**
 	 * @brief The name of each sample application.
 	*/
 	enum class SampleApplicationName : uint8_t {
 		Triangle = 0x00u,
+		//Same as above, but a massive field of instances is generated, culled and drawn on the device.
+		TriangleStress = 0x01u,
 		Terrain = 0x10u,
 		Water = 0x11u,
+		//Same as above, but the terrain is rendered with mesh shader instead of tessellation.
+		TerrainMesh = 0x12u,
+		WaterMesh = 0x13u,
+		//Water reflection and refraction are traced by ray tracing pipeline instead of ray query.
+		WaterTrace = 0x14u,
+		//Same as above, but rays are traced at half resolution and reconstructed to full resolution.
+		WaterTraceHalf = 0x15u,
+		//Water surface is drawn as a clipmap centred at the camera instead of a plane of fixed subdivision.
+		WaterClipmap = 0x16u,
+		//Terrain depth is filled by a depth pre-pass before shading, which is also the scene depth of water.
+		WaterPrePass = 0x17u,
+		//Sky is baked from a procedural atmosphere instead of loaded from a sky box texture.
+		TerrainAtmosphere = 0x18u,
 		Invalid = 0xFFu
 	};
 
@@ -78,6 +342,8 @@ namespace {
 	struct CanvasEventStatus {
 
 		bool NeedReshape, CursorMoved;
+		//Set when the user requests a different present mode.
+		std::optional<VkPresentModeKHR> RequestedPresentMode;
 
 	};
 
@@ -96,6 +362,23 @@ namespace {
 		reinterpret_cast<CanvasEventStatus*>(glfwGetWindowUserPointer(canvas))->CursorMoved = true;
 	}
 
+	void pressKey(GLFWwindow* const canvas, const int key, int, const int action, int) {
+		if (action != GLFW_PRESS) {
+			return;
+		}
+		auto& requested_mode = reinterpret_cast<CanvasEventStatus*>(glfwGetWindowUserPointer(canvas))->RequestedPresentMode;
+		switch (key) {
+		case GLFW_KEY_1: requested_mode = VK_PRESENT_MODE_FIFO_KHR;
+			break;
+		case GLFW_KEY_2: requested_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+			break;
+		case GLFW_KEY_3: requested_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			break;
+		default:
+			break;
+		}
+	}
+
 	void processKeystroke(GLFWwindow* const canvas, LearnVulkan::Camera& camera, const double delta) noexcept {
 		using enum LearnVulkan::Camera::MoveDirection;
 		if (glfwGetKey(canvas, GLFW_KEY_W)) {
@@ -122,6 +405,115 @@ namespace {
 		}
 	}
 
+	constexpr const char* getPresentModeName(const VkPresentModeKHR mode) noexcept {
+		switch (mode) {
+		case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+		case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+		case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+		default: return "Unknown";
+		}
+	}
+
+	//Compose the canvas title displaying present mode, latency, and GPU time of all profiled regions.
+	std::string composeProfileReport(const LearnVulkan::MasterEngine& engine) {
+		const LearnVulkan::PresentPacer& pacer = engine.presentPacer();
+
+		std::ostringstream title;
+		title << CanvasTitle << std::fixed << std::setprecision(3);
+		title << " | " << getPresentModeName(pacer.presentMode()) << " | Latency: " << pacer.latency() << " ms";
+		for (const auto& region : engine.profiler().regionTime()) {
+			title << " | " << region.Name << ": " << region.Millisecond << " ms";
+		}
+		return title.str();
+	}
+
+	/////////////////////////////////////////////////////////////////////////////
+	///								Render Thread
+	////////////////////////////////////////////////////////////////////////////
+
+	//Control of the render thread, which waits for, records and submits frames,
+	//by the main thread, which owns the canvas and simulates the camera from input.
+	struct RenderThreadControl {
+
+		//Checked by the render thread at every frame boundary.
+		std::atomic<bool> PauseRequested, ExitRequested;
+		std::mutex Mutex;
+		std::condition_variable Condition;
+
+		//The rest are guarded by the mutex.
+		bool Paused;/**< The main thread has exclusive access to the engine while the render thread is paused. */
+		std::atomic<bool> Exited;/**< Can also be read without holding the mutex. */
+		std::exception_ptr Error;/**< Thrown by the render thread before it exits. */
+		//The canvas title composed by the render thread, to be set by the main thread.
+		std::string Title;
+		bool TitleUpdated;
+
+	};
+
+	void runRenderThread(LearnVulkan::MasterEngine& engine, RenderThreadControl& control) {
+		LearnVulkan::CpuProfiler::nameThread("Render");
+		try {
+			double last_report_time = glfwGetTime(), last_memory_report_time = last_report_time;
+			while (!control.ExitRequested.load(std::memory_order_relaxed)) {
+				if (control.PauseRequested.load(std::memory_order_relaxed)) {
+					std::unique_lock lock(control.Mutex);
+					control.Paused = true;
+					control.Condition.notify_all();
+					control.Condition.wait(lock, [&control]() noexcept { return !control.PauseRequested.load(std::memory_order_relaxed); });
+					control.Paused = false;
+					continue;
+				}
+
+				//the camera pose published by the main thread is sampled when the frame is drawn
+				engine.draw(engine.waitNextFrame());
+
+				if (const double current_time = glfwGetTime();
+					current_time - last_report_time >= ProfileReportInterval) {
+					std::string title = composeProfileReport(engine);
+					{
+						const std::lock_guard lock(control.Mutex);
+						control.Title = std::move(title);
+						control.TitleUpdated = true;
+					}
+					glfwPostEmptyEvent();
+					last_report_time = current_time;
+				}
+				if (const double current_time = glfwGetTime();
+					current_time - last_memory_report_time >= MemoryReportInterval) {
+					engine.memoryTelemetry().print(cout);
+					last_memory_report_time = current_time;
+				}
+			}
+		} catch (...) {
+			const std::lock_guard lock(control.Mutex);
+			control.Error = std::current_exception();
+		}
+		{
+			const std::lock_guard lock(control.Mutex);
+			control.Exited.store(true, std::memory_order_relaxed);
+		}
+		control.Condition.notify_all();
+		//wake up the main thread waiting for input
+		glfwPostEmptyEvent();
+	}
+
+	//Pause the render thread at the next frame boundary.
+	//Return false if the render thread has exited, and there is no need to resume it.
+	bool pauseRenderThread(RenderThreadControl& control) {
+		std::unique_lock lock(control.Mutex);
+		control.PauseRequested.store(true, std::memory_order_relaxed);
+		control.Condition.wait(lock, [&control]() noexcept { return control.Paused || control.Exited.load(std::memory_order_relaxed); });
+		return control.Paused;
+	}
+
+	void resumeRenderThread(RenderThreadControl& control) {
+		{
+			const std::lock_guard lock(control.Mutex);
+			control.PauseRequested.store(false, std::memory_order_relaxed);
+		}
+		control.Condition.notify_all();
+	}
+
 	struct CanvasDestroyer {
 	public:
 
@@ -137,17 +529,21 @@ namespace {
 	////////////////////////////////////////////////////////////////////
 	/**
 	 * @brief Initialise the drawing canvas.
+	 * @param headless If true, the canvas is hidden and sized for benchmarking.
 	 * @return Canvas.
 	*/
-	CanvasHandle initCanvas() {
+	CanvasHandle initCanvas(const bool headless) {
 		/*******************************
 		 * Canvas initialisation setup
 		 *******************************/
 		CHECK_GLFW_ERROR(glfwVulkanSupported());
 
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_VISIBLE, headless ? GLFW_FALSE : GLFW_TRUE);
+		glfwWindowHint(GLFW_RESIZABLE, headless ? GLFW_FALSE : GLFW_TRUE);
 
-		GLFWwindow* const canvas = glfwCreateWindow(InitialWidth, InitialHeight, "Vulkan Tutorial", nullptr, nullptr);
+		GLFWwindow* const canvas = headless ? glfwCreateWindow(BenchmarkWidth, BenchmarkHeight, CanvasTitle, nullptr, nullptr)
+			: glfwCreateWindow(InitialWidth, InitialHeight, CanvasTitle, nullptr, nullptr);
 		if (!canvas) {
 			throw runtime_error("Unable to initialise GLFW window");
 		}
@@ -158,90 +554,297 @@ namespace {
 		 *************************************/
 		glfwSetFramebufferSizeCallback(canvas, &resizeCanvas);
 		glfwSetCursorPosCallback(canvas, &moveCursor);
+		glfwSetKeyCallback(canvas, &pressKey);
 		glfwSetInputMode(canvas, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 		return canvas_handle;
 	}
 
-	void runApplication(const SampleApplicationName app_name) {
-		const CanvasHandle canvas_handle = initCanvas();
+	//A texture of a sample application, which is read from its baked image container if it is up to date,
+	//otherwise it is decoded in the background and baked into the container for the next run.
+	struct SampleTexture {
+
+		const char* Container = nullptr;
+		std::future<LearnVulkan::ImageManager::ImageDecodeResult> Decode;/**< Not valid if reading from the container. */
+
+	};
+
+	//A heightfield is streamed from its baked tiled image file,
+	//which is baked in the background if it is not up to date.
+	struct SampleHeightfield {
+
+		const char* TiledFile = nullptr;
+		std::future<void> Bake;/**< Not valid if the tiled file is up to date. */
+
+	};
+
+	//Textures not used by the sample application are left empty.
+	struct SampleTextureDecode {
+
+		SampleTexture SkyBox, Triangle, WaterNormalmap, WaterDistortion;
+		SampleHeightfield Heightfield;
+
+	};
+
+	//Staging buffers of the textures in use, read once decoding completes.
+	struct SampleTextureRead {
+
+		LearnVulkan::ImageManager::ImageReadResult SkyBox, Triangle, WaterNormalmap, WaterDistortion;
+
+	};
+
+	template<LearnVulkan::ImageManager::ImageBitWidth BitWidth>
+	SampleTexture loadSampleTexture(const char* const container, const std::span<const char* const> source,
+		const LearnVulkan::ImageManager::ImageReadInfo& img_read_info, const bool bake_mip_map) {
+		namespace IM = LearnVulkan::ImageManager;
+
+		vector<const char*> all_source(source.begin(), source.end());
+		if (img_read_info.CompressedFilename) {
+			all_source.push_back(img_read_info.CompressedFilename);
+		}
+		if (IM::isContainerFileUpToDate(container, all_source)) {
+			return { .Container = container };
+		}
+		return {
+			.Container = container,
+			.Decode = std::async(std::launch::async, [container, source, img_read_info, bake_mip_map]() {
+				IM::ImageDecodeResult image = IM::decodeFile<BitWidth>(source, img_read_info);
+				if (bake_mip_map && image.Level.size() == 1u && !IM::isBlockCompressed(image.Format)) {
+					IM::bakeMipMap(image);
+				}
+				try {
+					IM::writeContainerFile(container, image);
+				} catch (const std::exception&) {
+					//failing to bake only costs decoding again in the next run
+				}
+				return image;
+			})
+		};
+	}
+
+	SampleHeightfield loadSampleHeightfield(const char* const tiled_file, const std::span<const char* const> source,
+		const LearnVulkan::ImageManager::ImageReadInfo& img_read_info, const uint32_t tile_size) {
+		namespace IM = LearnVulkan::ImageManager;
+
+		if (IM::isContainerFileUpToDate(tiled_file, source)) {
+			return { .TiledFile = tiled_file };
+		}
+		return {
+			.TiledFile = tiled_file,
+			//unlike a texture, the tiled file is required to stream the heightfield, so failing to bake is fatal
+			.Bake = std::async(std::launch::async, [tiled_file, source, img_read_info, tile_size]() {
+				IM::writeTiledFile(tiled_file, IM::decodeFile<IM::ImageBitWidth::Sixteen>(source, img_read_info), tile_size);
+			})
+		};
+	}
+
+	//Start loading all textures required by a sample application.
+	SampleTextureDecode decodeSampleTexture(const SampleApplicationName app_name) {
+		using std::array;
+
+		using namespace LearnVulkan;
+		namespace IM = ImageManager;
+		using enum SampleApplicationName;
+		namespace RP = ResourcePath;
+
+		//filenames must remain valid until decoding completes, so they are all static
+		constexpr static string_view SkyBoxRightFilename = "/right.png",
+			SkyBoxLeftFilename = "/left.png",
+			SkyBoxTopFilename = "/top.png",
+			SkyBoxBottomFilename = "/bottom.png",
+			SkyBoxFrontFilename = "/front.png",
+			SkyBoxBackFilename = "/back.png";
+		constexpr static auto SkyBoxAllFullPath = File::toAbsolutePath<RP::SkyCubeMapResourceRoot,
+			SkyBoxRightFilename,
+			SkyBoxLeftFilename,
+			SkyBoxTopFilename,
+			SkyBoxBottomFilename,
+			SkyBoxFrontFilename,
+			SkyBoxBackFilename
+		>();
+		constexpr static auto SkyBoxAllFullPathArray = std::apply(
+			[](const auto&... tup_elem) constexpr noexcept { return array { tup_elem.data()... }; },
+			SkyBoxAllFullPath
+		);
+
+		//baked image containers in the cache are preferred if they are up to date
+		constexpr static string_view TextureCacheDirectory = "/Texture",
+			SkyBoxContainerFilename = "/Texture/SkyBox.lvimg",
+			TriangleContainerFilename = "/Texture/Triangle.lvimg",
+			HeightfieldTiledFilename = "/Texture/TerrainHeightfieldHalf.lvtile",
+			WaterNormalmapContainerFilename = "/Texture/WaterNormal.lvimg",
+			WaterDistortionContainerFilename = "/Texture/WaterDUDV.lvimg";
+		constexpr static auto TextureCacheDirectoryFullPath = File::toAbsolutePath<RP::CacheRoot, TextureCacheDirectory>();
+		constexpr static auto SkyBoxContainerFullPath = File::toAbsolutePath<RP::CacheRoot, SkyBoxContainerFilename>();
+		constexpr static auto TriangleContainerFullPath = File::toAbsolutePath<RP::CacheRoot, TriangleContainerFilename>();
+		constexpr static auto HeightfieldTiledFullPath = File::toAbsolutePath<RP::CacheRoot, HeightfieldTiledFilename>();
+		constexpr static auto WaterNormalmapContainerFullPath = File::toAbsolutePath<RP::CacheRoot, WaterNormalmapContainerFilename>();
+		constexpr static auto WaterDistortionContainerFullPath = File::toAbsolutePath<RP::CacheRoot, WaterDistortionContainerFilename>();
+		std::filesystem::create_directories(TextureCacheDirectoryFullPath.data());
+
+		//the heightfield is streamed in tiles, each of which is 128 KiB in half-float RGBA
+		constexpr static uint32_t HeightfieldTileSize = 128u;
+
+		//pre-compressed textures are preferred if present, otherwise fall back to decode the source images
+		constexpr static string_view SkyBoxCompressedFilename = "/SkyBox.ktx2";
+		constexpr static auto SkyBoxCompressedFullPath = File::toAbsolutePath<RP::SkyCubeMapResourceRoot, SkyBoxCompressedFilename>();
+
+		constexpr static string_view TriangleImageFilename = "/WoodFloor051_1K-PNG/WoodFloor051_1K_Color.png";
+		constexpr static auto TriangleImageFullPath = File::toAbsolutePath<RP::GeneralResourceRoot, TriangleImageFilename>();
+		constexpr static array TriangleImageFullPathArray = { TriangleImageFullPath.data() };
+
+		constexpr static string_view TerrainHeightfieldFilename = "/TerrainHeightfield.png",
+			WaterNormalmapFilename = "/Water/waterNormal.png", WaterDistortionFilename = "/Water/waterDUDV.png";
+		constexpr static auto TerrainHeightfieldFullPath = File::toAbsolutePath<RP::HeightfieldResourceRoot,
+			TerrainHeightfieldFilename>();
+		constexpr static auto WaterNormalmapFullPath = File::toAbsolutePath<RP::GeneralResourceRoot, WaterNormalmapFilename>();
+		constexpr static auto WaterDistortionFullPath = File::toAbsolutePath<RP::GeneralResourceRoot, WaterDistortionFilename>();
+		constexpr static array TerrainHeightfieldFullPathArray = { TerrainHeightfieldFullPath.data() },
+			WaterNormalmapFullPathArray = { WaterNormalmapFullPath.data() },
+			WaterDistortionFullPathArray = { WaterDistortionFullPath.data() };
+		constexpr static string_view WaterNormalmapCompressedFilename = "/Water/waterNormal.ktx2",
+			WaterDistortionCompressedFilename = "/Water/waterDUDV.ktx2";
+		constexpr static auto WaterNormalmapCompressedFullPath = File::toAbsolutePath<RP::GeneralResourceRoot,
+			WaterNormalmapCompressedFilename>();
+		constexpr static auto WaterDistortionCompressedFullPath = File::toAbsolutePath<RP::GeneralResourceRoot,
+			WaterDistortionCompressedFilename>();
+
+		SampleTextureDecode texture;
+		switch (app_name) {
+		case TriangleStress:
+			[[fallthrough]];
+		case Triangle:
+			texture.Triangle = ::loadSampleTexture<IM::ImageBitWidth::Eight>(TriangleContainerFullPath.data(),
+				TriangleImageFullPathArray, {
+				.Channel = 4,
+				.ColourSpace = IM::ImageColourSpace::SRGB
+			}, true);
+			break;
+		case WaterPrePass:
+			[[fallthrough]];
+		case WaterClipmap:
+			[[fallthrough]];
+		case WaterTraceHalf:
+			[[fallthrough]];
+		case WaterTrace:
+			[[fallthrough]];
+		case WaterMesh:
+			[[fallthrough]];
+		case Water:
+			texture.WaterNormalmap = ::loadSampleTexture<IM::ImageBitWidth::Eight>(WaterNormalmapContainerFullPath.data(),
+				WaterNormalmapFullPathArray, {
+				.Channel = 4,
+				.ColourSpace = IM::ImageColourSpace::Linear,
+				.CompressedFilename = WaterNormalmapCompressedFullPath.data()
+			}, true);
+			texture.WaterDistortion = ::loadSampleTexture<IM::ImageBitWidth::Eight>(WaterDistortionContainerFullPath.data(),
+				WaterDistortionFullPathArray, {
+				.Channel = 2,
+				.ColourSpace = IM::ImageColourSpace::Linear,
+				.CompressedFilename = WaterDistortionCompressedFullPath.data()
+			}, true);
+			[[fallthrough]];
+		case TerrainMesh:
+			[[fallthrough]];
+		case Terrain:
+			//neither sky nor heightfield is sampled with mip-map
+			texture.SkyBox = ::loadSampleTexture<IM::ImageBitWidth::Eight>(SkyBoxContainerFullPath.data(),
+				SkyBoxAllFullPathArray, {
+				.Channel = 4,
+				.ColourSpace = IM::ImageColourSpace::SRGB,
+				.CompressedFilename = SkyBoxCompressedFullPath.data()
+			}, false);
+			[[fallthrough]];
+		case TerrainAtmosphere:
+			texture.Heightfield = ::loadSampleHeightfield(HeightfieldTiledFullPath.data(),
+				TerrainHeightfieldFullPathArray, {
+				.Channel = 4,
+				.ColourSpace = IM::ImageColourSpace::Linear,
+				.HalfFloat = true
+			}, HeightfieldTileSize);
+			break;
+		default: throw runtime_error("The sample application name specified is unknown");
+		}
+		return texture;
+	}
+
+	//Block until all textures of a sample application are decoded, without taking the decode result.
+	void waitSampleTexture(SampleTextureDecode& texture) {
+		for (SampleTexture* const sample_texture : { &texture.SkyBox, &texture.Triangle, &texture.WaterNormalmap, &texture.WaterDistortion }) {
+			if (sample_texture->Decode.valid()) {
+				sample_texture->Decode.wait();
+			}
+		}
+		if (texture.Heightfield.Bake.valid()) {
+			texture.Heightfield.Bake.get();
+		}
+	}
+
+	//Read textures of a sample application into staging buffers, textures not used are left empty.
+	SampleTextureRead readSampleTexture(const LearnVulkan::VulkanContext& ctx, SampleTextureDecode& texture) {
+		namespace IM = LearnVulkan::ImageManager;
+
+		const auto readTexture = [&ctx](SampleTexture& sample_texture) -> IM::ImageReadResult {
+			if (!sample_texture.Container) {
+				return { };
+			}
+			return sample_texture.Decode.valid() ? IM::readFile(ctx.Device, ctx.Allocator, sample_texture.Decode.get())
+				: IM::readContainerFile(ctx.Device, ctx.Allocator, sample_texture.Container);
+		};
+		return {
+			.SkyBox = readTexture(texture.SkyBox),
+			.Triangle = readTexture(texture.Triangle),
+			.WaterNormalmap = readTexture(texture.WaterNormalmap),
+			.WaterDistortion = readTexture(texture.WaterDistortion)
+		};
+	}
+
+	//Run the sample application interactively, or run a benchmark if benchmark setting is not null.
+	//The number of frame in flight follows the default of the mode if not given.
+	void runApplication(const SampleApplicationName app_name, const BenchmarkSetting* const benchmark,
+		const std::optional<unsigned int> frame_in_flight) {
+		using PhaseIdentifier = LearnVulkan::StartupGraph::PhaseIdentifier;
+		using std::array;
+
+		const CanvasHandle canvas_handle = initCanvas(benchmark != nullptr);
 		GLFWwindow* const canvas = canvas_handle.get();
 
-		LearnVulkan::MasterEngine engine(canvas, CameraData, cout);
+		LearnVulkan::Camera::CameraData camera_data = CameraData;
+		if (benchmark) {
+			camera_data.Aspect = (1.0 * BenchmarkWidth) / (1.0 * BenchmarkHeight);
+		}
+		//declared in reverse order of destruction, such that staging buffers and renderer are released before the engine
+		std::optional<LearnVulkan::MasterEngine> engine_storage;
+		SampleTextureDecode texture;
+		SampleTextureRead texture_read;
+		unique_ptr<LearnVulkan::RendererInterface> renderer;
 
 		//Create sample application based on selection of app_name.
-		const auto createSampleApplication = [&engine, app_name]() -> unique_ptr<LearnVulkan::RendererInterface> {
-			using std::array;
-
+		const auto createSampleApplication = [&engine_storage, app_name, &texture, &texture_read]()
+			-> unique_ptr<LearnVulkan::RendererInterface> {
 			using namespace LearnVulkan;
-			namespace IM = ImageManager;
 			using enum SampleApplicationName;
-			namespace RP = ResourcePath;
 
+			MasterEngine& engine = *engine_storage;
 			const VulkanContext& ctx = engine.context();
 
-			////////////////////////
-			/// Load skybox texture
-			////////////////////////
-			bool draw_skybox;
-			switch (app_name) {
-			case Terrain:
-				[[fallthrough]];
-			case Water:
-				draw_skybox = true;
-				break;
-			default:
-				draw_skybox = false;
-				break;
-			}
-			constexpr static string_view SkyBoxRightFilename = "/right.png",
-				SkyBoxLeftFilename = "/left.png",
-				SkyBoxTopFilename = "/top.png",
-				SkyBoxBottomFilename = "/bottom.png",
-				SkyBoxFrontFilename = "/front.png",
-				SkyBoxBackFilename = "/back.png";
-			constexpr static auto SkyBoxAllFullPath = File::toAbsolutePath<RP::SkyCubeMapResourceRoot,
-				SkyBoxRightFilename,
-				SkyBoxLeftFilename,
-				SkyBoxTopFilename,
-				SkyBoxBottomFilename,
-				SkyBoxFrontFilename,
-				SkyBoxBackFilename
-			>();
-			constexpr static auto SkyBoxAllFullPathArray = std::apply(
-				[](const auto&... tup_elem) constexpr noexcept { return array { tup_elem.data()... }; },
-				SkyBoxAllFullPath
-			);
-
-			IM::ImageReadResult skybox_image;
-			if (draw_skybox) {
-				skybox_image = IM::readFile<IM::ImageBitWidth::Eight>(ctx.Device, ctx.Allocator, SkyBoxAllFullPathArray, {
-					.Channel = 4,
-					.ColourSpace = IM::ImageColourSpace::SRGB
-				});
-			}
-
 			//////////////////////////
 			/// Setup renderer
 			/////////////////////////
 			switch (app_name) {
 			case Triangle:
+				[[fallthrough]];
+			case TriangleStress:
 			{
-				constexpr static string_view TriangleImageFilename = "/WoodFloor051_1K-PNG/WoodFloor051_1K_Color.png";
-				constexpr static auto TriangleImageFullPath = File::toAbsolutePath<RP::GeneralResourceRoot, TriangleImageFilename>();
-				constexpr static array TriangleImageFullPathArray = { TriangleImageFullPath.data() };
-
-				constexpr static IM::ImageReadInfo triangle_image_info {
-					.Channel = 4,
-					.ColourSpace = IM::ImageColourSpace::SRGB
-				};
-				const IM::ImageReadResult triangle_image = IM::readFile<IM::ImageBitWidth::Eight>(ctx.Device, ctx.Allocator,
-					TriangleImageFullPathArray, triangle_image_info);
-
+				constexpr static DrawTriangle::StressInfo stress_info { };
 				const DrawTriangle::TriangleCreateInfo triangle_info {
 					.CameraDescriptorSetLayout = engine.camera().descriptorSetLayout(),
-					.SurfaceTexture = &triangle_image,
-					.DebugMessage = &cout
+					.Heap = &engine.descriptorHeap(),
+					.SurfaceTexture = &texture_read.Triangle,
+					.Uploader = &engine.uploader(),
+					.MipMap = &engine.mipMapGenerator(),
+					.DebugMessage = &cout,
+					.Stress = app_name == TriangleStress ? &stress_info : nullptr
 				};
 				return make_unique<DrawTriangle>(ctx, triangle_info);
 			}
@@ -249,55 +852,61 @@ namespace {
 			//in terrain renderer's case, we configure the terrain renderer to exclude water 
 			case Terrain:
 				[[fallthrough]];
+			case TerrainMesh:
+				[[fallthrough]];
+			case TerrainAtmosphere:
+				[[fallthrough]];
 			case Water:
+				[[fallthrough]];
+			case WaterMesh:
+				[[fallthrough]];
+			case WaterTrace:
+				[[fallthrough]];
+			case WaterTraceHalf:
+				[[fallthrough]];
+			case WaterClipmap:
+				[[fallthrough]];
+			case WaterPrePass:
 			{
-				const bool draw_water = app_name == Water;
-
-				constexpr static string_view TerrainHeightfieldFilename = "/TerrainHeightfield.png",
-					WaterNormalmapFilename = "/Water/waterNormal.png", WaterDistortionFilename = "/Water/waterDUDV.png";
-				constexpr static auto TerrainHeightfieldFullPath = File::toAbsolutePath<RP::HeightfieldResourceRoot,
-					TerrainHeightfieldFilename>();
-				constexpr static auto WaterNormalmapFullPath = File::toAbsolutePath<RP::GeneralResourceRoot, WaterNormalmapFilename>();
-				constexpr static auto WaterDistortionFullPath = File::toAbsolutePath<RP::GeneralResourceRoot, WaterDistortionFilename>();
-				constexpr static array TerrainHeightfieldFullPathArray = { TerrainHeightfieldFullPath.data() },
-					WaterNormalmapFullPathArray = { WaterNormalmapFullPath.data() },
-					WaterDistortionFullPathArray = { WaterDistortionFullPath.data() };
-
-				constexpr static IM::ImageReadInfo heightfield_info {
-					.Channel = 4,
-					.ColourSpace = IM::ImageColourSpace::Linear
-				}, water_normalmap_info {
-					.Channel = 4,
-					.ColourSpace = IM::ImageColourSpace::Linear
-				}, water_distortion_info {
-					.Channel = 2,
-					.ColourSpace = IM::ImageColourSpace::Linear
+				const bool draw_water = app_name == Water || app_name == WaterMesh || app_name == WaterTrace || app_name == WaterTraceHalf
+					|| app_name == WaterClipmap || app_name == WaterPrePass,
+					trace_water = app_name == WaterTrace || app_name == WaterTraceHalf;
+
+				//low sun in front of the initial camera, where scattering is the most visible
+				constexpr static DrawSky::AtmosphereInfo atmosphere_info {
+					.SunDirection = glm::vec3(0.0f, 0.15f, -1.0f)
 				};
-				const IM::ImageReadResult heightfield = IM::readFile<IM::ImageBitWidth::Sixteen>(ctx.Device, ctx.Allocator,
-					TerrainHeightfieldFullPathArray, heightfield_info);
-				
-				IM::ImageReadResult water_normalmap, water_distortion;
 				const SimpleTerrain::TerrainSkyCreateInfo terrain_sky_info {
-					.SkyBox = &skybox_image
+					.SkyBox = &texture_read.SkyBox,
+					.Atmosphere = app_name == TerrainAtmosphere ? &atmosphere_info : nullptr
 				};
 				SimpleTerrain::TerrainWaterCreateInfo terrain_water_info;
 				if (draw_water) {
-					water_normalmap = IM::readFile<IM::ImageBitWidth::Eight>(ctx.Device, ctx.Allocator,
-						WaterNormalmapFullPathArray, water_normalmap_info);
-					water_distortion = IM::readFile<IM::ImageBitWidth::Eight>(ctx.Device, ctx.Allocator,
-						WaterDistortionFullPathArray, water_distortion_info);
-
 					terrain_water_info = {
-						.WaterNormalmap = &water_normalmap,
-						.WaterDistortion = &water_distortion
+						.WaterNormalmap = &texture_read.WaterNormalmap,
+						.WaterDistortion = &texture_read.WaterDistortion,
+						.AccelStructMemory = &engine.accelStructPool(),
+						.RayTracingPipeline = trace_water,
+						.RayTracingResolution = app_name == WaterTraceHalf ? SimpleWater::TraceResolution::Half
+							: SimpleWater::TraceResolution::Full,
+						.Surface = app_name == WaterClipmap ? SimpleWater::SurfaceGeometry::Clipmap : SimpleWater::SurfaceGeometry::Plane
 					};
 				}
 
 				const SimpleTerrain::TerrainCreateInfo terrain_info {
 					.CameraDescriptorSetLayout = engine.camera().descriptorSetLayout(),
+					.Heap = &engine.descriptorHeap(),
 					.SkyInfo = &terrain_sky_info,
 					.WaterInfo = draw_water ? &terrain_water_info : nullptr,
-					.Heightfield = &heightfield,
+					.Heightfield = texture.Heightfield.TiledFile,
+					.MeshShader = app_name == TerrainMesh || app_name == WaterMesh,
+					.DepthPrePass = app_name == WaterPrePass,
+					.Profiler = &engine.profiler(),
+					.Uploader = &engine.uploader(),
+					.FrameMemory = &engine.frameAllocator(),
+					.PipelineLibrary = &engine.pipelineLibrary(),
+					.MipMap = &engine.mipMapGenerator(),
+					.Arena = &engine.bufferArena(),
 					.DebugMessage = &cout
 				};
 				return make_unique<SimpleTerrain>(ctx, terrain_info);
@@ -305,15 +914,96 @@ namespace {
 			default: throw runtime_error("The sample application name specified is unknown");
 			}
 		};
-		//initialise renderer and create framebuffer for swap chain using the render pass from renderer
-		const auto renderer = createSampleApplication();
-		engine.attachRenderer(renderer.get());
+
+		/************************************
+		 * Startup
+		 ***********************************/
+		//Independent phases run concurrently.
+		//Engine creation stays on the main thread for the window system,
+		//and so does renderer creation, which shares allocators that are only safe to be used by one thread.
+		//Pipeline creation, geometry and BLAS recording, and waiting for the device therefore still run in sequence
+		//inside renderer setup, and each of them is reported as a step of that phase.
+		LearnVulkan::StartupGraph startup;
+		std::ostringstream shader_precompile_msg;
+
+		const PhaseIdentifier asset_decode = startup.addPhase({
+			.Name = "Asset decode",
+			.Work = [app_name, &texture]() {
+				texture = decodeSampleTexture(app_name);
+				waitSampleTexture(texture);
+			}
+		});
+		//shaders are compiled into the cache, from which renderers load them later
+		const PhaseIdentifier shader_compile = startup.addPhase({
+			.Name = "Shader compile",
+			.Work = [&shader_precompile_msg]() {
+				LearnVulkan::ShaderModuleManager::precompileShaderCache(LearnVulkan::ResourcePath::ShaderRoot, shader_precompile_msg);
+			}
+		});
+		const PhaseIdentifier engine_setup = startup.addPhase({
+			.Name = "Engine creation",
+			.Work = [&engine_storage, canvas, &camera_data, benchmark, frame_in_flight]() {
+				engine_storage.emplace(LearnVulkan::MasterEngine::CreateInfo {
+					.Canvas = canvas,
+					.CameraData = &camera_data,
+					.DebugMessage = &cout,
+					.Offscreen = benchmark != nullptr,
+					.Pacing = {
+						.PreferredPresentMode = VK_PRESENT_MODE_FIFO_KHR,
+						.MinFrameTime = MinFrameTime
+					},
+					.FrameInFlight = frame_in_flight.value_or(benchmark ? BenchmarkFrameInFlight : InteractiveFrameInFlight),
+					//benchmark always renders at its output extent, such that every run is identical
+					.Resolution = benchmark ? std::nullopt : std::optional(LearnVulkan::DynamicResolution::CreateInfo {
+						.TargetFrameTime = DynamicResolutionTargetFrameTime
+					})
+				});
+			},
+			.MainThread = true
+		});
+
+		const array texture_staging_dependency = { asset_decode, engine_setup };
+		const PhaseIdentifier texture_staging = startup.addPhase({
+			.Name = "Texture staging",
+			.Work = [&engine_storage, &texture, &texture_read]() {
+				texture_read = readSampleTexture(engine_storage->context(), texture);
+			},
+			.Dependency = texture_staging_dependency
+		});
+		//renderer must not start compiling before the cache is populated, otherwise it may read a partially written cache
+		const array renderer_setup_dependency = { texture_staging, shader_compile };
+		startup.addPhase({
+			.Name = "Renderer setup",
+			.Work = [&engine_storage, &renderer, &createSampleApplication]() {
+				renderer = createSampleApplication();
+				engine_storage->attachRenderer(renderer.get());
+			},
+			.Dependency = renderer_setup_dependency,
+			.MainThread = true
+		});
+
+		startup.run();
+		cout << shader_precompile_msg.str();
+		startup.report(cout);
+
+		LearnVulkan::MasterEngine& engine = *engine_storage;
 
 		const auto clean_up = [canvas, &engine]() -> void {
 			CHECK_VULKAN_ERROR(vkDeviceWaitIdle(engine.context().Device));
 			engine.attachRenderer(nullptr);
 		};
-		CanvasEventStatus canvas_event;
+		if (benchmark) {
+			try {
+				runBenchmark(engine, *benchmark);
+			} catch (...) {
+				clean_up();
+				throw;
+			}
+			clean_up();
+			return;
+		}
+
+		CanvasEventStatus canvas_event { };
 		dvec2 last_cursor_position;
 		{
 			//load up initial cursor position
@@ -321,47 +1011,74 @@ namespace {
 			glfwGetCursorPos(canvas, &x, &y);
 			last_cursor_position = dvec2(x, y);
 		}
-		double last_time = glfwGetTime();
 		glfwSetWindowUserPointer(canvas, &canvas_event);
-		while (!glfwWindowShouldClose(canvas)) {
-			//frame time limit logic
-			double delta_time;
-			{
-				double current_time;
-				do {
-					current_time = glfwGetTime();
-					delta_time = current_time - last_time;
-				} while (delta_time < MinFrameTime);
-				last_time = current_time;
-			}
 
-			//I/O event
-			glfwPollEvents();
-			processKeystroke(canvas, engine.camera(), delta_time);
-			if (canvas_event.NeedReshape) {
-				//camera is automatically reshaped when the engine context is reshaped
-				engine.reshape(canvas);
+		//The main thread handles input and moves the camera, while the render thread draws with the latest camera pose.
+		//Neither thread waits for the other, except when the presentation is changed by the main thread.
+		RenderThreadControl render_control { };
+		std::thread render_thread(&runRenderThread, std::ref(engine), std::ref(render_control));
+		const auto stop_render_thread = [&render_control, &render_thread]() -> void {
+			render_control.ExitRequested.store(true, std::memory_order_relaxed);
+			resumeRenderThread(render_control);
+			render_thread.join();
+		};
+
+		try {
+			LearnVulkan::Camera& camera = engine.camera();
+			double last_input_time = glfwGetTime();
+			while (!glfwWindowShouldClose(canvas) && !render_control.Exited.load(std::memory_order_relaxed)) {
+				//I/O event
+				glfwWaitEventsTimeout(SimulationInterval);
+				const double current_time = glfwGetTime();
+				processKeystroke(canvas, camera, current_time - last_input_time);
+				last_input_time = current_time;
+				if (canvas_event.CursorMoved) {
+					double x, y;
+					glfwGetCursorPos(canvas, &x, &y);
+					const dvec2 current_pos = dvec2(x, y),
+						offset = dvec2(current_pos.x - last_cursor_position.x, last_cursor_position.y - current_pos.y);
+					last_cursor_position = current_pos;
+
+					camera.rotate(offset);
+					canvas_event.CursorMoved = false;
+				}
+				camera.publish();
+
+				if ((canvas_event.NeedReshape || canvas_event.RequestedPresentMode) && pauseRenderThread(render_control)) {
+					try {
+						if (canvas_event.NeedReshape) {
+							//camera is automatically reshaped when the engine context is reshaped
+							engine.reshape(canvas);
+						}
+						if (canvas_event.RequestedPresentMode) {
+							engine.setPresentMode(canvas, *canvas_event.RequestedPresentMode);
+						}
+					} catch (...) {
+						resumeRenderThread(render_control);
+						throw;
+					}
+					resumeRenderThread(render_control);
+				}
 				canvas_event.NeedReshape = false;
-			}
-			if (canvas_event.CursorMoved) {
-				double x, y;
-				glfwGetCursorPos(canvas, &x, &y);
-				const dvec2 current_pos = dvec2(x, y),
-					offset = dvec2(current_pos.x - last_cursor_position.x, last_cursor_position.y - current_pos.y);
-				last_cursor_position = current_pos;
-
-				engine.camera().rotate(offset);
-				canvas_event.CursorMoved = false;
-			}
+				canvas_event.RequestedPresentMode.reset();
 
-			try {
-				engine.draw(delta_time);
-			} catch (...) {
-				clean_up();
-				throw;
+				if (std::unique_lock lock(render_control.Mutex); render_control.TitleUpdated) {
+					render_control.TitleUpdated = false;
+					const std::string title = std::move(render_control.Title);
+					lock.unlock();
+					glfwSetWindowTitle(canvas, title.c_str());
+				}
 			}
+		} catch (...) {
+			stop_render_thread();
+			clean_up();
+			throw;
 		}
+		stop_render_thread();
 		clean_up();
+		if (render_control.Error) {
+			std::rethrow_exception(render_control.Error);
+		}
 	}
 
 }
@@ -372,8 +1089,26 @@ int main(const int argc, const char* const* const argv) {
 		cout << "Please specify which sample to run:\n";
 		cout << "Available options:\n";
 		cout << "-> triangle\n";
+		cout << "-> triangle-stress\n";
 		cout << "-> terrain\n";
-		cout << "-> water" << endl;
+		cout << "-> water\n";
+		cout << "-> terrain-mesh\n";
+		cout << "-> water-mesh\n";
+		cout << "-> water-trace\n";
+		cout << "-> water-trace-half\n";
+		cout << "-> water-clipmap\n";
+		cout << "-> water-prepass\n";
+		cout << "-> terrain-atmosphere\n";
+		cout << "Append \'benchmark [frame count] [JSON report filename]\' to run the sample offscreen along a scripted camera path." << endl;
+		cout << "Append \'" << FrameInFlightOption << "<1-" << LearnVulkan::EngineSetting::MaxFrameInFlight
+			<< ">\' to override the number of frame in flight, which is " << InteractiveFrameInFlight
+			<< " when interactive and " << BenchmarkFrameInFlight << " when benchmarking by default." << endl;
+		cout << "Or specify \'shader-cache\' to compile every shader into the shader cache without running any sample." << endl;
+		return EXIT_SUCCESS;
+	}
+	if (string_view(argv[1]) == "shader-cache") {
+		//shaders are compiled without any device, such that the cache can be generated as a build step
+		LearnVulkan::ShaderModuleManager::precompileShaderCache(LearnVulkan::ResourcePath::ShaderRoot, cout);
 		return EXIT_SUCCESS;
 	}
 
@@ -383,22 +1118,98 @@ int main(const int argc, const char* const* const argv) {
 		selection == "triangle") {
 		app_name = Triangle;
 		cout << "My very first Vulkan application, demonstrates the basic workflow to setup a Vulkan renderer." << endl;
+	} else if (selection == "triangle-stress") {
+		app_name = TriangleStress;
+		cout << "Millions of triangle instances generated, culled and drawn on the device, to stress vertex and draw throughput." << endl;
 	} else if (selection == "terrain") {
 		app_name = Terrain;
 		cout << "Demonstration of implementing a terrain renderer using compute and tessellation shader." << endl;
 	} else if (selection == "water") {
 		app_name = Water;
 		cout << "First experience of diving into ray tracing to render reflective and refractive water." << endl;
+	} else if (selection == "terrain-mesh") {
+		app_name = TerrainMesh;
+		cout << "Terrain renderer using task and mesh shader in place of tessellation, if supported by the device." << endl;
+	} else if (selection == "water-mesh") {
+		app_name = WaterMesh;
+		cout << "Water renderer with terrain rendered using task and mesh shader, if supported by the device." << endl;
+	} else if (selection == "water-trace") {
+		app_name = WaterTrace;
+		cout << "Water renderer tracing reflection and refraction with ray tracing pipeline, if supported by the device." << endl;
+	} else if (selection == "water-trace-half") {
+		app_name = WaterTraceHalf;
+		cout << "Water renderer tracing at half resolution, and reconstructing full resolution spatially and temporally." << endl;
+	} else if (selection == "water-clipmap") {
+		app_name = WaterClipmap;
+		cout << "Water renderer drawing the surface as a clipmap centred at the camera, with a fixed vertex count." << endl;
+	} else if (selection == "water-prepass") {
+		app_name = WaterPrePass;
+		cout << "Water renderer with terrain depth filled by a depth pre-pass, such that every terrain sample is shaded once." << endl;
+	} else if (selection == "terrain-atmosphere") {
+		app_name = TerrainAtmosphere;
+		cout << "Terrain renderer with sky baked from single scattering in the atmosphere, in place of a sky box texture." << endl;
 	} else {
 		cout << "Unknown sample name \'" << selection << '\'' << endl;
 		return EXIT_SUCCESS;
 	}
 
+	//options may appear anywhere after the sample name, and the rest are positional
+	std::optional<unsigned int> frame_in_flight;
+	vector<const char*> positional;
+	for (const auto i : iota(2, argc)) {
+		const string_view arg = argv[i];
+		if (!arg.starts_with(FrameInFlightOption)) {
+			positional.push_back(argv[i]);
+			continue;
+		}
+
+		const string_view value = arg.substr(FrameInFlightOption.size());
+		unsigned int count = 0u;
+		if (const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+			ec != std::errc { } || ptr != value.data() + value.size()
+			|| count == 0u || count > LearnVulkan::EngineSetting::MaxFrameInFlight) {
+			cout << "Invalid number of frame in flight \'" << value << "\', expecting 1 to "
+				<< LearnVulkan::EngineSetting::MaxFrameInFlight << endl;
+			return EXIT_FAILURE;
+		}
+		frame_in_flight = count;
+	}
+
+	BenchmarkSetting benchmark_setting {
+		.SampleName = argv[1],
+		.FrameCount = BenchmarkDefaultFrameCount,
+		.OutputFilename = nullptr
+	};
+	const bool run_benchmark = !positional.empty() && string_view(positional[0]) == "benchmark";
+	if (run_benchmark) {
+		if (positional.size() > 1u) {
+			const string_view frame_count = positional[1];
+			if (const auto [ptr, ec] = std::from_chars(frame_count.data(), frame_count.data() + frame_count.size(), benchmark_setting.FrameCount);
+				ec != std::errc { } || ptr != frame_count.data() + frame_count.size() || benchmark_setting.FrameCount == 0u) {
+				cout << "Invalid benchmark frame count \'" << frame_count << '\'' << endl;
+				return EXIT_FAILURE;
+			}
+		}
+		if (positional.size() > 2u) {
+			benchmark_setting.OutputFilename = positional[2];
+		}
+	}
+
 	try {
 		CHECK_GLFW_ERROR(glfwInit());
 		CHECK_VULKAN_ERROR(volkInitialize());
-		runApplication(app_name);
+		LearnVulkan::CpuProfiler::nameThread("Main");
+		runApplication(app_name, run_benchmark ? &benchmark_setting : nullptr, frame_in_flight);
 		glfwTerminate();
+
+		if constexpr (LearnVulkan::EngineSetting::EnableCpuProfiler) {
+			std::ofstream trace(CpuTraceFilename);
+			if (!trace) {
+				throw runtime_error("Unable to open the CPU trace file for writing");
+			}
+			LearnVulkan::CpuProfiler::writeChromeTrace(trace);
+			cout << "CPU trace is written to \'" << CpuTraceFilename << '\'' << endl;
+		}
 	} catch (const std::exception& e) {
 		cerr << e.what() << endl;
 		glfwTerminate();